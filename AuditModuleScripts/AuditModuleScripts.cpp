@@ -0,0 +1,977 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	AuditModuleScripts.cpp
+
+Abstract:
+
+	This module houses a program that audits the script references of a
+	module.  Every event script field (such as OnHeartbeat or OnUsed) of the
+	GFF resources of the module and its HAKs is collected, and each script is
+	checked for a compiled (.ncs) and a source (.nss) resource.
+
+	The report lists, for each script, how many references and resources use
+	it, ordered from the most used script.  Scripts that are missing, or
+	were never compiled, are flagged.
+
+	Resources are read in parallel.  Script fields are located by scanning
+	the field array of each file for the label indicies that name script
+	fields, rather than by looking each field up by name.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	PrintfTextOut(
+		)
+	{
+		AllocConsole( );
+	}
+
+	inline
+	~PrintfTextOut(
+		)
+	{
+		FreeConsole( );
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine displays text to the log file and the debug console.
+
+		The console output may have color attributes supplied, as per the standard
+		SetConsoleTextAttribute API.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text as per the standard
+					 SetConsoleTextAttribute API (e.g. FOREGROUND_RED).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		HANDLE console = GetStdHandle( STD_OUTPUT_HANDLE );
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+		DWORD n = (DWORD)strlen(buf);
+		SetConsoleTextAttribute( console, Attributes );
+		WriteConsoleA(console, buf, n, &n, 0);
+	}
+
+};
+
+//
+// Define the GFF resource types whose script references are collected.
+//
+
+static const NWN::ResType AuditTypes[ ] =
+{
+	NWN::ResIFO,
+	NWN::ResARE,
+	NWN::ResGIT,
+	NWN::ResDLG,
+	NWN::ResUTC,
+	NWN::ResUTD,
+	NWN::ResUTE,
+	NWN::ResUTI,
+	NWN::ResUTM,
+	NWN::ResUTP,
+	NWN::ResUTS,
+	NWN::ResUTT,
+	NWN::ResUTW,
+	NWN::ResUPE
+};
+
+//
+// Define the labels of RESREF fields that name scripts.  A label matches a
+// prefix entry if it begins with the prefix, and an exact entry if it is
+// equal to it.  Event scripts are named On<Event> on most objects,
+// Script<Event> on creatures, Mod_On<Event> in module.ifo, and conversation
+// nodes use Script (action) and Active (condition).
+//
+
+struct ScriptLabelSpec
+{
+	const char * Label;
+	bool         Prefix;
+};
+
+static const ScriptLabelSpec ScriptLabels[ ] =
+{
+	{ "On",     true  },
+	{ "Script", true  },
+	{ "Mod_On", true  },
+	{ "Active", false }
+};
+
+//
+// Define the status of a referenced script.
+//
+
+typedef enum _SCRIPT_STATUS
+{
+	ScriptCompiled,    // .ncs exists
+	ScriptNotCompiled, // Only the .nss exists
+	ScriptMissing,     // Neither exists
+
+	LastScriptStatus
+} SCRIPT_STATUS, * PSCRIPT_STATUS;
+
+static const char * ScriptStatusNames[ LastScriptStatus ] =
+{
+	"OK",
+	"NOT_COMPILED",
+	"MISSING"
+};
+
+//
+// Define a script reference made by a resource.
+//
+
+struct ScriptReference
+{
+	NWN::ResRef32 Script;
+	std::string   Label;
+};
+
+typedef std::vector< ScriptReference > ScriptReferenceVec;
+
+//
+// Define the results of a scan item.  Present is filled in before the scan,
+// and selects the resource types of the item that are read; the other types
+// may only exist in the base game data.
+//
+
+struct ItemResult
+{
+	std::vector< bool >                  Present;
+	std::vector< ScriptReferenceVec >    References; // Parallel to AuditTypes
+};
+
+typedef std::vector< ItemResult > ItemResultVec;
+
+//
+// Define the usage of a script across the module.
+//
+
+struct ScriptUsage
+{
+	NWN::ResRef32           Script;
+	ULONG                   References;
+	ULONG                   Resources;
+	std::set< std::string > Events;
+	std::string             FirstReferrer;
+	SCRIPT_STATUS           Status;
+};
+
+typedef std::vector< ScriptUsage > ScriptUsageVec;
+
+size_t
+GetAuditTypeIndex(
+	__in NWN::ResType ResType
+	)
+/*++
+
+Routine Description:
+
+	This routine looks up the audit table index of a resource type.
+
+Arguments:
+
+	ResType - Supplies the resource type to look up.
+
+Return Value:
+
+	The routine returns the index of the resource type in AuditTypes, else
+	RTL_NUMBER_OF( AuditTypes ) if the type is not audited.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < RTL_NUMBER_OF( AuditTypes ); i += 1)
+	{
+		if (AuditTypes[ i ] == ResType)
+			return i;
+	}
+
+	return RTL_NUMBER_OF( AuditTypes );
+}
+
+bool
+IsScriptLabel(
+	__in const std::string & Label
+	)
+/*++
+
+Routine Description:
+
+	This routine determines whether a field label names a script field.
+
+Arguments:
+
+	Label - Supplies the field label.
+
+Return Value:
+
+	The routine returns true if the label names a script field, else false.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	for (size_t i = 0; i < RTL_NUMBER_OF( ScriptLabels ); i += 1)
+	{
+		if (ScriptLabels[ i ].Prefix)
+		{
+			if (!Label.compare( 0, strlen( ScriptLabels[ i ].Label ), ScriptLabels[ i ].Label ))
+				return true;
+		}
+		else
+		{
+			if (Label == ScriptLabels[ i ].Label)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// Define the module scan visitor that collects the script references of the
+// resources of each item.
+//
+
+class ScriptAuditVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	inline
+	ScriptAuditVisitor(
+		__inout ItemResultVec & Results
+		)
+	: m_Results( Results )
+	{
+	}
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+private:
+
+	ScriptAuditVisitor &
+	operator=(
+		__in const ScriptAuditVisitor & other
+		);
+
+	ItemResultVec & m_Results;
+
+};
+
+void
+ScriptAuditVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine collects the script references of each resource of an item.
+
+	The labels of each file are classified once, which yields the set of
+	label indicies that name script fields.  The field array of the file is
+	then scanned for RESREF fields with those label indicies.
+
+	It is called on a module scan worker thread.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the item to read.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	ItemResult                    & Result = m_Results[ Context.GetItemIndex( ) ];
+	std::vector< std::string >      Labels;
+	std::vector< bool >             ScriptLabelIds;
+	GffFileReader::ResRefFieldVec   Fields;
+
+	Result.References.resize( RTL_NUMBER_OF( AuditTypes ) );
+
+	for (size_t t = 0; t < RTL_NUMBER_OF( AuditTypes ); t += 1)
+	{
+		const GffFileReader * Reader;
+
+		if (!Result.Present[ t ])
+			continue;
+
+		Reader = Context.GetGffReader( AuditTypes[ t ] );
+
+		Reader->GetLabels( Labels );
+
+		ScriptLabelIds.clear( );
+		ScriptLabelIds.resize( Labels.size( ), false );
+
+		for (size_t i = 0; i < Labels.size( ); i += 1)
+			ScriptLabelIds[ i ] = IsScriptLabel( Labels[ i ] );
+
+		Reader->FindResRefFields( ScriptLabelIds, Fields );
+
+		for (GffFileReader::ResRefFieldVec::const_iterator it = Fields.begin( );
+		     it != Fields.end( );
+		     ++it)
+		{
+			ScriptReference Reference;
+
+			//
+			// An empty field means that the event has no script.
+			//
+
+			if (it->ResRef.RefStr[ 0 ] == '\0')
+				continue;
+
+			Reference.Script = it->ResRef;
+			Reference.Label  = Labels[ it->LabelIndex ];
+
+			Result.References[ t ].push_back( Reference );
+		}
+	}
+}
+
+void
+AddModuleResources(
+	__in ResourceManager & ResMan,
+	__inout ModuleScan & Scan,
+	__out ItemResultVec & Results
+	)
+/*++
+
+Routine Description:
+
+	This routine adds a scan item for every resource name that has an audited
+	resource in the module, its HAKs, or a directory (such as the override
+	directory), and records which types each item has there.  Resources that
+	only exist in the base game data files are not audited.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan that receives the items.
+
+	Results - Receives the results of each item, with the present resource
+	          types filled in, in item order.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< std::string, std::pair< NWN::ResRef32, std::vector< bool > > > ItemMap;
+
+	ItemMap Items;
+	size_t  i;
+
+	for (ResourceManager::FileId Id = 0;
+	     Id < ResMan.GetEncapsulatedFileCount( );
+	     Id += 1)
+	{
+		NWN::ResRef32                 ResRef;
+		NWN::ResType                  ResType;
+		size_t                        TypeIndex;
+		ResourceManager::FileHandle   Handle;
+		ResourceManager::AccessorType AccessorType;
+		std::string                   AccessorName;
+
+		if (!ResMan.GetEncapsulatedFileEntry( Id, ResRef, ResType ))
+			continue;
+
+		TypeIndex = GetAuditTypeIndex( ResType );
+
+		if (TypeIndex == RTL_NUMBER_OF( AuditTypes ))
+			continue;
+
+		//
+		// Determine where the resource comes from.  The module and its HAKs
+		// are ERFs, or the module is a directory.
+		//
+
+		Handle = ResMan.OpenFileByIndex( Id );
+
+		if (Handle == ResourceManager::INVALID_FILE)
+			continue;
+
+		try
+		{
+			AccessorType = ResMan.GetResourceAccessorName( Handle, AccessorName );
+		}
+		catch (std::exception)
+		{
+			ResMan.CloseFile( Handle );
+			throw;
+		}
+
+		ResMan.CloseFile( Handle );
+
+		if ((AccessorType != ResourceManager::AccessorTypeErf) &&
+		    (AccessorType != ResourceManager::AccessorTypeDirectory))
+		{
+			continue;
+		}
+
+		std::pair< NWN::ResRef32, std::vector< bool > > & Item = Items[ ResMan.StrFromResRef( ResRef ) ];
+
+		if (Item.second.empty( ))
+		{
+			Item.first = ResRef;
+			Item.second.resize( RTL_NUMBER_OF( AuditTypes ), false );
+		}
+
+		Item.second[ TypeIndex ] = true;
+	}
+
+	Results.clear( );
+	Results.resize( Items.size( ) );
+
+	i = 0;
+
+	for (ItemMap::const_iterator it = Items.begin( );
+	     it != Items.end( );
+	     ++it, i += 1)
+	{
+		Scan.AddItem( it->second.first );
+
+		Results[ i ].Present = it->second.second;
+	}
+}
+
+bool
+CompareScriptUsage(
+	__in const ScriptUsage & Usage1,
+	__in const ScriptUsage & Usage2
+	)
+/*++
+
+Routine Description:
+
+	This routine orders scripts from the most referenced, then by name.
+
+Arguments:
+
+	Usage1 - Supplies the first script.
+
+	Usage2 - Supplies the second script.
+
+Return Value:
+
+	The routine returns true if the first script is ordered first.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Usage1.References != Usage2.References)
+		return Usage1.References > Usage2.References;
+
+	return memcmp( &Usage1.Script, &Usage2.Script, sizeof( Usage1.Script ) ) < 0;
+}
+
+void
+MergeScriptUsage(
+	__in ResourceManager & ResMan,
+	__in const ModuleScan & Scan,
+	__in const ItemResultVec & Results,
+	__out ScriptUsageVec & Usage
+	)
+/*++
+
+Routine Description:
+
+	This routine merges the script references of every resource into the
+	usage of each script, and checks each script for its compiled and source
+	resources.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan whose items were read.
+
+	Results - Supplies the results of each item.
+
+	Usage - Receives the usage of each referenced script, ordered from the
+	        most referenced script.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< std::string, ScriptUsage > ScriptMap;
+
+	ScriptMap Scripts;
+
+	for (size_t i = 0; i < Results.size( ); i += 1)
+	{
+		for (size_t t = 0; t < Results[ i ].References.size( ); t += 1)
+		{
+			std::set< std::string > Seen;
+			std::string             Referrer;
+
+			if (Results[ i ].References[ t ].empty( ))
+				continue;
+
+			Referrer  = ResMan.StrFromResRef( Scan.GetItems( )[ i ].ResRef );
+			Referrer += ".";
+			Referrer += ResourceManager::ResTypeToExt( AuditTypes[ t ] );
+
+			for (ScriptReferenceVec::const_iterator it = Results[ i ].References[ t ].begin( );
+			     it != Results[ i ].References[ t ].end( );
+			     ++it)
+			{
+				std::string   Name  = ResMan.StrFromResRef( it->Script );
+				ScriptUsage & Entry = Scripts[ Name ];
+
+				if (Entry.References == 0)
+				{
+					Entry.Script        = ResourceManager::ResRef32FromStr( Name );
+					Entry.FirstReferrer = Referrer;
+				}
+
+				Entry.References += 1;
+				Entry.Events.insert( it->Label );
+
+				if (Seen.insert( Name ).second)
+					Entry.Resources += 1;
+			}
+		}
+	}
+
+	//
+	// Resolve each script once, regardless of how often it is referenced.
+	//
+
+	Usage.clear( );
+	Usage.reserve( Scripts.size( ) );
+
+	for (ScriptMap::iterator it = Scripts.begin( );
+	     it != Scripts.end( );
+	     ++it)
+	{
+		if (ResMan.ResourceExists( it->second.Script, NWN::ResNCS ))
+			it->second.Status = ScriptCompiled;
+		else if (ResMan.ResourceExists( it->second.Script, NWN::ResNSS ))
+			it->second.Status = ScriptNotCompiled;
+		else
+			it->second.Status = ScriptMissing;
+
+		Usage.push_back( it->second );
+	}
+
+	std::sort( Usage.begin( ), Usage.end( ), CompareScriptUsage );
+}
+
+bool
+WriteReport(
+	__in const char * ReportFile,
+	__in ResourceManager & ResMan,
+	__in const ScriptUsageVec & Usage
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the script report, a tab separated file with one line
+	for each referenced script, ordered from the most referenced script.
+
+Arguments:
+
+	ReportFile - Supplies the path to the report file to write.
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Usage - Supplies the usage of each script.
+
+Return Value:
+
+	The routine returns true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE * f;
+
+	f = fopen( ReportFile, "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Script\tReferences\tResources\tStatus\tEvents\tFirstReferrer\n" );
+
+	for (ScriptUsageVec::const_iterator it = Usage.begin( );
+	     it != Usage.end( );
+	     ++it)
+	{
+		std::string Events;
+
+		for (std::set< std::string >::const_iterator eit = it->Events.begin( );
+		     eit != it->Events.end( );
+		     ++eit)
+		{
+			if (!Events.empty( ))
+				Events += ",";
+
+			Events += *eit;
+		}
+
+		fprintf(
+			f,
+			"%s\t%lu\t%lu\t%s\t%s\t%s\n",
+			ResMan.StrFromResRef( it->Script ).c_str( ),
+			it->References,
+			it->Resources,
+			ScriptStatusNames[ it->Status ],
+			Events.c_str( ),
+			it->FirstReferrer.c_str( ));
+	}
+
+	return (fclose( f ) == 0);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"AuditModuleScripts\n"
+		"\n"
+		"This program collects the event script references of the GFF resources of\n"
+		"a module and its HAKs, and checks that each script has been compiled.\n"
+		"\n"
+		"Usage: AuditModuleScripts -home <homedir> -installdir <installdir>\n"
+		"                          -module <module resource name>\n"
+		"                          [-report <report file>]\n"
+		"                          [-threads <worker thread count>]\n"
+		"\n"
+		"The report is a tab separated file with one line for each script, ordered\n"
+		"from the most referenced script.  The program exits with status 1 if any\n"
+		"referenced script is missing or was not compiled.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the module script audit
+	program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char    * ModuleName;
+	const char    * NWN2Home;
+	const char    * InstallDir;
+	const char    * ReportFile;
+	unsigned long   MaxThreads;
+	int             ExitCode;
+
+	ModuleName = NULL;
+	NWN2Home   = NULL;
+	InstallDir = NULL;
+	ReportFile = NULL;
+	MaxThreads = 0;
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-module" )) && (i + 1 < argc))
+			ModuleName = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-home" )) && (i + 1 < argc))
+			NWN2Home = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-installdir" )) && (i + 1 < argc))
+			InstallDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-report" )) && (i + 1 < argc))
+			ReportFile = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	//
+	// First, check that we've got the necessary arguments.
+	//
+
+	if (ModuleName == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the module resource name of the module to load with -module <module resource name>.  The module resource name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (NWN2Home == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 home directory location with -home <homedir>.  The home directory is typically the path to your \"Documents\\Neverwinter Nights 2\" directory.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (InstallDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 game installation directory location with -installdir <installdir>.  The installation directory is typically the path to the Neverwinter Nights 2 directory under Program Files.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	//
+	// Now spin up a resource manager instance.
+	//
+
+	PrintfTextOut   TextOut;
+	ResourceManager ResMan( &TextOut );
+
+	ExitCode = 0;
+
+	try
+	{
+		ItemResultVec  Results;
+		ScriptUsageVec Usage;
+		ULONG          References;
+		ULONG          Counts[ LastScriptStatus ];
+
+		TextOut.WriteText( "Loading module...\n" );
+		ModuleScan::LoadModule( ResMan, ModuleName, NWN2Home, InstallDir );
+
+		ModuleScan Scan( ResMan, &TextOut );
+
+		Scan.SetScanTypes( AuditTypes, RTL_NUMBER_OF( AuditTypes ) );
+
+		AddModuleResources( ResMan, Scan, Results );
+
+		TextOut.WriteText( "Reading %lu resource names...\n", (unsigned long) Results.size( ) );
+
+		ScriptAuditVisitor Visitor( Results );
+
+		if (!Scan.Scan( &Visitor, MaxThreads ))
+			ExitCode = 1;
+
+		MergeScriptUsage( ResMan, Scan, Results, Usage );
+
+		//
+		// Flag the scripts that cannot run.
+		//
+
+		References = 0;
+
+		ZeroMemory( Counts, sizeof( Counts ) );
+
+		for (ScriptUsageVec::const_iterator it = Usage.begin( );
+		     it != Usage.end( );
+		     ++it)
+		{
+			References           += it->References;
+			Counts[ it->Status ] += 1;
+
+			if (it->Status == ScriptCompiled)
+				continue;
+
+			TextOut.WriteText(
+				FOREGROUND_RED | FOREGROUND_INTENSITY,
+				"%s: %s (%lu references in %lu resources, first in %s).\n",
+				ResMan.StrFromResRef( it->Script ).c_str( ),
+				(it->Status == ScriptMissing) ? "script does not exist" : "script was not compiled",
+				it->References,
+				it->Resources,
+				it->FirstReferrer.c_str( ));
+		}
+
+		TextOut.WriteText(
+			"Found %lu references to %lu scripts (%lu missing, %lu not compiled) in %lums (%lums locating resources) with %lu threads.\n",
+			References,
+			(unsigned long) Usage.size( ),
+			Counts[ ScriptMissing ],
+			Counts[ ScriptNotCompiled ],
+			Scan.GetStats( ).PrepareTime + Scan.GetStats( ).VisitTime,
+			Scan.GetStats( ).PrepareTime,
+			Scan.GetStats( ).Threads);
+
+		if ((Counts[ ScriptMissing ] != 0) || (Counts[ ScriptNotCompiled ] != 0))
+			ExitCode = 1;
+
+		if (ReportFile != NULL)
+		{
+			if (!WriteReport( ReportFile, ResMan, Usage ))
+			{
+				TextOut.WriteText( "ERROR: Failed to write report file '%s'.\n", ReportFile );
+				ExitCode = -1;
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
+		ExitCode = -1;
+	}
+
+	return ExitCode;
+}
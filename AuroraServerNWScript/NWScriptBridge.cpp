@@ -98,6 +98,8 @@ Environment:
 --*/
 {
 	const NWScriptActionEntry * ActionEntry;
+	bool                        Recorded;
+	bool                        Completed;
 
 	UNREFERENCED_PARAMETER( VMStack );
 
@@ -123,6 +125,17 @@ Environment:
 		return;
 	}
 
+	//
+	// If an action trace is being recorded, capture the arguments now, while
+	// they are still on the stack.
+	//
+
+	Recorded  = m_TraceWriter.BeginAction(
+		&NWActions_NWN2[ ActionId ],
+		NumArguments,
+		VMStack);
+	Completed = true;
+
 	try
 	{
 		PushParametersToServerVMStack( VMStack, ActionId, NumArguments );
@@ -141,6 +154,14 @@ Environment:
 		}
 
 		ScriptVM.AbortScript( );
+		Completed = false;
+	}
+
+	if (Recorded)
+	{
+		m_TraceWriter.EndAction(
+			VMStack,
+			(Completed) && (!ScriptVM.IsScriptAborted( )));
 	}
 }
 
@@ -456,7 +477,7 @@ Environment:
 
 	try
 	{
-		Bridge = new EngineStructureBridge(
+		Bridge = new (EngineType) EngineStructureBridge(
 			EngineType,
 			m_ServerCmdImplementer,
 			Representation);
@@ -952,7 +973,7 @@ Environment:
 
 	try
 	{
-		Bridge = new EngineStructureBridge(
+		Bridge = new (EngineType) EngineStructureBridge(
 			EngineType,
 			m_ServerCmdImplementer,
 			Representation);
@@ -1566,7 +1587,7 @@ Environment:
 
 	try
 	{
-		Bridge = new EngineStructureBridge(
+		Bridge = new ((INWScriptStack::ENGINE_STRUCTURE_NUMBER) EngineType) EngineStructureBridge(
 			(INWScriptStack::ENGINE_STRUCTURE_NUMBER) EngineType,
 			CmdImplementer,
 			NewRepresentation);
@@ -103,6 +103,56 @@ public:
 		m_DebugLevel = DebugLevel;
 	}
 
+	//
+	// Start (or, with an empty file name, stop) recording an action trace.
+	// Only action calls serviced for the reference VM are recorded, so the
+	// caller only brackets scripts that it runs under the reference VM with
+	// BeginTraceScript / EndTraceScript.
+	//
+
+	inline
+	bool
+	SetActionTraceFile(
+		__in const std::string & FileName
+		)
+	{
+		if (FileName.empty( ))
+		{
+			m_TraceWriter.Close( );
+			return true;
+		}
+
+		return m_TraceWriter.Open( FileName.c_str( ) );
+	}
+
+	inline
+	bool
+	IsActionTraceEnabled(
+		) const
+	{
+		return m_TraceWriter.IsOpen( );
+	}
+
+	inline
+	void
+	BeginTraceScript(
+		__in const char * ScriptName,
+		__in NWN::OBJECTID ObjectSelf,
+		__in const NWScriptVM::ScriptParamVec & Parameters
+		)
+	{
+		m_TraceWriter.BeginScript( ScriptName, ObjectSelf, Parameters );
+	}
+
+	inline
+	void
+	EndTraceScript(
+		__in int ReturnCode
+		)
+	{
+		m_TraceWriter.EndScript( ReturnCode );
+	}
+
 	//
 	// INWScriptActions implementation.
 	//
@@ -400,6 +450,7 @@ private:
 	bool                                        m_LastActionFromJIT;
 	bool                                        m_JITScriptAborted;
 	NWScriptStack::STACK_POINTER                m_IntegerSPSize;
+	NWScriptActionTraceWriter                   m_TraceWriter;
 
 	//
 	// Define the action handler table, which is dispatched by the core
@@ -457,8 +508,13 @@ public:
 	// to reside in a separate DLL as an optional component) may perform frees
 	// in some circumstances.
 	//
+	// Bridge objects are allocated from the engine structure pool, as scripts
+	// create and discard them (effects in particular) at a high rate.  The
+	// pool is likewise cross-module safe, as frees are dispatched through the
+	// virtual destructor into the allocating module.
+	//
 
-	DECLARE_SWUTIL_CROSS_MODULE_NEW( );
+	DECLARE_ENGINE_STRUCTURE_POOLED_NEW( );
 	
 	//
 	// Return the opaque NWN2Server representation of the engine structure that
@@ -378,13 +378,33 @@ Environment:
 						CodeSize);
 				}
 
-				ReturnCode = m_VM->ExecuteScript(
-					ScriptData->Reader,
+				//
+				// Only action calls made through the reference VM can be
+				// recorded, so only scripts run here go into an action trace.
+				//
+
+				m_Bridge->BeginTraceScript(
+					ServerVM->GetScriptName( ),
 					ServerVM->GetCurrentActionObjectSelf( ),
-					NWN::INVALIDOBJID,
-					Params,
-					0,
-					NWScriptVM::ESF_STATIC_TYPE_DISCOVERY);
+					Params);
+
+				try
+				{
+					ReturnCode = m_VM->ExecuteScript(
+						ScriptData->Reader,
+						ServerVM->GetCurrentActionObjectSelf( ),
+						NWN::INVALIDOBJID,
+						Params,
+						0,
+						NWScriptVM::ESF_STATIC_TYPE_DISCOVERY);
+				}
+				catch (std::exception)
+				{
+					m_Bridge->EndTraceScript( 0 );
+					throw;
+				}
+
+				m_Bridge->EndTraceScript( ReturnCode );
 			}
 #endif
 
@@ -64,6 +64,7 @@ Abstract:
 #include "../NWNScriptLib/NWScriptStack.h"
 #include "../NWNScriptLib/NWScriptInterfaces.h"
 #include "../NWNScriptLib/NWScriptVM.h"
+#include "../NWNScriptLib/NWScriptActionTrace.h"
 #include "../NWNScriptLib/NWScriptAnalyzer.h"
 #include "../NWNScriptJIT/NWNScriptJIT.h"
 #include "../NWNScriptJIT/NWScriptJITLib.h"
@@ -394,9 +394,50 @@ Environment:
 		return false;
 	}
 
+	if (!m_ActionTraceFile.empty( ))
+		ApplyActionTraceFile( );
+
 	return true;
 }
 
+void
+ServerNWScriptPlugin::ApplyActionTraceFile(
+	)
+/*++
+
+Routine Description:
+
+	This routine starts (or stops) recording an action trace to the
+	configured action trace file.  An existing trace file is replaced.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.  Failures are logged.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (!m_Bridge->SetActionTraceFile( m_ActionTraceFile ))
+	{
+		m_TextOut->WriteText(
+			"Failed to create action trace file %s.\n",
+			m_ActionTraceFile.c_str( ));
+	}
+	else if (!m_ActionTraceFile.empty( ))
+	{
+		m_TextOut->WriteText(
+			"Recording action trace to %s.\n",
+			m_ActionTraceFile.c_str( ));
+	}
+}
+
 bool
 ServerNWScriptPlugin::EstablishRuntime(
 	__in const char * NWNXHome
@@ -548,7 +589,9 @@ Environment:
 {
 	try
 	{
-		wchar_t StrValue[ MAX_PATH + 1 ];
+		wchar_t     StrValue[ MAX_PATH + 1 ];
+		std::string ActionTraceFile;
+		bool        ActionTraceChanged;
 		
 		if (m_IniPath.empty( ))
 		{
@@ -640,6 +683,20 @@ Environment:
 				m_CodeGenOutputDirectory.push_back( L'\\' );
 		}
 
+		GetPrivateProfileString(
+			L"Settings",
+			L"ActionTraceFile",
+			L"",
+			StrValue,
+			MAX_PATH,
+			m_IniPath.c_str( ));
+
+		if (!swutil::UnicodeToAnsi( StrValue, ActionTraceFile ))
+			throw std::runtime_error( "Character conversion failed." );
+
+		ActionTraceChanged = (ActionTraceFile != m_ActionTraceFile);
+		m_ActionTraceFile  = ActionTraceFile;
+
 		m_TextOut->WriteText(
 			"DebugLevel set to %lu.\n",
 			(unsigned long) m_DebugLevel );
@@ -688,10 +745,24 @@ Environment:
 			_wmkdir( m_CodeGenOutputDirectory.c_str( ) );
 		}
 
+		if (m_ActionTraceFile.empty( ))
+		{
+			m_TextOut->WriteText(
+				"Action calls will not be recorded.\n" );
+		}
+		else
+		{
+			m_TextOut->WriteText(
+				"ActionTraceFile set to %s (only scripts run by the reference VM are recorded).\n",
+				m_ActionTraceFile.c_str( ) );
+		}
+
 		if (m_Runtime != NULL)
 			m_Runtime->SetDebugLevel( m_DebugLevel );
 		if (m_Bridge != NULL)
 			m_Bridge->SetDebugLevel( m_DebugLevel );
+		if ((m_Bridge != NULL) && (ActionTraceChanged))
+			ApplyActionTraceFile( );
 	}
 	catch (std::exception &e)
 	{
@@ -260,6 +260,10 @@ private:
 		__in const char * NWNXHome
 		);
 
+	void
+	ApplyActionTraceFile(
+		);
+
 	void
 	PatchCmdImplementer(
 		__in NWN2Server::CVirtualMachine * ServerVM
@@ -287,6 +291,7 @@ private:
 	void                        * m_OrigCmdImplementerVtable;
 	std::wstring                  m_IniPath;
 	std::wstring                  m_CodeGenOutputDirectory;
+	std::string                   m_ActionTraceFile;
 	NWScriptVM::ExecDebugLevel    m_DebugLevel;
 	bool                          m_UseReferenceVM;
 	ULONG                         m_MinFreeMemoryToJIT;
@@ -0,0 +1,668 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	BufferParserTest.cpp
+
+Abstract:
+
+	This module houses a program that checks the word at a time bit field
+	extraction of swutil::BufferParser against the original bit at a time
+	implementation, and measures the throughput of both.
+
+	The check covers both bit orders, every starting bit offset and every
+	field width from 0 to 64 bits (including fields that straddle the 64-bit
+	window, i.e. more than 57 bits at a nonzero offset), at every byte
+	position of a buffer so that the tail handling near the end of the buffer
+	is exercised, and with every highest valid bit position of the last byte.
+
+--*/
+
+#include "Precomp.h"
+
+using swutil::BufferParser;
+
+//
+// Define the size of the buffers used by the equivalence check.  The buffer
+// must be longer than the 9 bytes that a single field may span so that both
+// the window and the tail paths are taken.
+//
+
+#define CHECK_BUFFER_SIZE  24
+#define CHECK_BUFFER_COUNT 32
+
+//
+// Define the field widths measured by the benchmark.
+//
+
+const size_t BenchmarkWidths[ ] = { 1, 5, 13, 32, 64 };
+
+//
+// Define a bit reader that replicates the original, bit at a time,
+// implementation of BufferParser::GetFieldBits.  It keeps the same position
+// state as BufferParser so that positions can be compared after each read.
+//
+
+class ReferenceBitReader
+{
+
+public:
+
+	inline
+	ReferenceBitReader(
+		__in_bcount( Length ) const unsigned char * Data,
+		__in size_t Length,
+		__in BufferParser::BitOrderMode BitOrder
+		)
+	: m_Data( Data ),
+	  m_DataPos( Data ),
+	  m_DataPosRemaining( Length ),
+	  m_BitPos( 8 ),
+	  m_HighestValidBitPos( 8 ),
+	  m_BitOrderMode( BitOrder )
+	{
+	}
+
+	inline
+	void
+	SetHighestValidBitPos(
+		__in size_t HighestValidBitPos
+		)
+	{
+		m_HighestValidBitPos = HighestValidBitPos;
+	}
+
+	inline
+	bool
+	SkipData(
+		__in size_t FieldLength
+		)
+	{
+		if ((m_BitPos != 8) || (m_DataPosRemaining < FieldLength))
+			return false;
+
+		m_DataPosRemaining -= FieldLength;
+		m_DataPos          += FieldLength;
+
+		return true;
+	}
+
+	inline
+	size_t
+	GetBytePos(
+		) const
+	{
+		return m_DataPos - m_Data;
+	}
+
+	inline
+	size_t
+	GetBitPos(
+		) const
+	{
+		return m_BitPos;
+	}
+
+	bool
+	GetFieldBits(
+		__in size_t NumBits,
+		__out unsigned __int64 & FieldBits
+		)
+	{
+		if (NumBits > 64)
+			return false;
+
+		if (!m_DataPosRemaining)
+			return false;
+
+		size_t BitsThisByte  = ((m_DataPosRemaining > 1) ? 8 : m_HighestValidBitPos);
+		size_t BitsRemaining = BitsThisByte - ((m_BitPos == 8) ? 0 : m_BitPos);
+		size_t CurrOutBit    = 0;
+
+		if (NumBits > BitsRemaining)
+		{
+			size_t BitsExtra = NumBits - BitsRemaining;
+			size_t BytesRequired = 1 + (BitsExtra / 8) + ((BitsExtra % 8) ? 1 : 0);
+
+			if (m_DataPosRemaining < BytesRequired)
+				return false;
+
+			if ((m_DataPosRemaining == BytesRequired) &&
+			    ((BitsExtra % 8) > m_HighestValidBitPos))
+				return false;
+		}
+
+		FieldBits = 0;
+
+		while (CurrOutBit < NumBits)
+		{
+			if (m_BitPos == 8)
+				m_BitPos = 0;
+
+			switch (m_BitOrderMode)
+			{
+
+			case BufferParser::BitOrderLowToHigh:
+				FieldBits <<= 1;
+				FieldBits  |= static_cast< unsigned __int64 >( ((*m_DataPos >> (    m_BitPos)) & 1ull) );
+				break;
+
+			case BufferParser::BitOrderHighToLow:
+				FieldBits <<= 1;
+				FieldBits  |= static_cast< unsigned __int64 >( ((*m_DataPos >> (7 - m_BitPos)) & 1ull) );
+				break;
+
+			}
+
+			CurrOutBit += 1;
+			m_BitPos   += 1;
+
+			if (m_BitPos == 8)
+			{
+				m_DataPos          += 1;
+				m_DataPosRemaining -= 1;
+			}
+		}
+
+		return true;
+	}
+
+private:
+
+	const unsigned char        * m_Data;
+	const unsigned char        * m_DataPos;
+	size_t                       m_DataPosRemaining;
+	size_t                       m_BitPos;
+	size_t                       m_HighestValidBitPos;
+	BufferParser::BitOrderMode   m_BitOrderMode;
+
+};
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test data is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFF;
+}
+
+void
+FillBuffer(
+	__out std::vector< unsigned char > & Buffer,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine fills a buffer with pseudo-random bytes.
+
+Arguments:
+
+	Buffer - Supplies the buffer to fill.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < Buffer.size( ); i += 1)
+		Buffer[ i ] = (unsigned char) NextRandom( Seed );
+}
+
+const char *
+GetBitOrderName(
+	__in BufferParser::BitOrderMode BitOrder
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the display name of a bit order.
+
+Arguments:
+
+	BitOrder - Supplies the bit order.
+
+Return Value:
+
+	The display name of the bit order.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	return (BitOrder == BufferParser::BitOrderLowToHigh)
+		? "low-to-high"
+		: "high-to-low";
+}
+
+bool
+CheckRead(
+	__inout BufferParser & Parser,
+	__inout ReferenceBitReader & Reference,
+	__in size_t NumBits
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a field with both the parser and the reference
+	reader, and compares the outcome, the value read and the resulting
+	position.
+
+Arguments:
+
+	Parser - Supplies the parser under test.
+
+	Reference - Supplies the reference reader, positioned as per Parser.
+
+	NumBits - Supplies the width of the field to read.
+
+Return Value:
+
+	The routine returns true if both readers agree, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned __int64 ParserBits;
+	unsigned __int64 ReferenceBits;
+	bool             ParserStatus;
+	bool             ReferenceStatus;
+
+	ParserBits      = 0;
+	ReferenceBits   = 0;
+	ParserStatus    = Parser.GetFieldBits( NumBits, ParserBits );
+	ReferenceStatus = Reference.GetFieldBits( NumBits, ReferenceBits );
+
+	if (ParserStatus != ReferenceStatus)
+		return false;
+
+	if (!ParserStatus)
+		return true;
+
+	return (ParserBits == ReferenceBits)                       &&
+	       (Parser.GetBytePos( ) == Reference.GetBytePos( ))   &&
+	       (Parser.GetBitPos( ) == Reference.GetBitPos( ));
+}
+
+bool
+CheckEquivalence(
+	)
+/*++
+
+Routine Description:
+
+	This routine checks that BufferParser::GetFieldBits returns the same
+	results, and leaves the parser at the same position, as the original bit
+	at a time implementation.
+
+	For each bit order, each highest valid bit position of the last byte,
+	each starting byte position, each starting bit offset and each field
+	width, a parser is positioned with SkipData and a leading read of the bit
+	offset, and then reads the field followed by a short trailing field.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns true if every read matched, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const BufferParser::BitOrderMode BitOrders[ ] =
+	{
+		BufferParser::BitOrderLowToHigh,
+		BufferParser::BitOrderHighToLow
+	};
+
+	std::vector< unsigned char > Buffer( CHECK_BUFFER_SIZE );
+	unsigned long                Seed;
+	unsigned long                Checks;
+	unsigned long                Mismatches;
+
+	Seed       = 1;
+	Checks     = 0;
+	Mismatches = 0;
+
+	for (size_t b = 0; b < CHECK_BUFFER_COUNT; b += 1)
+	{
+		FillBuffer( Buffer, Seed );
+
+		for (size_t o = 0; o < sizeof( BitOrders ) / sizeof( BitOrders[ 0 ] ); o += 1)
+		{
+			for (size_t HighestValid = 1; HighestValid <= 8; HighestValid += 1)
+			{
+				for (size_t StartByte = 0; StartByte < Buffer.size( ); StartByte += 1)
+				{
+					for (size_t BitOffset = 0; BitOffset < 8; BitOffset += 1)
+					{
+						for (size_t NumBits = 0; NumBits <= 64; NumBits += 1)
+						{
+							BufferParser       Parser( &Buffer[ 0 ], Buffer.size( ), BitOrders[ o ] );
+							ReferenceBitReader Reference( &Buffer[ 0 ], Buffer.size( ), BitOrders[ o ] );
+
+							Parser.SetHighestValidBitPos( HighestValid );
+							Reference.SetHighestValidBitPos( HighestValid );
+
+							Parser.SkipData( StartByte );
+							Reference.SkipData( StartByte );
+
+							Checks += 1;
+
+							if ((!CheckRead( Parser, Reference, BitOffset )) ||
+							    (!CheckRead( Parser, Reference, NumBits ))   ||
+							    (!CheckRead( Parser, Reference, 3 )))
+							{
+								if (Mismatches < 16)
+								{
+									printf(
+										"MISMATCH: %s, highest valid bit %lu, byte %lu, bit offset %lu, %lu bits.\n",
+										GetBitOrderName( BitOrders[ o ] ),
+										(unsigned long) HighestValid,
+										(unsigned long) StartByte,
+										(unsigned long) BitOffset,
+										(unsigned long) NumBits);
+								}
+
+								Mismatches += 1;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	printf(
+		"Equivalence check: %lu cases, %lu mismatch(es).\n",
+		Checks,
+		Mismatches);
+
+	return (Mismatches == 0);
+}
+
+template< class Reader >
+double
+MeasureThroughput(
+	__in const std::vector< unsigned char > & Buffer,
+	__in BufferParser::BitOrderMode BitOrder,
+	__in size_t NumBits,
+	__inout unsigned __int64 & Checksum
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a buffer to its end in fields of a given width, and
+	returns the rate at which it was read.
+
+Arguments:
+
+	Buffer - Supplies the buffer to read.
+
+	BitOrder - Supplies the bit order to read the buffer in.
+
+	NumBits - Supplies the width of each field.
+
+	Checksum - Supplies a checksum that the fields read are folded into, so
+	           that the reads cannot be optimized away.
+
+Return Value:
+
+	The routine returns the read rate, in megabytes per second.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Reader           Parser( &Buffer[ 0 ], Buffer.size( ), BitOrder );
+	unsigned __int64 Bits;
+	LARGE_INTEGER    Frequency;
+	LARGE_INTEGER    Start;
+	LARGE_INTEGER    End;
+	double           Seconds;
+
+	QueryPerformanceFrequency( &Frequency );
+	QueryPerformanceCounter( &Start );
+
+	while (Parser.GetFieldBits( NumBits, Bits ))
+		Checksum += Bits;
+
+	QueryPerformanceCounter( &End );
+
+	Seconds = (double) (End.QuadPart - Start.QuadPart) / (double) Frequency.QuadPart;
+
+	if (Seconds <= 0.0)
+		return 0.0;
+
+	return ((double) Buffer.size( ) / (1024.0 * 1024.0)) / Seconds;
+}
+
+void
+RunBenchmark(
+	__in size_t SizeMB
+	)
+/*++
+
+Routine Description:
+
+	This routine measures the throughput of BufferParser::GetFieldBits and of
+	the original bit at a time implementation, for both bit orders and a
+	range of field widths.
+
+Arguments:
+
+	SizeMB - Supplies the size of the buffer to read, in megabytes.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const BufferParser::BitOrderMode BitOrders[ ] =
+	{
+		BufferParser::BitOrderLowToHigh,
+		BufferParser::BitOrderHighToLow
+	};
+
+	std::vector< unsigned char > Buffer( SizeMB * 1024 * 1024 );
+	unsigned long                Seed;
+	unsigned __int64             Checksum;
+
+	Seed     = 1;
+	Checksum = 0;
+
+	FillBuffer( Buffer, Seed );
+
+	printf(
+		"Throughput over a %lu MB buffer (MB/s, bit at a time -> BufferParser):\n",
+		(unsigned long) SizeMB);
+
+	for (size_t o = 0; o < sizeof( BitOrders ) / sizeof( BitOrders[ 0 ] ); o += 1)
+	{
+		for (size_t w = 0; w < sizeof( BenchmarkWidths ) / sizeof( BenchmarkWidths[ 0 ] ); w += 1)
+		{
+			double ReferenceRate;
+			double ParserRate;
+
+			ReferenceRate = MeasureThroughput< ReferenceBitReader >(
+				Buffer,
+				BitOrders[ o ],
+				BenchmarkWidths[ w ],
+				Checksum);
+			ParserRate    = MeasureThroughput< BufferParser >(
+				Buffer,
+				BitOrders[ o ],
+				BenchmarkWidths[ w ],
+				Checksum);
+
+			printf(
+				"  %s  w=%-2lu  %8.1f -> %8.1f  (%.2fx)\n",
+				GetBitOrderName( BitOrders[ o ] ),
+				(unsigned long) BenchmarkWidths[ w ],
+				ReferenceRate,
+				ParserRate,
+				(ReferenceRate > 0.0) ? ParserRate / ReferenceRate : 0.0);
+		}
+	}
+
+	printf( "(checksum %I64x)\n", Checksum );
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"BufferParserTest\n"
+		"\n"
+		"This program checks that BufferParser bit field reads match the original\n"
+		"bit at a time implementation for both bit orders and all bit offsets and\n"
+		"field widths, and optionally measures the throughput of both.\n"
+		"\n"
+		"Usage: BufferParserTest [-bench] [-size <benchmark buffer MB>]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the BufferParser test program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	bool   Benchmark;
+	size_t SizeMB;
+
+	Benchmark = false;
+	SizeMB    = 64;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if (!_stricmp( argv[ i ], "-bench" ))
+			Benchmark = true;
+		else if ((!_stricmp( argv[ i ], "-size" )) && (i + 1 < argc))
+			SizeMB = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	if (SizeMB == 0)
+	{
+		printf( "\nThe benchmark buffer size must be at least 1 MB.\n" );
+		return -1;
+	}
+
+	if (!CheckEquivalence( ))
+		return 1;
+
+	if (Benchmark)
+	{
+		try
+		{
+			RunBenchmark( SizeMB );
+		}
+		catch (std::exception &e)
+		{
+			printf( "ERROR: Exception '%s'.\n", e.what( ) );
+			return -1;
+		}
+	}
+
+	return 0;
+}
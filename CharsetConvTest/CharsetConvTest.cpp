@@ -0,0 +1,1175 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	CharsetConvTest.cpp
+
+Abstract:
+
+	This module houses a program that checks the single pass code page
+	transcoders (swutil::CodepageToUTF8 and swutil::UTF8ToCodepage), and the
+	UTF8Encode and UTF8Decode routines built on them, against the original
+	two pass conversion through UTF-16 with MultiByteToWideChar and
+	WideCharToMultiByte.
+
+	Both directions are checked for Windows-1252 and Windows-1250 with
+	pseudo-random input, including the bytes that each code page leaves
+	undefined, malformed and truncated UTF-8, overlong forms, encoded
+	surrogates, characters outside the BMP and characters with no mapping in
+	the code page.  Outputs are compared byte for byte.  Whenever the single
+	pass transcoder declines an input, the fallback taken by UTF8Decode must
+	still produce the original result.
+
+--*/
+
+#include "Precomp.h"
+
+//
+// Define the code pages that have a single pass transcoder.  CP_ACP is
+// checked as well (it is direct only if the ANSI code page is one of these),
+// as is a code page that always takes the fallback path.
+//
+
+const UINT DirectCodepages[ ] = { 1252, 1250 };
+const UINT FallbackCodepage   = 437;
+
+//
+// Define the kinds of generated input.
+//
+
+typedef enum _INPUT_KIND
+{
+	InputAsciiText,
+	InputCodepageText,
+	InputRandomBytes,
+	InputRandomCharacters,
+	InputMalformed,
+
+	LastInputKind
+} INPUT_KIND, * PINPUT_KIND;
+
+//
+// Define fixed UTF-8 inputs at the edges of the decoder's checks.
+//
+
+const char * EdgeCaseInputs[ ] =
+{
+	"\xC0\x80",             // Overlong NUL.
+	"\xC1\xBF",             // Overlong two byte form.
+	"\xE0\x80\x80",         // Overlong three byte form.
+	"\xE0\x9F\xBF",         // Largest overlong three byte form.
+	"\xE0\xA0\x80",         // U+0800, smallest three byte form.
+	"\xED\x9F\xBF",         // U+D7FF, below the surrogates.
+	"\xED\xA0\x80",         // Encoded high surrogate.
+	"\xED\xBF\xBF",         // Encoded low surrogate.
+	"\xEE\x80\x80",         // U+E000, above the surrogates.
+	"\xEF\xBB\xBF",         // Byte order mark.
+	"\xEF\xBF\xBD",         // Replacement character.
+	"\xEF\xBF\xBF",         // U+FFFF.
+	"\xF0\x9F\x98\x80",     // Outside the BMP.
+	"\xF4\x8F\xBF\xBF",     // U+10FFFF.
+	"\xF4\x90\x80\x80",     // Above U+10FFFF.
+	"\xF8\x88\x80\x80\x80", // Five byte form.
+	"\xC2",                 // Truncated two byte form.
+	"\xE2\x82",             // Truncated three byte form.
+	"\xC2\x41",             // Bad continuation byte.
+	"\xE2\x41\xAC",         // Bad continuation byte.
+	"\x80",                 // Stray continuation byte.
+	"\xFE",                 // Invalid lead byte.
+	"\xFF",                 // Invalid lead byte.
+	"\xC2\x80",             // U+0080, unmapped in both code pages.
+	"\xC2\x81",             // U+0081, an undefined byte in both code pages.
+	"\xC2\x8D",             // U+008D, an undefined byte in 1252.
+	"\xC2\x9F",             // U+009F, unmapped in both code pages.
+	"\xC2\xA0",             // No-break space.
+	"\xE2\x82\xAC",         // Euro sign.
+	"\xC5\x82",             // Latin small letter l with stroke (1250 only).
+	"\xCB\x9C",             // Small tilde (1252 only).
+	"\xE2\x84\xA2",         // Trade mark sign.
+	"abc\xE2\x82\xAC" "def" // Euro sign between ASCII runs.
+};
+
+//
+// Define the statistics kept for one code page and direction.
+//
+
+typedef struct _CHECK_STATS
+{
+	unsigned long Cases;
+	unsigned long Declines;
+	unsigned long Mismatches;
+} CHECK_STATS, * PCHECK_STATS;
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test data is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value, in the range 0 to
+	0xFFFFFF.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+bool
+ReferenceEncode(
+	__in const std::string & Text,
+	__out std::string & Result,
+	__in UINT Codepage
+	)
+/*++
+
+Routine Description:
+
+	This routine converts 8-bit characters in a code page to UTF-8 as the
+	original UTF8Encode did: first to UTF-16 with MultiByteToWideChar, then
+	to UTF-8 with WideCharToMultiByte.
+
+Arguments:
+
+	Text - Supplies the 8-bit characters to convert.
+
+	Result - Receives the UTF-8 characters.
+
+	Codepage - Supplies the code page of Text.
+
+Return Value:
+
+	The routine returns true on success, else false.  As with the original
+	routine, conversion of an empty string fails.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	int InputChars   = static_cast< int >( Text.size( ) );
+	int UnicodeChars = MultiByteToWideChar(
+		Codepage,
+		0,
+		Text.data( ),
+		InputChars,
+		NULL,
+		0);
+
+	if (!UnicodeChars)
+		return false;
+
+	std::vector< wchar_t > UnicodeBuffer( UnicodeChars );
+
+	if (!MultiByteToWideChar(
+		Codepage,
+		0,
+		Text.data( ),
+		InputChars,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars))
+		return false;
+
+	int UTF8Chars = WideCharToMultiByte(
+		CP_UTF8,
+		0,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars,
+		NULL,
+		0,
+		NULL,
+		NULL);
+
+	if (!UTF8Chars)
+		return false;
+
+	std::vector< char > UTF8Buffer( UTF8Chars );
+
+	if (!WideCharToMultiByte(
+		CP_UTF8,
+		0,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars,
+		&UTF8Buffer[ 0 ],
+		UTF8Chars,
+		NULL,
+		NULL))
+		return false;
+
+	Result.assign( &UTF8Buffer[ 0 ], UTF8Chars );
+
+	return true;
+}
+
+bool
+ReferenceDecode(
+	__in const std::string & UTF8,
+	__out std::string & Result,
+	__in UINT Codepage
+	)
+/*++
+
+Routine Description:
+
+	This routine converts UTF-8 characters to 8-bit characters in a code
+	page as the original UTF8Decode and UnicodeToAnsi pair did: first to
+	UTF-16 with MultiByteToWideChar, then to the code page with
+	WideCharToMultiByte, using the system's default substitution rules.
+
+Arguments:
+
+	UTF8 - Supplies the UTF-8 characters to convert.
+
+	Result - Receives the 8-bit characters.
+
+	Codepage - Supplies the code page to convert to.
+
+Return Value:
+
+	The routine returns true on success, else false.  As with the original
+	routines, conversion of an empty string fails.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	int InputBytes   = static_cast< int >( UTF8.size( ) );
+	int UnicodeChars = MultiByteToWideChar(
+		CP_UTF8,
+		0,
+		UTF8.data( ),
+		InputBytes,
+		NULL,
+		0);
+
+	if (!UnicodeChars)
+		return false;
+
+	std::vector< wchar_t > UnicodeBuffer( UnicodeChars );
+
+	if (!MultiByteToWideChar(
+		CP_UTF8,
+		0,
+		UTF8.data( ),
+		InputBytes,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars))
+		return false;
+
+	int AnsiChars = WideCharToMultiByte(
+		Codepage,
+		0,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars,
+		NULL,
+		0,
+		NULL,
+		NULL);
+
+	if (!AnsiChars)
+		return false;
+
+	std::vector< char > AnsiBuffer( AnsiChars );
+
+	if (!WideCharToMultiByte(
+		Codepage,
+		0,
+		&UnicodeBuffer[ 0 ],
+		UnicodeChars,
+		&AnsiBuffer[ 0 ],
+		AnsiChars,
+		NULL,
+		NULL))
+		return false;
+
+	Result.assign( &AnsiBuffer[ 0 ], AnsiChars );
+
+	return true;
+}
+
+void
+AppendUTF8(
+	__inout std::string & Text,
+	__in unsigned long Character
+	)
+/*++
+
+Routine Description:
+
+	This routine appends the UTF-8 encoding of a Unicode character to a
+	string.  No check is made that the character is not a surrogate.
+
+Arguments:
+
+	Text - Supplies the string to append to.
+
+	Character - Supplies the character to encode, at most U+10FFFF.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Character < 0x80)
+	{
+		Text.push_back( (char) Character );
+	}
+	else if (Character < 0x800)
+	{
+		Text.push_back( (char) (0xC0 | (Character >> 6)) );
+		Text.push_back( (char) (0x80 | (Character & 0x3F)) );
+	}
+	else if (Character < 0x10000)
+	{
+		Text.push_back( (char) (0xE0 | (Character >> 12)) );
+		Text.push_back( (char) (0x80 | ((Character >> 6) & 0x3F)) );
+		Text.push_back( (char) (0x80 | (Character & 0x3F)) );
+	}
+	else
+	{
+		Text.push_back( (char) (0xF0 | (Character >> 18)) );
+		Text.push_back( (char) (0x80 | ((Character >> 12) & 0x3F)) );
+		Text.push_back( (char) (0x80 | ((Character >> 6) & 0x3F)) );
+		Text.push_back( (char) (0x80 | (Character & 0x3F)) );
+	}
+}
+
+size_t
+GenerateLength(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine picks the length of a generated input.  Most inputs are
+	short, but some are long enough to take the 16 and 8 byte ASCII run
+	copies several times over.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the length, from 1 to 299 bytes or characters.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((NextRandom( Seed ) % 8) == 0)
+		return 1 + (NextRandom( Seed ) % 299);
+
+	return 1 + (NextRandom( Seed ) % 40);
+}
+
+void
+GenerateCodepageInput(
+	__in INPUT_KIND Kind,
+	__out std::string & Text,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine generates 8-bit input for the code page to UTF-8
+	direction.
+
+Arguments:
+
+	Kind - Supplies the kind of input to generate.  InputAsciiText is
+	       mostly ASCII with occasional upper half bytes, InputCodepageText
+	       is mostly upper half bytes, and every other kind is uniformly
+	       random bytes.
+
+	Text - Receives the generated input.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	size_t Length = GenerateLength( Seed );
+
+	Text.clear( );
+
+	for (size_t i = 0; i < Length; i += 1)
+	{
+		unsigned long Byte = NextRandom( Seed ) & 0xFF;
+
+		switch (Kind)
+		{
+
+		case InputAsciiText:
+			if ((NextRandom( Seed ) % 16) != 0)
+				Byte &= 0x7F;
+			break;
+
+		case InputCodepageText:
+			if ((NextRandom( Seed ) % 4) != 0)
+				Byte |= 0x80;
+			break;
+
+		default:
+			break;
+
+		}
+
+		Text.push_back( (char) Byte );
+	}
+}
+
+unsigned long
+GenerateCharacter(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine picks a random Unicode scalar value, weighted so that each
+	UTF-8 sequence length, and the range used by the Latin code pages, is
+	well represented.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the character, which is never a surrogate.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Character;
+
+	switch (NextRandom( Seed ) % 6)
+	{
+
+	case 0:
+		return NextRandom( Seed ) % 0x80;
+
+	case 1:
+		return 0x80 + (NextRandom( Seed ) % 0x80);
+
+	case 2:
+		return 0x100 + (NextRandom( Seed ) % 0x700);
+
+	case 3:
+		//
+		// The general punctuation, currency and letterlike blocks hold most
+		// of the code page characters encoded with three bytes.
+		//
+
+		return 0x2000 + (NextRandom( Seed ) % 0x200);
+
+	case 4:
+		Character = 0x800 + (NextRandom( Seed ) % (0x10000 - 0x800));
+
+		if ((Character >= 0xD800) && (Character <= 0xDFFF))
+			Character -= 0x800;
+
+		return Character;
+
+	default:
+		return 0x10000 + (NextRandom( Seed ) % 0x100000);
+
+	}
+}
+
+void
+GenerateUTF8Input(
+	__in INPUT_KIND Kind,
+	__in UINT Codepage,
+	__out std::string & UTF8,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine generates UTF-8 input for the UTF-8 to code page
+	direction.
+
+Arguments:
+
+	Kind - Supplies the kind of input to generate.  InputAsciiText and
+	       InputCodepageText are converted from generated code page text by
+	       the reference routine, so every character has an exact mapping.
+	       InputRandomCharacters is well formed UTF-8 of random characters,
+	       InputRandomBytes is random bytes and InputMalformed is well formed
+	       UTF-8 with a single defect introduced.
+
+	Codepage - Supplies the code page that the input will be converted to.
+
+	UTF8 - Receives the generated input.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string Text;
+	size_t      Length;
+	size_t      Offset;
+
+	switch (Kind)
+	{
+
+	case InputAsciiText:
+	case InputCodepageText:
+		GenerateCodepageInput( Kind, Text, Seed );
+
+		if (!ReferenceEncode( Text, UTF8, Codepage ))
+			UTF8.clear( );
+		return;
+
+	case InputRandomBytes:
+		GenerateCodepageInput( Kind, UTF8, Seed );
+		return;
+
+	default:
+		break;
+
+	}
+
+	Length = GenerateLength( Seed );
+
+	UTF8.clear( );
+
+	for (size_t i = 0; i < Length; i += 1)
+		AppendUTF8( UTF8, GenerateCharacter( Seed ) );
+
+	if (Kind != InputMalformed)
+		return;
+
+	Offset = NextRandom( Seed ) % (UTF8.size( ) + 1);
+
+	switch (NextRandom( Seed ) % 5)
+	{
+
+	case 0:
+		//
+		// Truncate, usually in the middle of a sequence.
+		//
+
+		UTF8.resize( (Offset == 0) ? UTF8.size( ) - 1 : Offset );
+		break;
+
+	case 1:
+		//
+		// Overwrite a byte.
+		//
+
+		if (Offset == UTF8.size( ))
+			Offset -= 1;
+
+		UTF8[ Offset ] = (char) (NextRandom( Seed ) & 0xFF);
+		break;
+
+	case 2:
+		{
+			const unsigned char InvalidBytes[ ] =
+			{
+				0x80, 0xBF, 0xC0, 0xC1, 0xF5, 0xF8, 0xFC, 0xFE, 0xFF
+			};
+
+			UTF8.insert(
+				Offset,
+				1,
+				(char) InvalidBytes[ NextRandom( Seed ) % sizeof( InvalidBytes ) ]);
+		}
+		break;
+
+	case 3:
+		{
+			//
+			// Insert an overlong form of a character that has a shorter
+			// encoding.
+			//
+
+			unsigned long Character = NextRandom( Seed );
+			std::string   Overlong;
+
+			if (NextRandom( Seed ) & 1)
+			{
+				Character &= 0x7F;
+				Overlong.push_back( (char) (0xC0 | (Character >> 6)) );
+				Overlong.push_back( (char) (0x80 | (Character & 0x3F)) );
+			}
+			else
+			{
+				Character &= 0x7FF;
+				Overlong.push_back( (char) 0xE0 );
+				Overlong.push_back( (char) (0x80 | (Character >> 6)) );
+				Overlong.push_back( (char) (0x80 | (Character & 0x3F)) );
+			}
+
+			UTF8.insert( Offset, Overlong );
+		}
+		break;
+
+	default:
+		{
+			//
+			// Insert an encoded surrogate.
+			//
+
+			unsigned long Character = 0xD800 + (NextRandom( Seed ) % 0x800);
+			std::string   Surrogate;
+
+			Surrogate.push_back( (char) (0xE0 | (Character >> 12)) );
+			Surrogate.push_back( (char) (0x80 | ((Character >> 6) & 0x3F)) );
+			Surrogate.push_back( (char) (0x80 | (Character & 0x3F)) );
+
+			UTF8.insert( Offset, Surrogate );
+		}
+		break;
+
+	}
+}
+
+void
+PrintMismatch(
+	__in const char * Direction,
+	__in UINT Codepage,
+	__in const char * What,
+	__in const std::string & Input
+	)
+/*++
+
+Routine Description:
+
+	This routine prints a description of a failed check, including the
+	input in hexadecimal.
+
+Arguments:
+
+	Direction - Supplies the name of the conversion direction.
+
+	Codepage - Supplies the code page being checked.
+
+	What - Supplies the name of the failed check.
+
+	Input - Supplies the input that was converted.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"MISMATCH: %s, code page %u, %s, %lu byte input:",
+		Direction,
+		Codepage,
+		What,
+		(unsigned long) Input.size( ));
+
+	for (size_t i = 0; (i < Input.size( )) && (i < 32); i += 1)
+		printf( " %02X", (unsigned) (unsigned char) Input[ i ] );
+
+	printf( "%s\n", (Input.size( ) > 32) ? " ..." : "" );
+}
+
+void
+CheckEncode(
+	__in UINT Codepage,
+	__in const std::string & Text,
+	__in bool Direct,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine converts one input from a code page to UTF-8 with the
+	reference routine, with CodepageToUTF8, and with UTF8Encode both into a
+	separate string and in place, and compares the results.
+
+	CodepageToUTF8 is given an exactly sized copy of the input, rather than
+	the string's own (terminated) storage, so that a read past the end of
+	the input faults under the page heap.
+
+Arguments:
+
+	Codepage - Supplies the code page of Text.
+
+	Text - Supplies the input to convert.
+
+	Direct - Supplies true if the code page has a single pass transcoder,
+	         in which case CodepageToUTF8 must not decline.
+
+	Stats - Supplies the statistics to update.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string Expected;
+	std::string Actual;
+	bool        ExpectedStatus;
+	bool        ActualStatus;
+	bool        Matched;
+
+	Stats.Cases += 1;
+	Matched      = true;
+
+	ExpectedStatus = ReferenceEncode( Text, Expected, Codepage );
+
+	if (!Text.empty( ))
+	{
+		std::vector< char > Source( Text.begin( ), Text.end( ) );
+		std::vector< char > Buffer( Text.size( ) * 3 );
+		size_t              Length;
+
+		Length = swutil::CodepageToUTF8(
+			&Source[ 0 ],
+			Source.size( ),
+			&Buffer[ 0 ],
+			Codepage);
+
+		if (Length == (size_t) -1)
+		{
+			Stats.Declines += 1;
+
+			if (Direct)
+			{
+				if (Stats.Mismatches++ < 16)
+					PrintMismatch( "encode", Codepage, "unexpected decline", Text );
+
+				Matched = false;
+			}
+		}
+		else if ((!ExpectedStatus)                                      ||
+		         (Length != Expected.size( ))                           ||
+		         (memcmp( &Buffer[ 0 ], Expected.data( ), Length ) != 0))
+		{
+			if (Stats.Mismatches++ < 16)
+				PrintMismatch( "encode", Codepage, "CodepageToUTF8", Text );
+
+			Matched = false;
+		}
+	}
+
+	if (!Matched)
+		return;
+
+	ActualStatus = swutil::UTF8Encode( Text, Actual, Codepage );
+
+	if ((ActualStatus != ExpectedStatus) ||
+	    ((ExpectedStatus) && (Actual != Expected)))
+	{
+		if (Stats.Mismatches++ < 16)
+			PrintMismatch( "encode", Codepage, "UTF8Encode", Text );
+
+		return;
+	}
+
+	Actual       = Text;
+	ActualStatus = swutil::UTF8Encode( Actual, Actual, Codepage );
+
+	if ((ActualStatus != ExpectedStatus) ||
+	    ((ExpectedStatus) && (Actual != Expected)))
+	{
+		if (Stats.Mismatches++ < 16)
+			PrintMismatch( "encode", Codepage, "UTF8Encode in place", Text );
+	}
+}
+
+void
+CheckDecode(
+	__in UINT Codepage,
+	__in const std::string & UTF8,
+	__in bool MustMap,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine converts one input from UTF-8 to a code page with the
+	reference routine, with UTF8ToCodepage, and with UTF8Decode both into a
+	separate string and in place, and compares the results.
+
+	UTF8ToCodepage is given an exactly sized copy of the input, so that a
+	read past the end of a truncated sequence faults under the page heap.
+	It may decline an input, but any output that it does produce must match
+	the reference exactly.  UTF8Decode must match the
+	reference whether or not the single pass transcoder declined.
+
+Arguments:
+
+	Codepage - Supplies the code page to convert to.
+
+	UTF8 - Supplies the input to convert.
+
+	MustMap - Supplies true if every character of the input is known to
+	          have an exact mapping in a code page with a single pass
+	          transcoder, in which case UTF8ToCodepage must not decline.
+
+	Stats - Supplies the statistics to update.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string Expected;
+	std::string Actual;
+	bool        ExpectedStatus;
+	bool        ActualStatus;
+	bool        Matched;
+
+	Stats.Cases += 1;
+	Matched      = true;
+
+	ExpectedStatus = ReferenceDecode( UTF8, Expected, Codepage );
+
+	if (!UTF8.empty( ))
+	{
+		std::vector< char > Source( UTF8.begin( ), UTF8.end( ) );
+		std::vector< char > Buffer( UTF8.size( ) );
+		size_t              Length;
+
+		Length = swutil::UTF8ToCodepage(
+			&Source[ 0 ],
+			Source.size( ),
+			&Buffer[ 0 ],
+			Codepage);
+
+		if (Length == (size_t) -1)
+		{
+			Stats.Declines += 1;
+
+			if (MustMap)
+			{
+				if (Stats.Mismatches++ < 16)
+					PrintMismatch( "decode", Codepage, "unexpected decline", UTF8 );
+
+				Matched = false;
+			}
+		}
+		else if ((!ExpectedStatus)                                      ||
+		         (Length != Expected.size( ))                           ||
+		         (memcmp( &Buffer[ 0 ], Expected.data( ), Length ) != 0))
+		{
+			if (Stats.Mismatches++ < 16)
+				PrintMismatch( "decode", Codepage, "UTF8ToCodepage", UTF8 );
+
+			Matched = false;
+		}
+	}
+
+	if (!Matched)
+		return;
+
+	ActualStatus = swutil::UTF8Decode( UTF8, Actual, Codepage );
+
+	if ((ActualStatus != ExpectedStatus) ||
+	    ((ExpectedStatus) && (Actual != Expected)))
+	{
+		if (Stats.Mismatches++ < 16)
+			PrintMismatch( "decode", Codepage, "UTF8Decode", UTF8 );
+
+		return;
+	}
+
+	Actual       = UTF8;
+	ActualStatus = swutil::UTF8Decode( Actual, Actual, Codepage );
+
+	if ((ActualStatus != ExpectedStatus) ||
+	    ((ExpectedStatus) && (Actual != Expected)))
+	{
+		if (Stats.Mismatches++ < 16)
+			PrintMismatch( "decode", Codepage, "UTF8Decode in place", UTF8 );
+	}
+}
+
+bool
+CheckCodepage(
+	__in UINT Codepage,
+	__in bool Direct,
+	__in unsigned long Count,
+	__in unsigned long Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine checks both conversion directions for one code page, with
+	every single byte and every fixed edge case, then with Count generated
+	inputs of each kind.
+
+Arguments:
+
+	Codepage - Supplies the code page to check.
+
+	Direct - Supplies true if the code page has a single pass transcoder.
+
+	Count - Supplies the number of generated inputs of each kind.
+
+	Seed - Supplies the initial generator state.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	CHECK_STATS EncodeStats;
+	CHECK_STATS DecodeStats;
+	std::string Input;
+
+	ZeroMemory( &EncodeStats, sizeof( EncodeStats ) );
+	ZeroMemory( &DecodeStats, sizeof( DecodeStats ) );
+
+	//
+	// Every byte on its own, which covers the bytes that the code page
+	// leaves undefined, and every byte both as a code page character and
+	// (for bytes below 0x80 or in error) as UTF-8.
+	//
+
+	for (unsigned long Byte = 0; Byte < 256; Byte += 1)
+	{
+		Input.assign( 1, (char) Byte );
+
+		CheckEncode( Codepage, Input, Direct, EncodeStats );
+		CheckDecode( Codepage, Input, (Direct) && (Byte < 0x80), DecodeStats );
+
+		if (ReferenceEncode( Input, Input, Codepage ))
+			CheckDecode( Codepage, Input, Direct, DecodeStats );
+	}
+
+	//
+	// The empty string, which is never transcoded directly.
+	//
+
+	Input.clear( );
+
+	CheckEncode( Codepage, Input, false, EncodeStats );
+	CheckDecode( Codepage, Input, false, DecodeStats );
+
+	for (size_t i = 0; i < sizeof( EdgeCaseInputs ) / sizeof( EdgeCaseInputs[ 0 ] ); i += 1)
+	{
+		Input = EdgeCaseInputs[ i ];
+
+		CheckDecode( Codepage, Input, false, DecodeStats );
+	}
+
+	for (int Kind = 0; Kind < LastInputKind; Kind += 1)
+	{
+		for (unsigned long i = 0; i < Count; i += 1)
+		{
+			GenerateCodepageInput( (INPUT_KIND) Kind, Input, Seed );
+			CheckEncode( Codepage, Input, Direct, EncodeStats );
+
+			GenerateUTF8Input( (INPUT_KIND) Kind, Codepage, Input, Seed );
+			CheckDecode(
+				Codepage,
+				Input,
+				(Direct) && ((Kind == InputAsciiText) || (Kind == InputCodepageText)),
+				DecodeStats);
+		}
+	}
+
+	printf(
+		"Code page %u (%s):\n"
+		"  encode: %lu cases, %lu declined, %lu mismatch(es).\n"
+		"  decode: %lu cases, %lu declined, %lu mismatch(es).\n",
+		Codepage,
+		(Direct) ? "direct" : "fallback",
+		EncodeStats.Cases,
+		EncodeStats.Declines,
+		EncodeStats.Mismatches,
+		DecodeStats.Cases,
+		DecodeStats.Declines,
+		DecodeStats.Mismatches);
+
+	return (EncodeStats.Mismatches == 0) && (DecodeStats.Mismatches == 0);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"CharsetConvTest\n"
+		"\n"
+		"This program checks that the single pass code page <-> UTF-8 transcoders,\n"
+		"and UTF8Encode and UTF8Decode, match the original two pass conversion\n"
+		"through UTF-16 for Windows-1252 and Windows-1250.\n"
+		"\n"
+		"Usage: CharsetConvTest [-count <inputs per kind>] [-seed <seed>]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the character set conversion
+	test program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Count;
+	unsigned long Seed;
+	UINT          Acp;
+	bool          AcpDirect;
+	bool          Passed;
+
+	Count = 20000;
+	Seed  = 1;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-count" )) && (i + 1 < argc))
+			Count = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-seed" )) && (i + 1 < argc))
+			Seed = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	try
+	{
+		Passed    = true;
+		Acp       = GetACP( );
+		AcpDirect = false;
+
+		for (size_t i = 0; i < sizeof( DirectCodepages ) / sizeof( DirectCodepages[ 0 ] ); i += 1)
+		{
+			if (!CheckCodepage( DirectCodepages[ i ], true, Count, Seed ))
+				Passed = false;
+
+			if (DirectCodepages[ i ] == Acp)
+				AcpDirect = true;
+		}
+
+		printf( "CP_ACP is code page %u.\n", Acp );
+
+		if (!CheckCodepage( CP_ACP, AcpDirect, Count, Seed ))
+			Passed = false;
+
+		if (!CheckCodepage( FallbackCodepage, false, Count / 10, Seed ))
+			Passed = false;
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	return Passed ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    Precomp.h
+
+Abstract:
+
+    This module acts as the precompiled header that pulls in all common system
+    and SkywingUtils definitions that are used by other modules.
+
+--*/
+
+#ifndef _PROGRAMS_CHARSETCONVTEST_PRECOMP_H
+#define _PROGRAMS_CHARSETCONVTEST_PRECOMP_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#define _CRT_SECURE_NO_DEPRECATE
+#define _CRT_SECURE_NO_DEPRECATE_GLOBALS
+#define _STRSAFE_NO_DEPRECATE
+
+#include <winsock2.h>
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <tchar.h>
+#include <strsafe.h>
+#include <limits.h>
+
+#include "../ProjectGlobal/ProjGlobalDefs.h"
+#include "../SkywingUtils/SkywingUtils.h"
+
+#endif
@@ -0,0 +1,1446 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	CheckAreaWalkmesh.cpp
+
+Abstract:
+
+	This module houses a program that checks the walkmesh connectivity of
+	every area of a module.
+
+	The walkable islands of each area's walkmesh are grouped into connected
+	components.  Doors, waypoints and the module start location are then
+	flagged if they are not on a walkable face, or if they lie in a component
+	that none of the area's entry points (the module start location and the
+	destinations of door and trigger transitions) can reach.  Transitions that
+	lead to a missing or non-walkable destination are flagged as well.
+
+	Areas are analyzed in parallel.  Transitions are resolved across areas
+	once every area has been analyzed.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	PrintfTextOut(
+		)
+	{
+		AllocConsole( );
+	}
+
+	inline
+	~PrintfTextOut(
+		)
+	{
+		FreeConsole( );
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine displays text to the log file and the debug console.
+
+		The console output may have color attributes supplied, as per the standard
+		SetConsoleTextAttribute API.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text as per the standard
+					 SetConsoleTextAttribute API (e.g. FOREGROUND_RED).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		HANDLE console = GetStdHandle( STD_OUTPUT_HANDLE );
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+		DWORD n = (DWORD)strlen(buf);
+		SetConsoleTextAttribute( console, Attributes );
+		WriteConsoleA(console, buf, n, &n, 0);
+	}
+
+};
+
+//
+// Define the resource types that are located for each area.  The .git holds
+// the placed objects of the area, and the .trx holds its walkmesh.
+//
+
+static const NWN::ResType AreaScanTypes[ ] =
+{
+	NWN::ResGIT,
+	NWN::ResTRX
+};
+
+//
+// Define the kinds of objects that are checked.
+//
+
+typedef enum _OBJECT_KIND
+{
+	ObjectDoor,
+	ObjectWaypoint,
+	ObjectTrigger,
+	ObjectStartLocation,
+
+	LastObjectKind
+} OBJECT_KIND, * POBJECT_KIND;
+
+static const char * ObjectKindNames[ LastObjectKind ] =
+{
+	"door",
+	"waypoint",
+	"trigger",
+	"start"
+};
+
+//
+// Define the object instance lists of an area's .git that are checked.
+// Triggers are only checked as the source of transitions, as their position
+// is not a location that a creature is placed at.
+//
+
+struct ObjectListSpec
+{
+	const char  * ListName;
+	OBJECT_KIND   Kind;
+};
+
+static const ObjectListSpec ObjectLists[ ] =
+{
+	{ "Door List",    ObjectDoor     },
+	{ "WaypointList", ObjectWaypoint },
+	{ "TriggerList",  ObjectTrigger  }
+};
+
+//
+// Define where on the walkmesh an object was found.
+//
+
+typedef enum _PLACEMENT
+{
+	PlacementNotChecked, // Position is not checked (triggers)
+	PlacementOffMesh,    // No walkmesh face under the position
+	PlacementNotWalkable,// Face under the position is not walkable
+	PlacementNoIsland,   // Walkable face that belongs to no island
+	PlacementWalkable,   // Walkable face on an island
+
+	LastPlacement
+} PLACEMENT, * PPLACEMENT;
+
+enum { NO_COMPONENT = 0xFFFFFFFF };
+enum { NO_ISLAND    = 0xFFFF };
+
+//
+// Define a placed object of an area.
+//
+
+struct AreaObject
+{
+	OBJECT_KIND                Kind;
+	std::string                Tag;
+	std::string                LinkedTo;
+	NWN::Vector3               Position;
+	PLACEMENT                  Placement;
+	unsigned short             Island;
+	ULONG                      Component;
+	std::vector< std::string > Problems;
+};
+
+typedef std::vector< AreaObject > AreaObjectVec;
+
+//
+// Define the result of analyzing one area.
+//
+
+struct AreaResult
+{
+	bool                  Analyzed;
+	ULONG                 Faces;
+	ULONG                 WalkableFaces;
+	ULONG                 Islands;
+	ULONG                 PathTableMismatches;
+	std::vector< ULONG >  ComponentFaces; // Walkable faces of each component
+	AreaObjectVec         Objects;
+	ULONG                 EntryPoints;
+	std::set< ULONG >     EntryComponents;
+};
+
+typedef std::vector< AreaResult > AreaResultVec;
+
+//
+// Define the module start location.
+//
+
+struct StartLocation
+{
+	size_t       AreaIndex; // Scan item index, or -1 if not a module area
+	NWN::Vector3 Position;
+};
+
+bool
+GetObjectPosition(
+	__in const GffFileReader::GffStruct & Struct,
+	__out NWN::Vector3 & Position
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the position of a placed object.  Doors and placeables
+	store their position in X, Y and Z, whereas other objects use XPosition,
+	YPosition and ZPosition.
+
+Arguments:
+
+	Struct - Supplies the instance structure of the object.
+
+	Position - Receives the position of the object.
+
+Return Value:
+
+	The routine returns true on success, else false if the object has no
+	position.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((Struct.GetFLOAT( "XPosition", Position.x )) &&
+	    (Struct.GetFLOAT( "YPosition", Position.y )) &&
+	    (Struct.GetFLOAT( "ZPosition", Position.z )))
+	{
+		return true;
+	}
+
+	if ((Struct.GetFLOAT( "X", Position.x )) &&
+	    (Struct.GetFLOAT( "Y", Position.y )) &&
+	    (Struct.GetFLOAT( "Z", Position.z )))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+std::string
+FormatObjectName(
+	__in const AreaObject & Object
+	)
+/*++
+
+Routine Description:
+
+	This routine forms the display name of a placed object, such as
+	"door 'dr_tavern' at (12.50, 40.00)".
+
+Arguments:
+
+	Object - Supplies the object to name.
+
+Return Value:
+
+	The routine returns the display name of the object.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	char Position[ 64 ];
+
+	StringCbPrintfA(
+		Position,
+		sizeof( Position ),
+		" at (%.2f, %.2f)",
+		Object.Position.x,
+		Object.Position.y);
+
+	if (Object.Kind == ObjectStartLocation)
+		return std::string( "module start location" ) + Position;
+
+	return std::string( ObjectKindNames[ Object.Kind ] ) + " '" + Object.Tag + "'" + Position;
+}
+
+//
+// Define the module scan visitor that analyzes the walkmesh of each area.
+//
+
+class WalkmeshVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	inline
+	WalkmeshVisitor(
+		__inout AreaResultVec & Results,
+		__in const StartLocation & Start
+		)
+	: m_Results( Results ),
+	  m_Start( Start )
+	{
+	}
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+private:
+
+	//
+	// Group the islands of a walkmesh into connected components.
+	//
+
+	static
+	void
+	ComputeComponents(
+		__in const AreaSurfaceMesh & Walkmesh,
+		__out std::vector< ULONG > & IslandComponent,
+		__inout AreaResult & Result
+		);
+
+	//
+	// Locate an object on the walkmesh.
+	//
+
+	static
+	void
+	PlaceObject(
+		__in const AreaSurfaceMesh & Walkmesh,
+		__in const std::vector< ULONG > & IslandComponent,
+		__inout AreaObject & Object
+		);
+
+	//
+	// Check that the island path table agrees with the components for the
+	// islands that objects were placed on.
+	//
+
+	static
+	ULONG
+	CheckPathTable(
+		__in const AreaSurfaceMesh & Walkmesh,
+		__in const std::vector< ULONG > & IslandComponent,
+		__in const AreaObjectVec & Objects
+		);
+
+	WalkmeshVisitor &
+	operator=(
+		__in const WalkmeshVisitor & other
+		);
+
+	AreaResultVec       & m_Results;
+	const StartLocation & m_Start;
+
+};
+
+void
+WalkmeshVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the doors, waypoints and triggers of an area, computes
+	the connected components of its walkmesh, and locates each object on the
+	walkmesh.  Entry points and reachability are resolved once every area has
+	been analyzed.
+
+	It is called on a module scan worker thread.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the area to analyze.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	AreaResult                     & Result = m_Results[ Context.GetItemIndex( ) ];
+	const GffFileReader::GffStruct * RootStruct;
+	std::vector< ULONG >             IslandComponent;
+
+	RootStruct = Context.GetGffReader( NWN::ResGIT )->GetRootStruct( );
+
+	//
+	// Collect the objects of the area.
+	//
+
+	for (size_t l = 0; l < RTL_NUMBER_OF( ObjectLists ); l += 1)
+	{
+		for (size_t i = 0; i <= ULONG_MAX; i += 1)
+		{
+			GffFileReader::GffStruct Instance;
+			AreaObject               Object;
+
+			if (!RootStruct->GetListElement( ObjectLists[ l ].ListName, i, Instance ))
+				break;
+
+			Object.Kind      = ObjectLists[ l ].Kind;
+			Object.Placement = PlacementNotChecked;
+			Object.Island    = NO_ISLAND;
+			Object.Component = NO_COMPONENT;
+
+			if (!GetObjectPosition( Instance, Object.Position ))
+			{
+				throw std::runtime_error(
+					std::string( "Failed to read position of " ) +
+					ObjectKindNames[ Object.Kind ] +
+					" instance.");
+			}
+
+			if (!Instance.GetCExoString( "Tag", Object.Tag ))
+				Object.Tag.clear( );
+
+			if (!Instance.GetCExoString( "LinkedTo", Object.LinkedTo ))
+				Object.LinkedTo.clear( );
+
+			Result.Objects.push_back( Object );
+		}
+	}
+
+	if (m_Start.AreaIndex == Context.GetItemIndex( ))
+	{
+		AreaObject Object;
+
+		Object.Kind      = ObjectStartLocation;
+		Object.Position  = m_Start.Position;
+		Object.Placement = PlacementNotChecked;
+		Object.Island    = NO_ISLAND;
+		Object.Component = NO_COMPONENT;
+
+		Result.Objects.push_back( Object );
+	}
+
+	//
+	// Load the walkmesh alone; the terrain and water meshes are not needed.
+	// A full load validates the walkmesh and its island tables.
+	//
+
+	if (Context.GetFileName( NWN::ResTRX ).empty( ))
+		throw std::runtime_error( "Area has no walkmesh (.trx)." );
+
+	const AreaSurfaceMesh & Walkmesh = Context.GetTrxReader( NWN::ResTRX, false, true )->GetSurfaceMesh( );
+
+	ComputeComponents( Walkmesh, IslandComponent, Result );
+
+	for (AreaObjectVec::iterator it = Result.Objects.begin( );
+	     it != Result.Objects.end( );
+	     ++it)
+	{
+		if (it->Kind == ObjectTrigger)
+			continue;
+
+		PlaceObject( Walkmesh, IslandComponent, *it );
+	}
+
+	Result.PathTableMismatches = CheckPathTable( Walkmesh, IslandComponent, Result.Objects );
+	Result.Analyzed            = true;
+}
+
+void
+WalkmeshVisitor::ComputeComponents(
+	__in const AreaSurfaceMesh & Walkmesh,
+	__out std::vector< ULONG > & IslandComponent,
+	__inout AreaResult & Result
+	)
+/*++
+
+Routine Description:
+
+	This routine groups the islands of a walkmesh into connected components,
+	using the island adjacency lists, and counts the walkable faces of each
+	component.
+
+Arguments:
+
+	Walkmesh - Supplies the walkmesh of the area.
+
+	IslandComponent - Receives the component of each island.  Components are
+	                  numbered in order of their first island.
+
+	Result - Supplies the area result, which receives the face, island and
+	         component counts.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	const AreaSurfaceMesh::IslandVec   & Islands = Walkmesh.GetIslands( );
+	const AreaSurfaceMesh::TriangleVec & Faces   = Walkmesh.GetTriangles( );
+	std::vector< ULONG >                 Parent;
+	ULONG                                Components;
+
+	//
+	// Join each island with its neighbors.
+	//
+
+	Parent.resize( Islands.size( ) );
+
+	for (ULONG i = 0; i < (ULONG) Islands.size( ); i += 1)
+		Parent[ i ] = i;
+
+	for (ULONG i = 0; i < (ULONG) Islands.size( ); i += 1)
+	{
+		const AreaSurfaceMesh::AdjacentVec & Adjacent = Islands[ i ].GetAdjacent( );
+
+		for (AreaSurfaceMesh::AdjacentVec::const_iterator it = Adjacent.begin( );
+		     it != Adjacent.end( );
+		     ++it)
+		{
+			ULONG Root1;
+			ULONG Root2;
+
+			if ((*it == NO_ISLAND) || (*it >= Islands.size( )))
+				continue;
+
+			for (Root1 = i; Parent[ Root1 ] != Root1; Root1 = Parent[ Root1 ])
+				Parent[ Root1 ] = Parent[ Parent[ Root1 ] ];
+
+			for (Root2 = *it; Parent[ Root2 ] != Root2; Root2 = Parent[ Root2 ])
+				Parent[ Root2 ] = Parent[ Parent[ Root2 ] ];
+
+			if (Root1 < Root2)
+				Parent[ Root2 ] = Root1;
+			else
+				Parent[ Root1 ] = Root2;
+		}
+	}
+
+	//
+	// Number the components.  Each root is the lowest island of its
+	// component, so it is numbered before any other island that it roots.
+	//
+
+	IslandComponent.resize( Islands.size( ) );
+
+	Components = 0;
+
+	for (ULONG i = 0; i < (ULONG) Islands.size( ); i += 1)
+	{
+		ULONG Root;
+
+		for (Root = i; Parent[ Root ] != Root; Root = Parent[ Root ])
+			;
+
+		if (Root == i)
+			IslandComponent[ i ] = Components++;
+		else
+			IslandComponent[ i ] = IslandComponent[ Root ];
+	}
+
+	//
+	// Count the walkable faces of each component.
+	//
+
+	Result.Faces         = (ULONG) Faces.size( );
+	Result.WalkableFaces = 0;
+	Result.Islands       = (ULONG) Islands.size( );
+
+	Result.ComponentFaces.clear( );
+	Result.ComponentFaces.resize( Components, 0 );
+
+	for (AreaSurfaceMesh::TriangleVec::const_iterator it = Faces.begin( );
+	     it != Faces.end( );
+	     ++it)
+	{
+		if (!(it->Flags & AreaSurfaceMesh::SurfaceMeshFace::WALKABLE))
+			continue;
+
+		Result.WalkableFaces += 1;
+
+		if (it->Island != NO_ISLAND)
+			Result.ComponentFaces[ IslandComponent[ it->Island ] ] += 1;
+	}
+}
+
+void
+WalkmeshVisitor::PlaceObject(
+	__in const AreaSurfaceMesh & Walkmesh,
+	__in const std::vector< ULONG > & IslandComponent,
+	__inout AreaObject & Object
+	)
+/*++
+
+Routine Description:
+
+	This routine locates the walkmesh face under an object, and records
+	whether the object stands on a walkable face (as per PositionWalkable),
+	and if so, the island and component of the face.
+
+Arguments:
+
+	Walkmesh - Supplies the walkmesh of the area.
+
+	IslandComponent - Supplies the component of each island.
+
+	Object - Supplies the object to place, which receives its placement.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	const AreaSurfaceMesh::SurfaceMeshFace * Face;
+	NWN::Vector2                             Position;
+
+	Position.x = Object.Position.x;
+	Position.y = Object.Position.y;
+
+	//
+	// Look up the face once rather than through PositionWalkable, as the
+	// island of the face is needed as well.
+	//
+
+	Face = Walkmesh.IsPointInTileSurfaceMeshGrid( Position ) ? Walkmesh.FindFace( Position ) : NULL;
+
+	if (Face == NULL)
+	{
+		Object.Placement = PlacementOffMesh;
+		return;
+	}
+
+	if (!(Face->Flags & AreaSurfaceMesh::SurfaceMeshFace::WALKABLE))
+	{
+		Object.Placement = PlacementNotWalkable;
+		return;
+	}
+
+	if ((Face->Island == NO_ISLAND) || (Face->Island >= IslandComponent.size( )))
+	{
+		Object.Placement = PlacementNoIsland;
+		return;
+	}
+
+	Object.Placement = PlacementWalkable;
+	Object.Island    = Face->Island;
+	Object.Component = IslandComponent[ Face->Island ];
+}
+
+ULONG
+WalkmeshVisitor::CheckPathTable(
+	__in const AreaSurfaceMesh & Walkmesh,
+	__in const std::vector< ULONG > & IslandComponent,
+	__in const AreaObjectVec & Objects
+	)
+/*++
+
+Routine Description:
+
+	This routine checks that the island path table, which the pathfinder
+	uses, agrees with the island adjacency lists about which of the islands
+	that objects stand on are connected.  A disagreement usually indicates a
+	walkmesh that was not fully rebaked.
+
+	Only the islands of placed objects are compared, rather than every pair
+	of islands, so that the check stays cheap on large areas.
+
+Arguments:
+
+	Walkmesh - Supplies the walkmesh of the area.
+
+	IslandComponent - Supplies the component of each island.
+
+	Objects - Supplies the placed objects of the area.
+
+Return Value:
+
+	The routine returns the count of island pairs on which the path table and
+	the adjacency lists disagree.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	std::vector< unsigned short > Islands;
+	ULONG                         Mismatches;
+
+	for (AreaObjectVec::const_iterator it = Objects.begin( );
+	     it != Objects.end( );
+	     ++it)
+	{
+		if (it->Placement == PlacementWalkable)
+			Islands.push_back( it->Island );
+	}
+
+	std::sort( Islands.begin( ), Islands.end( ) );
+	Islands.erase( std::unique( Islands.begin( ), Islands.end( ) ), Islands.end( ) );
+
+	Mismatches = 0;
+
+	for (size_t i = 0; i < Islands.size( ); i += 1)
+	{
+		for (size_t j = i + 1; j < Islands.size( ); j += 1)
+		{
+			bool PathExists;
+			bool Connected;
+
+			PathExists = (Walkmesh.GetNextIsland( Islands[ i ], Islands[ j ] ) != NO_ISLAND);
+			Connected  = (IslandComponent[ Islands[ i ] ] == IslandComponent[ Islands[ j ] ]);
+
+			if (PathExists != Connected)
+				Mismatches += 1;
+		}
+	}
+
+	return Mismatches;
+}
+
+void
+ResolveTransitions(
+	__in ResourceManager & ResMan,
+	__in const ModuleScan & Scan,
+	__inout AreaResultVec & Results
+	)
+/*++
+
+Routine Description:
+
+	This routine resolves the door and trigger transitions of every area to
+	their destination objects, and determines the entry points of each area.
+	The entry points of an area are the module start location (if it is in
+	the area), and every door or waypoint that a transition leads to.
+
+	Transitions whose destination does not exist, or is not on a walkable
+	face, are flagged on the transition.  Doors and waypoints that are not on
+	a walkable face, or are in a component that no entry point of their area
+	reaches, are flagged on the object.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan whose areas were analyzed.
+
+	Results - Supplies the results of each area.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::pair< size_t, size_t > ObjectRef;
+	typedef std::multimap< std::string, ObjectRef > TagMap;
+
+	TagMap Tags;
+
+	//
+	// Index the possible transition destinations by tag.
+	//
+
+	for (size_t a = 0; a < Results.size( ); a += 1)
+	{
+		for (size_t o = 0; o < Results[ a ].Objects.size( ); o += 1)
+		{
+			const AreaObject & Object = Results[ a ].Objects[ o ];
+
+			if ((Object.Kind != ObjectDoor) && (Object.Kind != ObjectWaypoint))
+				continue;
+
+			if (Object.Tag.empty( ))
+				continue;
+
+			Tags.insert( TagMap::value_type( Object.Tag, ObjectRef( a, o ) ) );
+		}
+	}
+
+	//
+	// Follow each transition to its destination, which becomes an entry point
+	// of the destination area.
+	//
+
+	for (size_t a = 0; a < Results.size( ); a += 1)
+	{
+		for (size_t o = 0; o < Results[ a ].Objects.size( ); o += 1)
+		{
+			AreaObject & Object = Results[ a ].Objects[ o ];
+
+			if (Object.Kind == ObjectStartLocation)
+			{
+				Results[ a ].EntryPoints += 1;
+
+				if (Object.Placement == PlacementWalkable)
+					Results[ a ].EntryComponents.insert( Object.Component );
+
+				continue;
+			}
+
+			if (Object.LinkedTo.empty( ))
+				continue;
+
+			std::pair< TagMap::const_iterator, TagMap::const_iterator > Range = Tags.equal_range( Object.LinkedTo );
+
+			if (Range.first == Range.second)
+			{
+				Object.Problems.push_back( "transition destination '" + Object.LinkedTo + "' does not exist" );
+				continue;
+			}
+
+			for (TagMap::const_iterator it = Range.first; it != Range.second; ++it)
+			{
+				AreaResult       & DestArea = Results[ it->second.first ];
+				const AreaObject & Dest     = DestArea.Objects[ it->second.second ];
+
+				DestArea.EntryPoints += 1;
+
+				if (Dest.Placement == PlacementWalkable)
+				{
+					DestArea.EntryComponents.insert( Dest.Component );
+					continue;
+				}
+
+				Object.Problems.push_back(
+					"transition leads to " +
+					FormatObjectName( Dest ) +
+					" in area " +
+					ResMan.StrFromResRef( Scan.GetItems( )[ it->second.first ].ResRef ) +
+					", which is not on a walkable face");
+			}
+		}
+	}
+
+	//
+	// Check the placement and reachability of each object.
+	//
+
+	for (size_t a = 0; a < Results.size( ); a += 1)
+	{
+		for (AreaObjectVec::iterator it = Results[ a ].Objects.begin( );
+		     it != Results[ a ].Objects.end( );
+		     ++it)
+		{
+			switch (it->Placement)
+			{
+
+			case PlacementNotChecked:
+				break;
+
+			case PlacementOffMesh:
+				it->Problems.push_back( "is outside the walkmesh" );
+				break;
+
+			case PlacementNotWalkable:
+				it->Problems.push_back( "is on a non-walkable face" );
+				break;
+
+			case PlacementNoIsland:
+				it->Problems.push_back( "is on a walkable face that belongs to no island" );
+				break;
+
+			case PlacementWalkable:
+				if ((Results[ a ].EntryPoints != 0) &&
+				    (Results[ a ].EntryComponents.find( it->Component ) == Results[ a ].EntryComponents.end( )))
+				{
+					char Problem[ 128 ];
+
+					StringCbPrintfA(
+						Problem,
+						sizeof( Problem ),
+						"is in walkable component %lu, which no entry point reaches",
+						it->Component);
+
+					it->Problems.push_back( Problem );
+				}
+				break;
+
+			}
+		}
+	}
+}
+
+ULONG
+PrintAreaReport(
+	__in IDebugTextOut * TextOut,
+	__in const std::string & AreaName,
+	__in const AreaResult & Result
+	)
+/*++
+
+Routine Description:
+
+	This routine prints the walkmesh summary and the problems of an area to
+	the console.
+
+Arguments:
+
+	TextOut - Supplies the text out interface.
+
+	AreaName - Supplies the resource name of the area.
+
+	Result - Supplies the result of the area.
+
+Return Value:
+
+	The routine returns the count of problems of the area.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG Largest;
+	ULONG Problems;
+
+	Largest = 0;
+
+	for (std::vector< ULONG >::const_iterator it = Result.ComponentFaces.begin( );
+	     it != Result.ComponentFaces.end( );
+	     ++it)
+	{
+		Largest = max( Largest, *it );
+	}
+
+	TextOut->WriteText(
+		"%s: %lu faces (%lu walkable), %lu islands in %lu components (largest %lu faces), %lu entry points.\n",
+		AreaName.c_str( ),
+		Result.Faces,
+		Result.WalkableFaces,
+		Result.Islands,
+		(ULONG) Result.ComponentFaces.size( ),
+		Largest,
+		Result.EntryPoints);
+
+	if (Result.EntryPoints == 0)
+		TextOut->WriteText( "   No entry points; reachability was not checked.\n" );
+
+	if (Result.PathTableMismatches != 0)
+	{
+		TextOut->WriteText(
+			FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+			"   WARNING: The island path table disagrees with island adjacency for %lu island pairs; the walkmesh may need to be rebaked.\n",
+			Result.PathTableMismatches);
+	}
+
+	Problems = 0;
+
+	for (AreaObjectVec::const_iterator it = Result.Objects.begin( );
+	     it != Result.Objects.end( );
+	     ++it)
+	{
+		for (std::vector< std::string >::const_iterator pit = it->Problems.begin( );
+		     pit != it->Problems.end( );
+		     ++pit)
+		{
+			TextOut->WriteText(
+				FOREGROUND_RED | FOREGROUND_INTENSITY,
+				"   %s %s.\n",
+				FormatObjectName( *it ).c_str( ),
+				pit->c_str( ));
+
+			Problems += 1;
+		}
+	}
+
+	return Problems;
+}
+
+bool
+WriteReport(
+	__in const char * ReportFile,
+	__in ResourceManager & ResMan,
+	__in const ModuleScan & Scan,
+	__in const AreaResultVec & Results
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the walkmesh report, a tab separated file with one
+	line for each checked object of each area, in module area order.
+
+Arguments:
+
+	ReportFile - Supplies the path to the report file to write.
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan whose areas were analyzed.
+
+	Results - Supplies the results of each area.
+
+Return Value:
+
+	The routine returns true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE * f;
+
+	f = fopen( ReportFile, "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Area\tKind\tTag\tX\tY\tZ\tComponent\tStatus\tDetail\n" );
+
+	for (size_t i = 0; i < Results.size( ); i += 1)
+	{
+		std::string AreaName = ResMan.StrFromResRef( Scan.GetItems( )[ i ].ResRef );
+
+		if (!Results[ i ].Analyzed)
+		{
+			fprintf( f, "%s\tarea\t\t\t\t\t\tFAILED\tArea could not be analyzed.\n", AreaName.c_str( ) );
+			continue;
+		}
+
+		for (AreaObjectVec::const_iterator it = Results[ i ].Objects.begin( );
+		     it != Results[ i ].Objects.end( );
+		     ++it)
+		{
+			std::string Detail;
+
+			if ((it->Placement == PlacementNotChecked) && (it->Problems.empty( )))
+				continue;
+
+			for (std::vector< std::string >::const_iterator pit = it->Problems.begin( );
+			     pit != it->Problems.end( );
+			     ++pit)
+			{
+				if (!Detail.empty( ))
+					Detail += "; ";
+
+				Detail += *pit;
+			}
+
+			fprintf(
+				f,
+				"%s\t%s\t%s\t%.2f\t%.2f\t%.2f\t",
+				AreaName.c_str( ),
+				ObjectKindNames[ it->Kind ],
+				it->Tag.c_str( ),
+				it->Position.x,
+				it->Position.y,
+				it->Position.z);
+
+			if (it->Component != NO_COMPONENT)
+				fprintf( f, "%lu", it->Component );
+
+			fprintf(
+				f,
+				"\t%s\t%s\n",
+				it->Problems.empty( ) ? "OK" : "PROBLEM",
+				Detail.c_str( ));
+		}
+	}
+
+	return (fclose( f ) == 0);
+}
+
+void
+GetStartLocation(
+	__in ResourceManager & ResMan,
+	__in const ModuleScan & Scan,
+	__out StartLocation & Start
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the module start location from module.ifo.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan, whose items are the module areas.
+
+	Start - Receives the start location.  The area index is set to -1 if the
+	        start location is not in a module area.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	DemandResourceStr                ModuleIfoFile( ResMan, "module", NWN::ResIFO );
+	GffFileReader                    ModuleIfo( ModuleIfoFile, ResMan );
+	const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
+	NWN::ResRef32                    EntryArea;
+	std::string                      AreaName;
+
+	Start.AreaIndex = (size_t) -1;
+
+	if ((!RootStruct->GetResRef( "Mod_Entry_Area", EntryArea )) ||
+	    (!RootStruct->GetFLOAT( "Mod_Entry_X", Start.Position.x )) ||
+	    (!RootStruct->GetFLOAT( "Mod_Entry_Y", Start.Position.y )) ||
+	    (!RootStruct->GetFLOAT( "Mod_Entry_Z", Start.Position.z )))
+	{
+		return;
+	}
+
+	AreaName = ResMan.StrFromResRef( EntryArea );
+
+	for (size_t i = 0; i < Scan.GetItems( ).size( ); i += 1)
+	{
+		if (ResMan.StrFromResRef( Scan.GetItems( )[ i ].ResRef ) == AreaName)
+		{
+			Start.AreaIndex = i;
+			break;
+		}
+	}
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"CheckAreaWalkmesh\n"
+		"\n"
+		"This program checks the walkmesh connectivity of every area of a module.\n"
+		"Doors, waypoints and the module start location are flagged if they are not\n"
+		"on a walkable face, or cannot be reached from any entry point of their\n"
+		"area.  Transitions that lead to a missing or non-walkable destination are\n"
+		"flagged as well.\n"
+		"\n"
+		"Usage: CheckAreaWalkmesh -home <homedir> -installdir <installdir>\n"
+		"                         -module <module resource name>\n"
+		"                         [-report <report file>]\n"
+		"                         [-threads <worker thread count>]\n"
+		"\n"
+		"The report is a tab separated file with one line for each door, waypoint\n"
+		"and transition.  The program exits with status 1 if any problem is found.\n"
+		"\n"
+		"Areas that are only entered through scripts have no entry points, and are\n"
+		"not checked for reachability.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the area walkmesh checker
+	program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char    * ModuleName;
+	const char    * NWN2Home;
+	const char    * InstallDir;
+	const char    * ReportFile;
+	unsigned long   MaxThreads;
+	int             ExitCode;
+
+	ModuleName = NULL;
+	NWN2Home   = NULL;
+	InstallDir = NULL;
+	ReportFile = NULL;
+	MaxThreads = 0;
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-module" )) && (i + 1 < argc))
+			ModuleName = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-home" )) && (i + 1 < argc))
+			NWN2Home = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-installdir" )) && (i + 1 < argc))
+			InstallDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-report" )) && (i + 1 < argc))
+			ReportFile = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	//
+	// First, check that we've got the necessary arguments.
+	//
+
+	if (ModuleName == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the module resource name of the module to load with -module <module resource name>.  The module resource name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (NWN2Home == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 home directory location with -home <homedir>.  The home directory is typically the path to your \"Documents\\Neverwinter Nights 2\" directory.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (InstallDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 game installation directory location with -installdir <installdir>.  The installation directory is typically the path to the Neverwinter Nights 2 directory under Program Files.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	//
+	// Now spin up a resource manager instance.
+	//
+
+	PrintfTextOut   TextOut;
+	ResourceManager ResMan( &TextOut );
+
+	ExitCode = 0;
+
+	try
+	{
+		AreaResultVec Results;
+		StartLocation Start;
+		ULONG         Problems;
+		ULONG         Failed;
+
+		TextOut.WriteText( "Loading module...\n" );
+		ModuleScan::LoadModule( ResMan, ModuleName, NWN2Home, InstallDir );
+
+		ModuleScan Scan( ResMan, &TextOut );
+
+		Scan.SetScanTypes( AreaScanTypes, RTL_NUMBER_OF( AreaScanTypes ) );
+		Scan.AddModuleAreas( );
+
+		GetStartLocation( ResMan, Scan, Start );
+
+		if (Start.AreaIndex == (size_t) -1)
+			TextOut.WriteText( "WARNING: The module start location is not in a module area.\n" );
+
+		//
+		// Analyze each area in parallel, then resolve the transitions between
+		// areas.
+		//
+
+		Results.resize( Scan.GetItems( ).size( ) );
+
+		for (AreaResultVec::iterator it = Results.begin( );
+		     it != Results.end( );
+		     ++it)
+		{
+			it->Analyzed            = false;
+			it->Faces               = 0;
+			it->WalkableFaces       = 0;
+			it->Islands             = 0;
+			it->PathTableMismatches = 0;
+			it->EntryPoints         = 0;
+		}
+
+		TextOut.WriteText( "Analyzing %lu areas...\n", (unsigned long) Results.size( ) );
+
+		WalkmeshVisitor Visitor( Results, Start );
+
+		Scan.Scan( &Visitor, MaxThreads );
+
+		ResolveTransitions( ResMan, Scan, Results );
+
+		//
+		// Print the report of each area in module order.
+		//
+
+		Problems = 0;
+		Failed   = 0;
+
+		for (size_t i = 0; i < Results.size( ); i += 1)
+		{
+			std::string AreaName = ResMan.StrFromResRef( Scan.GetItems( )[ i ].ResRef );
+
+			if (!Results[ i ].Analyzed)
+			{
+				Failed += 1;
+				continue;
+			}
+
+			Problems += PrintAreaReport( &TextOut, AreaName, Results[ i ] );
+		}
+
+		TextOut.WriteText(
+			"Checked %lu areas (%lu failed) in %lums (%lums locating resources) with %lu threads: %lu problems.\n",
+			(unsigned long) Results.size( ),
+			Failed,
+			Scan.GetStats( ).PrepareTime + Scan.GetStats( ).VisitTime,
+			Scan.GetStats( ).PrepareTime,
+			Scan.GetStats( ).Threads,
+			Problems);
+
+		if ((Problems != 0) || (Failed != 0))
+			ExitCode = 1;
+
+		if (ReportFile != NULL)
+		{
+			if (!WriteReport( ReportFile, ResMan, Scan, Results ))
+			{
+				TextOut.WriteText( "ERROR: Failed to write report file '%s'.\n", ReportFile );
+				ExitCode = -1;
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
+		ExitCode = -1;
+	}
+
+	return ExitCode;
+}
@@ -0,0 +1,596 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ErfDedupTest.cpp
+
+Abstract:
+
+	This module houses a program that checks that ERF files written with
+	resource deduplication read back correctly.
+
+	A set of resources with many byte-identical contents is written to an ERF
+	file, with and without deduplication and with one and several hashing
+	threads.  Each ERF is read back with ErfFileReader, and every resource is
+	compared byte for byte against the contents that were written.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ErfFileReader.h"
+#include "../NWN2DataLib/ErfFileWriter.h"
+
+//
+// Define the count of resources written to each ERF, and the count of
+// distinct payloads that most resources draw their contents from.
+//
+
+#define TEST_RESOURCE_COUNT 400
+#define TEST_PAYLOAD_COUNT  16
+
+typedef std::vector< unsigned char > ByteVec;
+
+//
+// Define a resource written to the test ERF.
+//
+
+struct TestResource
+{
+	NWN::ResRef32 ResRef;
+	NWN::ResType  ResType;
+	ByteVec       Contents;
+};
+
+typedef std::vector< TestResource > TestResourceVec;
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test data is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+void
+FillRandom(
+	__out ByteVec & Contents,
+	__in size_t Size,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine fills a buffer with pseudo-random bytes.
+
+Arguments:
+
+	Contents - Receives the buffer contents.
+
+	Size - Supplies the size of the buffer.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Contents.resize( Size );
+
+	for (size_t i = 0; i < Size; i += 1)
+		Contents[ i ] = (unsigned char) NextRandom( Seed );
+}
+
+void
+BuildTestResources(
+	__out TestResourceVec & Resources
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the resources written to the test ERFs.
+
+	Most resources take their contents from a small pool of payloads, so that
+	the ERF is dominated by duplicates.  The pool includes payloads that span
+	several 64KB compare chunks, and payloads of the same size that differ in
+	only their first or last byte, so that contents that match in size but
+	not in bytes are not shared.  Some resources have unique contents, and
+	some are empty.
+
+Arguments:
+
+	Resources - Receives the test resources.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	static const size_t PayloadSizes[ TEST_PAYLOAD_COUNT ] =
+	{
+		1, 7, 100, 100, 100, 4096, 4096, 65535,
+		65536, 65536, 65537, 131072, 131073, 200000, 200000, 12
+	};
+
+	std::vector< ByteVec > Payloads( TEST_PAYLOAD_COUNT );
+	unsigned long          Seed;
+
+	Seed = 1;
+
+	for (size_t i = 0; i < TEST_PAYLOAD_COUNT; i += 1)
+		FillRandom( Payloads[ i ], PayloadSizes[ i ], Seed );
+
+	//
+	// Make payloads of the same size that differ in only one byte.
+	//
+
+	Payloads[ 3 ] = Payloads[ 2 ];
+	Payloads[ 3 ][ 0 ] ^= 0x01;
+
+	Payloads[ 4 ] = Payloads[ 2 ];
+	Payloads[ 4 ][ 99 ] ^= 0x80;
+
+	Payloads[ 9 ] = Payloads[ 8 ];
+	Payloads[ 9 ][ 65535 ] ^= 0xFF;
+
+	Payloads[ 14 ] = Payloads[ 13 ];
+	Payloads[ 14 ][ 131072 ] ^= 0x10;
+
+	Resources.resize( TEST_RESOURCE_COUNT );
+
+	for (size_t i = 0; i < TEST_RESOURCE_COUNT; i += 1)
+	{
+		TestResource & Resource = Resources[ i ];
+
+		ZeroMemory( &Resource.ResRef, sizeof( Resource.ResRef ) );
+
+		StringCbPrintfA(
+			Resource.ResRef.RefStr,
+			sizeof( Resource.ResRef.RefStr ),
+			"dedup_%04lu",
+			(unsigned long) i);
+
+		Resource.ResType = (i & 1) ? NWN::ResUTC : NWN::ResTXT;
+
+		if ((i % 11) == 0)
+			Resource.Contents.clear( );
+		else if ((i % 7) == 0)
+			FillRandom( Resource.Contents, 1 + NextRandom( Seed ) % 70000, Seed );
+		else
+			Resource.Contents = Payloads[ NextRandom( Seed ) % TEST_PAYLOAD_COUNT ];
+	}
+}
+
+bool
+CheckErf(
+	__in const std::string & FileName,
+	__in const TestResourceVec & Resources
+	)
+/*++
+
+Routine Description:
+
+	This routine reads back an ERF with ErfFileReader, and compares every
+	resource in it byte for byte against the resources that were written.
+
+Arguments:
+
+	FileName - Supplies the name of the ERF file to check.
+
+	Resources - Supplies the resources that were written to the ERF.
+
+Return Value:
+
+	The routine returns true if the ERF holds exactly the resources that were
+	written, else false.  An std::exception may be raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< std::pair< std::string, NWN::ResType >, size_t > ResourceMap;
+
+	ErfFileReader32     Erf( FileName );
+	ResourceMap         Expected;
+	std::vector< bool > Seen( Resources.size( ), false );
+	ByteVec             Buffer;
+	bool                Matched;
+
+	for (size_t i = 0; i < Resources.size( ); i += 1)
+	{
+		Expected[ std::make_pair( std::string( Resources[ i ].ResRef.RefStr ), Resources[ i ].ResType ) ] = i;
+	}
+
+	Matched = true;
+
+	if (Erf.GetEncapsulatedFileCount( ) != Resources.size( ))
+	{
+		printf(
+			"MISMATCH: %s holds %lu resources, expected %lu.\n",
+			FileName.c_str( ),
+			(unsigned long) Erf.GetEncapsulatedFileCount( ),
+			(unsigned long) Resources.size( ));
+
+		Matched = false;
+	}
+
+	for (ErfFileReader32::FileId Id = 0; Id < Erf.GetEncapsulatedFileCount( ); Id += 1)
+	{
+		NWN::ResRef32               ResRef;
+		NWN::ResType                ResType;
+		ErfFileReader32::FileHandle Handle;
+		ResourceMap::const_iterator it;
+		size_t                      Read;
+		char                        Name[ sizeof( ResRef.RefStr ) + 1 ];
+
+		if (!Erf.GetEncapsulatedFileEntry( Id, ResRef, ResType ))
+		{
+			printf( "MISMATCH: Failed to read resource entry %lu.\n", (unsigned long) Id );
+			Matched = false;
+			continue;
+		}
+
+		ZeroMemory( Name, sizeof( Name ) );
+		memcpy( Name, ResRef.RefStr, sizeof( ResRef.RefStr ) );
+
+		it = Expected.find( std::make_pair( std::string( Name ), ResType ) );
+
+		if ((it == Expected.end( )) || (Seen[ it->second ]))
+		{
+			printf( "MISMATCH: Unexpected resource %s.%lu.\n", Name, (unsigned long) ResType );
+			Matched = false;
+			continue;
+		}
+
+		Seen[ it->second ] = true;
+
+		const ByteVec & Contents = Resources[ it->second ].Contents;
+
+		Handle = Erf.OpenFileByIndex( Id );
+
+		if (Handle == ErfFileReader32::INVALID_FILE)
+		{
+			printf( "MISMATCH: Failed to open resource %s.\n", Name );
+			Matched = false;
+			continue;
+		}
+
+		Buffer.resize( Contents.size( ) + 1 );
+		Read = 0;
+
+		if ((Erf.GetEncapsulatedFileSize( Handle ) != Contents.size( ))           ||
+		    ((!Contents.empty( ))                                                &&
+		     ((!Erf.ReadEncapsulatedFile( Handle, 0, Contents.size( ), &Read, &Buffer[ 0 ] )) ||
+		      (Read != Contents.size( ))                                         ||
+		      (memcmp( &Buffer[ 0 ], &Contents[ 0 ], Contents.size( ) )))))
+		{
+			printf(
+				"MISMATCH: Contents of resource %s (%lu bytes) differ.\n",
+				Name,
+				(unsigned long) Contents.size( ));
+
+			Matched = false;
+		}
+
+		Erf.CloseFile( Handle );
+	}
+
+	for (size_t i = 0; i < Seen.size( ); i += 1)
+	{
+		if (!Seen[ i ])
+		{
+			printf( "MISMATCH: Resource %s is missing.\n", Resources[ i ].ResRef.RefStr );
+			Matched = false;
+		}
+	}
+
+	return Matched;
+}
+
+bool
+RunTest(
+	__in const std::string & FileName,
+	__in const TestResourceVec & Resources,
+	__in bool Deduplicate,
+	__in size_t MaxThreads
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the test resources to an ERF file, checks the commit
+	statistics, and reads the ERF back to compare its contents.
+
+Arguments:
+
+	FileName - Supplies the name of the ERF file to write.
+
+	Resources - Supplies the resources to write.
+
+	Deduplicate - Supplies a Boolean value that indicates whether the ERF is
+	              written with deduplication.
+
+	MaxThreads - Supplies the maximum count of hashing threads, or zero for
+	             one thread per processor.
+
+Return Value:
+
+	The routine returns true if the test passed, else false.  An
+	std::exception may be raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ErfFileWriter32              Writer;
+	ErfFileWriter32::CommitStats Stats;
+	std::set< ByteVec >          Distinct;
+	ULONGLONG                    TotalBytes;
+	ULONGLONG                    DistinctBytes;
+	ULONG                        EmptyCount;
+	ULONG                        ExpectedStored;
+	ULONGLONG                    ExpectedStoredBytes;
+	bool                         Passed;
+
+	printf(
+		"Writing %s (%s, %lu thread(s))...\n",
+		FileName.c_str( ),
+		Deduplicate ? "deduplicated" : "not deduplicated",
+		(unsigned long) MaxThreads);
+
+	Writer.SetDefaultFileType( ErfFileWriter32::ERF_FILE_TYPE );
+	Writer.SetMaxThreads( MaxThreads );
+
+	TotalBytes    = 0;
+	DistinctBytes = 0;
+	EmptyCount    = 0;
+
+	//
+	// N.B.  An empty resource is still given a non-NULL contents pointer, as
+	//       a pending file with a NULL view is taken to be backed by a file
+	//       handle.
+	//
+
+	for (size_t i = 0; i < Resources.size( ); i += 1)
+	{
+		const TestResource & Resource = Resources[ i ];
+		static const unsigned char EmptyContents = 0;
+
+		Writer.AddFile(
+			Resource.ResRef,
+			Resource.ResType,
+			Resource.Contents.empty( ) ? &EmptyContents : &Resource.Contents[ 0 ],
+			Resource.Contents.size( ));
+
+		TotalBytes += Resource.Contents.size( );
+
+		if (Resource.Contents.empty( ))
+			EmptyCount += 1;
+		else if (Distinct.insert( Resource.Contents ).second)
+			DistinctBytes += Resource.Contents.size( );
+	}
+
+	if (!Writer.Commit(
+		FileName,
+		0,
+		Deduplicate ? ErfFileWriter32::ERF_COMMIT_FLAG_DEDUPLICATE : 0))
+	{
+		printf( "ERROR: Failed to write %s.\n", FileName.c_str( ) );
+		return false;
+	}
+
+	//
+	// Empty resources are never shared, so each counts as stored.
+	//
+
+	Stats  = Writer.GetCommitStats( );
+	Passed = true;
+
+	if (Deduplicate)
+	{
+		ExpectedStored      = (ULONG) Distinct.size( ) + EmptyCount;
+		ExpectedStoredBytes = DistinctBytes;
+	}
+	else
+	{
+		ExpectedStored      = (ULONG) Resources.size( );
+		ExpectedStoredBytes = TotalBytes;
+	}
+
+	if ((Stats.ResourceCount != Resources.size( )) ||
+	    (Stats.ResourceBytes != TotalBytes)         ||
+	    (Stats.StoredResourceCount != ExpectedStored) ||
+	    (Stats.StoredBytes != ExpectedStoredBytes))
+	{
+		printf(
+			"MISMATCH: Stored %lu resources (%I64u bytes), expected %lu (%I64u bytes).\n",
+			(unsigned long) Stats.StoredResourceCount,
+			Stats.StoredBytes,
+			(unsigned long) ExpectedStored,
+			ExpectedStoredBytes);
+
+		Passed = false;
+	}
+
+	if (!CheckErf( FileName, Resources ))
+		Passed = false;
+
+	printf(
+		"%s: %lu resources (%I64u bytes), %lu stored (%I64u bytes).\n",
+		Passed ? "PASSED" : "FAILED",
+		(unsigned long) Stats.ResourceCount,
+		Stats.ResourceBytes,
+		(unsigned long) Stats.StoredResourceCount,
+		Stats.StoredBytes);
+
+	return Passed;
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"ErfDedupTest\n"
+		"\n"
+		"This program writes an ERF file with many duplicate resources, with and\n"
+		"without deduplication, reads it back and compares every resource against\n"
+		"the contents that were written.\n"
+		"\n"
+		"Usage: ErfDedupTest [-keep] [-out <ERF file>]\n"
+		"\n"
+		"By default, a temporary file is used and deleted afterwards.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the ERF deduplication test
+	program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every test passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string     OutputFile;
+	bool            Keep;
+	bool            Passed;
+	TestResourceVec Resources;
+
+	Keep = false;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-out" )) && (i + 1 < argc))
+			OutputFile = argv[ ++i ];
+		else if (!_stricmp( argv[ i ], "-keep" ))
+			Keep = true;
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	if (OutputFile.empty( ))
+	{
+		char TempPath[ MAX_PATH + 1 ];
+		char TempFile[ MAX_PATH + 1 ];
+
+		if ((!GetTempPathA( sizeof( TempPath ), TempPath )) ||
+		    (!GetTempFileNameA( TempPath, "erf", 0, TempFile )))
+		{
+			printf( "ERROR: Failed to create a temporary file.\n" );
+			return -1;
+		}
+
+		OutputFile = TempFile;
+	}
+
+	try
+	{
+		BuildTestResources( Resources );
+
+		Passed = true;
+
+		if (!RunTest( OutputFile, Resources, false, 0 ))
+			Passed = false;
+
+		if (!RunTest( OutputFile, Resources, true, 1 ))
+			Passed = false;
+
+		if (!RunTest( OutputFile, Resources, true, 0 ))
+			Passed = false;
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		Passed = false;
+	}
+
+	if (!Keep)
+		DeleteFileA( OutputFile.c_str( ) );
+
+	return Passed ? 0 : 1;
+}
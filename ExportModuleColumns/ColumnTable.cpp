@@ -0,0 +1,903 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ColumnTable.cpp
+
+Abstract:
+
+	This module houses the column table object, which holds rows of typed
+	values in columnar form and reads and writes them as column files.
+
+--*/
+
+#include "Precomp.h"
+#include "ColumnTable.h"
+
+C_ASSERT( sizeof( ColumnTable::COLUMN_FILE_HEADER ) == 32 );
+C_ASSERT( sizeof( ColumnTable::STRING_DICT_HEADER ) == 32 );
+
+//
+// Define a file handle wrapper that closes the file when it goes out of
+// scope.
+//
+
+class ColumnFile
+{
+
+public:
+
+	inline
+	ColumnFile(
+		__in const std::string & FileName,
+		__in const char * Mode
+		)
+	: m_File( fopen( FileName.c_str( ), Mode ) )
+	{
+	}
+
+	inline
+	~ColumnFile(
+		)
+	{
+		if (m_File != NULL)
+			fclose( m_File );
+	}
+
+	inline
+	FILE *
+	Get(
+		) const
+	{
+		return m_File;
+	}
+
+	//
+	// Close the file, returning false if buffered data could not be written.
+	//
+
+	inline
+	bool
+	Close(
+		)
+	{
+		FILE * File = m_File;
+
+		m_File = NULL;
+
+		return (fclose( File ) == 0);
+	}
+
+private:
+
+	FILE * m_File;
+
+};
+
+ColumnTable::ColumnTable(
+	__in const ColumnDescVec & Schema
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new, empty column table.
+
+Arguments:
+
+	Schema - Supplies the columns of the table.
+
+Return Value:
+
+	The newly constructed object.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_Schema( Schema ),
+  m_RowCount( 0 )
+{
+	m_Columns.resize( Schema.size( ) );
+
+	for (size_t i = 0; i < Schema.size( ); i += 1)
+	{
+		m_Columns[ i ].Type        = Schema[ i ].Type;
+		m_Columns[ i ].ElementSize = GetElementSize( Schema[ i ].Type );
+	}
+}
+
+ColumnTable::~ColumnTable(
+	)
+/*++
+
+Routine Description:
+
+	This routine cleans up an already-existing column table.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+ULONGLONG
+ColumnTable::HashData(
+	__in_bcount( Length ) const void * Data,
+	__in size_t Length,
+	__in ULONGLONG Hash
+	)
+/*++
+
+Routine Description:
+
+	This routine folds a block of data into an FNV-1a hash.
+
+Arguments:
+
+	Data - Supplies the data to hash.
+
+	Length - Supplies the length, in bytes, of the data.
+
+	Hash - Supplies the hash of any preceding data, or INITIAL_HASH.
+
+Return Value:
+
+	The routine returns the updated hash.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const unsigned char * p = (const unsigned char *) Data;
+
+	for (size_t i = 0; i < Length; i += 1)
+	{
+		Hash ^= p[ i ];
+		Hash *= 0x100000001B3ULL;
+	}
+
+	return Hash;
+}
+
+ULONGLONG
+ColumnTable::GetSchemaHash(
+	) const
+/*++
+
+Routine Description:
+
+	This routine hashes the names and types of the columns of the table.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns the schema hash.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONGLONG Hash;
+
+	Hash = INITIAL_HASH;
+
+	for (ColumnDescVec::const_iterator it = m_Schema.begin( );
+	     it != m_Schema.end( );
+	     ++it)
+	{
+		ULONG Type = (ULONG) it->Type;
+
+		Hash = HashData( it->Name.c_str( ), it->Name.size( ) + 1, Hash );
+		Hash = HashData( &Type, sizeof( Type ), Hash );
+	}
+
+	return Hash;
+}
+
+size_t
+ColumnTable::AddRow(
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a row of default values to the table.  Numeric
+	columns are set to zero, and string columns are set to NULL_STRING.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns the index of the new row.  On failure, an
+	std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (ColumnVec::iterator it = m_Columns.begin( );
+	     it != m_Columns.end( );
+	     ++it)
+	{
+		//
+		// NULL_STRING has all bits set, so string columns can be filled with
+		// 0xFF bytes.
+		//
+
+		it->Data.resize(
+			it->Data.size( ) + it->ElementSize,
+			(it->Type == ColumnString) ? 0xFF : 0x00);
+	}
+
+	return m_RowCount++;
+}
+
+void
+ColumnTable::SetInteger(
+	__in size_t Row,
+	__in size_t Column,
+	__in LONGLONG Value
+	)
+/*++
+
+Routine Description:
+
+	This routine stores an integer value, converting it to the type of the
+	column.
+
+Arguments:
+
+	Row - Supplies the row index.
+
+	Column - Supplies the column index.
+
+	Value - Supplies the value to store.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned char * p = GetValue( Row, Column );
+
+	switch (m_Columns[ Column ].Type)
+	{
+
+	case ColumnInt32:
+		{
+			LONG v = (LONG) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnInt64:
+		memcpy( p, &Value, sizeof( Value ) );
+		break;
+
+	case ColumnFloat:
+		{
+			float v = (float) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnDouble:
+		{
+			double v = (double) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnString:
+		{
+			char Str[ 32 ];
+
+			StringCbPrintfA( Str, sizeof( Str ), "%I64d", Value );
+			SetString( Row, Column, Str );
+		}
+		break;
+
+	}
+}
+
+void
+ColumnTable::SetReal(
+	__in size_t Row,
+	__in size_t Column,
+	__in double Value
+	)
+/*++
+
+Routine Description:
+
+	This routine stores a floating point value, converting it to the type of
+	the column.
+
+Arguments:
+
+	Row - Supplies the row index.
+
+	Column - Supplies the column index.
+
+	Value - Supplies the value to store.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned char * p = GetValue( Row, Column );
+
+	switch (m_Columns[ Column ].Type)
+	{
+
+	case ColumnInt32:
+		{
+			LONG v = (LONG) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnInt64:
+		{
+			LONGLONG v = (LONGLONG) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnFloat:
+		{
+			float v = (float) Value;
+
+			memcpy( p, &v, sizeof( v ) );
+		}
+		break;
+
+	case ColumnDouble:
+		memcpy( p, &Value, sizeof( Value ) );
+		break;
+
+	case ColumnString:
+		{
+			char Str[ 64 ];
+
+			StringCbPrintfA( Str, sizeof( Str ), "%.9g", Value );
+			SetString( Row, Column, Str );
+		}
+		break;
+
+	}
+}
+
+void
+ColumnTable::SetString(
+	__in size_t Row,
+	__in size_t Column,
+	__in const std::string & Value
+	)
+/*++
+
+Routine Description:
+
+	This routine stores a string value, converting it to the type of the
+	column.  A string that does not parse as a number stores zero in a
+	numeric column.
+
+Arguments:
+
+	Row - Supplies the row index.
+
+	Column - Supplies the column index.
+
+	Value - Supplies the value to store.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned char * p = GetValue( Row, Column );
+
+	switch (m_Columns[ Column ].Type)
+	{
+
+	case ColumnInt32:
+	case ColumnInt64:
+		SetInteger( Row, Column, _strtoi64( Value.c_str( ), NULL, 0 ) );
+		break;
+
+	case ColumnFloat:
+	case ColumnDouble:
+		SetReal( Row, Column, strtod( Value.c_str( ), NULL ) );
+		break;
+
+	case ColumnString:
+		{
+			ULONG Index = InternString( Value );
+
+			memcpy( p, &Index, sizeof( Index ) );
+		}
+		break;
+
+	}
+}
+
+void
+ColumnTable::AppendRows(
+	__in const ColumnTable & Source,
+	__in size_t FirstRow,
+	__in size_t RowCount
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a range of rows from another table.  String values
+	are re-indexed against the string dictionary of this table.
+
+Arguments:
+
+	Source - Supplies the table to copy rows from.  Its columns must have the
+	         same types as the columns of this table.
+
+	FirstRow - Supplies the index of the first row to copy.
+
+	RowCount - Supplies the count of rows to copy.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Source.m_Columns.size( ) != m_Columns.size( ))
+		throw std::runtime_error( "Column table schemas do not match." );
+
+	if ((FirstRow > Source.m_RowCount) ||
+	    (RowCount > Source.m_RowCount - FirstRow))
+	{
+		throw std::runtime_error( "Column table row range out of bounds." );
+	}
+
+	if (RowCount == 0)
+		return;
+
+	for (size_t i = 0; i < m_Columns.size( ); i += 1)
+	{
+		ColumnData       & Dst = m_Columns[ i ];
+		const ColumnData & Src = Source.m_Columns[ i ];
+
+		if (Src.Type != Dst.Type)
+			throw std::runtime_error( "Column table schemas do not match." );
+
+		if (Dst.Type != ColumnString)
+		{
+			Dst.Data.insert(
+				Dst.Data.end( ),
+				Src.Data.begin( ) + FirstRow * Src.ElementSize,
+				Src.Data.begin( ) + (FirstRow + RowCount) * Src.ElementSize);
+
+			continue;
+		}
+
+		//
+		// String indicies are local to each table, so each value must be
+		// interned again.
+		//
+
+		for (size_t Row = FirstRow; Row < FirstRow + RowCount; Row += 1)
+		{
+			ULONG Index;
+
+			memcpy( &Index, Source.GetValue( Row, i ), sizeof( Index ) );
+
+			if (Index != NULL_STRING)
+				Index = InternString( Source.m_Strings[ Index ] );
+
+			Dst.Data.insert(
+				Dst.Data.end( ),
+				(const unsigned char *) &Index,
+				(const unsigned char *) (&Index + 1));
+		}
+	}
+
+	m_RowCount += RowCount;
+}
+
+void
+ColumnTable::Write(
+	__in const std::string & PathPrefix
+	) const
+/*++
+
+Routine Description:
+
+	This routine writes the table to one file per column, and a string
+	dictionary file.
+
+Arguments:
+
+	PathPrefix - Supplies the path and table name that the file names are
+	             formed from.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < m_Columns.size( ); i += 1)
+	{
+		const ColumnData   & C        = m_Columns[ i ];
+		std::string          FileName = PathPrefix + "." + m_Schema[ i ].Name + ".col";
+		ColumnFile           File( FileName, "wb" );
+		COLUMN_FILE_HEADER   Header;
+
+		if (File.Get( ) == NULL)
+			throw std::runtime_error( "Failed to create " + FileName );
+
+		ZeroMemory( &Header, sizeof( Header ) );
+
+		Header.Signature   = COLUMN_FILE_SIGNATURE;
+		Header.Version     = COLUMN_FILE_VERSION;
+		Header.Type        = (ULONG) C.Type;
+		Header.ElementSize = (ULONG) C.ElementSize;
+		Header.RowCount    = m_RowCount;
+
+		if ((fwrite( &Header, sizeof( Header ), 1, File.Get( ) ) != 1) ||
+		    ((!C.Data.empty( )) &&
+		     (fwrite( &C.Data[ 0 ], C.Data.size( ), 1, File.Get( ) ) != 1)) ||
+		    (!File.Close( )))
+		{
+			throw std::runtime_error( "Failed to write " + FileName );
+		}
+	}
+
+	//
+	// Now write the string dictionary.
+	//
+
+	std::string                FileName = PathPrefix + ".strings.dict";
+	ColumnFile                 File( FileName, "wb" );
+	STRING_DICT_HEADER         Header;
+	std::vector< ULONGLONG >   Offsets;
+
+	if (File.Get( ) == NULL)
+		throw std::runtime_error( "Failed to create " + FileName );
+
+	Offsets.reserve( m_Strings.size( ) + 1 );
+	Offsets.push_back( 0 );
+
+	for (StringVec::const_iterator it = m_Strings.begin( );
+	     it != m_Strings.end( );
+	     ++it)
+	{
+		Offsets.push_back( Offsets.back( ) + it->size( ) + 1 );
+	}
+
+	ZeroMemory( &Header, sizeof( Header ) );
+
+	Header.Signature   = STRING_DICT_SIGNATURE;
+	Header.Version     = COLUMN_FILE_VERSION;
+	Header.StringCount = (ULONG) m_Strings.size( );
+	Header.DataSize    = Offsets.back( );
+
+	if ((fwrite( &Header, sizeof( Header ), 1, File.Get( ) ) != 1) ||
+	    (fwrite( &Offsets[ 0 ], Offsets.size( ) * sizeof( ULONGLONG ), 1, File.Get( ) ) != 1))
+	{
+		throw std::runtime_error( "Failed to write " + FileName );
+	}
+
+	for (StringVec::const_iterator it = m_Strings.begin( );
+	     it != m_Strings.end( );
+	     ++it)
+	{
+		if (fwrite( it->c_str( ), it->size( ) + 1, 1, File.Get( ) ) != 1)
+			throw std::runtime_error( "Failed to write " + FileName );
+	}
+
+	if (!File.Close( ))
+		throw std::runtime_error( "Failed to write " + FileName );
+}
+
+bool
+ColumnTable::Read(
+	__in const std::string & PathPrefix
+	)
+/*++
+
+Routine Description:
+
+	This routine replaces the contents of the table with the contents of the
+	column files written by a previous call to Write.
+
+Arguments:
+
+	PathPrefix - Supplies the path and table name that the file names are
+	             formed from.
+
+Return Value:
+
+	The routine returns true if the table was read, else false if any file
+	was absent or did not match the schema of the table.  On failure, the
+	table is left empty.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ColumnVec      Columns( m_Columns );
+	StringVec      Strings;
+	StringIndexMap StringIndex;
+	ULONGLONG      RowCount;
+
+	RowCount = 0;
+
+	for (size_t i = 0; i < Columns.size( ); i += 1)
+	{
+		ColumnData         & C = Columns[ i ];
+		ColumnFile           File( PathPrefix + "." + m_Schema[ i ].Name + ".col", "rb" );
+		COLUMN_FILE_HEADER   Header;
+
+		if (File.Get( ) == NULL)
+			return false;
+
+		if (fread( &Header, sizeof( Header ), 1, File.Get( ) ) != 1)
+			return false;
+
+		if ((Header.Signature != COLUMN_FILE_SIGNATURE) ||
+		    (Header.Version != COLUMN_FILE_VERSION) ||
+		    (Header.Type != (ULONG) C.Type) ||
+		    (Header.ElementSize != C.ElementSize))
+		{
+			return false;
+		}
+
+		if (i == 0)
+			RowCount = Header.RowCount;
+		else if (Header.RowCount != RowCount)
+			return false;
+
+		if (RowCount > (ULONGLONG) (ULONG_MAX / C.ElementSize))
+			return false;
+
+		C.Data.resize( (size_t) RowCount * C.ElementSize );
+
+		if ((!C.Data.empty( )) &&
+		    (fread( &C.Data[ 0 ], C.Data.size( ), 1, File.Get( ) ) != 1))
+		{
+			return false;
+		}
+	}
+
+	//
+	// Now read the string dictionary back.
+	//
+
+	ColumnFile                 File( PathPrefix + ".strings.dict", "rb" );
+	STRING_DICT_HEADER         Header;
+	std::vector< ULONGLONG >   Offsets;
+	std::vector< char >        Data;
+
+	if (File.Get( ) == NULL)
+		return false;
+
+	if ((fread( &Header, sizeof( Header ), 1, File.Get( ) ) != 1) ||
+	    (Header.Signature != STRING_DICT_SIGNATURE) ||
+	    (Header.Version != COLUMN_FILE_VERSION) ||
+	    (Header.StringCount >= ULONG_MAX / sizeof( ULONGLONG )) ||
+	    (Header.DataSize > ULONG_MAX))
+	{
+		return false;
+	}
+
+	Offsets.resize( (size_t) Header.StringCount + 1 );
+	Data.resize( (size_t) Header.DataSize );
+
+	if (fread( &Offsets[ 0 ], Offsets.size( ) * sizeof( ULONGLONG ), 1, File.Get( ) ) != 1)
+		return false;
+
+	if ((!Data.empty( )) &&
+	    (fread( &Data[ 0 ], Data.size( ), 1, File.Get( ) ) != 1))
+	{
+		return false;
+	}
+
+	if ((Offsets[ 0 ] != 0) || (Offsets.back( ) != Header.DataSize))
+		return false;
+
+	Strings.reserve( Header.StringCount );
+
+	for (ULONG i = 0; i < Header.StringCount; i += 1)
+	{
+		if ((Offsets[ i + 1 ] <= Offsets[ i ]) ||
+		    (Data[ (size_t) Offsets[ i + 1 ] - 1 ] != '\0'))
+		{
+			return false;
+		}
+
+		Strings.push_back( std::string( &Data[ (size_t) Offsets[ i ] ] ) );
+		StringIndex[ Strings.back( ) ] = i;
+	}
+
+	//
+	// Every string index that is stored in a string column must refer to the
+	// dictionary.
+	//
+
+	for (ColumnVec::const_iterator it = Columns.begin( );
+	     it != Columns.end( );
+	     ++it)
+	{
+		if (it->Type != ColumnString)
+			continue;
+
+		for (size_t Row = 0; Row < (size_t) RowCount; Row += 1)
+		{
+			ULONG Index;
+
+			memcpy( &Index, &it->Data[ Row * sizeof( ULONG ) ], sizeof( Index ) );
+
+			if ((Index != NULL_STRING) && (Index >= Header.StringCount))
+				return false;
+		}
+	}
+
+	m_Columns.swap( Columns );
+	m_Strings.swap( Strings );
+	m_StringIndex.swap( StringIndex );
+	m_RowCount = (size_t) RowCount;
+
+	return true;
+}
+
+size_t
+ColumnTable::GetElementSize(
+	__in COLUMN_TYPE Type
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the size of an element of a column type.
+
+Arguments:
+
+	Type - Supplies the column type.
+
+Return Value:
+
+	The routine returns the size, in bytes, of an element.  On failure, an
+	std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Type)
+	{
+
+	case ColumnInt32:
+		return sizeof( LONG );
+
+	case ColumnInt64:
+		return sizeof( LONGLONG );
+
+	case ColumnFloat:
+		return sizeof( float );
+
+	case ColumnDouble:
+		return sizeof( double );
+
+	case ColumnString:
+		return sizeof( ULONG );
+
+	default:
+		throw std::runtime_error( "Invalid column type." );
+
+	}
+}
+
+ULONG
+ColumnTable::InternString(
+	__in const std::string & Value
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the dictionary index of a string, adding the string
+	to the dictionary if it is not already present.  Indicies are assigned in
+	order of first use, so that the dictionary is deterministic for a given
+	sequence of rows.
+
+Arguments:
+
+	Value - Supplies the string to look up.
+
+Return Value:
+
+	The routine returns the dictionary index of the string.  On failure, an
+	std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	StringIndexMap::const_iterator it;
+	ULONG                          Index;
+
+	it = m_StringIndex.find( Value );
+
+	if (it != m_StringIndex.end( ))
+		return it->second;
+
+	if (m_Strings.size( ) >= NULL_STRING)
+		throw std::runtime_error( "Too many strings in column table." );
+
+	Index = (ULONG) m_Strings.size( );
+
+	m_Strings.push_back( Value );
+	m_StringIndex.insert( StringIndexMap::value_type( Value, Index ) );
+
+	return Index;
+}
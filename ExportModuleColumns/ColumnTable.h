@@ -0,0 +1,315 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ColumnTable.h
+
+Abstract:
+
+	This module defines the column table object, which holds rows of typed
+	values in columnar form, and reads and writes them as a set of column
+	files that may be memory mapped and scanned directly by analysis tools.
+
+	A table named <prefix> is stored as one <prefix>.<column>.col file per
+	column, plus a <prefix>.strings.dict string dictionary that is shared by
+	all string columns of the table.  All values are little endian.
+
+	Each column file begins with a COLUMN_FILE_HEADER, which is followed by
+	RowCount packed elements of the column type.  String columns hold the
+	ULONG index of each value in the string dictionary, or NULL_STRING if the
+	value was absent.
+
+	The string dictionary begins with a STRING_DICT_HEADER, which is followed
+	by StringCount + 1 ULONGLONG offsets, and then DataSize bytes of string
+	data.  String i spans the data bytes [Offsets[i], Offsets[i + 1]), the
+	last of which is a null terminator.
+
+--*/
+
+#ifndef _PROGRAMS_EXPORTMODULECOLUMNS_COLUMNTABLE_H
+#define _PROGRAMS_EXPORTMODULECOLUMNS_COLUMNTABLE_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class ColumnTable
+{
+
+public:
+
+	typedef swutil::SharedPtr< ColumnTable > Ptr;
+
+	//
+	// Define the storage types of a column.
+	//
+
+	typedef enum _COLUMN_TYPE
+	{
+		ColumnInt32  = 0,
+		ColumnInt64  = 1,
+		ColumnFloat  = 2,
+		ColumnDouble = 3,
+		ColumnString = 4,
+
+		LastColumnType
+	} COLUMN_TYPE, * PCOLUMN_TYPE;
+
+	typedef const enum _COLUMN_TYPE * PCCOLUMN_TYPE;
+
+	enum
+	{
+		COLUMN_FILE_SIGNATURE = 'FCWN',
+		STRING_DICT_SIGNATURE = 'DSWN',
+		COLUMN_FILE_VERSION   = 1
+	};
+
+	//
+	// Define the string index that is stored for an absent string.
+	//
+
+	static const ULONG NULL_STRING = 0xFFFFFFFF;
+
+	//
+	// Define the on-disk headers.  Both are 32 bytes long so that the data
+	// that follows is aligned for vector loads in a mapped view.
+	//
+
+	typedef struct _COLUMN_FILE_HEADER
+	{
+		ULONG     Signature;    // COLUMN_FILE_SIGNATURE
+		ULONG     Version;      // COLUMN_FILE_VERSION
+		ULONG     Type;         // COLUMN_TYPE
+		ULONG     ElementSize;  // Bytes per row
+		ULONGLONG RowCount;
+		ULONGLONG Reserved;
+	} COLUMN_FILE_HEADER, * PCOLUMN_FILE_HEADER;
+
+	typedef const struct _COLUMN_FILE_HEADER * PCCOLUMN_FILE_HEADER;
+
+	typedef struct _STRING_DICT_HEADER
+	{
+		ULONG     Signature;    // STRING_DICT_SIGNATURE
+		ULONG     Version;      // COLUMN_FILE_VERSION
+		ULONG     StringCount;
+		ULONG     Reserved;
+		ULONGLONG DataSize;
+		ULONGLONG Reserved2;
+	} STRING_DICT_HEADER, * PSTRING_DICT_HEADER;
+
+	typedef const struct _STRING_DICT_HEADER * PCSTRING_DICT_HEADER;
+
+	//
+	// Define the description of a column.
+	//
+
+	struct ColumnDesc
+	{
+		std::string Name;
+		COLUMN_TYPE Type;
+	};
+
+	typedef std::vector< ColumnDesc > ColumnDescVec;
+
+	ColumnTable(
+		__in const ColumnDescVec & Schema
+		);
+
+	~ColumnTable(
+		);
+
+	//
+	// Return the columns of the table.
+	//
+
+	inline
+	const ColumnDescVec &
+	GetSchema(
+		) const
+	{
+		return m_Schema;
+	}
+
+	//
+	// Return the count of rows in the table.
+	//
+
+	inline
+	size_t
+	GetRowCount(
+		) const
+	{
+		return m_RowCount;
+	}
+
+	//
+	// Return a hash of the column names and types, used to detect a change of
+	// schema between two exports.
+	//
+
+	ULONGLONG
+	GetSchemaHash(
+		) const;
+
+	//
+	// Fold a block of data into an FNV-1a hash.  The first block is hashed
+	// with a Hash of INITIAL_HASH.
+	//
+
+	static const ULONGLONG INITIAL_HASH = 0xCBF29CE484222325ULL;
+
+	static
+	ULONGLONG
+	HashData(
+		__in_bcount( Length ) const void * Data,
+		__in size_t Length,
+		__in ULONGLONG Hash
+		);
+
+	//
+	// Append a row whose values are all zero (or NULL_STRING), and return its
+	// index.
+	//
+
+	size_t
+	AddRow(
+		);
+
+	//
+	// Set a value.  The value is converted to the type of the column; strings
+	// that do not parse as a number store zero in a numeric column.
+	//
+
+	void
+	SetInteger(
+		__in size_t Row,
+		__in size_t Column,
+		__in LONGLONG Value
+		);
+
+	void
+	SetReal(
+		__in size_t Row,
+		__in size_t Column,
+		__in double Value
+		);
+
+	void
+	SetString(
+		__in size_t Row,
+		__in size_t Column,
+		__in const std::string & Value
+		);
+
+	//
+	// Append a range of rows of another table with the same schema.
+	//
+
+	void
+	AppendRows(
+		__in const ColumnTable & Source,
+		__in size_t FirstRow,
+		__in size_t RowCount
+		);
+
+	//
+	// Write the table to its column files.  An std::exception is raised on
+	// failure.
+	//
+
+	void
+	Write(
+		__in const std::string & PathPrefix
+		) const;
+
+	//
+	// Replace the contents of the table with the contents of its column files.
+	// The routine returns false if any file is absent or does not match the
+	// schema of the table.
+	//
+
+	bool
+	Read(
+		__in const std::string & PathPrefix
+		);
+
+private:
+
+	typedef std::vector< unsigned char > ByteVec;
+	typedef std::vector< std::string > StringVec;
+	typedef stdext::hash_map< std::string, ULONG > StringIndexMap;
+
+	//
+	// Define the storage of one column.
+	//
+
+	struct ColumnData
+	{
+		COLUMN_TYPE Type;
+		size_t      ElementSize;
+		ByteVec     Data;
+	};
+
+	typedef std::vector< ColumnData > ColumnVec;
+
+	//
+	// Return the size of an element of a column type.
+	//
+
+	static
+	size_t
+	GetElementSize(
+		__in COLUMN_TYPE Type
+		);
+
+	//
+	// Return the dictionary index of a string, adding it if it is new.
+	//
+
+	ULONG
+	InternString(
+		__in const std::string & Value
+		);
+
+	//
+	// Return the address of a value.
+	//
+
+	inline
+	unsigned char *
+	GetValue(
+		__in size_t Row,
+		__in size_t ColumnIndex
+		)
+	{
+		if ((Row >= m_RowCount) || (ColumnIndex >= m_Columns.size( )))
+			throw std::runtime_error( "Column table index out of range." );
+
+		ColumnData & C = m_Columns[ ColumnIndex ];
+
+		return &C.Data[ Row * C.ElementSize ];
+	}
+
+	inline
+	const unsigned char *
+	GetValue(
+		__in size_t Row,
+		__in size_t ColumnIndex
+		) const
+	{
+		const ColumnData & C = m_Columns[ ColumnIndex ];
+
+		return &C.Data[ Row * C.ElementSize ];
+	}
+
+	ColumnDescVec  m_Schema;
+	ColumnVec      m_Columns;
+	size_t         m_RowCount;
+	StringVec      m_Strings;
+	StringIndexMap m_StringIndex;
+
+};
+
+#endif
@@ -0,0 +1,1570 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ExportModuleColumns.cpp
+
+Abstract:
+
+	This module houses a program that exports selected fields of the creature,
+	item and placeable blueprints of a module, and of the object instances
+	placed in its areas, as columnar files for use by analysis tools.
+
+	Resources are read in parallel.  Each table keeps a state file recording
+	the size and content hash of every resource that it was built from, so
+	that a later export only re-reads the resources that have changed.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
+#include "ColumnTable.h"
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	PrintfTextOut(
+		)
+	{
+		AllocConsole( );
+	}
+
+	inline
+	~PrintfTextOut(
+		)
+	{
+		FreeConsole( );
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine displays text to the log file and the debug console.
+
+		The console output may have color attributes supplied, as per the standard
+		SetConsoleTextAttribute API.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text as per the standard
+					 SetConsoleTextAttribute API (e.g. FOREGROUND_RED).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		HANDLE console = GetStdHandle( STD_OUTPUT_HANDLE );
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+		DWORD n = (DWORD)strlen(buf);
+		SetConsoleTextAttribute( console, Attributes );
+		WriteConsoleA(console, buf, n, &n, 0);
+	}
+
+};
+
+//
+// Define the description of a GFF field that is exported by default.
+//
+
+struct FieldSpec
+{
+	const char              * FieldName;
+	ColumnTable::COLUMN_TYPE  Type;
+};
+
+static const FieldSpec CreatureFields[ ] =
+{
+	{ "TemplateResRef",   ColumnTable::ColumnString },
+	{ "Tag",              ColumnTable::ColumnString },
+	{ "FirstName",        ColumnTable::ColumnString },
+	{ "LastName",         ColumnTable::ColumnString },
+	{ "Race",             ColumnTable::ColumnInt32  },
+	{ "Subrace",          ColumnTable::ColumnInt32  },
+	{ "Gender",           ColumnTable::ColumnInt32  },
+	{ "ChallengeRating",  ColumnTable::ColumnFloat  },
+	{ "MaxHitPoints",     ColumnTable::ColumnInt32  },
+	{ "CurrentHitPoints", ColumnTable::ColumnInt32  },
+	{ "Str",              ColumnTable::ColumnInt32  },
+	{ "Dex",              ColumnTable::ColumnInt32  },
+	{ "Con",              ColumnTable::ColumnInt32  },
+	{ "Int",              ColumnTable::ColumnInt32  },
+	{ "Wis",              ColumnTable::ColumnInt32  },
+	{ "Cha",              ColumnTable::ColumnInt32  },
+	{ "NaturalAC",        ColumnTable::ColumnInt32  },
+	{ "FactionID",        ColumnTable::ColumnInt32  },
+	{ "GoodEvil",         ColumnTable::ColumnInt32  },
+	{ "LawfulChaotic",    ColumnTable::ColumnInt32  },
+	{ "Plot",             ColumnTable::ColumnInt32  },
+	{ "Conversation",     ColumnTable::ColumnString }
+};
+
+static const FieldSpec ItemFields[ ] =
+{
+	{ "TemplateResRef",   ColumnTable::ColumnString },
+	{ "Tag",              ColumnTable::ColumnString },
+	{ "LocalizedName",    ColumnTable::ColumnString },
+	{ "BaseItem",         ColumnTable::ColumnInt32  },
+	{ "Cost",             ColumnTable::ColumnInt64  },
+	{ "AddCost",          ColumnTable::ColumnInt64  },
+	{ "StackSize",        ColumnTable::ColumnInt32  },
+	{ "Charges",          ColumnTable::ColumnInt32  },
+	{ "Plot",             ColumnTable::ColumnInt32  },
+	{ "Stolen",           ColumnTable::ColumnInt32  },
+	{ "Cursed",           ColumnTable::ColumnInt32  },
+	{ "Identified",       ColumnTable::ColumnInt32  }
+};
+
+static const FieldSpec PlaceableFields[ ] =
+{
+	{ "TemplateResRef",   ColumnTable::ColumnString },
+	{ "Tag",              ColumnTable::ColumnString },
+	{ "LocName",          ColumnTable::ColumnString },
+	{ "Appearance",       ColumnTable::ColumnInt32  },
+	{ "HP",               ColumnTable::ColumnInt32  },
+	{ "CurrentHP",        ColumnTable::ColumnInt32  },
+	{ "Hardness",         ColumnTable::ColumnInt32  },
+	{ "Plot",             ColumnTable::ColumnInt32  },
+	{ "Static",           ColumnTable::ColumnInt32  },
+	{ "Useable",          ColumnTable::ColumnInt32  },
+	{ "HasInventory",     ColumnTable::ColumnInt32  },
+	{ "Conversation",     ColumnTable::ColumnString }
+};
+
+//
+// Creature and item instances store their position in XPosition, YPosition
+// and ZPosition, whereas placeable instances use X, Y and Z.  Both sets are
+// exported; the set that an object type does not have reads as zero.
+//
+
+static const FieldSpec InstanceFields[ ] =
+{
+	{ "TemplateResRef",   ColumnTable::ColumnString },
+	{ "Tag",              ColumnTable::ColumnString },
+	{ "XPosition",        ColumnTable::ColumnFloat  },
+	{ "YPosition",        ColumnTable::ColumnFloat  },
+	{ "ZPosition",        ColumnTable::ColumnFloat  },
+	{ "X",                ColumnTable::ColumnFloat  },
+	{ "Y",                ColumnTable::ColumnFloat  },
+	{ "Z",                ColumnTable::ColumnFloat  }
+};
+
+//
+// Define the object instance lists of an area's .git that are exported.
+//
+
+struct InstanceListSpec
+{
+	const char * ListName;
+	const char * ObjectType;
+};
+
+static const InstanceListSpec InstanceLists[ ] =
+{
+	{ "Creature List",  "creature"  },
+	{ "List",           "item"      },
+	{ "Placeable List", "placeable" }
+};
+
+//
+// Define the tables that may be exported.  Blueprint tables have one row per
+// blueprint resource.  The instance table has one row per object instance
+// placed in a module area.
+//
+
+struct ExportTableSpec
+{
+	const char      * TableName;
+	NWN::ResType      ResType;
+	bool              Instances;
+	const FieldSpec * DefaultFields;
+	size_t            NumDefaultFields;
+};
+
+static const ExportTableSpec ExportTables[ ] =
+{
+	{ "utc", NWN::ResUTC, false, CreatureFields,  RTL_NUMBER_OF( CreatureFields )  },
+	{ "uti", NWN::ResUTI, false, ItemFields,      RTL_NUMBER_OF( ItemFields )      },
+	{ "utp", NWN::ResUTP, false, PlaceableFields, RTL_NUMBER_OF( PlaceableFields ) },
+	{ "git", NWN::ResGIT, true,  InstanceFields,  RTL_NUMBER_OF( InstanceFields )  }
+};
+
+//
+// Define the column type names accepted on the command line.
+//
+
+struct ColumnTypeName
+{
+	const char               * TypeName;
+	ColumnTable::COLUMN_TYPE   Type;
+};
+
+static const ColumnTypeName ColumnTypeNames[ ] =
+{
+	{ "int",    ColumnTable::ColumnInt32  },
+	{ "int64",  ColumnTable::ColumnInt64  },
+	{ "float",  ColumnTable::ColumnFloat  },
+	{ "double", ColumnTable::ColumnDouble },
+	{ "string", ColumnTable::ColumnString }
+};
+
+//
+// Define the export state file, which records the resources that a table was
+// built from.  It is written after the column files of the table, and is
+// deleted before they are rewritten, so that a partially written table is
+// never reused.
+//
+
+enum
+{
+	EXPORT_STATE_SIGNATURE = 'SEWN',
+	EXPORT_STATE_VERSION   = 1
+};
+
+typedef struct _EXPORT_STATE_HEADER
+{
+	ULONG     Signature;    // EXPORT_STATE_SIGNATURE
+	ULONG     Version;      // EXPORT_STATE_VERSION
+	ULONG     EntryCount;
+	ULONG     Reserved;
+	ULONGLONG SchemaHash;
+	ULONGLONG RowCount;
+} EXPORT_STATE_HEADER, * PEXPORT_STATE_HEADER;
+
+typedef const struct _EXPORT_STATE_HEADER * PCEXPORT_STATE_HEADER;
+
+typedef struct _EXPORT_STATE_ENTRY
+{
+	NWN::ResRef32 ResRef;
+	ULONGLONG     FileSize;
+	ULONGLONG     ContentHash;
+	ULONG         FirstRow;
+	ULONG         RowCount;
+} EXPORT_STATE_ENTRY, * PEXPORT_STATE_ENTRY;
+
+typedef const struct _EXPORT_STATE_ENTRY * PCEXPORT_STATE_ENTRY;
+
+typedef std::vector< EXPORT_STATE_ENTRY > ExportStateVec;
+typedef std::map< std::string, size_t > ExportStateIndexMap;
+
+//
+// Define the result of visiting one resource.
+//
+
+struct ItemResult
+{
+	bool             Exported;    // The visitor completed for the item
+	bool             Reused;      // The rows of the previous export are kept
+	size_t           PrevEntry;   // Previous state entry, if Reused
+	ULONGLONG        FileSize;
+	ULONGLONG        ContentHash;
+	ColumnTable::Ptr Rows;        // New rows, if not Reused
+};
+
+typedef std::vector< ItemResult > ItemResultVec;
+
+void
+HashResourceFile(
+	__in const std::string & FileName,
+	__out ULONGLONG & FileSize,
+	__out ULONGLONG & ContentHash
+	)
+/*++
+
+Routine Description:
+
+	This routine computes the size and content hash of a resource file.
+
+Arguments:
+
+	FileName - Supplies the name of the file to hash.
+
+	FileSize - Receives the size, in bytes, of the file.
+
+	ContentHash - Receives the hash of the contents of the file.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	HANDLE                       File;
+	std::vector< unsigned char > Buffer;
+	DWORD                        Read;
+
+	File = CreateFileA(
+		FileName.c_str( ),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL);
+
+	if (File == INVALID_HANDLE_VALUE)
+		throw std::runtime_error( "Failed to open " + FileName );
+
+	Buffer.resize( 65536 );
+
+	FileSize    = 0;
+	ContentHash = ColumnTable::INITIAL_HASH;
+
+	for (;;)
+	{
+		if (!ReadFile( File, &Buffer[ 0 ], (DWORD) Buffer.size( ), &Read, NULL ))
+		{
+			CloseHandle( File );
+			throw std::runtime_error( "Failed to read " + FileName );
+		}
+
+		if (Read == 0)
+			break;
+
+		FileSize    += Read;
+		ContentHash  = ColumnTable::HashData( &Buffer[ 0 ], Read, ContentHash );
+	}
+
+	CloseHandle( File );
+}
+
+void
+StoreFieldValue(
+	__in const GffFileReader::GffStruct & Struct,
+	__in const char * FieldName,
+	__in ResourceManager & ResMan,
+	__in ColumnTable & Table,
+	__in size_t Row,
+	__in size_t Column
+	)
+/*++
+
+Routine Description:
+
+	This routine stores the value of a GFF field in a column table.  The value
+	is converted to the type of the column.  Absent fields, and fields that do
+	not hold a scalar value (such as lists), leave the default value in place.
+
+Arguments:
+
+	Struct - Supplies the GFF structure to read the field from.
+
+	FieldName - Supplies the name of the field.
+
+	ResMan - Supplies the resource manager, used to convert resource names.
+
+	Table - Supplies the table to store the value in.
+
+	Row - Supplies the row index.
+
+	Column - Supplies the column index.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileReader::GFF_FIELD_TYPE FieldType;
+
+	if (!Struct.GetFieldType( FieldName, FieldType ))
+		return;
+
+	switch (FieldType)
+	{
+
+	case GffFileReader::GFF_BYTE:
+		{
+			unsigned __int8 Value;
+
+			if (Struct.GetBYTE( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_CHAR:
+		{
+			signed __int8 Value;
+
+			if (Struct.GetCHAR( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_WORD:
+		{
+			unsigned __int16 Value;
+
+			if (Struct.GetWORD( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_SHORT:
+		{
+			signed __int16 Value;
+
+			if (Struct.GetSHORT( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_DWORD:
+		{
+			unsigned long Value;
+
+			if (Struct.GetDWORD( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_INT:
+		{
+			signed __int32 Value;
+
+			if (Struct.GetINT( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_DWORD64:
+		{
+			unsigned __int64 Value;
+
+			if (Struct.GetDWORD64( FieldName, Value ))
+				Table.SetInteger( Row, Column, (LONGLONG) Value );
+		}
+		break;
+
+	case GffFileReader::GFF_INT64:
+		{
+			signed __int64 Value;
+
+			if (Struct.GetINT64( FieldName, Value ))
+				Table.SetInteger( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_FLOAT:
+		{
+			float Value;
+
+			if (Struct.GetFLOAT( FieldName, Value ))
+				Table.SetReal( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_DOUBLE:
+		{
+			double Value;
+
+			if (Struct.GetDOUBLE( FieldName, Value ))
+				Table.SetReal( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_CEXOSTRING:
+		{
+			std::string Value;
+
+			if (Struct.GetCExoString( FieldName, Value ))
+				Table.SetString( Row, Column, Value );
+		}
+		break;
+
+	case GffFileReader::GFF_RESREF:
+		{
+			NWN::ResRef32 Value;
+
+			if (Struct.GetResRef( FieldName, Value ))
+				Table.SetString( Row, Column, ResMan.StrFromResRef( Value ) );
+		}
+		break;
+
+	case GffFileReader::GFF_CEXOLOCSTRING:
+		{
+			std::string Value;
+
+			if (Struct.GetCExoLocString( FieldName, Value ))
+				Table.SetString( Row, Column, Value );
+		}
+		break;
+
+	default:
+		break;
+
+	}
+}
+
+//
+// Define the module scan visitor that builds the rows of each resource.
+//
+
+class ColumnExportVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	inline
+	ColumnExportVisitor(
+		__in const ExportTableSpec & Spec,
+		__in const ColumnTable::ColumnDescVec & Schema,
+		__in size_t FirstFieldColumn,
+		__in const ExportStateVec & PrevState,
+		__in const ExportStateIndexMap & PrevIndex,
+		__inout ItemResultVec & Results
+		)
+	: m_Spec( Spec ),
+	  m_Schema( Schema ),
+	  m_FirstFieldColumn( FirstFieldColumn ),
+	  m_PrevState( PrevState ),
+	  m_PrevIndex( PrevIndex ),
+	  m_Results( Results )
+	{
+	}
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+private:
+
+	//
+	// Store the exported fields of a GFF structure in a row.
+	//
+
+	void
+	StoreRowFields(
+		__in const GffFileReader::GffStruct & Struct,
+		__in ResourceManager & ResMan,
+		__in ColumnTable & Table,
+		__in size_t Row
+		);
+
+	ColumnExportVisitor &
+	operator=(
+		__in const ColumnExportVisitor & other
+		);
+
+	const ExportTableSpec            & m_Spec;
+	const ColumnTable::ColumnDescVec & m_Schema;
+	size_t                             m_FirstFieldColumn;
+	const ExportStateVec             & m_PrevState;
+	const ExportStateIndexMap        & m_PrevIndex;
+	ItemResultVec                    & m_Results;
+
+};
+
+void
+ColumnExportVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the rows of a resource.  If the resource is unchanged
+	since the previous export, its previous rows are kept and the resource is
+	not parsed.
+
+	It is called on a module scan worker thread.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the resource.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	ResourceManager                     & ResMan   = Context.GetResourceManager( );
+	const std::string                   & FileName = Context.GetFileName( m_Spec.ResType );
+	ItemResult                          & Result   = m_Results[ Context.GetItemIndex( ) ];
+	std::string                           ResRef;
+	ExportStateIndexMap::const_iterator   it;
+	const GffFileReader::GffStruct      * RootStruct;
+	ColumnTable::Ptr                      Table;
+
+	ResRef = ResMan.StrFromResRef( Context.GetItem( ).ResRef );
+
+	if (FileName.empty( ))
+		throw std::runtime_error( "Resource not found." );
+
+	HashResourceFile( FileName, Result.FileSize, Result.ContentHash );
+
+	it = m_PrevIndex.find( ResRef );
+
+	if (it != m_PrevIndex.end( ))
+	{
+		const EXPORT_STATE_ENTRY & Entry = m_PrevState[ it->second ];
+
+		if ((Entry.FileSize == Result.FileSize) &&
+		    (Entry.ContentHash == Result.ContentHash))
+		{
+			Result.Reused    = true;
+			Result.PrevEntry = it->second;
+			Result.Exported  = true;
+			return;
+		}
+	}
+
+	RootStruct = Context.GetGffReader( m_Spec.ResType )->GetRootStruct( );
+	Table      = new ColumnTable( m_Schema );
+
+	if (!m_Spec.Instances)
+	{
+		size_t Row = Table->AddRow( );
+
+		Table->SetString( Row, 0, ResRef );
+		StoreRowFields( *RootStruct, ResMan, *Table, Row );
+	}
+	else
+	{
+		for (size_t l = 0; l < RTL_NUMBER_OF( InstanceLists ); l += 1)
+		{
+			for (size_t i = 0; i <= ULONG_MAX; i += 1)
+			{
+				GffFileReader::GffStruct Instance;
+				size_t                   Row;
+
+				if (!RootStruct->GetListElement( InstanceLists[ l ].ListName, i, Instance ))
+					break;
+
+				Row = Table->AddRow( );
+
+				Table->SetString( Row, 0, ResRef );
+				Table->SetString( Row, 1, InstanceLists[ l ].ObjectType );
+				Table->SetInteger( Row, 2, (LONGLONG) i );
+				StoreRowFields( Instance, ResMan, *Table, Row );
+			}
+		}
+	}
+
+	Result.Rows     = Table;
+	Result.Exported = true;
+}
+
+void
+ColumnExportVisitor::StoreRowFields(
+	__in const GffFileReader::GffStruct & Struct,
+	__in ResourceManager & ResMan,
+	__in ColumnTable & Table,
+	__in size_t Row
+	)
+/*++
+
+Routine Description:
+
+	This routine stores each exported field of a GFF structure in a row.
+
+Arguments:
+
+	Struct - Supplies the GFF structure to read.
+
+	ResMan - Supplies the resource manager.
+
+	Table - Supplies the table to store the values in.
+
+	Row - Supplies the row index.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	for (size_t Column = m_FirstFieldColumn; Column < m_Schema.size( ); Column += 1)
+	{
+		StoreFieldValue(
+			Struct,
+			m_Schema[ Column ].Name.c_str( ),
+			ResMan,
+			Table,
+			Row,
+			Column);
+	}
+}
+
+bool
+ReadExportState(
+	__in const std::string & FileName,
+	__in ULONGLONG SchemaHash,
+	__out ExportStateVec & Entries,
+	__out ULONGLONG & RowCount
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the export state file of a table.
+
+Arguments:
+
+	FileName - Supplies the name of the state file.
+
+	SchemaHash - Supplies the schema hash of the table.  The state is only
+	             accepted if it was written for the same schema.
+
+	Entries - Receives the state entries.
+
+	RowCount - Receives the count of rows in the table.
+
+Return Value:
+
+	The routine returns true if the state was read, else false if it is
+	absent, damaged or belongs to another schema.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE                * f;
+	EXPORT_STATE_HEADER   Header;
+	bool                  Status;
+
+	Entries.clear( );
+
+	f = fopen( FileName.c_str( ), "rb" );
+
+	if (f == NULL)
+		return false;
+
+	Status = false;
+
+	if ((fread( &Header, sizeof( Header ), 1, f ) == 1) &&
+	    (Header.Signature == EXPORT_STATE_SIGNATURE) &&
+	    (Header.Version == EXPORT_STATE_VERSION) &&
+	    (Header.SchemaHash == SchemaHash) &&
+	    (Header.EntryCount < ULONG_MAX / sizeof( EXPORT_STATE_ENTRY )))
+	{
+		Entries.resize( Header.EntryCount );
+		RowCount = Header.RowCount;
+
+		if ((Entries.empty( )) ||
+		    (fread( &Entries[ 0 ], Entries.size( ) * sizeof( EXPORT_STATE_ENTRY ), 1, f ) == 1))
+		{
+			Status = true;
+		}
+	}
+
+	fclose( f );
+
+	if (!Status)
+		Entries.clear( );
+
+	return Status;
+}
+
+void
+WriteExportState(
+	__in const std::string & FileName,
+	__in ULONGLONG SchemaHash,
+	__in const ExportStateVec & Entries,
+	__in ULONGLONG RowCount
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the export state file of a table.
+
+Arguments:
+
+	FileName - Supplies the name of the state file.
+
+	SchemaHash - Supplies the schema hash of the table.
+
+	Entries - Supplies the state entries.
+
+	RowCount - Supplies the count of rows in the table.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE                * f;
+	EXPORT_STATE_HEADER   Header;
+	bool                  Status;
+
+	f = fopen( FileName.c_str( ), "wb" );
+
+	if (f == NULL)
+		throw std::runtime_error( "Failed to create " + FileName );
+
+	ZeroMemory( &Header, sizeof( Header ) );
+
+	Header.Signature  = EXPORT_STATE_SIGNATURE;
+	Header.Version    = EXPORT_STATE_VERSION;
+	Header.EntryCount = (ULONG) Entries.size( );
+	Header.SchemaHash = SchemaHash;
+	Header.RowCount   = RowCount;
+
+	Status = (fwrite( &Header, sizeof( Header ), 1, f ) == 1);
+
+	if ((Status) && (!Entries.empty( )))
+		Status = (fwrite( &Entries[ 0 ], Entries.size( ) * sizeof( EXPORT_STATE_ENTRY ), 1, f ) == 1);
+
+	if (fclose( f ) != 0)
+		Status = false;
+
+	if (!Status)
+	{
+		DeleteFileA( FileName.c_str( ) );
+		throw std::runtime_error( "Failed to write " + FileName );
+	}
+}
+
+void
+BuildSchema(
+	__in const ExportTableSpec & Spec,
+	__in const ColumnTable::ColumnDescVec & Fields,
+	__out ColumnTable::ColumnDescVec & Schema,
+	__out size_t & FirstFieldColumn
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the columns of a table.  The leading columns identify
+	the resource (and, for instances, the instance) that each row came from,
+	and are followed by one column per exported GFF field.
+
+Arguments:
+
+	Spec - Supplies the table to build the schema of.
+
+	Fields - Supplies the GFF fields to export, or an empty vector to export
+	         the default fields of the table.
+
+	Schema - Receives the columns of the table.
+
+	FirstFieldColumn - Receives the index of the first GFF field column.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ColumnTable::ColumnDesc Desc;
+
+	Schema.clear( );
+
+	if (!Spec.Instances)
+	{
+		Desc.Name = "ResRef";
+		Desc.Type = ColumnTable::ColumnString;
+		Schema.push_back( Desc );
+	}
+	else
+	{
+		Desc.Name = "Area";
+		Desc.Type = ColumnTable::ColumnString;
+		Schema.push_back( Desc );
+
+		Desc.Name = "ObjectType";
+		Desc.Type = ColumnTable::ColumnString;
+		Schema.push_back( Desc );
+
+		Desc.Name = "Instance";
+		Desc.Type = ColumnTable::ColumnInt32;
+		Schema.push_back( Desc );
+	}
+
+	FirstFieldColumn = Schema.size( );
+
+	if (Fields.empty( ))
+	{
+		for (size_t i = 0; i < Spec.NumDefaultFields; i += 1)
+		{
+			Desc.Name = Spec.DefaultFields[ i ].FieldName;
+			Desc.Type = Spec.DefaultFields[ i ].Type;
+			Schema.push_back( Desc );
+		}
+	}
+	else
+	{
+		Schema.insert( Schema.end( ), Fields.begin( ), Fields.end( ) );
+	}
+
+	//
+	// Column names form file names, so they must be unique without regard to
+	// case.
+	//
+
+	for (size_t i = 0; i < Schema.size( ); i += 1)
+	{
+		for (size_t j = i + 1; j < Schema.size( ); j += 1)
+		{
+			if (!_stricmp( Schema[ i ].Name.c_str( ), Schema[ j ].Name.c_str( ) ))
+			{
+				throw std::runtime_error(
+					"Duplicate column " +
+					Schema[ j ].Name +
+					" in table " +
+					Spec.TableName);
+			}
+		}
+	}
+}
+
+bool
+ExportTable(
+	__in ResourceManager & ResMan,
+	__in IDebugTextOut * TextOut,
+	__in const ExportTableSpec & Spec,
+	__in const ColumnTable::ColumnDescVec & Fields,
+	__in const std::string & OutputDir,
+	__in ULONG MaxThreads,
+	__in bool FullExport
+	)
+/*++
+
+Routine Description:
+
+	This routine exports one table.  The resources of the table are visited
+	in parallel, and their rows are then combined in resource order.  Rows of
+	resources that are unchanged since the previous export are copied from
+	the previous column files instead of being parsed again.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded into.
+
+	TextOut - Supplies the text output interface.
+
+	Spec - Supplies the table to export.
+
+	Fields - Supplies the GFF fields to export, or an empty vector to export
+	         the default fields of the table.
+
+	OutputDir - Supplies the directory to write the column files to.
+
+	MaxThreads - Supplies the maximum count of worker threads, or zero to use
+	             one worker thread per processor.
+
+	FullExport - Supplies true to ignore the previous export.
+
+Return Value:
+
+	The routine returns true if every resource was exported, else false if
+	any resource failed (its rows are omitted).  An std::exception is raised
+	on failure to write the table.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ColumnTable::ColumnDescVec   Schema;
+	size_t                       FirstFieldColumn;
+	std::string                  Prefix;
+	std::string                  StateFile;
+	ExportStateVec               PrevState;
+	ExportStateIndexMap          PrevIndex;
+	ULONGLONG                    PrevRowCount;
+	ExportStateVec               State;
+	ItemResultVec                Results;
+	ULONG                        Reused;
+	bool                         UpToDate;
+	ULONG                        StartTime;
+
+	StartTime    = GetTickCount( );
+	PrevRowCount = 0;
+
+	BuildSchema( Spec, Fields, Schema, FirstFieldColumn );
+
+	Prefix    = OutputDir + "\\" + Spec.TableName;
+	StateFile = Prefix + ".state";
+
+	ColumnTable Previous( Schema );
+	ColumnTable Output( Schema );
+
+	//
+	// Load the previous export, if it was made with the same schema and is
+	// intact.
+	//
+
+	if ((!FullExport) &&
+	    (ReadExportState( StateFile, Previous.GetSchemaHash( ), PrevState, PrevRowCount )) &&
+	    (Previous.Read( Prefix )) &&
+	    (Previous.GetRowCount( ) == PrevRowCount))
+	{
+		for (size_t i = 0; i < PrevState.size( ); i += 1)
+		{
+			const EXPORT_STATE_ENTRY & Entry = PrevState[ i ];
+
+			if ((Entry.FirstRow > PrevRowCount) ||
+			    (Entry.RowCount > PrevRowCount - Entry.FirstRow))
+			{
+				PrevIndex.clear( );
+				break;
+			}
+
+			PrevIndex[ ResMan.StrFromResRef( Entry.ResRef ) ] = i;
+		}
+	}
+
+	if (PrevIndex.empty( ))
+		PrevState.clear( );
+
+	//
+	// Visit every resource of the table.
+	//
+
+	ModuleScan Scan( ResMan, TextOut );
+
+	Scan.SetScanTypes( &Spec.ResType, 1 );
+
+	if (Spec.Instances)
+		Scan.AddModuleAreas( );
+	else
+		Scan.AddResourcesOfType( Spec.ResType );
+
+	{
+		ItemResult Empty;
+
+		Empty.Exported    = false;
+		Empty.Reused      = false;
+		Empty.PrevEntry   = 0;
+		Empty.FileSize    = 0;
+		Empty.ContentHash = 0;
+
+		Results.resize( Scan.GetItems( ).size( ), Empty );
+	}
+
+	ColumnExportVisitor Visitor( Spec, Schema, FirstFieldColumn, PrevState, PrevIndex, Results );
+
+	Scan.Scan( &Visitor, MaxThreads );
+
+	//
+	// Now combine the rows in resource order.
+	//
+
+	Reused = 0;
+
+	for (size_t i = 0; i < Results.size( ); i += 1)
+	{
+		const ItemResult   & Result = Results[ i ];
+		EXPORT_STATE_ENTRY   Entry;
+
+		if (!Result.Exported)
+			continue;
+
+		ZeroMemory( &Entry, sizeof( Entry ) );
+
+		Entry.ResRef      = Scan.GetItems( )[ i ].ResRef;
+		Entry.FileSize    = Result.FileSize;
+		Entry.ContentHash = Result.ContentHash;
+		Entry.FirstRow    = (ULONG) Output.GetRowCount( );
+
+		if (Result.Reused)
+		{
+			const EXPORT_STATE_ENTRY & Prev = PrevState[ Result.PrevEntry ];
+
+			Output.AppendRows( Previous, Prev.FirstRow, Prev.RowCount );
+			Reused += 1;
+		}
+		else
+		{
+			Output.AppendRows( *Result.Rows, 0, Result.Rows->GetRowCount( ) );
+		}
+
+		if (Output.GetRowCount( ) > ULONG_MAX)
+			throw std::runtime_error( "Too many rows in table." );
+
+		Entry.RowCount = (ULONG) (Output.GetRowCount( ) - Entry.FirstRow);
+
+		State.push_back( Entry );
+	}
+
+	//
+	// If every resource was kept, in the same order, then the previous export
+	// is already up to date and need not be written again.
+	//
+
+	UpToDate = ((Reused == State.size( )) && (State.size( ) == PrevState.size( )));
+
+	for (size_t i = 0; (UpToDate) && (i < State.size( )); i += 1)
+	{
+		if ((memcmp( &State[ i ].ResRef, &PrevState[ i ].ResRef, sizeof( NWN::ResRef32 ) )) ||
+		    (State[ i ].FirstRow != PrevState[ i ].FirstRow))
+		{
+			UpToDate = false;
+		}
+	}
+
+	if ((!UpToDate) || (State.empty( )))
+	{
+		DeleteFileA( StateFile.c_str( ) );
+
+		Output.Write( Prefix );
+
+		WriteExportState(
+			StateFile,
+			Output.GetSchemaHash( ),
+			State,
+			Output.GetRowCount( ));
+	}
+
+	{
+		const ModuleScan::ScanStats & Stats = Scan.GetStats( );
+
+		TextOut->WriteText(
+			"Table %s: %lu resource(s) (%lu read, %lu unchanged, %lu failed), %lu row(s), %lu thread(s), %lums%s.\n",
+			Spec.TableName,
+			Stats.Items,
+			(ULONG) State.size( ) - Reused,
+			Reused,
+			Stats.FailedItems,
+			(ULONG) Output.GetRowCount( ),
+			Stats.Threads,
+			GetTickCount( ) - StartTime,
+			((UpToDate) && (!State.empty( ))) ? " (up to date)" : "");
+
+		return (Stats.FailedItems == 0);
+	}
+}
+
+bool
+ParseFieldArgument(
+	__in const char * Arg,
+	__inout std::vector< ColumnTable::ColumnDescVec > & TableFields
+	)
+/*++
+
+Routine Description:
+
+	This routine parses a -field argument of the form
+	<table>:<field name>[:<type>], and adds the field to the fields of the
+	table.
+
+Arguments:
+
+	Arg - Supplies the argument text.
+
+	TableFields - Supplies the fields of each table, indexed parallel to the
+	              ExportTables array.
+
+Return Value:
+
+	The routine returns true if the argument was valid, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string               Text( Arg );
+	std::string               TableName;
+	std::string               TypeName;
+	ColumnTable::ColumnDesc   Desc;
+	size_t                    Offset;
+	size_t                    Table;
+	size_t                    i;
+
+	if ((Offset = Text.find( ':' )) == std::string::npos)
+		return false;
+
+	TableName = Text.substr( 0, Offset );
+	Desc.Name = Text.substr( Offset + 1 );
+	Desc.Type = ColumnTable::ColumnString;
+
+	if ((Offset = Desc.Name.find( ':' )) != std::string::npos)
+	{
+		TypeName = Desc.Name.substr( Offset + 1 );
+		Desc.Name.erase( Offset );
+
+		for (i = 0; i < RTL_NUMBER_OF( ColumnTypeNames ); i += 1)
+		{
+			if (!_stricmp( TypeName.c_str( ), ColumnTypeNames[ i ].TypeName ))
+				break;
+		}
+
+		if (i == RTL_NUMBER_OF( ColumnTypeNames ))
+			return false;
+
+		Desc.Type = ColumnTypeNames[ i ].Type;
+	}
+
+	//
+	// GFF field names are at most 16 characters, and must form a valid file
+	// name component.
+	//
+
+	if ((Desc.Name.empty( )) ||
+	    (Desc.Name.size( ) > 16) ||
+	    (Desc.Name.find_first_of( "\\/:*?\"<>|" ) != std::string::npos))
+	{
+		return false;
+	}
+
+	for (Table = 0; Table < RTL_NUMBER_OF( ExportTables ); Table += 1)
+	{
+		if (!_stricmp( TableName.c_str( ), ExportTables[ Table ].TableName ))
+			break;
+	}
+
+	if (Table == RTL_NUMBER_OF( ExportTables ))
+		return false;
+
+	TableFields[ Table ].push_back( Desc );
+
+	return true;
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"ExportModuleColumns\n"
+		"\n"
+		"This program exports selected fields of the creature, item and placeable\n"
+		"blueprints of a module, and of the objects placed in its areas, as columnar\n"
+		"files.  Re-running the program only re-reads resources that have changed.\n"
+		"\n"
+		"Usage: ExportModuleColumns -home <homedir> -installdir <installdir>\n"
+		"                           -module <module resource name>\n"
+		"                           -out <output directory>\n"
+		"                           [-table <table name...>]\n"
+		"                           [-field <table>:<field name>[:<type>]...]\n"
+		"                           [-threads <worker thread count>] [-full]\n"
+		);
+
+	printf( "\n" );
+	printf( "Legal table names are:\n" );
+
+	for (size_t i = 0; i < RTL_NUMBER_OF( ExportTables ); i += 1)
+		printf( "   %s\n", ExportTables[ i ].TableName );
+
+	printf( "\n" );
+	printf( "Legal field types are:\n" );
+
+	for (size_t i = 0; i < RTL_NUMBER_OF( ColumnTypeNames ); i += 1)
+		printf( "   %s\n", ColumnTypeNames[ i ].TypeName );
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the module column exporter
+	program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char                                * ModuleName;
+	const char                                * NWN2Home;
+	const char                                * InstallDir;
+	const char                                * OutputDir;
+	std::vector< ColumnTable::ColumnDescVec >   TableFields;
+	std::vector< bool >                         TableSelected;
+	bool                                        AnySelected;
+	unsigned long                               MaxThreads;
+	bool                                        FullExport;
+	int                                         ExitCode;
+
+	ModuleName  = NULL;
+	NWN2Home    = NULL;
+	InstallDir  = NULL;
+	OutputDir   = NULL;
+	AnySelected = false;
+	MaxThreads  = 0;
+	FullExport  = false;
+
+	TableFields.resize( RTL_NUMBER_OF( ExportTables ) );
+	TableSelected.resize( RTL_NUMBER_OF( ExportTables ), false );
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-module" )) && (i + 1 < argc))
+			ModuleName = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-home" )) && (i + 1 < argc))
+			NWN2Home = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-installdir" )) && (i + 1 < argc))
+			InstallDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-out" )) && (i + 1 < argc))
+			OutputDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-full")))
+			FullExport = true;
+		else if ((!_stricmp( argv[ i ], "-field" )) && (i + 1 < argc))
+		{
+			if (!ParseFieldArgument( argv[ ++i ], TableFields ))
+			{
+				PrintUsage( );
+				printf( "\nInvalid field '%s'.  Fields are given as <table>:<field name>[:<type>], such as utc:Race:int.\n", argv[ i ] );
+				return -1;
+			}
+		}
+		else if ((!_stricmp( argv[ i ], "-table" )) && (i + 1 < argc))
+		{
+			bool FoundIt;
+
+			FoundIt  = false;
+			i       += 1;
+
+			for (size_t j = 0; j < RTL_NUMBER_OF( ExportTables ); j += 1)
+			{
+				if (!_stricmp( argv[ i ], ExportTables[ j ].TableName ))
+				{
+					TableSelected[ j ] = true;
+					AnySelected        = true;
+					FoundIt            = true;
+					break;
+				}
+			}
+
+			if (!FoundIt)
+			{
+				PrintUsage( );
+				printf( "\nInvalid table name '%s'.\n", argv[ i ] );
+				return -1;
+			}
+		}
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	//
+	// First, check that we've got the necessary arguments.
+	//
+
+	if (ModuleName == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the module resource name of the module to load with -module <module resource name>.  The module resource name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (NWN2Home == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 home directory location with -home <homedir>.  The home directory is typically the path to your \"Documents\\Neverwinter Nights 2\" directory.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (InstallDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 game installation directory location with -installdir <installdir>.  The installation directory is typically the path to the Neverwinter Nights 2 directory under Program Files.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (OutputDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the directory to write the column files to with -out <output directory>.\n" );
+		return -1;
+	}
+
+	if (!AnySelected)
+		TableSelected.assign( TableSelected.size( ), true );
+
+	if ((!CreateDirectoryA( OutputDir, NULL )) &&
+	    (GetLastError( ) != ERROR_ALREADY_EXISTS))
+	{
+		printf( "Failed to create output directory '%s'.\n", OutputDir );
+		return -1;
+	}
+
+	//
+	// Now spin up a resource manager instance.
+	//
+
+	PrintfTextOut   TextOut;
+	ResourceManager ResMan( &TextOut );
+
+	ExitCode = 0;
+
+	try
+	{
+		TextOut.WriteText( "Loading module...\n" );
+		ModuleScan::LoadModule( ResMan, ModuleName, NWN2Home, InstallDir );
+
+		for (size_t i = 0; i < RTL_NUMBER_OF( ExportTables ); i += 1)
+		{
+			if (!TableSelected[ i ])
+				continue;
+
+			if (!ExportTable(
+				ResMan,
+				&TextOut,
+				ExportTables[ i ],
+				TableFields[ i ],
+				OutputDir,
+				MaxThreads,
+				FullExport))
+			{
+				ExitCode = 1;
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
+		ExitCode = -1;
+	}
+
+	return ExitCode;
+}
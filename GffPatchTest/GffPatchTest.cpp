@@ -0,0 +1,2017 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	GffPatchTest.cpp
+
+Abstract:
+
+	This module houses a program that checks that GFF patches round trip.
+
+	For each pair of base and target files, a patch is created with
+	GffPatch::CreatePatch and applied to the base file with
+	GffPatch::ApplyPatch.  The result must hash to the target hash recorded in
+	the patch, and must have the same structures and fields as the target
+	file (compared field by field, without regard to field order).
+
+	A set of directed cases covers field adds, removes and changes, nested
+	structure patches, list element inserts, removes, moves and changes,
+	field order only differences and identical files, and checks the patch
+	counters of each.  Randomly generated files are then edited at random, as
+	are any GFF files named on the command line.  Every patch is also checked
+	to be rejected when applied to the wrong base file, when truncated, when
+	given trailing data or a bad header, and when its first operation is
+	invalid; patches with random bytes overwritten must either be rejected or
+	apply cleanly.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/GffPatch.h"
+
+//
+// Define the size of a patch that contains no edits (the 24 byte patch
+// header, followed by the end of structure operation).
+//
+
+#define EMPTY_PATCH_SIZE 25
+
+//
+// Define the deepest nesting of structures in randomly generated files.
+//
+
+#define MAX_TEST_DEPTH 3
+
+//
+// Define the count of patches with overwritten bytes that are applied for
+// each patch checked.
+//
+
+#define CORRUPT_PATCH_COUNT 16
+
+typedef std::vector< unsigned char > ByteVec;
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		vprintf( fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		vprintf( fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		vprintf( fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	{
+		vprintf( fmt, argptr );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+};
+
+//
+// Define the directed test cases.  Each case edits the same base file, and
+// lists the patch counters that the edit is expected to produce.  The field
+// counters include the fields edited within patched list elements.
+//
+
+typedef enum _PATCH_CASE_ID
+{
+	CaseIdentical,
+	CaseFieldOrder,
+	CaseFieldAdd,
+	CaseFieldRemove,
+	CaseFieldChange,
+	CaseFieldTypeChange,
+	CaseFieldBecomesStruct,
+	CaseStructType,
+	CaseNestedChange,
+	CaseNestedAddRemove,
+	CaseListInsert,
+	CaseListRemove,
+	CaseListMove,
+	CaseListReverse,
+	CaseListChange,
+	CaseListClear,
+	CaseListMixed,
+
+	LastPatchCase
+} PATCH_CASE_ID, * PPATCH_CASE_ID;
+
+struct PATCH_CASE
+{
+	const char * Name;
+	bool         Changed;
+	ULONG        FieldsAdded;
+	ULONG        FieldsRemoved;
+	ULONG        FieldsChanged;
+	ULONG        ElementsAdded;
+	ULONG        ElementsRemoved;
+	ULONG        ElementsMoved;
+	ULONG        ElementsChanged;
+};
+
+const PATCH_CASE PatchCases[ LastPatchCase ] =
+{
+	//
+	// Name                    Changed  Fields +  -  ~  Elements +  -  >  ~
+	//
+
+	{ "identical",              false,         0, 0, 0,          0, 0, 0, 0 },
+	{ "field order",            false,         0, 0, 0,          0, 0, 0, 0 },
+	{ "field add",              true,          1, 0, 0,          0, 0, 0, 0 },
+	{ "field remove",           true,          0, 1, 0,          0, 0, 0, 0 },
+	{ "field change",           true,          0, 0, 1,          0, 0, 0, 0 },
+	{ "field type change",      true,          0, 0, 1,          0, 0, 0, 0 },
+	{ "field becomes struct",   true,          0, 0, 1,          0, 0, 0, 0 },
+	{ "struct type",            true,          0, 0, 0,          0, 0, 0, 0 },
+	{ "nested change",          true,          0, 0, 1,          0, 0, 0, 0 },
+	{ "nested add and remove",  true,          1, 1, 0,          0, 0, 0, 0 },
+	{ "list insert",            true,          0, 0, 0,          1, 0, 0, 0 },
+	{ "list remove",            true,          0, 0, 0,          0, 1, 0, 0 },
+	{ "list move",              true,          0, 0, 0,          0, 0, 1, 0 },
+	{ "list reverse",           true,          0, 0, 0,          0, 0, 5, 0 },
+	{ "list change",            true,          0, 0, 1,          0, 0, 0, 1 },
+	{ "list clear",             true,          0, 0, 0,          0, 6, 0, 0 },
+	{ "list mixed",             true,          0, 0, 3,          0, 0, 1, 2 },
+};
+
+//
+// Define the results of a group of checks.
+//
+
+struct CHECK_STATS
+{
+	unsigned long        Patches;
+	unsigned long        Changed;
+	unsigned long        Rejected;
+	unsigned long        CorruptApplied;
+	unsigned long        Mismatches;
+	unsigned __int64     PatchBytes;
+	GffPatch::PatchStats Totals;
+};
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test data is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+void
+ReportMismatch(
+	__inout CHECK_STATS & Stats,
+	__in const char * Description,
+	__in const char * Problem
+	)
+/*++
+
+Routine Description:
+
+	This routine counts a failed check, and prints the first few failures.
+
+Arguments:
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+	Description - Supplies the description of the files being checked.
+
+	Problem - Supplies the description of the failed check.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Stats.Mismatches < 16)
+		printf( "MISMATCH: %s: %s\n", Description, Problem );
+
+	Stats.Mismatches += 1;
+}
+
+void
+CommitFile(
+	__in GffFileWriter & Writer,
+	__out ByteVec & Data
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the contents of a GFF writer to memory.
+
+Arguments:
+
+	Writer - Supplies the writer to commit.
+
+	Data - Receives the GFF file data.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (!Writer.Commit( Data, GffFileWriter::GFF_FILE_TYPE ))
+		throw std::runtime_error( "Failed to commit GFF file." );
+}
+
+void
+MakeLabel(
+	__in unsigned long Index,
+	__out_bcount( LabelSize ) char * Label,
+	__in size_t LabelSize
+	)
+/*++
+
+Routine Description:
+
+	This routine returns one of the field labels used in randomly generated
+	files.  The last few labels have the maximum label length of 16.
+
+Arguments:
+
+	Index - Supplies the label number.
+
+	Label - Receives the label.
+
+	LabelSize - Supplies the size of the label buffer.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Index < 20)
+		StringCbPrintfA( Label, LabelSize, "F%02lu", Index );
+	else
+		StringCbPrintfA( Label, LabelSize, "LongFieldLabel%02lu", Index );
+}
+
+void
+BuildRandomStruct(
+	__inout GffFileWriter::GffStruct & Struct,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	);
+
+void
+SetRandomField(
+	__inout GffFileWriter::GffStruct & Struct,
+	__in const char * Label,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine adds a field of a random type and value to a structure.
+	Values are drawn from a small range, so that equal fields are common.
+
+Arguments:
+
+	Struct - Supplies the structure that receives the field, which must not
+	         already have a field with the given label.
+
+	Label - Supplies the label of the field.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Type;
+	unsigned long Value;
+	char          Text[ 32 ];
+
+	//
+	// Lists are picked more often than other types, so that most files have
+	// several lists to edit.  Structures and lists are not nested deeper than
+	// MAX_TEST_DEPTH.
+	//
+
+	Type  = NextRandom( Seed ) % ((Depth < MAX_TEST_DEPTH) ? 20 : GffFileReader::GFF_STRUCT);
+	Value = NextRandom( Seed ) % 4;
+
+	if (Type > GffFileReader::GFF_LIST)
+		Type = GffFileReader::GFF_LIST;
+
+	StringCbPrintfA( Text, sizeof( Text ), "value%lu", Value );
+
+	switch (Type)
+	{
+
+	case GffFileReader::GFF_BYTE:
+		Struct.SetBYTE( Label, (unsigned __int8) Value );
+		break;
+
+	case GffFileReader::GFF_CHAR:
+		Struct.SetCHAR( Label, (signed __int8) -(int) Value );
+		break;
+
+	case GffFileReader::GFF_WORD:
+		Struct.SetWORD( Label, (unsigned __int16) (Value * 1000) );
+		break;
+
+	case GffFileReader::GFF_SHORT:
+		Struct.SetSHORT( Label, (signed __int16) -(int) (Value * 1000) );
+		break;
+
+	case GffFileReader::GFF_DWORD:
+		Struct.SetDWORD( Label, (unsigned __int32) (Value * 100000) );
+		break;
+
+	case GffFileReader::GFF_INT:
+		Struct.SetINT( Label, -(signed __int32) (Value * 100000) );
+		break;
+
+	case GffFileReader::GFF_DWORD64:
+		Struct.SetDWORD64( Label, (unsigned __int64) Value << 40 );
+		break;
+
+	case GffFileReader::GFF_INT64:
+		Struct.SetINT64( Label, -((signed __int64) Value << 40) );
+		break;
+
+	case GffFileReader::GFF_FLOAT:
+		Struct.SetFLOAT( Label, (float) Value * 0.25f );
+		break;
+
+	case GffFileReader::GFF_DOUBLE:
+		Struct.SetDOUBLE( Label, (double) Value * 0.125 );
+		break;
+
+	case GffFileReader::GFF_CEXOSTRING:
+		Struct.SetCExoString( Label, Text );
+		break;
+
+	case GffFileReader::GFF_RESREF:
+		Struct.SetResRef( Label, std::string( Text ) );
+		break;
+
+	case GffFileReader::GFF_CEXOLOCSTRING:
+		Struct.SetCExoLocString( Label, Text );
+		break;
+
+	case GffFileReader::GFF_VOID:
+		{
+			ByteVec Data;
+
+			Data.resize( Value * 3, (unsigned char) Value );
+
+			Struct.SetVOID( Label, Data );
+		}
+		break;
+
+	case GffFileReader::GFF_STRUCT:
+		{
+			GffFileWriter::GffStruct Child = Struct.CreateStruct( Label, Value );
+
+			BuildRandomStruct( Child, Seed, Depth + 1 );
+		}
+		break;
+
+	case GffFileReader::GFF_LIST:
+		{
+			unsigned long Count;
+
+			//
+			// List elements are built from a few element seeds, so that
+			// lists hold equal elements.
+			//
+
+			Count = NextRandom( Seed ) % 7;
+
+			Struct.CreateList( Label );
+
+			for (unsigned long i = 0; i < Count; i += 1)
+			{
+				unsigned long            ElementSeed = NextRandom( Seed ) % 6;
+				GffFileWriter::GffStruct Element     = Struct.AppendListElement( Label, ElementSeed % 3 );
+
+				BuildRandomStruct( Element, ElementSeed, Depth + 1 );
+			}
+		}
+		break;
+
+	}
+}
+
+void
+BuildRandomStruct(
+	__inout GffFileWriter::GffStruct & Struct,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine fills an empty structure with random fields.
+
+Arguments:
+
+	Struct - Supplies the structure to fill.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Count;
+
+	if (Depth == 0)
+		Count = 4 + NextRandom( Seed ) % 8;
+	else
+		Count = NextRandom( Seed ) % 5;
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		char                          Label[ 17 ];
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+
+		MakeLabel( NextRandom( Seed ) % 24, Label, sizeof( Label ) );
+
+		if (Struct.GetFieldType( Label, FieldType ))
+			continue;
+
+		SetRandomField( Struct, Label, Seed, Depth );
+	}
+}
+
+void
+MutateStruct(
+	__in const GffFileReader::GffStruct & Base,
+	__inout GffFileWriter::GffStruct & Target,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	);
+
+void
+MutateList(
+	__in const GffFileReader::GffStruct & Base,
+	__in GffFileReader::FIELD_INDEX FieldIndex,
+	__inout GffFileWriter::GffStruct & Target,
+	__in const char * Label,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine makes random edits to a list field.  Elements are removed,
+	edited, moved and duplicated, and new elements are inserted.
+
+Arguments:
+
+	Base - Supplies the base structure that contains the list.
+
+	FieldIndex - Supplies the field index of the list in the base structure.
+
+	Target - Supplies the copy of the base structure to edit.
+
+	Label - Supplies the label of the list.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Depth - Supplies the nesting depth of the structure that contains the
+	        list.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const size_t             NEW_ELEMENT = (size_t) -1;
+	GffFileReader::GffStruct BaseElement;
+	std::vector< size_t >    Order;
+	std::vector< bool >      Edit;
+	size_t                   Count;
+	unsigned long            Moves;
+	unsigned long            Inserts;
+
+	//
+	// Pick the base element (or a new element) for each target position.
+	//
+
+	for (Count = 0; Base.GetListElementByIndex( FieldIndex, Count, BaseElement ); Count += 1)
+	{
+		unsigned long Action = NextRandom( Seed ) % 8;
+
+		if (Action == 0)
+			continue;
+
+		Order.push_back( Count );
+		Edit.push_back( Action == 1 );
+	}
+
+	Moves = NextRandom( Seed ) % 3;
+
+	for (unsigned long i = 0; (i < Moves) && (Order.size( ) >= 2); i += 1)
+	{
+		size_t From     = NextRandom( Seed ) % Order.size( );
+		size_t To       = NextRandom( Seed ) % Order.size( );
+		size_t Element  = Order[ From ];
+		bool   EditFlag = Edit[ From ];
+
+		Order.erase( Order.begin( ) + From );
+		Edit.erase( Edit.begin( ) + From );
+		Order.insert( Order.begin( ) + To, Element );
+		Edit.insert( Edit.begin( ) + To, EditFlag );
+	}
+
+	Inserts = NextRandom( Seed ) % 3;
+
+	for (unsigned long i = 0; i < Inserts; i += 1)
+	{
+		size_t Position = NextRandom( Seed ) % (Order.size( ) + 1);
+		size_t Element  = NEW_ELEMENT;
+
+		if ((Count != 0) && (NextRandom( Seed ) % 3 == 0))
+			Element = NextRandom( Seed ) % Count;
+
+		Order.insert( Order.begin( ) + Position, Element );
+		Edit.insert( Edit.begin( ) + Position, false );
+	}
+
+	//
+	// Now rebuild the list in the new order.
+	//
+
+	Target.DeleteField( Label );
+	Target.CreateList( Label );
+
+	for (size_t j = 0; j < Order.size( ); j += 1)
+	{
+		GffFileWriter::GffStruct Element;
+
+		if (Order[ j ] == NEW_ELEMENT)
+		{
+			unsigned long ElementSeed = NextRandom( Seed ) % 6;
+
+			Element = Target.AppendListElement( Label, ElementSeed % 3 );
+
+			BuildRandomStruct( Element, ElementSeed, Depth + 1 );
+			continue;
+		}
+
+		if (!Base.GetListElementByIndex( FieldIndex, Order[ j ], BaseElement ))
+			throw std::runtime_error( "Failed to retrieve list element." );
+
+		Element = Target.AppendListElement( Label, BaseElement.GetType( ) );
+
+		Element.InitializeFromStruct( &BaseElement );
+
+		if (Edit[ j ])
+			MutateStruct( BaseElement, Element, Seed, Depth + 1 );
+	}
+}
+
+void
+MutateStruct(
+	__in const GffFileReader::GffStruct & Base,
+	__inout GffFileWriter::GffStruct & Target,
+	__inout unsigned long & Seed,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine makes random edits to a structure.  Fields are removed,
+	replaced with fields of a random type, or added, and nested structures and
+	lists are edited in turn.
+
+Arguments:
+
+	Base - Supplies the base structure.
+
+	Target - Supplies the copy of the base structure to edit.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileReader::FIELD_INDEX FieldCount;
+	unsigned long              Adds;
+
+	if (NextRandom( Seed ) % 8 == 0)
+		Target.SetType( NextRandom( Seed ) % 4 );
+
+	FieldCount = Base.GetFieldCount( );
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < FieldCount; i += 1)
+	{
+		std::string                   Label;
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+		unsigned long                 Action;
+
+		if ((!Base.GetFieldName( i, Label )) ||
+		    (!Base.GetFieldType( i, FieldType )))
+		{
+			throw std::runtime_error( "Failed to retrieve field." );
+		}
+
+		Action = NextRandom( Seed ) % 8;
+
+		if (Action == 0)
+		{
+			Target.DeleteField( Label.c_str( ) );
+		}
+		else if (Action == 1)
+		{
+			Target.DeleteField( Label.c_str( ) );
+			SetRandomField( Target, Label.c_str( ), Seed, Depth );
+		}
+		else if ((Action <= 3) && (FieldType == GffFileReader::GFF_STRUCT))
+		{
+			GffFileReader::GffStruct BaseChild;
+			GffFileWriter::GffStruct TargetChild;
+
+			if (!Base.GetStructByIndex( i, BaseChild ))
+				throw std::runtime_error( "Failed to retrieve structure by index." );
+
+			TargetChild = Target.CreateStruct( Label.c_str( ) );
+
+			MutateStruct( BaseChild, TargetChild, Seed, Depth + 1 );
+		}
+		else if ((Action <= 3) && (FieldType == GffFileReader::GFF_LIST))
+		{
+			MutateList( Base, i, Target, Label.c_str( ), Seed, Depth );
+		}
+	}
+
+	Adds = NextRandom( Seed ) % 3;
+
+	for (unsigned long i = 0; i < Adds; i += 1)
+	{
+		char                          Label[ 17 ];
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+
+		MakeLabel( NextRandom( Seed ) % 24, Label, sizeof( Label ) );
+
+		if (Target.GetFieldType( Label, FieldType ))
+			continue;
+
+		SetRandomField( Target, Label, Seed, Depth );
+	}
+}
+
+bool
+FindField(
+	__in const GffFileReader::GffStruct & Struct,
+	__in const std::string & Label,
+	__out GffFileReader::FIELD_INDEX & FieldIndex
+	)
+/*++
+
+Routine Description:
+
+	This routine locates a field of a structure by label.
+
+Arguments:
+
+	Struct - Supplies the structure to search.
+
+	Label - Supplies the label of the field.
+
+	FieldIndex - Receives the field index of the field.
+
+Return Value:
+
+	The routine returns true if the field was found, else false.  On failure,
+	an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileReader::FIELD_INDEX FieldCount;
+
+	FieldCount = Struct.GetFieldCount( );
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < FieldCount; i += 1)
+	{
+		std::string FieldLabel;
+
+		if (!Struct.GetFieldName( i, FieldLabel ))
+			throw std::runtime_error( "Failed to retrieve field." );
+
+		if (FieldLabel == Label)
+		{
+			FieldIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+CompareStructs(
+	__in const GffFileReader::GffStruct & Left,
+	__in const GffFileReader::GffStruct & Right,
+	__in const std::string & Path,
+	__out std::string & Difference
+	)
+/*++
+
+Routine Description:
+
+	This routine compares two structures field by field, without regard to
+	the order of fields, and without using the patch engine's hashes.
+
+Arguments:
+
+	Left - Supplies the first structure.
+
+	Right - Supplies the second structure.
+
+	Path - Supplies the path of the structures, for reporting differences.
+
+	Difference - Receives a description of the first difference found.
+
+Return Value:
+
+	The routine returns true if the structures have the same contents, else
+	false.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileReader::FIELD_INDEX FieldCount;
+
+	if (Left.GetType( ) != Right.GetType( ))
+	{
+		Difference = Path + " has a different structure type";
+		return false;
+	}
+
+	FieldCount = Left.GetFieldCount( );
+
+	if (FieldCount != Right.GetFieldCount( ))
+	{
+		Difference = Path + " has a different field count";
+		return false;
+	}
+
+	//
+	// The field counts match, so if every left field is found on the right,
+	// both structures have the same set of labels.
+	//
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < FieldCount; i += 1)
+	{
+		std::string                   Label;
+		std::string                   RightLabel;
+		std::string                   FieldPath;
+		GffFileReader::FIELD_INDEX    RightIndex;
+		GffFileReader::GFF_FIELD_TYPE LeftType;
+		GffFileReader::GFF_FIELD_TYPE RightType;
+
+		if ((!Left.GetFieldName( i, Label )) ||
+		    (!Left.GetFieldType( i, LeftType )))
+		{
+			throw std::runtime_error( "Failed to retrieve field." );
+		}
+
+		FieldPath = Path + "." + Label;
+
+		if ((!FindField( Right, Label, RightIndex )) ||
+		    (!Right.GetFieldType( RightIndex, RightType )))
+		{
+			Difference = FieldPath + " is missing";
+			return false;
+		}
+
+		if (LeftType != RightType)
+		{
+			Difference = FieldPath + " has a different type";
+			return false;
+		}
+
+		if (LeftType == GffFileReader::GFF_STRUCT)
+		{
+			GffFileReader::GffStruct LeftChild;
+			GffFileReader::GffStruct RightChild;
+
+			if ((!Left.GetStructByIndex( i, LeftChild )) ||
+			    (!Right.GetStructByIndex( RightIndex, RightChild )))
+			{
+				throw std::runtime_error( "Failed to retrieve structure by index." );
+			}
+
+			if (!CompareStructs( LeftChild, RightChild, FieldPath, Difference ))
+				return false;
+		}
+		else if (LeftType == GffFileReader::GFF_LIST)
+		{
+			for (size_t j = 0; ; j += 1)
+			{
+				GffFileReader::GffStruct LeftElement;
+				GffFileReader::GffStruct RightElement;
+				bool                     LeftPresent;
+				bool                     RightPresent;
+				char                     Index[ 32 ];
+
+				LeftPresent  = Left.GetListElementByIndex( i, j, LeftElement );
+				RightPresent = Right.GetListElementByIndex( RightIndex, j, RightElement );
+
+				if (LeftPresent != RightPresent)
+				{
+					Difference = FieldPath + " has a different element count";
+					return false;
+				}
+
+				if (!LeftPresent)
+					break;
+
+				StringCbPrintfA( Index, sizeof( Index ), "[%lu]", (unsigned long) j );
+
+				if (!CompareStructs( LeftElement, RightElement, FieldPath + Index, Difference ))
+					return false;
+			}
+		}
+		else
+		{
+			ByteVec LeftData;
+			ByteVec RightData;
+			bool    LeftComplex;
+			bool    RightComplex;
+
+			if ((!Left.GetFieldRawData( i, LeftData, Label, LeftType, LeftComplex )) ||
+			    (!Right.GetFieldRawData( RightIndex, RightData, RightLabel, RightType, RightComplex )))
+			{
+				throw std::runtime_error( "Failed to retrieve field data." );
+			}
+
+			if (LeftData != RightData)
+			{
+				Difference = FieldPath + " has different data";
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool
+IsPatchRejected(
+	__in const GffFileReader & Base,
+	__in const GffPatch::PatchData & Patch
+	)
+/*++
+
+Routine Description:
+
+	This routine applies a patch that is expected to be rejected.
+
+Arguments:
+
+	Base - Supplies the file to apply the patch to.
+
+	Patch - Supplies the patch.
+
+Return Value:
+
+	The routine returns true if ApplyPatch raised an std::exception, else
+	false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileWriter Writer;
+
+	try
+	{
+		GffPatch::ApplyPatch( Base, Patch, Writer );
+	}
+	catch (std::exception)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+void
+CheckRejections(
+	__in const GffFileReader & Base,
+	__in const GffFileReader & Target,
+	__in const GffPatch::PatchData & Patch,
+	__in bool Changed,
+	__in const char * Description,
+	__inout unsigned long & Seed,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks that a patch is rejected when it is applied to the
+	wrong file, or after it is truncated or damaged, and that patches with
+	random bytes overwritten are either rejected or applied cleanly.
+
+Arguments:
+
+	Base - Supplies the base file of the patch.
+
+	Target - Supplies the target file of the patch.
+
+	Patch - Supplies the patch.
+
+	Changed - Supplies a Boolean value that indicates whether the base and
+	          target files differ.
+
+	Description - Supplies the description of the files being checked.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	static const char * const DamageNames[ 5 ] =
+	{
+		"trailing data",
+		"a bad signature",
+		"a bad version",
+		"a bad base hash",
+		"an invalid operation"
+	};
+
+	GffPatch::PatchData Damaged;
+	size_t              Step;
+	char                Problem[ 128 ];
+
+	//
+	// A patch between different files must not apply to its target file.
+	//
+
+	if (Changed)
+	{
+		if (IsPatchRejected( Target, Patch ))
+			Stats.Rejected += 1;
+		else
+			ReportMismatch( Stats, Description, "Patch applied to the wrong base file." );
+	}
+
+	//
+	// Every truncation of the patch must be rejected.  Long patches are
+	// truncated at evenly spaced lengths only.
+	//
+
+	Step = Patch.size( ) / 128 + 1;
+
+	for (size_t Length = 0; Length < Patch.size( ); Length += Step)
+	{
+		Damaged.assign( Patch.begin( ), Patch.begin( ) + Length );
+
+		if (IsPatchRejected( Base, Damaged ))
+		{
+			Stats.Rejected += 1;
+			continue;
+		}
+
+		StringCbPrintfA(
+			Problem,
+			sizeof( Problem ),
+			"Patch truncated to %lu of %lu bytes was applied.",
+			(unsigned long) Length,
+			(unsigned long) Patch.size( ));
+
+		ReportMismatch( Stats, Description, Problem );
+	}
+
+	//
+	// Trailing data, a bad signature, a bad version, a bad base hash and an
+	// invalid first operation must each be rejected.
+	//
+
+	for (unsigned long Damage = 0; Damage < 5; Damage += 1)
+	{
+		Damaged = Patch;
+
+		switch (Damage)
+		{
+
+		case 0:
+			Damaged.push_back( 0 );
+			break;
+
+		case 1:
+			Damaged[ 0 ] = (unsigned char) (Damaged[ 0 ] + 1);
+			break;
+
+		case 2:
+			Damaged[ 4 ] = (unsigned char) (Damaged[ 4 ] + 1);
+			break;
+
+		case 3:
+			Damaged[ 8 ] = (unsigned char) (Damaged[ 8 ] + 1);
+			break;
+
+		case 4:
+			Damaged[ EMPTY_PATCH_SIZE - 1 ] = 0xFF;
+			break;
+
+		}
+
+		if (IsPatchRejected( Base, Damaged ))
+		{
+			Stats.Rejected += 1;
+			continue;
+		}
+
+		StringCbPrintfA(
+			Problem,
+			sizeof( Problem ),
+			"Patch with %s was applied.",
+			DamageNames[ Damage ]);
+
+		ReportMismatch( Stats, Description, Problem );
+	}
+
+	//
+	// A patch with random bytes of its operations overwritten may still be a
+	// valid patch, but must either be rejected or produce a file that can be
+	// written and read back.
+	//
+
+	if (Patch.size( ) <= EMPTY_PATCH_SIZE)
+		return;
+
+	for (unsigned long i = 0; i < CORRUPT_PATCH_COUNT; i += 1)
+	{
+		GffFileWriter Writer;
+		ByteVec       AppliedData;
+		size_t        Offset;
+
+		Damaged = Patch;
+		Offset  = (EMPTY_PATCH_SIZE - 1) + NextRandom( Seed ) % (Patch.size( ) - (EMPTY_PATCH_SIZE - 1));
+
+		Damaged[ Offset ] = (unsigned char) NextRandom( Seed );
+
+		try
+		{
+			GffPatch::ApplyPatch( Base, Damaged, Writer );
+		}
+		catch (std::exception)
+		{
+			Stats.Rejected += 1;
+			continue;
+		}
+
+		try
+		{
+			CommitFile( Writer, AppliedData );
+
+			GffFileReader Applied( &AppliedData[ 0 ], AppliedData.size( ), Base.GetResourceManager( ) );
+
+			GffPatch::HashFile( Applied );
+		}
+		catch (std::exception &e)
+		{
+			StringCbPrintfA(
+				Problem,
+				sizeof( Problem ),
+				"Damaged patch produced a bad file (%s).",
+				e.what( ));
+
+			ReportMismatch( Stats, Description, Problem );
+			continue;
+		}
+
+		Stats.CorruptApplied += 1;
+	}
+}
+
+void
+CheckPatch(
+	__in const GffFileReader & Base,
+	__in const GffFileReader & Target,
+	__in const char * Description,
+	__in_opt const PATCH_CASE * Expected,
+	__inout unsigned long & Seed,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine creates the patch between two files, applies it to the base
+	file, and checks that the result matches the target file.  The patch is
+	then checked to be rejected when misapplied or damaged.
+
+Arguments:
+
+	Base - Supplies the base file.
+
+	Target - Supplies the target file.
+
+	Description - Supplies the description of the files being checked.
+
+	Expected - Optionally supplies the directed case whose patch counters the
+	           patch must have.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffPatch::PatchData  Patch;
+	GffPatch::PatchStats PatchStats;
+	GffFileWriter        Writer;
+	ByteVec              AppliedData;
+	std::string          Difference;
+	bool                 Same;
+	bool                 Changed;
+	ULONGLONG            BaseHash;
+	ULONGLONG            TargetHash;
+	ULONGLONG            AppliedHash;
+	char                 Problem[ 256 ];
+
+	try
+	{
+		Same       = CompareStructs( *Base.GetRootStruct( ), *Target.GetRootStruct( ), "Root", Difference );
+		Changed    = GffPatch::CreatePatch( Base, Target, Patch, &PatchStats );
+		BaseHash   = GffPatch::HashFile( Base );
+		TargetHash = GffPatch::HashFile( Target );
+
+		Stats.Patches    += 1;
+		Stats.PatchBytes += Patch.size( );
+
+		if (Changed)
+			Stats.Changed += 1;
+
+		Stats.Totals.StructsCompared += PatchStats.StructsCompared;
+		Stats.Totals.FieldsAdded     += PatchStats.FieldsAdded;
+		Stats.Totals.FieldsRemoved   += PatchStats.FieldsRemoved;
+		Stats.Totals.FieldsChanged   += PatchStats.FieldsChanged;
+		Stats.Totals.ElementsAdded   += PatchStats.ElementsAdded;
+		Stats.Totals.ElementsRemoved += PatchStats.ElementsRemoved;
+		Stats.Totals.ElementsMoved   += PatchStats.ElementsMoved;
+		Stats.Totals.ElementsChanged += PatchStats.ElementsChanged;
+
+		if (Changed == Same)
+		{
+			ReportMismatch(
+				Stats,
+				Description,
+				Same ? "Patch of equal files has edits." : "Patch of different files has no edits.");
+		}
+
+		if ((Changed != (BaseHash != TargetHash)) ||
+		    (GffPatch::GetTargetHash( Patch ) != TargetHash))
+		{
+			ReportMismatch( Stats, Description, "Patch hashes do not match the files." );
+		}
+
+		if ((!Changed) && (Patch.size( ) != EMPTY_PATCH_SIZE))
+		{
+			StringCbPrintfA(
+				Problem,
+				sizeof( Problem ),
+				"Patch without edits is %lu bytes.",
+				(unsigned long) Patch.size( ));
+
+			ReportMismatch( Stats, Description, Problem );
+		}
+
+		if ((Expected != NULL) &&
+		    ((Changed != Expected->Changed)                          ||
+		     (PatchStats.FieldsAdded != Expected->FieldsAdded)       ||
+		     (PatchStats.FieldsRemoved != Expected->FieldsRemoved)   ||
+		     (PatchStats.FieldsChanged != Expected->FieldsChanged)   ||
+		     (PatchStats.ElementsAdded != Expected->ElementsAdded)   ||
+		     (PatchStats.ElementsRemoved != Expected->ElementsRemoved) ||
+		     (PatchStats.ElementsMoved != Expected->ElementsMoved)   ||
+		     (PatchStats.ElementsChanged != Expected->ElementsChanged)))
+		{
+			StringCbPrintfA(
+				Problem,
+				sizeof( Problem ),
+				"Patch counters are %s, fields +%lu -%lu ~%lu, elements +%lu -%lu >%lu ~%lu.",
+				Changed ? "changed" : "unchanged",
+				PatchStats.FieldsAdded,
+				PatchStats.FieldsRemoved,
+				PatchStats.FieldsChanged,
+				PatchStats.ElementsAdded,
+				PatchStats.ElementsRemoved,
+				PatchStats.ElementsMoved,
+				PatchStats.ElementsChanged);
+
+			ReportMismatch( Stats, Description, Problem );
+		}
+
+		//
+		// Apply the patch, and read the result back.
+		//
+
+		GffPatch::ApplyPatch( Base, Patch, Writer );
+		CommitFile( Writer, AppliedData );
+
+		GffFileReader Applied( &AppliedData[ 0 ], AppliedData.size( ), Base.GetResourceManager( ) );
+
+		AppliedHash = GffPatch::HashFile( Applied );
+
+		if (AppliedHash != GffPatch::GetTargetHash( Patch ))
+		{
+			StringCbPrintfA(
+				Problem,
+				sizeof( Problem ),
+				"Patched file hash %016I64x, expected %016I64x.",
+				AppliedHash,
+				GffPatch::GetTargetHash( Patch ));
+
+			ReportMismatch( Stats, Description, Problem );
+		}
+
+		if (!CompareStructs( *Applied.GetRootStruct( ), *Target.GetRootStruct( ), "Root", Difference ))
+		{
+			StringCbPrintfA(
+				Problem,
+				sizeof( Problem ),
+				"Patched file differs from the target file: %s.",
+				Difference.c_str( ));
+
+			ReportMismatch( Stats, Description, Problem );
+		}
+
+		CheckRejections( Base, Target, Patch, Changed, Description, Seed, Stats );
+	}
+	catch (std::exception &e)
+	{
+		StringCbPrintfA(
+			Problem,
+			sizeof( Problem ),
+			"Exception '%s'.",
+			e.what( ));
+
+		ReportMismatch( Stats, Description, Problem );
+	}
+}
+
+void
+BuildCaseBase(
+	__inout GffFileWriter::GffStruct & Root,
+	__in bool Reversed
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the base file of the directed cases.
+
+Arguments:
+
+	Root - Supplies the empty root structure to fill.
+
+	Reversed - Supplies a Boolean value that indicates whether the fields are
+	           added in reverse order.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (int Step = 0; Step < 6; Step += 1)
+	{
+		switch (Reversed ? 5 - Step : Step)
+		{
+
+		case 0:
+			Root.SetCExoString( "Name", "base" );
+			break;
+
+		case 1:
+			Root.SetBYTE( "Level", 3 );
+			break;
+
+		case 2:
+			Root.SetDWORD( "Gold", 100 );
+			break;
+
+		case 3:
+			Root.SetResRef( "Tag", std::string( "base_tag" ) );
+			break;
+
+		case 4:
+			{
+				GffFileWriter::GffStruct Outer = Root.CreateStruct( "Outer", 1 );
+				GffFileWriter::GffStruct Inner;
+
+				if (Reversed)
+				{
+					Inner = Outer.CreateStruct( "Inner", 2 );
+					Inner.SetCExoString( "Note", "inner" );
+					Inner.SetFLOAT( "Value", 1.5f );
+					Outer.SetINT( "Count", 1 );
+				}
+				else
+				{
+					Outer.SetINT( "Count", 1 );
+					Inner = Outer.CreateStruct( "Inner", 2 );
+					Inner.SetFLOAT( "Value", 1.5f );
+					Inner.SetCExoString( "Note", "inner" );
+				}
+			}
+			break;
+
+		case 5:
+			for (unsigned long i = 0; i < 6; i += 1)
+			{
+				GffFileWriter::GffStruct Element = Root.AppendListElement( "Items", 10 + i );
+				char                     Tag[ 32 ];
+
+				StringCbPrintfA( Tag, sizeof( Tag ), "item_%lu", i );
+
+				Element.SetDWORD( "Id", i );
+				Element.SetCExoString( "Tag", Tag );
+			}
+			break;
+
+		}
+	}
+}
+
+void
+EditCase(
+	__in PATCH_CASE_ID Case,
+	__inout GffFileWriter::GffStruct & Root
+	)
+/*++
+
+Routine Description:
+
+	This routine makes the edit of a directed case to a copy of the base
+	file.
+
+Arguments:
+
+	Case - Supplies the directed case.
+
+	Root - Supplies the root structure of the copy of the base file.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileWriter::GffStruct Struct;
+	GffFileWriter::GffStruct Element;
+
+	switch (Case)
+	{
+
+	case CaseIdentical:
+	case CaseFieldOrder:
+		break;
+
+	case CaseFieldAdd:
+		Root.SetDWORD( "Experience", 500 );
+		break;
+
+	case CaseFieldRemove:
+		Root.DeleteField( "Gold" );
+		break;
+
+	case CaseFieldChange:
+		Root.SetDWORD( "Gold", 250 );
+		break;
+
+	case CaseFieldTypeChange:
+		Root.DeleteField( "Level" );
+		Root.SetWORD( "Level", 3 );
+		break;
+
+	case CaseFieldBecomesStruct:
+		Root.DeleteField( "Name" );
+		Root.CreateStruct( "Name" ).SetCExoString( "First", "base" );
+		break;
+
+	case CaseStructType:
+		Root.CreateStruct( "Outer" ).SetType( 5 );
+		break;
+
+	case CaseNestedChange:
+		Root.CreateStruct( "Outer" ).CreateStruct( "Inner" ).SetFLOAT( "Value", 2.5f );
+		break;
+
+	case CaseNestedAddRemove:
+		Struct = Root.CreateStruct( "Outer" ).CreateStruct( "Inner" );
+		Struct.DeleteField( "Note" );
+		Struct.SetINT( "Extra", 7 );
+		break;
+
+	case CaseListInsert:
+		Element = Root.AddListElement( "Items", 2, 99 );
+		Element.SetDWORD( "Id", 99 );
+		Element.SetCExoString( "Tag", "inserted" );
+		break;
+
+	case CaseListRemove:
+		Root.DeleteListElement( "Items", 3 );
+		break;
+
+	case CaseListMove:
+		if (!Root.GetListElement( "Items", 0, Struct ))
+			throw std::runtime_error( "Failed to retrieve list element." );
+
+		Element = Root.AppendListElement( "Items", 10 );
+		Element.InitializeFromStruct( Struct );
+		Root.DeleteListElement( "Items", 0 );
+		break;
+
+	case CaseListReverse:
+		for (size_t i = 0; i < 5; i += 1)
+		{
+			if (!Root.GetListElement( "Items", 4 - i, Struct ))
+				throw std::runtime_error( "Failed to retrieve list element." );
+
+			Element = Root.AppendListElement( "Items", (unsigned long) (14 - i) );
+			Element.InitializeFromStruct( Struct );
+			Root.DeleteListElement( "Items", 4 - i );
+		}
+		break;
+
+	case CaseListChange:
+		if (!Root.GetListElement( "Items", 4, Struct ))
+			throw std::runtime_error( "Failed to retrieve list element." );
+
+		Struct.SetCExoString( "Tag", "changed" );
+		break;
+
+	case CaseListClear:
+		Root.DeleteField( "Items" );
+		Root.CreateList( "Items" );
+		break;
+
+	case CaseListMixed:
+		//
+		// Items 0..5 become 5, 0, 1 (changed), 2, 4, new.  Item 5 moves, and
+		// the changed item and the new item are patched from the unused
+		// items 1 and 3 (one field of item 1, and both fields of item 3).
+		//
+
+		if (!Root.GetListElement( "Items", 1, Struct ))
+			throw std::runtime_error( "Failed to retrieve list element." );
+
+		Struct.SetCExoString( "Tag", "changed" );
+
+		Root.DeleteListElement( "Items", 3 );
+
+		if (!Root.GetListElement( "Items", 4, Struct ))
+			throw std::runtime_error( "Failed to retrieve list element." );
+
+		Element = Root.AddListElement( "Items", 0, 15 );
+		Element.InitializeFromStruct( Struct );
+		Root.DeleteListElement( "Items", 5 );
+
+		Element = Root.AppendListElement( "Items", 20 );
+		Element.SetDWORD( "Id", 20 );
+		Element.SetCExoString( "Tag", "new" );
+		break;
+
+	}
+}
+
+void
+CheckCases(
+	__in ResourceManager & ResMan,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the patch of each directed case, in both directions.
+
+Arguments:
+
+	ResMan - Supplies the resource manager instance used by GFF readers.
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileWriter            BaseWriter;
+	GffFileWriter::GffStruct Root;
+	ByteVec                  BaseData;
+	unsigned long            Seed;
+
+	Root = BaseWriter.GetRootStruct( );
+
+	BuildCaseBase( Root, false );
+	CommitFile( BaseWriter, BaseData );
+
+	GffFileReader Base( &BaseData[ 0 ], BaseData.size( ), ResMan );
+
+	Seed = 1;
+
+	for (int i = 0; i < LastPatchCase; i += 1)
+	{
+		GffFileWriter TargetWriter;
+		ByteVec       TargetData;
+		char          Description[ 64 ];
+
+		Root = TargetWriter.GetRootStruct( );
+
+		BuildCaseBase( Root, i == CaseFieldOrder );
+		EditCase( (PATCH_CASE_ID) i, Root );
+		CommitFile( TargetWriter, TargetData );
+
+		GffFileReader Target( &TargetData[ 0 ], TargetData.size( ), ResMan );
+
+		CheckPatch( Base, Target, PatchCases[ i ].Name, &PatchCases[ i ], Seed, Stats );
+
+		StringCbPrintfA( Description, sizeof( Description ), "%s (reverse)", PatchCases[ i ].Name );
+
+		CheckPatch( Target, Base, Description, NULL, Seed, Stats );
+	}
+}
+
+void
+CheckRandomEdits(
+	__in const GffFileReader & Base,
+	__in const char * Name,
+	__in unsigned long Count,
+	__inout unsigned long & Seed,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the patches between a file and random edits of it,
+	in both directions.
+
+Arguments:
+
+	Base - Supplies the file to edit.
+
+	Name - Supplies the name of the file, for reporting mismatches.
+
+	Count - Supplies the count of random edits to check.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		GffFileWriter            TargetWriter;
+		GffFileWriter::GffStruct Root;
+		ByteVec                  TargetData;
+		char                     Description[ MAX_PATH + 64 ];
+
+		TargetWriter.InitializeFromReader( &Base );
+
+		Root = TargetWriter.GetRootStruct( );
+
+		MutateStruct( *Base.GetRootStruct( ), Root, Seed, 0 );
+		CommitFile( TargetWriter, TargetData );
+
+		GffFileReader Target( &TargetData[ 0 ], TargetData.size( ), Base.GetResourceManager( ) );
+
+		StringCbPrintfA( Description, sizeof( Description ), "%s, edit %lu", Name, i );
+
+		CheckPatch( Base, Target, Description, NULL, Seed, Stats );
+
+		StringCbPrintfA( Description, sizeof( Description ), "%s, edit %lu (reverse)", Name, i );
+
+		CheckPatch( Target, Base, Description, NULL, Seed, Stats );
+	}
+}
+
+void
+CheckGenerated(
+	__in ResourceManager & ResMan,
+	__in unsigned long Count,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the patches between randomly generated files and
+	random edits of them, and checks that every kind of edit was covered.
+
+Arguments:
+
+	ResMan - Supplies the resource manager instance used by GFF readers.
+
+	Count - Supplies the count of files to generate.
+
+	Stats - Supplies the results of the group of checks, which are updated.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Seed;
+
+	Seed = 1;
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		GffFileWriter            BaseWriter;
+		GffFileWriter::GffStruct Root;
+		ByteVec                  BaseData;
+		char                     Name[ 64 ];
+
+		Root = BaseWriter.GetRootStruct( );
+
+		BuildRandomStruct( Root, Seed, 0 );
+		CommitFile( BaseWriter, BaseData );
+
+		GffFileReader Base( &BaseData[ 0 ], BaseData.size( ), ResMan );
+
+		StringCbPrintfA( Name, sizeof( Name ), "generated file %lu", i );
+
+		CheckRandomEdits( Base, Name, 4, Seed, Stats );
+	}
+
+	if ((Count != 0) &&
+	    ((Stats.Totals.FieldsAdded == 0)     ||
+	     (Stats.Totals.FieldsRemoved == 0)   ||
+	     (Stats.Totals.FieldsChanged == 0)   ||
+	     (Stats.Totals.ElementsAdded == 0)   ||
+	     (Stats.Totals.ElementsRemoved == 0) ||
+	     (Stats.Totals.ElementsMoved == 0)   ||
+	     (Stats.Totals.ElementsChanged == 0)))
+	{
+		ReportMismatch( Stats, "generated files", "Random edits did not cover every kind of edit." );
+	}
+}
+
+void
+PrintStats(
+	__in const char * Name,
+	__in const CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine prints the results of a group of checks.
+
+Arguments:
+
+	Name - Supplies the name of the group.
+
+	Stats - Supplies the results of the group of checks.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"  %-16s %6lu patches (%6lu with edits, %8.1f KB), fields +%lu -%lu ~%lu, elements +%lu -%lu >%lu ~%lu\n"
+		"  %-16s %6lu damaged patches rejected, %lu applied, %lu mismatches\n",
+		Name,
+		Stats.Patches,
+		Stats.Changed,
+		(double) Stats.PatchBytes / 1024.0,
+		Stats.Totals.FieldsAdded,
+		Stats.Totals.FieldsRemoved,
+		Stats.Totals.FieldsChanged,
+		Stats.Totals.ElementsAdded,
+		Stats.Totals.ElementsRemoved,
+		Stats.Totals.ElementsMoved,
+		Stats.Totals.ElementsChanged,
+		"",
+		Stats.Rejected,
+		Stats.CorruptApplied,
+		Stats.Mismatches);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"GffPatchTest\n"
+		"\n"
+		"This program checks that GFF patches reproduce the target file when applied\n"
+		"to the base file, for directed cases, for random edits of generated files\n"
+		"and for random edits of the given GFF files, and that misapplied, truncated\n"
+		"or damaged patches are rejected.\n"
+		"\n"
+		"Usage: GffPatchTest [-count <generated files>] [-edits <edits per file>]\n"
+		"                    [file.gff ...]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the GFF patch test program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long               Count;
+	unsigned long               Edits;
+	unsigned long               Seed;
+	std::vector< const char * > Files;
+	CHECK_STATS                 CaseStats;
+	CHECK_STATS                 GeneratedStats;
+	CHECK_STATS                 FileStats;
+	unsigned long               Mismatches;
+	PrintfTextOut               TextOut;
+
+	Count = 200;
+	Edits = 16;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-count" )) && (i + 1 < argc))
+			Count = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-edits" )) && (i + 1 < argc))
+			Edits = strtoul( argv[ ++i ], NULL, 10 );
+		else if (argv[ i ][ 0 ] == '-')
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+		else
+			Files.push_back( argv[ i ] );
+	}
+
+	ZeroMemory( &CaseStats, sizeof( CaseStats ) );
+	ZeroMemory( &GeneratedStats, sizeof( GeneratedStats ) );
+	ZeroMemory( &FileStats, sizeof( FileStats ) );
+
+	try
+	{
+		ResourceManager ResMan( &TextOut );
+
+		CheckCases( ResMan, CaseStats );
+		CheckGenerated( ResMan, Count, GeneratedStats );
+
+		Seed = 1;
+
+		for (size_t i = 0; i < Files.size( ); i += 1)
+		{
+			GffFileReader Base( Files[ i ], ResMan );
+
+			CheckRandomEdits( Base, Files[ i ], Edits, Seed, FileStats );
+		}
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	Mismatches = CaseStats.Mismatches      +
+	             GeneratedStats.Mismatches +
+	             FileStats.Mismatches;
+
+	printf( "GFF patch round trips (CreatePatch -> ApplyPatch):\n" );
+
+	PrintStats( "directed cases", CaseStats );
+	PrintStats( "generated files", GeneratedStats );
+
+	if (!Files.empty( ))
+		PrintStats( "named files", FileStats );
+
+	printf( "%lu mismatches.\n", Mismatches );
+
+	return (Mismatches == 0) ? 0 : 1;
+}
@@ -16,6 +16,7 @@ Abstract:
 #include "Precomp.h"
 #include "../NWN2DataLib/TextOut.h"
 #include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
 
 //
 // Define the debug text output interface, used to write debug or log messages
@@ -199,26 +200,51 @@ Environment:
 		Description.c_str( ));
 }
 
+//
+// Define the resource types that are located for each area.  Areas are
+// comprised of an <area>.are with area parameters, an <area>.git with the
+// object instance parameters about objects that have been placed in the area
+// via the toolset, and an <area>.trx with the area terrain and walkmesh.
+//
+
+static const NWN::ResType AreaScanTypes[ ] =
+{
+	NWN::ResARE,
+	NWN::ResGIT,
+	NWN::ResTRX
+};
+
+//
+// Define the module scan visitor that prints information about each area.
+//
+
+class AreaInformationVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+};
+
 void
-ShowAreaInformation(
-	__in const NWN::ResRef32 & AreaResRef,
-	__in ResourceManager & ResMan,
-	__in IDebugTextOut * TextOut
+AreaInformationVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
 	)
 /*++
 
 Routine Description:
 
 	This routine prints information about an area to the text output console.
+	It is called on a module scan worker thread.
 
 Arguments:
 
-	AreaResRef - Supplies the resource name of the area to display.
-
-	ResMan - Supplies a reference to the resource manager instance to use in
-	         order to load any associated resource data.
-
-	TextOut - Supplies the text output interface.
+	Context - Supplies the scan context, which describes the area to display.
 
 Return Value:
 
@@ -226,32 +252,25 @@ Return Value:
 
 Environment:
 
-	User mode.
+	User mode, module scan worker thread.
 
 --*/
 {
-	//
-	// Areas are comprised of two files, an <area>.are with area parameters,
-	// and an <area>.git with the object instance parameters about objects that
-	// have been placed in the area via the toolset.
-	//
-
-	DemandResource32                 AreFile( ResMan, AreaResRef, NWN::ResARE );
-	DemandResource32                 GitFile( ResMan, AreaResRef, NWN::ResGIT );
-	GffFileReader                    Are( AreFile, ResMan );
-	GffFileReader                    Git( GitFile, ResMan );
+	ResourceManager                & ResMan  = Context.GetResourceManager( );
+	IDebugTextOut                  * TextOut = Context.GetTextOut( );
 	const GffFileReader::GffStruct * RootStruct;
 	std::string                      AreaName;
 	std::string                      AreaTag;
 
-	RootStruct = Are.GetRootStruct( );
+	RootStruct = Context.GetGffReader( NWN::ResARE )->GetRootStruct( );
 
 	//
-	// Acquire parameters we need from area.git.
+	// Acquire parameters we need from area.are.
 	//
 
 	if (!RootStruct->GetCExoLocString( "Name", AreaName ))
 		throw std::runtime_error( "Failed to read area Name" );
+
 	if (!RootStruct->GetCExoString( "Tag", AreaTag ))
 		throw std::runtime_error( "Failed to read area Tag" );
 	
@@ -260,11 +279,25 @@ Environment:
 		AreaName.c_str( ),
 		AreaTag.c_str( ));
 
+	//
+	// Show the area dimensions if the area has terrain data.
+	//
+
+	if (!Context.GetFileName( NWN::ResTRX ).empty( ))
+	{
+		TrxFileReader * Trx = Context.GetTrxReader( NWN::ResTRX, true );
+
+		TextOut->WriteText(
+			"Area dimensions: %lu x %lu tiles\n",
+			Trx->GetWidth( ),
+			Trx->GetHeight( ));
+	}
+
 	//
 	// Now show instance information about various objects in the area.
 	//
 
-	RootStruct = Git.GetRootStruct( );
+	RootStruct = Context.GetGffReader( NWN::ResGIT )->GetRootStruct( );
 
 	for (size_t i = 0; i <= ULONG_MAX; i += 1)
 	{
@@ -309,6 +342,7 @@ Environment:
 	const char * ModuleName;
 	const char * NWN2Home;
 	const char * InstallDir;
+	ULONG        MaxThreads;
 
 	//
 	// First, check that we've got the necessary arguments.
@@ -317,7 +351,7 @@ Environment:
 	if (argc < 4)
 	{
 		wprintf(
-			L"Usage: %S <module> <nwn2 home directory> <nwn2 install directory>\n",
+			L"Usage: %S <module> <nwn2 home directory> <nwn2 install directory> [worker thread count]\n",
 			argv[ 0 ] );
 
 		return 0;
@@ -326,6 +360,7 @@ Environment:
 	ModuleName = argv[ 1 ];
 	NWN2Home   = argv[ 2 ];
 	InstallDir = argv[ 3 ];
+	MaxThreads = (argc > 4) ? strtoul( argv[ 4 ], NULL, 10 ) : 0;
 
 	//
 	// Now spin up a resource manager instance.
@@ -363,30 +398,32 @@ Environment:
 		GffFileReader                    ModuleIfo( ModuleIfoFile, ResMan );
 		const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
 		std::string                      ModName;
-		GffFileReader::GffStruct         Struct;
+		ModuleScan                       Scan( ResMan, &TextOut );
+		AreaInformationVisitor           Visitor;
 
 		if (RootStruct->GetCExoLocString( "Mod_Name", ModName ))
 			TextOut.WriteText( "The module name is: %s.\n", ModName.c_str( ) );
 
 		//
-		// Now look at each area.
+		// Now look at each area.  The areas are scanned in parallel, but the
+		// information for each area is printed in module order.
 		//
 
-		for (size_t i = 0; i <= ULONG_MAX; i += 1)
-		{
-			NWN::ResRef32 AreaResRef;
-
-			if (!RootStruct->GetListElement( "Mod_Area_list", i, Struct ))
-				break;
-
-			if (!Struct.GetResRef( "Area_Name", AreaResRef ))
-				throw std::runtime_error( "Mod_Area_list element is missing Area_Name." );
+		Scan.SetScanTypes( AreaScanTypes, RTL_NUMBER_OF( AreaScanTypes ) );
+		Scan.AddModuleAreas( );
+		Scan.Scan( &Visitor, MaxThreads );
 
-			//
-			// Show information about this area.
-			//
-
-			ShowAreaInformation( AreaResRef, ResMan, &TextOut );
+		{
+			const ModuleScan::ScanStats & Stats = Scan.GetStats( );
+
+			TextOut.WriteText(
+				"Scanned %lu area(s) (%lu failed) on %lu thread(s) in %lums (%lums locating resources, %lums reading areas).\n",
+				Stats.Items,
+				Stats.FailedItems,
+				Stats.Threads,
+				Stats.PrepareTime + Stats.VisitTime,
+				Stats.PrepareTime,
+				Stats.VisitTime);
 		}
 	}
 	catch (std::exception &e)
@@ -16,6 +16,7 @@ Abstract:
 #include "Precomp.h"
 #include "../NWN2DataLib/TextOut.h"
 #include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
 
 //
 // Define the debug text output interface, used to write debug or log messages
@@ -133,115 +134,51 @@ public:
 
 };
 
+//
+// Define the module scan visitor that lists each model.
+//
+
+class ModelListVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+};
+
 void
-LoadModule(
-	__in ResourceManager & ResMan,
-	__in const char * ModuleName,
-	__in const char * NWN2Home,
-	__in const char * InstallDir
+ModelListVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
 	)
 /*++
 
 Routine Description:
 
-	This routine performs a full load of a module, including the TLK file and
-	any dependent HAKs.
+	This routine prints the name of a model to the text output console.  It is
+	called on a module scan worker thread.
 
 Arguments:
 
-	ResMan - Supplies the ResourceManager instance that is to load the module.
-
-	ModuleName - Supplies the resource name of the module to load.
-
-	NWN2Home - Supplies the users NWN2 home directory (i.e. NWN2 Documents dir).
-
-	InstallDir - Supplies the game installation directory.
+	Context - Supplies the scan context, which describes the model to list.
 
 Return Value:
 
-	None.  On failure, an std::exception is raised.
+	None.  An std::exception is raised on failure.
 
 Environment:
 
-	User mode.
+	User mode, module scan worker thread.
 
 --*/
 {
-
-	std::vector< NWN::ResRef32 > HAKList;
-	std::string                  CustomTlk;
-
-	//
-	// Load up the module.  First, we load just the core module resources, then
-	// we determine the HAK list and load all of the HAKs up too.
-	//
-
-	ResMan.LoadModuleResourcesLite(
-		ModuleName,
-		NWN2Home,
-		InstallDir);
-
-	{
-		DemandResourceStr                ModuleIfoFile( ResMan, "module", NWN::ResIFO );
-		GffFileReader                    ModuleIfo( ModuleIfoFile, ResMan );
-		const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
-		GffFileReader::GffStruct         Struct;
-		size_t                           Offset;
-
-		RootStruct->GetCExoString( "Mod_CustomTlk", CustomTlk );
-
-		//
-		// Chop off the .tlk extension in the CustomTlk field if we had one.
-		//
-
-		if ((Offset = CustomTlk.rfind( '.' )) != std::string::npos)
-			CustomTlk.erase( Offset );
-
-		for (size_t i = 0; i <= UCHAR_MAX; i += 1)
-		{
-			GffFileReader::GffStruct Hak;
-			NWN::ResRef32            HakRef;
-
-			if (!RootStruct->GetListElement( "Mod_HakList", i, Hak ))
-				break;
-
-			if (!Hak.GetCExoStringAsResRef( "Mod_Hak", HakRef ))
-				throw std::runtime_error( "Failed to read Mod_HakList.Mod_Hak" );
-
-			HAKList.push_back( HakRef );
-		}
-
-		//
-		// If there were no haks, then try the legacy field.
-		//
-
-		if (HAKList.empty( ))
-		{
-			NWN::ResRef32 HakRef;
-
-			if ((RootStruct->GetCExoStringAsResRef( "Mod_Hak", HakRef )) &&
-				 (HakRef.RefStr[ 0 ] != '\0'))
-			{
-				HAKList.push_back( HakRef );
-			}
-		}
-	}
-
-	//
-	// Now perform a full load with the HAK list and CustomTlk available.
-	//
-	// N.B.  The DemandResourceStr above must go out of scope before we issue a
-	//       new load, as it references a temporary file that will be cleaned up
-	//       by the new load request.
-	//
-
-	ResMan.LoadModuleResources(
-		ModuleName,
-		CustomTlk,
-		NWN2Home,
-		InstallDir,
-		HAKList
-		);
+	Context.GetTextOut( )->WriteText(
+		"%s\n",
+		Context.GetResourceManager( ).StrFromResRef( Context.GetItem( ).ResRef ).c_str( ));
 }
 
 int
@@ -273,10 +210,10 @@ Environment:
 
 --*/
 {
-	const char               * ModuleName;
-	const char               * NWN2Home;
-	const char               * InstallDir;
-	std::set< std::string >    ModuleModels;
+	const char * ModuleName;
+	const char * NWN2Home;
+	const char * InstallDir;
+	ULONG        MaxThreads;
 
 	//
 	// First, check that we've got the necessary arguments.
@@ -285,7 +222,7 @@ Environment:
 	if (argc < 4)
 	{
 		wprintf(
-			L"Usage: %S <module> <nwn2 home directory> <nwn2 install directory>\n",
+			L"Usage: %S <module> <nwn2 home directory> <nwn2 install directory> [worker thread count]\n",
 			argv[ 0 ] );
 
 		return 0;
@@ -294,6 +231,7 @@ Environment:
 	ModuleName = argv[ 1 ];
 	NWN2Home   = argv[ 2 ];
 	InstallDir = argv[ 3 ];
+	MaxThreads = (argc > 4) ? strtoul( argv[ 4 ], NULL, 10 ) : 0;
 
 	//
 	// Now spin up a resource manager instance.
@@ -304,58 +242,37 @@ Environment:
 
 	try
 	{
+		ModuleScan       Scan( ResMan, &TextOut );
+		ModelListVisitor Visitor;
+
 		//
 		// Load the module up all the way, including HAKs.
 		//
 
-		LoadModule(
+		ModuleScan::LoadModule(
 			ResMan,
 			ModuleName,
 			NWN2Home,
 			InstallDir);
 
 		//
-		// Now look at each MDB.
+		// Now list each MDB.  Each distinct RESREF is listed once, in RESREF
+		// order.  We may have multiple references for the same RESREF if the
+		// model is overridden at some level of the resource hierarchy, i.e. if
+		// the model was patched in a later game patch zip file.
 		//
 
-		for (ResourceManager::FileId Id = ResMan.GetEncapsulatedFileCount( );
-		     Id != 0;
-		     Id -= 1)
-		{
-			NWN::ResRef32 ResRef;
-			NWN::ResType  ResType;
-
-			if (!ResMan.GetEncapsulatedFileEntry( (Id - 1), ResRef, ResType ))
-				continue;
-
-			//
-			// Record this MDB uniquely.  We may have multiple references for the
-			// same RESREF if the model is overridden at some level of the
-			// resource hierarchy, i.e. if the model was patched in a later game
-			// patch zip file.
-			//
-			// The first reference we see is the most precedent one, but looking
-			// up by the ResRef and ResType instead of the FileId will always
-			// retrieve the most precedent file.
-			//
-			// N.B.  The resref we receive is guaranteed to be lowercased if a
-			//       well-formed data file set is provided, thus it's not
-			//       necessary to separately lowercase it here.
-			//
-
-			ModuleModels.insert( ResMan.StrFromResRef( ResRef ) );
-		}
+		Scan.AddResourcesOfType( NWN::ResMDB );
+		Scan.Scan( &Visitor, MaxThreads );
 
-		//
-		// Now print out a list of all unique model RESREFS.  Each of these listed
-		// models has a ResType of NWN::ResMDB.
-		//
-
-		for (std::set< std::string >::const_iterator it = ModuleModels.begin( );
-		    it != ModuleModels.end( );
-		    ++it)
 		{
-			TextOut.WriteText( "%s\n", it->c_str( ) );
+			const ModuleScan::ScanStats & Stats = Scan.GetStats( );
+
+			TextOut.WriteText(
+				"Listed %lu model(s) on %lu thread(s) in %lums.\n",
+				Stats.Items,
+				Stats.Threads,
+				Stats.PrepareTime + Stats.VisitTime);
 		}
 	}
 	catch (std::exception &e)
@@ -0,0 +1,1934 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ModuleDependencies.cpp
+
+Abstract:
+
+	This module houses a program that extracts the resource dependency graph
+	of a module.  Starting from module.ifo, the areas of the module, the
+	objects placed in them, their blueprints, conversations, scripts, models
+	and model textures are discovered, and every reference is resolved against
+	the resource manager.
+
+	The graph is built breadth first.  Each level of the graph is parsed in
+	parallel on a module scan, and the references found are merged on the
+	calling thread, where each resource is resolved and queued for parsing
+	only once.
+
+	The program writes the transitive dependencies of each area, the list of
+	references that could not be resolved, and the list of module resources
+	that nothing refers to.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
+#include "../NWN2DataLib/2DAFileReader.h"
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	PrintfTextOut(
+		)
+	{
+		AllocConsole( );
+	}
+
+	inline
+	~PrintfTextOut(
+		)
+	{
+		FreeConsole( );
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine displays text to the log file and the debug console.
+
+		The console output may have color attributes supplied, as per the standard
+		SetConsoleTextAttribute API.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text as per the standard
+					 SetConsoleTextAttribute API (e.g. FOREGROUND_RED).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		HANDLE console = GetStdHandle( STD_OUTPUT_HANDLE );
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+		DWORD n = (DWORD)strlen(buf);
+		SetConsoleTextAttribute( console, Attributes );
+		WriteConsoleA(console, buf, n, &n, 0);
+	}
+
+};
+
+//
+// Define the resource types whose contents are parsed for references.  The
+// remaining resource types of the graph (scripts, textures, sounds and the
+// like) have no dependencies of their own.
+//
+
+static const NWN::ResType ParsedTypes[ ] =
+{
+	NWN::ResIFO,
+	NWN::ResARE,
+	NWN::ResGIT,
+	NWN::ResDLG,
+	NWN::ResUTC,
+	NWN::ResUTD,
+	NWN::ResUTE,
+	NWN::ResUTI,
+	NWN::ResUTM,
+	NWN::ResUTP,
+	NWN::ResUTR,
+	NWN::ResUTS,
+	NWN::ResUTT,
+	NWN::ResUTW,
+	NWN::ResUPE,
+	NWN::ResUSC,
+	NWN::ResMDB
+};
+
+//
+// Define the resource types that are listed in the unused resource report.
+// Only types that a reference can lead to are listed.
+//
+
+static const NWN::ResType TrackedTypes[ ] =
+{
+	NWN::ResARE,
+	NWN::ResGIT,
+	NWN::ResGIC,
+	NWN::ResTRX,
+	NWN::ResTRN,
+	NWN::ResDLG,
+	NWN::ResUTC,
+	NWN::ResUTD,
+	NWN::ResUTE,
+	NWN::ResUTI,
+	NWN::ResUTM,
+	NWN::ResUTP,
+	NWN::ResUTR,
+	NWN::ResUTS,
+	NWN::ResUTT,
+	NWN::ResUTW,
+	NWN::ResUPE,
+	NWN::ResUSC,
+	NWN::ResMDB,
+	NWN::ResNCS,
+	NWN::ResDDS,
+	NWN::ResTGA,
+	NWN::ResWAV,
+	NWN::ResSEF
+};
+
+//
+// Define the object instance lists of an area's .git, and the blueprint type
+// of the objects in each list.
+//
+
+struct InstanceListSpec
+{
+	const char   * ListName;
+	NWN::ResType   TemplateType;
+};
+
+static const InstanceListSpec InstanceLists[ ] =
+{
+	{ "TreeList",         NWN::ResUTR },
+	{ "WaypointList",     NWN::ResUTW },
+	{ "PlacedFXList",     NWN::ResUPE },
+	{ "Placeable List",   NWN::ResUTP },
+	{ "Door List",        NWN::ResUTD },
+	{ "List",             NWN::ResUTI },
+	{ "EnvironmentList",  NWN::ResUTP },
+	{ "Creature List",    NWN::ResUTC },
+	{ "TriggerList",      NWN::ResUTT },
+	{ "SoundList",        NWN::ResUTS },
+	{ "StaticCameraList", NWN::ResUSC },
+	{ "StoreList",        NWN::ResUTM }
+};
+
+//
+// Define the RESREF fields that refer to other resources.  A field matches if
+// its label matches, and the object that contains it is of the given type (or
+// of any type if ResINVALID is given).  Placed objects in a .git have the
+// type of their blueprint.
+//
+
+struct ReferenceFieldSpec
+{
+	NWN::ResType   ObjectType;
+	const char   * FieldName;
+	NWN::ResType   RefType;
+};
+
+static const ReferenceFieldSpec ReferenceFields[ ] =
+{
+	{ NWN::ResIFO,     "Mod_Entry_Area", NWN::ResARE },
+	{ NWN::ResIFO,     "Area_Name",      NWN::ResARE },
+	{ NWN::ResINVALID, "Conversation",   NWN::ResDLG },
+	{ NWN::ResINVALID, "InventoryRes",   NWN::ResUTI },
+	{ NWN::ResINVALID, "EquippedRes",    NWN::ResUTI },
+	{ NWN::ResUTE,     "ResRef",         NWN::ResUTC },
+	{ NWN::ResUTS,     "Sound",          NWN::ResWAV },
+	{ NWN::ResDLG,     "Sound",          NWN::ResWAV },
+	{ NWN::ResDLG,     "Active",         NWN::ResNCS },
+	{ NWN::ResUPE,     "Effect",         NWN::ResSEF }
+};
+
+//
+// Define the label prefixes of RESREF fields that name event scripts, such
+// as OnEnter, ScriptHeartbeat or Mod_OnClientEntr.
+//
+
+static const char * ScriptFieldPrefixes[ ] =
+{
+	"On",
+	"Script",
+	"Mod_On"
+};
+
+//
+// Define the 2DA tables that map the appearance of an object to its model.
+//
+
+struct AppearanceTableSpec
+{
+	NWN::ResType   ObjectType;
+	const char   * TableName;
+	const char   * ModelColumn;
+};
+
+static const AppearanceTableSpec AppearanceTables[ ] =
+{
+	{ NWN::ResUTP, "placeables", "ModelName" },
+	{ NWN::ResUTD, "doortypes",  "Model"     }
+};
+
+typedef swutil::SharedPtr< TwoDAFileReader > TwoDAFileReaderPtr;
+typedef std::vector< TwoDAFileReaderPtr > TwoDAFileReaderVec;
+
+//
+// Define the maximum nesting depth of GFF structures that are searched.
+//
+
+enum { MAX_STRUCT_DEPTH = 32 };
+
+//
+// Define a reference to a resource found while parsing a resource.  If the
+// resource does not exist as RefType, AltType (if valid) is tried.  Optional
+// references that cannot be resolved are dropped instead of being reported.
+//
+
+struct ResourceReference
+{
+	NWN::ResRef32 ResRef;
+	NWN::ResType  RefType;
+	NWN::ResType  AltType;
+	bool          Optional;
+};
+
+typedef std::vector< ResourceReference > ResourceReferenceVec;
+
+//
+// Define the result of parsing one resource.
+//
+
+struct ParseResult
+{
+	ResourceReferenceVec References;
+	std::string          Error;
+};
+
+typedef std::vector< ParseResult > ParseResultVec;
+
+//
+// Define a resource of the dependency graph.
+//
+
+struct DependencyNode
+{
+	NWN::ResRef32         ResRef;
+	NWN::ResType          ResType;
+	bool                  Exists;
+	std::string           ParseError;
+	std::vector< size_t > Dependencies;
+};
+
+typedef std::vector< DependencyNode > DependencyNodeVec;
+typedef std::map< std::string, size_t > NodeIndexMap;
+
+bool
+IsTypeInList(
+	__in NWN::ResType ResType,
+	__in_ecount( NumTypes ) const NWN::ResType * Types,
+	__in size_t NumTypes
+	)
+/*++
+
+Routine Description:
+
+	This routine determines whether a resource type is in a list of types.
+
+Arguments:
+
+	ResType - Supplies the resource type to look up.
+
+	Types - Supplies the list of types.
+
+	NumTypes - Supplies the count of types in the list.
+
+Return Value:
+
+	The routine returns true if the type is in the list, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < NumTypes; i += 1)
+	{
+		if (Types[ i ] == ResType)
+			return true;
+	}
+
+	return false;
+}
+
+std::string
+GetResourceKey(
+	__in ResourceManager & ResMan,
+	__in const NWN::ResRef32 & ResRef,
+	__in NWN::ResType ResType
+	)
+/*++
+
+Routine Description:
+
+	This routine forms the name of a resource, including its extension, which
+	is also used as the key of the resource in the dependency graph.
+
+Arguments:
+
+	ResMan - Supplies the resource manager.
+
+	ResRef - Supplies the resource name.
+
+	ResType - Supplies the resource type.
+
+Return Value:
+
+	The routine returns the lower case resource file name.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string Key;
+
+	Key  = ResMan.StrFromResRef( ResRef );
+	Key += ".";
+	Key += ResourceManager::ResTypeToExt( ResType );
+
+	return Key;
+}
+
+void
+AddReference(
+	__inout ResourceReferenceVec & References,
+	__in const NWN::ResRef32 & ResRef,
+	__in NWN::ResType RefType,
+	__in NWN::ResType AltType,
+	__in bool Optional
+	)
+/*++
+
+Routine Description:
+
+	This routine records a reference to a resource.  Empty resource names are
+	ignored, as they are used by fields that refer to nothing.
+
+Arguments:
+
+	References - Supplies the reference list to append to.
+
+	ResRef - Supplies the name of the referenced resource.
+
+	RefType - Supplies the type of the referenced resource.
+
+	AltType - Supplies the type to try if no resource of RefType exists, or
+	          ResINVALID.
+
+	Optional - Supplies a Boolean value that indicates true if the reference
+	           is dropped, rather than reported, if it cannot be resolved.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	ResourceReference Reference;
+
+	if (ResRef.RefStr[ 0 ] == '\0')
+		return;
+
+	Reference.ResRef   = ResRef;
+	Reference.RefType  = RefType;
+	Reference.AltType  = AltType;
+	Reference.Optional = Optional;
+
+	References.push_back( Reference );
+}
+
+bool
+GetIntegerField(
+	__in const GffFileReader::GffStruct & Struct,
+	__in const char * FieldName,
+	__out size_t & Value
+	)
+/*++
+
+Routine Description:
+
+	This routine reads an unsigned integer field of any width.
+
+Arguments:
+
+	Struct - Supplies the structure that contains the field.
+
+	FieldName - Supplies the label of the field.
+
+	Value - Receives the field value.
+
+Return Value:
+
+	The routine returns true if the field exists and has a non-negative
+	integer value, else false.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	GffFileReader::GFF_FIELD_TYPE FieldType;
+
+	if (!Struct.GetFieldType( FieldName, FieldType ))
+		return false;
+
+	switch (FieldType)
+	{
+
+	case GffFileReader::GFF_BYTE:
+		{
+			unsigned __int8 v;
+
+			if (!Struct.GetBYTE( FieldName, v ))
+				return false;
+
+			Value = v;
+		}
+		return true;
+
+	case GffFileReader::GFF_WORD:
+		{
+			unsigned __int16 v;
+
+			if (!Struct.GetWORD( FieldName, v ))
+				return false;
+
+			Value = v;
+		}
+		return true;
+
+	case GffFileReader::GFF_DWORD:
+		{
+			unsigned __int32 v;
+
+			if (!Struct.GetDWORD( FieldName, v ))
+				return false;
+
+			Value = v;
+		}
+		return true;
+
+	case GffFileReader::GFF_INT:
+		{
+			signed __int32 v;
+
+			if ((!Struct.GetINT( FieldName, v )) || (v < 0))
+				return false;
+
+			Value = (size_t) v;
+		}
+		return true;
+
+	default:
+		return false;
+
+	}
+}
+
+//
+// Define the module scan visitor that collects the references of each
+// resource of one type.
+//
+
+class DependencyVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	inline
+	DependencyVisitor(
+		__in NWN::ResType ResType,
+		__in const TwoDAFileReaderVec & Tables,
+		__inout ParseResultVec & Results
+		)
+	: m_ResType( ResType ),
+	  m_Tables( Tables ),
+	  m_Results( Results )
+	{
+	}
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+private:
+
+	//
+	// Collect the references of a GFF structure and its children.
+	//
+
+	void
+	CollectStructReferences(
+		__in const GffFileReader::GffStruct & Struct,
+		__in NWN::ResType ObjectType,
+		__in size_t Depth,
+		__inout ResourceReferenceVec & References
+		);
+
+	//
+	// Collect the model of an object from its appearance.
+	//
+
+	void
+	CollectModelReference(
+		__in const GffFileReader::GffStruct & Struct,
+		__in NWN::ResType ObjectType,
+		__inout ResourceReferenceVec & References
+		);
+
+	//
+	// Collect the textures of the materials of a model.
+	//
+
+	void
+	CollectMaterialReferences(
+		__in const MODEL_MATERIAL & Material,
+		__inout ResourceReferenceVec & References
+		);
+
+	DependencyVisitor &
+	operator=(
+		__in const DependencyVisitor & other
+		);
+
+	NWN::ResType               m_ResType;
+	const TwoDAFileReaderVec & m_Tables;
+	ParseResultVec           & m_Results;
+
+};
+
+void
+DependencyVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine collects the references of a resource.  A resource that
+	cannot be parsed records the error instead, and contributes no
+	references.
+
+	It is called on a module scan worker thread.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the resource.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	ParseResult & Result = m_Results[ Context.GetItemIndex( ) ];
+
+	try
+	{
+		if (m_ResType == NWN::ResMDB)
+		{
+			const ModelCollider & Model = Context.GetTrxReader( m_ResType, false )->GetCollider( );
+
+			for (ModelCollider::RigidMeshVec::const_iterator it = Model.GetRigidMeshes( ).begin( );
+			     it != Model.GetRigidMeshes( ).end( );
+			     ++it)
+			{
+				CollectMaterialReferences( it->GetHeader( ).Material, Result.References );
+			}
+
+			for (ModelCollider::SkinMeshVec::const_iterator it = Model.GetSkinMeshes( ).begin( );
+			     it != Model.GetSkinMeshes( ).end( );
+			     ++it)
+			{
+				CollectMaterialReferences( it->GetHeader( ).Material, Result.References );
+			}
+
+			return;
+		}
+
+		const GffFileReader::GffStruct * RootStruct = Context.GetGffReader( m_ResType )->GetRootStruct( );
+		const NWN::ResRef32            & ResRef     = Context.GetItem( ).ResRef;
+
+		switch (m_ResType)
+		{
+
+		case NWN::ResARE:
+			//
+			// The instance data and terrain of an area share its name.  Only
+			// the .git is required.
+			//
+
+			AddReference( Result.References, ResRef, NWN::ResGIT, NWN::ResINVALID, false );
+			AddReference( Result.References, ResRef, NWN::ResGIC, NWN::ResINVALID, true );
+			AddReference( Result.References, ResRef, NWN::ResTRX, NWN::ResINVALID, true );
+			AddReference( Result.References, ResRef, NWN::ResTRN, NWN::ResINVALID, true );
+
+			CollectStructReferences( *RootStruct, m_ResType, 0, Result.References );
+			break;
+
+		case NWN::ResGIT:
+			//
+			// Each placed object refers to its blueprint, and otherwise has
+			// the references of an object of the blueprint type.
+			//
+
+			for (size_t l = 0; l < RTL_NUMBER_OF( InstanceLists ); l += 1)
+			{
+				for (size_t i = 0; i <= ULONG_MAX; i += 1)
+				{
+					GffFileReader::GffStruct Instance;
+					NWN::ResRef32            TemplateResRef;
+
+					if (!RootStruct->GetListElement( InstanceLists[ l ].ListName, i, Instance ))
+						break;
+
+					if (Instance.GetResRef( "TemplateResRef", TemplateResRef ))
+					{
+						AddReference(
+							Result.References,
+							TemplateResRef,
+							InstanceLists[ l ].TemplateType,
+							NWN::ResINVALID,
+							false);
+					}
+
+					CollectStructReferences( Instance, InstanceLists[ l ].TemplateType, 0, Result.References );
+				}
+			}
+			break;
+
+		default:
+			CollectStructReferences( *RootStruct, m_ResType, 0, Result.References );
+			break;
+
+		}
+	}
+	catch (std::exception &e)
+	{
+		Result.Error = e.what( );
+	}
+}
+
+void
+DependencyVisitor::CollectStructReferences(
+	__in const GffFileReader::GffStruct & Struct,
+	__in NWN::ResType ObjectType,
+	__in size_t Depth,
+	__inout ResourceReferenceVec & References
+	)
+/*++
+
+Routine Description:
+
+	This routine collects the references made by the fields of a GFF
+	structure, and by the structures and lists that it contains.
+
+	RESREF fields are matched against the reference field table, and against
+	the label prefixes of event script fields.  The appearance of the object
+	itself (at depth zero) selects its model.
+
+Arguments:
+
+	Struct - Supplies the structure to search.
+
+	ObjectType - Supplies the type of the object that contains the structure,
+	             which selects the reference fields that apply.
+
+	Depth - Supplies the nesting depth of the structure within the object.
+
+	References - Supplies the reference list to append to.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	if (Depth > MAX_STRUCT_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	if (Depth == 0)
+		CollectModelReference( Struct, ObjectType, References );
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < Struct.GetFieldCount( ); i += 1)
+	{
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+		std::string                   FieldName;
+
+		if (!Struct.GetFieldType( i, FieldType ))
+			throw std::runtime_error( "Failed to query field type." );
+
+		switch (FieldType)
+		{
+
+		case GffFileReader::GFF_STRUCT:
+			{
+				GffFileReader::GffStruct Child;
+
+				if (!Struct.GetStructByIndex( i, Child ))
+					throw std::runtime_error( "Failed to retrieve structure by index." );
+
+				CollectStructReferences( Child, ObjectType, Depth + 1, References );
+			}
+			break;
+
+		case GffFileReader::GFF_LIST:
+			for (size_t Element = 0; Element <= ULONG_MAX; Element += 1)
+			{
+				GffFileReader::GffStruct Child;
+
+				if (!Struct.GetListElementByIndex( i, Element, Child ))
+					break;
+
+				CollectStructReferences( Child, ObjectType, Depth + 1, References );
+			}
+			break;
+
+		case GffFileReader::GFF_RESREF:
+			{
+				NWN::ResRef32 ResRef;
+				NWN::ResType  RefType;
+
+				if (!Struct.GetFieldName( i, FieldName ))
+					throw std::runtime_error( "Failed to retrieve field label." );
+
+				RefType = NWN::ResINVALID;
+
+				for (size_t f = 0; f < RTL_NUMBER_OF( ReferenceFields ); f += 1)
+				{
+					if (((ReferenceFields[ f ].ObjectType == NWN::ResINVALID) ||
+					     (ReferenceFields[ f ].ObjectType == ObjectType)) &&
+					    (FieldName == ReferenceFields[ f ].FieldName))
+					{
+						RefType = ReferenceFields[ f ].RefType;
+						break;
+					}
+				}
+
+				for (size_t p = 0;
+				     (p < RTL_NUMBER_OF( ScriptFieldPrefixes )) && (RefType == NWN::ResINVALID);
+				     p += 1)
+				{
+					if (!FieldName.compare( 0, strlen( ScriptFieldPrefixes[ p ] ), ScriptFieldPrefixes[ p ] ))
+						RefType = NWN::ResNCS;
+				}
+
+				if (RefType == NWN::ResINVALID)
+					break;
+
+				if (!Struct.GetResRef( FieldName.c_str( ), ResRef ))
+					throw std::runtime_error( "Failed to read RESREF field." );
+
+				AddReference( References, ResRef, RefType, NWN::ResINVALID, false );
+			}
+			break;
+
+		default:
+			break;
+
+		}
+	}
+}
+
+void
+DependencyVisitor::CollectModelReference(
+	__in const GffFileReader::GffStruct & Struct,
+	__in NWN::ResType ObjectType,
+	__inout ResourceReferenceVec & References
+	)
+/*++
+
+Routine Description:
+
+	This routine collects the model of an object whose appearance is looked
+	up in a 2DA table.
+
+Arguments:
+
+	Struct - Supplies the root structure of the object.
+
+	ObjectType - Supplies the type of the object.
+
+	References - Supplies the reference list to append to.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	size_t      Appearance;
+	std::string Model;
+
+	for (size_t t = 0; t < RTL_NUMBER_OF( AppearanceTables ); t += 1)
+	{
+		if (AppearanceTables[ t ].ObjectType != ObjectType)
+			continue;
+
+		if (m_Tables[ t ].get( ) == NULL)
+			continue;
+
+		if (!GetIntegerField( Struct, "Appearance", Appearance ))
+			continue;
+
+		if (!m_Tables[ t ]->Get2DAString( AppearanceTables[ t ].ModelColumn, Appearance, Model ))
+			continue;
+
+		if (Model.size( ) > sizeof( NWN::ResRef32 ))
+			continue;
+
+		AddReference(
+			References,
+			ResourceManager::ResRef32FromStr( Model ),
+			NWN::ResMDB,
+			NWN::ResINVALID,
+			false);
+	}
+}
+
+void
+DependencyVisitor::CollectMaterialReferences(
+	__in const MODEL_MATERIAL & Material,
+	__inout ResourceReferenceVec & References
+	)
+/*++
+
+Routine Description:
+
+	This routine collects the texture maps of a model material.  Textures are
+	resolved as .dds files, falling back to .tga files.
+
+Arguments:
+
+	Material - Supplies the material to search.
+
+	References - Supplies the reference list to append to.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	AddReference( References, Material.DiffuseMap, NWN::ResDDS, NWN::ResTGA, false );
+	AddReference( References, Material.NormalMap, NWN::ResDDS, NWN::ResTGA, false );
+	AddReference( References, Material.TintMap, NWN::ResDDS, NWN::ResTGA, false );
+	AddReference( References, Material.GlowMap, NWN::ResDDS, NWN::ResTGA, false );
+}
+
+//
+// Define the dependency graph of a module.
+//
+
+class DependencyGraph
+{
+
+public:
+
+	inline
+	DependencyGraph(
+		__in ResourceManager & ResMan,
+		__in IDebugTextOut * TextOut
+		)
+	: m_ResourceManager( ResMan ),
+	  m_TextOut( TextOut ),
+	  m_Levels( 0 ),
+	  m_MissingCount( 0 )
+	{
+	}
+
+	//
+	// Build the graph, starting from module.ifo.  An std::exception is raised
+	// on failure.
+	//
+
+	void
+	Build(
+		__in ULONG MaxThreads
+		);
+
+	//
+	// Write the reports of the graph to a directory.  The routine returns
+	// false on failure.
+	//
+
+	bool
+	WriteReports(
+		__in const char * OutputDir
+		);
+
+	inline
+	const DependencyNodeVec &
+	GetNodes(
+		) const
+	{
+		return m_Nodes;
+	}
+
+	inline
+	ULONG
+	GetLevels(
+		) const
+	{
+		return m_Levels;
+	}
+
+	//
+	// Return the count of unresolved references, and of unused module
+	// resources.  Valid once WriteReports has been called.
+	//
+
+	inline
+	size_t
+	GetMissingCount(
+		) const
+	{
+		return m_MissingCount;
+	}
+
+	inline
+	size_t
+	GetUnusedCount(
+		) const
+	{
+		return m_Unused.size( );
+	}
+
+private:
+
+	typedef std::vector< size_t > IndexVec;
+
+	//
+	// Resolve a reference to a node of the graph, adding the node if it is
+	// new.  The routine returns false if an optional reference could not be
+	// resolved.
+	//
+
+	bool
+	ResolveReference(
+		__in const ResourceReference & Reference,
+		__out size_t & NodeIndex,
+		__inout IndexVec & Frontier
+		);
+
+	//
+	// Load the appearance tables used to find the models of objects.
+	//
+
+	void
+	LoadAppearanceTables(
+		);
+
+	//
+	// Parse the resources of one type, and merge their references into the
+	// graph.
+	//
+
+	void
+	ParseResources(
+		__in NWN::ResType ResType,
+		__in const IndexVec & Nodes,
+		__in ULONG MaxThreads,
+		__inout IndexVec & Frontier
+		);
+
+	//
+	// Find the module resources that are not part of the graph.
+	//
+
+	void
+	FindUnusedResources(
+		);
+
+	//
+	// Collect every node reachable from a node.
+	//
+
+	void
+	GetClosure(
+		__in size_t Root,
+		__out IndexVec & Closure
+		) const;
+
+	ResourceManager            & m_ResourceManager;
+	IDebugTextOut              * m_TextOut;
+	DependencyNodeVec            m_Nodes;
+	NodeIndexMap                 m_NodeIndex;
+	TwoDAFileReaderVec           m_Tables;
+	ULONG                        m_Levels;
+	std::vector< std::string >   m_Unused;
+	size_t                       m_MissingCount;
+
+};
+
+void
+DependencyGraph::Build(
+	__in ULONG MaxThreads
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the dependency graph of the module.
+
+	The graph is built one level at a time.  The resources of a level that
+	have contents to parse are parsed in parallel, one module scan per
+	resource type, and the references that they make form the next level.
+	Each resource is added to the graph, and parsed, only once.
+
+Arguments:
+
+	MaxThreads - Supplies the maximum count of worker threads per scan, or
+	             zero to use one worker thread per processor.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ResourceReference Root;
+	IndexVec          Frontier;
+	size_t            RootIndex;
+
+	LoadAppearanceTables( );
+
+	Root.ResRef   = ResourceManager::ResRef32FromStr( "module" );
+	Root.RefType  = NWN::ResIFO;
+	Root.AltType  = NWN::ResINVALID;
+	Root.Optional = false;
+
+	ResolveReference( Root, RootIndex, Frontier );
+
+	if (!m_Nodes[ RootIndex ].Exists)
+		throw std::runtime_error( "module.ifo is not present." );
+
+	m_Levels = 0;
+
+	while (!Frontier.empty( ))
+	{
+		typedef std::map< NWN::ResType, IndexVec > TypeMap;
+
+		TypeMap  Types;
+		IndexVec Next;
+
+		for (IndexVec::const_iterator it = Frontier.begin( );
+		     it != Frontier.end( );
+		     ++it)
+		{
+			Types[ m_Nodes[ *it ].ResType ].push_back( *it );
+		}
+
+		for (TypeMap::const_iterator it = Types.begin( );
+		     it != Types.end( );
+		     ++it)
+		{
+			ParseResources( it->first, it->second, MaxThreads, Next );
+		}
+
+		Frontier.swap( Next );
+		m_Levels += 1;
+	}
+
+	FindUnusedResources( );
+}
+
+bool
+DependencyGraph::ResolveReference(
+	__in const ResourceReference & Reference,
+	__out size_t & NodeIndex,
+	__inout IndexVec & Frontier
+	)
+/*++
+
+Routine Description:
+
+	This routine resolves a reference against the resource manager, and
+	returns the graph node of the resource.  A resource that is seen for the
+	first time is added to the graph, and queued for parsing if it exists and
+	has contents to parse.
+
+Arguments:
+
+	Reference - Supplies the reference to resolve.
+
+	NodeIndex - Receives the index of the node of the resource.
+
+	Frontier - Supplies the list of nodes to parse next, which receives the
+	           node if it is new and must be parsed.
+
+Return Value:
+
+	The routine returns true on success, else false if the reference was
+	optional and could not be resolved.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NWN::ResType           ResType;
+	bool                   Exists;
+	NodeIndexMap::iterator it;
+
+	ResType = Reference.RefType;
+	Exists  = m_ResourceManager.ResourceExists( Reference.ResRef, ResType );
+
+	if ((!Exists) && (Reference.AltType != NWN::ResINVALID))
+	{
+		if (m_ResourceManager.ResourceExists( Reference.ResRef, Reference.AltType ))
+		{
+			ResType = Reference.AltType;
+			Exists  = true;
+		}
+	}
+
+	if ((!Exists) && (Reference.Optional))
+		return false;
+
+	//
+	// Return the existing node if the resource was already seen.
+	//
+
+	std::string Key = GetResourceKey( m_ResourceManager, Reference.ResRef, ResType );
+
+	it = m_NodeIndex.find( Key );
+
+	if (it != m_NodeIndex.end( ))
+	{
+		NodeIndex = it->second;
+		return true;
+	}
+
+	DependencyNode Node;
+
+	Node.ResRef  = Reference.ResRef;
+	Node.ResType = ResType;
+	Node.Exists  = Exists;
+
+	NodeIndex = m_Nodes.size( );
+
+	m_Nodes.push_back( Node );
+	m_NodeIndex.insert( NodeIndexMap::value_type( Key, NodeIndex ) );
+
+	if ((Exists) &&
+	    (IsTypeInList( ResType, ParsedTypes, RTL_NUMBER_OF( ParsedTypes ) )))
+	{
+		Frontier.push_back( NodeIndex );
+	}
+
+	return true;
+}
+
+void
+DependencyGraph::LoadAppearanceTables(
+	)
+/*++
+
+Routine Description:
+
+	This routine loads the 2DA tables that map object appearances to models.
+	The tables are shared, read only, by the scan worker threads.  A table
+	that is not present, or lacks its model column, is skipped.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_Tables.clear( );
+	m_Tables.resize( RTL_NUMBER_OF( AppearanceTables ) );
+
+	for (size_t t = 0; t < RTL_NUMBER_OF( AppearanceTables ); t += 1)
+	{
+		try
+		{
+			DemandResourceStr  TableFile(
+				m_ResourceManager,
+				AppearanceTables[ t ].TableName,
+				NWN::Res2DA);
+			TwoDAFileReaderPtr Table;
+
+			Table = new TwoDAFileReader( TableFile );
+
+			if (!Table->HasColumn( AppearanceTables[ t ].ModelColumn ))
+			{
+				m_TextOut->WriteText(
+					"WARNING: %s.2da has no %s column; models of these objects are not followed.\n",
+					AppearanceTables[ t ].TableName,
+					AppearanceTables[ t ].ModelColumn);
+				continue;
+			}
+
+			m_Tables[ t ] = Table;
+		}
+		catch (std::exception &e)
+		{
+			m_TextOut->WriteText(
+				"WARNING: Failed to load %s.2da (%s); models of these objects are not followed.\n",
+				AppearanceTables[ t ].TableName,
+				e.what( ));
+		}
+	}
+}
+
+void
+DependencyGraph::ParseResources(
+	__in NWN::ResType ResType,
+	__in const IndexVec & Nodes,
+	__in ULONG MaxThreads,
+	__inout IndexVec & Frontier
+	)
+/*++
+
+Routine Description:
+
+	This routine parses a set of resources of one type in parallel, then adds
+	the references found in each resource to the graph.
+
+Arguments:
+
+	ResType - Supplies the type of the resources.
+
+	Nodes - Supplies the nodes of the resources to parse.
+
+	MaxThreads - Supplies the maximum count of worker threads, or zero to use
+	             one worker thread per processor.
+
+	Frontier - Supplies the list of nodes to parse next, which receives the
+	           new nodes that must be parsed.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ModuleScan        Scan( m_ResourceManager, m_TextOut );
+	ParseResultVec    Results;
+	DependencyVisitor Visitor( ResType, m_Tables, Results );
+
+	Scan.SetScanTypes( &ResType, 1 );
+
+	for (IndexVec::const_iterator it = Nodes.begin( );
+	     it != Nodes.end( );
+	     ++it)
+	{
+		Scan.AddItem( m_Nodes[ *it ].ResRef );
+	}
+
+	Results.resize( Nodes.size( ) );
+
+	Scan.Scan( &Visitor, MaxThreads );
+
+	//
+	// Merge the references in item order, so that the graph is built the same
+	// way regardless of the order in which the workers finished.
+	//
+
+	for (size_t i = 0; i < Nodes.size( ); i += 1)
+	{
+		IndexVec Dependencies;
+
+		if (!Results[ i ].Error.empty( ))
+		{
+			m_Nodes[ Nodes[ i ] ].ParseError = Results[ i ].Error;
+
+			m_TextOut->WriteText(
+				"WARNING: Failed to parse %s: %s\n",
+				GetResourceKey( m_ResourceManager, m_Nodes[ Nodes[ i ] ].ResRef, ResType ).c_str( ),
+				Results[ i ].Error.c_str( ));
+		}
+
+		for (ResourceReferenceVec::const_iterator it = Results[ i ].References.begin( );
+		     it != Results[ i ].References.end( );
+		     ++it)
+		{
+			size_t NodeIndex;
+
+			if (!ResolveReference( *it, NodeIndex, Frontier ))
+				continue;
+
+			if (NodeIndex != Nodes[ i ])
+				Dependencies.push_back( NodeIndex );
+		}
+
+		std::sort( Dependencies.begin( ), Dependencies.end( ) );
+		Dependencies.erase(
+			std::unique( Dependencies.begin( ), Dependencies.end( ) ),
+			Dependencies.end( ));
+
+		m_Nodes[ Nodes[ i ] ].Dependencies.swap( Dependencies );
+	}
+}
+
+void
+DependencyGraph::FindUnusedResources(
+	)
+/*++
+
+Routine Description:
+
+	This routine lists the resources of the module, its HAKs and the resource
+	directories that are of a type that the graph tracks, but are not part of
+	the graph.  Resources that only exist in the base game data files are not
+	listed.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::set< std::string > Unused;
+
+	for (ResourceManager::FileId Id = 0;
+	     Id < m_ResourceManager.GetEncapsulatedFileCount( );
+	     Id += 1)
+	{
+		NWN::ResRef32                 ResRef;
+		NWN::ResType                  ResType;
+		ResourceManager::FileHandle   Handle;
+		ResourceManager::AccessorType AccessorType;
+		std::string                   AccessorName;
+		std::string                   Key;
+
+		if (!m_ResourceManager.GetEncapsulatedFileEntry( Id, ResRef, ResType ))
+			continue;
+
+		if (!IsTypeInList( ResType, TrackedTypes, RTL_NUMBER_OF( TrackedTypes ) ))
+			continue;
+
+		Key = GetResourceKey( m_ResourceManager, ResRef, ResType );
+
+		if (m_NodeIndex.find( Key ) != m_NodeIndex.end( ))
+			continue;
+
+		Handle = m_ResourceManager.OpenFileByIndex( Id );
+
+		if (Handle == ResourceManager::INVALID_FILE)
+			continue;
+
+		try
+		{
+			AccessorType = m_ResourceManager.GetResourceAccessorName( Handle, AccessorName );
+		}
+		catch (std::exception)
+		{
+			m_ResourceManager.CloseFile( Handle );
+			throw;
+		}
+
+		m_ResourceManager.CloseFile( Handle );
+
+		if ((AccessorType != ResourceManager::AccessorTypeErf) &&
+		    (AccessorType != ResourceManager::AccessorTypeDirectory))
+		{
+			continue;
+		}
+
+		Unused.insert( Key );
+	}
+
+	m_Unused.assign( Unused.begin( ), Unused.end( ) );
+}
+
+void
+DependencyGraph::GetClosure(
+	__in size_t Root,
+	__out IndexVec & Closure
+	) const
+/*++
+
+Routine Description:
+
+	This routine collects every node that a node depends on, directly or
+	transitively, in graph order.
+
+Arguments:
+
+	Root - Supplies the node whose dependencies are collected.
+
+	Closure - Receives the nodes that the root depends on.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< bool > Seen;
+	IndexVec            Stack;
+
+	Closure.clear( );
+	Seen.resize( m_Nodes.size( ), false );
+
+	Seen[ Root ] = true;
+	Stack.push_back( Root );
+
+	while (!Stack.empty( ))
+	{
+		size_t Node = Stack.back( );
+
+		Stack.pop_back( );
+
+		for (IndexVec::const_iterator it = m_Nodes[ Node ].Dependencies.begin( );
+		     it != m_Nodes[ Node ].Dependencies.end( );
+		     ++it)
+		{
+			if (Seen[ *it ])
+				continue;
+
+			Seen[ *it ] = true;
+			Closure.push_back( *it );
+			Stack.push_back( *it );
+		}
+	}
+
+	std::sort( Closure.begin( ), Closure.end( ) );
+}
+
+bool
+DependencyGraph::WriteReports(
+	__in const char * OutputDir
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the reports of the graph, each a tab separated file
+	in the output directory:
+
+	dependencies.txt - One line for each resource that each area depends on,
+	                   directly or transitively.
+
+	missing.txt - One line for each reference to a resource that does not
+	              exist, naming the resource that refers to it.
+
+	unused.txt - One line for each module resource that nothing refers to.
+
+Arguments:
+
+	OutputDir - Supplies the directory to write the reports to.
+
+Return Value:
+
+	The routine returns true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string   FileName;
+	FILE        * f;
+	bool          Status;
+
+	Status = true;
+
+	//
+	// Write the dependencies of each area.
+	//
+
+	FileName  = OutputDir;
+	FileName += "\\dependencies.txt";
+
+	f = fopen( FileName.c_str( ), "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Area\tResource\tStatus\n" );
+
+	for (size_t i = 0; i < m_Nodes.size( ); i += 1)
+	{
+		IndexVec    Closure;
+		std::string Area;
+
+		if (m_Nodes[ i ].ResType != NWN::ResARE)
+			continue;
+
+		Area = m_ResourceManager.StrFromResRef( m_Nodes[ i ].ResRef );
+
+		GetClosure( i, Closure );
+
+		for (IndexVec::const_iterator it = Closure.begin( );
+		     it != Closure.end( );
+		     ++it)
+		{
+			fprintf(
+				f,
+				"%s\t%s\t%s\n",
+				Area.c_str( ),
+				GetResourceKey( m_ResourceManager, m_Nodes[ *it ].ResRef, m_Nodes[ *it ].ResType ).c_str( ),
+				m_Nodes[ *it ].Exists ? "present" : "missing");
+		}
+	}
+
+	if (fclose( f ) != 0)
+		Status = false;
+
+	//
+	// Write each reference to a missing resource.
+	//
+
+	FileName  = OutputDir;
+	FileName += "\\missing.txt";
+
+	f = fopen( FileName.c_str( ), "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Resource\tReferencedBy\n" );
+
+	m_MissingCount = 0;
+
+	for (size_t i = 0; i < m_Nodes.size( ); i += 1)
+	{
+		std::string Referrer = GetResourceKey( m_ResourceManager, m_Nodes[ i ].ResRef, m_Nodes[ i ].ResType );
+
+		for (IndexVec::const_iterator it = m_Nodes[ i ].Dependencies.begin( );
+		     it != m_Nodes[ i ].Dependencies.end( );
+		     ++it)
+		{
+			if (m_Nodes[ *it ].Exists)
+				continue;
+
+			fprintf(
+				f,
+				"%s\t%s\n",
+				GetResourceKey( m_ResourceManager, m_Nodes[ *it ].ResRef, m_Nodes[ *it ].ResType ).c_str( ),
+				Referrer.c_str( ));
+		}
+	}
+
+	for (size_t i = 0; i < m_Nodes.size( ); i += 1)
+	{
+		if (!m_Nodes[ i ].Exists)
+			m_MissingCount += 1;
+	}
+
+	if (fclose( f ) != 0)
+		Status = false;
+
+	//
+	// Write the unused module resources.
+	//
+
+	FileName  = OutputDir;
+	FileName += "\\unused.txt";
+
+	f = fopen( FileName.c_str( ), "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Resource\n" );
+
+	for (std::vector< std::string >::const_iterator it = m_Unused.begin( );
+	     it != m_Unused.end( );
+	     ++it)
+	{
+		fprintf( f, "%s\n", it->c_str( ) );
+	}
+
+	if (fclose( f ) != 0)
+		Status = false;
+
+	return Status;
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"ModuleDependencies\n"
+		"\n"
+		"This program extracts the resource dependency graph of a module, from its\n"
+		"areas and placed objects down to blueprints, conversations, scripts, models\n"
+		"and textures.  It writes the dependencies of each area, the references to\n"
+		"missing resources, and the module resources that nothing refers to.\n"
+		"\n"
+		"Usage: ModuleDependencies -home <homedir> -installdir <installdir>\n"
+		"                          -module <module resource name>\n"
+		"                          -out <output directory>\n"
+		"                          [-threads <worker thread count>]\n"
+		"\n"
+		"Resources that are only used by scripts (for example, blueprints that are\n"
+		"spawned by name) are listed as unused.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the module dependency
+	extraction program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char    * ModuleName;
+	const char    * NWN2Home;
+	const char    * InstallDir;
+	const char    * OutputDir;
+	unsigned long   MaxThreads;
+	int             ExitCode;
+
+	ModuleName = NULL;
+	NWN2Home   = NULL;
+	InstallDir = NULL;
+	OutputDir  = NULL;
+	MaxThreads = 0;
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-module" )) && (i + 1 < argc))
+			ModuleName = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-home" )) && (i + 1 < argc))
+			NWN2Home = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-installdir" )) && (i + 1 < argc))
+			InstallDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-out" )) && (i + 1 < argc))
+			OutputDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	//
+	// First, check that we've got the necessary arguments.
+	//
+
+	if (ModuleName == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the module resource name of the module to load with -module <module resource name>.  The module resource name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (NWN2Home == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 home directory location with -home <homedir>.  The home directory is typically the path to your \"Documents\\Neverwinter Nights 2\" directory.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (InstallDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 game installation directory location with -installdir <installdir>.  The installation directory is typically the path to the Neverwinter Nights 2 directory under Program Files.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (OutputDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the directory to write the reports to with -out <output directory>.\n" );
+		return -1;
+	}
+
+	if ((!CreateDirectoryA( OutputDir, NULL )) &&
+	    (GetLastError( ) != ERROR_ALREADY_EXISTS))
+	{
+		printf( "Failed to create output directory '%s'.\n", OutputDir );
+		return -1;
+	}
+
+	//
+	// Now spin up a resource manager instance.
+	//
+
+	PrintfTextOut   TextOut;
+	ResourceManager ResMan( &TextOut );
+
+	ExitCode = 0;
+
+	try
+	{
+		DependencyGraph Graph( ResMan, &TextOut );
+		ULONG           StartTime;
+		size_t          Edges;
+
+		TextOut.WriteText( "Loading module...\n" );
+		ModuleScan::LoadModule( ResMan, ModuleName, NWN2Home, InstallDir );
+
+		TextOut.WriteText( "Building dependency graph...\n" );
+
+		StartTime = GetTickCount( );
+
+		Graph.Build( MaxThreads );
+
+		if (!Graph.WriteReports( OutputDir ))
+		{
+			TextOut.WriteText( "ERROR: Failed to write reports to '%s'.\n", OutputDir );
+			ExitCode = -1;
+		}
+
+		Edges = 0;
+
+		for (DependencyNodeVec::const_iterator it = Graph.GetNodes( ).begin( );
+		     it != Graph.GetNodes( ).end( );
+		     ++it)
+		{
+			Edges += it->Dependencies.size( );
+		}
+
+		TextOut.WriteText(
+			"Built a graph of %lu resources and %lu references in %lu levels (%lums): %lu missing, %lu unused.\n",
+			(unsigned long) Graph.GetNodes( ).size( ),
+			(unsigned long) Edges,
+			Graph.GetLevels( ),
+			GetTickCount( ) - StartTime,
+			(unsigned long) Graph.GetMissingCount( ),
+			(unsigned long) Graph.GetUnusedCount( ));
+
+		if ((ExitCode == 0) && (Graph.GetMissingCount( ) != 0))
+			ExitCode = 1;
+	}
+	catch (std::exception &e)
+	{
+		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
+		ExitCode = -1;
+	}
+
+	return ExitCode;
+}
@@ -40,8 +40,10 @@ Environment:
 	User mode.
 
 --*/
-: m_FileType( ERF_FILE_TYPE )
+: m_FileType( ERF_FILE_TYPE ),
+  m_MaxThreads( 0 )
 {
+	ZeroMemory( &m_CommitStats, sizeof( m_CommitStats ) );
 }
 
 template< typename ResRefT >
@@ -587,8 +589,6 @@ Environment:
 {
 	ERF_HEADER        Header;
 
-	UNREFERENCED_PARAMETER( Flags );
-
 	//
 	// If the user did not supply an override file type, take the default one.
 	//
@@ -596,6 +596,12 @@ Environment:
 	if (FileType == 0)
 		FileType = m_FileType;
 
+	//
+	// Determine which files share stored contents before anything is written.
+	//
+
+	BuildStoredFileMap( Flags );
+
 	//
 	// First, generate and store the header.
 	//
@@ -800,10 +806,14 @@ Environment:
 
 --*/
 {
-	unsigned long OffsetToResource;
+	unsigned long                OffsetToResource;
+	std::vector< unsigned long > StoredOffsets;
+	CommitStats                  Stats;
 
 	UNREFERENCED_PARAMETER( Header );
 
+	ZeroMemory( &Stats, sizeof( Stats ) );
+
 	//
 	// Calculate the end of the resource list.
 	//
@@ -813,17 +823,41 @@ Environment:
 
 	OffsetToResource = Header.OffsetToResourceList + Header.EntryCount * sizeof( RESOURCE_LIST_ELEMENT );
 
-	for (ErfPendingFileVec::const_iterator it = m_PendingFiles.begin( );
-	     it != m_PendingFiles.end( );
-	     ++it)
+	StoredOffsets.resize( m_PendingFiles.size( ) );
+
+	for (size_t i = 0; i < m_PendingFiles.size( ); i += 1)
 	{
 		RESOURCE_LIST_ELEMENT ListElement;
+		ULONGLONG             FileSize;
 
-		if ((*it)->Contents.GetFileSize( ) > ULONG_MAX)
+		FileSize = m_PendingFiles[ i ]->Contents.GetFileSize( );
+
+		if (FileSize > ULONG_MAX)
 			throw std::runtime_error( "Resource size exceeds maximum ERF resource size limit." );
 
+		ListElement.ResourceSize = (ULONG) FileSize;
+
+		Stats.ResourceCount += 1;
+		Stats.ResourceBytes += FileSize;
+
+		//
+		// A file whose contents match an earlier file refers to the contents
+		// already stored for that file, and takes no space of its own.
+		//
+
+		if (m_StoredFile[ i ] != i)
+		{
+			ListElement.OffsetToResource = StoredOffsets[ m_StoredFile[ i ] ];
+
+			Context->Write( &ListElement, sizeof( ListElement ) );
+			continue;
+		}
+
 		ListElement.OffsetToResource = OffsetToResource;
-		ListElement.ResourceSize     = (ULONG) (*it)->Contents.GetFileSize( );
+		StoredOffsets[ i ]           = OffsetToResource;
+
+		Stats.StoredResourceCount += 1;
+		Stats.StoredBytes         += FileSize;
 
 		//
 		// Transfer the resource list element to the ERF.
@@ -836,6 +870,8 @@ Environment:
 
 		OffsetToResource = ListElement.OffsetToResource + ListElement.ResourceSize;
 	}
+
+	m_CommitStats = Stats;
 }
 
 template< typename ResRefT >
@@ -873,9 +909,7 @@ Environment:
 
 	enum { CHUNK_SIZE = 4096 };
 
-	for (ErfPendingFileVec::const_iterator it = m_PendingFiles.begin( );
-	     it != m_PendingFiles.end( );
-	     ++it)
+	for (size_t i = 0; i < m_PendingFiles.size( ); i += 1)
 	{
 		unsigned char Buffer[ CHUNK_SIZE ];
 		unsigned long FileSize;
@@ -883,13 +917,21 @@ Environment:
 		unsigned long Offset;
 		unsigned long Read;
 
+		//
+		// Files that share the stored contents of an earlier file have
+		// nothing of their own to write.
+		//
+
+		if (m_StoredFile[ i ] != i)
+			continue;
+
 		//
 		// Transfer the resource file contents to the ERF.  It has already been
 		// verified that the resource will fit in the ERF, and has a size that
 		// fits within ULONG_MAX.
 		//
 
-		FileSize = (unsigned long) (*it)->Contents.GetFileSize( );
+		FileSize = (unsigned long) m_PendingFiles[ i ]->Contents.GetFileSize( );
 
 		if (FileSize == 0)
 			continue;
@@ -897,11 +939,18 @@ Environment:
 		BytesLeft = FileSize;
 		Offset    = 0;
 
+		//
+		// The contents may have been read already to hash them, so always
+		// begin at the start of the file.
+		//
+
+		m_PendingFiles[ i ]->Contents.SeekOffset( 0, "Rewind Pending File" );
+
 		while (BytesLeft != 0)
 		{
 			Read = min( BytesLeft, CHUNK_SIZE );
 
-			(*it)->Contents.ReadFile(
+			m_PendingFiles[ i ]->Contents.ReadFile(
 				Buffer,
 				Read,
 				"Read Pending File Contents");
@@ -914,5 +963,387 @@ Environment:
 	}
 }
 
+template< typename ResRefT >
+void
+ErfFileWriter< ResRefT >::BuildStoredFileMap(
+	__in unsigned long Flags
+	)
+/*++
+
+Routine Description:
+
+	This routine determines, for each pending file, the pending file whose
+	stored contents it uses in the ERF being committed.
+
+	If deduplication is requested, every pending file is hashed (in parallel),
+	and a file whose size, hash and contents match an earlier file refers to
+	the contents of that earlier file.  Otherwise, each file refers to its own
+	contents.
+
+Arguments:
+
+	Flags - Supplies flags that control the behavior of the commit operation.
+	        Legal values are drawn from the ERF_COMMIT_FLAG_* family of values.
+
+Return Value:
+
+	None.  The routine raises an std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::pair< ULONGLONG, ULONGLONG > ContentKey;
+	typedef std::map< ContentKey, std::vector< size_t > > ContentMap;
+
+	std::vector< ULONGLONG > Hashes;
+	ContentMap               Contents;
+
+	m_StoredFile.resize( m_PendingFiles.size( ) );
+
+	for (size_t i = 0; i < m_PendingFiles.size( ); i += 1)
+		m_StoredFile[ i ] = i;
+
+	if ((Flags & ERF_COMMIT_FLAG_DEDUPLICATE) == 0)
+		return;
+
+	HashPendingFiles( Hashes );
+
+	for (size_t i = 0; i < m_PendingFiles.size( ); i += 1)
+	{
+		const FileWrapper & File = m_PendingFiles[ i ]->Contents;
+		ContentKey          Key( File.GetFileSize( ), Hashes[ i ] );
+
+		//
+		// Empty files have no contents to share.
+		//
+
+		if (Key.first == 0)
+			continue;
+
+		//
+		// Files with the same size and hash are almost certainly identical,
+		// but the contents are compared to be sure before they are shared.
+		// Each list holds one stored file per distinct content.
+		//
+
+		std::vector< size_t > & Candidates = Contents[ Key ];
+		bool                    Found      = false;
+
+		for (std::vector< size_t >::const_iterator it = Candidates.begin( );
+		     it != Candidates.end( );
+		     ++it)
+		{
+			if (CompareFileContents( m_PendingFiles[ *it ]->Contents, File ))
+			{
+				m_StoredFile[ i ] = *it;
+				Found             = true;
+				break;
+			}
+		}
+
+		if (!Found)
+			Candidates.push_back( i );
+	}
+}
+
+template< typename ResRefT >
+void
+ErfFileWriter< ResRefT >::HashPendingFiles(
+	__out std::vector< ULONGLONG > & Hashes
+	)
+/*++
+
+Routine Description:
+
+	This routine hashes the contents of every pending file.  The files are
+	divided among several worker threads.
+
+Arguments:
+
+	Hashes - Receives the hash of each pending file, in pending file order.
+
+Return Value:
+
+	None.  The routine raises an std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	HashContext           Context;
+	std::vector< HANDLE > Threads;
+	SYSTEM_INFO           SystemInfo;
+	size_t                ThreadCount;
+	size_t                ThreadsStarted;
+
+	Context.Writer      = this;
+	Context.NextFile    = 0;
+	Context.FailedFiles = 0;
+
+	Context.Hashes.resize( m_PendingFiles.size( ), 0 );
+
+	GetSystemInfo( &SystemInfo );
+
+	ThreadCount = (m_MaxThreads != 0) ? m_MaxThreads : SystemInfo.dwNumberOfProcessors;
+
+	if (ThreadCount > m_PendingFiles.size( ))
+		ThreadCount = m_PendingFiles.size( );
+
+	if (ThreadCount == 0)
+		ThreadCount = 1;
+
+	//
+	// Start the workers.  If no thread could be created, then hash the files
+	// on the calling thread instead.
+	//
+
+	Threads.resize( ThreadCount, NULL );
+	ThreadsStarted = 0;
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		Threads[ i ] = CreateThread(
+			NULL,
+			0,
+			HashWorkerThread,
+			&Context,
+			0,
+			NULL);
+
+		if (Threads[ i ] != NULL)
+			ThreadsStarted += 1;
+	}
+
+	if (ThreadsStarted == 0)
+		RunHashWorker( Context );
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		if (Threads[ i ] == NULL)
+			continue;
+
+		WaitForSingleObject( Threads[ i ], INFINITE );
+		CloseHandle( Threads[ i ] );
+	}
+
+	if (Context.FailedFiles != 0)
+		throw std::runtime_error( "Failed to read pending file contents." );
+
+	Hashes.swap( Context.Hashes );
+}
+
+template< typename ResRefT >
+DWORD
+WINAPI
+ErfFileWriter< ResRefT >::HashWorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point of a pending file hash worker thread.
+
+Arguments:
+
+	Parameter - Supplies the HashContext of the hash operation.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, hash worker thread.
+
+--*/
+{
+	HashContext * Context = (HashContext *) Parameter;
+
+	Context->Writer->RunHashWorker( *Context );
+
+	return 0;
+}
+
+template< typename ResRefT >
+void
+ErfFileWriter< ResRefT >::RunHashWorker(
+	__inout HashContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine hashes pending files until none remain.
+
+Arguments:
+
+	Context - Supplies the context of the hash operation.
+
+Return Value:
+
+	None.  Failures are recorded in the context.
+
+Environment:
+
+	User mode, hash worker thread.
+
+--*/
+{
+	for (;;)
+	{
+		size_t Index;
+
+		Index = (size_t) (InterlockedIncrement( &Context.NextFile ) - 1);
+
+		if (Index >= m_PendingFiles.size( ))
+			break;
+
+		try
+		{
+			Context.Hashes[ Index ] = HashFileContents( m_PendingFiles[ Index ]->Contents );
+		}
+		catch (std::exception)
+		{
+			InterlockedIncrement( &Context.FailedFiles );
+		}
+	}
+}
+
+template< typename ResRefT >
+ULONGLONG
+ErfFileWriter< ResRefT >::HashFileContents(
+	__in const FileWrapper & Contents
+	)
+/*++
+
+Routine Description:
+
+	This routine computes the 64-bit FNV-1a hash of the contents of a pending
+	file.  The current offset of the file is not used, but may be moved.
+
+Arguments:
+
+	Contents - Supplies the file to hash.
+
+Return Value:
+
+	The routine returns the hash of the file contents.  The routine raises an
+	std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	enum { CHUNK_SIZE = 65536 };
+
+	std::vector< unsigned char > Buffer;
+	ULONGLONG                    FileSize;
+	ULONGLONG                    Offset;
+	ULONGLONG                    Hash;
+
+	FileSize = Contents.GetFileSize( );
+	Hash     = 0xCBF29CE484222325ULL;
+
+	Buffer.resize( (size_t) min( FileSize, (ULONGLONG) CHUNK_SIZE ) + 1 );
+
+	for (Offset = 0; Offset < FileSize; )
+	{
+		size_t Read = (size_t) min( FileSize - Offset, (ULONGLONG) CHUNK_SIZE );
+
+		Contents.ReadFileAtOffset(
+			Offset,
+			&Buffer[ 0 ],
+			Read,
+			"Hash Pending File Contents");
+
+		for (size_t i = 0; i < Read; i += 1)
+		{
+			Hash ^= Buffer[ i ];
+			Hash *= 0x100000001B3ULL;
+		}
+
+		Offset += Read;
+	}
+
+	return Hash;
+}
+
+template< typename ResRefT >
+bool
+ErfFileWriter< ResRefT >::CompareFileContents(
+	__in const FileWrapper & Contents1,
+	__in const FileWrapper & Contents2
+	)
+/*++
+
+Routine Description:
+
+	This routine compares the contents of two pending files of the same size.
+	The current offsets of the files are not used, but may be moved.
+
+Arguments:
+
+	Contents1 - Supplies the first file to compare.
+
+	Contents2 - Supplies the second file to compare.
+
+Return Value:
+
+	The routine returns true if the files have the same contents, else false.
+	The routine raises an std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	enum { CHUNK_SIZE = 65536 };
+
+	std::vector< unsigned char > Buffer1;
+	std::vector< unsigned char > Buffer2;
+	ULONGLONG                    FileSize;
+	ULONGLONG                    Offset;
+
+	FileSize = Contents1.GetFileSize( );
+
+	if (FileSize != Contents2.GetFileSize( ))
+		return false;
+
+	Buffer1.resize( (size_t) min( FileSize, (ULONGLONG) CHUNK_SIZE ) + 1 );
+	Buffer2.resize( Buffer1.size( ) );
+
+	for (Offset = 0; Offset < FileSize; )
+	{
+		size_t Read = (size_t) min( FileSize - Offset, (ULONGLONG) CHUNK_SIZE );
+
+		Contents1.ReadFileAtOffset(
+			Offset,
+			&Buffer1[ 0 ],
+			Read,
+			"Compare Pending File Contents");
+		Contents2.ReadFileAtOffset(
+			Offset,
+			&Buffer2[ 0 ],
+			Read,
+			"Compare Pending File Contents");
+
+		if (memcmp( &Buffer1[ 0 ], &Buffer2[ 0 ], Read ))
+			return false;
+
+		Offset += Read;
+	}
+
+	return true;
+}
+
 template ErfFileWriter< NWN::ResRef32 >;
 template ErfFileWriter< NWN::ResRef16 >;
@@ -80,9 +80,29 @@ public:
 
 	enum
 	{
+		//
+		// Store the contents of resources that are byte-identical to an
+		// earlier resource only once.  The resource list entries of every copy
+		// refer to the same stored contents.
+		//
+
+		ERF_COMMIT_FLAG_DEDUPLICATE = 0x00000001,
+
 		LAST_ERF_COMMIT_FLAG
 	};
 
+	//
+	// Define the statistics of the last commit operation.
+	//
+
+	struct CommitStats
+	{
+		ULONG     ResourceCount;       // Resources in the ERF
+		ULONG     StoredResourceCount; // Resources whose contents were stored
+		ULONGLONG ResourceBytes;       // Total size of all resources
+		ULONGLONG StoredBytes;         // Total size of stored contents
+	};
+
 	//
 	// Commit the contents of the ERF to disk.
 	//
@@ -127,6 +147,33 @@ public:
 		return m_FileType;
 	}
 
+	//
+	// Set the maximum count of threads used to hash resources for a
+	// deduplicating commit, or zero to use one thread per processor.
+	//
+
+	inline
+	void
+	SetMaxThreads(
+		__in size_t MaxThreads
+		)
+	{
+		m_MaxThreads = MaxThreads;
+	}
+
+	//
+	// Return the statistics of the last successful commit.  The bytes saved by
+	// deduplication are ResourceBytes - StoredBytes.
+	//
+
+	inline
+	const CommitStats &
+	GetCommitStats(
+		) const
+	{
+		return m_CommitStats;
+	}
+
 	//
 	// Initialize a writer's contents from a resource accessor.
 	//
@@ -471,6 +518,79 @@ private:
 		__in ErfWriteContext * Context
 		);
 
+	//
+	// Determine which pending file's stored contents each pending file uses.
+	//
+
+	void
+	BuildStoredFileMap(
+		__in unsigned long Flags
+		);
+
+	//
+	// Define the context of the worker threads that hash pending files.
+	//
+
+	struct HashContext
+	{
+		ErfFileWriter            * Writer;
+		std::vector< ULONGLONG >   Hashes;
+		volatile LONG              NextFile;
+		volatile LONG              FailedFiles;
+	};
+
+	//
+	// Hash every pending file, using several worker threads.  An
+	// std::exception is raised if any file could not be read.
+	//
+
+	void
+	HashPendingFiles(
+		__out std::vector< ULONGLONG > & Hashes
+		);
+
+	//
+	// Worker thread entry point for HashPendingFiles.
+	//
+
+	static
+	DWORD
+	WINAPI
+	HashWorkerThread(
+		__in LPVOID Parameter
+		);
+
+	//
+	// Hash pending files until none remain.
+	//
+
+	void
+	RunHashWorker(
+		__inout HashContext & Context
+		);
+
+	//
+	// Return the hash of the contents of a pending file.
+	//
+
+	static
+	ULONGLONG
+	HashFileContents(
+		__in const FileWrapper & Contents
+		);
+
+	//
+	// Return true if two pending files of the same size have the same
+	// contents.
+	//
+
+	static
+	bool
+	CompareFileContents(
+		__in const FileWrapper & Contents1,
+		__in const FileWrapper & Contents2
+		);
+
 	//
 	// Retrieve the file version that should be defaulted for the new ERF file.
 	//
@@ -617,6 +737,21 @@ private:
 
 	ErfPendingFileVec m_PendingFiles;
 
+	//
+	// Define the index of the pending file whose stored contents each pending
+	// file uses during a commit.  Unique files refer to themselves.
+	//
+
+	std::vector< size_t > m_StoredFile;
+
+	//
+	// Define the statistics of the last commit, and the maximum count of
+	// threads used to hash resources.
+	//
+
+	CommitStats       m_CommitStats;
+	size_t            m_MaxThreads;
+
 };
 
 typedef ErfFileWriter< NWN::ResRef32 > ErfFileWriter32;
@@ -179,6 +179,77 @@ public:
 		throw std::runtime_error( ExMsg );
 	}
 
+	//
+	// Read from a particular file offset, regardless of the current offset.
+	// Unlike SeekOffset followed by ReadFile, the routine may be called by
+	// several threads at once.
+	//
+	// N.B.  For a file that is not mapped, the handle is not opened for
+	//       overlapped I/O, so the read leaves the system's file pointer just
+	//       past the data that was read.  A caller that mixes this routine
+	//       with ReadFile must call SeekOffset before the next ReadFile.
+	//
+
+	inline
+	void
+	ReadFileAtOffset(
+		__in ULONGLONG Offset,
+		__out_bcount( Length ) void * Buffer,
+		__in size_t Length,
+		__in const char * Description
+		) const
+	{
+		DWORD      Transferred;
+		OVERLAPPED Overlapped;
+		char       ExMsg[ 64 ];
+
+		if (Length == 0)
+			return;
+
+		if (m_View != NULL)
+		{
+			if ((Offset + Length < Offset) ||
+			    (Offset + Length > m_Size))
+			{
+				StringCbPrintfA(
+					ExMsg,
+					sizeof( ExMsg ),
+					"ReadFileAtOffset( %s ) failed.",
+					Description);
+
+				throw std::runtime_error( ExMsg );
+			}
+
+			xmemcpy(
+				Buffer,
+				&m_View[ Offset ],
+				Length);
+
+			return;
+		}
+
+		ZeroMemory( &Overlapped, sizeof( Overlapped ) );
+
+		Overlapped.Offset     = (DWORD) ((Offset >>  0) & 0xFFFFFFFF);
+		Overlapped.OffsetHigh = (DWORD) ((Offset >> 32) & 0xFFFFFFFF);
+
+		if (::ReadFile(
+			m_File,
+			Buffer,
+			(DWORD) Length,
+			&Transferred,
+			&Overlapped) && (Transferred == (DWORD) Length))
+			return;
+
+		StringCbPrintfA(
+			ExMsg,
+			sizeof( ExMsg ),
+			"ReadFileAtOffset( %s ) failed.",
+			Description);
+
+		throw std::runtime_error( ExMsg );
+	}
+
 	//
 	// Seek to a particular file offset.
 	//
@@ -275,7 +346,7 @@ private:
 	inline
 	void
 	ThrowInPageError(
-		)
+		) const
 	{
 		throw std::runtime_error( "In-page I/O error accessing file" );
 	}
@@ -287,7 +358,7 @@ private:
 		__out_bcount_full_opt(_Size) void * _Dst,
 		__in_bcount_opt(_Size) const void * _Src,
 		__in size_t _Size
-		)
+		) const
 	{
 		__try
 		{
@@ -0,0 +1,370 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	GffCommitBatch.cpp
+
+Abstract:
+
+	This module houses the GFF commit batch object, which saves a set of GFF
+	files while only rewriting the files whose contents have changed, and
+	flushes the files that were written to disk once for the whole batch.
+
+--*/
+
+#include "Precomp.h"
+#include "GffCommitBatch.h"
+
+//
+// Define the size of the chunks in which an existing file is compared.
+//
+
+#define GFF_COMMIT_BATCH_COMPARE_CHUNK 65536
+
+GffCommitBatch::GffCommitBatch(
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new, empty commit batch.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The newly constructed object.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ZeroMemory( &m_CommitStats, sizeof( m_CommitStats ) );
+
+	InitializeCriticalSection( &m_Lock );
+}
+
+GffCommitBatch::~GffCommitBatch(
+	)
+/*++
+
+Routine Description:
+
+	This routine cleans up a commit batch.  Files that were written but not
+	yet flushed are closed; their contents reach the disk whenever the system
+	writes them back.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (HandleVec::iterator it = m_WrittenFiles.begin( );
+	     it != m_WrittenFiles.end( );
+	     ++it)
+	{
+		CloseHandle( *it );
+	}
+
+	DeleteCriticalSection( &m_Lock );
+}
+
+bool
+GffCommitBatch::Commit(
+	__in GffFileWriter & Writer,
+	__in const std::string & FileName,
+	__in unsigned long FileType, /* = 0 */
+	__in unsigned long Flags /* = 0 */
+	)
+/*++
+
+Routine Description:
+
+	This routine serializes the staged contents of a GFF writer to memory, and
+	writes them to a disk file unless the file already holds exactly the same
+	contents.  A file that is written is kept open until Flush is called.
+
+	The routine may be called from several threads at once.
+
+Arguments:
+
+	Writer - Supplies the GFF writer whose contents are committed.
+
+	FileName - Supplies the name of the file to write to.
+
+	FileType - Supplies the type tag of the file (GFF, BIC, etc.)
+
+	Flags - Supplies flags that control the behavior of the commit operation.
+	        Legal values are drawn from the GFF_COMMIT_FLAG_* family of values.
+
+Return Value:
+
+	The routine returns true if the file was written or already held the GFF
+	contents, else false if the commit failed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FileContents Contents;
+	HANDLE       File;
+
+	if (!Writer.Commit( Contents, FileType, Flags ))
+		return false;
+
+	File = INVALID_HANDLE_VALUE;
+
+	try
+	{
+		if (!IsFileUnchanged( FileName, Contents ))
+			File = WriteContents( FileName, Contents );
+	}
+	catch (std::exception)
+	{
+		return false;
+	}
+
+	EnterCriticalSection( &m_Lock );
+
+	if (File != INVALID_HANDLE_VALUE)
+	{
+		try
+		{
+			m_WrittenFiles.push_back( File );
+		}
+		catch (std::exception)
+		{
+			LeaveCriticalSection( &m_Lock );
+
+			CloseHandle( File );
+
+			return false;
+		}
+
+		m_CommitStats.WrittenFileCount += 1;
+		m_CommitStats.WrittenBytes     += Contents.size( );
+	}
+
+	m_CommitStats.FileCount += 1;
+	m_CommitStats.FileBytes += Contents.size( );
+
+	LeaveCriticalSection( &m_Lock );
+
+	return true;
+}
+
+bool
+GffCommitBatch::Flush(
+	)
+/*++
+
+Routine Description:
+
+	This routine flushes every file written by the batch since the last flush
+	to disk, and closes the files.  The flushes are issued back to back once
+	all files have been written, rather than as each file is written.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns true if every file was flushed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	bool Flushed;
+
+	Flushed = true;
+
+	EnterCriticalSection( &m_Lock );
+
+	for (HandleVec::iterator it = m_WrittenFiles.begin( );
+	     it != m_WrittenFiles.end( );
+	     ++it)
+	{
+		if (!FlushFileBuffers( *it ))
+			Flushed = false;
+
+		CloseHandle( *it );
+	}
+
+	m_WrittenFiles.clear( );
+
+	LeaveCriticalSection( &m_Lock );
+
+	return Flushed;
+}
+
+bool
+GffCommitBatch::IsFileUnchanged(
+	__in const std::string & FileName,
+	__in const FileContents & Contents
+	)
+/*++
+
+Routine Description:
+
+	This routine determines whether a disk file holds exactly the given
+	contents.  The size of the file is checked first, so that the file is only
+	read if its size matches.
+
+Arguments:
+
+	FileName - Supplies the name of the file to compare.
+
+	Contents - Supplies the contents to compare the file against.
+
+Return Value:
+
+	The routine returns true if the file exists and holds the contents, else
+	false.  An std::exception may be raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	WIN32_FILE_ATTRIBUTE_DATA    Attributes;
+	ULONGLONG                    FileSize;
+	HANDLE                       File;
+	std::vector< unsigned char > Buffer;
+	size_t                       Offset;
+	bool                         Unchanged;
+
+	if (!GetFileAttributesExA( FileName.c_str( ), GetFileExInfoStandard, &Attributes ))
+		return false;
+
+	if (Attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		return false;
+
+	FileSize = ((ULONGLONG) Attributes.nFileSizeHigh << 32) | (ULONGLONG) Attributes.nFileSizeLow;
+
+	if (FileSize != (ULONGLONG) Contents.size( ))
+		return false;
+
+	Buffer.resize( GFF_COMMIT_BATCH_COMPARE_CHUNK );
+
+	File = CreateFileA(
+		FileName.c_str( ),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL);
+
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+
+	Unchanged = true;
+
+	for (Offset = 0; Offset < Contents.size( ); )
+	{
+		DWORD ToRead;
+		DWORD Read;
+
+		ToRead = (DWORD) min( Buffer.size( ), Contents.size( ) - Offset );
+
+		if ((!ReadFile( File, &Buffer[ 0 ], ToRead, &Read, NULL )) ||
+		    (Read != ToRead)                                        ||
+		    (memcmp( &Buffer[ 0 ], &Contents[ Offset ], ToRead )))
+		{
+			Unchanged = false;
+			break;
+		}
+
+		Offset += ToRead;
+	}
+
+	CloseHandle( File );
+
+	return Unchanged;
+}
+
+HANDLE
+GffCommitBatch::WriteContents(
+	__in const std::string & FileName,
+	__in const FileContents & Contents
+	)
+/*++
+
+Routine Description:
+
+	This routine replaces the contents of a disk file.  The file is not
+	flushed.
+
+Arguments:
+
+	FileName - Supplies the name of the file to write to.
+
+	Contents - Supplies the contents to write.
+
+Return Value:
+
+	The routine returns an open handle to the file, which the caller closes.
+	On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	HANDLE File;
+	size_t Offset;
+
+	File = CreateFileA(
+		FileName.c_str( ),
+		GENERIC_WRITE,
+		FILE_SHARE_READ,
+		NULL,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+
+	if (File == INVALID_HANDLE_VALUE)
+		throw std::runtime_error( "Failed to open file." );
+
+	for (Offset = 0; Offset < Contents.size( ); )
+	{
+		DWORD ToWrite;
+		DWORD Written;
+
+		ToWrite = (DWORD) min( (size_t) ULONG_MAX, Contents.size( ) - Offset );
+
+		if ((!WriteFile( File, &Contents[ Offset ], ToWrite, &Written, NULL )) ||
+		    (Written != ToWrite))
+		{
+			CloseHandle( File );
+			throw std::runtime_error( "Failed to write file." );
+		}
+
+		Offset += ToWrite;
+	}
+
+	return File;
+}
@@ -0,0 +1,145 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	GffCommitBatch.h
+
+Abstract:
+
+	This module defines the GFF commit batch object, which saves a set of GFF
+	files (such as the files of a directory-mode module) while only rewriting
+	the files whose contents have changed.
+
+	Each file is serialized to memory and compared against the file already
+	on disk, cheaply by size first, and is left untouched if the contents are
+	identical.  Files that are written are flushed to disk together once the
+	whole batch is done, instead of one by one.
+
+--*/
+
+#ifndef _PROGRAMS_NWN2DATALIB_GFFCOMMITBATCH_H
+#define _PROGRAMS_NWN2DATALIB_GFFCOMMITBATCH_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include "GffFileWriter.h"
+
+//
+// Define the GFF commit batch object.  Commit may be called from any number
+// of threads at once, so long as each GffFileWriter is only committed by one
+// thread at a time.
+//
+
+class GffCommitBatch
+{
+
+public:
+
+	//
+	// Define the statistics of the batch.
+	//
+
+	struct CommitStats
+	{
+		ULONG     FileCount;        // Files committed to the batch
+		ULONG     WrittenFileCount; // Files whose contents changed
+		ULONGLONG FileBytes;        // Total size of all files
+		ULONGLONG WrittenBytes;     // Total size of files written
+	};
+
+	GffCommitBatch(
+		);
+
+	//
+	// Destructor.  Files that were written but not yet flushed are closed
+	// without being flushed.
+	//
+
+	~GffCommitBatch(
+		);
+
+	//
+	// Commit the contents of a GFF writer to a disk file, unless the file
+	// already holds the same contents.  The write is not flushed to disk until
+	// Flush is called.  The routine returns false if the commit failed.
+	//
+
+	bool
+	Commit(
+		__in GffFileWriter & Writer,
+		__in const std::string & FileName,
+		__in unsigned long FileType = 0,
+		__in unsigned long Flags = 0
+		);
+
+	//
+	// Flush every file written by the batch to disk.  The routine returns
+	// false if any file could not be flushed.
+	//
+
+	bool
+	Flush(
+		);
+
+	//
+	// Return the statistics of the batch.  Files that were left unchanged are
+	// FileCount - WrittenFileCount.
+	//
+
+	inline
+	const CommitStats &
+	GetCommitStats(
+		) const
+	{
+		return m_CommitStats;
+	}
+
+private:
+
+	typedef std::vector< unsigned char > FileContents;
+	typedef std::vector< HANDLE > HandleVec;
+
+	//
+	// Determine whether a disk file holds exactly the given contents.
+	//
+
+	static
+	bool
+	IsFileUnchanged(
+		__in const std::string & FileName,
+		__in const FileContents & Contents
+		);
+
+	//
+	// Replace the contents of a disk file.  The returned handle remains open
+	// so that the file may be flushed later.  The routine raises an
+	// std::exception on failure.
+	//
+
+	static
+	HANDLE
+	WriteContents(
+		__in const std::string & FileName,
+		__in const FileContents & Contents
+		);
+
+	GffCommitBatch(
+		__in const GffCommitBatch & Other
+		);
+
+	GffCommitBatch &
+	operator=(
+		__in const GffCommitBatch & Other
+		);
+
+	HandleVec        m_WrittenFiles;
+	CommitStats      m_CommitStats;
+	CRITICAL_SECTION m_Lock;
+
+};
+
+#endif
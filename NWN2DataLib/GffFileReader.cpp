@@ -259,6 +259,297 @@ Environment:
 	//
 }
 
+void
+GffFileReader::Validate(
+	) const
+/*++
+
+Routine Description:
+
+	This routine checks the structure of the entire file.  Every structure,
+	field and list that is reachable from the root structure is visited, and
+	all of the indicies and data ranges that they contain are checked against
+	the bounds of the file.
+
+	Ordinarily, a field is only checked when it is read, and accessors report
+	a malformed field in the same way as a missing field.  The routine allows
+	a file to be verified in full up front instead.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.  The routine raises an std::exception describing the first problem
+	that was found, if the file is malformed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< bool > Visited;
+
+	Visited.resize( m_Header.StructCount, false );
+
+	ValidateStruct( 0, Visited, 0 );
+}
+
+void
+GffFileReader::ValidateStruct(
+	__in STRUCT_INDEX StructIndex,
+	__inout std::vector< bool > & Visited,
+	__in size_t Depth
+	) const
+/*++
+
+Routine Description:
+
+	This routine checks a structure, and each of its fields.
+
+Arguments:
+
+	StructIndex - Supplies the index of the structure to check.
+
+	Visited - Supplies the per-structure visited flags of the validation pass.
+	          The flag of the structure is set.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  The routine raises an std::exception if the structure is malformed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GFF_STRUCT_ENTRY StructEntry;
+	FIELD_INDEX      FieldIndex;
+
+	if (Depth > MAX_VALIDATE_DEPTH)
+		throw std::runtime_error( "Structures are nested too deeply." );
+
+	GetStructByIndex( StructIndex, StructEntry );
+
+	//
+	// Every structure is referenced exactly once.  A structure that is shared
+	// (or that contains itself) would be visited repeatedly by a reader.
+	//
+
+	if (Visited[ StructIndex ])
+		throw std::runtime_error( "Structure is referenced more than once." );
+
+	Visited[ StructIndex ] = true;
+
+	if (StructEntry.FieldCount == 1)
+	{
+		//
+		// The DataOrDataOffset field is the field index itself.
+		//
+
+		ValidateField( StructEntry.DataOrDataOffset, Visited, Depth );
+		return;
+	}
+
+	if ((ULONGLONG) StructEntry.FieldCount * sizeof( FIELD_INDEX ) + StructEntry.DataOrDataOffset > m_Header.FieldIndiciesCount)
+		throw std::runtime_error( "Illegal field indicies index." );
+
+	for (FIELD_INDEX i = 0; i < StructEntry.FieldCount; i += 1)
+	{
+		SEEK_OFFSET( (ULONGLONG) i * sizeof( FIELD_INDEX ) + StructEntry.DataOrDataOffset + m_Header.FieldIndiciesOffset );
+		READ_FILE( &FieldIndex, sizeof( FieldIndex ) );
+
+		ValidateField( FieldIndex, Visited, Depth );
+	}
+}
+
+void
+GffFileReader::ValidateField(
+	__in FIELD_INDEX FieldIndex,
+	__inout std::vector< bool > & Visited,
+	__in size_t Depth
+	) const
+/*++
+
+Routine Description:
+
+	This routine checks a field.  The data of a large field must lie within
+	the field data stream, and child structures and list elements are checked
+	in turn.
+
+Arguments:
+
+	FieldIndex - Supplies the index of the field to check.
+
+	Visited - Supplies the per-structure visited flags of the validation pass.
+
+	Depth - Supplies the nesting depth of the structure that contains the
+	        field.
+
+Return Value:
+
+	None.  The routine raises an std::exception if the field is malformed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GFF_FIELD_ENTRY FieldEntry;
+	ULONGLONG       Length;
+
+	GetFieldByIndex( FieldIndex, FieldEntry );
+
+	if (FieldEntry.LabelIndex >= m_Header.LabelCount)
+		throw std::runtime_error( "Illegal label index." );
+
+	Length = 0;
+
+	switch (FieldEntry.Type)
+	{
+
+	case GFF_BYTE:
+	case GFF_CHAR:
+	case GFF_WORD:
+	case GFF_SHORT:
+	case GFF_DWORD:
+	case GFF_INT:
+	case GFF_FLOAT:
+		//
+		// Small fields are stored in the field entry itself.
+		//
+		break;
+
+	case GFF_DWORD64:
+	case GFF_INT64:
+	case GFF_DOUBLE:
+		Length = 8;
+		break;
+
+	case GFF_VECTOR:
+		Length = 12;
+		break;
+
+	case GFF_CEXOSTRING:
+	case GFF_VOID:
+		{
+			unsigned __int32 Size;
+
+			if (!ReadFieldData( FieldEntry.DataOrDataOffset, &Size, sizeof( Size ) ))
+				throw std::runtime_error( "Field data index out of range." );
+
+			Length = (ULONGLONG) Size + sizeof( Size );
+		}
+		break;
+
+	case GFF_RESREF:
+		{
+			unsigned __int8 Size;
+
+			if (!ReadFieldData( FieldEntry.DataOrDataOffset, &Size, sizeof( Size ) ))
+				throw std::runtime_error( "Field data index out of range." );
+
+			Length = (ULONGLONG) Size + sizeof( Size );
+		}
+		break;
+
+	case GFF_CEXOLOCSTRING:
+		{
+			GFF_CEXOLOCSTRING_ENTRY LocString;
+			ULONGLONG               Offset;
+
+			if (!ReadFieldData( FieldEntry.DataOrDataOffset, &LocString, sizeof( LocString ) ))
+				throw std::runtime_error( "Field data index out of range." );
+
+			if (LocString.Length < sizeof( LocString ) - 4)
+				throw std::runtime_error( "CExoLocString header is truncated." );
+
+			Length = (ULONGLONG) LocString.Length + 4;
+
+			if ((ULONGLONG) FieldEntry.DataOrDataOffset + Length > m_Header.FieldDataCount)
+				throw std::runtime_error( "Field data extends past the field data stream." );
+
+			//
+			// Each substring must lie within the declared length.
+			//
+
+			Offset = sizeof( LocString );
+
+			for (unsigned long i = 0; i < LocString.StringCount; i += 1)
+			{
+				GFF_CEXOLOCSUBSTRING_ENTRY SubString;
+
+				if (Offset + sizeof( SubString ) > Length)
+					throw std::runtime_error( "CExoLocString substring is truncated." );
+
+				if (!ReadFieldData(
+					(FIELD_DATA_INDEX) (FieldEntry.DataOrDataOffset + Offset),
+					&SubString,
+					sizeof( SubString )))
+				{
+					throw std::runtime_error( "Field data index out of range." );
+				}
+
+				Offset += sizeof( SubString ) + (ULONGLONG) SubString.StringLength;
+
+				if (Offset > Length)
+					throw std::runtime_error( "CExoLocString substring is truncated." );
+			}
+		}
+		break;
+
+	case GFF_STRUCT:
+		ValidateStruct( FieldEntry.DataOrDataOffset, Visited, Depth + 1 );
+		break;
+
+	case GFF_LIST:
+		{
+			unsigned __int32 Size;
+			STRUCT_INDEX     StructIndex;
+
+			if (!ReadListIndicies( FieldEntry.DataOrDataOffset, &Size, sizeof( Size ) ))
+				throw std::runtime_error( "List indicies index out of range." );
+
+			if ((ULONGLONG) Size * sizeof( StructIndex ) + sizeof( Size ) + FieldEntry.DataOrDataOffset > m_Header.ListIndiciesCount)
+				throw std::runtime_error( "List extends past the list indicies stream." );
+
+			for (unsigned __int32 i = 0; i < Size; i += 1)
+			{
+				if (!ReadListIndicies(
+					(LIST_INDICIES_INDEX) (FieldEntry.DataOrDataOffset + sizeof( Size ) + i * sizeof( StructIndex )),
+					&StructIndex,
+					sizeof( StructIndex )))
+				{
+					throw std::runtime_error( "List indicies index out of range." );
+				}
+
+				ValidateStruct( StructIndex, Visited, Depth + 1 );
+			}
+		}
+		break;
+
+	default:
+		throw std::runtime_error( "Unrecognized field type." );
+
+	}
+
+	//
+	// Large fields must lie entirely within the field data stream.
+	//
+
+	if ((Length != 0) &&
+	    ((ULONGLONG) FieldEntry.DataOrDataOffset + Length > m_Header.FieldDataCount))
+	{
+		throw std::runtime_error( "Field data extends past the field data stream." );
+	}
+}
+
 void
 GffFileReader::GetFieldByIndex(
 	__in FIELD_INDEX FieldIndex,
@@ -344,6 +635,133 @@ Environment:
 	}
 }
 
+void
+GffFileReader::GetLabels(
+	__out std::vector< std::string > & Labels
+	) const
+/*++
+
+Routine Description:
+
+	This routine retrieves the text of every label of the file.  The label
+	table is read in a single pass.
+
+Arguments:
+
+	Labels - Receives the label text of each label, indexed by label index.
+
+Return Value:
+
+	None.  The routine raises an std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< GFF_LABEL_ENTRY > LabelEntries;
+
+	Labels.clear( );
+
+	if (m_Header.LabelCount == 0)
+		return;
+
+	LabelEntries.resize( m_Header.LabelCount );
+
+	SEEK_OFFSET( m_Header.LabelOffset );
+	READ_FILE( &LabelEntries[ 0 ], LabelEntries.size( ) * sizeof( GFF_LABEL_ENTRY ) );
+
+	Labels.resize( LabelEntries.size( ) );
+
+	for (size_t i = 0; i < LabelEntries.size( ); i += 1)
+	{
+		const char * Name = LabelEntries[ i ].Name;
+
+		Labels[ i ].assign( Name, strnlen( Name, sizeof( LabelEntries[ i ].Name ) ) );
+	}
+}
+
+void
+GffFileReader::FindResRefFields(
+	__in const std::vector< bool > & Labels,
+	__out ResRefFieldVec & Fields
+	) const
+/*++
+
+Routine Description:
+
+	This routine collects the contents of every RESREF field of the file whose
+	label is flagged in a label set.
+
+	The field array is read in a single pass and each field is matched by its
+	label index, so the cost is independent of the structure layout of the
+	file and no label text is compared.  Fields that are not reachable from
+	the root structure (which well-formed files do not have) are included.
+
+Arguments:
+
+	Labels - Supplies a table, indexed by label index, that flags the labels
+	         of the fields to collect.  Labels past the end of the table are
+	         not collected.
+
+	Fields - Receives the label index and contents of each matching field, in
+	         field array order.
+
+Return Value:
+
+	None.  The routine raises an std::exception on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< GFF_FIELD_ENTRY > FieldEntries;
+
+	Fields.clear( );
+
+	if (m_Header.FieldCount == 0)
+		return;
+
+	FieldEntries.resize( m_Header.FieldCount );
+
+	SEEK_OFFSET( m_Header.FieldOffset );
+	READ_FILE( &FieldEntries[ 0 ], FieldEntries.size( ) * sizeof( GFF_FIELD_ENTRY ) );
+
+	for (std::vector< GFF_FIELD_ENTRY >::const_iterator it = FieldEntries.begin( );
+	     it != FieldEntries.end( );
+	     ++it)
+	{
+		ResRefField     Field;
+		unsigned __int8 Size;
+
+		if (it->Type != GFF_RESREF)
+			continue;
+
+		if ((it->LabelIndex >= Labels.size( )) || (!Labels[ it->LabelIndex ]))
+			continue;
+
+		if ((!ValidateFieldDataRange( it->DataOrDataOffset, sizeof( Size ) )) ||
+		    (!ReadFieldData( it->DataOrDataOffset, &Size, sizeof( Size ) )))
+			throw std::runtime_error( "Illegal RESREF field data." );
+
+		ZeroMemory( &Field.ResRef, sizeof( Field.ResRef ) );
+
+		if (Size > sizeof( Field.ResRef ))
+			throw std::runtime_error( "RESREF field too long." );
+
+		if ((!ValidateFieldDataRange( it->DataOrDataOffset + sizeof( Size ), Size )) ||
+		    (!ReadFieldData( it->DataOrDataOffset + sizeof( Size ), &Field.ResRef, Size )))
+			throw std::runtime_error( "Illegal RESREF field data." );
+
+		Field.LabelIndex = it->LabelIndex;
+
+		Fields.push_back( Field );
+	}
+}
+
 void
 GffFileReader::GetStructByIndex(
 	__in STRUCT_INDEX StructIndex,
@@ -121,8 +121,26 @@ public:
 		return &m_RootStruct;
 	}
 
+	//
+	// Check every structure, field and list reachable from the root structure
+	// for legal indicies and data ranges.  Fields are otherwise only checked
+	// as they are read.  An std::exception describing the first problem that
+	// was found is raised on failure.
+	//
+
+	void
+	Validate(
+		) const;
+
 private:
 
+	//
+	// Define the maximum nesting depth of structures accepted by Validate, as
+	// per GffFileWriter.
+	//
+
+	enum { MAX_VALIDATE_DEPTH = 32 };
+
 	//
 	// Parse the on-disk format and read the base directory data in.
 	//
@@ -328,6 +346,19 @@ public:
 			return m_StructEntry.Type;
 		}
 
+		//
+		// Return the on-disk descriptor of this structure.  Two structures of
+		// the same reader with equal descriptors have the same contents.
+		//
+
+		inline
+		const GFF_STRUCT_ENTRY &
+		GetStructEntry(
+			) const
+		{
+			return m_StructEntry;
+		}
+
 		//
 		// Return the count of fields in the structure.
 		//
@@ -1130,6 +1161,41 @@ public:
 		return m_ResourceManager;
 	}
 
+	//
+	// Define a RESREF field located by FindResRefFields.
+	//
+
+	struct ResRefField
+	{
+		LABEL_INDEX   LabelIndex;
+		NWN::ResRef32 ResRef;
+	};
+
+	typedef std::vector< ResRefField > ResRefFieldVec;
+
+	//
+	// Return the label table of the file, indexed by label index.  An
+	// std::exception is raised on failure.
+	//
+
+	void
+	GetLabels(
+		__out std::vector< std::string > & Labels
+		) const;
+
+	//
+	// Collect every RESREF field whose label index is flagged in Labels (as
+	// built from GetLabels).  The field array is scanned directly, in field
+	// order, rather than by walking the structure tree, so that no labels are
+	// compared per field.  An std::exception is raised on failure.
+	//
+
+	void
+	FindResRefFields(
+		__in const std::vector< bool > & Labels,
+		__out ResRefFieldVec & Fields
+		) const;
+
 private:
 
 	//
@@ -1162,6 +1228,24 @@ private:
 		__out GFF_STRUCT_ENTRY & StructEntry
 		) const;
 
+	//
+	// Validate a structure, or a field, and the structures that it references.
+	//
+
+	void
+	ValidateStruct(
+		__in STRUCT_INDEX StructIndex,
+		__inout std::vector< bool > & Visited,
+		__in size_t Depth
+		) const;
+
+	void
+	ValidateField(
+		__in FIELD_INDEX FieldIndex,
+		__inout std::vector< bool > & Visited,
+		__in size_t Depth
+		) const;
+
 	//
 	// Compare field names.
 	//
@@ -1042,6 +1042,66 @@ public:
 			}
 		}
 
+		//
+		// Set a data field from raw field data, in the form returned by
+		// GffFileReader::GffStruct::GetFieldRawData.  An existing field of the
+		// same name is replaced, even if it is of a different type.
+		//
+
+		inline
+		void
+		SetFieldRawData(
+			__in const char * FieldName,
+			__in GffFileReader::GFF_FIELD_TYPE FieldType,
+			__in const std::vector< unsigned char > & FieldData
+			)
+		{
+			GffFileReader::GFF_FIELD_TYPE OldFieldType;
+
+			if ((FieldType == GffFileReader::GFF_STRUCT) ||
+			    (FieldType == GffFileReader::GFF_LIST) ||
+			    (FieldType >= GffFileReader::LAST_GFF_FIELD_TYPE))
+			{
+				throw std::runtime_error( "Raw data may only be set for a data field." );
+			}
+
+			if ((GetFieldType( FieldName, OldFieldType )) &&
+			    (OldFieldType != FieldType))
+			{
+				DeleteField( FieldName );
+			}
+
+			if (IsComplexType( FieldType ))
+			{
+				SetComplexFieldByName( FieldType, FieldName, FieldData );
+				return;
+			}
+
+			//
+			// Simple fields are stored inline, and so must fit in the
+			// DataOrDataOffset entry of the field descriptor.
+			//
+
+			if (FieldData.size( ) > sizeof( unsigned long ))
+				throw std::runtime_error( "Simple field data too large." );
+
+			bool                    NewField;
+			FieldEntryVec::iterator it = CreateField( FieldType, FieldName, NewField );
+
+			try
+			{
+				it->FieldData   = FieldData;
+				it->FieldFlags |= FIELD_FLAG_HAS_DATA;
+			}
+			catch (...)
+			{
+				if (NewField)
+					m_StructEntry->StructFields.erase( it );
+
+				throw;
+			}
+		}
+
 		//
 		// Transfer a field from a GffFileReader over to the GffFileWriter.  The
 		// field should not already exist (the caller must invoke DeleteField if
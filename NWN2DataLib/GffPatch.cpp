@@ -0,0 +1,1856 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	GffPatch.cpp
+
+Abstract:
+
+	This module houses the GFF patch object, which computes and applies
+	structural patches between GFF files.
+
+--*/
+
+#include "Precomp.h"
+#include "GffPatch.h"
+
+//
+// Define the FNV-1a parameters used for structure hashes.
+//
+
+#define GFF_HASH_INITIAL 0xCBF29CE484222325ULL
+#define GFF_HASH_PRIME   0x00000100000001B3ULL
+
+static
+inline
+ULONGLONG
+GffHashData(
+	__in_bcount( Length ) const void * Data,
+	__in size_t Length,
+	__in ULONGLONG Hash
+	)
+{
+	const unsigned char * p = (const unsigned char *) Data;
+
+	for (size_t i = 0; i < Length; i += 1)
+	{
+		Hash ^= p[ i ];
+		Hash *= GFF_HASH_PRIME;
+	}
+
+	return Hash;
+}
+
+//
+// Return true if a field type is a data (rather than a struct or list) type.
+//
+
+static
+inline
+bool
+IsDataFieldType(
+	__in GffFileReader::GFF_FIELD_TYPE FieldType
+	)
+{
+	return ((FieldType != GffFileReader::GFF_STRUCT) &&
+	        (FieldType != GffFileReader::GFF_LIST));
+}
+
+//
+// Return true if the raw data of a data field has the layout that
+// GffFileReader::GffStruct::GetFieldRawData returns for its type, so that a
+// file written with the field can be read back.
+//
+
+static
+bool
+IsValidFieldData(
+	__in GffFileReader::GFF_FIELD_TYPE FieldType,
+	__in const std::vector< unsigned char > & FieldData
+	)
+{
+	ULONG Size;
+
+	switch (FieldType)
+	{
+
+	case GffFileReader::GFF_BYTE:
+	case GffFileReader::GFF_CHAR:
+		return (FieldData.size( ) == 1);
+
+	case GffFileReader::GFF_WORD:
+	case GffFileReader::GFF_SHORT:
+		return (FieldData.size( ) == 2);
+
+	case GffFileReader::GFF_DWORD:
+	case GffFileReader::GFF_INT:
+	case GffFileReader::GFF_FLOAT:
+		return (FieldData.size( ) == 4);
+
+	case GffFileReader::GFF_DWORD64:
+	case GffFileReader::GFF_INT64:
+	case GffFileReader::GFF_DOUBLE:
+		return (FieldData.size( ) == 8);
+
+	case GffFileReader::GFF_VECTOR:
+		return (FieldData.size( ) == 12);
+
+	case GffFileReader::GFF_CEXOSTRING:
+	case GffFileReader::GFF_CEXOLOCSTRING:
+	case GffFileReader::GFF_VOID:
+		if (FieldData.size( ) < sizeof( Size ))
+			return false;
+
+		memcpy( &Size, &FieldData[ 0 ], sizeof( Size ) );
+
+		return (FieldData.size( ) - sizeof( Size ) == Size);
+
+	case GffFileReader::GFF_RESREF:
+		if (FieldData.empty( ))
+			return false;
+
+		return (FieldData.size( ) - 1 == FieldData[ 0 ]);
+
+	default:
+		return false;
+
+	}
+}
+
+//
+// Define the structure hash cache, which hashes each structure of a reader
+// once.  A structure's hash covers its type and its fields, in label order,
+// including the contents of all child structures and lists.
+//
+
+class GffPatch::StructHashCache
+{
+
+public:
+
+	//
+	// Define the description of a field of a structure.
+	//
+
+	struct FieldInfo
+	{
+		std::string                   Label;
+		GffFileReader::FIELD_INDEX    Index;
+		GffFileReader::GFF_FIELD_TYPE Type;
+		ULONGLONG                     Hash;
+
+		inline
+		bool
+		operator<(
+			__in const FieldInfo & other
+			) const
+		{
+			return (Label < other.Label);
+		}
+	};
+
+	typedef std::vector< FieldInfo > FieldInfoVec;
+	typedef std::vector< ULONGLONG > HashVec;
+
+	//
+	// Return the hash of a structure.
+	//
+
+	ULONGLONG
+	GetStructHash(
+		__in const GffFileReader::GffStruct & Struct,
+		__in size_t Depth
+		);
+
+	//
+	// Return the fields of a structure, sorted by label.
+	//
+
+	void
+	GetFields(
+		__in const GffFileReader::GffStruct & Struct,
+		__out FieldInfoVec & Fields,
+		__in size_t Depth
+		);
+
+	//
+	// Return the hashes of the elements of a list field.
+	//
+
+	void
+	GetListHashes(
+		__in const GffFileReader::GffStruct & Struct,
+		__in GffFileReader::FIELD_INDEX FieldIndex,
+		__out HashVec & Hashes,
+		__in size_t Depth
+		);
+
+private:
+
+	//
+	// Structures are identified by their on-disk descriptor.
+	//
+
+	struct StructKey
+	{
+		ULONG Type;
+		ULONG DataOrDataOffset;
+		ULONG FieldCount;
+
+		inline
+		bool
+		operator<(
+			__in const StructKey & other
+			) const
+		{
+			if (Type != other.Type)
+				return (Type < other.Type);
+			if (DataOrDataOffset != other.DataOrDataOffset)
+				return (DataOrDataOffset < other.DataOrDataOffset);
+
+			return (FieldCount < other.FieldCount);
+		}
+	};
+
+	typedef std::map< StructKey, ULONGLONG > StructHashMap;
+
+	StructHashMap m_Hashes;
+
+};
+
+ULONGLONG
+GffPatch::StructHashCache::GetStructHash(
+	__in const GffFileReader::GffStruct & Struct,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the hash of a structure, computing it (and the hashes
+	of all child structures) on first use.
+
+Arguments:
+
+	Struct - Supplies the structure to hash.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	The routine returns the structure hash.  On failure, an std::exception is
+	raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const GffFileReader::GFF_STRUCT_ENTRY & Entry = Struct.GetStructEntry( );
+	StructKey                               Key;
+	StructHashMap::const_iterator           it;
+	FieldInfoVec                            Fields;
+	ULONGLONG                               Hash;
+
+	Key.Type             = Entry.Type;
+	Key.DataOrDataOffset = Entry.DataOrDataOffset;
+	Key.FieldCount       = Entry.FieldCount;
+
+	it = m_Hashes.find( Key );
+
+	if (it != m_Hashes.end( ))
+		return it->second;
+
+	GetFields( Struct, Fields, Depth );
+
+	Hash = GffHashData( &Key.Type, sizeof( Key.Type ), GFF_HASH_INITIAL );
+
+	for (FieldInfoVec::const_iterator fit = Fields.begin( );
+	     fit != Fields.end( );
+	     ++fit)
+	{
+		Hash = GffHashData( &fit->Hash, sizeof( fit->Hash ), Hash );
+	}
+
+	m_Hashes.insert( StructHashMap::value_type( Key, Hash ) );
+
+	return Hash;
+}
+
+void
+GffPatch::StructHashCache::GetFields(
+	__in const GffFileReader::GffStruct & Struct,
+	__out FieldInfoVec & Fields,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine describes each field of a structure, including a hash of the
+	field's label, type and contents.
+
+Arguments:
+
+	Struct - Supplies the structure to describe.
+
+	Fields - Receives the fields, sorted by label.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > FieldData;
+	std::string                  FieldName;
+	bool                         Complex;
+
+	if (Depth > MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	Fields.resize( Struct.GetFieldCount( ) );
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < Struct.GetFieldCount( ); i += 1)
+	{
+		FieldInfo & Field = Fields[ i ];
+		ULONG       Type;
+
+		Field.Index = i;
+
+		if (!Struct.GetFieldName( i, Field.Label ))
+			throw std::runtime_error( "Failed to retrieve field label." );
+
+		if (!Struct.GetFieldType( i, Field.Type ))
+			throw std::runtime_error( "Failed to query field type." );
+
+		Type       = (ULONG) Field.Type;
+		Field.Hash = GffHashData( Field.Label.c_str( ), Field.Label.size( ) + 1, GFF_HASH_INITIAL );
+		Field.Hash = GffHashData( &Type, sizeof( Type ), Field.Hash );
+
+		switch (Field.Type)
+		{
+
+		case GffFileReader::GFF_STRUCT:
+			{
+				GffFileReader::GffStruct Child;
+				ULONGLONG                ChildHash;
+
+				if (!Struct.GetStructByIndex( i, Child ))
+					throw std::runtime_error( "Failed to retrieve structure by index." );
+
+				ChildHash  = GetStructHash( Child, Depth + 1 );
+				Field.Hash = GffHashData( &ChildHash, sizeof( ChildHash ), Field.Hash );
+			}
+			break;
+
+		case GffFileReader::GFF_LIST:
+			{
+				HashVec Hashes;
+				ULONG   Count;
+
+				GetListHashes( Struct, i, Hashes, Depth );
+
+				Count      = (ULONG) Hashes.size( );
+				Field.Hash = GffHashData( &Count, sizeof( Count ), Field.Hash );
+
+				if (!Hashes.empty( ))
+				{
+					Field.Hash = GffHashData(
+						&Hashes[ 0 ],
+						Hashes.size( ) * sizeof( ULONGLONG ),
+						Field.Hash);
+				}
+			}
+			break;
+
+		default:
+			{
+				GffFileReader::GFF_FIELD_TYPE FieldType;
+				ULONG                         Length;
+
+				if (!Struct.GetFieldRawData( i, FieldData, FieldName, FieldType, Complex ))
+					throw std::runtime_error( "Failed to retrieve field raw data." );
+
+				Length     = (ULONG) FieldData.size( );
+				Field.Hash = GffHashData( &Length, sizeof( Length ), Field.Hash );
+
+				if (!FieldData.empty( ))
+					Field.Hash = GffHashData( &FieldData[ 0 ], FieldData.size( ), Field.Hash );
+			}
+			break;
+
+		}
+	}
+
+	std::sort( Fields.begin( ), Fields.end( ) );
+}
+
+void
+GffPatch::StructHashCache::GetListHashes(
+	__in const GffFileReader::GffStruct & Struct,
+	__in GffFileReader::FIELD_INDEX FieldIndex,
+	__out HashVec & Hashes,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the hash of each element of a list field.
+
+Arguments:
+
+	Struct - Supplies the structure that contains the list.
+
+	FieldIndex - Supplies the field index of the list.
+
+	Hashes - Receives the hash of each list element, in list order.
+
+	Depth - Supplies the nesting depth of the structure that contains the
+	        list.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	GffFileReader::GffStruct Element;
+
+	Hashes.clear( );
+
+	for (size_t i = 0; i <= ULONG_MAX; i += 1)
+	{
+		if (!Struct.GetListElementByIndex( FieldIndex, i, Element ))
+			break;
+
+		Hashes.push_back( GetStructHash( Element, Depth + 1 ) );
+	}
+}
+
+//
+// Define the patch builder, which writes the patch operations that turn one
+// structure into another.
+//
+
+class GffPatch::PatchBuilder
+{
+
+public:
+
+	inline
+	PatchBuilder(
+		__inout PatchData & Patch,
+		__inout PatchStats & Stats
+		)
+	: m_Patch( Patch ),
+	  m_Stats( Stats )
+	{
+	}
+
+	//
+	// Write the patch of a structure.
+	//
+
+	void
+	DiffStruct(
+		__in const GffFileReader::GffStruct & Base,
+		__in const GffFileReader::GffStruct & Target,
+		__in size_t Depth
+		);
+
+	//
+	// Append raw data to the patch.
+	//
+
+	inline
+	void
+	WriteData(
+		__in_bcount( Length ) const void * Data,
+		__in size_t Length
+		)
+	{
+		m_Patch.insert(
+			m_Patch.end( ),
+			(const unsigned char *) Data,
+			(const unsigned char *) Data + Length);
+	}
+
+	inline
+	void
+	WriteByte(
+		__in unsigned char Value
+		)
+	{
+		m_Patch.push_back( Value );
+	}
+
+	inline
+	void
+	WriteUlong(
+		__in ULONG Value
+		)
+	{
+		WriteData( &Value, sizeof( Value ) );
+	}
+
+	inline
+	void
+	WriteLabel(
+		__in const std::string & Label
+		)
+	{
+		WriteByte( (unsigned char) Label.size( ) );
+		WriteData( Label.data( ), Label.size( ) );
+	}
+
+	StructHashCache BaseCache;
+	StructHashCache TargetCache;
+
+private:
+
+	//
+	// Write the patch of a list field.
+	//
+
+	void
+	DiffList(
+		__in const GffFileReader::GffStruct & Base,
+		__in GffFileReader::FIELD_INDEX BaseIndex,
+		__in const GffFileReader::GffStruct & Target,
+		__in GffFileReader::FIELD_INDEX TargetIndex,
+		__in size_t Depth
+		);
+
+	//
+	// Write an operation that adds a field of the target.
+	//
+
+	void
+	WriteAddField(
+		__in const GffFileReader::GffStruct & Target,
+		__in const StructHashCache::FieldInfo & Field,
+		__in size_t Depth
+		);
+
+	//
+	// Write the type, length and raw data of a data field.
+	//
+
+	void
+	WriteFieldData(
+		__in const GffFileReader::GffStruct & Struct,
+		__in GffFileReader::FIELD_INDEX FieldIndex
+		);
+
+	//
+	// Write a structure in full.
+	//
+
+	void
+	WriteFullStruct(
+		__in const GffFileReader::GffStruct & Struct,
+		__in size_t Depth
+		);
+
+	PatchBuilder &
+	operator=(
+		__in const PatchBuilder & other
+		);
+
+	PatchData  & m_Patch;
+	PatchStats & m_Stats;
+
+};
+
+void
+GffPatch::PatchBuilder::DiffStruct(
+	__in const GffFileReader::GffStruct & Base,
+	__in const GffFileReader::GffStruct & Target,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the patch of a structure.  Fields are matched by
+	label; fields whose hashes are equal are skipped without being visited.
+
+Arguments:
+
+	Base - Supplies the structure of the base file.
+
+	Target - Supplies the structure of the target file.
+
+	Depth - Supplies the nesting depth of the structures.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	StructHashCache::FieldInfoVec                 BaseFields;
+	StructHashCache::FieldInfoVec                 TargetFields;
+	StructHashCache::FieldInfoVec::const_iterator bit;
+	StructHashCache::FieldInfoVec::const_iterator tit;
+
+	m_Stats.StructsCompared += 1;
+
+	if (Base.GetType( ) != Target.GetType( ))
+	{
+		WriteByte( PatchOpSetType );
+		WriteUlong( Target.GetType( ) );
+	}
+
+	BaseCache.GetFields( Base, BaseFields, Depth );
+	TargetCache.GetFields( Target, TargetFields, Depth );
+
+	bit = BaseFields.begin( );
+	tit = TargetFields.begin( );
+
+	while ((bit != BaseFields.end( )) || (tit != TargetFields.end( )))
+	{
+		//
+		// Fields that are only present in the base file are removed, and
+		// fields that are only present in the target file are added.
+		//
+
+		if ((tit == TargetFields.end( )) ||
+		    ((bit != BaseFields.end( )) && (bit->Label < tit->Label)))
+		{
+			WriteByte( PatchOpRemoveField );
+			WriteLabel( bit->Label );
+
+			m_Stats.FieldsRemoved += 1;
+			++bit;
+			continue;
+		}
+
+		if ((bit == BaseFields.end( )) || (tit->Label < bit->Label))
+		{
+			WriteAddField( Target, *tit, Depth );
+
+			m_Stats.FieldsAdded += 1;
+			++tit;
+			continue;
+		}
+
+		//
+		// The field is present in both files.  Unchanged fields (including
+		// entire unchanged subtrees) are skipped.
+		//
+
+		if (bit->Hash == tit->Hash)
+		{
+			++bit;
+			++tit;
+			continue;
+		}
+
+		if ((bit->Type == GffFileReader::GFF_STRUCT) &&
+		    (tit->Type == GffFileReader::GFF_STRUCT))
+		{
+			GffFileReader::GffStruct BaseChild;
+			GffFileReader::GffStruct TargetChild;
+
+			if ((!Base.GetStructByIndex( bit->Index, BaseChild )) ||
+			    (!Target.GetStructByIndex( tit->Index, TargetChild )))
+			{
+				throw std::runtime_error( "Failed to retrieve structure by index." );
+			}
+
+			if (Depth >= MAX_DEPTH)
+				throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+			WriteByte( PatchOpPatchStruct );
+			WriteLabel( tit->Label );
+			DiffStruct( BaseChild, TargetChild, Depth + 1 );
+		}
+		else if ((bit->Type == GffFileReader::GFF_LIST) &&
+		         (tit->Type == GffFileReader::GFF_LIST))
+		{
+			WriteByte( PatchOpPatchList );
+			WriteLabel( tit->Label );
+			DiffList( Base, bit->Index, Target, tit->Index, Depth );
+		}
+		else if ((IsDataFieldType( bit->Type )) &&
+		         (IsDataFieldType( tit->Type )))
+		{
+			WriteByte( PatchOpChangeDataField );
+			WriteLabel( tit->Label );
+			WriteFieldData( Target, tit->Index );
+
+			m_Stats.FieldsChanged += 1;
+		}
+		else
+		{
+			//
+			// The field changed between a data field, a structure and a list,
+			// so replace it entirely.
+			//
+
+			WriteByte( PatchOpRemoveField );
+			WriteLabel( bit->Label );
+			WriteAddField( Target, *tit, Depth );
+
+			m_Stats.FieldsChanged += 1;
+		}
+
+		++bit;
+		++tit;
+	}
+
+	WriteByte( PatchOpEnd );
+}
+
+void
+GffPatch::PatchBuilder::DiffList(
+	__in const GffFileReader::GffStruct & Base,
+	__in GffFileReader::FIELD_INDEX BaseIndex,
+	__in const GffFileReader::GffStruct & Target,
+	__in GffFileReader::FIELD_INDEX TargetIndex,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the patch of a list field.  Each target element is
+	first matched to an unused base element with the same hash (preferring
+	the element at the same position), so that unchanged elements, including
+	elements that moved, are kept by reference.  The remaining target elements
+	are paired in order with the remaining base elements and patched, and any
+	target elements left over are stored in full.
+
+Arguments:
+
+	Base - Supplies the structure of the base file that contains the list.
+
+	BaseIndex - Supplies the field index of the list in the base structure.
+
+	Target - Supplies the structure of the target file that contains the list.
+
+	TargetIndex - Supplies the field index of the list in the target structure.
+
+	Depth - Supplies the nesting depth of the structures that contain the
+	        list.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< ULONGLONG, std::vector< size_t > > HashIndexMap;
+
+	const size_t             NO_MATCH = (size_t) -1;
+	StructHashCache::HashVec BaseHashes;
+	StructHashCache::HashVec TargetHashes;
+	std::vector< size_t >    Match;
+	std::vector< bool >      Used;
+	HashIndexMap             BaseIndexByHash;
+	std::vector< size_t >    Unused;
+	std::vector< size_t >    InOrder;
+	size_t                   Kept;
+	size_t                   NextUnused;
+
+	if (Depth >= MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	BaseCache.GetListHashes( Base, BaseIndex, BaseHashes, Depth );
+	TargetCache.GetListHashes( Target, TargetIndex, TargetHashes, Depth );
+
+	Match.resize( TargetHashes.size( ), NO_MATCH );
+	Used.resize( BaseHashes.size( ), false );
+
+	//
+	// First, keep elements that are unchanged in place.
+	//
+
+	for (size_t j = 0; j < TargetHashes.size( ); j += 1)
+	{
+		if ((j < BaseHashes.size( )) && (BaseHashes[ j ] == TargetHashes[ j ]))
+		{
+			Match[ j ] = j;
+			Used[ j ]  = true;
+		}
+	}
+
+	//
+	// Next, find unchanged elements that moved.
+	//
+
+	for (size_t i = 0; i < BaseHashes.size( ); i += 1)
+	{
+		if (!Used[ i ])
+			BaseIndexByHash[ BaseHashes[ i ] ].push_back( i );
+	}
+
+	for (size_t j = 0; j < TargetHashes.size( ); j += 1)
+	{
+		HashIndexMap::iterator it;
+
+		if (Match[ j ] != NO_MATCH)
+			continue;
+
+		it = BaseIndexByHash.find( TargetHashes[ j ] );
+
+		if ((it == BaseIndexByHash.end( )) || (it->second.empty( )))
+			continue;
+
+		Match[ j ] = it->second.front( );
+		Used[ Match[ j ] ] = true;
+
+		it->second.erase( it->second.begin( ) );
+	}
+
+	for (size_t i = 0; i < BaseHashes.size( ); i += 1)
+	{
+		if (!Used[ i ])
+			Unused.push_back( i );
+	}
+
+	//
+	// The kept elements that stay in their relative order are the longest
+	// increasing run of their base indicies; any other kept element moved.
+	// InOrder[ n ] holds the smallest base index that ends such a run of
+	// length n + 1.
+	//
+
+	Kept = 0;
+
+	for (size_t j = 0; j < TargetHashes.size( ); j += 1)
+	{
+		std::vector< size_t >::iterator it;
+
+		if (Match[ j ] == NO_MATCH)
+			continue;
+
+		Kept += 1;
+		it    = std::lower_bound( InOrder.begin( ), InOrder.end( ), Match[ j ] );
+
+		if (it == InOrder.end( ))
+			InOrder.push_back( Match[ j ] );
+		else
+			*it = Match[ j ];
+	}
+
+	m_Stats.ElementsMoved += (ULONG) (Kept - InOrder.size( ));
+
+	//
+	// Now write the element operations in target order.
+	//
+
+	WriteUlong( (ULONG) TargetHashes.size( ) );
+
+	NextUnused = 0;
+
+	for (size_t j = 0; j < TargetHashes.size( ); )
+	{
+		if (Match[ j ] != NO_MATCH)
+		{
+			size_t Count;
+
+			//
+			// Keep a run of elements with consecutive base indicies.
+			//
+
+			for (Count = 1; j + Count < TargetHashes.size( ); Count += 1)
+			{
+				if (Match[ j + Count ] != Match[ j ] + Count)
+					break;
+			}
+
+			WriteByte( ElementOpKeep );
+			WriteUlong( (ULONG) Match[ j ] );
+			WriteUlong( (ULONG) Count );
+
+			j += Count;
+			continue;
+		}
+
+		if (NextUnused < Unused.size( ))
+		{
+			GffFileReader::GffStruct BaseElement;
+			GffFileReader::GffStruct TargetElement;
+			size_t                   i = Unused[ NextUnused++ ];
+
+			if ((!Base.GetListElementByIndex( BaseIndex, i, BaseElement )) ||
+			    (!Target.GetListElementByIndex( TargetIndex, j, TargetElement )))
+			{
+				throw std::runtime_error( "Failed to retrieve list element." );
+			}
+
+			WriteByte( ElementOpPatch );
+			WriteUlong( (ULONG) i );
+			DiffStruct( BaseElement, TargetElement, Depth + 1 );
+
+			m_Stats.ElementsChanged += 1;
+		}
+		else
+		{
+			GffFileReader::GffStruct TargetElement;
+
+			if (!Target.GetListElementByIndex( TargetIndex, j, TargetElement ))
+				throw std::runtime_error( "Failed to retrieve list element." );
+
+			WriteByte( ElementOpNew );
+			WriteFullStruct( TargetElement, Depth + 1 );
+
+			m_Stats.ElementsAdded += 1;
+		}
+
+		j += 1;
+	}
+
+	m_Stats.ElementsRemoved += (ULONG) (Unused.size( ) - NextUnused);
+}
+
+void
+GffPatch::PatchBuilder::WriteAddField(
+	__in const GffFileReader::GffStruct & Target,
+	__in const StructHashCache::FieldInfo & Field,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine writes an operation that adds a field of the target file.
+
+Arguments:
+
+	Target - Supplies the structure of the target file that holds the field.
+
+	Field - Supplies the field to add.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Field.Type)
+	{
+
+	case GffFileReader::GFF_STRUCT:
+		{
+			GffFileReader::GffStruct Child;
+
+			if (!Target.GetStructByIndex( Field.Index, Child ))
+				throw std::runtime_error( "Failed to retrieve structure by index." );
+
+			WriteByte( PatchOpAddStructField );
+			WriteLabel( Field.Label );
+			WriteFullStruct( Child, Depth + 1 );
+		}
+		break;
+
+	case GffFileReader::GFF_LIST:
+		{
+			GffFileReader::GffStruct Element;
+			size_t                   CountOffset;
+			ULONG                    Count;
+
+			WriteByte( PatchOpAddListField );
+			WriteLabel( Field.Label );
+
+			CountOffset = m_Patch.size( );
+			WriteUlong( 0 );
+
+			for (Count = 0; Count < ULONG_MAX; Count += 1)
+			{
+				if (!Target.GetListElementByIndex( Field.Index, Count, Element ))
+					break;
+
+				WriteFullStruct( Element, Depth + 1 );
+			}
+
+			memcpy( &m_Patch[ CountOffset ], &Count, sizeof( Count ) );
+		}
+		break;
+
+	default:
+		WriteByte( PatchOpAddDataField );
+		WriteLabel( Field.Label );
+		WriteFieldData( Target, Field.Index );
+		break;
+
+	}
+}
+
+void
+GffPatch::PatchBuilder::WriteFieldData(
+	__in const GffFileReader::GffStruct & Struct,
+	__in GffFileReader::FIELD_INDEX FieldIndex
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the type, length and raw data of a data field.
+
+Arguments:
+
+	Struct - Supplies the structure that holds the field.
+
+	FieldIndex - Supplies the field index of the field.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char >  FieldData;
+	std::string                   FieldName;
+	GffFileReader::GFF_FIELD_TYPE FieldType;
+	bool                          Complex;
+
+	if (!Struct.GetFieldRawData( FieldIndex, FieldData, FieldName, FieldType, Complex ))
+		throw std::runtime_error( "Failed to retrieve field raw data." );
+
+	WriteByte( (unsigned char) FieldType );
+	WriteUlong( (ULONG) FieldData.size( ) );
+
+	if (!FieldData.empty( ))
+		WriteData( &FieldData[ 0 ], FieldData.size( ) );
+}
+
+void
+GffPatch::PatchBuilder::WriteFullStruct(
+	__in const GffFileReader::GffStruct & Struct,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine writes a structure in full: its type, its field count, and
+	then the label, type and contents of each field, in field order.
+
+Arguments:
+
+	Struct - Supplies the structure to write.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Depth > MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	WriteUlong( Struct.GetType( ) );
+	WriteUlong( Struct.GetFieldCount( ) );
+
+	for (GffFileReader::FIELD_INDEX i = 0; i < Struct.GetFieldCount( ); i += 1)
+	{
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+		std::string                   Label;
+
+		if (!Struct.GetFieldName( i, Label ))
+			throw std::runtime_error( "Failed to retrieve field label." );
+
+		if (!Struct.GetFieldType( i, FieldType ))
+			throw std::runtime_error( "Failed to query field type." );
+
+		WriteLabel( Label );
+
+		switch (FieldType)
+		{
+
+		case GffFileReader::GFF_STRUCT:
+			{
+				GffFileReader::GffStruct Child;
+
+				if (!Struct.GetStructByIndex( i, Child ))
+					throw std::runtime_error( "Failed to retrieve structure by index." );
+
+				WriteByte( (unsigned char) FieldType );
+				WriteFullStruct( Child, Depth + 1 );
+			}
+			break;
+
+		case GffFileReader::GFF_LIST:
+			{
+				GffFileReader::GffStruct Element;
+				size_t                   CountOffset;
+				ULONG                    Count;
+
+				WriteByte( (unsigned char) FieldType );
+
+				CountOffset = m_Patch.size( );
+				WriteUlong( 0 );
+
+				for (Count = 0; Count < ULONG_MAX; Count += 1)
+				{
+					if (!Struct.GetListElementByIndex( i, Count, Element ))
+						break;
+
+					WriteFullStruct( Element, Depth + 1 );
+				}
+
+				memcpy( &m_Patch[ CountOffset ], &Count, sizeof( Count ) );
+			}
+			break;
+
+		default:
+			WriteFieldData( Struct, i );
+			break;
+
+		}
+	}
+}
+
+//
+// Define the patch cursor, which reads a patch and raises an std::exception
+// if the patch is truncated.
+//
+
+class GffPatch::PatchCursor
+{
+
+public:
+
+	inline
+	PatchCursor(
+		__in const PatchData & Patch
+		)
+	: m_Patch( Patch ),
+	  m_Offset( 0 )
+	{
+	}
+
+	inline
+	void
+	Read(
+		__out_bcount( Length ) void * Buffer,
+		__in size_t Length
+		)
+	{
+		if (Length > GetRemaining( ))
+			throw std::runtime_error( "Truncated GFF patch." );
+
+		if (Length != 0)
+			memcpy( Buffer, &m_Patch[ m_Offset ], Length );
+
+		m_Offset += Length;
+	}
+
+	inline
+	unsigned char
+	ReadByte(
+		)
+	{
+		unsigned char Value;
+
+		Read( &Value, sizeof( Value ) );
+
+		return Value;
+	}
+
+	inline
+	ULONG
+	ReadUlong(
+		)
+	{
+		ULONG Value;
+
+		Read( &Value, sizeof( Value ) );
+
+		return Value;
+	}
+
+	//
+	// Read a count of items that each take at least one byte of the patch.
+	//
+
+	inline
+	ULONG
+	ReadCount(
+		)
+	{
+		ULONG Count = ReadUlong( );
+
+		if (Count > GetRemaining( ))
+			throw std::runtime_error( "Truncated GFF patch." );
+
+		return Count;
+	}
+
+	inline
+	std::string
+	ReadLabel(
+		)
+	{
+		unsigned char Length = ReadByte( );
+		char          Label[ 16 ];
+
+		if (Length > sizeof( Label ))
+			throw std::runtime_error( "Invalid field label in GFF patch." );
+
+		Read( Label, Length );
+
+		return std::string( Label, Length );
+	}
+
+	inline
+	void
+	ReadFieldData(
+		__out GffFileReader::GFF_FIELD_TYPE & FieldType,
+		__out std::vector< unsigned char > & FieldData
+		)
+	{
+		FieldType = (GffFileReader::GFF_FIELD_TYPE) ReadByte( );
+
+		ReadFieldContents( FieldType, FieldData );
+	}
+
+	//
+	// Read the length and raw data of a data field whose type byte has
+	// already been read.
+	//
+
+	inline
+	void
+	ReadFieldContents(
+		__in GffFileReader::GFF_FIELD_TYPE FieldType,
+		__out std::vector< unsigned char > & FieldData
+		)
+	{
+		ULONG Length;
+
+		if ((!IsDataFieldType( FieldType )) ||
+		    (FieldType >= GffFileReader::LAST_GFF_FIELD_TYPE))
+		{
+			throw std::runtime_error( "Invalid field type in GFF patch." );
+		}
+
+		Length = ReadCount( );
+
+		FieldData.resize( Length );
+
+		if (Length != 0)
+			Read( &FieldData[ 0 ], Length );
+
+		if (!IsValidFieldData( FieldType, FieldData ))
+			throw std::runtime_error( "Invalid field data in GFF patch." );
+	}
+
+	inline
+	size_t
+	GetRemaining(
+		) const
+	{
+		return m_Patch.size( ) - m_Offset;
+	}
+
+private:
+
+	PatchCursor &
+	operator=(
+		__in const PatchCursor & other
+		);
+
+	const PatchData & m_Patch;
+	size_t            m_Offset;
+
+};
+
+bool
+GffPatch::CreatePatch(
+	__in const GffFileReader & Base,
+	__in const GffFileReader & Target,
+	__out PatchData & Patch,
+	__out_opt PatchStats * Stats /* = NULL */
+	)
+/*++
+
+Routine Description:
+
+	This routine computes a patch that transforms the base file into the
+	target file.
+
+	Every structure of both files is hashed first, so that any subtree that is
+	the same in both files is skipped in constant time while the patch is
+	built.  Field edits are recorded per field, and list edits record which
+	base elements are kept (and where they move to), which are patched, and
+	which new elements are added.
+
+Arguments:
+
+	Base - Supplies the base file.
+
+	Target - Supplies the target file.
+
+	Patch - Receives the patch.
+
+	Stats - Optionally receives the counters of the patch.
+
+Return Value:
+
+	The routine returns true if the files differ, else false if they have the
+	same contents.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PatchStats    LocalStats;
+	PatchBuilder  Builder( Patch, (Stats != NULL) ? *Stats : LocalStats );
+	PATCH_HEADER  Header;
+	bool          Changed;
+
+	C_ASSERT( sizeof( PATCH_HEADER ) == 24 );
+
+	ZeroMemory( &LocalStats, sizeof( LocalStats ) );
+
+	if (Stats != NULL)
+		ZeroMemory( Stats, sizeof( *Stats ) );
+
+	Patch.clear( );
+
+	ZeroMemory( &Header, sizeof( Header ) );
+
+	Header.Signature  = PATCH_SIGNATURE;
+	Header.Version    = PATCH_VERSION;
+	Header.BaseHash   = Builder.BaseCache.GetStructHash( *Base.GetRootStruct( ), 0 );
+	Header.TargetHash = Builder.TargetCache.GetStructHash( *Target.GetRootStruct( ), 0 );
+
+	Builder.WriteData( &Header, sizeof( Header ) );
+
+	Changed = (Header.BaseHash != Header.TargetHash);
+
+	if (Changed)
+		Builder.DiffStruct( *Base.GetRootStruct( ), *Target.GetRootStruct( ), 0 );
+	else
+		Builder.WriteByte( PatchOpEnd );
+
+	return Changed;
+}
+
+void
+GffPatch::ApplyPatch(
+	__in const GffFileReader & Base,
+	__in const PatchData & Patch,
+	__inout GffFileWriter & Writer
+	)
+/*++
+
+Routine Description:
+
+	This routine applies a patch to the base file that it was created against,
+	and stores the resulting target file in a GFF writer.
+
+Arguments:
+
+	Base - Supplies the base file.  Its hash must match the base hash that is
+	       recorded in the patch.
+
+	Patch - Supplies the patch to apply.
+
+	Writer - Supplies an empty writer, which receives the target file.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PatchCursor              Cursor( Patch );
+	PATCH_HEADER             Header;
+	StructHashCache          BaseCache;
+	GffFileWriter::GffStruct Root;
+
+	Cursor.Read( &Header, sizeof( Header ) );
+
+	if ((Header.Signature != PATCH_SIGNATURE) ||
+	    (Header.Version != PATCH_VERSION))
+	{
+		throw std::runtime_error( "Unrecognized GFF patch format." );
+	}
+
+	if (BaseCache.GetStructHash( *Base.GetRootStruct( ), 0 ) != Header.BaseHash)
+		throw std::runtime_error( "GFF patch was not created against this file." );
+
+	Writer.InitializeFromReader( &Base );
+
+	Root = Writer.GetRootStruct( );
+
+	ApplyStructPatch( *Base.GetRootStruct( ), Cursor, Root, 0 );
+
+	if (Cursor.GetRemaining( ) != 0)
+		throw std::runtime_error( "Trailing data in GFF patch." );
+}
+
+ULONGLONG
+GffPatch::HashFile(
+	__in const GffFileReader & Reader
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the content hash of a GFF file.  Two files with the
+	same hash have the same structures and fields, without regard to the
+	order of fields within a structure.
+
+Arguments:
+
+	Reader - Supplies the file to hash.
+
+Return Value:
+
+	The routine returns the content hash.  On failure, an std::exception is
+	raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	StructHashCache Cache;
+
+	return Cache.GetStructHash( *Reader.GetRootStruct( ), 0 );
+}
+
+ULONGLONG
+GffPatch::GetTargetHash(
+	__in const PatchData & Patch
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the content hash of the file that a patch produces,
+	so that the result of ApplyPatch may be checked with HashFile.
+
+Arguments:
+
+	Patch - Supplies the patch.
+
+Return Value:
+
+	The routine returns the target hash.  On failure, an std::exception is
+	raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PatchCursor  Cursor( Patch );
+	PATCH_HEADER Header;
+
+	Cursor.Read( &Header, sizeof( Header ) );
+
+	if ((Header.Signature != PATCH_SIGNATURE) ||
+	    (Header.Version != PATCH_VERSION))
+	{
+		throw std::runtime_error( "Unrecognized GFF patch format." );
+	}
+
+	return Header.TargetHash;
+}
+
+void
+GffPatch::ApplyStructPatch(
+	__in const GffFileReader::GffStruct & Base,
+	__inout PatchCursor & Cursor,
+	__inout GffFileWriter::GffStruct & Writer,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine applies the operations of a structure patch.
+
+Arguments:
+
+	Base - Supplies the structure of the base file.
+
+	Cursor - Supplies the patch cursor, positioned at the structure patch.
+
+	Writer - Supplies the writer structure, which holds a copy of the base
+	         structure with any earlier edits applied.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Depth > MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	for (;;)
+	{
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+		std::string                   Label;
+		unsigned char                 Op;
+		bool                          Exists;
+
+		Op = Cursor.ReadByte( );
+
+		if (Op == PatchOpEnd)
+			break;
+
+		if (Op == PatchOpSetType)
+		{
+			Writer.SetType( Cursor.ReadUlong( ) );
+			continue;
+		}
+
+		Label  = Cursor.ReadLabel( );
+		Exists = Writer.GetFieldType( Label.c_str( ), FieldType );
+
+		//
+		// Additions must not find an existing field, and all other edits must
+		// find one, else the patch does not match the file.
+		//
+
+		if ((Op == PatchOpAddDataField) ||
+		    (Op == PatchOpAddStructField) ||
+		    (Op == PatchOpAddListField))
+		{
+			if (Exists)
+				throw std::runtime_error( "GFF patch adds a field that already exists: " + Label );
+		}
+		else if (!Exists)
+		{
+			throw std::runtime_error( "GFF patch edits a field that does not exist: " + Label );
+		}
+
+		switch (Op)
+		{
+
+		case PatchOpRemoveField:
+			Writer.DeleteField( Label.c_str( ) );
+			break;
+
+		case PatchOpAddDataField:
+		case PatchOpChangeDataField:
+			{
+				if ((Op == PatchOpChangeDataField) && (!IsDataFieldType( FieldType )))
+					throw std::runtime_error( "GFF patch changes data of a field that is not a data field: " + Label );
+
+				std::vector< unsigned char > FieldData;
+
+				Cursor.ReadFieldData( FieldType, FieldData );
+				Writer.SetFieldRawData( Label.c_str( ), FieldType, FieldData );
+			}
+			break;
+
+		case PatchOpAddStructField:
+			{
+				GffFileWriter::GffStruct Child = Writer.CreateStruct( Label.c_str( ) );
+
+				ReadFullStruct( Cursor, Child, Depth + 1 );
+			}
+			break;
+
+		case PatchOpAddListField:
+			{
+				ULONG Count = Cursor.ReadCount( );
+
+				Writer.CreateList( Label.c_str( ) );
+
+				for (ULONG i = 0; i < Count; i += 1)
+				{
+					GffFileWriter::GffStruct Element = Writer.AppendListElement( Label.c_str( ) );
+
+					ReadFullStruct( Cursor, Element, Depth + 1 );
+				}
+			}
+			break;
+
+		case PatchOpPatchStruct:
+			{
+				GffFileReader::GffStruct BaseChild;
+
+				if (FieldType != GffFileReader::GFF_STRUCT)
+					throw std::runtime_error( "GFF patch edits a structure that is not a structure: " + Label );
+
+				if (!Base.GetStruct( Label.c_str( ), BaseChild ))
+					throw std::runtime_error( "GFF patch edits a structure that is not in the base file: " + Label );
+
+				GffFileWriter::GffStruct Child = Writer.CreateStruct( Label.c_str( ) );
+
+				ApplyStructPatch( BaseChild, Cursor, Child, Depth + 1 );
+			}
+			break;
+
+		case PatchOpPatchList:
+			if (FieldType != GffFileReader::GFF_LIST)
+				throw std::runtime_error( "GFF patch edits a list that is not a list: " + Label );
+
+			ApplyListPatch( Base, Label, Cursor, Writer, Depth );
+			break;
+
+		default:
+			throw std::runtime_error( "Invalid operation in GFF patch." );
+
+		}
+	}
+}
+
+void
+GffPatch::ApplyListPatch(
+	__in const GffFileReader::GffStruct & Base,
+	__in const std::string & Label,
+	__inout PatchCursor & Cursor,
+	__inout GffFileWriter::GffStruct & Writer,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine applies a list patch, rebuilding the list of the writer from
+	elements of the base list and new elements.
+
+Arguments:
+
+	Base - Supplies the structure of the base file that contains the list.
+
+	Label - Supplies the label of the list.
+
+	Cursor - Supplies the patch cursor, positioned at the list patch.
+
+	Writer - Supplies the writer structure that contains the list.
+
+	Depth - Supplies the nesting depth of the structure that contains the
+	        list.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG Count;
+	ULONG Built;
+
+	if (Depth >= MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	Count = Cursor.ReadCount( );
+
+	Writer.DeleteField( Label.c_str( ) );
+	Writer.CreateList( Label.c_str( ) );
+
+	for (Built = 0; Built < Count; )
+	{
+		GffFileReader::GffStruct BaseElement;
+		ULONG                    BaseIndex;
+
+		switch (Cursor.ReadByte( ))
+		{
+
+		case ElementOpKeep:
+			{
+				ULONG RunLength;
+
+				BaseIndex = Cursor.ReadUlong( );
+				RunLength = Cursor.ReadUlong( );
+
+				if ((RunLength == 0) || (RunLength > Count - Built))
+					throw std::runtime_error( "Invalid list element run in GFF patch." );
+
+				for (ULONG i = 0; i < RunLength; i += 1)
+				{
+					if (!Base.GetListElement( Label.c_str( ), (size_t) BaseIndex + i, BaseElement ))
+						throw std::runtime_error( "GFF patch keeps a list element that is not in the base file." );
+
+					Writer.AppendListElement(
+						Label.c_str( ),
+						BaseElement.GetType( )).InitializeFromStruct(
+							&BaseElement,
+							MAX_DEPTH - (Depth + 1));
+				}
+
+				Built += RunLength;
+			}
+			break;
+
+		case ElementOpPatch:
+			{
+				BaseIndex = Cursor.ReadUlong( );
+
+				if (!Base.GetListElement( Label.c_str( ), BaseIndex, BaseElement ))
+					throw std::runtime_error( "GFF patch edits a list element that is not in the base file." );
+
+				GffFileWriter::GffStruct Element = Writer.AppendListElement(
+					Label.c_str( ),
+					BaseElement.GetType( ));
+
+				Element.InitializeFromStruct( &BaseElement, MAX_DEPTH - (Depth + 1) );
+
+				ApplyStructPatch( BaseElement, Cursor, Element, Depth + 1 );
+
+				Built += 1;
+			}
+			break;
+
+		case ElementOpNew:
+			{
+				GffFileWriter::GffStruct Element = Writer.AppendListElement( Label.c_str( ) );
+
+				ReadFullStruct( Cursor, Element, Depth + 1 );
+
+				Built += 1;
+			}
+			break;
+
+		default:
+			throw std::runtime_error( "Invalid list element operation in GFF patch." );
+
+		}
+	}
+}
+
+void
+GffPatch::ReadFullStruct(
+	__inout PatchCursor & Cursor,
+	__inout GffFileWriter::GffStruct & Writer,
+	__in size_t Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine builds a structure that is stored in full in a patch.
+
+Arguments:
+
+	Cursor - Supplies the patch cursor, positioned at the structure.
+
+	Writer - Supplies the new, empty writer structure to build.
+
+	Depth - Supplies the nesting depth of the structure.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG FieldCount;
+
+	if (Depth > MAX_DEPTH)
+		throw std::runtime_error( "Exceeded maximum nested structure depth." );
+
+	Writer.SetType( Cursor.ReadUlong( ) );
+
+	FieldCount = Cursor.ReadCount( );
+
+	for (ULONG i = 0; i < FieldCount; i += 1)
+	{
+		GffFileReader::GFF_FIELD_TYPE FieldType;
+		std::string                   Label;
+
+		Label     = Cursor.ReadLabel( );
+		FieldType = (GffFileReader::GFF_FIELD_TYPE) Cursor.ReadByte( );
+
+		switch (FieldType)
+		{
+
+		case GffFileReader::GFF_STRUCT:
+			{
+				GffFileWriter::GffStruct Child = Writer.CreateStruct( Label.c_str( ) );
+
+				ReadFullStruct( Cursor, Child, Depth + 1 );
+			}
+			break;
+
+		case GffFileReader::GFF_LIST:
+			{
+				ULONG Count = Cursor.ReadCount( );
+
+				Writer.CreateList( Label.c_str( ) );
+
+				for (ULONG j = 0; j < Count; j += 1)
+				{
+					GffFileWriter::GffStruct Element = Writer.AppendListElement( Label.c_str( ) );
+
+					ReadFullStruct( Cursor, Element, Depth + 1 );
+				}
+			}
+			break;
+
+		default:
+			{
+				std::vector< unsigned char > FieldData;
+
+				Cursor.ReadFieldContents( FieldType, FieldData );
+				Writer.SetFieldRawData( Label.c_str( ), FieldType, FieldData );
+			}
+			break;
+
+		}
+	}
+}
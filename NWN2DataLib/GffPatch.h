@@ -0,0 +1,213 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	GffPatch.h
+
+Abstract:
+
+	This module defines the GFF patch object, which computes a compact binary
+	patch describing the structural differences between two GFF files, and
+	applies such a patch to produce the second file from the first.
+
+	Every structure is hashed once up front, so that identical subtrees are
+	skipped without being visited when the patch is built.  Field order is not
+	significant; fields are compared by label.
+
+--*/
+
+#ifndef _PROGRAMS_NWN2DATALIB_GFFPATCH_H
+#define _PROGRAMS_NWN2DATALIB_GFFPATCH_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include "GffFileReader.h"
+#include "GffFileWriter.h"
+
+class GffPatch
+{
+
+public:
+
+	typedef std::vector< unsigned char > PatchData;
+
+	//
+	// Define the counters of a patch.  List element moves count the fewest
+	// unchanged elements that had to move to reach the new list order.
+	//
+
+	struct PatchStats
+	{
+		ULONG StructsCompared;
+		ULONG FieldsAdded;
+		ULONG FieldsRemoved;
+		ULONG FieldsChanged;
+		ULONG ElementsAdded;
+		ULONG ElementsRemoved;
+		ULONG ElementsMoved;
+		ULONG ElementsChanged;
+	};
+
+	//
+	// Compute a patch that transforms Base into Target.  The routine returns
+	// true if the files differ, else false (in which case the patch is still
+	// valid, and contains no edits).  An std::exception is raised on failure.
+	//
+
+	static
+	bool
+	CreatePatch(
+		__in const GffFileReader & Base,
+		__in const GffFileReader & Target,
+		__out PatchData & Patch,
+		__out_opt PatchStats * Stats = NULL
+		);
+
+	//
+	// Apply a patch created against Base.  The writer, which must be empty,
+	// receives the contents of the target file.  An std::exception is raised
+	// if the patch is malformed, or was not created against Base.
+	//
+
+	static
+	void
+	ApplyPatch(
+		__in const GffFileReader & Base,
+		__in const PatchData & Patch,
+		__inout GffFileWriter & Writer
+		);
+
+	//
+	// Return the content hash of a GFF file, as recorded in a patch for the
+	// base and target files.
+	//
+
+	static
+	ULONGLONG
+	HashFile(
+		__in const GffFileReader & Reader
+		);
+
+	//
+	// Return the content hash of the target file that a patch produces.
+	//
+
+	static
+	ULONGLONG
+	GetTargetHash(
+		__in const PatchData & Patch
+		);
+
+private:
+
+	class StructHashCache;
+	class PatchBuilder;
+	class PatchCursor;
+
+	//
+	// Define the patch header.
+	//
+
+	enum
+	{
+		PATCH_SIGNATURE = 'PFFG',
+		PATCH_VERSION   = 1
+	};
+
+	typedef struct _PATCH_HEADER
+	{
+		ULONG     Signature;   // PATCH_SIGNATURE
+		ULONG     Version;     // PATCH_VERSION
+		ULONGLONG BaseHash;
+		ULONGLONG TargetHash;
+	} PATCH_HEADER, * PPATCH_HEADER;
+
+	typedef const struct _PATCH_HEADER * PCPATCH_HEADER;
+
+	//
+	// Define the operations of a structure patch.  A structure patch is a
+	// sequence of operations ended by PatchOpEnd.  Labels are stored as a
+	// length byte followed by the label text.
+	//
+
+	typedef enum _PATCH_OP
+	{
+		PatchOpEnd             = 0, // End of structure
+		PatchOpSetType         = 1, // ULONG StructType
+		PatchOpRemoveField     = 2, // Label
+		PatchOpAddDataField    = 3, // Label, BYTE Type, ULONG Length, Data
+		PatchOpChangeDataField = 4, // Label, BYTE Type, ULONG Length, Data
+		PatchOpAddStructField  = 5, // Label, Full structure
+		PatchOpAddListField    = 6, // Label, ULONG Count, Full structures
+		PatchOpPatchStruct     = 7, // Label, Structure patch
+		PatchOpPatchList       = 8, // Label, ULONG Count, Element operations
+
+		LastPatchOp
+	} PATCH_OP, * PPATCH_OP;
+
+	//
+	// Define the element operations of a list patch, which build the new list
+	// in order from elements of the base list and new elements.
+	//
+
+	typedef enum _ELEMENT_OP
+	{
+		ElementOpKeep          = 0, // ULONG BaseIndex, ULONG Count
+		ElementOpPatch         = 1, // ULONG BaseIndex, Structure patch
+		ElementOpNew           = 2, // Full structure
+
+		LastElementOp
+	} ELEMENT_OP, * PELEMENT_OP;
+
+	//
+	// Define the maximum nesting depth of structures, as per GffFileWriter.
+	//
+
+	enum { MAX_DEPTH = 32 };
+
+	//
+	// Apply a structure patch.
+	//
+
+	static
+	void
+	ApplyStructPatch(
+		__in const GffFileReader::GffStruct & Base,
+		__inout PatchCursor & Cursor,
+		__inout GffFileWriter::GffStruct & Writer,
+		__in size_t Depth
+		);
+
+	//
+	// Apply a list patch.
+	//
+
+	static
+	void
+	ApplyListPatch(
+		__in const GffFileReader::GffStruct & Base,
+		__in const std::string & Label,
+		__inout PatchCursor & Cursor,
+		__inout GffFileWriter::GffStruct & Writer,
+		__in size_t Depth
+		);
+
+	//
+	// Build a structure stored in full in a patch.
+	//
+
+	static
+	void
+	ReadFullStruct(
+		__inout PatchCursor & Cursor,
+		__inout GffFileWriter::GffStruct & Writer,
+		__in size_t Depth
+		);
+
+};
+
+#endif
@@ -0,0 +1,1128 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ModuleScan.cpp
+
+Abstract:
+
+	This module houses the module scan object, which runs a visitor over a set
+	of module resources on a pool of worker threads.
+
+	The resource manager is not safe for concurrent use, so every resource is
+	located on the calling thread before the workers start.  Each worker then
+	parses the located files with its own readers (and its own mesh manager),
+	and the output of each item is printed in item order.
+
+--*/
+
+#include "Precomp.h"
+#include "ModuleScan.h"
+
+//
+// Define the text out interface handed to a visitor, which holds the messages
+// of one item until they can be printed in order.
+//
+
+class ModuleScan::ScanTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	{
+		Message Msg;
+		char    buf[8193];
+
+		StringCbVPrintfA( buf, sizeof( buf ), fmt, argptr );
+
+		Msg.Attributes = Attributes;
+		Msg.Text       = buf;
+
+		m_Messages.push_back( Msg );
+	}
+
+	//
+	// Write all held messages to another text out interface.
+	//
+
+	inline
+	void
+	Flush(
+		__in IDebugTextOut * TextOut
+		)
+	{
+		for (MessageVec::const_iterator it = m_Messages.begin( );
+		     it != m_Messages.end( );
+		     ++it)
+		{
+			TextOut->WriteText( it->Attributes, "%s", it->Text.c_str( ) );
+		}
+
+		m_Messages.clear( );
+	}
+
+private:
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	struct Message
+	{
+		WORD        Attributes;
+		std::string Text;
+	};
+
+	typedef std::vector< Message > MessageVec;
+
+	MessageVec m_Messages;
+
+};
+
+ModuleScan::ScanContext::ScanContext(
+	__in ModuleScan * Scan
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new worker thread context.
+
+Arguments:
+
+	Scan - Supplies the module scan that the worker belongs to.
+
+Return Value:
+
+	The newly constructed object.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_Scan( Scan ),
+  m_ResourceManager( &Scan->m_ResourceManager ),
+  m_Item( NULL ),
+  m_ItemIndex( 0 ),
+  m_TextOut( NULL )
+{
+	m_GffReaders.resize( Scan->m_ScanTypes.size( ) );
+	m_TrxReaders.resize( Scan->m_ScanTypes.size( ) );
+}
+
+ModuleScan::ScanContext::~ScanContext(
+	)
+/*++
+
+Routine Description:
+
+	This routine cleans up a worker thread context.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	EndItem( );
+}
+
+const std::string &
+ModuleScan::ScanContext::GetFileName(
+	__in ResType Type
+	) const
+/*++
+
+Routine Description:
+
+	This routine returns the file name of the current item's resource of a
+	given type.
+
+Arguments:
+
+	Type - Supplies the resource type, which must be one of the scan types.
+
+Return Value:
+
+	The routine returns the file name, or an empty string if the item has no
+	resource of the given type.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	return m_Item->FileNames[ GetTypeIndex( Type ) ];
+}
+
+const GffFileReader *
+ModuleScan::ScanContext::GetGffReader(
+	__in ResType Type
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a GFF reader for the current item's resource of a
+	given type, parsing the file the first time that it is requested.
+
+Arguments:
+
+	Type - Supplies the resource type, which must be one of the scan types.
+
+Return Value:
+
+	The routine returns the GFF reader.  An std::exception is raised on
+	failure, including if the item has no resource of the given type.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	size_t Index = GetTypeIndex( Type );
+
+	if (m_GffReaders[ Index ].get( ) == NULL)
+	{
+		const std::string & FileName = m_Item->FileNames[ Index ];
+
+		if (FileName.empty( ))
+			throw std::runtime_error( "Resource not present for scan item." );
+
+		m_GffReaders[ Index ] = new GffFileReader( FileName, *m_ResourceManager );
+	}
+
+	return m_GffReaders[ Index ].get( );
+}
+
+TrxFileReader *
+ModuleScan::ScanContext::GetTrxReader(
+	__in ResType Type,
+	__in bool LoadOnlyDimensions,
+	__in bool RefuseDisplayOnlyModels
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a TRX reader for the current item's resource of a
+	given type (typically .trx or .trn), parsing the file the first time that
+	it is requested.  An .mdb resource is parsed as a model.  Meshes are
+	registered with the worker's mesh manager.
+
+Arguments:
+
+	Type - Supplies the resource type, which must be one of the scan types.
+
+	LoadOnlyDimensions - Supplies a Boolean value that indicates true if only
+	                     the area dimensions are to be loaded.  The value is
+	                     only used the first time the reader is requested for
+	                     an item.
+
+	RefuseDisplayOnlyModels - Supplies a Boolean value that indicates true if
+	                          meshes that are only used for display (such as
+	                          terrain and water) are not to be loaded.  Only
+	                          the walkmesh and collision data are loaded.  The
+	                          value is only used the first time the reader is
+	                          requested for an item.
+
+Return Value:
+
+	The routine returns the TRX reader.  An std::exception is raised on
+	failure, including if the item has no resource of the given type.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	size_t Index = GetTypeIndex( Type );
+
+	if (m_TrxReaders[ Index ].get( ) == NULL)
+	{
+		const std::string & FileName = m_Item->FileNames[ Index ];
+
+		if (FileName.empty( ))
+			throw std::runtime_error( "Resource not present for scan item." );
+
+		m_TrxReaders[ Index ] = new TrxFileReader(
+			m_MeshManager,
+			FileName,
+			LoadOnlyDimensions,
+			(Type == NWN::ResMDB) ? TrxFileReader::ModeMDB : TrxFileReader::ModeTRX,
+			NULL,
+			RefuseDisplayOnlyModels);
+	}
+
+	return m_TrxReaders[ Index ].get( );
+}
+
+void
+ModuleScan::ScanContext::BeginItem(
+	__in size_t ItemIndex,
+	__in IDebugTextOut * TextOut
+	)
+/*++
+
+Routine Description:
+
+	This routine prepares the context for a new item.
+
+Arguments:
+
+	ItemIndex - Supplies the index of the item.
+
+	TextOut - Supplies the text out interface of the item.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	m_Item      = &m_Scan->m_Items[ ItemIndex ];
+	m_ItemIndex = ItemIndex;
+	m_TextOut   = TextOut;
+}
+
+void
+ModuleScan::ScanContext::EndItem(
+	)
+/*++
+
+Routine Description:
+
+	This routine releases the readers of the last item.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	for (size_t i = 0; i < m_GffReaders.size( ); i += 1)
+		m_GffReaders[ i ] = NULL;
+
+	for (size_t i = 0; i < m_TrxReaders.size( ); i += 1)
+		m_TrxReaders[ i ] = NULL;
+
+	m_Item    = NULL;
+	m_TextOut = NULL;
+}
+
+size_t
+ModuleScan::ScanContext::GetTypeIndex(
+	__in ResType Type
+	) const
+/*++
+
+Routine Description:
+
+	This routine returns the index of a scan type.
+
+Arguments:
+
+	Type - Supplies the resource type to look up.
+
+Return Value:
+
+	The routine returns the index of the type in the scan types.  An
+	std::exception is raised if the type is not a scan type.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	const ResTypeVec & Types = m_Scan->m_ScanTypes;
+
+	for (size_t i = 0; i < Types.size( ); i += 1)
+	{
+		if (Types[ i ] == Type)
+			return i;
+	}
+
+	throw std::runtime_error( "Resource type is not a scan type." );
+}
+
+ModuleScan::ModuleScan(
+	__in ResourceManager & ResMan,
+	__in IDebugTextOut * TextOut
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new, empty module scan.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that holds the loaded module.
+
+	TextOut - Supplies the text out interface that the output of the scan is
+	          printed to.
+
+Return Value:
+
+	The newly constructed object.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ResourceManager( ResMan ),
+  m_TextOut( TextOut ),
+  m_Visitor( NULL ),
+  m_NextItem( 0 ),
+  m_FailedItems( 0 ),
+  m_NextOutput( 0 )
+{
+	ZeroMemory( &m_Stats, sizeof( m_Stats ) );
+
+	InitializeCriticalSection( &m_OutputLock );
+}
+
+ModuleScan::~ModuleScan(
+	)
+/*++
+
+Routine Description:
+
+	This routine cleans up a module scan.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	DeleteCriticalSection( &m_OutputLock );
+}
+
+void
+ModuleScan::LoadModule(
+	__in ResourceManager & ResMan,
+	__in const char * ModuleName,
+	__in const char * NWN2Home,
+	__in const char * InstallDir
+	)
+/*++
+
+Routine Description:
+
+	This routine performs a full load of a module, including the TLK file and
+	any dependent HAKs.
+
+Arguments:
+
+	ResMan - Supplies the ResourceManager instance that is to load the module.
+
+	ModuleName - Supplies the resource name of the module to load.
+
+	NWN2Home - Supplies the users NWN2 home directory (i.e. NWN2 Documents dir).
+
+	InstallDir - Supplies the game installation directory.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< NWN::ResRef32 > HAKList;
+	std::string                  CustomTlk;
+
+	//
+	// Load up the module.  First, we load just the core module resources, then
+	// we determine the HAK list and load all of the HAKs up too.
+	//
+
+	ResMan.LoadModuleResourcesLite(
+		ModuleName,
+		NWN2Home,
+		InstallDir);
+
+	{
+		DemandResourceStr                ModuleIfoFile( ResMan, "module", NWN::ResIFO );
+		GffFileReader                    ModuleIfo( ModuleIfoFile, ResMan );
+		const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
+		size_t                           Offset;
+
+		RootStruct->GetCExoString( "Mod_CustomTlk", CustomTlk );
+
+		//
+		// Chop off the .tlk extension in the CustomTlk field if we had one.
+		//
+
+		if ((Offset = CustomTlk.rfind( '.' )) != std::string::npos)
+			CustomTlk.erase( Offset );
+
+		for (size_t i = 0; i <= UCHAR_MAX; i += 1)
+		{
+			GffFileReader::GffStruct Hak;
+			NWN::ResRef32            HakRef;
+
+			if (!RootStruct->GetListElement( "Mod_HakList", i, Hak ))
+				break;
+
+			if (!Hak.GetCExoStringAsResRef( "Mod_Hak", HakRef ))
+				throw std::runtime_error( "Failed to read Mod_HakList.Mod_Hak" );
+
+			HAKList.push_back( HakRef );
+		}
+
+		//
+		// If there were no haks, then try the legacy field.
+		//
+
+		if (HAKList.empty( ))
+		{
+			NWN::ResRef32 HakRef;
+
+			if ((RootStruct->GetCExoStringAsResRef( "Mod_Hak", HakRef )) &&
+				 (HakRef.RefStr[ 0 ] != '\0'))
+			{
+				HAKList.push_back( HakRef );
+			}
+		}
+	}
+
+	//
+	// Now perform a full load with the HAK list and CustomTlk available.
+	//
+	// N.B.  The DemandResourceStr above must go out of scope before we issue a
+	//       new load, as it references a temporary file that will be cleaned up
+	//       by the new load request.
+	//
+
+	ResMan.LoadModuleResources(
+		ModuleName,
+		CustomTlk,
+		NWN2Home,
+		InstallDir,
+		HAKList
+		);
+}
+
+void
+ModuleScan::SetScanTypes(
+	__in_ecount( NumTypes ) const ResType * Types,
+	__in size_t NumTypes
+	)
+/*++
+
+Routine Description:
+
+	This routine sets the resource types that are located for each item.
+
+Arguments:
+
+	Types - Supplies the resource types.
+
+	NumTypes - Supplies the count of resource types.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_ScanTypes.assign( Types, Types + NumTypes );
+}
+
+void
+ModuleScan::AddItem(
+	__in const NWN::ResRef32 & ResRef
+	)
+/*++
+
+Routine Description:
+
+	This routine adds an item to the scan by resource name.
+
+Arguments:
+
+	ResRef - Supplies the resource name of the item.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ScanItem Item;
+
+	Item.ResRef = ResRef;
+
+	m_Items.push_back( Item );
+}
+
+void
+ModuleScan::AddModuleAreas(
+	)
+/*++
+
+Routine Description:
+
+	This routine adds an item for every area in the module's area list.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	DemandResourceStr                ModuleIfoFile( m_ResourceManager, "module", NWN::ResIFO );
+	GffFileReader                    ModuleIfo( ModuleIfoFile, m_ResourceManager );
+	const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
+	GffFileReader::GffStruct         Struct;
+
+	for (size_t i = 0; i <= ULONG_MAX; i += 1)
+	{
+		NWN::ResRef32 AreaResRef;
+
+		if (!RootStruct->GetListElement( "Mod_Area_list", i, Struct ))
+			break;
+
+		if (!Struct.GetResRef( "Area_Name", AreaResRef ))
+			throw std::runtime_error( "Mod_Area_list element is missing Area_Name." );
+
+		AddItem( AreaResRef );
+	}
+}
+
+void
+ModuleScan::AddResourcesOfType(
+	__in ResType Type
+	)
+/*++
+
+Routine Description:
+
+	This routine adds an item for every distinct resource name of a given
+	type that is known to the resource manager.
+
+Arguments:
+
+	Type - Supplies the resource type to enumerate.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< std::string, NWN::ResRef32 > ResRefMap;
+
+	ResRefMap Names;
+
+	for (ResourceManager::FileId Id = m_ResourceManager.GetEncapsulatedFileCount( );
+	     Id != 0;
+	     Id -= 1)
+	{
+		NWN::ResRef32 ResRef;
+		NWN::ResType  ResType;
+
+		if (!m_ResourceManager.GetEncapsulatedFileEntry( (Id - 1), ResRef, ResType ))
+			continue;
+
+		if (ResType != Type)
+			continue;
+
+		//
+		// The same name may be present at several levels of the resource
+		// hierarchy.  Only one item is added, and locating the item by name
+		// always retrieves the most precedent file.
+		//
+
+		Names.insert( ResRefMap::value_type( m_ResourceManager.StrFromResRef( ResRef ), ResRef ) );
+	}
+
+	for (ResRefMap::const_iterator it = Names.begin( );
+	     it != Names.end( );
+	     ++it)
+	{
+		AddItem( it->second );
+	}
+}
+
+bool
+ModuleScan::Scan(
+	__in IModuleScanVisitor * Visitor,
+	__in ULONG MaxThreads
+	)
+/*++
+
+Routine Description:
+
+	This routine runs a visitor over every item of the scan.
+
+	The files of every item are located on the calling thread, then the items
+	are divided among worker threads.  The output of each item is printed in
+	item order as soon as every earlier item has finished.
+
+Arguments:
+
+	Visitor - Supplies the visitor to run for each item.
+
+	MaxThreads - Supplies the maximum count of worker threads, or zero to use
+	             one worker thread per processor.
+
+Return Value:
+
+	The routine returns true if every item was visited successfully, else
+	false if any item failed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< ScanContext * > Workers;
+	std::vector< HANDLE >        Threads;
+	SYSTEM_INFO                  SystemInfo;
+	size_t                       ThreadCount;
+	size_t                       ThreadsStarted;
+	DWORD                        StartTime;
+	DWORD                        VisitStartTime;
+
+	ZeroMemory( &m_Stats, sizeof( m_Stats ) );
+
+	StartTime = GetTickCount( );
+
+	LocateItemFiles( );
+
+	VisitStartTime = GetTickCount( );
+
+	GetSystemInfo( &SystemInfo );
+
+	ThreadCount = (MaxThreads != 0) ? MaxThreads : SystemInfo.dwNumberOfProcessors;
+
+	if (ThreadCount > m_Items.size( ))
+		ThreadCount = m_Items.size( );
+
+	if (ThreadCount == 0)
+		ThreadCount = 1;
+
+	m_Visitor     = Visitor;
+	m_NextItem    = 0;
+	m_FailedItems = 0;
+	m_NextOutput  = 0;
+
+	m_ItemOutput.clear( );
+	m_ItemOutput.resize( m_Items.size( ), NULL );
+	m_ItemDone.clear( );
+	m_ItemDone.resize( m_Items.size( ), false );
+
+	try
+	{
+		for (size_t i = 0; i < m_Items.size( ); i += 1)
+			m_ItemOutput[ i ] = new ScanTextOut;
+
+		for (size_t i = 0; i < ThreadCount; i += 1)
+			Workers.push_back( new ScanContext( this ) );
+	}
+	catch (...)
+	{
+		for (size_t i = 0; i < Workers.size( ); i += 1)
+			delete Workers[ i ];
+
+		for (size_t i = 0; i < m_ItemOutput.size( ); i += 1)
+			delete m_ItemOutput[ i ];
+
+		m_ItemOutput.clear( );
+
+		ReleaseItemFiles( );
+
+		throw;
+	}
+
+	//
+	// Start the workers.  If no thread could be created, then visit the items
+	// on the calling thread instead.
+	//
+
+	Threads.resize( ThreadCount, NULL );
+	ThreadsStarted = 0;
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		Threads[ i ] = CreateThread(
+			NULL,
+			0,
+			ScanWorkerThread,
+			Workers[ i ],
+			0,
+			NULL);
+
+		if (Threads[ i ] != NULL)
+			ThreadsStarted += 1;
+	}
+
+	if (ThreadsStarted == 0)
+	{
+		RunWorker( *Workers[ 0 ] );
+		ThreadsStarted = 1;
+	}
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		if (Threads[ i ] == NULL)
+			continue;
+
+		WaitForSingleObject( Threads[ i ], INFINITE );
+		CloseHandle( Threads[ i ] );
+	}
+
+	for (size_t i = 0; i < Workers.size( ); i += 1)
+		delete Workers[ i ];
+
+	for (size_t i = 0; i < m_ItemOutput.size( ); i += 1)
+		delete m_ItemOutput[ i ];
+
+	m_ItemOutput.clear( );
+	m_ItemDone.clear( );
+
+	ReleaseItemFiles( );
+
+	m_Stats.Items       = (ULONG) m_Items.size( );
+	m_Stats.FailedItems = (ULONG) m_FailedItems;
+	m_Stats.Threads     = (ULONG) ThreadsStarted;
+	m_Stats.PrepareTime = VisitStartTime - StartTime;
+	m_Stats.VisitTime   = GetTickCount( ) - VisitStartTime;
+
+	m_Visitor = NULL;
+
+	return (m_FailedItems == 0);
+}
+
+void
+ModuleScan::LocateItemFiles(
+	)
+/*++
+
+Routine Description:
+
+	This routine locates the files of every scan type for every item.  Items
+	that do not have a resource of a given type receive an empty file name.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_DemandedFiles.clear( );
+
+	for (ScanItemVec::iterator it = m_Items.begin( );
+	     it != m_Items.end( );
+	     ++it)
+	{
+		it->FileNames.clear( );
+		it->FileNames.resize( m_ScanTypes.size( ) );
+
+		for (size_t i = 0; i < m_ScanTypes.size( ); i += 1)
+		{
+			try
+			{
+				it->FileNames[ i ] = m_ResourceManager.Demand(
+					it->ResRef,
+					m_ScanTypes[ i ]);
+			}
+			catch (std::exception)
+			{
+				continue;
+			}
+
+			m_DemandedFiles.push_back( it->FileNames[ i ] );
+		}
+	}
+}
+
+void
+ModuleScan::ReleaseItemFiles(
+	)
+/*++
+
+Routine Description:
+
+	This routine releases the files located by LocateItemFiles.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (StringVec::const_iterator it = m_DemandedFiles.begin( );
+	     it != m_DemandedFiles.end( );
+	     ++it)
+	{
+		m_ResourceManager.Release( *it );
+	}
+
+	m_DemandedFiles.clear( );
+
+	for (ScanItemVec::iterator it = m_Items.begin( );
+	     it != m_Items.end( );
+	     ++it)
+	{
+		it->FileNames.clear( );
+	}
+}
+
+DWORD
+WINAPI
+ModuleScan::ScanWorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point of a scan worker thread.
+
+Arguments:
+
+	Parameter - Supplies the ScanContext of the worker.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	ScanContext * Context = (ScanContext *) Parameter;
+
+	Context->m_Scan->RunWorker( *Context );
+
+	return 0;
+}
+
+void
+ModuleScan::RunWorker(
+	__in ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine visits items until none remain.
+
+Arguments:
+
+	Context - Supplies the context of the worker.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	for (;;)
+	{
+		size_t Index;
+
+		Index = (size_t) (InterlockedIncrement( &m_NextItem ) - 1);
+
+		if (Index >= m_Items.size( ))
+			break;
+
+		Context.BeginItem( Index, m_ItemOutput[ Index ] );
+
+		try
+		{
+			m_Visitor->VisitScanItem( Context );
+		}
+		catch (std::exception &e)
+		{
+			try
+			{
+				m_ItemOutput[ Index ]->WriteText(
+					"ERROR: Exception '%s' scanning %s.\n",
+					e.what( ),
+					m_ResourceManager.StrFromResRef( m_Items[ Index ].ResRef ).c_str( ));
+			}
+			catch (std::exception)
+			{
+			}
+
+			InterlockedIncrement( &m_FailedItems );
+		}
+
+		Context.EndItem( );
+
+		CompleteItem( Index );
+	}
+}
+
+void
+ModuleScan::CompleteItem(
+	__in size_t ItemIndex
+	)
+/*++
+
+Routine Description:
+
+	This routine records that an item has been visited, and prints the output
+	of every item that is now next in order.
+
+Arguments:
+
+	ItemIndex - Supplies the index of the finished item.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, scan worker thread.
+
+--*/
+{
+	EnterCriticalSection( &m_OutputLock );
+
+	m_ItemDone[ ItemIndex ] = true;
+
+	while ((m_NextOutput < m_Items.size( )) && (m_ItemDone[ m_NextOutput ]))
+	{
+		m_ItemOutput[ m_NextOutput ]->Flush( m_TextOut );
+		m_NextOutput += 1;
+	}
+
+	LeaveCriticalSection( &m_OutputLock );
+}
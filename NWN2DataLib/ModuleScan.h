@@ -0,0 +1,410 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ModuleScan.h
+
+Abstract:
+
+	This module defines the module scan object, which runs a visitor over a
+	set of module resources (such as every area, or every resource of a given
+	type) on a pool of worker threads, and merges the output of the visitor in
+	a deterministic order.
+
+--*/
+
+#ifndef _PROGRAMS_NWN2DATALIB_MODULESCAN_H
+#define _PROGRAMS_NWN2DATALIB_MODULESCAN_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include "TextOut.h"
+#include "ResourceManager.h"
+#include "GffFileReader.h"
+#include "TrxFileReader.h"
+#include "MeshManager.h"
+
+struct IModuleScanVisitor;
+
+//
+// Define the module scan object.
+//
+
+class ModuleScan
+{
+
+public:
+
+	typedef NWN::ResType ResType;
+	typedef std::vector< ResType > ResTypeVec;
+	typedef std::vector< std::string > StringVec;
+
+	//
+	// Define an item to scan.  An item is a resource name, along with the
+	// files of the scan's resource types that exist under that name (such as
+	// the .are, .git and .trx files of an area).
+	//
+
+	struct ScanItem
+	{
+		NWN::ResRef32 ResRef;
+		StringVec     FileNames; // Parallel to the scan types, empty if absent
+	};
+
+	typedef std::vector< ScanItem > ScanItemVec;
+
+	//
+	// Define the per worker thread context that is handed to a visitor.  The
+	// readers returned by the context belong to the current item, and are
+	// released once the visitor returns.  They must not be passed to other
+	// threads.
+	//
+
+	class ScanContext
+	{
+
+	public:
+
+		//
+		// Return the resource manager.  Only the thread safe helpers (such as
+		// StrFromResRef and GetTalkString) may be used from a visitor.
+		//
+
+		inline
+		ResourceManager &
+		GetResourceManager(
+			) const
+		{
+			return *m_ResourceManager;
+		}
+
+		//
+		// Return the current item and its index.
+		//
+
+		inline
+		const ScanItem &
+		GetItem(
+			) const
+		{
+			return *m_Item;
+		}
+
+		inline
+		size_t
+		GetItemIndex(
+			) const
+		{
+			return m_ItemIndex;
+		}
+
+		//
+		// Return the text out interface for the current item.
+		//
+
+		inline
+		IDebugTextOut *
+		GetTextOut(
+			) const
+		{
+			return m_TextOut;
+		}
+
+		//
+		// Return the file name of the current item's resource of the given
+		// type, or an empty string if the item has no such resource.  An
+		// std::exception is raised if the type is not one of the scan types.
+		//
+
+		const std::string &
+		GetFileName(
+			__in ResType Type
+			) const;
+
+		//
+		// Return a GFF reader for the current item's resource of the given
+		// type.  The file is parsed on first use.  An std::exception is raised
+		// if the resource does not exist or could not be parsed.
+		//
+
+		const GffFileReader *
+		GetGffReader(
+			__in ResType Type
+			);
+
+		//
+		// Return a TRX reader for the current item's .trx (or .trn) resource,
+		// or an MDB reader for its .mdb resource.  Meshes are registered with
+		// a mesh manager that is private to the worker thread.  If
+		// RefuseDisplayOnlyModels is set, display only meshes (terrain, water
+		// and model render meshes) are skipped.  An std::exception is raised
+		// on failure.
+		//
+
+		TrxFileReader *
+		GetTrxReader(
+			__in ResType Type,
+			__in bool LoadOnlyDimensions,
+			__in bool RefuseDisplayOnlyModels = false
+			);
+
+	private:
+
+		ScanContext(
+			__in ModuleScan * Scan
+			);
+
+		~ScanContext(
+			);
+
+		//
+		// Prepare for a new item, or release the readers of the last item.
+		//
+
+		void
+		BeginItem(
+			__in size_t ItemIndex,
+			__in IDebugTextOut * TextOut
+			);
+
+		void
+		EndItem(
+			);
+
+		//
+		// Return the index of a scan type.
+		//
+
+		size_t
+		GetTypeIndex(
+			__in ResType Type
+			) const;
+
+		typedef std::vector< GffFileReader::Ptr > GffReaderVec;
+		typedef std::vector< TrxFileReader::Ptr > TrxReaderVec;
+
+		ModuleScan       * m_Scan;
+		ResourceManager  * m_ResourceManager;
+		const ScanItem   * m_Item;
+		size_t             m_ItemIndex;
+		IDebugTextOut    * m_TextOut;
+		GffReaderVec       m_GffReaders;
+		TrxReaderVec       m_TrxReaders;
+		MeshManager        m_MeshManager;
+
+		friend class ModuleScan;
+
+	};
+
+	//
+	// Define the timing and counters of the last scan.
+	//
+
+	struct ScanStats
+	{
+		ULONG Items;
+		ULONG FailedItems;
+		ULONG Threads;
+		ULONG PrepareTime;   // Milliseconds locating resources
+		ULONG VisitTime;     // Milliseconds running the visitor
+	};
+
+	ModuleScan(
+		__in ResourceManager & ResMan,
+		__in IDebugTextOut * TextOut
+		);
+
+	~ModuleScan(
+		);
+
+	//
+	// Perform a full load of a module into a resource manager, including the
+	// custom TLK and all HAKs listed in module.ifo.  An std::exception is
+	// raised on failure.
+	//
+
+	static
+	void
+	LoadModule(
+		__in ResourceManager & ResMan,
+		__in const char * ModuleName,
+		__in const char * NWN2Home,
+		__in const char * InstallDir
+		);
+
+	//
+	// Set the resource types that are located for each item.
+	//
+
+	void
+	SetScanTypes(
+		__in_ecount( NumTypes ) const ResType * Types,
+		__in size_t NumTypes
+		);
+
+	//
+	// Add an item by resource name.
+	//
+
+	void
+	AddItem(
+		__in const NWN::ResRef32 & ResRef
+		);
+
+	//
+	// Add an item for every area listed in module.ifo, in module order.  An
+	// std::exception is raised on failure.
+	//
+
+	void
+	AddModuleAreas(
+		);
+
+	//
+	// Add an item for every distinct resource name of the given type known to
+	// the resource manager, in resource name order.
+	//
+
+	void
+	AddResourcesOfType(
+		__in ResType Type
+		);
+
+	//
+	// Return the items of the scan.
+	//
+
+	inline
+	const ScanItemVec &
+	GetItems(
+		) const
+	{
+		return m_Items;
+	}
+
+	//
+	// Run the visitor over every item, with at most MaxThreads worker threads
+	// (or one per processor if zero).  The routine returns false if any item
+	// failed.
+	//
+
+	bool
+	Scan(
+		__in IModuleScanVisitor * Visitor,
+		__in ULONG MaxThreads
+		);
+
+	//
+	// Return the timing and counters of the last scan.
+	//
+
+	inline
+	const ScanStats &
+	GetStats(
+		) const
+	{
+		return m_Stats;
+	}
+
+private:
+
+	class ScanTextOut;
+
+	//
+	// Locate the files of every item.  The resource manager is only used on
+	// the calling thread.
+	//
+
+	void
+	LocateItemFiles(
+		);
+
+	//
+	// Release the files located by LocateItemFiles.
+	//
+
+	void
+	ReleaseItemFiles(
+		);
+
+	//
+	// Worker thread entry point.
+	//
+
+	static
+	DWORD
+	WINAPI
+	ScanWorkerThread(
+		__in LPVOID Parameter
+		);
+
+	//
+	// Visit items until none remain.
+	//
+
+	void
+	RunWorker(
+		__in ScanContext & Context
+		);
+
+	//
+	// Record a finished item, and print the output of every item that is now
+	// next in order.
+	//
+
+	void
+	CompleteItem(
+		__in size_t ItemIndex
+		);
+
+	typedef std::vector< ScanTextOut * > ScanTextOutVec;
+
+	ResourceManager            & m_ResourceManager;
+	IDebugTextOut              * m_TextOut;
+	ResTypeVec                   m_ScanTypes;
+	ScanItemVec                  m_Items;
+	StringVec                    m_DemandedFiles;
+	IModuleScanVisitor         * m_Visitor;
+	volatile LONG                m_NextItem;
+	volatile LONG                m_FailedItems;
+	ScanTextOutVec               m_ItemOutput;
+	std::vector< bool >          m_ItemDone;
+	size_t                       m_NextOutput;
+	CRITICAL_SECTION             m_OutputLock;
+	ScanStats                    m_Stats;
+
+	friend class ScanContext;
+
+};
+
+//
+// Define the visitor interface that is called for each item of a scan.
+//
+
+struct IModuleScanVisitor
+{
+
+	//
+	// Visit one item.  The routine is called on a worker thread, and may run
+	// concurrently with other calls for other items.  Text written to the
+	// context's text out interface is printed in item order once the scan
+	// reaches the item.  Results that must be merged should be stored by item
+	// index and combined by the caller once Scan returns.
+	//
+	// If the routine raises an std::exception, the item is reported as failed
+	// and the scan continues.
+	//
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		) = 0;
+
+};
+
+#endif
@@ -34,6 +34,7 @@ Abstract:
 #include <list>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <hash_map>
 #include <sstream>
 
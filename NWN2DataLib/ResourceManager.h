@@ -1003,6 +1003,28 @@ public:
 		}
 	}
 
+	//
+	// Return the directories that directory resources (such as a directory
+	// module, the campaign directory and the override directories) are read
+	// from.  Each directory is searched including its subdirectories.
+	//
+
+	inline
+	void
+	GetResourceDirectories(
+		__out StringVec & Directories
+		) const
+	{
+		Directories.clear( );
+
+		for (DirFileVec::const_iterator it = m_DirFiles.begin( );
+		     it != m_DirFiles.end( );
+		     ++it)
+		{
+			Directories.push_back( (*it)->GetDirectoryName( ) );
+		}
+	}
+
 	//
 	// Read a file into a vector, given a resource accessor and file index.
 	//
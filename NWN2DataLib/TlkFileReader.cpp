@@ -164,10 +164,17 @@ Environment:
 	if (StringDesc->StringSize == 0)
 		return true;
 
-	m_FileWrapper.SeekOffset(
+	//
+	// N.B.  A positional read is used so that strings may be looked up by
+	//       several threads at once (e.g. by GffFileReader instances parsing
+	//       localized strings on different threads).
+	//
+
+	m_FileWrapper.ReadFileAtOffset(
 		m_StringsOffset + StringDesc->OffsetToString,
-		"Seek to String" );
-	m_FileWrapper.ReadFile( &String[ 0 ], String.size( ), "Read String" );
+		&String[ 0 ],
+		String.size( ),
+		"Read String" );
 
 	return true;
 }
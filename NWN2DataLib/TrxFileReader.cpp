@@ -464,7 +464,10 @@ Environment:
 	if (CompressHeader.TypeId == TRX_COMPRESSION_HEADER_ID)
 	{
 		NWN::Compressor              CompressContext;
-		std::vector< unsigned char > Compressed;
+		COMPRESSED_STREAM_CONTEXT    StreamContext;
+		std::vector< unsigned char > Chunk;
+		size_t                       Written;
+		bool                         Decompressed;
 
 		//
 		// Decompress into a staging buffer.
@@ -493,7 +496,7 @@ Environment:
 		Buffer.resize( Size );
 
 		//
-		// Validate lengths and allocate storage for the compressed block.
+		// Validate lengths.
 		//
 
 		if (CompressHeader.CompressedSize < 1)
@@ -502,25 +505,52 @@ Environment:
 		if (CompressHeader.CompressedSize >= 128 * 1024 * 1024)
 			throw std::exception( "Too large compressed walkmesh (>128MB)-2" );
 
-		Compressed.resize( CompressHeader.CompressedSize );
+		//
+		// Decompress the compressed stream straight from the file into the
+		// decompressed block, a chunk at a time, rather than first staging the
+		// whole compressed block.
+		//
 
-		ReadFile(
-			&Compressed[ 0 ],
-			CompressHeader.CompressedSize,
-			"Compressed walkmesh stream");
+		Chunk.resize( min( CompressHeader.CompressedSize, (ULONG) COMPRESSED_STREAM_CHUNK_SIZE ) );
+
+		StreamContext.Reader    = this;
+		StreamContext.Remaining = CompressHeader.CompressedSize;
+		StreamContext.Chunk     = &Chunk[ 0 ];
+		StreamContext.Error[ 0 ] = '\0';
+
+		Decompressed = CompressContext.UncompressStream(
+			ReadCompressedStreamChunk,
+			&StreamContext,
+			&Buffer[ 0 ],
+			Buffer.size( ),
+			Written);
+
+		if (StreamContext.Error[ 0 ] != '\0')
+			throw std::runtime_error( StreamContext.Error );
 
 		//
-		// Decompress the compressed stream.
+		// Skip any compressed data trailing the end of the stream so that the
+		// file position matches that of a full read of the compressed block.
+		// This is done even if decompression failed, so that a compressed
+		// block cut short by the end of the file is reported as a read error
+		// ahead of a decompression failure, as when the whole block was read
+		// up front.
 		//
 
-		if (!CompressContext.Uncompress(
-			&Compressed[ 0 ],
-			Compressed.size( ),
-			Buffer))
+		while (StreamContext.Remaining != 0)
 		{
-			throw std::exception( "Walkmesh decompression failed." );
+			size_t Transfer;
+
+			Transfer = min( StreamContext.Remaining, Chunk.size( ) );
+
+			ReadFile( &Chunk[ 0 ], Transfer, "Compressed walkmesh stream" );
+
+			StreamContext.Remaining -= Transfer;
 		}
 
+		if (!Decompressed)
+			throw std::exception( "Walkmesh decompression failed." );
+
 		//
 		// Initialize the buffer reader for direct memory reads.
 		//
@@ -992,6 +1022,73 @@ Environment:
 	m_Walkmesh.RegisterMesh( MeshMgr );
 }
 
+bool
+__stdcall
+TrxFileReader::ReadCompressedStreamChunk(
+	__in void * Context,
+	__deref_out_bcount( *Length ) const unsigned char * * Data,
+	__out size_t * Length
+	)
+/*++
+
+Routine Description:
+
+	This routine supplies the decompressor with the next chunk of a compressed
+	block, read from the current file position.
+
+	As the decompressor is not exception safe, file read failures are recorded
+	in the stream context and reported as a decompression failure, for the
+	caller to raise once the decompressor has cleaned up.
+
+Arguments:
+
+	Context - Supplies the compressed stream context.
+
+	Data - Receives a pointer to the chunk.
+
+	Length - Receives the length of the chunk, or zero if the entire block has
+	         been consumed.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PCOMPRESSED_STREAM_CONTEXT StreamContext;
+	size_t                     Transfer;
+
+	StreamContext = reinterpret_cast< PCOMPRESSED_STREAM_CONTEXT >( Context );
+	Transfer      = min( StreamContext->Remaining, (size_t) COMPRESSED_STREAM_CHUNK_SIZE );
+
+	try
+	{
+		StreamContext->Reader->ReadFile(
+			StreamContext->Chunk,
+			Transfer,
+			"Compressed walkmesh stream");
+	}
+	catch (std::exception &e)
+	{
+		StringCbCopyA(
+			StreamContext->Error,
+			sizeof( StreamContext->Error ),
+			e.what( ));
+
+		return false;
+	}
+
+	StreamContext->Remaining -= Transfer;
+
+	*Data   = StreamContext->Chunk;
+	*Length = Transfer;
+
+	return true;
+}
 
 void
 TrxFileReader::DecodeAreaWidthHeight(
@@ -427,6 +427,22 @@ private:
 
 	typedef const struct _READER_CONTEXT * PCREADER_CONTEXT;
 
+	//
+	// Compressed stream context, used to feed a compressed block from the
+	// file to the decompressor in fixed size chunks without staging the
+	// entire compressed block in memory.
+	//
+
+	enum { COMPRESSED_STREAM_CHUNK_SIZE = 64 * 1024 };
+
+	typedef struct _COMPRESSED_STREAM_CONTEXT
+	{
+		TrxFileReader * Reader;
+		size_t          Remaining;
+		unsigned char * Chunk;
+		char            Error[ 64 ];
+	} COMPRESSED_STREAM_CONTEXT, * PCOMPRESSED_STREAM_CONTEXT;
+
 	//
 	// Define the main parse entrypoint.
 	//
@@ -578,6 +594,20 @@ private:
 		return m_FileWrapper.ReadFile( Buffer, Length, Description );
 	}
 
+	//
+	// Decompressor input callback that reads the next chunk of a compressed
+	// block from the file.
+	//
+
+	static
+	bool
+	__stdcall
+	ReadCompressedStreamChunk(
+		__in void * Context,
+		__deref_out_bcount( *Length ) const unsigned char * * Data,
+		__out size_t * Length
+		);
+
 	//
 	// ReadFile wrapper for DDS images.
 	//
@@ -127,6 +127,88 @@ namespace NWN2ToolsetCompilerPlugin
             }
         }
 
+        //
+        // Compile a set of scripts in parallel using the specified resource
+        // system.  ScriptCompiled is invoked once per script (on the calling
+        // thread) with the script name, whether it compiled, and any
+        // diagnostics.  The return value is true if every script compiled.
+        //
+        // N.B.  The native compiler's entrypoint symbol state is not updated
+        //       by a batch compile.
+        //
+
+        public delegate void ScriptCompiledHandler(string Name, bool Succeeded, string Diagnostics);
+
+        public bool CompileScripts(IList<string> Names, string OutputDirectory, bool GenerateDebugInfo, ScriptCompiledHandler ScriptCompiled)
+        {
+            bool Status;
+            NSC_COMPILER_DISPATCH_TABLE DispatchTable = CreateNscCompilerDispatchTable();
+            NSC_BATCH_SCRIPT[] Scripts;
+            NscBatchScriptCompletionProc CompletionRoutine;
+
+            if (m_Compiling)
+                return false;
+
+            if (m_Compiler == IntPtr.Zero)
+            {
+                m_Compiler = NscCreateCompiler(true);
+
+                if (m_Compiler == IntPtr.Zero)
+                    return false;
+            }
+
+            Scripts = new NSC_BATCH_SCRIPT[Names.Count];
+
+            for (int i = 0; i < Names.Count; i += 1)
+            {
+                Scripts[i].ScriptFileName = Names[i];
+                Scripts[i].ScriptText = IntPtr.Zero;
+                Scripts[i].ScriptTextLength = IntPtr.Zero;
+            }
+
+            CompletionRoutine = delegate(IntPtr ScriptIndex, string ScriptFileName, bool Succeeded, string Diagnostics, IntPtr Context)
+            {
+                ScriptCompiled(ScriptFileName, Succeeded, Diagnostics);
+            };
+
+            m_CompilerDiagnosticsLog = null;
+
+            m_Compiling = true;
+
+            try
+            {
+                Status = NscCompileScriptBatchExternal(
+                    m_Compiler,
+                    Scripts,
+                    (IntPtr)Scripts.Length,
+                    OutputDirectory,
+                    m_ResourceAccessor.IsIndexInvalidationPending(),
+                    GenerateDebugInfo || m_SettingsManager.EnableDebugSymbols,
+                    true,
+                    true,
+                    m_SettingsManager.CompilerVersion,
+                    0, // One worker thread per processor
+                    ref DispatchTable,
+                    CompletionRoutine,
+                    IntPtr.Zero);
+            }
+            catch
+            {
+                m_Compiling = false;
+                throw;
+            }
+
+            m_Compiling = false;
+
+            GC.KeepAlive(CompletionRoutine);
+
+            m_ResourceAccessor.AcknowledgeIndexInvalidation();
+
+            m_CompilerDiagnosticsLog = null;
+
+            return Status;
+        }
+
         //
         // Determine whether the last compiled script is likely to need runtime
         // compilation (and thus must compile with the stock script compiler).
@@ -369,6 +451,33 @@ namespace NWN2ToolsetCompilerPlugin
             int CompilerVersion,
             ref NSC_COMPILER_DISPATCH_TABLE DispatchTable);
 
+        [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+        private struct NSC_BATCH_SCRIPT
+        {
+            public string ScriptFileName;
+            public IntPtr ScriptText;
+            public IntPtr ScriptTextLength;
+        };
+
+        [UnmanagedFunctionPointer(CallingConvention.StdCall, CharSet = CharSet.Ansi, SetLastError = true)]
+        private delegate void NscBatchScriptCompletionProc(IntPtr ScriptIndex, string ScriptFileName, [MarshalAs(UnmanagedType.I1)] bool Succeeded, string Diagnostics, IntPtr Context);
+
+        [DllImport("NWNScriptCompilerDll.ndl", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi, ExactSpelling = true, SetLastError = true)]
+        private static extern bool NscCompileScriptBatchExternal(
+            IntPtr Compiler,
+            [In] NSC_BATCH_SCRIPT[] Scripts,
+            IntPtr ScriptCount,
+            string OutputDirectory,
+            bool FlushResources,
+            bool GenerateDebugInfo,
+            bool Optimize,
+            bool IgnoreIncludes,
+            int CompilerVersion,
+            uint MaxThreads,
+            ref NSC_COMPILER_DISPATCH_TABLE DispatchTable,
+            NscBatchScriptCompletionProc CompletionRoutine,
+            IntPtr CompletionContext);
+
         [DllImport("NWNScriptCompilerDll.ndl", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi, ExactSpelling = true, SetLastError = true)]
         private static extern bool NscDeleteCompiler(
             IntPtr Compiler);
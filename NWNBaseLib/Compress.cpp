@@ -36,22 +36,391 @@ Environment:
 
 --*/
 {
-	int   Status;
-	uLong UncompressedSize;
+	size_t PlainWritten;
 
-	UncompressedSize = (uLong) Plain.size( );
+	if (!Uncompress( Data, Length, &Plain[ 0 ], Plain.size( ), PlainWritten ))
+		return false;
+
+	Plain.resize( PlainWritten );
+
+	return true;
+}
+
+bool
+Compressor::Uncompress(
+	__in_bcount( Length ) const unsigned char * Data,
+	__in size_t Length,
+	__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+	__in size_t PlainLength,
+	__out size_t & PlainWritten
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses a single logical block in stateless mode,
+	directly into a caller supplied buffer.  No intermediate copies of the
+	compressed or uncompressed data are made.
 
-	Status = uncompress(
-		&Plain[ 0 ],
-		&UncompressedSize,
+Arguments:
+
+	Data - Supplies the compressed data.
+
+	Length - Supplies the length of the compressed data, in bytes.
+
+	Plain - Receives the uncompressed data.
+
+	PlainLength - Supplies the length of the Plain buffer, in bytes.
+
+	PlainWritten - Receives the count of uncompressed bytes written.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.  The
+	routine fails if the uncompressed data would not fit in the buffer.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	return InflateStream(
+		NULL,
+		NULL,
 		Data,
-		(uLong) Length);
+		Length,
+		NULL,
+		NULL,
+		Plain,
+		PlainLength,
+		PlainWritten);
+}
+
+bool
+Compressor::UncompressStream(
+	__in UncompressInputProc InputProc,
+	__in void * InputContext,
+	__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+	__in size_t PlainLength,
+	__out size_t & PlainWritten
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses a single logical block whose compressed data is
+	supplied in chunks by an input routine.  The uncompressed data is written
+	directly into a caller supplied buffer.
+
+Arguments:
+
+	InputProc - Supplies the routine that returns the next chunk of compressed
+	            data.
+
+	InputContext - Supplies the context argument for the input routine.
+
+	Plain - Receives the uncompressed data.
+
+	PlainLength - Supplies the length of the Plain buffer, in bytes.
+
+	PlainWritten - Receives the count of uncompressed bytes written.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.  The
+	routine fails if the uncompressed data would not fit in the buffer, or if
+	the input routine failed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	return InflateStream(
+		InputProc,
+		InputContext,
+		NULL,
+		0,
+		NULL,
+		NULL,
+		Plain,
+		PlainLength,
+		PlainWritten);
+}
+
+bool
+Compressor::UncompressStream(
+	__in UncompressInputProc InputProc,
+	__in void * InputContext,
+	__in UncompressOutputProc OutputProc,
+	__in void * OutputContext,
+	__out_opt size_t * PlainWritten /* = NULL */
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses a single logical block whose compressed data is
+	supplied in chunks by an input routine.  The uncompressed data is passed
+	to an output routine in chunks of at most STREAM_CHUNK_SIZE bytes, so the
+	uncompressed size need not be known in advance.
+
+Arguments:
+
+	InputProc - Supplies the routine that returns the next chunk of compressed
+	            data.
+
+	InputContext - Supplies the context argument for the input routine.
+
+	OutputProc - Supplies the routine that consumes each chunk of uncompressed
+	             data.
+
+	OutputContext - Supplies the context argument for the output routine.
+
+	PlainWritten - Optionally receives the total count of uncompressed bytes.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.  The
+	routine fails if either callback routine failed.
+
+Environment:
 
-	if (Status != Z_OK)
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Chunk;
+	size_t                       Written;
+
+	try
+	{
+		Chunk.resize( STREAM_CHUNK_SIZE );
+	}
+	catch (std::exception)
+	{
 		return false;
+	}
 
-	Plain.resize( UncompressedSize );
+	if (!InflateStream(
+		InputProc,
+		InputContext,
+		NULL,
+		0,
+		OutputProc,
+		OutputContext,
+		&Chunk[ 0 ],
+		Chunk.size( ),
+		Written))
+	{
+		return false;
+	}
+
+	if (PlainWritten != NULL)
+		*PlainWritten = Written;
 
 	return true;
 }
 
+bool
+Compressor::InflateStream(
+	__in_opt UncompressInputProc InputProc,
+	__in_opt void * InputContext,
+	__in_bcount_opt( Length ) const unsigned char * Data,
+	__in size_t Length,
+	__in_opt UncompressOutputProc OutputProc,
+	__in_opt void * OutputContext,
+	__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+	__in size_t PlainLength,
+	__out size_t & PlainWritten
+	)
+/*++
+
+Routine Description:
+
+	This routine runs a zlib inflate stream to completion.
+
+	Compressed data is taken first from the Data buffer, and then (if an input
+	routine is supplied) from successive chunks returned by the input routine.
+
+	Uncompressed data is written to the Plain buffer.  If an output routine is
+	supplied, the Plain buffer is a staging buffer that is handed to the output
+	routine and reused each time it fills; otherwise, the stream must fit in
+	the Plain buffer.
+
+	Buffers are handed to zlib in transfers of at most MAX_ZLIB_TRANSFER
+	bytes, as zlib lengths are 32 bits wide.
+
+Arguments:
+
+	InputProc - Optionally supplies the routine that returns the next chunk of
+	            compressed data.
+
+	InputContext - Supplies the context argument for the input routine.
+
+	Data - Optionally supplies initial compressed data.
+
+	Length - Supplies the length of the Data buffer, in bytes.
+
+	OutputProc - Optionally supplies the routine that consumes uncompressed
+	             data.
+
+	OutputContext - Supplies the context argument for the output routine.
+
+	Plain - Receives the uncompressed data.
+
+	PlainLength - Supplies the length of the Plain buffer, in bytes.
+
+	PlainWritten - Receives the total count of uncompressed bytes produced.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const size_t          MAX_ZLIB_TRANSFER = 0x40000000;
+	z_stream              Stream;
+	int                   Status;
+	const unsigned char * InNext;
+	size_t                InRemaining;
+	bool                  InputEnd;
+	size_t                OutRemaining;
+	size_t                Flushed;
+	size_t                Transfer;
+	bool                  Succeeded;
+
+	PlainWritten = 0;
+
+	ZeroMemory( &Stream, sizeof( Stream ) );
+
+	if (inflateInit( &Stream ) != Z_OK)
+		return false;
+
+	InNext       = Data;
+	InRemaining  = Length;
+	InputEnd     = (InputProc == NULL);
+	OutRemaining = PlainLength;
+	Flushed      = 0;
+	Succeeded    = false;
+
+	Stream.next_out = Plain;
+
+	for (;;)
+	{
+		//
+		// Hand zlib the next transfer of compressed data, first fetching a new
+		// chunk from the input routine if we have exhausted the current one.
+		//
+
+		if (Stream.avail_in == 0)
+		{
+			if ((InRemaining == 0) && (!InputEnd))
+			{
+				const unsigned char * Chunk;
+				size_t                ChunkLength;
+
+				Chunk       = NULL;
+				ChunkLength = 0;
+
+				if (!InputProc( InputContext, &Chunk, &ChunkLength ))
+					break;
+
+				if (ChunkLength == 0)
+				{
+					InputEnd = true;
+				}
+				else
+				{
+					InNext      = Chunk;
+					InRemaining = ChunkLength;
+				}
+			}
+
+			Transfer = min( InRemaining, MAX_ZLIB_TRANSFER );
+
+			Stream.next_in  = (Bytef *) InNext;
+			Stream.avail_in = (uInt) Transfer;
+
+			InNext      += Transfer;
+			InRemaining -= Transfer;
+		}
+
+		//
+		// Hand zlib the next transfer of output space, first flushing the
+		// staging buffer to the output routine if it has filled.
+		//
+
+		if (Stream.avail_out == 0)
+		{
+			if ((OutputProc != NULL) && (OutRemaining == 0))
+			{
+				Transfer = (size_t) (Stream.next_out - Plain);
+
+				if (!OutputProc( OutputContext, Plain, Transfer ))
+					break;
+
+				Flushed         += Transfer;
+				Stream.next_out  = Plain;
+				OutRemaining     = PlainLength;
+			}
+
+			Transfer = min( OutRemaining, MAX_ZLIB_TRANSFER );
+
+			Stream.avail_out = (uInt) Transfer;
+
+			OutRemaining -= Transfer;
+		}
+
+		Status = inflate( &Stream, Z_NO_FLUSH );
+
+		if (Status == Z_STREAM_END)
+		{
+			Succeeded = true;
+			break;
+		}
+
+		if (Status == Z_OK)
+			continue;
+
+		//
+		// No progress was possible.  That is only recoverable if we can supply
+		// more input or more output space on the next pass.
+		//
+
+		if (Status != Z_BUF_ERROR)
+			break;
+
+		if ((Stream.avail_in == 0) && ((InRemaining != 0) || (!InputEnd)))
+			continue;
+
+		if ((Stream.avail_out == 0) &&
+		    ((OutRemaining != 0) || (OutputProc != NULL)))
+			continue;
+
+		break;
+	}
+
+	inflateEnd( &Stream );
+
+	if (!Succeeded)
+		return false;
+
+	Transfer = (size_t) (Stream.next_out - Plain);
+
+	if ((OutputProc != NULL) && (Transfer != 0))
+	{
+		if (!OutputProc( OutputContext, Plain, Transfer ))
+			return false;
+	}
+
+	PlainWritten = Flushed + Transfer;
+
+	return true;
+}
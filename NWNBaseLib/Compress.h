@@ -24,6 +24,34 @@ namespace NWN
 
 	public:
 
+		//
+		// Define the callbacks used by streaming decompression.
+		//
+		// The input routine supplies the next chunk of compressed data.  A
+		// zero length chunk signifies the end of the compressed data.  The
+		// chunk must remain valid until the input routine is next called.
+		//
+		// The output routine consumes the next chunk of uncompressed data.
+		//
+		// Either routine returns false to abort decompression.
+		//
+
+		typedef
+		bool
+		(__stdcall * UncompressInputProc)(
+			__in void * Context,
+			__deref_out_bcount( *Length ) const unsigned char * * Data,
+			__out size_t * Length
+			);
+
+		typedef
+		bool
+		(__stdcall * UncompressOutputProc)(
+			__in void * Context,
+			__in_bcount( Length ) const unsigned char * Data,
+			__in size_t Length
+			);
+
 		inline
 		Compressor(
 			)
@@ -48,7 +76,78 @@ namespace NWN
 			__inout std::vector< unsigned char > & Plain
 			);
 
+		//
+		// Perform stateless decompression directly into a caller supplied
+		// buffer.  Decompression fails if the buffer is too small.
+		//
+
+		bool
+		Uncompress(
+			__in_bcount( Length ) const unsigned char * Data,
+			__in size_t Length,
+			__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+			__in size_t PlainLength,
+			__out size_t & PlainWritten
+			);
+
+		//
+		// Perform streaming decompression, pulling compressed data from the
+		// input routine and writing the uncompressed data directly into a
+		// caller supplied buffer.  Decompression fails if the buffer is too
+		// small.
+		//
+
+		bool
+		UncompressStream(
+			__in UncompressInputProc InputProc,
+			__in void * InputContext,
+			__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+			__in size_t PlainLength,
+			__out size_t & PlainWritten
+			);
+
+		//
+		// Perform streaming decompression, pulling compressed data from the
+		// input routine and pushing uncompressed data to the output routine
+		// in chunks.  The total uncompressed size need not be known.
+		//
+
+		bool
+		UncompressStream(
+			__in UncompressInputProc InputProc,
+			__in void * InputContext,
+			__in UncompressOutputProc OutputProc,
+			__in void * OutputContext,
+			__out_opt size_t * PlainWritten = NULL
+			);
+
 	private:
 
+		//
+		// Define the size of the output staging buffer used when pushing
+		// uncompressed data to an output routine.
+		//
+
+		enum { STREAM_CHUNK_SIZE = 64 * 1024 };
+
+		//
+		// Run an inflate stream to completion.  If an output routine is
+		// supplied, the output buffer is used as a staging buffer that is
+		// flushed to the output routine whenever it fills.
+		//
+
+		bool
+		InflateStream(
+			__in_opt UncompressInputProc InputProc,
+			__in_opt void * InputContext,
+			__in_bcount_opt( Length ) const unsigned char * Data,
+			__in size_t Length,
+			__in_opt UncompressOutputProc OutputProc,
+			__in_opt void * OutputContext,
+			__out_bcount_part( PlainLength, PlainWritten ) unsigned char * Plain,
+			__in size_t PlainLength,
+			__out size_t & PlainWritten
+			);
+
 	};
 }
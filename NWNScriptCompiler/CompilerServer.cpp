@@ -0,0 +1,1127 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    CompilerServer.cpp
+
+Abstract:
+
+    This module houses the compiler server, which services compile requests
+    over a named pipe using a compiler context that stays warm between
+    requests.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "CompilerServer.h"
+
+//
+// Define the text out interface used to capture the diagnostics for a single
+// request so that they can be returned to the client.
+//
+
+class StringTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	StringTextOut(
+		)
+	{
+	}
+
+	inline
+	~StringTextOut(
+		)
+	{
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine appends text to the captured diagnostics string.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text (ignored).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+
+		m_Text += buf;
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	const std::string &
+	GetText(
+		) const
+	{
+		return m_Text;
+	}
+
+private:
+
+	std::string m_Text;
+
+};
+
+//
+// Helpers to build a response payload.
+//
+
+static
+void
+AppendUINT32(
+	__inout std::vector< unsigned char > & Buffer,
+	__in UINT32 Value
+	)
+{
+	for (size_t i = 0; i < sizeof( Value ); i += 1)
+		Buffer.push_back( (unsigned char) (Value >> (i * 8)) );
+}
+
+static
+void
+AppendUINT64(
+	__inout std::vector< unsigned char > & Buffer,
+	__in ULONGLONG Value
+	)
+{
+	for (size_t i = 0; i < sizeof( Value ); i += 1)
+		Buffer.push_back( (unsigned char) (Value >> (i * 8)) );
+}
+
+static
+void
+AppendBlob(
+	__inout std::vector< unsigned char > & Buffer,
+	__in_bcount( Length ) const void * Data,
+	__in size_t Length
+	)
+{
+	AppendUINT32( Buffer, (UINT32) Length );
+
+	if (Length != 0)
+	{
+		Buffer.insert(
+			Buffer.end( ),
+			(const unsigned char *) Data,
+			(const unsigned char *) Data + Length);
+	}
+}
+
+CompilerServer::CompilerServer(
+	__in ResourceManager & ResMan,
+	__in NscCompiler & Compiler,
+	__in IDebugTextOut * TextOut,
+	__in const std::vector< std::string > & SearchPaths,
+	__in int CompilerVersion,
+	__in bool Optimize,
+	__in bool Quiet,
+	__in UINT32 CompilerFlags
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new compiler server.  The server borrows the
+	caller's resource manager and compiler context, both of which must remain
+	valid for the lifetime of the server.
+
+Arguments:
+
+	ResMan - Supplies the resource manager used to load scripts by name.
+
+	Compiler - Supplies the compiler context that is kept warm.
+
+	TextOut - Supplies the text out interface used for server status output.
+
+	SearchPaths - Supplies the include search paths, which are monitored for
+	              changes.
+
+	CompilerVersion - Supplies the default BioWare compiler version.
+
+	Optimize - Supplies the default optimization setting.
+
+	Quiet - Supplies a Boolean value that indicates true if per-request status
+	        messages should be silenced.
+
+	CompilerFlags - Supplies compiler flags that apply to every request.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ResMan( ResMan ),
+  m_Compiler( Compiler ),
+  m_TextOut( TextOut ),
+  m_SearchPaths( SearchPaths ),
+  m_CompilerVersion( CompilerVersion ),
+  m_Optimize( Optimize ),
+  m_Quiet( Quiet ),
+  m_CompilerFlags( CompilerFlags ),
+  m_NWScriptTimestamp( 0 ),
+  m_Requests( 0 ),
+  m_Invalidations( 0 ),
+  m_TotalTime( 0 ),
+  m_MaxTime( 0 )
+{
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+CompilerServer::~CompilerServer(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the compiler server, closing any change
+	notification handles.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (HandleVec::iterator it = m_ChangeHandles.begin( );
+	     it != m_ChangeHandles.end( );
+	     ++it)
+	{
+		FindCloseChangeNotification( *it );
+	}
+
+	m_ChangeHandles.clear( );
+}
+
+bool
+CompilerServer::Run(
+	__in const std::string & PipeName
+	)
+/*++
+
+Routine Description:
+
+	This routine creates the server pipe and services clients, one at a time,
+	until a client requests a shutdown.
+
+Arguments:
+
+	PipeName - Supplies the name of the pipe (without the \\.\pipe\ prefix).
+
+Return Value:
+
+	The routine returns a Boolean value indicating true if the server shut
+	down on request, else false if the pipe could not be created.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string FullPipeName;
+	bool        Running;
+
+	FullPipeName  = "\\\\.\\pipe\\";
+	FullPipeName += PipeName;
+
+	StartChangeMonitor( );
+
+	m_NWScriptTimestamp = GetNWScriptTimestamp( );
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Compiler server listening on %s.\n",
+			FullPipeName.c_str( ));
+	}
+
+	Running = true;
+
+	while (Running)
+	{
+		HANDLE Pipe;
+
+		Pipe = CreateNamedPipeA(
+			FullPipeName.c_str( ),
+			PIPE_ACCESS_DUPLEX,
+			PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+			PIPE_UNLIMITED_INSTANCES,
+			PIPE_BUFFER_SIZE,
+			PIPE_BUFFER_SIZE,
+			0,
+			NULL);
+
+		if (Pipe == INVALID_HANDLE_VALUE)
+		{
+			m_TextOut->WriteText(
+				"Error: Failed to create server pipe %s (error %lu).\n",
+				FullPipeName.c_str( ),
+				GetLastError( ));
+
+			return false;
+		}
+
+		if ((ConnectNamedPipe( Pipe, NULL )) ||
+		    (GetLastError( ) == ERROR_PIPE_CONNECTED))
+		{
+			Running = ServeClient( Pipe );
+
+			FlushFileBuffers( Pipe );
+			DisconnectNamedPipe( Pipe );
+		}
+
+		CloseHandle( Pipe );
+	}
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Compiler server stopped after %lu request(s).\n",
+			m_Requests);
+	}
+
+	return true;
+}
+
+bool
+CompilerServer::ServeClient(
+	__in HANDLE Pipe
+	)
+/*++
+
+Routine Description:
+
+	This routine services requests from a single connected client until the
+	client disconnects.
+
+Arguments:
+
+	Pipe - Supplies the connected pipe instance.
+
+Return Value:
+
+	The routine returns false if the client requested a shutdown, else true.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ByteVec Request;
+	ByteVec Response;
+	bool    Shutdown;
+
+	Shutdown = false;
+
+	while (!Shutdown)
+	{
+		if (!ReadFrame( Pipe, Request ))
+			break;
+
+		ProcessRequest( Request, Response, Shutdown );
+
+		if (!WriteFrame( Pipe, Response ))
+			break;
+	}
+
+	return !Shutdown;
+}
+
+bool
+CompilerServer::ReadFrame(
+	__in HANDLE Pipe,
+	__out ByteVec & Frame
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a length-prefixed frame from the pipe.
+
+Arguments:
+
+	Pipe - Supplies the connected pipe instance.
+
+	Frame - Receives the frame payload.
+
+Return Value:
+
+	The routine returns a Boolean value indicating true on success, else false
+	if the client disconnected or sent a malformed frame.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned char LengthBytes[ 4 ];
+	UINT32        Length;
+	DWORD         Offset;
+	DWORD         Transferred;
+
+	for (Offset = 0; Offset < sizeof( LengthBytes ); Offset += Transferred)
+	{
+		if (!ReadFile(
+			Pipe,
+			&LengthBytes[ Offset ],
+			sizeof( LengthBytes ) - Offset,
+			&Transferred,
+			NULL))
+		{
+			return false;
+		}
+
+		if (Transferred == 0)
+			return false;
+	}
+
+	Length = ((UINT32) LengthBytes[ 0 ] <<  0) |
+	         ((UINT32) LengthBytes[ 1 ] <<  8) |
+	         ((UINT32) LengthBytes[ 2 ] << 16) |
+	         ((UINT32) LengthBytes[ 3 ] << 24);
+
+	if (Length > MAX_FRAME_SIZE)
+	{
+		m_TextOut->WriteText(
+			"Error: Compiler server rejected oversized request (%lu bytes).\n",
+			(unsigned long) Length);
+
+		return false;
+	}
+
+	Frame.resize( Length );
+
+	for (Offset = 0; Offset < Length; Offset += Transferred)
+	{
+		if (!ReadFile(
+			Pipe,
+			&Frame[ Offset ],
+			Length - Offset,
+			&Transferred,
+			NULL))
+		{
+			return false;
+		}
+
+		if (Transferred == 0)
+			return false;
+	}
+
+	return true;
+}
+
+bool
+CompilerServer::WriteFrame(
+	__in HANDLE Pipe,
+	__in const ByteVec & Frame
+	)
+/*++
+
+Routine Description:
+
+	This routine writes a length-prefixed frame to the pipe.
+
+Arguments:
+
+	Pipe - Supplies the connected pipe instance.
+
+	Frame - Supplies the frame payload.
+
+Return Value:
+
+	The routine returns a Boolean value indicating true on success, else false
+	on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ByteVec Buffer;
+	DWORD   Offset;
+	DWORD   Transferred;
+
+	Buffer.reserve( Frame.size( ) + sizeof( UINT32 ) );
+
+	AppendUINT32( Buffer, (UINT32) Frame.size( ) );
+	Buffer.insert( Buffer.end( ), Frame.begin( ), Frame.end( ) );
+
+	for (Offset = 0; Offset < (DWORD) Buffer.size( ); Offset += Transferred)
+	{
+		if (!WriteFile(
+			Pipe,
+			&Buffer[ Offset ],
+			(DWORD) Buffer.size( ) - Offset,
+			&Transferred,
+			NULL))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+CompilerServer::ProcessRequest(
+	__in const ByteVec & Request,
+	__out ByteVec & Response,
+	__out bool & Shutdown
+	)
+/*++
+
+Routine Description:
+
+	This routine executes a single request and builds the response payload.
+
+Arguments:
+
+	Request - Supplies the request payload.
+
+	Response - Receives the response payload.
+
+	Shutdown - Receives true if the server is to stop after replying.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Code;
+	std::vector< unsigned char > Symbols;
+	std::vector< unsigned char > Source;
+	StringTextOut                Diagnostics;
+	UINT32                       Status;
+	UINT32                       Command;
+	UINT32                       CompilerFlags;
+	UINT32                       Options;
+	INT32                        CompilerVersion;
+	UINT32                       NameLength;
+	UINT32                       SourceLength;
+	const void                 * NameData;
+	const void                 * SourceData;
+	std::string                  Name;
+	ULONGLONG                    StartTime;
+	ULONGLONG                    LoadTime;
+	ULONGLONG                    CompileTime;
+	ULONGLONG                    TotalTime;
+
+	StartTime       = GetMicroseconds( );
+	Command         = 0;
+	CompilerFlags   = 0;
+	Options         = 0;
+	CompilerVersion = 0;
+	NameLength      = 0;
+	SourceLength    = 0;
+	NameData        = NULL;
+	SourceData      = NULL;
+	LoadTime        = 0;
+	CompileTime     = 0;
+	Status          = NscServerStatus_Error;
+	Shutdown        = false;
+
+	//
+	// Pick up any source changes since the last request first, so that the
+	// request sees the current include files.
+	//
+
+	CheckForChanges( );
+
+	try
+	{
+		swutil::BufferParser Parser(
+			Request.empty( ) ? NULL : &Request[ 0 ],
+			Request.size( ));
+
+		if ((!Parser.GetField( Command ))                           ||
+		    (!Parser.GetField( CompilerFlags ))                     ||
+		    (!Parser.GetField( Options ))                           ||
+		    (!Parser.GetField( CompilerVersion ))                   ||
+		    (!Parser.GetField( NameLength ))                        ||
+		    (!Parser.GetDataPtr( NameLength, &NameData ))           ||
+		    (!Parser.GetField( SourceLength ))                      ||
+		    (!Parser.GetDataPtr( SourceLength, &SourceData )))
+		{
+			Diagnostics.WriteText( "Error: Malformed compiler server request.\n" );
+			Command = 0;
+		}
+
+		switch (Command)
+		{
+
+		case 0:
+			break;
+
+		case NscServerCmd_Compile:
+			{
+				NWN::ResRef32 FileResRef;
+				NWN::ResType  FileResType;
+				NscResult     Result;
+
+				Name.assign( (const char *) NameData, NameLength );
+
+				if (CompilerVersion == 0)
+					CompilerVersion = m_CompilerVersion;
+
+				//
+				// Use the supplied source text if there was any, otherwise
+				// load the script through the same path as the command line
+				// driver (filesystem first, then the resource system).
+				//
+
+				if (SourceLength != 0)
+				{
+					char FileName[ _MAX_FNAME ];
+
+					if (_splitpath_s(
+						Name.c_str( ),
+						NULL,
+						0,
+						NULL,
+						0,
+						FileName,
+						_MAX_FNAME,
+						NULL,
+						0))
+					{
+						Diagnostics.WriteText(
+							"Error: Malformed file pathname \"%s\".\n",
+							Name.c_str( ));
+						break;
+					}
+
+					FileResRef = m_ResMan.ResRef32FromStr( FileName );
+					Source.assign(
+						(const unsigned char *) SourceData,
+						(const unsigned char *) SourceData + SourceLength);
+				}
+				else if (!LoadInputFile(
+					m_ResMan,
+					&Diagnostics,
+					Name,
+					FileResRef,
+					FileResType,
+					Source))
+				{
+					Diagnostics.WriteText(
+						"Error: Unable to read input file '%s'.\n",
+						Name.c_str( ));
+					break;
+				}
+
+				LoadTime = GetMicroseconds( ) - StartTime;
+
+				Result = m_Compiler.NscCompileScript(
+					FileResRef,
+					(!Source.empty( )) ? &Source[ 0 ] : NULL,
+					Source.size( ),
+					CompilerVersion,
+					m_Optimize || ((Options & NscServerOpt_Optimize) != 0),
+					(Options & NscServerOpt_IgnoreIncludes) != 0,
+					&Diagnostics,
+					m_CompilerFlags | CompilerFlags,
+					Code,
+					Symbols);
+
+				CompileTime = GetMicroseconds( ) - StartTime - LoadTime;
+				Status      = (UINT32) Result;
+
+				if ((Options & NscServerOpt_NoDebugSymbols) != 0)
+					Symbols.clear( );
+			}
+			break;
+
+		case NscServerCmd_Invalidate:
+			Invalidate(
+				(Options & NscServerOpt_ResetCompiler) != 0,
+				"client requested invalidation");
+			Status = NscResult_Success;
+			break;
+
+		case NscServerCmd_QueryStats:
+			Diagnostics.WriteText(
+				"Requests: %lu\n"
+				"Invalidations: %lu\n"
+				"TotalTimeUs: %I64u\n"
+				"AverageTimeUs: %I64u\n"
+				"MaxTimeUs: %I64u\n",
+				m_Requests,
+				m_Invalidations,
+				m_TotalTime,
+				m_Requests ? m_TotalTime / m_Requests : 0,
+				m_MaxTime);
+			Status = NscResult_Success;
+			break;
+
+		case NscServerCmd_Shutdown:
+			Shutdown = true;
+			Status   = NscResult_Success;
+			break;
+
+		default:
+			Diagnostics.WriteText(
+				"Error: Unknown compiler server command %lu.\n",
+				(unsigned long) Command);
+			break;
+
+		}
+	}
+	catch (std::exception &e)
+	{
+		Diagnostics.WriteText(
+			"Error: Exception '%s' servicing compiler server request.\n",
+			e.what( ));
+
+		Code.clear( );
+		Symbols.clear( );
+		Status = NscServerStatus_Error;
+	}
+
+	TotalTime = GetMicroseconds( ) - StartTime;
+
+	m_Requests  += 1;
+	m_TotalTime += TotalTime;
+
+	if (TotalTime > m_MaxTime)
+		m_MaxTime = TotalTime;
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Server: request %lu (%s) status %ld in %I64uus (load %I64uus, compile %I64uus).\n",
+			m_Requests,
+			Name.empty( ) ? "-" : Name.c_str( ),
+			(long) Status,
+			TotalTime,
+			LoadTime,
+			CompileTime);
+	}
+
+	//
+	// Build the response.
+	//
+
+	Response.clear( );
+
+	AppendUINT32( Response, Status );
+	AppendUINT64( Response, LoadTime );
+	AppendUINT64( Response, CompileTime );
+	AppendUINT64( Response, TotalTime );
+	AppendBlob( Response, Code.empty( ) ? NULL : &Code[ 0 ], Code.size( ) );
+	AppendBlob( Response, Symbols.empty( ) ? NULL : &Symbols[ 0 ], Symbols.size( ) );
+	AppendBlob( Response, Diagnostics.GetText( ).data( ), Diagnostics.GetText( ).size( ) );
+}
+
+void
+CompilerServer::StartChangeMonitor(
+	)
+/*++
+
+Routine Description:
+
+	This routine registers change notifications for each include search path,
+	and for each directory that the resource manager reads directory resources
+	(such as a directory module or the override directory) from, so that
+	edited include files are picked up by the next request.
+
+	Scripts that were found in an ERF, HAK or ZIP file are not watched, as the
+	resource manager only reads those files when the module is loaded.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< std::string > ResourceDirectories;
+
+	for (std::vector< std::string >::const_iterator it = m_SearchPaths.begin( );
+	     it != m_SearchPaths.end( );
+	     ++it)
+	{
+		if (!WatchDirectory( *it, false ))
+		{
+			m_TextOut->WriteText(
+				"Warning: Unable to monitor include path \"%s\" for changes (error %lu).\n",
+				it->c_str( ),
+				GetLastError( ));
+		}
+	}
+
+	//
+	// Directory resources are indexed recursively, so watch the whole tree.
+	// Directories that the resource manager searches but which do not exist
+	// (such as an absent override directory) are skipped quietly.
+	//
+
+	m_ResMan.GetResourceDirectories( ResourceDirectories );
+
+	for (std::vector< std::string >::const_iterator it = ResourceDirectories.begin( );
+	     it != ResourceDirectories.end( );
+	     ++it)
+	{
+		DWORD Attributes;
+
+		Attributes = GetFileAttributesA( it->c_str( ) );
+
+		if ((Attributes == INVALID_FILE_ATTRIBUTES) ||
+		    (!(Attributes & FILE_ATTRIBUTE_DIRECTORY)))
+		{
+			continue;
+		}
+
+		if (!WatchDirectory( *it, true ))
+		{
+			m_TextOut->WriteText(
+				"Warning: Unable to monitor resource directory \"%s\" for changes (error %lu).\n",
+				it->c_str( ),
+				GetLastError( ));
+		}
+	}
+}
+
+bool
+CompilerServer::WatchDirectory(
+	__in const std::string & Directory,
+	__in bool WatchSubtree
+	)
+/*++
+
+Routine Description:
+
+	This routine registers a change notification for a directory, which is
+	polled by CheckForChanges.
+
+Arguments:
+
+	Directory - Supplies the directory to watch.
+
+	WatchSubtree - Supplies a Boolean value indicating true if changes to the
+	               subdirectories of the directory are to be reported too.
+
+Return Value:
+
+	The routine returns true if the directory is being watched, else false if
+	the change notification could not be created (in which case the last
+	error is set).
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	HANDLE Change;
+
+	Change = FindFirstChangeNotificationA(
+		Directory.c_str( ),
+		WatchSubtree ? TRUE : FALSE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+
+	if (Change == INVALID_HANDLE_VALUE)
+		return false;
+
+	try
+	{
+		m_ChangeHandles.push_back( Change );
+	}
+	catch (std::exception)
+	{
+		FindCloseChangeNotification( Change );
+		throw;
+	}
+
+	return true;
+}
+
+void
+CompilerServer::CheckForChanges(
+	)
+/*++
+
+Routine Description:
+
+	This routine polls the change notifications registered by
+	StartChangeMonitor.  If any watched directory changed, the include cache
+	is flushed, and if nwscript.nss itself changed, the compiler is reset so
+	that it is reparsed.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	bool      Changed;
+	ULONGLONG Timestamp;
+
+	Changed = false;
+
+	for (HandleVec::iterator it = m_ChangeHandles.begin( );
+	     it != m_ChangeHandles.end( );
+	     ++it)
+	{
+		if (WaitForSingleObject( *it, 0 ) != WAIT_OBJECT_0)
+			continue;
+
+		Changed = true;
+
+		FindNextChangeNotification( *it );
+	}
+
+	if (!Changed)
+		return;
+
+	Timestamp = GetNWScriptTimestamp( );
+
+	Invalidate( Timestamp != m_NWScriptTimestamp, "source change detected" );
+
+	m_NWScriptTimestamp = Timestamp;
+}
+
+void
+CompilerServer::Invalidate(
+	__in bool ResetCompiler,
+	__in const char * Reason
+	)
+/*++
+
+Routine Description:
+
+	This routine drops cached compiler state.
+
+Arguments:
+
+	ResetCompiler - Supplies a Boolean value indicating true if nwscript.nss
+	                is to be reparsed on the next request.
+
+	Reason - Supplies the reason for the invalidation, which is printed to
+	         the console.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_Compiler.NscSetResourceCacheEnabled( false );
+	m_Compiler.NscSetResourceCacheEnabled( true );
+
+	if (ResetCompiler)
+		m_Compiler.NscResetCompiler( );
+
+	m_Invalidations += 1;
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Server: %s, flushed include cache%s.\n",
+			Reason,
+			ResetCompiler ? " and nwscript.nss" : "");
+	}
+}
+
+ULONGLONG
+CompilerServer::GetNWScriptTimestamp(
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the last write time of the first nwscript.nss found
+	along the include search paths.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns the last write time, else zero if no nwscript.nss was
+	found on disk.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (std::vector< std::string >::const_iterator it = m_SearchPaths.begin( );
+	     it != m_SearchPaths.end( );
+	     ++it)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA Attributes;
+		std::string               FileName;
+		ULARGE_INTEGER            Timestamp;
+
+		FileName  = *it;
+		FileName += "\\nwscript.nss";
+
+		if (!GetFileAttributesExA(
+			FileName.c_str( ),
+			GetFileExInfoStandard,
+			&Attributes))
+		{
+			continue;
+		}
+
+		Timestamp.LowPart  = Attributes.ftLastWriteTime.dwLowDateTime;
+		Timestamp.HighPart = Attributes.ftLastWriteTime.dwHighDateTime;
+
+		return Timestamp.QuadPart;
+	}
+
+	return 0;
+}
+
+ULONGLONG
+CompilerServer::GetMicroseconds(
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a monotonic timestamp in microseconds.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The current time, in microseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	LARGE_INTEGER Counter;
+
+	if ((m_Frequency.QuadPart == 0) || (!QueryPerformanceCounter( &Counter )))
+		return (ULONGLONG) GetTickCount( ) * 1000;
+
+	return (ULONGLONG) ((Counter.QuadPart / m_Frequency.QuadPart) * 1000000 +
+		((Counter.QuadPart % m_Frequency.QuadPart) * 1000000) / m_Frequency.QuadPart);
+}
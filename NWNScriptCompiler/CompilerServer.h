@@ -0,0 +1,261 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    CompilerServer.h
+
+Abstract:
+
+    This module defines the compiler server, which keeps a warm compiler
+    context (loaded module resources, parsed nwscript.nss and the include
+    cache) resident and services compile requests over a local named pipe.
+
+    The wire protocol is a simple length-prefixed framing.  Each message is a
+    little endian UINT32 byte count followed by that many bytes of payload.
+    All integers in the payload are little endian.
+
+    Request payload:
+
+        UINT32 Command         - NSC_SERVER_COMMAND value.
+        UINT32 CompilerFlags   - NscCompilerFlags (OR'd with the server's).
+        UINT32 Options         - NSC_SERVER_OPTIONS values.
+        INT32  CompilerVersion - BioWare compiler version, 0 for default.
+        UINT32 NameLength      - Followed by the script name (file path or
+                                 resource name, no terminator).
+        UINT32 SourceLength    - Followed by the script source text.  If the
+                                 length is zero, the script is loaded by name.
+
+    Response payload:
+
+        UINT32 Status          - NscResult value, or NscServerStatus_Error.
+        UINT64 LoadTime        - Microseconds spent loading the source text.
+        UINT64 CompileTime     - Microseconds spent in the compiler.
+        UINT64 TotalTime       - Microseconds spent servicing the request.
+        UINT32 CodeLength      - Followed by the compiled NCS image.
+        UINT32 SymbolsLength   - Followed by the NDB debug symbols.
+        UINT32 TextLength      - Followed by the diagnostics text.
+
+--*/
+
+#ifndef _PROGRAMS_NWNSCRIPTCOMPILER_COMPILERSERVER_H
+#define _PROGRAMS_NWNSCRIPTCOMPILER_COMPILERSERVER_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+typedef enum _NSC_SERVER_COMMAND
+{
+	//
+	// Compile a script and return the results.
+	//
+
+	NscServerCmd_Compile             = 0x00000001,
+
+	//
+	// Flush the include cache.  If the compile options contain
+	// NscServerOpt_ResetCompiler, nwscript.nss is reparsed as well.
+	//
+
+	NscServerCmd_Invalidate          = 0x00000002,
+
+	//
+	// Return the accumulated latency statistics as diagnostics text.
+	//
+
+	NscServerCmd_QueryStats          = 0x00000003,
+
+	//
+	// Stop the server after replying.
+	//
+
+	NscServerCmd_Shutdown            = 0x00000004,
+
+	NscServerCmd_LastCommand
+} NSC_SERVER_COMMAND, * PNSC_SERVER_COMMAND;
+
+typedef enum _NSC_SERVER_OPTIONS
+{
+	NscServerOpt_Optimize            = 0x00000001,
+	NscServerOpt_IgnoreIncludes      = 0x00000002,
+	NscServerOpt_NoDebugSymbols      = 0x00000004,
+	NscServerOpt_ResetCompiler       = 0x00000008,
+
+	NscServerOpt_LastOption
+} NSC_SERVER_OPTIONS, * PNSC_SERVER_OPTIONS;
+
+//
+// Status returned for malformed or failed requests (as opposed to a script
+// that failed to compile, which returns NscResult_Failure).
+//
+
+#define NscServerStatus_Error 0xFFFFFFFF
+
+bool
+LoadInputFile(
+	__in ResourceManager & ResMan,
+	__in IDebugTextOut * TextOut,
+	__in const std::string & InFile,
+	__out NWN::ResRef32 & FileResRef,
+	__out NWN::ResType & FileResType,
+	__out std::vector< unsigned char > & FileContents
+	);
+
+class CompilerServer
+{
+
+public:
+
+	CompilerServer(
+		__in ResourceManager & ResMan,
+		__in NscCompiler & Compiler,
+		__in IDebugTextOut * TextOut,
+		__in const std::vector< std::string > & SearchPaths,
+		__in int CompilerVersion,
+		__in bool Optimize,
+		__in bool Quiet,
+		__in UINT32 CompilerFlags
+		);
+
+	~CompilerServer(
+		);
+
+	//
+	// Service requests on the given pipe name until a shutdown request is
+	// received.  The pipe is created as \\.\pipe\<PipeName>.
+	//
+
+	bool
+	Run(
+		__in const std::string & PipeName
+		);
+
+private:
+
+	typedef std::vector< unsigned char > ByteVec;
+	typedef std::vector< HANDLE > HandleVec;
+
+	enum
+	{
+		MAX_FRAME_SIZE  = 16 * 1024 * 1024,
+		PIPE_BUFFER_SIZE = 64 * 1024
+	};
+
+	//
+	// Service a single connected client, returning false if the server is to
+	// shut down.
+	//
+
+	bool
+	ServeClient(
+		__in HANDLE Pipe
+		);
+
+	//
+	// Read and write a length-prefixed frame.
+	//
+
+	bool
+	ReadFrame(
+		__in HANDLE Pipe,
+		__out ByteVec & Frame
+		);
+
+	bool
+	WriteFrame(
+		__in HANDLE Pipe,
+		__in const ByteVec & Frame
+		);
+
+	//
+	// Execute a request and build the response.
+	//
+
+	void
+	ProcessRequest(
+		__in const ByteVec & Request,
+		__out ByteVec & Response,
+		__out bool & Shutdown
+		);
+
+	//
+	// Begin watching the include search paths, and the directories that the
+	// resource manager reads directory resources from, for modifications.
+	//
+
+	void
+	StartChangeMonitor(
+		);
+
+	//
+	// Register a change notification for a single directory.
+	//
+
+	bool
+	WatchDirectory(
+		__in const std::string & Directory,
+		__in bool WatchSubtree
+		);
+
+	//
+	// Poll the change notifications and invalidate cached state if any
+	// watched file changed.
+	//
+
+	void
+	CheckForChanges(
+		);
+
+	//
+	// Drop cached include files, and optionally the parsed nwscript.nss.  The
+	// reason is printed to the console.
+	//
+
+	void
+	Invalidate(
+		__in bool ResetCompiler,
+		__in const char * Reason
+		);
+
+	//
+	// Return the last write time of nwscript.nss in the search paths.
+	//
+
+	ULONGLONG
+	GetNWScriptTimestamp(
+		);
+
+	//
+	// Return the current time in microseconds.
+	//
+
+	ULONGLONG
+	GetMicroseconds(
+		);
+
+	ResourceManager            & m_ResMan;
+	NscCompiler                & m_Compiler;
+	IDebugTextOut              * m_TextOut;
+	std::vector< std::string >   m_SearchPaths;
+	int                          m_CompilerVersion;
+	bool                         m_Optimize;
+	bool                         m_Quiet;
+	UINT32                       m_CompilerFlags;
+	HandleVec                    m_ChangeHandles;
+	ULONGLONG                    m_NWScriptTimestamp;
+	LARGE_INTEGER                m_Frequency;
+
+	//
+	// Latency statistics.
+	//
+
+	unsigned long                m_Requests;
+	unsigned long                m_Invalidations;
+	ULONGLONG                    m_TotalTime;
+	ULONGLONG                    m_MaxTime;
+
+};
+
+#endif
@@ -20,6 +20,9 @@ Abstract:
 #include "../NWN2DataLib/GffFileWriter.h"
 #include "../NWN2DataLib/NWScriptReader.h"
 #include "../NWNScriptCompilerLib/Nsc.h"
+#include "CompilerServer.h"
+#include "ModuleAnalyzer.h"
+#include "ModuleDisassembler.h"
 
 typedef std::vector< std::wstring > WStringVec;
 typedef std::vector< const wchar_t * > WStringArgVec;
@@ -2270,6 +2273,9 @@ Environment:
 	std::string                ErrorPrefix;
 	std::string                BatchOutDir;
 	std::string                CustomModPath;
+	std::string                ServerPipeName;
+	std::string                AnalyzeReportFile;
+	std::string                DisassemblyOutDir;
 	WStringVec                 ResponseFileText;
 	WStringArgVec              ResponseFileArgs;
 	bool                       Compile            = true;
@@ -2366,6 +2372,10 @@ Environment:
 						EnableExtensions = true;
 						break;
 
+					case L'f':
+						CompilerFlags |= NscCompilerFlag_FuseTailCalls;
+						break;
+
 					case L'g':
 						NoDebug = true;
 						break;
@@ -2532,6 +2542,61 @@ Environment:
 						}
 						break;
 
+					case L's':
+						CompilerFlags |= NscCompilerFlag_OptimizeNcs;
+						break;
+
+					case L't':
+						{
+							if (i + 1 >= argc)
+							{
+								wprintf( L"Error: Malformed arguments.\n" );
+								Error = true;
+								break;
+							}
+
+							if (!swutil::UnicodeToAnsi( argv[ i + 1 ], AnalyzeReportFile ))
+							{
+								wprintf(
+									L"Failed to convert report file name '%s' from wchar_t to char.\n",
+									argv[ i + 1 ]);
+								Error = true;
+								break;
+							}
+
+							LoadResources = true;
+							i += 1;
+						}
+						break;
+
+					case L'u':
+						{
+							if (i + 1 >= argc)
+							{
+								wprintf( L"Error: Malformed arguments.\n" );
+								Error = true;
+								break;
+							}
+
+							if (!swutil::UnicodeToAnsi( argv[ i + 1 ], DisassemblyOutDir ))
+							{
+								wprintf(
+									L"Error: Failed to convert disassembly output directory '%s' from wchar_t to char.\n",
+									argv[ i + 1 ]);
+								Error = true;
+								break;
+							}
+
+							if (DisassemblyOutDir.empty( ))
+								DisassemblyOutDir = ".";
+
+							DisassemblyOutDir.push_back( '/' );
+
+							LoadResources = true;
+							i += 1;
+						}
+						break;
+
 					case L'v':
 						{
 							CompilerVersion = 0;
@@ -2561,6 +2626,28 @@ Environment:
 						}
 						break;
 
+					case L'w':
+						{
+							if (i + 1 >= argc)
+							{
+								wprintf( L"Error: Malformed arguments.\n" );
+								Error = true;
+								break;
+							}
+
+							if (!swutil::UnicodeToAnsi( argv[ i + 1 ], ServerPipeName ))
+							{
+								wprintf(
+									L"Failed to convert server pipe name '%s' from wchar_t to char.\n",
+									argv[ i + 1 ]);
+								Error = true;
+								break;
+							}
+
+							i += 1;
+						}
+						break;
+
 					case L'x':
 						{
 							if (i + 1 >= argc)
@@ -2691,6 +2778,23 @@ Environment:
 		}
 	} while (!Error) ;
 
+	//
+	// Server mode compiles the files that clients ask for, so it does not take
+	// input files on the command line.
+	//
+
+	if ((!Error) && (!ServerPipeName.empty( )) && (!InFiles.empty( )))
+	{
+		wprintf( L"Error: Input files cannot be used with -w (compile server mode).\n" );
+		Error = true;
+	}
+
+	//
+	// Report what the NCS optimizer did unless we were asked to be quiet.
+	//
+
+	if ((!Quiet) && ((CompilerFlags & NscCompilerFlag_OptimizeNcs) != 0))
+		CompilerFlags |= NscCompilerFlag_ShowOptimizerStats;
 
 	if (!Quiet)
 	{
@@ -2703,13 +2807,16 @@ Environment:
 			__TIME__);
 	}
 
-	if ((Error) || (InFiles.empty( )))
+	if ((Error) ||
+	    ((InFiles.empty( )) && (ServerPipeName.empty( )) && (AnalyzeReportFile.empty( )) &&
+	     (DisassemblyOutDir.empty( ))))
 	{
 		wprintf(
 			L"Usage:\n"
-			L"NWNScriptCompiler [-1acdegjkloq] [-b batchoutdir] [-h homedir]\n"
+			L"NWNScriptCompiler [-1acdefgjkloqs] [-b batchoutdir] [-h homedir]\n"
 			L"                  [[-i pathspec] ...] [-m resref] [-n installdir]\n"
-			L"                  [-r modpath] [-v#] [-x errprefix] [-y]\n"
+			L"                  [-r modpath] [-t reportfile] [-u disasmdir] [-v#]\n"
+			L"                  [-w pipename] [-x errprefix] [-y]\n"
 			L"                  infile [outfile|infiles]\n"
 			L"  batchoutdir - Supplies the location at which batch mode places\n"
 			L"                output files and enables multiple input filenames.\n"
@@ -2722,6 +2829,21 @@ Environment:
 			L"  modpath - Supplies the full path to the .mod (or directory) that\n"
 			L"            contains the module.ifo for the module to load.  This\n"
 			L"            option overrides the [-r resref] option.\n"
+			L"  reportfile - Analyzes every compiled script (.ncs) in the loaded\n"
+			L"               module in parallel and writes a JSON report of the\n"
+			L"               results.  Input files are not required in this mode.\n"
+			L"  disasmdir - Disassembles every compiled script (.ncs) in the loaded\n"
+			L"              module in parallel, writing one .pcode file per script\n"
+			L"              to disasmdir and reporting throughput.  Input files are\n"
+			L"              not required in this mode.\n"
+			L"  pipename - Runs a compile server on \\\\.\\pipe\\pipename that keeps\n"
+			L"             resources, nwscript.nss and includes loaded between\n"
+			L"             requests.  Input files cannot be given in this mode.\n"
+			L"             Edits under the include paths and the module, campaign\n"
+			L"             and override directories flush the include cache.\n"
+			L"             Scripts in ERF, HAK or ZIP files, and new files in the\n"
+			L"             module and override directories, are only seen after\n"
+			L"             the server is restarted.\n"
 			L"  errprefix - Prefix string to prepend to compiler errors (replacing\n"
 			L"              the default of \"Error\").\n"
 			L"  -1 - Assume NWN1-style module and KEY/BIF resources instead of\n"
@@ -2731,6 +2853,9 @@ Environment:
 			L"  -c - Compile the script (default, overrides -d).\n"
 			L"  -d - Disassemble the script (overrides -c).\n"
 			L"  -e - Enable non-BioWare extensions.\n"
+			L"  -f - With -s, also turn JSR/RETN tail calls into JMP.  Off by\n"
+			L"       default, as the fused code has not been verified against\n"
+			L"       the script analyzer (-a) or the JIT.\n"
 			L"  -g - Suppress generation of .ndb debug symbols file.\n"
 			L"  -j - Show where include file are being sourced from.\n"
 			L"  -k - Show preprocessed source text to console output.\n"
@@ -2739,6 +2864,9 @@ Environment:
 			L"  -o - Optimize the compiled script.\n"
 			L"  -p - Dump internal PCode for compiled script contributions.\n"
 			L"  -q - Silence most messages.\n"
+			L"  -s - Run the NCS optimizer over the generated code and report\n"
+			L"       the static instruction and byte reduction of each script\n"
+			L"       (not applied to scripts that use ReadPC).\n"
 			L"  -vx.xx - Set the version of the compiler.\n"
 			L"  -y - Continue processing input files even on error.\n"
 			);
@@ -2811,6 +2939,33 @@ Environment:
 			CustomModPath);
 	}
 
+	//
+	// If we are to analyze the compiled scripts of the module, then do so now;
+	// no compiler context is required for this.
+	//
+
+	if (!AnalyzeReportFile.empty( ))
+	{
+		ModuleAnalyzer Analyzer( *g_ResMan, &g_TextOut, Erf16, Quiet );
+
+		if (Analyzer.AnalyzeModule( AnalyzeReportFile ) != 0)
+			ReturnCode = -1;
+
+		if (InFiles.empty( ) && ServerPipeName.empty( ) && DisassemblyOutDir.empty( ))
+		{
+			if (g_Log != NULL)
+			{
+				fclose( g_Log );
+				g_Log = NULL;
+			}
+
+			delete g_ResMan;
+			g_ResMan = NULL;
+
+			return ReturnCode;
+		}
+	}
+
 	//
 	// Now create the script compiler context.
 	//
@@ -2831,6 +2986,57 @@ Environment:
 
 	SetConsoleCtrlHandler( AppConsoleCtrlHandler, TRUE );
 
+	//
+	// If we are to disassemble the compiled scripts of the module, then do so
+	// now.  The compiler context supplies the action names.
+	//
+
+	if (!DisassemblyOutDir.empty( ))
+	{
+		ModuleDisassembler Disassembler( *g_ResMan, Compiler, &g_TextOut, Quiet );
+
+		if (Disassembler.DisassembleModule( DisassemblyOutDir ) != 0)
+			ReturnCode = -1;
+	}
+
+	//
+	// If we are to run as a compile server, then service requests until we
+	// are asked to stop.  The compiler context is kept warm across requests.
+	//
+
+	if (!ServerPipeName.empty( ))
+	{
+		CompilerServer Server(
+			*g_ResMan,
+			Compiler,
+			&g_TextOut,
+			SearchPaths,
+			CompilerVersion,
+			Optimize,
+			Quiet,
+			CompilerFlags);
+
+		if (!Server.Run( ServerPipeName ))
+			ReturnCode = -1;
+
+		//
+		// The server runs instead of compiling input files, so we are done.
+		//
+
+		if (g_Log != NULL)
+		{
+			fclose( g_Log );
+			g_Log = NULL;
+		}
+
+		SetConsoleCtrlHandler( AppConsoleCtrlHandler, FALSE );
+
+		delete g_ResMan;
+		g_ResMan = NULL;
+
+		return ReturnCode;
+	}
+
 	//
 	// Process each of the input files in turn.
 	//
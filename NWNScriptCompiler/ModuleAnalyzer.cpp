@@ -0,0 +1,847 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    ModuleAnalyzer.cpp
+
+Abstract:
+
+    This module houses the module analyzer, which runs the NWScriptAnalyzer
+    over every compiled script available through the resource system in
+    parallel and reports the results.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/NWScriptReader.h"
+#include "../NWNScriptCompilerLib/NscOptimizer.h"
+#include "ModuleAnalyzer.h"
+
+ModuleAnalyzer::ModuleAnalyzer(
+	__in ResourceManager & ResMan,
+	__in IDebugTextOut * TextOut,
+	__in bool Nwn1Actions,
+	__in bool Quiet
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new module analyzer.
+
+Arguments:
+
+	ResMan - Supplies the resource manager whose compiled scripts are to be
+	         analyzed.
+
+	TextOut - Supplies the text out interface used for status output.
+
+	Nwn1Actions - Supplies a Boolean value indicating true if the NWN1 action
+	              table is to be used instead of the NWN2 action table.
+
+	Quiet - Supplies a Boolean value that indicates true if non-critical
+	        messages should be silenced.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ResMan( ResMan ),
+  m_TextOut( TextOut ),
+  m_Quiet( Quiet ),
+  m_NextScript( 0 )
+{
+	if (Nwn1Actions)
+	{
+		m_ActionDefs  = NWActions_NWN1;
+		m_ActionCount = MAX_ACTION_ID_NWN1;
+	}
+	else
+	{
+		m_ActionDefs  = NWActions_NWN2;
+		m_ActionCount = MAX_ACTION_ID_NWN2;
+	}
+
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+ModuleAnalyzer::~ModuleAnalyzer(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the module analyzer.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+int
+ModuleAnalyzer::AnalyzeModule(
+	__in const std::string & ReportFile
+	)
+/*++
+
+Routine Description:
+
+	This routine loads every compiled script, analyzes them in parallel on one
+	worker thread per processor, and writes the report.
+
+	The resource manager is not thread safe, so all script loading happens on
+	the calling thread before the workers start.  Each worker then owns its
+	own NWScriptAnalyzer instance for each script it picks up.
+
+Arguments:
+
+	ReportFile - Supplies the file name of the report to write.
+
+Return Value:
+
+	The routine returns the count of scripts that failed analysis, or -1 if
+	the report could not be written.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	SYSTEM_INFO SystemInfo;
+	ULONGLONG   StartTime;
+	ULONGLONG   LoadTime;
+	ULONGLONG   AnalyzeTime;
+	size_t      WorkerCount;
+	int         Failures;
+
+	StartTime = GetMicroseconds( );
+
+	LoadScripts( );
+
+	LoadTime = GetMicroseconds( ) - StartTime;
+
+	GetSystemInfo( &SystemInfo );
+
+	WorkerCount = SystemInfo.dwNumberOfProcessors;
+
+	if (WorkerCount > m_Scripts.size( ))
+		WorkerCount = m_Scripts.size( );
+	if (WorkerCount == 0)
+		WorkerCount = 1;
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Analyzing %lu compiled script(s) on %lu thread(s)...\n",
+			(unsigned long) m_Scripts.size( ),
+			(unsigned long) WorkerCount);
+	}
+
+	//
+	// Start the workers.  If a thread cannot be created, then the scripts are
+	// simply picked up by the threads that did start (or by the calling
+	// thread, below).
+	//
+
+	StartTime = GetMicroseconds( );
+
+	m_NextScript = 0;
+	m_Workers.resize( WorkerCount );
+
+	for (size_t i = 0; i < WorkerCount; i += 1)
+	{
+		WorkerContext & Worker = m_Workers[ i ];
+
+		Worker.Analyzer        = this;
+		Worker.ScriptsAnalyzed = 0;
+		Worker.BusyTime        = 0;
+		Worker.Thread          = CreateThread(
+			NULL,
+			0,
+			WorkerThread,
+			&Worker,
+			0,
+			NULL);
+	}
+
+	for (size_t i = 0; i < WorkerCount; i += 1)
+	{
+		WorkerContext & Worker = m_Workers[ i ];
+
+		if (Worker.Thread == NULL)
+		{
+			WorkerThread( &Worker );
+			continue;
+		}
+
+		WaitForSingleObject( Worker.Thread, INFINITE );
+		CloseHandle( Worker.Thread );
+		Worker.Thread = NULL;
+	}
+
+	AnalyzeTime = GetMicroseconds( ) - StartTime;
+
+	//
+	// Summarize the results.
+	//
+
+	Failures = 0;
+
+	for (ScriptResultVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		if (it->Status == ScriptStatus_Ok)
+			continue;
+
+		Failures += 1;
+
+		m_TextOut->WriteText(
+			"Error: (Verifier error): %s '%s' at PC=%08X analyzing script \"%s.ncs\".\n",
+			GetStatusName( it->Status ),
+			it->Message.c_str( ),
+			(unsigned long) it->PC,
+			it->Name.c_str( ));
+	}
+
+	if (!m_Quiet)
+	{
+		double Seconds = (double) AnalyzeTime / 1000000.0;
+		double Rate    = (Seconds > 0.0) ? (double) m_Scripts.size( ) / Seconds : 0.0;
+
+		m_TextOut->WriteText(
+			"Analyzed %lu script(s), %d failure(s), load %I64ums, analysis %I64ums (%.1f scripts/s, %.1f scripts/s per core).\n",
+			(unsigned long) m_Scripts.size( ),
+			Failures,
+			LoadTime / 1000,
+			AnalyzeTime / 1000,
+			Rate,
+			Rate / (double) WorkerCount);
+	}
+
+	if (!WriteReport( ReportFile, LoadTime, AnalyzeTime ))
+		return -1;
+
+	return Failures;
+}
+
+void
+ModuleAnalyzer::LoadScripts(
+	)
+/*++
+
+Routine Description:
+
+	This routine reads every *.ncs resource into memory.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_Scripts.clear( );
+
+	for (ResourceManager::FileId Id = m_ResMan.GetEncapsulatedFileCount( );
+	     Id != 0;
+	     Id -= 1)
+	{
+		NWN::ResRef32              ResRef;
+		NWN::ResType               ResType;
+		ResourceManager::FileHandle File;
+		size_t                     Size;
+		size_t                     BytesRead;
+
+		if (!m_ResMan.GetEncapsulatedFileEntry( (Id - 1), ResRef, ResType ))
+			continue;
+
+		if (ResType != NWN::ResNCS)
+			continue;
+
+		m_Scripts.push_back( ScriptResult( ) );
+
+		ScriptResult & Result = m_Scripts.back( );
+
+		Result.Name                    = m_ResMan.StrFromResRef( ResRef );
+		Result.Status                  = ScriptStatus_Ok;
+		Result.PC                      = 0;
+		Result.StackIndex              = NWScriptAnalyzer::script_error::invalid_stack_index;
+		Result.Subroutines             = 0;
+		Result.UnreachableInstructions = 0;
+		Result.UnreachableBytes        = 0;
+		Result.UnreachableKnown        = false;
+
+		File = m_ResMan.OpenFileByIndex( (Id - 1) );
+
+		if (File == ResourceManager::INVALID_FILE)
+		{
+			Result.Status  = ScriptStatus_LoadError;
+			Result.Message = "unable to open script";
+			continue;
+		}
+
+		try
+		{
+			Size = m_ResMan.GetEncapsulatedFileSize( File );
+
+			Result.Code.resize( Size );
+
+			if ((Size != 0) &&
+			    ((!m_ResMan.ReadEncapsulatedFile(
+					File,
+					0,
+					Size,
+					&BytesRead,
+					&Result.Code[ 0 ])) ||
+			     (BytesRead != Size)))
+			{
+				Result.Status  = ScriptStatus_LoadError;
+				Result.Message = "unable to read script";
+			}
+		}
+		catch (std::exception &e)
+		{
+			Result.Status  = ScriptStatus_LoadError;
+			Result.Message = e.what( );
+		}
+
+		m_ResMan.CloseFile( File );
+	}
+}
+
+void
+ModuleAnalyzer::AnalyzeScript(
+	__inout ScriptResult & Result
+	)
+/*++
+
+Routine Description:
+
+	This routine analyzes a single compiled script.  The program structure is
+	discovered first so that structural errors can be told apart from errors
+	raising the code to IR, which means the JIT cannot run the script.
+
+Arguments:
+
+	Result - Supplies the script to analyze, and receives the analysis
+	         results.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.  Called concurrently on worker threads; only Result and thread
+	local state is touched.
+
+--*/
+{
+	bool StructureDone;
+
+	if (Result.Status != ScriptStatus_Ok)
+		return;
+
+	if (Result.Code.size( ) < (size_t) NCS_HEADER_SIZE)
+	{
+		Result.Status  = ScriptStatus_LoadError;
+		Result.Message = "too short header";
+		return;
+	}
+
+	//
+	// Measure unreachable code directly from the instruction stream.
+	//
+
+	{
+		CNscOptimizer Optimizer;
+
+		Result.UnreachableKnown = Optimizer.FindUnreachableCode(
+			&Result.Code[ 0 ],
+			Result.Code.size( ),
+			&Result.UnreachableInstructions,
+			&Result.UnreachableBytes);
+	}
+
+	StructureDone = false;
+
+	try
+	{
+		NWScriptReader StructureReader(
+			Result.Name.c_str( ),
+			&Result.Code[ NCS_HEADER_SIZE ],
+			Result.Code.size( ) - NCS_HEADER_SIZE,
+			NULL,
+			0);
+		NWScriptAnalyzer StructureAnalyzer(
+			NULL,
+			m_ActionDefs,
+			m_ActionCount);
+
+		StructureAnalyzer.Analyze(
+			&StructureReader,
+			NWScriptAnalyzer::AF_STRUCTURE_ONLY);
+
+		Result.Subroutines = StructureAnalyzer.GetSubroutines( ).size( );
+
+		StructureDone = true;
+
+		NWScriptReader Reader(
+			Result.Name.c_str( ),
+			&Result.Code[ NCS_HEADER_SIZE ],
+			Result.Code.size( ) - NCS_HEADER_SIZE,
+			NULL,
+			0);
+		NWScriptAnalyzer Analyzer(
+			NULL,
+			m_ActionDefs,
+			m_ActionCount);
+
+		Analyzer.Analyze( &Reader, 0 );
+	}
+	catch (NWScriptAnalyzer::stack_error &e)
+	{
+		SetScriptError( Result, e );
+
+		Result.Status = StructureDone
+			? ScriptStatus_StackError
+			: ScriptStatus_StructureError;
+	}
+	catch (NWScriptAnalyzer::script_error &e)
+	{
+		SetScriptError( Result, e );
+
+		Result.Status = StructureDone
+			? ScriptStatus_IRError
+			: ScriptStatus_StructureError;
+	}
+	catch (std::exception &e)
+	{
+		Result.Message = e.what( );
+
+		Result.Status = StructureDone
+			? ScriptStatus_IRError
+			: ScriptStatus_StructureError;
+	}
+
+	//
+	// The instruction stream is not needed for the report, so release it now.
+	// Every script is loaded before the workers start, so peak memory use is
+	// still the code of the whole module; this only frees it as we go.
+	//
+
+	std::vector< unsigned char >( ).swap( Result.Code );
+}
+
+void
+ModuleAnalyzer::SetScriptError(
+	__inout ScriptResult & Result,
+	__in const NWScriptAnalyzer::script_error & e
+	)
+/*++
+
+Routine Description:
+
+	This routine records the message and location of an analyzer error in a
+	script's results.
+
+Arguments:
+
+	Result - Supplies the script results that receive the error.
+
+	e - Supplies the analyzer error.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Result.Message    = e.what( );
+	Result.PC         = (ULONG) e.pc( );
+	Result.StackIndex = e.stack_index( );
+
+	if (*e.specific( ) != '\0')
+	{
+		Result.Message += ": ";
+		Result.Message += e.specific( );
+	}
+}
+
+DWORD
+WINAPI
+ModuleAnalyzer::WorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the worker thread entry point.  Scripts are handed out by
+	atomically incrementing the next script index.
+
+Arguments:
+
+	Parameter - Supplies the worker context.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, module analyzer worker thread.
+
+--*/
+{
+	WorkerContext  * Worker   = (WorkerContext *) Parameter;
+	ModuleAnalyzer * Analyzer = Worker->Analyzer;
+
+	for (;;)
+	{
+		LONG      Index;
+		ULONGLONG StartTime;
+
+		Index = InterlockedIncrement( &Analyzer->m_NextScript ) - 1;
+
+		if ((size_t) Index >= Analyzer->m_Scripts.size( ))
+			break;
+
+		StartTime = Analyzer->GetMicroseconds( );
+
+		try
+		{
+			Analyzer->AnalyzeScript( Analyzer->m_Scripts[ Index ] );
+		}
+		catch (std::exception &e)
+		{
+			Analyzer->m_Scripts[ Index ].Status  = ScriptStatus_IRError;
+			Analyzer->m_Scripts[ Index ].Message = e.what( );
+		}
+
+		Worker->BusyTime        += Analyzer->GetMicroseconds( ) - StartTime;
+		Worker->ScriptsAnalyzed += 1;
+	}
+
+	return 0;
+}
+
+bool
+ModuleAnalyzer::WriteReport(
+	__in const std::string & ReportFile,
+	__in ULONGLONG LoadTime,
+	__in ULONGLONG AnalyzeTime
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the JSON analysis report.
+
+Arguments:
+
+	ReportFile - Supplies the file name of the report to write.
+
+	LoadTime - Supplies the time taken to load the scripts, in microseconds.
+
+	AnalyzeTime - Supplies the wall clock time taken to analyze the scripts,
+	              in microseconds.
+
+Return Value:
+
+	The routine returns a Boolean value indicating true on success, else false
+	on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Counts[ ScriptStatus_Max ];
+	FILE        * f;
+	bool          First;
+
+	f = fopen( ReportFile.c_str( ), "wt" );
+
+	if (f == NULL)
+	{
+		m_TextOut->WriteText(
+			"Error: Unable to open report file \"%s\".\n",
+			ReportFile.c_str( ));
+
+		return false;
+	}
+
+	ZeroMemory( Counts, sizeof( Counts ) );
+
+	for (ScriptResultVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		Counts[ it->Status ] += 1;
+	}
+
+	fprintf( f, "{\n" );
+	fprintf( f, "  \"scripts\": %lu,\n", (unsigned long) m_Scripts.size( ) );
+
+	for (int Status = 0; Status < ScriptStatus_Max; Status += 1)
+	{
+		fprintf(
+			f,
+			"  \"%s\": %lu,\n",
+			GetStatusName( (SCRIPT_STATUS) Status ),
+			Counts[ Status ]);
+	}
+
+	fprintf( f, "  \"load_time_us\": %I64u,\n", LoadTime );
+	fprintf( f, "  \"analyze_time_us\": %I64u,\n", AnalyzeTime );
+	fprintf( f, "  \"threads\": [\n" );
+
+	for (size_t i = 0; i < m_Workers.size( ); i += 1)
+	{
+		const WorkerContext & Worker = m_Workers[ i ];
+		double                Rate;
+
+		Rate = (Worker.BusyTime != 0)
+			? (double) Worker.ScriptsAnalyzed * 1000000.0 / (double) Worker.BusyTime
+			: 0.0;
+
+		fprintf(
+			f,
+			"    { \"scripts\": %lu, \"busy_time_us\": %I64u, \"scripts_per_second\": %.2f }%s\n",
+			Worker.ScriptsAnalyzed,
+			Worker.BusyTime,
+			Rate,
+			(i + 1 < m_Workers.size( )) ? "," : "");
+	}
+
+	fprintf( f, "  ],\n" );
+	fprintf( f, "  \"results\": [\n" );
+
+	First = true;
+
+	for (ScriptResultVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		if (!First)
+			fprintf( f, ",\n" );
+
+		First = false;
+
+		fprintf(
+			f,
+			"    { \"script\": \"%s\", \"status\": \"%s\", \"subroutines\": %lu",
+			EscapeJson( it->Name ).c_str( ),
+			GetStatusName( it->Status ),
+			(unsigned long) it->Subroutines);
+
+		if (it->UnreachableKnown)
+		{
+			fprintf(
+				f,
+				", \"unreachable_instructions\": %lu, \"unreachable_bytes\": %lu",
+				(unsigned long) it->UnreachableInstructions,
+				(unsigned long) it->UnreachableBytes);
+		}
+
+		if (it->Status != ScriptStatus_Ok)
+		{
+			fprintf(
+				f,
+				", \"pc\": %lu, \"message\": \"%s\"",
+				it->PC,
+				EscapeJson( it->Message ).c_str( ));
+
+			if (it->StackIndex != NWScriptAnalyzer::script_error::invalid_stack_index)
+				fprintf( f, ", \"stack_index\": %d", it->StackIndex );
+		}
+
+		fprintf( f, " }" );
+	}
+
+	fprintf( f, "\n  ]\n}\n" );
+
+	if (ferror( f ))
+	{
+		fclose( f );
+
+		m_TextOut->WriteText(
+			"Error: Failed to write report file \"%s\".\n",
+			ReportFile.c_str( ));
+
+		return false;
+	}
+
+	fclose( f );
+
+	return true;
+}
+
+ULONGLONG
+ModuleAnalyzer::GetMicroseconds(
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a monotonic timestamp in microseconds.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The current time, in microseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	LARGE_INTEGER Counter;
+
+	if ((m_Frequency.QuadPart == 0) || (!QueryPerformanceCounter( &Counter )))
+		return (ULONGLONG) GetTickCount( ) * 1000;
+
+	return (ULONGLONG) ((Counter.QuadPart / m_Frequency.QuadPart) * 1000000 +
+		((Counter.QuadPart % m_Frequency.QuadPart) * 1000000) / m_Frequency.QuadPart);
+}
+
+const char *
+ModuleAnalyzer::GetStatusName(
+	__in SCRIPT_STATUS Status
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the report name of a script status.
+
+Arguments:
+
+	Status - Supplies the status to name.
+
+Return Value:
+
+	The status name.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Status)
+	{
+
+	case ScriptStatus_Ok:
+		return "ok";
+
+	case ScriptStatus_LoadError:
+		return "load_error";
+
+	case ScriptStatus_StructureError:
+		return "structure_error";
+
+	case ScriptStatus_StackError:
+		return "stack_error";
+
+	case ScriptStatus_IRError:
+		return "ir_error";
+
+	default:
+		return "unknown";
+
+	}
+}
+
+std::string
+ModuleAnalyzer::EscapeJson(
+	__in const std::string & Str
+	)
+/*++
+
+Routine Description:
+
+	This routine escapes a string for inclusion in a JSON string literal.
+
+Arguments:
+
+	Str - Supplies the string to escape.
+
+Return Value:
+
+	The escaped string.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::string Escaped;
+
+	Escaped.reserve( Str.size( ) );
+
+	for (std::string::const_iterator it = Str.begin( ); it != Str.end( ); ++it)
+	{
+		unsigned char c = (unsigned char) *it;
+
+		if ((c == '"') || (c == '\\'))
+		{
+			Escaped.push_back( '\\' );
+			Escaped.push_back( (char) c );
+		}
+		else if (c < 0x20)
+		{
+			char Hex[ 8 ];
+
+			StringCbPrintfA( Hex, sizeof( Hex ), "\\u%04x", c );
+			Escaped += Hex;
+		}
+		else
+		{
+			Escaped.push_back( (char) c );
+		}
+	}
+
+	return Escaped;
+}
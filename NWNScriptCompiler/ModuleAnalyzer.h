@@ -0,0 +1,187 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    ModuleAnalyzer.h
+
+Abstract:
+
+    This module defines the module analyzer, which verifies every compiled
+    script (*.ncs) available through the resource manager with the
+    NWScriptAnalyzer.  Scripts are analyzed in parallel, one independent
+    analyzer instance per script, and the results are aggregated into a
+    machine-readable (JSON) report.
+
+--*/
+
+#ifndef _PROGRAMS_NWNSCRIPTCOMPILER_MODULEANALYZER_H
+#define _PROGRAMS_NWNSCRIPTCOMPILER_MODULEANALYZER_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class ModuleAnalyzer
+{
+
+public:
+
+	ModuleAnalyzer(
+		__in ResourceManager & ResMan,
+		__in IDebugTextOut * TextOut,
+		__in bool Nwn1Actions,
+		__in bool Quiet
+		);
+
+	~ModuleAnalyzer(
+		);
+
+	//
+	// Analyze all compiled scripts and write the report.  The routine
+	// returns the number of scripts that failed analysis, or -1 if the
+	// report could not be written.
+	//
+
+	int
+	AnalyzeModule(
+		__in const std::string & ReportFile
+		);
+
+private:
+
+	//
+	// Define the outcome of analyzing a single script.
+	//
+
+	typedef enum _SCRIPT_STATUS
+	{
+		ScriptStatus_Ok,
+		ScriptStatus_LoadError,
+		ScriptStatus_StructureError,
+		ScriptStatus_StackError,
+		ScriptStatus_IRError,
+
+		ScriptStatus_Max
+	} SCRIPT_STATUS, * PSCRIPT_STATUS;
+
+	//
+	// Define the size of the NCS header ("NCS V1.0" followed by T <size>).
+	//
+
+	enum { NCS_HEADER_SIZE = 8 + 1 + 4 };
+
+	struct ScriptResult
+	{
+		std::string                  Name;
+		std::vector< unsigned char > Code;
+		SCRIPT_STATUS                Status;
+		std::string                  Message;
+		ULONG                        PC;
+		int                          StackIndex;
+		size_t                       Subroutines;
+		size_t                       UnreachableInstructions;
+		size_t                       UnreachableBytes;
+		bool                         UnreachableKnown;
+	};
+
+	typedef std::vector< ScriptResult > ScriptResultVec;
+
+	//
+	// Define per-worker thread state and throughput counters.
+	//
+
+	struct WorkerContext
+	{
+		ModuleAnalyzer * Analyzer;
+		HANDLE           Thread;
+		unsigned long    ScriptsAnalyzed;
+		ULONGLONG        BusyTime;
+	};
+
+	typedef std::vector< WorkerContext > WorkerContextVec;
+
+	//
+	// Load every compiled script from the resource system.
+	//
+
+	void
+	LoadScripts(
+		);
+
+	//
+	// Analyze a single script.
+	//
+
+	void
+	AnalyzeScript(
+		__inout ScriptResult & Result
+		);
+
+	//
+	// Record an analyzer error in a script's results.
+	//
+
+	static
+	void
+	SetScriptError(
+		__inout ScriptResult & Result,
+		__in const NWScriptAnalyzer::script_error & e
+		);
+
+	//
+	// Worker thread entry point.
+	//
+
+	static
+	DWORD
+	WINAPI
+	WorkerThread(
+		__in LPVOID Parameter
+		);
+
+	//
+	// Write the report.
+	//
+
+	bool
+	WriteReport(
+		__in const std::string & ReportFile,
+		__in ULONGLONG LoadTime,
+		__in ULONGLONG AnalyzeTime
+		);
+
+	//
+	// Return the current time in microseconds.
+	//
+
+	ULONGLONG
+	GetMicroseconds(
+		);
+
+	static
+	const char *
+	GetStatusName(
+		__in SCRIPT_STATUS Status
+		);
+
+	static
+	std::string
+	EscapeJson(
+		__in const std::string & Str
+		);
+
+	ResourceManager            & m_ResMan;
+	IDebugTextOut              * m_TextOut;
+	PCNWACTION_DEFINITION        m_ActionDefs;
+	NWSCRIPT_ACTION              m_ActionCount;
+	bool                         m_Quiet;
+	ScriptResultVec              m_Scripts;
+	WorkerContextVec             m_Workers;
+	volatile LONG                m_NextScript;
+	LARGE_INTEGER                m_Frequency;
+
+};
+
+#endif
@@ -0,0 +1,536 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    ModuleDisassembler.cpp
+
+Abstract:
+
+    This module houses the module disassembler, which disassembles every
+    compiled script available through the resource system in parallel and
+    writes one .pcode listing per script.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWNScriptCompilerLib/Nsc.h"
+#include "ModuleDisassembler.h"
+
+ModuleDisassembler::ModuleDisassembler(
+	__in ResourceManager & ResMan,
+	__in NscCompiler & Compiler,
+	__in IDebugTextOut * TextOut,
+	__in bool Quiet
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new module disassembler.
+
+Arguments:
+
+	ResMan - Supplies the resource manager whose compiled scripts are to be
+	         disassembled.
+
+	Compiler - Supplies the compiler context used to name action service
+	           handlers in the listings.
+
+	TextOut - Supplies the text out interface used for status output.
+
+	Quiet - Supplies a Boolean value that indicates true if non-critical
+	        messages should be silenced.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ResMan( ResMan ),
+  m_Compiler( Compiler ),
+  m_TextOut( TextOut ),
+  m_Quiet( Quiet ),
+  m_NextScript( 0 )
+{
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+ModuleDisassembler::~ModuleDisassembler(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the module disassembler.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+int
+ModuleDisassembler::DisassembleModule(
+	__in const std::string & OutDir
+	)
+/*++
+
+Routine Description:
+
+	This routine loads every compiled script and disassembles them in
+	parallel on one worker thread per processor.
+
+	The resource manager is not thread safe, so all script loading happens on
+	the calling thread before the workers start.  The compiler is initialized
+	(nwscript.nss parsed) on the calling thread as well, after which the
+	workers only read its action table.
+
+Arguments:
+
+	OutDir - Supplies the directory that receives the listings.  The name
+	         includes a trailing path separator.
+
+Return Value:
+
+	The routine returns the count of scripts that could not be disassembled,
+	or -1 if the compiler could not be initialized.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	SYSTEM_INFO SystemInfo;
+	ULONGLONG   StartTime;
+	ULONGLONG   LoadTime;
+	ULONGLONG   DisassembleTime;
+	ULONGLONG   CodeBytes;
+	ULONGLONG   TextBytes;
+	ULONGLONG   Instructions;
+	size_t      WorkerCount;
+	int         Failures;
+
+	m_OutDir = OutDir;
+
+	//
+	// Force the compiler to parse nwscript.nss now, so that the workers never
+	// race to initialize it.
+	//
+
+	{
+		NscDisassembledInstructionVec InstructionBuffer;
+		std::string                   TextBuffer;
+
+		m_Compiler.NscDisassembleScript(
+			NULL,
+			0,
+			InstructionBuffer,
+			TextBuffer);
+
+		if (!TextBuffer.empty( ))
+		{
+			m_TextOut->WriteText(
+				"Error: Unable to initialize the compiler for disassembly: %s\n",
+				TextBuffer.c_str( ));
+
+			return -1;
+		}
+	}
+
+	StartTime = GetMicroseconds( );
+
+	LoadScripts( );
+
+	LoadTime = GetMicroseconds( ) - StartTime;
+
+	GetSystemInfo( &SystemInfo );
+
+	WorkerCount = SystemInfo.dwNumberOfProcessors;
+
+	if (WorkerCount > m_Scripts.size( ))
+		WorkerCount = m_Scripts.size( );
+	if (WorkerCount == 0)
+		WorkerCount = 1;
+
+	if (!m_Quiet)
+	{
+		m_TextOut->WriteText(
+			"Disassembling %lu compiled script(s) on %lu thread(s)...\n",
+			(unsigned long) m_Scripts.size( ),
+			(unsigned long) WorkerCount);
+	}
+
+	//
+	// Start the workers.  If a thread cannot be created, then the scripts are
+	// simply picked up by the threads that did start (or by the calling
+	// thread, below).
+	//
+
+	StartTime = GetMicroseconds( );
+
+	m_NextScript = 0;
+	m_Workers.resize( WorkerCount );
+
+	for (size_t i = 0; i < WorkerCount; i += 1)
+	{
+		WorkerContext & Worker = m_Workers[ i ];
+
+		Worker.Disassembler        = this;
+		Worker.ScriptsDisassembled = 0;
+		Worker.Instructions        = 0;
+		Worker.BytesWritten        = 0;
+		Worker.BusyTime            = 0;
+		Worker.Thread              = CreateThread(
+			NULL,
+			0,
+			WorkerThread,
+			&Worker,
+			0,
+			NULL);
+	}
+
+	for (size_t i = 0; i < WorkerCount; i += 1)
+	{
+		WorkerContext & Worker = m_Workers[ i ];
+
+		if (Worker.Thread == NULL)
+		{
+			WorkerThread( &Worker );
+			continue;
+		}
+
+		WaitForSingleObject( Worker.Thread, INFINITE );
+		CloseHandle( Worker.Thread );
+		Worker.Thread = NULL;
+	}
+
+	DisassembleTime = GetMicroseconds( ) - StartTime;
+
+	//
+	// Summarize the results.
+	//
+
+	Failures     = 0;
+	CodeBytes    = 0;
+	TextBytes    = 0;
+	Instructions = 0;
+
+	for (ScriptEntryVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		CodeBytes += it->CodeSize;
+
+		if (!it->Loaded)
+		{
+			Failures += 1;
+
+			m_TextOut->WriteText(
+				"Error: Unable to load script \"%s.ncs\".\n",
+				it->Name.c_str( ));
+		}
+		else if (!it->Written)
+		{
+			Failures += 1;
+
+			m_TextOut->WriteText(
+				"Error: Unable to write disassembly file \"%s%s.pcode\".\n",
+				m_OutDir.c_str( ),
+				it->Name.c_str( ));
+		}
+	}
+
+	for (WorkerContextVec::const_iterator it = m_Workers.begin( );
+	     it != m_Workers.end( );
+	     ++it)
+	{
+		TextBytes    += it->BytesWritten;
+		Instructions += it->Instructions;
+	}
+
+	if (!m_Quiet)
+	{
+		double Seconds = (double) DisassembleTime / 1000000.0;
+
+		if (Seconds <= 0.0)
+			Seconds = 0.000001;
+
+		m_TextOut->WriteText(
+			"Disassembled %lu script(s), %d failure(s), load %I64ums, disassembly %I64ums.\n",
+			(unsigned long) m_Scripts.size( ),
+			Failures,
+			LoadTime / 1000,
+			DisassembleTime / 1000);
+		m_TextOut->WriteText(
+			"Throughput: %.1f scripts/s, %.2f MB/s NCS in, %.2f MB/s text out, %.0f instructions/s (%lu thread(s)).\n",
+			(double) m_Scripts.size( ) / Seconds,
+			(double) CodeBytes / (1024.0 * 1024.0) / Seconds,
+			(double) TextBytes / (1024.0 * 1024.0) / Seconds,
+			(double) Instructions / Seconds,
+			(unsigned long) WorkerCount);
+	}
+
+	return Failures;
+}
+
+void
+ModuleDisassembler::LoadScripts(
+	)
+/*++
+
+Routine Description:
+
+	This routine reads every *.ncs resource into memory.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_Scripts.clear( );
+
+	for (ResourceManager::FileId Id = m_ResMan.GetEncapsulatedFileCount( );
+	     Id != 0;
+	     Id -= 1)
+	{
+		NWN::ResRef32              ResRef;
+		NWN::ResType               ResType;
+		ResourceManager::FileHandle File;
+		size_t                     Size;
+		size_t                     BytesRead;
+
+		if (!m_ResMan.GetEncapsulatedFileEntry( (Id - 1), ResRef, ResType ))
+			continue;
+
+		if (ResType != NWN::ResNCS)
+			continue;
+
+		m_Scripts.push_back( ScriptEntry( ) );
+
+		ScriptEntry & Script = m_Scripts.back( );
+
+		Script.Name     = m_ResMan.StrFromResRef( ResRef );
+		Script.CodeSize = 0;
+		Script.Loaded   = false;
+		Script.Written  = false;
+
+		File = m_ResMan.OpenFileByIndex( (Id - 1) );
+
+		if (File == ResourceManager::INVALID_FILE)
+			continue;
+
+		try
+		{
+			Size = m_ResMan.GetEncapsulatedFileSize( File );
+
+			Script.Code.resize( Size );
+
+			if ((Size == 0) ||
+			    ((m_ResMan.ReadEncapsulatedFile(
+					File,
+					0,
+					Size,
+					&BytesRead,
+					&Script.Code[ 0 ])) &&
+			     (BytesRead == Size)))
+			{
+				Script.CodeSize = Size;
+				Script.Loaded   = true;
+			}
+		}
+		catch (std::exception &)
+		{
+		}
+
+		m_ResMan.CloseFile( File );
+	}
+}
+
+void
+ModuleDisassembler::DisassembleScript(
+	__inout ScriptEntry & Script,
+	__inout WorkerContext & Worker
+	)
+/*++
+
+Routine Description:
+
+	This routine disassembles a single compiled script and writes the listing
+	to <OutDir><Name>.pcode.  The script code is released afterwards.
+
+Arguments:
+
+	Script - Supplies the script to disassemble, and receives the result.
+
+	Worker - Supplies the worker whose buffers and counters are used.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.  Called concurrently on worker threads; only Script, Worker
+	and the (read only) compiler action table are touched.
+
+--*/
+{
+	std::string FileName;
+	FILE      * f;
+
+	if (!Script.Loaded)
+		return;
+
+	m_Compiler.NscDisassembleScript(
+		(!Script.Code.empty( )) ? &Script.Code[ 0 ] : NULL,
+		Script.Code.size( ),
+		Worker.InstructionBuffer,
+		Worker.TextBuffer);
+
+	std::vector< unsigned char >( ).swap( Script.Code );
+
+	Worker.Instructions += Worker.InstructionBuffer.size( );
+
+	FileName  = m_OutDir;
+	FileName += Script.Name;
+	FileName += ".pcode";
+
+	//
+	// The listing already carries CRLF line endings, so write it in binary
+	// mode.
+	//
+
+	f = fopen( FileName.c_str( ), "wb" );
+
+	if (f == NULL)
+		return;
+
+	if ((Worker.TextBuffer.empty( )) ||
+	    (fwrite( &Worker.TextBuffer[ 0 ], Worker.TextBuffer.size( ), 1, f ) == 1))
+	{
+		Script.Written       = true;
+		Worker.BytesWritten += Worker.TextBuffer.size( );
+	}
+
+	fclose( f );
+}
+
+DWORD
+WINAPI
+ModuleDisassembler::WorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the worker thread entry point.  Scripts are handed out by
+	atomically incrementing the next script index.
+
+Arguments:
+
+	Parameter - Supplies the worker context.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, module disassembler worker thread.
+
+--*/
+{
+	WorkerContext      * Worker       = (WorkerContext *) Parameter;
+	ModuleDisassembler * Disassembler = Worker->Disassembler;
+
+	for (;;)
+	{
+		LONG      Index;
+		ULONGLONG StartTime;
+
+		Index = InterlockedIncrement( &Disassembler->m_NextScript ) - 1;
+
+		if ((size_t) Index >= Disassembler->m_Scripts.size( ))
+			break;
+
+		StartTime = Disassembler->GetMicroseconds( );
+
+		try
+		{
+			Disassembler->DisassembleScript(
+				Disassembler->m_Scripts[ Index ],
+				*Worker);
+		}
+		catch (std::exception &)
+		{
+			Disassembler->m_Scripts[ Index ].Written = false;
+		}
+
+		Worker->BusyTime            += Disassembler->GetMicroseconds( ) - StartTime;
+		Worker->ScriptsDisassembled += 1;
+	}
+
+	return 0;
+}
+
+ULONGLONG
+ModuleDisassembler::GetMicroseconds(
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a monotonic timestamp in microseconds.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The current time, in microseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	LARGE_INTEGER Counter;
+
+	if ((m_Frequency.QuadPart == 0) || (!QueryPerformanceCounter( &Counter )))
+		return (ULONGLONG) GetTickCount( ) * 1000;
+
+	return (ULONGLONG) ((Counter.QuadPart / m_Frequency.QuadPart) * 1000000 +
+		((Counter.QuadPart % m_Frequency.QuadPart) * 1000000) / m_Frequency.QuadPart);
+}
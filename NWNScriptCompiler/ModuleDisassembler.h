@@ -0,0 +1,132 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    ModuleDisassembler.h
+
+Abstract:
+
+    This module defines the module disassembler, which disassembles every
+    compiled script (*.ncs) available through the resource manager to a
+    .pcode listing in an output directory.  Scripts are disassembled in
+    parallel and throughput statistics are reported.
+
+--*/
+
+#ifndef _PROGRAMS_NWNSCRIPTCOMPILER_MODULEDISASSEMBLER_H
+#define _PROGRAMS_NWNSCRIPTCOMPILER_MODULEDISASSEMBLER_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class ModuleDisassembler
+{
+
+public:
+
+	ModuleDisassembler(
+		__in ResourceManager & ResMan,
+		__in NscCompiler & Compiler,
+		__in IDebugTextOut * TextOut,
+		__in bool Quiet
+		);
+
+	~ModuleDisassembler(
+		);
+
+	//
+	// Disassemble all compiled scripts into the output directory.  The
+	// routine returns the number of scripts that could not be disassembled,
+	// or -1 if the compiler could not be initialized.
+	//
+
+	int
+	DisassembleModule(
+		__in const std::string & OutDir
+		);
+
+private:
+
+	struct ScriptEntry
+	{
+		std::string                  Name;
+		std::vector< unsigned char > Code;
+		size_t                       CodeSize;
+		bool                         Loaded;
+		bool                         Written;
+	};
+
+	typedef std::vector< ScriptEntry > ScriptEntryVec;
+
+	//
+	// Define per-worker thread state and throughput counters.  The decode and
+	// text buffers are reused for every script that the worker picks up.
+	//
+
+	struct WorkerContext
+	{
+		ModuleDisassembler            * Disassembler;
+		HANDLE                          Thread;
+		unsigned long                   ScriptsDisassembled;
+		ULONGLONG                       Instructions;
+		ULONGLONG                       BytesWritten;
+		ULONGLONG                       BusyTime;
+		NscDisassembledInstructionVec   InstructionBuffer;
+		std::string                     TextBuffer;
+	};
+
+	typedef std::vector< WorkerContext > WorkerContextVec;
+
+	//
+	// Load every compiled script from the resource system.
+	//
+
+	void
+	LoadScripts(
+		);
+
+	//
+	// Disassemble a single script and write its listing.
+	//
+
+	void
+	DisassembleScript(
+		__inout ScriptEntry & Script,
+		__inout WorkerContext & Worker
+		);
+
+	//
+	// Worker thread entry point.
+	//
+
+	static
+	DWORD
+	WINAPI
+	WorkerThread(
+		__in LPVOID Parameter
+		);
+
+	//
+	// Return the current time in microseconds.
+	//
+
+	ULONGLONG
+	GetMicroseconds(
+		);
+
+	ResourceManager            & m_ResMan;
+	NscCompiler                & m_Compiler;
+	IDebugTextOut              * m_TextOut;
+	bool                         m_Quiet;
+	std::string                  m_OutDir;
+	ScriptEntryVec               m_Scripts;
+	WorkerContextVec             m_Workers;
+	volatile LONG                m_NextScript;
+	LARGE_INTEGER                m_Frequency;
+
+};
+
+#endif
@@ -269,10 +269,57 @@ typedef struct _NSC_COMPILER_CONTEXT
 {
 	PCNSC_COMPILER_DISPATCH_TABLE   DispatchTable;
 	NscCompiler                   * Compiler;
+	bool                            EnableExtensions;
 } NSC_COMPILER_CONTEXT, * PNSC_COMPILER_CONTEXT;
 
 typedef const struct _NSC_COMPILER_CONTEXT * PCNSC_COMPILER_CONTEXT;
 
+//
+// Define the per-script state of a batch compile.
+//
+
+typedef struct _NSC_BATCH_SCRIPT_STATE
+{
+	NWN::ResRef32                   ResRef;
+	std::vector< unsigned char >    Contents;
+	std::string                     OutBaseFile;
+	std::string                     Diagnostics;
+	bool                            Loaded;
+	bool                            Succeeded;
+} NSC_BATCH_SCRIPT_STATE, * PNSC_BATCH_SCRIPT_STATE;
+
+//
+// Define the state shared by the worker threads of a batch compile.  Workers
+// claim scripts via NextScript and queue finished scripts to the calling
+// thread through CompletionOrder, signaling CompletionSemaphore once per
+// script.
+//
+
+typedef struct _NSC_BATCH_CONTEXT
+{
+	std::vector< NSC_BATCH_SCRIPT_STATE > Scripts;
+	volatile LONG                   NextScript;
+	int                             CompilerVersion;
+	bool                            Optimize;
+	bool                            IgnoreIncludes;
+	bool                            GenerateDebugInfo;
+	CRITICAL_SECTION                CompletionLock;
+	std::vector< size_t >           CompletionOrder;
+	size_t                          CompletionsPosted;
+	HANDLE                          CompletionSemaphore;
+} NSC_BATCH_CONTEXT, * PNSC_BATCH_CONTEXT;
+
+//
+// Define a batch compile worker thread, each with its own compiler instance.
+//
+
+typedef struct _NSC_BATCH_WORKER
+{
+	PNSC_BATCH_CONTEXT              Batch;
+	NscCompiler                   * Compiler;
+	HANDLE                          Thread;
+} NSC_BATCH_WORKER, * PNSC_BATCH_WORKER;
+
 //
 // Define the external thunk resource accessor.
 //
@@ -950,6 +997,234 @@ Environment:
 	return true;
 }
 
+void
+IndexExternalResources(
+	)
+/*++
+
+Routine Description:
+
+	This routine reindexes the resource system against the external resource
+	accessor, i.e. the I/O dispatch table of the current request.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ResourceManager::ModuleLoadParams    LoadParams;
+	IResourceAccessor< NWN::ResRef32 > * Accessor;
+
+	Accessor = &g_ResAccessor;
+
+	ZeroMemory( &LoadParams, sizeof( LoadParams ) );
+
+	LoadParams.ResManFlags                   = ResourceManager::ResManFlagNoBuiltinProviders;
+	LoadParams.CustomFirstChanceAccessors    = &Accessor;
+	LoadParams.NumCustomFirstChanceAccessors = 1;
+
+	g_ResMan->LoadModuleResources(
+		"",
+		"",
+		"",
+		"",
+		std::vector< NWN::ResRef32 >( ),
+		&LoadParams);
+}
+
+bool
+PrepareBatchScript(
+	__in PCNSC_COMPILER_DISPATCH_TABLE DispatchTable,
+	__in const NSC_BATCH_SCRIPT & Script,
+	__in const char * OutputDirectory,
+	__out NSC_BATCH_SCRIPT_STATE & State
+	)
+/*++
+
+Routine Description:
+
+	This routine loads the source text of a batch script and computes its
+	output file name.  It is called on the calling thread before the worker
+	threads start, so the resource system may be used freely.
+
+Arguments:
+
+	DispatchTable - Supplies the I/O dispatch table for the compiler.
+
+	Script - Supplies the script to prepare.
+
+	OutputDirectory - Supplies the directory where the compiled script should
+	                  be placed (on success).
+
+	State - Receives the loaded script.  Diagnostics receives any errors.
+
+Return Value:
+
+	The routine returns a Boolean value indicating true on success, else false
+	on failure.
+
+	On catastrophic failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	StringTextOut                CaptureOutput;
+	NWN::ResType                 InFileResType;
+	char                         FileName[ _MAX_FNAME ];
+
+	if ((Script.ScriptFileName == NULL) ||
+	    (_splitpath_s(
+		Script.ScriptFileName,
+		NULL,
+		0,
+		NULL,
+		0,
+		FileName,
+		_MAX_FNAME,
+		NULL,
+		0)))
+	{
+		State.Diagnostics = "Error: Invalid script source file path.\n";
+		return false;
+	}
+
+	State.OutBaseFile  = OutputDirectory;
+	State.OutBaseFile += "/";
+	State.OutBaseFile += FileName;
+
+	if (Script.ScriptText != NULL)
+	{
+		const unsigned char * Text = (const unsigned char *) Script.ScriptText;
+
+		State.ResRef = g_ResMan->ResRef32FromStr( FileName );
+		State.Contents.assign( Text, Text + Script.ScriptTextLength );
+
+		return true;
+	}
+
+	if (!LoadInputFile(
+		*g_ResMan,
+		&CaptureOutput,
+		DispatchTable,
+		std::string( Script.ScriptFileName ) + ".nss",
+		State.ResRef,
+		InFileResType,
+		State.Contents))
+	{
+		State.Diagnostics  = CaptureOutput.GetTextOutput( );
+		State.Diagnostics += "Error: Unable to access input file for compilation.\n";
+		return false;
+	}
+
+	return true;
+}
+
+DWORD
+WINAPI
+BatchWorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point of a batch compile worker thread.  It
+	compiles scripts until none remain, queuing each finished script for
+	completion on the calling thread.
+
+Arguments:
+
+	Parameter - Supplies the NSC_BATCH_WORKER of the thread.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, batch compile worker thread.
+
+--*/
+{
+	PNSC_BATCH_WORKER  Worker;
+	PNSC_BATCH_CONTEXT Batch;
+	size_t             Index;
+
+	Worker = (PNSC_BATCH_WORKER) Parameter;
+	Batch  = Worker->Batch;
+
+	for (;;)
+	{
+		Index = (size_t) (InterlockedIncrement( &Batch->NextScript ) - 1);
+
+		if (Index >= Batch->Scripts.size( ))
+			break;
+
+		NSC_BATCH_SCRIPT_STATE & Script = Batch->Scripts[ Index ];
+
+		if (Script.Loaded)
+		{
+			try
+			{
+				StringTextOut CaptureOutput;
+
+				Script.Succeeded = CompileSourceFile(
+					*Worker->Compiler,
+					Batch->CompilerVersion,
+					Batch->Optimize,
+					Batch->IgnoreIncludes,
+					!Batch->GenerateDebugInfo,
+					true,
+					&CaptureOutput,
+					Script.ResRef,
+					Script.Contents,
+					Script.OutBaseFile);
+
+				Script.Diagnostics = CaptureOutput.GetTextOutput( );
+			}
+			catch (std::exception &e)
+			{
+				Script.Succeeded = false;
+
+				try
+				{
+					Script.Diagnostics  = "Internal compiler error; compilation aborted (see below).\n";
+					Script.Diagnostics += e.what( );
+				}
+				catch (std::exception)
+				{
+				}
+			}
+
+			//
+			// The source text is no longer needed.
+			//
+
+			std::vector< unsigned char >( ).swap( Script.Contents );
+		}
+
+		EnterCriticalSection( &Batch->CompletionLock );
+		Batch->CompletionOrder[ Batch->CompletionsPosted++ ] = Index;
+		LeaveCriticalSection( &Batch->CompletionLock );
+
+		ReleaseSemaphore( Batch->CompletionSemaphore, 1, NULL );
+	}
+
+	return 0;
+}
+
 NSC_COMPILER_HANDLE
 __stdcall
 NscCreateCompiler(
@@ -1005,6 +1280,7 @@ Environment:
 
 		Compiler->DispatchTable = NULL;
 		Compiler->Compiler = NULL;
+		Compiler->EnableExtensions = EnableExtensions;
 
 		Compiler->Compiler = new NscCompiler(
 			*g_ResMan,
@@ -1192,26 +1468,7 @@ Environment:
 		g_ResAccessor.SetIoDispatchTable( DispatchTable );
 
 		if (FlushResources)
-		{
-			ResourceManager::ModuleLoadParams    LoadParams;
-			IResourceAccessor< NWN::ResRef32 > * Accessor;
-
-			Accessor = &g_ResAccessor;
-	
-			ZeroMemory( &LoadParams, sizeof( LoadParams ) );
-
-			LoadParams.ResManFlags                   = ResourceManager::ResManFlagNoBuiltinProviders;
-			LoadParams.CustomFirstChanceAccessors    = &Accessor;
-			LoadParams.NumCustomFirstChanceAccessors = 1;
-
-			g_ResMan->LoadModuleResources(
-				"",
-				"",
-				"",
-				"",
-				std::vector< NWN::ResRef32 >( ),
-				&LoadParams);
-		}
+			IndexExternalResources( );
 
 		if (!LoadInputFile(
 			*g_ResMan,
@@ -1274,6 +1531,297 @@ Environment:
 	return Status;
 }
 
+bool
+__stdcall
+NscCompileScriptBatchExternal(
+	__in NSC_COMPILER_HANDLE Compiler,
+	__in_ecount( ScriptCount ) PCNSC_BATCH_SCRIPT Scripts,
+	__in size_t ScriptCount,
+	__in const char * OutputDirectory,
+	__in bool FlushResources,
+	__in bool GenerateDebugInfo,
+	__in bool Optimize,
+	__in bool IgnoreIncludes,
+	__in int CompilerVersion,
+	__in ULONG MaxThreads,
+	__in PCNSC_COMPILER_DISPATCH_TABLE DispatchTable,
+	__in NscBatchScriptCompletionProc CompletionRoutine,
+	__in void * CompletionContext
+	)
+/*++
+
+Routine Description:
+
+	This routine compiles a batch of source files in parallel according to the
+	specified set of compilation options.
+
+	The source text of every script is loaded up front on the calling thread.
+	Each worker thread then compiles scripts with its own compiler instance.
+	Include files are loaded once into a resource cache shared by all of the
+	workers, whose lock also serializes all resource system (and thus I/O
+	dispatch table) access.  Completion routines are called on the calling
+	thread, also under the shared cache lock.
+
+Arguments:
+
+	Compiler - Supplies the compiler context created by NscCreateCompiler.
+
+	Scripts - Supplies the scripts to compile.
+
+	ScriptCount - Supplies the count of scripts to compile.
+
+	OutputDirectory - Supplies the directory where the compiled scripts should
+	                  be placed (on success).
+
+	FlushResources - Supplies a Boolean value indicating true if the resource
+	                 system must be reindexed.  The caller must supply true for
+	                 (at least) the first invocation for a given compiler.
+
+	GenerateDebugInfo - Supplies a Boolean value indicating true if debug
+	                    symbols should be saved.
+
+	Optimize - Supplies a Boolean value indicating true if the scripts should
+	           be optimized.
+
+	IgnoreIncludes - Supplies a Boolean value indicating true if include-only
+	                 source files should be ignored.
+
+	CompilerVersion - Supplies the BioWare-compatible compiler version number.
+
+	MaxThreads - Supplies the maximum number of worker threads, or zero to use
+	             one worker thread per processor.
+
+	DispatchTable - Supplies the I/O dispatch table for the compiler.
+
+	CompletionRoutine - Supplies the routine that is called once per script
+	                    with the compilation results.
+
+	CompletionContext - Supplies the context argument of the completion
+	                    routine.
+
+Return Value:
+
+	The routine returns a Boolean value indicating true if every script
+	compiled, else false if any script (or the batch itself) failed.
+
+Environment:
+
+	User mode, external entry point.
+
+--*/
+{
+	NscSharedResourceCache          ResourceCache;
+	NSC_BATCH_CONTEXT               Batch;
+	std::vector< NSC_BATCH_WORKER > Workers;
+	SYSTEM_INFO                     SystemInfo;
+	size_t                          ThreadCount;
+	size_t                          ThreadsStarted;
+	bool                            Status;
+
+	if ((Compiler == NULL) || (CompletionRoutine == NULL))
+		return false;
+
+	switch (DispatchTable->Size)
+	{
+
+	case sizeof( NSC_COMPILER_DISPATCH_TABLE_V1 ):
+		break;
+
+	case sizeof( *DispatchTable ):
+		break;
+
+	default:
+		return false;
+
+	}
+
+	Batch.NextScript          = 0;
+	Batch.CompilerVersion     = CompilerVersion;
+	Batch.Optimize            = Optimize;
+	Batch.IgnoreIncludes      = IgnoreIncludes;
+	Batch.GenerateDebugInfo   = GenerateDebugInfo;
+	Batch.CompletionsPosted   = 0;
+	Batch.CompletionSemaphore = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+
+	if (Batch.CompletionSemaphore == NULL)
+		return false;
+
+	InitializeCriticalSection( &Batch.CompletionLock );
+
+	Status = true;
+
+	try
+	{
+		//
+		// Setup the resource system to point to the requestors I/O dispatch
+		// table and load all of the source text while we are still single
+		// threaded.
+		//
+
+		g_ResAccessor.SetIoDispatchTable( DispatchTable );
+
+		if (FlushResources)
+			IndexExternalResources( );
+
+		Batch.Scripts.resize( ScriptCount );
+		Batch.CompletionOrder.resize( ScriptCount );
+
+		for (size_t i = 0; i < ScriptCount; i += 1)
+		{
+			NSC_BATCH_SCRIPT_STATE & State = Batch.Scripts[ i ];
+
+			State.Succeeded = false;
+			State.Loaded    = PrepareBatchScript(
+				DispatchTable,
+				Scripts[ i ],
+				OutputDirectory,
+				State);
+		}
+
+		//
+		// Create a compiler per worker thread, all attached to the shared
+		// include cache.
+		//
+
+		GetSystemInfo( &SystemInfo );
+
+		ThreadCount = (MaxThreads != 0) ? MaxThreads : SystemInfo.dwNumberOfProcessors;
+
+		if (ThreadCount > ScriptCount)
+			ThreadCount = ScriptCount;
+		if (ThreadCount > MAXIMUM_WAIT_OBJECTS)
+			ThreadCount = MAXIMUM_WAIT_OBJECTS;
+		if (ThreadCount == 0)
+			ThreadCount = 1;
+
+		Workers.resize( ThreadCount );
+
+		for (size_t i = 0; i < ThreadCount; i += 1)
+		{
+			Workers[ i ].Batch    = &Batch;
+			Workers[ i ].Compiler = NULL;
+			Workers[ i ].Thread   = NULL;
+		}
+
+		for (size_t i = 0; i < ThreadCount; i += 1)
+		{
+			Workers[ i ].Compiler = new NscCompiler(
+				*g_ResMan,
+				Compiler->EnableExtensions);
+
+			Workers[ i ].Compiler->NscSetSharedResourceCache( &ResourceCache );
+
+			if (DispatchTable->Size >= sizeof( NSC_COMPILER_DISPATCH_TABLE_V2 ))
+			{
+				if ((DispatchTable->ResLoadFile != NULL) &&
+				    (DispatchTable->ResUnloadFile != NULL))
+				{
+					Workers[ i ].Compiler->NscSetExternalResourceLoader(
+						DispatchTable->Context,
+						DispatchTable->ResLoadFile,
+						DispatchTable->ResUnloadFile);
+				}
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		DispatchTable->NscCompilerDiagnosticOutput(
+			"Internal compiler error; compilation aborted (see below).\n",
+			DispatchTable->Context);
+		DispatchTable->NscCompilerDiagnosticOutput(
+			e.what( ),
+			DispatchTable->Context);
+
+		Status = false;
+	}
+
+	if ((Status) && (ScriptCount != 0))
+	{
+		//
+		// Start the workers.  If no thread could be created, then compile on
+		// the calling thread instead.
+		//
+
+		ThreadsStarted = 0;
+
+		for (size_t i = 0; i < Workers.size( ); i += 1)
+		{
+			Workers[ i ].Thread = CreateThread(
+				NULL,
+				0,
+				BatchWorkerThread,
+				&Workers[ i ],
+				0,
+				NULL);
+
+			if (Workers[ i ].Thread != NULL)
+				ThreadsStarted += 1;
+		}
+
+		if (ThreadsStarted == 0)
+			BatchWorkerThread( &Workers[ 0 ] );
+
+		//
+		// Deliver the results in completion order.
+		//
+
+		for (size_t Completed = 0; Completed < ScriptCount; Completed += 1)
+		{
+			size_t Index;
+
+			WaitForSingleObject( Batch.CompletionSemaphore, INFINITE );
+
+			EnterCriticalSection( &Batch.CompletionLock );
+			Index = Batch.CompletionOrder[ Completed ];
+			LeaveCriticalSection( &Batch.CompletionLock );
+
+			const NSC_BATCH_SCRIPT_STATE & State = Batch.Scripts[ Index ];
+
+			if (!State.Succeeded)
+				Status = false;
+
+			ResourceCache.Acquire( );
+
+			CompletionRoutine(
+				Index,
+				Scripts[ Index ].ScriptFileName,
+				State.Succeeded,
+				State.Diagnostics.c_str( ),
+				CompletionContext);
+
+			ResourceCache.Release( );
+		}
+
+		for (size_t i = 0; i < Workers.size( ); i += 1)
+		{
+			if (Workers[ i ].Thread == NULL)
+				continue;
+
+			WaitForSingleObject( Workers[ i ].Thread, INFINITE );
+			CloseHandle( Workers[ i ].Thread );
+			Workers[ i ].Thread = NULL;
+		}
+	}
+
+	for (size_t i = 0; i < Workers.size( ); i += 1)
+		delete Workers[ i ].Compiler;
+
+	//
+	// Ensure that all resource references are closed as the dispatch table is
+	// going away.
+	//
+
+	g_ResMan->CloseOpenResourceFileHandles( );
+
+	g_ResAccessor.SetIoDispatchTable( NULL );
+
+	DeleteCriticalSection( &Batch.CompletionLock );
+	CloseHandle( Batch.CompletionSemaphore );
+
+	return Status;
+}
+
 const char *
 __stdcall
 NscGetEntrypointSymbolName(
@@ -11,7 +11,10 @@ Abstract:
 	This module defines the externally visible interface to the DLL version of
 	the NWScript compiler.
 
-	N.B.  The library is assumed to be single threaded.
+	N.B.  The library is assumed to be single threaded, i.e. calls into the
+	      library must not overlap.  NscCompileScriptBatchExternal compiles on
+	      internal worker threads, but serializes all calls it makes to the
+	      I/O dispatch table and completion routine.
 
 --*/
 
@@ -216,6 +219,37 @@ struct _NSC_COMPILER_CONTEXT;
 
 typedef struct _NSC_COMPILER_CONTEXT * NSC_COMPILER_HANDLE;
 
+//
+// Define a script to compile in a batch.  If ScriptText is NULL, the source
+// text is loaded from ScriptFileName (plus ".nss") as per
+// NscCompileScriptExternal, else ScriptText supplies the source text and
+// ScriptFileName only names the script and its output files.
+//
+
+typedef struct _NSC_BATCH_SCRIPT
+{
+	const char                         * ScriptFileName;
+	const void                         * ScriptText;
+	size_t                               ScriptTextLength;
+} NSC_BATCH_SCRIPT, * PNSC_BATCH_SCRIPT;
+
+typedef const struct _NSC_BATCH_SCRIPT * PCNSC_BATCH_SCRIPT;
+
+//
+// Define the per-script completion routine for a batch compile.  Diagnostics
+// holds the compiler output for the script (possibly empty).
+//
+
+typedef
+void
+(__stdcall * NscBatchScriptCompletionProc)(
+	__in size_t ScriptIndex,
+	__in const char * ScriptFileName,
+	__in bool Succeeded,
+	__in const char * Diagnostics,
+	__in void * Context
+	);
+
 //
 // Create a new compiler object; returns NULL on failure.
 //
@@ -282,6 +316,50 @@ bool
 	__in PCNSC_COMPILER_DISPATCH_TABLE DispatchTable
 	);
 
+//
+// Compile a batch of scripts in parallel.  Returns true if every script
+// compiled.  Include files are loaded once and shared by all worker threads.
+// The completion routine is called once per script, in completion order, on
+// the calling thread.  A MaxThreads value of zero uses one worker thread per
+// processor.  The compiler handle's own symbol state is not updated.
+//
+
+bool
+__stdcall
+NscCompileScriptBatchExternal(
+	__in NSC_COMPILER_HANDLE Compiler,
+	__in_ecount( ScriptCount ) PCNSC_BATCH_SCRIPT Scripts,
+	__in size_t ScriptCount,
+	__in const char * OutputDirectory,
+	__in bool FlushResources,
+	__in bool GenerateDebugInfo,
+	__in bool Optimize,
+	__in bool IgnoreIncludes,
+	__in int CompilerVersion,
+	__in ULONG MaxThreads,
+	__in PCNSC_COMPILER_DISPATCH_TABLE DispatchTable,
+	__in NscBatchScriptCompletionProc CompletionRoutine,
+	__in void * CompletionContext
+	);
+
+typedef
+bool
+(__stdcall * NscCompileScriptBatchExternalProc)(
+	__in NSC_COMPILER_HANDLE Compiler,
+	__in_ecount( ScriptCount ) PCNSC_BATCH_SCRIPT Scripts,
+	__in size_t ScriptCount,
+	__in const char * OutputDirectory,
+	__in bool FlushResources,
+	__in bool GenerateDebugInfo,
+	__in bool Optimize,
+	__in bool IgnoreIncludes,
+	__in int CompilerVersion,
+	__in ULONG MaxThreads,
+	__in PCNSC_COMPILER_DISPATCH_TABLE DispatchTable,
+	__in NscBatchScriptCompletionProc CompletionRoutine,
+	__in void * CompletionContext
+	);
+
 //
 // Return the entrypoint symbol of a script.  The compiler must have compiled
 // already.  The return value is only valid until the next compile and is NULL
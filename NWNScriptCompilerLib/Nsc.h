@@ -60,6 +60,7 @@
 class CNscContext;
 struct NscCompilerState;
 class NscCompiler;
+class NscSharedResourceCache;
 
 //-----------------------------------------------------------------------------
 //
@@ -71,7 +72,7 @@ enum NscConstants
 {
 	NscInitialScript	= 0x80000,
 	NscMaxScript		= 0x4000000,
-	NscMaxHash			= 64,
+	NscMaxHash			= 64,		// initial symbol table index size (power of 2)
 	NscMaxLabelSize		= 16,		// internal setting only, don't sweat it
 };
 
@@ -142,6 +143,9 @@ enum NscCompilerFlags
 	NscCompilerFlag_DumpPCode 			= 0x00000001,
 	NscCompilerFlag_ShowIncludes		= 0x00000002,
 	NscCompilerFlag_ShowPreprocessed	= 0x00000004,
+	NscCompilerFlag_OptimizeNcs			= 0x00000008,
+	NscCompilerFlag_ShowOptimizerStats	= 0x00000010,
+	NscCompilerFlag_FuseTailCalls		= 0x00000020,
 };
 
 //-----------------------------------------------------------------------------
@@ -337,9 +341,7 @@ struct NscSymbolFence // Note this is a value struct (memcpy'd) !
 {
 	//Used by symbol table
 	size_t			nSize;
-#ifdef _DEBUG
-	int				anHashDepth [NscMaxHash];
-#endif
+	size_t			nUndo;
 	//Used by the context manager
 	size_t			nFnSymbol;
 	NscFenceType	nFenceType;
@@ -362,7 +364,6 @@ struct NscSymbolFence // Note this is a value struct (memcpy'd) !
 			CaseValueVec *pSwitchCasesUsed;
 		};
 	};
-	size_t			anHashStart [NscMaxHash];
 };
 
 #ifdef _WIN32
@@ -885,6 +886,51 @@ void NscScriptDecompile (CNwnStream &sStream,
 	unsigned char *pauchData, unsigned long ulSize, NscCompiler *pCompiler);
 const char *NscGetActionName (int nAction, NscCompiler *pCompiler);
 
+//-----------------------------------------------------------------------------
+//
+// Disassembler routines.  Disassembly is split into a decode pass, which
+// produces one compact record per instruction, and a format pass, which
+// renders the records as text.
+//
+//-----------------------------------------------------------------------------
+
+enum NscDisassemblyForm
+{
+	NscDisasmForm_Invalid		= 0,	// ??
+	NscDisasmForm_Type			= 1,	// RSADDI, ADDII, NEGF
+	NscDisasmForm_TypeSize		= 2,	// EQUALTT size
+	NscDisasmForm_Stack			= 3,	// CPDOWNSP offset, size
+	NscDisasmForm_ConstInt		= 4,	// CONSTI value, CONSTO value
+	NscDisasmForm_ConstFloat	= 5,	// CONSTF value
+	NscDisasmForm_ConstString	= 6,	// CONSTS "value"
+	NscDisasmForm_Action		= 7,	// ACTION name(id), args
+	NscDisasmForm_Imm32			= 8,	// MOVSP value, DECISP value
+	NscDisasmForm_Branch		= 9,	// JMP off_target, JSR fn_target
+	NscDisasmForm_NoOperand		= 10,	// RETN, SAVEBP
+	NscDisasmForm_SaveStateAll	= 11,	// SAVE_STATEALL value
+	NscDisasmForm_Destruct		= 12,	// DESTRUCT size, offset, size
+	NscDisasmForm_StoreState	= 13,	// STORE_STATE type, bp, sp
+	NscDisasmForm_Size			= 14	// T size
+};
+
+struct NscDisassembledInstruction
+{
+	UINT32				ulOffset;		// Offset from the start of the script
+	UINT32				ulLength;		// Encoded length in bytes
+	unsigned char		cOp;			// Opcode
+	unsigned char		cType;			// Type or auxiliary byte
+	unsigned char		nForm;			// NscDisassemblyForm
+	UINT32				aulOperands [3];// Decoded operands (by form)
+};
+
+typedef std::vector <NscDisassembledInstruction> NscDisassembledInstructionVec;
+
+void NscScriptDisassemble (const unsigned char *pauchData, size_t nSize,
+	NscDisassembledInstructionVec &asInstructions);
+void NscFormatDisassembly (const unsigned char *pauchData, 
+	const NscDisassembledInstructionVec &asInstructions, 
+	NscCompiler *pCompiler, std::string &strOut);
+
 
 typedef std::vector< NscType > NscTypeVec;
 
@@ -900,8 +946,11 @@ struct NscPrototypeDefinition
 };
 
 //
-// Define the script compiler wrapper.  Note that only one concurrent usage is
-// permitted.
+// Define the script compiler wrapper.  A compiler instance may only be used
+// by one thread at a time, but separate instances may compile concurrently on
+// different threads.  Concurrent instances that share a resource system must
+// load resources through a common NscSharedResourceCache, and must compile
+// from in-memory source text, as the resource system is not thread safe.
 //
 
 class NscCompiler : public CNwnLoader
@@ -1001,6 +1050,23 @@ public:
 		__out std::string & Disassembly
 		);
 
+	// @cmember Disassemble script into caller supplied, reusable buffers.
+
+	//
+	// Disassemble a script as above, but decode into and format into caller
+	// supplied buffers so that their storage is reused across scripts.  Once
+	// nwscript.nss has been parsed (i.e. after the first disassembly or
+	// compile returns), concurrent calls on one compiler are permitted.
+	//
+
+	void
+	NscDisassembleScript (
+		__in_bcount( CodeLength ) const void * Code,
+		__in size_t CodeLength,
+		__inout NscDisassembledInstructionVec & Instructions,
+		__out std::string & Disassembly
+		);
+
 	// @cmember Lookup name of an action service handler by ordinal.
 
 	//
@@ -1119,6 +1185,21 @@ public:
 		__in bool EnableCache
 		);
 
+	// @cmember Attach a resource cache shared with other compilers.
+
+	//
+	// Attach the compiler to a resource cache that is shared with other
+	// compiler instances, or detach it if SharedCache is NULL.  While
+	// attached, resource loads are serialized through the shared cache and
+	// the compiler's own resource cache is bypassed.  The shared cache must
+	// outlive the attachment.
+	//
+
+	void
+	NscSetSharedResourceCache (
+		__in_opt NscSharedResourceCache * SharedCache
+		);
+
 
 	//
 	// Note, remaining routines are for internal use only.
@@ -1174,6 +1255,8 @@ public:
 
 private:
 
+	friend class NscSharedResourceCache;
+
 	//
 	// The resource cache is used to avoid reloading commonly referenced
 	// include files for multiple compilation sessions.
@@ -1283,6 +1366,23 @@ private:
 	NscFlushResourceCache (
 		);
 
+	// @cmember Load a resource bypassing the shared resource cache.
+
+	//
+	// Load a resource file from the search paths, the resource system or the
+	// external resource loader.  The shared resource cache lock, if any, is
+	// held by the caller.
+	//
+
+	unsigned char *
+	LoadResourceUncached (
+		__in const char * pszName,
+		__in const NWN::ResRef32 & ResRef,
+		__in NwnResType nResType,
+		__out UINT32 * pulSize,
+		__out bool * pfAllocated
+		);
+
 	ResourceManager             & m_ResourceManager;
 	bool                          m_EnableExtensions;
 	bool                          m_ShowIncludes;
@@ -1297,8 +1397,57 @@ private:
 	ResUnloadFileProc             m_ResUnloadFile;
 	bool                          m_CacheResources;
 	ResourceCache                 m_ResourceCache;
+	NscSharedResourceCache      * m_SharedResourceCache;
 	IDebugTextOut               * m_ErrorOutput;
 
 };
 
+//
+// Define a resource cache that is shared by compiler instances running on
+// different threads, e.g. for parallel batch compiles.  Each include file is
+// loaded once for all attached compilers, and the lock serializes access to
+// the (non thread safe) resource system.
+//
+
+class NscSharedResourceCache
+{
+
+public:
+
+	NscSharedResourceCache (
+		);
+
+	~NscSharedResourceCache (
+		);
+
+	//
+	// Release all cached resources.  No attached compiler may be compiling.
+	//
+
+	void
+	Flush (
+		);
+
+	//
+	// Acquire or release the cache lock.  While the lock is held, no attached
+	// compiler can enter the resource system.
+	//
+
+	void
+	Acquire (
+		);
+
+	void
+	Release (
+		);
+
+private:
+
+	friend class NscCompiler;
+
+	CRITICAL_SECTION              m_Lock;
+	NscCompiler::ResourceCache    m_ResourceCache;
+
+};
+
 #endif // ETS_NSC_H
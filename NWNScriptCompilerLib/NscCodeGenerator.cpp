@@ -91,6 +91,8 @@ CNscCodeGenerator::CNscCodeGenerator (CNscContext *pCtx,
 	m_fOptFor = fEnableOptimizations;
 	m_fOptDeclaration = fEnableOptimizations;
 	m_fOptConditional = fEnableOptimizations;
+	m_fOptNcs = pCtx ->GetOptNcs ();
+	m_fUsesReadPC = false;
 
 	//
 	// If we need to turn declaration optimizations off, i.e. to support
@@ -146,6 +148,7 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 	//
 
 	m_fMakeDebugFile = pDebugOutput != NULL;
+	m_fUsesReadPC = false;
 
 	//
 	// Search for either a main or StartingConditional
@@ -590,6 +593,42 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 	if (m_pCtx ->GetErrors () > 0)
 		return false;
 	
+	//
+	// Run the NCS optimizer if requested.  ReadPC bakes code offsets into
+	// the script, so scripts using it are left as generated.
+	//
+
+	if (m_fOptNcs && !m_fUsesReadPC)
+	{
+		size_t nNewSize;
+		m_sOptimizer .SetFuseTailCalls (m_pCtx ->GetFuseTailCalls ());
+		if (m_sOptimizer .Optimize (m_pauchCode, 
+			m_pauchOut - m_pauchCode, &nNewSize))
+		{
+			m_pauchOut = m_pauchCode + nNewSize;
+			if (m_pCtx ->GetShowOptimizerStats ())
+			{
+				const CNscOptimizer::Statistics &sStats = 
+					m_sOptimizer .GetStatistics ();
+				m_pCtx ->GenerateInternalDiagnostic (
+					"NCS optimizer: %u -> %u static instructions, %u -> %u bytes "
+					"(%u jumps threaded, %u dead instructions, %u dead "
+					"subroutines, %u stack ops coalesced, %u constants "
+					"folded, %u tail calls fused)",
+					(unsigned) sStats .nInstructionsBefore,
+					(unsigned) sStats .nInstructionsAfter,
+					(unsigned) sStats .nBytesBefore,
+					(unsigned) sStats .nBytesAfter,
+					(unsigned) sStats .nJumpsThreaded,
+					(unsigned) sStats .nDeadInstructions,
+					(unsigned) sStats .nDeadSubroutines,
+					(unsigned) sStats .nStackOpsCoalesced,
+					(unsigned) sStats .nConstantsFolded,
+					(unsigned) sStats .nTailCallsFused);
+			}
+		}
+	}
+
 	//
 	// Write the output
 	//
@@ -716,7 +755,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 
 				GetDebugTypeText (pSymbol ->nType, szType);
 				sprintf (m_pachCode, "f %08x %08x %03d %s %s",
-					pSymbol ->nCompiledStart, pSymbol ->nCompiledEnd,
+					MapDebugOffset (pSymbol ->nCompiledStart),
+					MapDebugOffset (pSymbol ->nCompiledEnd),
 					pExtra ->nArgCount, szType, pSymbol ->szString);
 				pDebugOutput ->WriteLine (m_pachCode);
 
@@ -761,7 +801,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 
 		GetDebugTypeText (fIsMain ? NscType_Void : NscType_Integer, szType);
 		sprintf (m_pachCode, "f %08x %08x %03d %s %s",
-			nLoaderStart, nLoaderEnd, 0, szType, "#loader");
+			MapDebugOffset (nLoaderStart), MapDebugOffset (nLoaderEnd),
+			0, szType, "#loader");
 		pDebugOutput ->WriteLine (m_pachCode);
 		if (fCreateGlobal)
 		{
@@ -769,7 +810,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 			//	nGlobalsStart, nGlobalsEnd, 0, szType, "#globals");
 			// It seems Bioware's compiler always marks globals as void
 			sprintf (m_pachCode, "f %08x %08x %03d %s %s",
-				nGlobalsStart, nGlobalsEnd, 0, "v", "#globals");
+				MapDebugOffset (nGlobalsStart), MapDebugOffset (nGlobalsEnd),
+				0, "v", "#globals");
 			pDebugOutput ->WriteLine (m_pachCode);
 		}
 
@@ -780,7 +822,7 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 		if (!fIsMain)
 		{
 			sprintf (m_pachCode, "v %08x %08x %08x %s %s",
-				nRetValPos, 0xffffffff, 0, "i", "#retval");
+				MapDebugOffset (nRetValPos), 0xffffffff, 0, "i", "#retval");
 			pDebugOutput ->WriteLine (m_pachCode);
 		}
 
@@ -795,7 +837,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 			{
 				GetDebugTypeText (pSymbol ->nType, szType);
 				sprintf (m_pachCode, "v %08x %08x %08x %s %s",
-					pSymbol ->nCompiledStart, pSymbol ->nCompiledEnd, 
+					MapDebugOffset (pSymbol ->nCompiledStart),
+					MapDebugOffset (pSymbol ->nCompiledEnd), 
 					pSymbol ->nStackOffset * 4, szType, pSymbol ->szString);
 				pDebugOutput ->WriteLine (m_pachCode);
 			}
@@ -810,7 +853,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 			NscSymbol *pSymbol = m_sLocalSymbols .GetSymbol (m_anLocalVars [i]);
 			GetDebugTypeText (pSymbol ->nType, szType);
 			sprintf (m_pachCode, "v %08x %08x %08x %s %s",
-				pSymbol ->nCompiledStart, pSymbol ->nCompiledEnd, 
+				MapDebugOffset (pSymbol ->nCompiledStart),
+				MapDebugOffset (pSymbol ->nCompiledEnd), 
 				pSymbol ->nStackOffset * 4, szType, pSymbol ->szString);
 			pDebugOutput ->WriteLine (m_pachCode);
 		}
@@ -823,7 +867,8 @@ bool CNscCodeGenerator::GenerateOutput (CNwnStream *pCodeOutput,
 		{
 			sprintf (m_pachCode, "l%02d %07d %08x %08x",
 				m_asLines [i] .nFile, m_asLines [i] .nLine,
-				m_asLines [i] .nCompiledStart, m_asLines [i] .nCompiledEnd);
+				MapDebugOffset (m_asLines [i] .nCompiledStart),
+				MapDebugOffset (m_asLines [i] .nCompiledEnd));
 			pDebugOutput ->WriteLine (m_pachCode);
 		}
 	}
@@ -2270,6 +2315,7 @@ bool CNscCodeGenerator::CodeIntrinsicReadPC (int nArgs, int nArgSize)
 	//
 
 	i = (INT32) (m_pauchOut - (m_pauchCode + 8 + 5));
+	m_fUsesReadPC = true;
 
 	CodeCONST (NscType_Integer, &i);
 	CodeCP (NscCode_CPDOWNSP, 2, 1);
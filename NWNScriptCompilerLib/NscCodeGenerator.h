@@ -48,6 +48,7 @@
 //-----------------------------------------------------------------------------
 
 #include "NscContext.h"
+#include "NscOptimizer.h"
 
 //-----------------------------------------------------------------------------
 //
@@ -253,6 +254,13 @@ protected:
 
 	static void GetDebugTypeText (NscType nType, char *pszText);
 
+	// @cmember Map a code offset for the debug file
+
+	size_t MapDebugOffset (size_t nOffset) const
+	{
+		return m_sOptimizer .MapOffset (nOffset);
+	}
+
 	// @cmember Purge local variables to the given depth
 
 	void PurgeVariables (int nDepth);
@@ -536,6 +544,18 @@ protected:
 	// @cmember If true, optimize conditionals
 
 	bool					m_fOptConditional;
+
+	// @cmember If true, run the NCS optimizer over the finished code
+
+	bool					m_fOptNcs;
+
+	// @cmember If true, the script uses ReadPC and cannot be relocated
+
+	bool					m_fUsesReadPC;
+
+	// @cmember NCS optimizer
+
+	CNscOptimizer			m_sOptimizer;
 };
 
 #endif // ETS_NSCCODEGENERATOR_H
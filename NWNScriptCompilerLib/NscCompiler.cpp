@@ -50,7 +50,232 @@
 // Globals
 //
 
-CNscContext *g_pCtx;
+//
+// Context of the compile running on each thread.  The parser routines reach
+// the context through here, so independent compiler instances may be used on
+// different threads at the same time.
+//
+
+struct NscCurrentContextSlot
+{
+	DWORD                               m_dwIndex;
+	CNscContext                       * m_pFallback;
+
+	NscCurrentContextSlot ()
+	: m_dwIndex (TlsAlloc ()),
+	  m_pFallback (NULL)
+	{
+	}
+
+	~NscCurrentContextSlot ()
+	{
+		if (m_dwIndex != TLS_OUT_OF_INDEXES)
+			TlsFree (m_dwIndex);
+	}
+};
+
+static NscCurrentContextSlot g_sNscCurrentContext;
+
+//
+// Parsed nwscript.nss tables shared by all compiler instances in the process
+//
+
+struct NscSharedNWScriptCache
+{
+	CRITICAL_SECTION                    m_sLock;
+	std::vector <NscSharedNWScript *>   m_apEntries;
+
+	NscSharedNWScriptCache ()
+	{
+		InitializeCriticalSection (&m_sLock);
+	}
+
+	~NscSharedNWScriptCache ()
+	{
+		for (size_t i = 0; i < m_apEntries .size (); i++)
+			delete m_apEntries [i];
+		DeleteCriticalSection (&m_sLock);
+	}
+};
+
+static NscSharedNWScriptCache g_sNscSharedNWScript;
+
+//-----------------------------------------------------------------------------
+//
+// @func Locate a previously parsed nwscript.nss (cache lock held)
+//
+// @parm const unsigned char * | pauchSource | nwscript.nss contents
+//
+// @parm size_t | nSize | Length of the contents
+//
+// @parm bool | fEnableExtensions | If true, non-bioware extensions are enabled
+//
+// @parm bool | fConstKeyword | If true, "const" is a reserved word
+//
+// @rdesc Referenced shared tables or NULL if none matched.
+//
+//-----------------------------------------------------------------------------
+
+static NscSharedNWScript *NscFindSharedNWScriptLocked (
+	const unsigned char *pauchSource, size_t nSize, 
+	bool fEnableExtensions, bool fConstKeyword)
+{
+	for (size_t i = 0; i < g_sNscSharedNWScript .m_apEntries .size (); i++)
+	{
+		NscSharedNWScript *pEntry = g_sNscSharedNWScript .m_apEntries [i];
+		if (pEntry ->m_fEnableExtensions == fEnableExtensions &&
+			pEntry ->m_fConstKeyword == fConstKeyword &&
+			pEntry ->m_vecSource .size () == nSize &&
+			(nSize == 0 || memcmp (&pEntry ->m_vecSource [0], 
+			pauchSource, nSize) == 0))
+		{
+			pEntry ->m_ulReferences++;
+			return pEntry;
+		}
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Locate a previously parsed nwscript.nss
+//
+// @parm const unsigned char * | pauchSource | nwscript.nss contents
+//
+// @parm UINT32 | ulSize | Length of the contents
+//
+// @parm bool | fEnableExtensions | If true, non-bioware extensions are enabled
+//
+// @parm bool | fConstKeyword | If true, "const" is a reserved word
+//
+// @rdesc Referenced shared tables or NULL if none matched.
+//
+//-----------------------------------------------------------------------------
+
+static NscSharedNWScript *NscFindSharedNWScript (
+	const unsigned char *pauchSource, UINT32 ulSize, 
+	bool fEnableExtensions, bool fConstKeyword)
+{
+	EnterCriticalSection (&g_sNscSharedNWScript .m_sLock);
+
+	NscSharedNWScript *pShared = NscFindSharedNWScriptLocked (
+		pauchSource, ulSize, fEnableExtensions, fConstKeyword);
+
+	LeaveCriticalSection (&g_sNscSharedNWScript .m_sLock);
+	return pShared;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Publish newly parsed nwscript.nss tables
+//
+// @parm NscSharedNWScript * | pShared | Tables to publish.  If an identical
+//		entry was published in the meantime, the tables are deleted.
+//
+// @rdesc Referenced shared tables.
+//
+//-----------------------------------------------------------------------------
+
+static NscSharedNWScript *NscPublishSharedNWScript (NscSharedNWScript *pShared)
+{
+	EnterCriticalSection (&g_sNscSharedNWScript .m_sLock);
+
+	NscSharedNWScript *pExisting = NscFindSharedNWScriptLocked (
+		pShared ->m_vecSource .empty () ? NULL : &pShared ->m_vecSource [0],
+		pShared ->m_vecSource .size (),
+		pShared ->m_fEnableExtensions, pShared ->m_fConstKeyword);
+	if (pExisting == NULL)
+	{
+		pShared ->m_ulReferences = 1;
+		g_sNscSharedNWScript .m_apEntries .push_back (pShared);
+	}
+
+	LeaveCriticalSection (&g_sNscSharedNWScript .m_sLock);
+
+	if (pExisting != NULL)
+	{
+		delete pShared;
+		return pExisting;
+	}
+	return pShared;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Attach shared nwscript.nss tables to a compiler
+//
+// @parm NscCompilerState * | pState | Compiler state
+//
+// @parm NscSharedNWScript * | pShared | Referenced shared tables.  The
+//		reference is transferred to the compiler state.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+static void NscAttachSharedNWScript (NscCompilerState *pState, 
+	NscSharedNWScript *pShared)
+{
+	pState ->m_sNscReservedWords .CopyFrom (&pShared ->m_sReservedWords);
+	pState ->m_nNscActionCount = pShared ->m_nActionCount;
+	pState ->m_anNscActions .RemoveAll ();
+	pState ->m_anNscActions .Append (pShared ->m_anActions .GetData (),
+		pShared ->m_anActions .GetCount ());
+	for (size_t i = 0; i < _countof (pState ->m_astrNscEngineTypes); i++)
+		pState ->m_astrNscEngineTypes [i] = pShared ->m_astrEngineTypes [i];
+	pState ->m_fEnableExtensions = pShared ->m_fEnableExtensions;
+	pState ->m_sNscNWScript .SetBase (&pShared ->m_sNWScript);
+	pState ->m_sNscLast .Reset ();
+	pState ->m_pSharedNWScript = pShared;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Release the shared nwscript.nss tables of a compiler
+//
+// @parm NscCompilerState * | pState | Compiler state
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+static void NscReleaseSharedNWScript (NscCompilerState *pState)
+{
+	NscSharedNWScript *pShared = pState ->m_pSharedNWScript;
+	if (pShared == NULL)
+		return;
+
+	//
+	// Drop every table chained onto the shared tables first
+	//
+
+	pState ->m_sNscNWScript .Reset ();
+	pState ->m_sNscLast .Reset ();
+	pState ->m_pSharedNWScript = NULL;
+
+	EnterCriticalSection (&g_sNscSharedNWScript .m_sLock);
+
+	if (--pShared ->m_ulReferences == 0)
+	{
+		std::vector <NscSharedNWScript *> &apEntries = 
+			g_sNscSharedNWScript .m_apEntries;
+		for (size_t i = 0; i < apEntries .size (); i++)
+		{
+			if (apEntries [i] == pShared)
+			{
+				apEntries .erase (apEntries .begin () + i);
+				break;
+			}
+		}
+	}
+	else
+		pShared = NULL;
+
+	LeaveCriticalSection (&g_sNscSharedNWScript .m_sLock);
+
+	if (pShared != NULL)
+		delete pShared;
+}
 
 //-----------------------------------------------------------------------------
 //
@@ -99,14 +324,75 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 {
 	fEnableExtensions; //4100
 
+	NscCompilerState *pState = pCompiler ->NscGetCompilerState ();
+	bool fConstKeyword = fEnableExtensions || nVersion >= 169;
+
+	//
+	// Read NWSCRIPT
+	//
+
+	bool fAllocated;
+	UINT32 ulSize;
+	unsigned char *pauchData = pLoader ->LoadResource (
+		"nwscript", NwnResType_NSS, &ulSize, &fAllocated);
+	if (pauchData == NULL)
+	{
+		if (pTextOut)
+			pTextOut ->WriteText ("Unable to load nwscript.nss\n");
+		return false;
+	}
+
+	//
+	// If an identical nwscript.nss has already been parsed in this process
+	// (by any compiler instance), then share its tables
+	//
+
+	NscSharedNWScript *pShared = NscFindSharedNWScript (pauchData, ulSize,
+		fEnableExtensions, fConstKeyword);
+
+	NscReleaseSharedNWScript (pState);
+
+	if (pShared != NULL)
+	{
+		if (fAllocated)
+			free (pauchData);
+
+		NscAttachSharedNWScript (pState, pShared);
+		return true;
+	}
+
+	//
+	// Keep a copy of the source to identify the shared tables by
+	//
+
+	try
+	{
+		pShared = new NscSharedNWScript ();
+		pShared ->m_vecSource .assign (pauchData, pauchData + ulSize);
+	}
+	catch (std::exception)
+	{
+		delete pShared;
+
+		if (fAllocated)
+			free (pauchData);
+
+		if (pTextOut)
+			pTextOut ->WriteText ("Unable to allocate memory (nwscript.nss)\n");
+		return false;
+	}
+
+	pShared ->m_fEnableExtensions = fEnableExtensions;
+	pShared ->m_fConstKeyword = fConstKeyword;
+
 	//
 	// Reset 
 	//
 
-	pCompiler ->NscGetCompilerState () ->m_nNscActionCount = 0;
-	pCompiler ->NscGetCompilerState () ->m_anNscActions .RemoveAll ();
-	pCompiler ->NscGetCompilerState () ->m_sNscReservedWords .Reset ();
-	pCompiler ->NscGetCompilerState () ->m_sNscNWScript .Reset ();
+	pState ->m_nNscActionCount = 0;
+	pState ->m_anNscActions .RemoveAll ();
+	pState ->m_sNscReservedWords .Reset ();
+	pState ->m_sNscNWScript .Reset ();
 
 	//
 	// Add the reserved words
@@ -132,7 +418,7 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 	NscAddToken ("return",         RETURN, pCompiler);
 	NscAddToken ("switch",         SWITCH, pCompiler);
 	NscAddToken ("while",          WHILE, pCompiler);
-	if (fEnableExtensions || nVersion >= 169)
+	if (fConstKeyword)
         NscAddToken ("const",      NWCONST, pCompiler);
 
 	NscAddToken ("OBJECT_SELF",    OBJECT_SELF_CONST, pCompiler);
@@ -140,21 +426,6 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 
 	pCompiler ->NscGetCompilerState () ->m_fEnableExtensions = fEnableExtensions;
 
-	//
-	// Read NWSCRIPT
-	//
-
-	bool fAllocated;
-	UINT32 ulSize;
-	unsigned char *pauchData = pLoader ->LoadResource (
-		"nwscript", NwnResType_NSS, &ulSize, &fAllocated);
-	if (pauchData == NULL)
-	{
-		if (pTextOut)
-			pTextOut ->WriteText ("Unable to load nwscript.nss\n");
-		return false;
-	}
-
 	//
 	// Compile
 	//
@@ -172,6 +443,8 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 		}
 		catch (std::exception)
 		{
+			delete pShared;
+
 			if (fAllocated)
 				free (pauchData);
 
@@ -190,6 +463,8 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 	}
 	catch (std::exception)
 	{
+		delete pShared;
+
 		if (fAllocated)
 			free (pauchData);
 
@@ -211,20 +486,32 @@ bool NscCompilerInitialize (CNwnLoader *pLoader, int nVersion,
 
 	sCtx .SetupPreprocessor ();
 
-	g_pCtx = &sCtx;
+	NscSetCurrentContext (&sCtx);
 
 	if (sCtx .parse () != 0 || sCtx .GetErrors () > 0)
 	{
+		delete pShared;
+
 		if (pTextOut)
 			pTextOut ->WriteText ("Error compiling nwscript.nss\n");
 		return false;
 	}
 
 	//
-	// Copy the symbol table
+	// Move the tables into the (immutable from here on) shared object.  Each
+	// compile chains its own symbols onto the shared symbol table.
 	//
 
-	sCtx .SaveSymbolTable (&pCompiler ->NscGetCompilerState () ->m_sNscNWScript);
+	sCtx .SaveSymbolTable (&pShared ->m_sNWScript);
+	pShared ->m_sReservedWords .CopyFrom (&pState ->m_sNscReservedWords);
+	pShared ->m_nActionCount = pState ->m_nNscActionCount;
+	pShared ->m_anActions .Append (pState ->m_anNscActions .GetData (),
+		pState ->m_anNscActions .GetCount ());
+	for (size_t i = 0; i < _countof (pShared ->m_astrEngineTypes); i++)
+		pShared ->m_astrEngineTypes [i] = pState ->m_astrNscEngineTypes [i];
+
+	pShared = NscPublishSharedNWScript (pShared);
+	NscAttachSharedNWScript (pState, pShared);
 	return true;
 }
 
@@ -332,7 +619,16 @@ NscResult NscCompileScript (CNwnLoader *pLoader, const char *pszName,
 	if ((ulCompilerFlags & NscCompilerFlag_DumpPCode) != 0)
 		sCtx .SetDumpPCode (true);
 
-	g_pCtx = &sCtx;
+	if ((ulCompilerFlags & NscCompilerFlag_OptimizeNcs) != 0)
+		sCtx .SetOptNcs (true);
+
+	if ((ulCompilerFlags & NscCompilerFlag_ShowOptimizerStats) != 0)
+		sCtx .SetShowOptimizerStats (true);
+
+	if ((ulCompilerFlags & NscCompilerFlag_FuseTailCalls) != 0)
+		sCtx .SetFuseTailCalls (true);
+
+	NscSetCurrentContext (&sCtx);
 
 	//
 	// PHASE 1
@@ -507,6 +803,43 @@ const char *NscGetActionName (int nAction, NscCompiler *pCompiler)
 	}
 }
 
+//-----------------------------------------------------------------------------
+//
+// @func Get the context of the compile running on the current thread
+//
+// @rdesc Pointer to the context or NULL if no compile is active.
+//
+//-----------------------------------------------------------------------------
+
+CNscContext *NscGetCurrentContext ()
+{
+	if (g_sNscCurrentContext .m_dwIndex == TLS_OUT_OF_INDEXES)
+		return g_sNscCurrentContext .m_pFallback;
+
+	return (CNscContext *) TlsGetValue (g_sNscCurrentContext .m_dwIndex);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Set the context of the compile running on the current thread
+//
+// @parm CNscContext * | pCtx | New context
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void NscSetCurrentContext (CNscContext *pCtx)
+{
+	if (g_sNscCurrentContext .m_dwIndex == TLS_OUT_OF_INDEXES)
+	{
+		g_sNscCurrentContext .m_pFallback = pCtx;
+		return;
+	}
+
+	TlsSetValue (g_sNscCurrentContext .m_dwIndex, pCtx);
+}
+
 //----------------------------------------------------------------------------
 //
 // Functions to hand off parser callbacks to the context class
@@ -516,7 +849,7 @@ const char *NscGetActionName (int nAction, NscCompiler *pCompiler)
 #if _NSCCONTEXT_USE_BISONPP
 void yyerror (char *s)
 {
-	g_pCtx->yyerror(s);
+	NscGetCurrentContext ()->yyerror(s);
 }
 #else
 void yy::parser::error (const yy::parser::location_type& l,
@@ -530,7 +863,7 @@ int yylex (YYSTYPE* yylval, CNscContext& context) {
 }
 
 int yylex (YYSTYPE* yylval) {
-    return g_pCtx->yylex(yylval);
+    return NscGetCurrentContext ()->yylex(yylval);
 }
 
 //----------------------------------------------------------------------------
@@ -569,6 +902,7 @@ NscCompiler::NscCompiler (
   m_ResLoadFile (NULL),
   m_ResUnloadFile (NULL),
   m_CacheResources (false),
+  m_SharedResourceCache (NULL),
   m_ErrorOutput (NULL)
 {
 	m_CompilerState ->m_fSaveSymbolTable = SaveSymbolTable;
@@ -584,6 +918,7 @@ NscCompiler::NscCompiler (
 
 NscCompiler::~NscCompiler ()
 {
+	NscReleaseSharedNWScript (m_CompilerState);
 	delete m_CompilerState;
 	NscFlushResourceCache ();
 }
@@ -905,9 +1240,36 @@ NscCompiler::NscDisassembleScript (
 	__out std::string & Disassembly
 	)
 {
-	CNwnMemoryStream MemStream;
+	NscDisassembledInstructionVec Instructions;
 
-	Disassembly .clear ();
+	NscDisassembleScript (Code, CodeLength, Instructions, Disassembly);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Disassemble a script into caller supplied buffers.
+//
+// @parm const void * | Code | Supplies a pointer to the instruction code
+//
+// @parm size_t | CodeLength | Supplies the length of the code to decompile
+//
+// @parm NscDisassembledInstructionVec & | Instructions | Receives the
+//		decoded instructions
+//
+// @parm std::string | Disassembly | Receives the disassembly output
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void
+NscCompiler::NscDisassembleScript (
+	__in_bcount( CodeLength ) const void * Code,
+	__in size_t CodeLength,
+	__inout NscDisassembledInstructionVec & Instructions,
+	__out std::string & Disassembly
+	)
+{
 
 	//
 	// Initialize but ensure we'll do a real initialize later, if we have not
@@ -930,18 +1292,13 @@ NscCompiler::NscDisassembleScript (
 		m_NWScriptParsed = true;
 	}
 
-	::NscScriptDecompile (MemStream,
-		(unsigned char *) Code,
-		(unsigned long) CodeLength,
-		this);
-
-	MemStream .Flush ();
-
-	if (MemStream .GetLength () == 0)
-		return;
-
-	Disassembly .assign ((char *) MemStream .GetData (),
-		MemStream .GetLength ());
+	::NscScriptDisassemble ((const unsigned char *) Code,
+		CodeLength,
+		Instructions);
+	::NscFormatDisassembly ((const unsigned char *) Code,
+		Instructions,
+		this,
+		Disassembly);
 }
 
 //-----------------------------------------------------------------------------
@@ -1155,6 +1512,25 @@ NscCompiler::NscSetResourceCacheEnabled (
 		NscFlushResourceCache ();
 }
 
+//-----------------------------------------------------------------------------
+//
+// @mfunc Attach the compiler to a shared resource cache.
+//
+// @parm NscSharedResourceCache * | SharedCache | Shared cache, or NULL to
+//                                                 detach.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void
+NscCompiler::NscSetSharedResourceCache (
+	__in_opt NscSharedResourceCache * SharedCache
+	)
+{
+	m_SharedResourceCache = SharedCache;
+}
+
 
 //-----------------------------------------------------------------------------
 //
@@ -1182,11 +1558,7 @@ NscCompiler::LoadResource (
 	)
 {
 	unsigned char               * FileContents;
-	ResourceManager::FileHandle   Handle;
-	size_t                        FileSize;
-	size_t                        BytesLeft;
-	size_t                        Offset;
-	size_t                        Read;
+	ResourceCache               * Cache;
 	NWN::ResRef32                 ResRef;
 
 	*pfAllocated = false;
@@ -1200,26 +1572,104 @@ NscCompiler::LoadResource (
 		return NULL;
 	}
 
+	if (m_SharedResourceCache != NULL)
+		Cache = &m_SharedResourceCache ->m_ResourceCache;
+	else if (m_CacheResources)
+		Cache = &m_ResourceCache;
+	else
+		Cache = NULL;
+
 	//
-	// If caching is enabled, query the existing cache first.
+	// Resolve the resource under the shared cache lock, if any, so that the
+	// resource system is only entered by one compiler at a time.
 	//
 
-	if (m_CacheResources)
+	if (m_SharedResourceCache != NULL)
+		EnterCriticalSection (&m_SharedResourceCache ->m_Lock);
+
+	try
 	{
-		ResourceCacheKey CacheKey;
+		bool Found = false;
 
-		CacheKey .ResRef  = ResRef;
-		CacheKey .ResType = (NWN::ResType) nResType;
+		//
+		// If caching is enabled, query the existing cache first.
+		//
+
+		if (Cache != NULL)
+		{
+			ResourceCacheKey CacheKey;
+
+			CacheKey .ResRef  = ResRef;
+			CacheKey .ResType = (NWN::ResType) nResType;
 
-		ResourceCache::const_iterator it = m_ResourceCache .find (CacheKey);
+			ResourceCache::const_iterator it = Cache ->find (CacheKey);
 
-		if (it != m_ResourceCache .end ())
+			if (it != Cache ->end ())
+			{
+				*pulSize     = it ->second .Size;
+				*pfAllocated = false;
+				FileContents = it ->second .Contents;
+				Found        = true;
+			}
+		}
+
+		if (!Found)
 		{
-			*pulSize     = it ->second .Size;
-			*pfAllocated = false;
-			return it ->second .Contents;
+			FileContents = LoadResourceUncached (pszName,
+				ResRef,
+				nResType,
+				pulSize,
+				pfAllocated);
 		}
 	}
+	catch (std::exception)
+	{
+		FileContents = NULL;
+	}
+
+	if (m_SharedResourceCache != NULL)
+		LeaveCriticalSection (&m_SharedResourceCache ->m_Lock);
+
+	return FileContents;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Load a resource from the search paths or the resource system,
+//        bypassing the cache lookup.
+//
+// @parm const char * | pszName | Supplies the name of the resource.
+//
+// @parm const NWN::ResRef32 & | ResRef | Supplies the ResRef of the resource.
+//
+// @parm NwnResType | nResType | Supplies the resource type of the resource.
+//
+// @parm UINT32 * | pulSize | On success, receives the size of the resource.
+//
+// @parm bool * | pfAllocated | On success, retrieves true if the caller must
+//                              deallocate the resource via a call to ::free.
+//
+// @rdesc Pointer to the resource contents on success, else NULL on failure.
+//
+//-----------------------------------------------------------------------------
+
+unsigned char *
+NscCompiler::LoadResourceUncached (
+	__in const char * pszName,
+	__in const NWN::ResRef32 & ResRef,
+	__in NwnResType nResType,
+	__out UINT32 * pulSize,
+	__out bool * pfAllocated
+	)
+{
+	unsigned char               * FileContents;
+	ResourceManager::FileHandle   Handle;
+	size_t                        FileSize;
+	size_t                        BytesLeft;
+	size_t                        Offset;
+	size_t                        Read;
+
+	*pfAllocated = false;
 
 	//
 	// Try additional search paths as the highest priority.
@@ -1665,7 +2115,13 @@ NscCompiler::NscCacheResource (
 	__in NWN::ResType ResType
 	)
 {
-	if (!m_CacheResources)
+	ResourceCache * Cache;
+
+	if (m_SharedResourceCache != NULL)
+		Cache = &m_SharedResourceCache ->m_ResourceCache;
+	else if (m_CacheResources)
+		Cache = &m_ResourceCache;
+	else
 		return false;
 
 	try
@@ -1681,7 +2137,7 @@ NscCompiler::NscCacheResource (
 		Entry .Contents  = ResFileContents;
 		Entry .Size      = ResFileLength;
 
-		Inserted = m_ResourceCache .insert (ResourceCache::value_type (Key, Entry)) .second;
+		Inserted = Cache ->insert (ResourceCache::value_type (Key, Entry)) .second;
 
 		assert (Inserted == true);
 	}
@@ -1712,6 +2168,94 @@ NscCompiler::NscFlushResourceCache (
 		if (it ->second .Allocated)
 			free (it ->second .Contents);
 	}
+
+	m_ResourceCache .clear ();
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc <c NscSharedResourceCache> constructor.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+NscSharedResourceCache::NscSharedResourceCache (
+	)
+{
+	InitializeCriticalSection (&m_Lock);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc <c NscSharedResourceCache> destructor.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+NscSharedResourceCache::~NscSharedResourceCache (
+	)
+{
+	Flush ();
+	DeleteCriticalSection (&m_Lock);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Release all cached resources.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void
+NscSharedResourceCache::Flush (
+	)
+{
+	EnterCriticalSection (&m_Lock);
+
+	for (NscCompiler::ResourceCache::iterator it = m_ResourceCache .begin ();
+		    it != m_ResourceCache .end ();
+		    ++it)
+	{
+		if (it ->second .Allocated)
+			free (it ->second .Contents);
+	}
+
+	m_ResourceCache .clear ();
+
+	LeaveCriticalSection (&m_Lock);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Acquire the cache lock.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void
+NscSharedResourceCache::Acquire (
+	)
+{
+	EnterCriticalSection (&m_Lock);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Release the cache lock.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void
+NscSharedResourceCache::Release (
+	)
+{
+	LeaveCriticalSection (&m_Lock);
 }
 
 
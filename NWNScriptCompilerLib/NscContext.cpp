@@ -64,6 +64,8 @@ static const char *g_astrNscIntrinsicNames [NscIntrinsic__NumIntrinsics+1] =
 	NULL					// NscIntrinsic__NumIntrinsics
 };
 
+static const std::string g_strNscEmpty;
+
 
 #if _NSCCONTEXT_USE_BISONPP
 void yyerror (char *s);
@@ -115,8 +117,13 @@ CNscContext::CNscContext (NscCompiler *pCompiler)
 	m_fWarnedGlobalOverflow = false;
 	m_fWarnedTooManyIdentifiers = false;
 	m_nGlobalIdentifierCount = 0;
+	m_pDeclType = NULL;
+	m_nLastDeclSymbol = 0xFFFFFFFF;
 	m_fPreprocessorEnabled = false;
 	m_fDumpPCode = false;
+	m_fOptNcs = false;
+	m_fShowOptimizerStats = false;
+	m_fFuseTailCalls = false;
 	m_fOptReturn = false;
 	m_fIncludeTerminatesComment = false;
 	m_fOptExpression = false;
@@ -2577,9 +2584,8 @@ const std::string *CNscContext::GetDefineValue (const DefineEntry *psDefine,
 		//
 
 	default:
-		static const std::string strEmpty;
 		assert (false);
-		return &strEmpty;
+		return &g_strNscEmpty;
 
 	}
 }
@@ -2830,7 +2836,7 @@ bool CNscContext::ParsePragmaDefaultFunction (const char *pszPragma)
 		return true;
 
 	std::string strFunction (pszFunction, nCount);
-	NscSymbol *pSymbol = FindDeclSymbol (strFunction .c_str ());
+	NscSymbol *pSymbol = FindDeclSymbolForUpdate (strFunction .c_str ());
 
 	//
 	// Check that the symbol is right
@@ -2958,7 +2964,7 @@ bool CNscContext::ParsePragmaPureFunction (const char *pszPragma)
 		return true;
 
 	std::string strFunction (pszFunction, nCount);
-	NscSymbol *pSymbol = FindDeclSymbol (strFunction .c_str ());
+	NscSymbol *pSymbol = FindDeclSymbolForUpdate (strFunction .c_str ());
 
 	//
 	// Check that the symbol is right
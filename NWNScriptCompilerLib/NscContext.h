@@ -79,6 +79,31 @@ class NscCompiler;
 //
 //-----------------------------------------------------------------------------
 
+struct NscSharedNWScript
+{
+	CNscSymbolTable               m_sNWScript;
+	CNscSymbolTable               m_sReservedWords;
+	int                           m_nActionCount;
+	CNwnArray <size_t>            m_anActions;
+	std::string                   m_astrEngineTypes [16];
+	std::vector <unsigned char>   m_vecSource;
+	bool                          m_fEnableExtensions;
+	bool                          m_fConstKeyword;
+	ULONG                         m_ulReferences;
+
+	inline
+	NscSharedNWScript(
+		)
+	: m_sReservedWords (0x400),
+	  m_nActionCount (0),
+	  m_anActions (),
+	  m_fEnableExtensions (false),
+	  m_fConstKeyword (false),
+	  m_ulReferences (0)
+	{
+	}
+};
+
 struct NscCompilerState
 {
 	CNscSymbolTable               m_sNscReservedWords;
@@ -86,6 +111,7 @@ struct NscCompilerState
 	CNwnArray <size_t>            m_anNscActions;
 	CNscSymbolTable               m_sNscNWScript;
 	CNscSymbolTable               m_sNscLast;
+	NscSharedNWScript           * m_pSharedNWScript;
 	CNscContext                 * m_pCtx;
 	std::string                   m_astrNscEngineTypes [16];
 	const char                  * m_pszErrorPrefix;
@@ -98,6 +124,7 @@ struct NscCompilerState
 	: m_sNscReservedWords (0x400),
 	  m_nNscActionCount (0),
 	  m_anNscActions (),
+	  m_pSharedNWScript (NULL),
 	  m_pCtx (NULL),
 	  m_pszErrorPrefix ("Error"),
 	  m_fEnableExtensions (false),
@@ -400,6 +427,33 @@ public:
 			(UINT32) ~(1 << NscSymType_Structure));
 	}
 
+	// @cmember Find a symbol for a declaration that may modify it
+
+	NscSymbol *FindDeclSymbolForUpdate (const char *pszName)
+	{
+		NscSymbol *pSymbol = FindDeclSymbol (pszName);
+		if (pSymbol != NULL && m_sSymbols .IsShared (pSymbol))
+		{
+
+			//
+			// The shared nwscript.nss table is read-only, so take a
+			// private copy before a script redeclares one of its symbols
+			//
+
+			size_t nSymbol = m_sSymbols .GetSymbolOffset (pSymbol);
+			m_sSymbols .Detach ();
+			pSymbol = m_sSymbols .GetSymbol (nSymbol);
+		}
+		return pSymbol;
+	}
+
+	// @cmember Set flags on a symbol
+
+	void SetSymbolFlags (NscSymbol *pSymbol, UINT32 ulFlags)
+	{
+		m_sSymbols .SetSymbolFlags (pSymbol, ulFlags);
+	}
+
 	// @cmember Find a symbol for use in a struct tag reference
 
 	NscSymbol *FindStructTagSymbol (const char *pszName)
@@ -777,6 +831,34 @@ public:
 		m_pLoader = pLoader;
 	}
 
+	// @cmember Get the type of the declaration being parsed
+
+	CNscPStackEntry *GetDeclType ()
+	{
+		return m_pDeclType;
+	}
+
+	// @cmember Set the type of the declaration being parsed
+
+	void SetDeclType (CNscPStackEntry *pDeclType)
+	{
+		m_pDeclType = pDeclType;
+	}
+
+	// @cmember Get the offset of the last declared global symbol
+
+	size_t GetLastDeclSymbol () const
+	{
+		return m_nLastDeclSymbol;
+	}
+
+	// @cmember Set the offset of the last declared global symbol
+
+	void SetLastDeclSymbol (size_t nSymbol)
+	{
+		m_nLastDeclSymbol = nSymbol;
+	}
+
 	// @cmember TRUE if a main was found 
 
 	bool HasMain () const
@@ -882,6 +964,48 @@ public:
 		m_fDumpPCode = fDumpPCode;
 	}
 
+	// @cmember Return TRUE if the NCS optimizer is to be run.
+
+	bool GetOptNcs () const
+	{
+		return m_fOptNcs;
+	}
+
+	// @cmember Set whether the NCS optimizer is to be run.
+	
+	void SetOptNcs (bool fOptNcs)
+	{
+		m_fOptNcs = fOptNcs;
+	}
+
+	// @cmember Return TRUE if NCS optimizer statistics are to be shown.
+
+	bool GetShowOptimizerStats () const
+	{
+		return m_fShowOptimizerStats;
+	}
+
+	// @cmember Set whether NCS optimizer statistics are to be shown.
+	
+	void SetShowOptimizerStats (bool fShowOptimizerStats)
+	{
+		m_fShowOptimizerStats = fShowOptimizerStats;
+	}
+
+	// @cmember Return TRUE if the NCS optimizer may fuse tail calls.
+
+	bool GetFuseTailCalls () const
+	{
+		return m_fFuseTailCalls;
+	}
+
+	// @cmember Set whether the NCS optimizer may fuse tail calls.
+	
+	void SetFuseTailCalls (bool fFuseTailCalls)
+	{
+		m_fFuseTailCalls = fFuseTailCalls;
+	}
+
 
 	// @cmember Return TRUE if includes terminate an unterminated comment
 
@@ -1812,6 +1936,14 @@ protected:
 
 	int						m_nGlobalIdentifierCount;
 
+	// @cmember Type of the declaration being parsed
+
+	CNscPStackEntry			*m_pDeclType;
+
+	// @cmember Offset of the last declared global symbol
+
+	size_t					m_nLastDeclSymbol;
+
 	//
 	// ------- EXTENSION FLAGS
 	//
@@ -1824,6 +1956,18 @@ protected:
 
 	bool					m_fDumpPCode;
 
+	// @cmember If true, run the NCS optimizer over the generated code
+
+	bool					m_fOptNcs;
+
+	// @cmember If true, report what the NCS optimizer did
+
+	bool					m_fShowOptimizerStats;
+
+	// @cmember If true, let the NCS optimizer turn JSR/RETN into JMP
+
+	bool					m_fFuseTailCalls;
+
 	// @cmember If true, terminate unterminated comments after an #include.
 
 	bool					m_fIncludeTerminatesComment;
@@ -1885,4 +2029,13 @@ protected:
 	int						m_nMaxIdentifierCount;
 };
 
+//-----------------------------------------------------------------------------
+//
+// Access to the context of the compile running on the current thread
+//
+//-----------------------------------------------------------------------------
+
+CNscContext *NscGetCurrentContext ();
+void NscSetCurrentContext (CNscContext *pCtx);
+
 #endif // ETS_NSCCONTEXT_H
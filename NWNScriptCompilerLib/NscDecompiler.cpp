@@ -79,156 +79,146 @@ static unsigned char *GetUINT16 (unsigned char *pData, unsigned long *pul)
 
 //-----------------------------------------------------------------------------
 //
-// @func Get a floating point value from the data
+// @func Get the operator type text
 //
-// @parm unsigned char * | pData | Pointer to the data
-//
-// @parm unsigned long * | pul | Pointer to the destination
+// @parm unsigned char | cOpType | Operator type
 //
-// @rdesc Updated address.
+// @rdesc Type suffix text or NULL if the type is unknown.
 //
 //-----------------------------------------------------------------------------
 
-static unsigned char *GetFLOAT (unsigned char *pData, float *pf)
+static const char *GetOpTypeText (unsigned char cOpType)
 {
-	*pf = CNwnByteOrder<float>::BigEndian (pData);
-	return &pData [4];
+	switch (cOpType)
+	{
+		case 0x03: return "I";
+		case 0x04: return "F";
+		case 0x05: return "S";
+		case 0x06: return "O";
+		case 0x10: return "EFF";
+		case 0x11: return "EVNT";
+		case 0x12: return "LOC";
+		case 0x13: return "TAL";
+		case 0x20: return "II";
+		case 0x21: return "FF";
+		case 0x22: return "OO";
+		case 0x23: return "SS";
+		case 0x24: return "TT";
+		case 0x25: return "IF";
+		case 0x26: return "FI";
+		case 0x30: return "EFFEFF";
+		case 0x3A: return "VV";
+		case 0x3B: return "VF";
+		case 0x3C: return "FV";
+		default: return NULL;
+	}
 }
 
 //-----------------------------------------------------------------------------
 //
-// @func Get the operator text
+// @func Get the mnemonic of an opcode
 //
-// @parm unsigned char | cOpType | Operator type
+// @parm unsigned char | cOp | Opcode
 //
-// @parm char * | szOpText | Output
-//
-// @rdesc None.
+// @rdesc Mnemonic text.
 //
 //-----------------------------------------------------------------------------
 
-static void GetOpText (unsigned char cOpType, char *szOpText)
+static const char *GetOpName (unsigned char cOp)
 {
-	switch (cOpType)
+	switch (cOp)
 	{
-		case 0x03:
-			strcpy (szOpText, "I");
-			break;
-
-		case 0x04:
-			strcpy (szOpText, "F");
-			break;
-
-		case 0x05:
-			strcpy (szOpText, "S");
-			break;
-
-		case 0x06:
-			strcpy (szOpText, "O");
-			break;
-
-		case 0x10:
-			strcpy (szOpText, "EFF");
-			break;
-
-		case 0x11:
-			strcpy (szOpText, "EVNT");
-			break;
-
-		case 0x12:
-			strcpy (szOpText, "LOC");
-			break;
-
-		case 0x13:
-			strcpy (szOpText, "TAL");
-			break;
-
-		case 0x20:
-			strcpy (szOpText, "II");
-			break;
-
-		case 0x21:
-			strcpy (szOpText, "FF");
-			break;
-
-		case 0x22:
-			strcpy (szOpText, "OO");
-			break;
-
-		case 0x23:
-			strcpy (szOpText, "SS");
-			break;
-
-		case 0x24:
-			strcpy (szOpText, "TT");
-			break;
-
-		case 0x25:
-			strcpy (szOpText, "IF");
-			break;
-
-		case 0x26:
-			strcpy (szOpText, "FI");
-			break;
-
-		case 0x30:
-			strcpy (szOpText, "EFFEFF");
-			break;
-
-		case 0x3A:
-			strcpy (szOpText, "VV");
-			break;
-
-		case 0x3B:
-			strcpy (szOpText, "VF");
-			break;
-
-		case 0x3C:
-			strcpy (szOpText, "FV");
-			break;
-
-		default:
-			sprintf (szOpText, "P%d", cOpType);
-			//if (g_fpDebug)
-			//	fprintf (g_fpDebug, "Unknown optype %02X\r\n", cOpType);
-			break;
+		case NscCode_CPDOWNSP:			return "CPDOWNSP";
+		case NscCode_RSADD:				return "RSADD";
+		case NscCode_CPTOPSP:			return "CPTOPSP";
+		case NscCode_CONST:				return "CONST";
+		case NscCode_ACTION:			return "ACTION";
+		case NscCode_LOGAND:			return "LOGAND";
+		case NscCode_LOGOR:				return "LOGOR";
+		case NscCode_INCOR:				return "INCOR";
+		case NscCode_EXCOR:				return "EXCOR";
+		case NscCode_BOOLAND:			return "BOOLAND";
+		case NscCode_EQUAL:				return "EQUAL";
+		case NscCode_NEQUAL:			return "NEQUAL";
+		case NscCode_GEQ:				return "GEQ";
+		case NscCode_GT:				return "GT";
+		case NscCode_LT:				return "LT";
+		case NscCode_LEQ:				return "LEQ";
+		case NscCode_SHLEFT:			return "SHLEFT";
+		case NscCode_SHRIGHT:			return "SHRIGHT";
+		case NscCode_USHRIGHT:			return "USHRIGHT";
+		case NscCode_ADD:				return "ADD";
+		case NscCode_SUB:				return "SUB";
+		case NscCode_MUL:				return "MUL";
+		case NscCode_DIV:				return "DIV";
+		case NscCode_MOD:				return "MOD";
+		case NscCode_NEG:				return "NEG";
+		case NscCode_COMP:				return "COMP";
+		case NscCode_MOVSP:				return "MOVSP";
+		case NscCode_STORE_STATEALL:	return "SAVE_STATEALL";
+		case NscCode_JMP:				return "JMP";
+		case NscCode_JSR:				return "JSR";
+		case NscCode_JZ:				return "JZ";
+		case NscCode_RETN:				return "RETN";
+		case NscCode_DESTRUCT:			return "DESTRUCT";
+		case NscCode_NOT:				return "NOT";
+		case NscCode_DECISP:			return "DECISP";
+		case NscCode_INCISP:			return "INCISP";
+		case NscCode_JNZ:				return "JNZ";
+		case NscCode_CPDOWNBP:			return "CPDOWNBP";
+		case NscCode_CPTOPBP:			return "CPTOPBP";
+		case NscCode_DECIBP:			return "DECIBP";
+		case NscCode_INCIBP:			return "INCIBP";
+		case NscCode_SAVEBP:			return "SAVEBP";
+		case NscCode_RESTOREBP:			return "RESTOREBP";
+		case NscCode_STORE_STATE:		return "STORE_STATE";
+		case NscCode_NOP:				return "NOP";
+		case NscCode_Size:				return "T";
+		default:						return "??";
 	}
 }
 
 //-----------------------------------------------------------------------------
 //
-// @func Dump a script
-//
-// @parm CNwnStream & | sStream | Destination stream
+// @func Decode a script into instruction records
 //
-// @parm unsigned char * | pStart | Start of the data
+// @parm const unsigned char * | pauchData | Script data (with header)
 //
-// @parm unsigned char * | pEnd | End of the data
+// @parm size_t | nSize | Length of the script data
 //
-// @param NscCompiler * | pCompiler | Compiler instance
+// @parm NscDisassembledInstructionVec & | asInstructions | Receives the 
+//		decoded instructions.  Existing storage is reused.
 //
 // @rdesc None.
 //
 //-----------------------------------------------------------------------------
 
-void NscScriptDecompile (CNwnStream &sStream, 
-	unsigned char *pauchData, unsigned long ulSize, NscCompiler *pCompiler)
+void NscScriptDisassemble (const unsigned char *pauchData, size_t nSize,
+	NscDisassembledInstructionVec &asInstructions)
 {
+	asInstructions .clear ();
+
+	if (nSize <= 8)
+		return;
+
+	//
+	// Most instructions are at least 6 bytes long in practice
+	//
+
+	if (asInstructions .capacity () < nSize / 6)
+		asInstructions .reserve (nSize / 6);
 
 	//
 	// Loop through the data
 	//
 
-	unsigned char *pStart = pauchData;
-	unsigned char *pEnd = &pauchData [ulSize];
-	unsigned char *pData = pStart;
-	pData += 8;
+	unsigned char *pStart = (unsigned char *) pauchData;
+	unsigned char *pEnd = &pStart [nSize];
+	unsigned char *pData = pStart + 8;
 	while (pData < pEnd)
 	{
-		char szByteText [128];
-		char szOpText [512];
-		char szOpType [32];
-		char *pszOpRoot;
+		NscDisassembledInstruction sInstr;
+		unsigned long ul1, ul2, ul3;
 
 		//
 		// Switch based on the next opcode
@@ -236,461 +226,642 @@ void NscScriptDecompile (CNwnStream &sStream,
 
 		unsigned char *pOp = pData;
 		unsigned char cOp = *pData++;
+
+		sInstr .ulOffset = (UINT32) (pOp - pStart);
+		sInstr .cOp = cOp;
+		sInstr .cType = 0;
+		sInstr .aulOperands [0] = 0;
+		sInstr .aulOperands [1] = 0;
+		sInstr .aulOperands [2] = 0;
+
 		switch (cOp)
 		{
 
 			case NscCode_CPDOWNSP:
-				{
-					if (&pData [7] > pEnd || pData [0] != 1)
-						goto invalid_op;
-					unsigned long ul1, ul2;
-					pData = GetUINT32 (pData + 1, &ul1);
-					pData = GetUINT16 (pData, &ul2);
-					sprintf (szByteText, "%02X 01 %08X %04X", cOp, ul1, ul2);
-					sprintf (szOpText, "CPDOWNSP %08X, %04X", ul1, ul2);
-				}
+			case NscCode_CPTOPSP:
+			case NscCode_CPDOWNBP:
+			case NscCode_CPTOPBP:
+				if (&pData [7] > pEnd || pData [0] != 1)
+					goto invalid_op;
+				pData = GetUINT32 (pData + 1, &ul1);
+				pData = GetUINT16 (pData, &ul2);
+				sInstr .nForm = NscDisasmForm_Stack;
+				sInstr .aulOperands [0] = ul1;
+				sInstr .aulOperands [1] = ul2;
 				break;
 
 			case NscCode_RSADD:
-				pszOpRoot = "RSADD";
-do_simple_operator:;
-				{
-					if (&pData [1] > pEnd)
-						goto invalid_op;
-					unsigned char cOpType = *pData++;
-					GetOpText (cOpType, szOpType);
-					sprintf (szByteText, "%02X %02X", cOp, cOpType);
-					sprintf (szOpText, "%s%s", pszOpRoot, szOpType);
-				}
-				break;
-
-			case NscCode_CPTOPSP:
-				{
-					if (&pData [7] > pEnd || pData [0] != 1)
-						goto invalid_op;
-					unsigned long ul1, ul2;
-					pData = GetUINT32 (pData + 1, &ul1);
-					pData = GetUINT16 (pData, &ul2);
-					sprintf (szByteText, "%02X 01 %08X %04X", cOp, ul1, ul2);
-					sprintf (szOpText, "CPTOPSP %08X, %04X", ul1, ul2);
-				}
+			case NscCode_NEG:
+			case NscCode_COMP:
+			case NscCode_NOT:
+				if (&pData [1] > pEnd)
+					goto invalid_op;
+				sInstr .cType = *pData++;
+				sInstr .nForm = NscDisasmForm_Type;
 				break;
 
 			case NscCode_CONST:
+				if (&pData [1] > pEnd)
+					goto invalid_op;
+				sInstr .cType = *pData;
+				switch (sInstr .cType)
 				{
-					if (&pData [1] > pEnd)
-						goto invalid_op;
-					unsigned char cOpType = *pData;
-					GetOpText (cOpType, szOpType);
-					switch (cOpType)
-					{
-						case 3:
-						case 6:
-							{
-								if (&pData [5] > pEnd)
-									goto invalid_op;
-								unsigned long ul;
-								pData = GetUINT32 (pData + 1, &ul);
-								sprintf (szByteText, "%02X %02X %08X", cOp, cOpType, ul);
-								sprintf (szOpText, "CONST%s %08X", szOpType, ul);
-							}
-							break;
-
-						case 4:
-							{
-								if (&pData [5] > pEnd)
-									goto invalid_op;
-								union
-								{
-									unsigned long ul;
-									float f;
-								} val;
-								pData = GetFLOAT (pData + 1, &val .f);
-								sprintf (szByteText, "%02X %02X %08X", cOp, cOpType, val .ul);
-								sprintf (szOpText, "CONST%s %f", szOpType, val .f);
-							}
-							break;
-
-						case 5:
-							{
-								if (&pData [3] > pEnd)
-									goto invalid_op;
-								unsigned long ul;
-								GetUINT16 (pData + 1, &ul);
-								if (&pData [3 + ul] > pEnd)
-									goto invalid_op;
-								pData += 3;
-								char szValue [129];
-								unsigned long ulCopy = ul > 128 ? 128 : ul;
-								memmove (szValue, pData, ulCopy);
-								szValue [ulCopy] = 0;
-								sprintf (szByteText, "%02X %02X %04X str", cOp, cOpType, ul);
-								snprintf (szOpText, _countof (szOpText), 
-									"CONST%s \"%s\"", szOpType, szValue);
-								pData += ul;
-							}
-							break;
-
-						default:
+					case 3:
+					case 6:
+						if (&pData [5] > pEnd)
 							goto invalid_op;
-					}
+						pData = GetUINT32 (pData + 1, &ul1);
+						sInstr .nForm = NscDisasmForm_ConstInt;
+						sInstr .aulOperands [0] = ul1;
+						break;
+
+					case 4:
+						if (&pData [5] > pEnd)
+							goto invalid_op;
+						pData = GetUINT32 (pData + 1, &ul1);
+						sInstr .nForm = NscDisasmForm_ConstFloat;
+						sInstr .aulOperands [0] = ul1;
+						break;
+
+					case 5:
+						if (&pData [3] > pEnd)
+							goto invalid_op;
+						GetUINT16 (pData + 1, &ul1);
+						if (&pData [3 + ul1] > pEnd)
+							goto invalid_op;
+						pData += 3;
+						sInstr .nForm = NscDisasmForm_ConstString;
+						sInstr .aulOperands [0] = ul1;
+						sInstr .aulOperands [1] = (UINT32) (pData - pStart);
+						pData += ul1;
+						break;
+
+					default:
+						goto invalid_op;
 				}
 				break;
 
 			case NscCode_ACTION:
-				{
-					if (&pData [4] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1, ul2;
-					pData = GetUINT16 (pData + 1, &ul1);
-					ul2 = *pData++;
-					const char *pszName = NscGetActionName ((int) ul1, pCompiler);
-					sprintf (szByteText, "%02X 00 %04X %02X", cOp, ul1, ul2);
-					sprintf (szOpText, "ACTION %s(%04X), %02X", pszName, ul1, ul2);
-				}
+				if (&pData [4] > pEnd || pData [0] != 0)
+					goto invalid_op;
+				pData = GetUINT16 (pData + 1, &ul1);
+				ul2 = *pData++;
+				sInstr .nForm = NscDisasmForm_Action;
+				sInstr .aulOperands [0] = ul1;
+				sInstr .aulOperands [1] = ul2;
 				break;
 
 			case NscCode_LOGAND:
-				pszOpRoot = "LOGAND";
-do_binary_operator:;
+			case NscCode_LOGOR:
+			case NscCode_INCOR:
+			case NscCode_EXCOR:
+			case NscCode_BOOLAND:
+			case NscCode_EQUAL:
+			case NscCode_NEQUAL:
+			case NscCode_GEQ:
+			case NscCode_GT:
+			case NscCode_LT:
+			case NscCode_LEQ:
+			case NscCode_SHLEFT:
+			case NscCode_SHRIGHT:
+			case NscCode_USHRIGHT:
+			case NscCode_ADD:
+			case NscCode_SUB:
+			case NscCode_MUL:
+			case NscCode_DIV:
+			case NscCode_MOD:
+				if (&pData [1] > pEnd)
+					goto invalid_op;
+				sInstr .cType = *pData++;
+				if (sInstr .cType == 0x24)
 				{
-					if (&pData [1] > pEnd)
+					if (&pData [2] > pEnd)
 						goto invalid_op;
-					unsigned char cOpType = *pData++;
-					GetOpText (cOpType, szOpType);
-					if (cOpType == 0x24)
-					{
-						if (&pData [2] > pEnd)
-							goto invalid_op;
-						unsigned long ul1;
-						pData = GetUINT16 (pData, &ul1);
-						sprintf (szByteText, "%02X %02X %04X", cOp, cOpType, ul1);
-						sprintf (szOpText, "%s%s %04X", pszOpRoot, szOpType, ul1);
-					}
-					else
-					{
-						sprintf (szByteText, "%02X %02X", cOp, cOpType);
-						sprintf (szOpText, "%s%s", pszOpRoot, szOpType);
-					}
+					pData = GetUINT16 (pData, &ul1);
+					sInstr .nForm = NscDisasmForm_TypeSize;
+					sInstr .aulOperands [0] = ul1;
 				}
+				else
+					sInstr .nForm = NscDisasmForm_Type;
 				break;
 
-			case NscCode_LOGOR:
-				pszOpRoot = "LOGOR";
-				goto do_binary_operator;
+			case NscCode_MOVSP:
+				if (&pData [5] > pEnd || pData [0] != 0)
+					goto invalid_op;
+				pData = GetUINT32 (pData + 1, &ul1);
+				sInstr .nForm = NscDisasmForm_Imm32;
+				sInstr .aulOperands [0] = ul1;
+				break;
 
-			case NscCode_INCOR:
-				pszOpRoot = "INCOR";
-				goto do_binary_operator;
+			case NscCode_DECISP:
+			case NscCode_INCISP:
+			case NscCode_DECIBP:
+			case NscCode_INCIBP:
+				if (&pData [5] > pEnd || pData [0] != 3)
+					goto invalid_op;
+				pData = GetUINT32 (pData + 1, &ul1);
+				sInstr .cType = 3;
+				sInstr .nForm = NscDisasmForm_Imm32;
+				sInstr .aulOperands [0] = ul1;
+				break;
 
-			case NscCode_EXCOR:
-				pszOpRoot = "EXCOR";
-				goto do_binary_operator;
+			case NscCode_STORE_STATEALL:
+				if (&pData [1] > pEnd)
+					goto invalid_op;
+				sInstr .cType = *pData++;
+				sInstr .nForm = NscDisasmForm_SaveStateAll;
+				break;
 
-			case NscCode_BOOLAND:
-				pszOpRoot = "BOOLAND";
-				goto do_binary_operator;
+			case NscCode_JMP:
+			case NscCode_JSR:
+			case NscCode_JZ:
+			case NscCode_JNZ:
+				if (&pData [5] > pEnd || pData [0] != 0)
+					goto invalid_op;
+				pData = GetUINT32 (pData + 1, &ul1);
+				sInstr .nForm = NscDisasmForm_Branch;
+				sInstr .aulOperands [0] = ul1;
+				sInstr .aulOperands [1] = (UINT32) (sInstr .ulOffset + ul1);
+				break;
 
-			case NscCode_EQUAL:
-				pszOpRoot = "EQUAL";
-				goto do_binary_operator;
+			case NscCode_RETN:
+			case NscCode_SAVEBP:
+			case NscCode_RESTOREBP:
+			case NscCode_NOP:
+				if (&pData [1] > pEnd || pData [0] != 0)
+					goto invalid_op;
+				pData++;
+				sInstr .nForm = NscDisasmForm_NoOperand;
+				break;
 
-			case NscCode_NEQUAL:
-				pszOpRoot = "NEQUAL";
-				goto do_binary_operator;
+			case NscCode_DESTRUCT:
+				if (&pData [7] > pEnd || pData [0] != 1)
+					goto invalid_op;
+				pData = GetUINT16 (pData + 1, &ul1);
+				pData = GetUINT16 (pData, &ul2);
+				pData = GetUINT16 (pData, &ul3);
+				sInstr .nForm = NscDisasmForm_Destruct;
+				sInstr .aulOperands [0] = ul1;
+				sInstr .aulOperands [1] = ul2;
+				sInstr .aulOperands [2] = ul3;
+				// First parameter, number of bytes to destroy
+				// Second parameter, offset of element not to destroy
+				// Third parameter, number of bytes no to destroy
+				break;
 
-			case NscCode_GEQ:
-				pszOpRoot = "GEQ";
-				goto do_binary_operator;
+			case NscCode_STORE_STATE:
+				if (&pData [9] > pEnd)
+					goto invalid_op;
+				sInstr .cType = *pData++;
+				pData = GetUINT32 (pData, &ul1);
+				pData = GetUINT32 (pData, &ul2);
+				sInstr .nForm = NscDisasmForm_StoreState;
+				sInstr .aulOperands [0] = ul1;
+				sInstr .aulOperands [1] = ul2;
+			    // First value is BP stack size to save
+				// second value is SP stack size to save
+				break;
 
-			case NscCode_GT:
-				pszOpRoot = "GT";
-				goto do_binary_operator;
+			case NscCode_Size:
+				if (&pData [4] > pEnd)
+					goto invalid_op;
+				pData = GetUINT32 (pData, &ul1);
+				sInstr .nForm = NscDisasmForm_Size;
+				sInstr .aulOperands [0] = ul1;
+				break;
 
-			case NscCode_LT:
-				pszOpRoot = "LT";
-				goto do_binary_operator;
+			default:
+invalid_op:;
 
-			case NscCode_LEQ:
-				pszOpRoot = "LEQ";
-				goto do_binary_operator;
+				//
+				// N.B.  A binary operator with a truncated TT size has 
+				//       already consumed its type byte
+				//
 
-			case NscCode_SHLEFT:
-				pszOpRoot = "SHLEFT";
-				goto do_binary_operator;
+				sInstr .nForm = NscDisasmForm_Invalid;
+				break;
+		}
 
-			case NscCode_SHRIGHT:
-				pszOpRoot = "SHRIGHT";
-				goto do_binary_operator;
+		sInstr .ulLength = (UINT32) (pData - pOp);
+		asInstructions .push_back (sInstr);
+	}
+}
 
-			case NscCode_USHRIGHT:
-				pszOpRoot = "USHRIGHT";
-				goto do_binary_operator;
+//-----------------------------------------------------------------------------
+//
+// Text formatting helpers.  These write into a buffer that the caller has
+// already sized and return the updated write position.
+//
+//-----------------------------------------------------------------------------
 
-			case NscCode_ADD:
-				pszOpRoot = "ADD";
-				goto do_binary_operator;
+static const char g_achNscHexUpper [] = "0123456789ABCDEF";
+static const char g_achNscHexLower [] = "0123456789abcdef";
 
-			case NscCode_SUB:
-				pszOpRoot = "SUB";
-				goto do_binary_operator;
+static char *PutHex (char *p, UINT32 ul, int nDigits, const char *pachDigits)
+{
+	for (int i = nDigits - 1; i >= 0; i--)
+	{
+		p [i] = pachDigits [ul & 0xF];
+		ul >>= 4;
+	}
+	return p + nDigits;
+}
 
-			case NscCode_MUL:
-				pszOpRoot = "MUL";
-				goto do_binary_operator;
+static char *PutHex8 (char *p, UINT32 ul)
+{
+	return PutHex (p, ul, 8, g_achNscHexUpper);
+}
 
-			case NscCode_DIV:
-				pszOpRoot = "DIV";
-				goto do_binary_operator;
+static char *PutHex4 (char *p, UINT32 ul)
+{
+	return PutHex (p, ul, 4, g_achNscHexUpper);
+}
 
-			case NscCode_MOD:
-				pszOpRoot = "MOD";
-				goto do_binary_operator;
+static char *PutHex2 (char *p, UINT32 ul)
+{
+	return PutHex (p, ul, 2, g_achNscHexUpper);
+}
 
-			case NscCode_NEG:
-				pszOpRoot = "NEG";
-				goto do_simple_operator;
+static char *PutText (char *p, const char *psz)
+{
+	while (*psz)
+		*p++ = *psz++;
+	return p;
+}
 
-			case NscCode_COMP:
-				pszOpRoot = "COMP";
-				goto do_simple_operator;
+static char *PutDecimal (char *p, UINT64 ul)
+{
+	char achDigits [20];
+	int nDigits = 0;
 
-			case NscCode_MOVSP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 00 %08X", cOp, ul1);
-					sprintf (szOpText, "MOVSP %08X", ul1);
-				}
+	do
+	{
+		achDigits [nDigits++] = (char) ('0' + (ul % 10));
+		ul /= 10;
+	} while (ul != 0);
+
+	while (nDigits > 0)
+		*p++ = achDigits [--nDigits];
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Format a float as printf's "%f" would
+//
+// @parm char * | p | Output position (at least 64 bytes available)
+//
+// @parm UINT32 | ulBits | IEEE bits of the float
+//
+// @rdesc Updated output position.
+//
+//-----------------------------------------------------------------------------
+
+static char *PutFloat (char *p, UINT32 ulBits)
+{
+	union
+	{
+		UINT32 ul;
+		float f;
+	} val;
+
+	val .ul = ulBits;
+
+	//
+	// A float below 1e9 in magnitude, scaled by 1e6, is an exact double with
+	// an exact fractional part, so rounding to six places is exact unless
+	// the value is a tie (which the CRTs may break differently).  Everything
+	// else is left to the CRT.
+	//
+
+	double dAbs = fabs ((double) val .f);
+
+	if (dAbs < 1e9)
+	{
+		double dScaled = dAbs * 1e6;
+		double dWhole = floor (dScaled);
+		double dFrac = dScaled - dWhole;
+
+		if (dFrac != 0.5)
+		{
+			UINT64 ulValue = (UINT64) dWhole + (dFrac > 0.5 ? 1 : 0);
+
+			if ((ulBits & 0x80000000) != 0)
+				*p++ = '-';
+			p = PutDecimal (p, ulValue / 1000000);
+			*p++ = '.';
+			UINT32 ulFraction = (UINT32) (ulValue % 1000000);
+			for (int i = 5; i >= 0; i--)
+			{
+				p [i] = (char) ('0' + (ulFraction % 10));
+				ulFraction /= 10;
+			}
+			return p + 6;
+		}
+	}
+
+	return p + sprintf (p, "%f", val .f);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Format decoded instructions as text
+//
+// @parm const unsigned char * | pauchData | Script data the instructions 
+//		were decoded from
+//
+// @parm const NscDisassembledInstructionVec & | asInstructions | Decoded
+//		instructions
+//
+// @parm NscCompiler * | pCompiler | Compiler used to name actions, or NULL
+//
+// @parm std::string & | strOut | Receives the text.  Existing storage is
+//		reused.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void NscFormatDisassembly (const unsigned char *pauchData, 
+	const NscDisassembledInstructionVec &asInstructions, 
+	NscCompiler *pCompiler, std::string &strOut)
+{
+	size_t nPos = 0;
+
+	//
+	// Lines other than actions and string constants are under 128 bytes
+	//
+
+	if (strOut .size () < asInstructions .size () * 64)
+		strOut .resize (asInstructions .size () * 64);
+
+	for (size_t i = 0; i < asInstructions .size (); i++)
+	{
+		const NscDisassembledInstruction &sInstr = asInstructions [i];
+		const char *pszName = NULL;
+		size_t nNameLength = 0;
+
+		//
+		// Make sure the line fits
+		//
+
+		if (sInstr .nForm == NscDisasmForm_Action)
+		{
+			if (pCompiler != NULL)
+				pszName = NscGetActionName ((int) sInstr .aulOperands [0], pCompiler);
+			else
+				pszName = "UnknownAction";
+			nNameLength = strlen (pszName);
+		}
+
+		size_t nNeeded = nPos + 128 + 256 + nNameLength;
+		if (strOut .size () < nNeeded)
+			strOut .resize (nNeeded > strOut .size () * 2 ? nNeeded : strOut .size () * 2);
+
+		char *pLine = &strOut [nPos];
+		char *p = pLine;
+		UINT32 ul1 = sInstr .aulOperands [0];
+		UINT32 ul2 = sInstr .aulOperands [1];
+		UINT32 ul3 = sInstr .aulOperands [2];
+
+		//
+		// Offset and raw bytes ("%08X %-24s ")
+		//
+
+		p = PutHex8 (p, sInstr .ulOffset);
+		*p++ = ' ';
+		char *pBytes = p;
+		p = PutHex2 (p, sInstr .cOp);
+		switch (sInstr .nForm)
+		{
+			case NscDisasmForm_Type:
+			case NscDisasmForm_SaveStateAll:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
 				break;
 
-			case NscCode_STORE_STATEALL:
-				{
-					if (&pData [1] > pEnd)
-						goto invalid_op;
-					unsigned long ul = *pData++;
-					sprintf (szByteText, "%02X %02X", cOp, ul);
-					sprintf (szOpText, "SAVE_STATEALL %02x", ul);
-				}
+			case NscDisasmForm_TypeSize:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
+				*p++ = ' ';
+				p = PutHex4 (p, ul1);
 				break;
 
-			case NscCode_JMP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 00 %08X", cOp, ul1);
-					sprintf (szOpText, "JMP off_%08X", (pOp - pStart) + ul1);
-				}
+			case NscDisasmForm_Stack:
+				p = PutText (p, " 01 ");
+				p = PutHex8 (p, ul1);
+				*p++ = ' ';
+				p = PutHex4 (p, ul2);
 				break;
 
-			case NscCode_JSR:
-				{
-					if (&pData [5] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 00 %08X", cOp, ul1);
-					sprintf (szOpText, "JSR fn_%08X", (pOp - pStart) + ul1);
-				}
+			case NscDisasmForm_ConstInt:
+			case NscDisasmForm_ConstFloat:
+			case NscDisasmForm_Imm32:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
+				*p++ = ' ';
+				p = PutHex8 (p, ul1);
 				break;
 
-			case NscCode_JZ:
-				{
-					if (&pData [5] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 00 %08X", cOp, ul1);
-					sprintf (szOpText, "JZ off_%08X", (pOp - pStart) + ul1);
-				}
+			case NscDisasmForm_ConstString:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
+				*p++ = ' ';
+				p = PutHex4 (p, ul1);
+				p = PutText (p, " str");
 				break;
 
-			case NscCode_RETN:
-				{
-					if (&pData [1] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					pData++;
-					sprintf (szByteText, "%02X 00", cOp);
-					sprintf (szOpText, "RETN");
-				}
+			case NscDisasmForm_Action:
+				p = PutText (p, " 00 ");
+				p = PutHex4 (p, ul1);
+				*p++ = ' ';
+				p = PutHex2 (p, ul2);
 				break;
 
-			case NscCode_DESTRUCT:
-				{
-					if (&pData [7] > pEnd || pData [0] != 1)
-						goto invalid_op;
-					unsigned long ul1, ul2, ul3;
-					pData = GetUINT16 (pData + 1, &ul1);
-					pData = GetUINT16 (pData, &ul2);
-					pData = GetUINT16 (pData, &ul3);
-					sprintf (szByteText, "%02X 01 %04X %04X %04x", cOp, ul1, ul2, ul3);
-					sprintf (szOpText, "DESTRUCT %04X, %04X, %04X", ul1, ul2, ul3);
-					// First parameter, number of bytes to destroy
-					// Second parameter, offset of element not to destroy
-					// Third parameter, number of bytes no to destroy
-				}
+			case NscDisasmForm_Branch:
+				p = PutText (p, " 00 ");
+				p = PutHex8 (p, ul1);
 				break;
 
-			case NscCode_NOT:
-				pszOpRoot = "NOT";
-				goto do_simple_operator;
+			case NscDisasmForm_NoOperand:
+				p = PutText (p, " 00");
+				break;
 
-			case NscCode_DECISP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 3)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 03 %08X", cOp, ul1);
-					sprintf (szOpText, "DECISP %08X", ul1);
-				}
+			case NscDisasmForm_Destruct:
+				p = PutText (p, " 01 ");
+				p = PutHex4 (p, ul1);
+				*p++ = ' ';
+				p = PutHex4 (p, ul2);
+				*p++ = ' ';
+				p = PutHex (p, ul3, 4, g_achNscHexLower);
 				break;
 
-			case NscCode_INCISP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 3)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 03 %08X", cOp, ul1);
-					sprintf (szOpText, "INCISP %08X", ul1);
-				}
+			case NscDisasmForm_StoreState:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
+				*p++ = ' ';
+				p = PutHex8 (p, ul1);
+				*p++ = ' ';
+				p = PutHex8 (p, ul2);
 				break;
 
-			case NscCode_JNZ:
-				{
-					if (&pData [5] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 00 %08X", cOp, ul1);
-					sprintf (szOpText, "JNZ off_%08X", (pOp - pStart) + ul1);
-				}
+			case NscDisasmForm_Size:
+				*p++ = ' ';
+				p = PutHex8 (p, ul1);
 				break;
+		}
+		while (p - pBytes < 24)
+			*p++ = ' ';
+		*p++ = ' ';
 
-			case NscCode_CPDOWNBP:
+		//
+		// Operation text
+		//
+
+		if (sInstr .nForm == NscDisasmForm_Invalid)
+			p = PutText (p, "??");
+		else
+			p = PutText (p, GetOpName (sInstr .cOp));
+
+		switch (sInstr .nForm)
+		{
+			case NscDisasmForm_Type:
+			case NscDisasmForm_TypeSize:
+			case NscDisasmForm_ConstInt:
+			case NscDisasmForm_ConstFloat:
+			case NscDisasmForm_ConstString:
 				{
-					if (&pData [7] > pEnd || pData [0] != 1)
-						goto invalid_op;
-					unsigned long ul1, ul2;
-					pData = GetUINT32 (pData + 1, &ul1);
-					pData = GetUINT16 (pData, &ul2);
-					sprintf (szByteText, "%02X 01 %08X %04X", cOp, ul1, ul2);
-					sprintf (szOpText, "CPDOWNBP %08X, %04X", ul1, ul2);
+					const char *pszType = GetOpTypeText (sInstr .cType);
+					if (pszType != NULL)
+						p = PutText (p, pszType);
+					else
+					{
+						*p++ = 'P';
+						p = PutDecimal (p, sInstr .cType);
+					}
 				}
 				break;
+		}
 
-			case NscCode_CPTOPBP:
-				{
-					if (&pData [7] > pEnd || pData [0] != 1)
-						goto invalid_op;
-					unsigned long ul1, ul2;
-					pData = GetUINT32 (pData + 1, &ul1);
-					pData = GetUINT16 (pData, &ul2);
-					sprintf (szByteText, "%02X 01 %08X %04X", cOp, ul1, ul2);
-					sprintf (szOpText, "CPTOPBP %08X, %04X", ul1, ul2);
-				}
+		switch (sInstr .nForm)
+		{
+			case NscDisasmForm_TypeSize:
+				*p++ = ' ';
+				p = PutHex4 (p, ul1);
 				break;
 
-			case NscCode_DECIBP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 3)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 03 %08X", cOp, ul1);
-					sprintf (szOpText, "DECIBP %08X", ul1);
-				}
+			case NscDisasmForm_Stack:
+				*p++ = ' ';
+				p = PutHex8 (p, ul1);
+				p = PutText (p, ", ");
+				p = PutHex4 (p, ul2);
 				break;
 
-			case NscCode_INCIBP:
-				{
-					if (&pData [5] > pEnd || pData [0] != 3)
-						goto invalid_op;
-					unsigned long ul1;
-					pData = GetUINT32 (pData + 1, &ul1);
-					sprintf (szByteText, "%02X 03 %08X", cOp, ul1);
-					sprintf (szOpText, "INCIBP %08X", ul1);
-				}
+			case NscDisasmForm_ConstInt:
+			case NscDisasmForm_Imm32:
+			case NscDisasmForm_Size:
+				*p++ = ' ';
+				p = PutHex8 (p, ul1);
 				break;
 
-			case NscCode_SAVEBP:
-				{
-					if (&pData [1] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					pData++;
-					sprintf (szByteText, "%02X 00", cOp);
-					sprintf (szOpText, "SAVEBP");
-				}
+			case NscDisasmForm_ConstFloat:
+				*p++ = ' ';
+				p = PutFloat (p, ul1);
 				break;
 
-			case NscCode_RESTOREBP:
+			case NscDisasmForm_ConstString:
 				{
-					if (&pData [1] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					pData++;
-					sprintf (szByteText, "%02X 00", cOp);
-					sprintf (szOpText, "RESTOREBP");
+
+					//
+					// At most 128 characters are shown, up to any NUL
+					//
+
+					const unsigned char *pszValue = &pauchData [ul2];
+					size_t nCopy = ul1 > 128 ? 128 : ul1;
+					const void *pNul = memchr (pszValue, 0, nCopy);
+					if (pNul != NULL)
+						nCopy = (size_t) ((const unsigned char *) pNul - pszValue);
+					p = PutText (p, " \"");
+					memcpy (p, pszValue, nCopy);
+					p += nCopy;
+					*p++ = '"';
 				}
 				break;
 
-			case NscCode_STORE_STATE:
-				{
-					if (&pData [9] > pEnd)
-						goto invalid_op;
-					unsigned long ul1, ul2, ul3;
-					ul3 = *pData++;
-					pData = GetUINT32 (pData, &ul1);
-					pData = GetUINT32 (pData, &ul2);
-					sprintf (szByteText, "%02X %02X %08X %08X", cOp, ul3, ul1, ul2);
-					sprintf (szOpText, "STORE_STATE %02X, %08X, %08X", ul3, ul1, ul2);
-				    // First value is BP stack size to save
-					// second value is SP stack size to save
-				}
+			case NscDisasmForm_Action:
+				*p++ = ' ';
+				memcpy (p, pszName, nNameLength);
+				p += nNameLength;
+				*p++ = '(';
+				p = PutHex4 (p, ul1);
+				p = PutText (p, "), ");
+				p = PutHex2 (p, ul2);
 				break;
 
-			case NscCode_NOP:
-				{
-					if (&pData [1] > pEnd || pData [0] != 0)
-						goto invalid_op;
-					pData++;
-					sprintf (szByteText, "%02X 00", cOp);
-					sprintf (szOpText, "NOP");
-				}
+			case NscDisasmForm_Branch:
+				p = PutText (p, sInstr .cOp == NscCode_JSR ? " fn_" : " off_");
+				p = PutHex8 (p, ul2);
 				break;
 
-			case NscCode_Size:
-				{
-					if (&pData [4] > pEnd)
-						goto invalid_op;
-					unsigned long ul;
-					pData = GetUINT32 (pData, &ul);
-					sprintf (szByteText, "%02X %08X", cOp, ul);
-					sprintf (szOpText, "T %08X", ul);
-				}
+			case NscDisasmForm_SaveStateAll:
+				*p++ = ' ';
+				p = PutHex (p, sInstr .cType, 2, g_achNscHexLower);
 				break;
 
-			default:
-invalid_op:;
-				sprintf (szByteText, "%02X", cOp);
-				sprintf (szOpText, "??");
-				//if (g_fpDebug)
-				//	fprintf (g_fpDebug, "Unknown opcode %02x\r\n", cOp);
+			case NscDisasmForm_Destruct:
+				*p++ = ' ';
+				p = PutHex4 (p, ul1);
+				p = PutText (p, ", ");
+				p = PutHex4 (p, ul2);
+				p = PutText (p, ", ");
+				p = PutHex4 (p, ul3);
 				break;
-		}
 
-		//
-		// Format the final line
-		//
+			case NscDisasmForm_StoreState:
+				*p++ = ' ';
+				p = PutHex2 (p, sInstr .cType);
+				p = PutText (p, ", ");
+				p = PutHex8 (p, ul1);
+				p = PutText (p, ", ");
+				p = PutHex8 (p, ul2);
+				break;
+		}
 
-		char szText [1024];
-		sprintf (szText, "%08X %-24s %s", pOp - pStart, szByteText, szOpText);
-		sStream .WriteLine (szText);
+		*p++ = '\r';
+		*p++ = '\n';
+		nPos += (size_t) (p - pLine);
 	}
+
+	strOut .resize (nPos);
+}
+
+//-----------------------------------------------------------------------------
+//
+// @func Dump a script
+//
+// @parm CNwnStream & | sStream | Destination stream
+//
+// @parm unsigned char * | pStart | Start of the data
+//
+// @parm unsigned char * | pEnd | End of the data
+//
+// @param NscCompiler * | pCompiler | Compiler instance
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void NscScriptDecompile (CNwnStream &sStream, 
+	unsigned char *pauchData, unsigned long ulSize, NscCompiler *pCompiler)
+{
+	NscDisassembledInstructionVec asInstructions;
+	std::string strText;
+
+	NscScriptDisassemble (pauchData, ulSize, asInstructions);
+	NscFormatDisassembly (pauchData, asInstructions, pCompiler, strText);
+
+	if (!strText .empty ())
+		sStream .Write (&strText [0], strText .size ());
 }
 
 #ifdef XXX
@@ -0,0 +1,1135 @@
+//-----------------------------------------------------------------------------
+//
+// @doc
+//
+// @module	NscOptimizer.cpp - Post-generation NCS optimizer |
+//
+// This module contains the NCS optimizer.
+//
+// Copyright (c) 2008-2011 - Ken Johnson (Skywing)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Neither the name of Edward T. Smith nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @end
+//
+// $History: NscOptimizer.cpp $
+//
+//-----------------------------------------------------------------------------
+
+#include "Precomp.h"
+#include "Nsc.h"
+#include "NscOptimizer.h"
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc <c CNscOptimizer> constructor.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+CNscOptimizer::CNscOptimizer ()
+{
+	m_nOriginalSize = 0;
+	m_nNewSize = 0;
+	m_nLoaderEnd = 0;
+	m_fRelocated = false;
+	m_fFuseTailCalls = false;
+	memset (&m_sStats, 0, sizeof (m_sStats));
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc <c CNscOptimizer> destructor.
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+CNscOptimizer::~CNscOptimizer ()
+{
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Optimize a complete NCS image
+//
+// @parm unsigned char * | pauchCode | Image to optimize.  On success the
+//		optimized image is written back to the same buffer.
+//
+// @parm size_t | nCodeSize | Size of the image, including the header
+//
+// @parm size_t * | pnNewCodeSize | Receives the size of the new image
+//
+// @rdesc TRUE if the image was optimized.  If FALSE is returned the image
+//		could not be decoded and was left unchanged.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::Optimize (unsigned char *pauchCode, size_t nCodeSize,
+	size_t *pnNewCodeSize)
+{
+
+	//
+	// Reset the state from any previous run
+	//
+
+	m_fRelocated = false;
+	m_nOriginalSize = nCodeSize;
+	m_nNewSize = nCodeSize;
+	memset (&m_sStats, 0, sizeof (m_sStats));
+	*pnNewCodeSize = nCodeSize;
+
+	//
+	// Decode the image.  If anything unexpected is seen, then leave the
+	// image alone rather than risk producing a broken script.
+	//
+
+	if (!Decode (pauchCode, nCodeSize))
+	{
+		m_asInstructions .clear ();
+		return false;
+	}
+
+	m_sStats .nInstructionsBefore = m_asInstructions .size ();
+	m_sStats .nBytesBefore = nCodeSize;
+
+	//
+	// Run the passes until nothing changes.  Each pass may expose more work
+	// for the others (folding a constant branch makes code unreachable,
+	// removing code makes more jumps thread, and so on).
+	//
+
+	for (int nPass = 0; nPass < Max_Passes; nPass++)
+	{
+		bool fChanged = false;
+
+		MarkTargets ();
+		fChanged |= FoldConstants ();
+		MarkTargets ();
+		fChanged |= ThreadJumps ();
+		fChanged |= RemoveDeadCode ();
+		MarkTargets ();
+		fChanged |= CoalesceStackOps ();
+		if (m_fFuseTailCalls)
+		{
+			MarkTargets ();
+			fChanged |= FuseTailCalls ();
+			fChanged |= RemoveDeadCode ();
+		}
+
+		if (!fChanged)
+			break;
+	}
+
+	//
+	// Lay out and write the new image.  The new image is never larger than
+	// the original, so it is staged in a temporary buffer and then copied
+	// over the original.
+	//
+
+	std::vector <unsigned char> auchOut (nCodeSize);
+	size_t nNewSize = Emit (pauchCode, &auchOut [0]);
+	memcpy (pauchCode, &auchOut [0], nNewSize);
+
+	m_nNewSize = nNewSize;
+	m_fRelocated = true;
+	*pnNewCodeSize = nNewSize;
+
+	m_sStats .nBytesAfter = nNewSize;
+	for (size_t i = 0; i < m_asInstructions .size (); i++)
+	{
+		if (!m_asInstructions [i] .fDeleted)
+			m_sStats .nInstructionsAfter++;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Map an offset in the original image to the optimized image
+//
+// @parm size_t | nOffset | Offset in the original image
+//
+// @rdesc Offset in the optimized image.  Offsets of deleted instructions
+//		map to the next instruction that survived.  Offsets that were not
+//		within the code (i.e. 0xffffffff markers) are returned unchanged.
+//
+//-----------------------------------------------------------------------------
+
+size_t CNscOptimizer::MapOffset (size_t nOffset) const
+{
+	if (!m_fRelocated || nOffset < Header_Size || nOffset > m_nOriginalSize)
+		return nOffset;
+	if (nOffset == m_nOriginalSize)
+		return m_nNewSize;
+
+	size_t nLow = 0;
+	size_t nHigh = m_asInstructions .size ();
+	while (nLow < nHigh)
+	{
+		size_t nMid = (nLow + nHigh) / 2;
+		if (m_asInstructions [nMid] .nOffset < nOffset)
+			nLow = nMid + 1;
+		else
+			nHigh = nMid;
+	}
+	if (nLow >= m_asInstructions .size ())
+		return m_nNewSize;
+	return m_asInstructions [nLow] .nNewOffset;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Measure the unreachable code in an NCS image
+//
+// @parm const unsigned char * | pauchCode | Image to examine
+//
+// @parm size_t | nCodeSize | Size of the image, including the header
+//
+// @parm size_t * | pnInstructions | Receives the number of unreachable
+//		instructions
+//
+// @parm size_t * | pnBytes | Receives the size of the unreachable code
+//
+// @rdesc TRUE if the image could be decoded.
+//
+// @comm The image is not modified and no other transformation is applied,
+//		so this may be used on scripts from any compiler.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::FindUnreachableCode (const unsigned char *pauchCode, 
+	size_t nCodeSize, size_t *pnInstructions, size_t *pnBytes)
+{
+	m_fRelocated = false;
+	memset (&m_sStats, 0, sizeof (m_sStats));
+	*pnInstructions = 0;
+	*pnBytes = 0;
+
+	if (!Decode (pauchCode, nCodeSize))
+	{
+		m_asInstructions .clear ();
+		return false;
+	}
+
+	RemoveDeadCode ();
+	for (size_t i = 0; i < m_asInstructions .size (); i++)
+	{
+		if (m_asInstructions [i] .fDeleted)
+		{
+			(*pnInstructions)++;
+			*pnBytes += m_asInstructions [i] .nLength;
+		}
+	}
+	m_asInstructions .clear ();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Decode the instruction stream
+//
+// @parm const unsigned char * | pauchCode | Image to decode
+//
+// @parm size_t | nCodeSize | Size of the image
+//
+// @rdesc TRUE if the image was decoded.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::Decode (const unsigned char *pauchCode, size_t nCodeSize)
+{
+	m_asInstructions .clear ();
+	m_nLoaderEnd = Invalid_Index;
+
+	if (nCodeSize <= Header_Size || pauchCode [8] != NscCode_Size)
+		return false;
+
+	//
+	// Split the image into instructions
+	//
+
+	size_t nOffset = Header_Size;
+	while (nOffset < nCodeSize)
+	{
+		const unsigned char *p = &pauchCode [nOffset];
+		size_t nRemaining = nCodeSize - nOffset;
+		Instruction sInst;
+
+		if (nRemaining < 2)
+			return false;
+
+		sInst .nOffset = nOffset;
+		sInst .nLength = 0;
+		sInst .nNewOffset = nOffset;
+		sInst .nTarget = Invalid_Index;
+		sInst .lOperand = 0;
+		sInst .ucOp = p [0];
+		sInst .ucType = p [1];
+		sInst .fDeleted = false;
+		sInst .fRewritten = false;
+		sInst .fPinned = false;
+		sInst .fReachable = false;
+		sInst .fTarget = false;
+		sInst .fSubroutine = false;
+
+		switch (sInst .ucOp)
+		{
+
+			case NscCode_CPDOWNSP:
+			case NscCode_CPDOWNBP:
+			case NscCode_DESTRUCT:
+				sInst .nLength = 8;
+				break;
+
+			case NscCode_CPTOPSP:
+			case NscCode_CPTOPBP:
+				sInst .nLength = 8;
+				if (nRemaining >= 8)
+					sInst .lOperand = CNwnByteOrder<INT16>::BigEndian (&p [6]);
+				break;
+
+			case NscCode_CONST:
+				if (sInst .ucType == 5)
+				{
+					if (nRemaining < 4)
+						return false;
+					sInst .nLength = 4 + CNwnByteOrder<UINT16>::BigEndian (&p [2]);
+				}
+				else if (sInst .ucType == 3 || sInst .ucType == 4 ||
+					sInst .ucType == 6)
+				{
+					sInst .nLength = 6;
+					if (nRemaining >= 6)
+						sInst .lOperand = CNwnByteOrder<INT32>::BigEndian (&p [2]);
+				}
+				else
+					return false;
+				break;
+
+			case NscCode_ACTION:
+				sInst .nLength = 5;
+				break;
+
+			case NscCode_LOGAND:
+			case NscCode_LOGOR:
+			case NscCode_INCOR:
+			case NscCode_EXCOR:
+			case NscCode_BOOLAND:
+			case NscCode_EQUAL:
+			case NscCode_NEQUAL:
+			case NscCode_GEQ:
+			case NscCode_GT:
+			case NscCode_LT:
+			case NscCode_LEQ:
+			case NscCode_SHLEFT:
+			case NscCode_SHRIGHT:
+			case NscCode_USHRIGHT:
+			case NscCode_ADD:
+			case NscCode_SUB:
+			case NscCode_MUL:
+			case NscCode_DIV:
+			case NscCode_MOD:
+				sInst .nLength = sInst .ucType == 0x24 ? 4 : 2;
+				break;
+
+			case NscCode_RSADD:
+			case NscCode_NEG:
+			case NscCode_COMP:
+			case NscCode_NOT:
+			case NscCode_RETN:
+			case NscCode_SAVEBP:
+			case NscCode_RESTOREBP:
+			case NscCode_NOP:
+			case NscCode_STORE_STATEALL:
+				sInst .nLength = 2;
+				break;
+
+			case NscCode_MOVSP:
+			case NscCode_JMP:
+			case NscCode_JSR:
+			case NscCode_JZ:
+			case NscCode_JNZ:
+			case NscCode_DECISP:
+			case NscCode_INCISP:
+			case NscCode_DECIBP:
+			case NscCode_INCIBP:
+				sInst .nLength = 6;
+				if (nRemaining >= 6)
+					sInst .lOperand = CNwnByteOrder<INT32>::BigEndian (&p [2]);
+				break;
+
+			case NscCode_STORE_STATE:
+				sInst .nLength = 10;
+				break;
+
+			default:
+				return false;
+		}
+
+		if (sInst .nLength > nRemaining)
+			return false;
+
+		m_asInstructions .push_back (sInst);
+		nOffset += sInst .nLength;
+	}
+
+	//
+	// Resolve all branch targets to instruction indices.  A branch into the
+	// middle of an instruction means that we do not understand this image.
+	//
+
+	for (size_t i = 0; i < m_asInstructions .size (); i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		switch (sInst .ucOp)
+		{
+
+			case NscCode_JMP:
+			case NscCode_JSR:
+			case NscCode_JZ:
+			case NscCode_JNZ:
+				{
+					size_t nTargetOffset = (size_t) ((ptrdiff_t) sInst .nOffset +
+						sInst .lOperand);
+					size_t nTarget = FindInstruction (nTargetOffset);
+					if (nTarget == Invalid_Index)
+						return false;
+					sInst .nTarget = nTarget;
+					if (sInst .ucOp == NscCode_JSR)
+						m_asInstructions [nTarget] .fSubroutine = true;
+				}
+				break;
+
+			case NscCode_STORE_STATE:
+
+				//
+				// STORE_STATE resumes at a fixed displacement past itself,
+				// which is always the instruction after the JMP that skips
+				// the deferred action.  That JMP must stay put.
+				//
+
+				if (i + 2 >= m_asInstructions .size () ||
+					m_asInstructions [i + 1] .ucOp != NscCode_JMP ||
+					m_asInstructions [i + 2] .nOffset !=
+					sInst .nOffset + StoreState_Resume)
+					return false;
+				m_asInstructions [i + 1] .fPinned = true;
+				break;
+
+			case NscCode_RETN:
+				if (m_nLoaderEnd == Invalid_Index)
+					m_nLoaderEnd = i;
+				break;
+		}
+	}
+
+	//
+	// The #loader pattern is recognized by the script analyzer, so it is
+	// never touched.
+	//
+
+	if (m_nLoaderEnd == Invalid_Index)
+		return false;
+	for (size_t i = 0; i <= m_nLoaderEnd; i++)
+		m_asInstructions [i] .fPinned = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Find an instruction by offset
+//
+// @parm size_t | nOffset | Offset of the instruction
+//
+// @rdesc Index of the instruction or Invalid_Index if no instruction
+//		starts at the given offset.
+//
+//-----------------------------------------------------------------------------
+
+size_t CNscOptimizer::FindInstruction (size_t nOffset) const
+{
+	size_t nLow = 0;
+	size_t nHigh = m_asInstructions .size ();
+	while (nLow < nHigh)
+	{
+		size_t nMid = (nLow + nHigh) / 2;
+		size_t nMidOffset = m_asInstructions [nMid] .nOffset;
+		if (nMidOffset == nOffset)
+			return nMid;
+		else if (nMidOffset < nOffset)
+			nLow = nMid + 1;
+		else
+			nHigh = nMid;
+	}
+	return Invalid_Index;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Skip deleted instructions
+//
+// @parm size_t | nIndex | Starting index
+//
+// @rdesc Index of the first live instruction at or after the given index.
+//		If there is none, the instruction count is returned.
+//
+//-----------------------------------------------------------------------------
+
+size_t CNscOptimizer::NextLive (size_t nIndex) const
+{
+	while (nIndex < m_asInstructions .size () &&
+		m_asInstructions [nIndex] .fDeleted)
+		nIndex++;
+	return nIndex;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Recompute which instructions are branch targets
+//
+// @rdesc None.
+//
+//-----------------------------------------------------------------------------
+
+void CNscOptimizer::MarkTargets ()
+{
+	size_t nCount = m_asInstructions .size ();
+
+	for (size_t i = 0; i < nCount; i++)
+		m_asInstructions [i] .fTarget = false;
+	m_asInstructions [0] .fTarget = true;
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		const Instruction &sInst = m_asInstructions [i];
+		size_t nTarget;
+
+		if (sInst .fDeleted)
+			continue;
+		if (sInst .nTarget != Invalid_Index)
+			nTarget = NextLive (sInst .nTarget);
+		else if (sInst .ucOp == NscCode_STORE_STATE)
+			nTarget = NextLive (i + 2);
+		else
+			continue;
+		if (nTarget < nCount)
+			m_asInstructions [nTarget] .fTarget = true;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Thread jumps whose destination is another jump
+//
+// @rdesc TRUE if anything changed.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::ThreadJumps ()
+{
+	size_t nCount = m_asInstructions .size ();
+	bool fChanged = false;
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		if (sInst .fDeleted)
+			continue;
+		if (sInst .ucOp != NscCode_JMP &&
+			sInst .ucOp != NscCode_JZ &&
+			sInst .ucOp != NscCode_JNZ)
+			continue;
+
+		//
+		// Follow the chain of unconditional jumps.  The step count guards
+		// against a loop made only of jumps.
+		//
+
+		size_t nFirst = NextLive (sInst .nTarget);
+		size_t nFinal = nFirst;
+		size_t nSteps = 0;
+		while (nFinal < nCount &&
+			m_asInstructions [nFinal] .ucOp == NscCode_JMP &&
+			nSteps++ < nCount)
+		{
+			size_t nNext = NextLive (m_asInstructions [nFinal] .nTarget);
+			if (nNext == nFinal)
+				break;
+			nFinal = nNext;
+		}
+		if (nFinal >= nCount)
+			continue;
+		if (nFinal != nFirst)
+		{
+			sInst .nTarget = nFinal;
+			m_sStats .nJumpsThreaded++;
+			fChanged = true;
+		}
+
+		//
+		// A branch to the next instruction does nothing but consume the
+		// condition (if any)
+		//
+
+		if (sInst .fPinned || nFinal != NextLive (i + 1))
+			continue;
+		if (sInst .ucOp == NscCode_JMP)
+			Delete (i);
+		else
+		{
+			sInst .ucOp = NscCode_MOVSP;
+			sInst .ucType = 0;
+			sInst .lOperand = -4;
+			sInst .nTarget = Invalid_Index;
+			sInst .fRewritten = true;
+		}
+		m_sStats .nJumpsThreaded++;
+		fChanged = true;
+	}
+	return fChanged;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Remove instructions that can never execute
+//
+// @rdesc TRUE if anything changed.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::RemoveDeadCode ()
+{
+	size_t nCount = m_asInstructions .size ();
+	std::vector <size_t> anWork;
+	bool fChanged = false;
+
+	for (size_t i = 0; i < nCount; i++)
+		m_asInstructions [i] .fReachable = false;
+
+	//
+	// Walk the control flow graph from the #loader.  Subroutines are only
+	// reachable through a JSR from live code, so this also discovers the
+	// dead subroutines.
+	//
+
+	anWork .push_back (0);
+	while (!anWork .empty ())
+	{
+		size_t i = NextLive (anWork .back ());
+		anWork .pop_back ();
+
+		if (i >= nCount || m_asInstructions [i] .fReachable)
+			continue;
+
+		Instruction &sInst = m_asInstructions [i];
+		sInst .fReachable = true;
+
+		switch (sInst .ucOp)
+		{
+
+			case NscCode_JMP:
+				anWork .push_back (sInst .nTarget);
+				break;
+
+			case NscCode_JZ:
+			case NscCode_JNZ:
+			case NscCode_JSR:
+				anWork .push_back (sInst .nTarget);
+				anWork .push_back (i + 1);
+				break;
+
+			case NscCode_STORE_STATE:
+				anWork .push_back (i + 2);
+				anWork .push_back (i + 1);
+				break;
+
+			case NscCode_RETN:
+				break;
+
+			default:
+				anWork .push_back (i + 1);
+				break;
+		}
+	}
+
+	//
+	// Delete everything we could not reach
+	//
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		if (sInst .fDeleted || sInst .fReachable)
+			continue;
+		if (sInst .fSubroutine)
+			m_sStats .nDeadSubroutines++;
+		Delete (i);
+		m_sStats .nDeadInstructions++;
+		fChanged = true;
+	}
+	return fChanged;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Coalesce pushes that are immediately discarded and adjacent
+//		stack adjustments
+//
+// @rdesc TRUE if anything changed.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::CoalesceStackOps ()
+{
+	size_t nCount = m_asInstructions .size ();
+	bool fChanged = false;
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		if (sInst .fDeleted || sInst .fPinned)
+			continue;
+
+		//
+		// The second instruction must only be reachable by falling through
+		// from the first, or we would change the other paths.
+		//
+
+		size_t j = NextLive (i + 1);
+		if (j >= nCount)
+			continue;
+		Instruction &sNext = m_asInstructions [j];
+		if (sNext .ucOp != NscCode_MOVSP || sNext .fTarget || sNext .fPinned)
+			continue;
+
+		//
+		// MOVSP a; MOVSP b -> MOVSP a+b
+		//
+
+		if (sInst .ucOp == NscCode_MOVSP)
+		{
+			sInst .lOperand += sNext .lOperand;
+			sInst .fRewritten = true;
+			Delete (j);
+			if (sInst .lOperand == 0)
+				Delete (i);
+			m_sStats .nStackOpsCoalesced++;
+			fChanged = true;
+			continue;
+		}
+
+		//
+		// push n; MOVSP -m (m >= n) -> MOVSP -(m - n).  The push may be a
+		// branch target; arriving there and doing the smaller MOVSP has the
+		// same effect as doing the push and the full MOVSP.
+		//
+
+		int nPush = GetPushSize (sInst);
+		if (nPush <= 0 || nPush > -sNext .lOperand)
+			continue;
+		Delete (i);
+		sNext .lOperand += nPush;
+		sNext .fRewritten = true;
+		if (sNext .lOperand == 0)
+			Delete (j);
+		m_sStats .nStackOpsCoalesced++;
+		fChanged = true;
+	}
+	return fChanged;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Fold integer constant expressions and constant branches
+//
+// @rdesc TRUE if anything changed.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::FoldConstants ()
+{
+	size_t nCount = m_asInstructions .size ();
+	bool fChanged = false;
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		if (sInst .fDeleted || sInst .fPinned)
+			continue;
+		if (sInst .ucOp != NscCode_CONST || sInst .ucType != 3)
+			continue;
+
+		size_t j = NextLive (i + 1);
+		if (j >= nCount)
+			continue;
+		Instruction &sNext = m_asInstructions [j];
+		if (sNext .fTarget || sNext .fPinned)
+			continue;
+
+		INT32 lResult;
+
+		//
+		// CONSTI a; op -> CONSTI (op a)
+		//
+
+		if (sNext .ucType == 3 && EvaluateUnary (sNext .ucOp,
+			sInst .lOperand, &lResult))
+		{
+			sInst .lOperand = lResult;
+			sInst .fRewritten = true;
+			Delete (j);
+			m_sStats .nConstantsFolded++;
+			fChanged = true;
+		}
+
+		//
+		// CONSTI a; JZ/JNZ -> JMP or nothing
+		//
+
+		else if (sNext .ucOp == NscCode_JZ || sNext .ucOp == NscCode_JNZ)
+		{
+			bool fTaken = (sNext .ucOp == NscCode_JZ) ?
+				sInst .lOperand == 0 : sInst .lOperand != 0;
+			Delete (i);
+			if (fTaken)
+				sNext .ucOp = NscCode_JMP;
+			else
+				Delete (j);
+			m_sStats .nConstantsFolded++;
+			fChanged = true;
+		}
+
+		//
+		// CONSTI a; CONSTI b; op -> CONSTI (a op b)
+		//
+
+		else if (sNext .ucOp == NscCode_CONST && sNext .ucType == 3)
+		{
+			size_t k = NextLive (j + 1);
+			if (k >= nCount)
+				continue;
+			Instruction &sOp = m_asInstructions [k];
+			if (sOp .fTarget || sOp .fPinned || sOp .ucType != 0x20)
+				continue;
+			if (!EvaluateBinary (sOp .ucOp, sInst .lOperand,
+				sNext .lOperand, &lResult))
+				continue;
+			sInst .lOperand = lResult;
+			sInst .fRewritten = true;
+			Delete (j);
+			Delete (k);
+			m_sStats .nConstantsFolded++;
+			fChanged = true;
+		}
+	}
+	return fChanged;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Turn JSR f; RETN into JMP f
+//
+// @rdesc TRUE if anything changed.
+//
+// @comm The return stack is separate from the data stack, so the callee's
+//		RETN returns directly to our caller.  The #loader is pinned since
+//		the analyzer requires its JSR.
+//
+//		The fused JMP enters another subroutine.  The script analyzer (and
+//		the JIT built on its IR) bounds each subroutine's control flow and
+//		derives its parameter size at its own RETN, and has not been
+//		verified against such code, so the pass only runs when explicitly
+//		enabled.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::FuseTailCalls ()
+{
+	size_t nCount = m_asInstructions .size ();
+	bool fChanged = false;
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+
+		if (sInst .fDeleted || sInst .fPinned ||
+			sInst .ucOp != NscCode_JSR)
+			continue;
+
+		size_t j = NextLive (i + 1);
+		if (j >= nCount || m_asInstructions [j] .ucOp != NscCode_RETN)
+			continue;
+
+		//
+		// The RETN stays if something else branches to it
+		//
+
+		sInst .ucOp = NscCode_JMP;
+		if (!m_asInstructions [j] .fTarget)
+			Delete (j);
+		m_sStats .nTailCallsFused++;
+		fChanged = true;
+	}
+	return fChanged;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Lay out and write the new image
+//
+// @parm const unsigned char * | pauchOriginal | Original image
+//
+// @parm unsigned char * | pauchOut | Destination buffer (at least as large
+//		as the original image)
+//
+// @rdesc Size of the new image.
+//
+//-----------------------------------------------------------------------------
+
+size_t CNscOptimizer::Emit (const unsigned char *pauchOriginal,
+	unsigned char *pauchOut)
+{
+	size_t nCount = m_asInstructions .size ();
+
+	//
+	// Assign the new offsets.  Deleted instructions take the offset of the
+	// next surviving instruction, which is also where branches to them
+	// must go.
+	//
+
+	size_t nOffset = Header_Size;
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Instruction &sInst = m_asInstructions [i];
+		sInst .nNewOffset = nOffset;
+		if (!sInst .fDeleted)
+			nOffset += sInst .nLength;
+	}
+
+	//
+	// Write the header with the new size
+	//
+
+	memcpy (pauchOut, pauchOriginal, Header_Size);
+	CNwnByteOrder<INT32>::BigEndian ((INT32) nOffset, &pauchOut [9]);
+
+	//
+	// Write the instructions
+	//
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		const Instruction &sInst = m_asInstructions [i];
+		unsigned char *p = &pauchOut [sInst .nNewOffset];
+
+		if (sInst .fDeleted)
+			continue;
+
+		if (sInst .nTarget != Invalid_Index)
+		{
+			size_t nTarget = NextLive (sInst .nTarget);
+			size_t nTargetOffset = nTarget < nCount ?
+				m_asInstructions [nTarget] .nNewOffset : nOffset;
+			p [0] = sInst .ucOp;
+			p [1] = 0;
+			CNwnByteOrder<INT32>::BigEndian ((INT32) (nTargetOffset -
+				sInst .nNewOffset), &p [2]);
+		}
+		else if (sInst .fRewritten)
+		{
+			p [0] = sInst .ucOp;
+			p [1] = sInst .ucType;
+			CNwnByteOrder<INT32>::BigEndian (sInst .lOperand, &p [2]);
+		}
+		else
+			memcpy (p, &pauchOriginal [sInst .nOffset], sInst .nLength);
+	}
+	return nOffset;
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Get the number of bytes pushed by a side effect free push
+//
+// @parm const Instruction & | sInstruction | Instruction to test
+//
+// @rdesc Bytes pushed, or zero if the instruction is not a pure push.
+//
+//-----------------------------------------------------------------------------
+
+int CNscOptimizer::GetPushSize (const Instruction &sInstruction)
+{
+	switch (sInstruction .ucOp)
+	{
+		case NscCode_CPTOPSP:
+		case NscCode_CPTOPBP:
+			return sInstruction .lOperand;
+
+		case NscCode_CONST:
+		case NscCode_RSADD:
+			return 4;
+
+		default:
+			return 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Evaluate an integer binary operator the way the VM does
+//
+// @parm unsigned char | ucOp | Operator
+//
+// @parm INT32 | lLhs | Left operand
+//
+// @parm INT32 | lRhs | Right operand
+//
+// @parm INT32 * | plResult | Receives the result
+//
+// @rdesc TRUE if the operator was folded.  Operators that can fault at
+//		run time are left alone so that the fault still happens.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::EvaluateBinary (unsigned char ucOp, INT32 lLhs,
+	INT32 lRhs, INT32 *plResult)
+{
+	switch (ucOp)
+	{
+		case NscCode_LOGAND:
+			*plResult = (lLhs && lRhs) ? 1 : 0;
+			return true;
+
+		case NscCode_LOGOR:
+			*plResult = (lLhs || lRhs) ? 1 : 0;
+			return true;
+
+		case NscCode_INCOR:
+			*plResult = lLhs | lRhs;
+			return true;
+
+		case NscCode_EXCOR:
+			*plResult = lLhs ^ lRhs;
+			return true;
+
+		case NscCode_BOOLAND:
+			*plResult = lLhs & lRhs;
+			return true;
+
+		case NscCode_EQUAL:
+			*plResult = lLhs == lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_NEQUAL:
+			*plResult = lLhs != lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_GEQ:
+			*plResult = lLhs >= lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_GT:
+			*plResult = lLhs > lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_LT:
+			*plResult = lLhs < lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_LEQ:
+			*plResult = lLhs <= lRhs ? 1 : 0;
+			return true;
+
+		case NscCode_ADD:
+			*plResult = (INT32) ((UINT32) lLhs + (UINT32) lRhs);
+			return true;
+
+		case NscCode_SUB:
+			*plResult = (INT32) ((UINT32) lLhs - (UINT32) lRhs);
+			return true;
+
+		case NscCode_MUL:
+			*plResult = (INT32) ((UINT32) lLhs * (UINT32) lRhs);
+			return true;
+
+		case NscCode_DIV:
+			if (lRhs == 0 || (lLhs == INT_MIN && lRhs == -1))
+				return false;
+			*plResult = lLhs / lRhs;
+			return true;
+
+		case NscCode_MOD:
+			if (lRhs == 0 || (lLhs == INT_MIN && lRhs == -1))
+				return false;
+			*plResult = lLhs % lRhs;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//
+// @mfunc Evaluate an integer unary operator the way the VM does
+//
+// @parm unsigned char | ucOp | Operator
+//
+// @parm INT32 | lValue | Operand
+//
+// @parm INT32 * | plResult | Receives the result
+//
+// @rdesc TRUE if the operator was folded.
+//
+//-----------------------------------------------------------------------------
+
+bool CNscOptimizer::EvaluateUnary (unsigned char ucOp, INT32 lValue,
+	INT32 *plResult)
+{
+	switch (ucOp)
+	{
+		case NscCode_NEG:
+			*plResult = (INT32) (0 - (UINT32) lValue);
+			return true;
+
+		case NscCode_COMP:
+			*plResult = ~lValue;
+			return true;
+
+		case NscCode_NOT:
+			*plResult = !lValue ? 1 : 0;
+			return true;
+
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,264 @@
+#ifndef ETS_NSCOPTIMIZER_H
+#define ETS_NSCOPTIMIZER_H
+
+//-----------------------------------------------------------------------------
+//
+// @doc
+//
+// @module	NscOptimizer.h - Post-generation NCS optimizer |
+//
+// This module contains the definition of the NCS optimizer.  The optimizer
+// runs over the finished instruction stream produced by the code generator,
+// builds a control flow graph from it, and applies transformations that the
+// single pass code generator cannot see (jump threading, unreachable code
+// and subroutine removal, stack copy coalescing, constant folding and
+// JSR/RETN fusion).  All instruction offsets are tracked so that the debug
+// symbol file can be relocated to the optimized layout.
+//
+// Copyright (c) 2008-2011 - Ken Johnson (Skywing)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Neither the name of Edward T. Smith nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @end
+//
+// $History: NscOptimizer.h $
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Required include files
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Forward definitions
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Class definition
+//
+//-----------------------------------------------------------------------------
+
+class CNscOptimizer
+{
+public:
+
+	struct Statistics
+	{
+		size_t	nInstructionsBefore;
+		size_t	nInstructionsAfter;
+		size_t	nBytesBefore;
+		size_t	nBytesAfter;
+		size_t	nJumpsThreaded;
+		size_t	nDeadInstructions;
+		size_t	nDeadSubroutines;
+		size_t	nStackOpsCoalesced;
+		size_t	nConstantsFolded;
+		size_t	nTailCallsFused;
+	};
+
+private:
+
+	enum Constants
+	{
+		Header_Size			= 8 + 5,	// "NCS V1.0" followed by T <size>
+		StoreState_Resume	= 16,		// STORE_STATE resumes past its JMP
+		Max_Passes			= 16,
+	};
+
+	static const size_t Invalid_Index = (size_t) -1;
+
+	struct Instruction
+	{
+		size_t			nOffset;
+		size_t			nLength;
+		size_t			nNewOffset;
+		size_t			nTarget;
+		INT32			lOperand;
+		unsigned char	ucOp;
+		unsigned char	ucType;
+		bool			fDeleted;
+		bool			fRewritten;
+		bool			fPinned;
+		bool			fReachable;
+		bool			fTarget;
+		bool			fSubroutine;
+	};
+
+	typedef std::vector <Instruction> InstructionVec;
+
+// @access Constructors and destructors
+public:
+
+	// @cmember General constructor
+
+	CNscOptimizer ();
+
+	// @cmember Delete the optimizer
+
+	~CNscOptimizer ();
+
+// @access Public methods
+public:
+
+	// @cmember Optimize a complete NCS image in place
+
+	bool Optimize (unsigned char *pauchCode, size_t nCodeSize,
+		size_t *pnNewCodeSize);
+
+	// @cmember Map an offset in the original image to the optimized image
+
+	size_t MapOffset (size_t nOffset) const;
+
+	// @cmember Measure the unreachable code in an NCS image
+
+	bool FindUnreachableCode (const unsigned char *pauchCode, 
+		size_t nCodeSize, size_t *pnInstructions, size_t *pnBytes);
+
+// @access Public inline methods
+public:
+
+	// @cmember Get the statistics of the last optimization
+
+	const Statistics &GetStatistics () const
+	{
+		return m_sStats;
+	}
+
+	// @cmember Return TRUE if the last optimization changed the layout
+
+	bool IsRelocated () const
+	{
+		return m_fRelocated;
+	}
+
+	// @cmember Set whether JSR/RETN pairs may be fused (off by default)
+
+	void SetFuseTailCalls (bool fFuseTailCalls)
+	{
+		m_fFuseTailCalls = fFuseTailCalls;
+	}
+
+// @access Protected methods
+protected:
+
+	// @cmember Decode the instruction stream
+
+	bool Decode (const unsigned char *pauchCode, size_t nCodeSize);
+
+	// @cmember Find an instruction index by offset
+
+	size_t FindInstruction (size_t nOffset) const;
+
+	// @cmember Skip deleted instructions
+
+	size_t NextLive (size_t nIndex) const;
+
+	// @cmember Recompute the jump target markers
+
+	void MarkTargets ();
+
+	// @cmember Thread jumps to jumps
+
+	bool ThreadJumps ();
+
+	// @cmember Remove unreachable code
+
+	bool RemoveDeadCode ();
+
+	// @cmember Coalesce redundant stack copies
+
+	bool CoalesceStackOps ();
+
+	// @cmember Fold constant expressions
+
+	bool FoldConstants ();
+
+	// @cmember Fuse JSR/RETN pairs
+
+	bool FuseTailCalls ();
+
+	// @cmember Emit the new instruction stream
+
+	size_t Emit (const unsigned char *pauchOriginal, unsigned char *pauchOut);
+
+	// @cmember Delete an instruction
+
+	void Delete (size_t nIndex)
+	{
+		m_asInstructions [nIndex] .fDeleted = true;
+	}
+
+	// @cmember Get the number of bytes pushed by a side effect free push
+
+	static int GetPushSize (const Instruction &sInstruction);
+
+	// @cmember Evaluate an integer binary operator
+
+	static bool EvaluateBinary (unsigned char ucOp, INT32 lLhs, INT32 lRhs,
+		INT32 *plResult);
+
+	// @cmember Evaluate an integer unary operator
+
+	static bool EvaluateUnary (unsigned char ucOp, INT32 lValue,
+		INT32 *plResult);
+
+// @cmember Protected members
+protected:
+
+	// @cmember Decoded instruction list
+
+	InstructionVec			m_asInstructions;
+
+	// @cmember Size of the original image
+
+	size_t					m_nOriginalSize;
+
+	// @cmember Size of the optimized image
+
+	size_t					m_nNewSize;
+
+	// @cmember Index of the last #loader instruction
+
+	size_t					m_nLoaderEnd;
+
+	// @cmember If true, the layout of the image changed
+
+	bool					m_fRelocated;
+
+	// @cmember If true, run the JSR/RETN fusion pass
+
+	bool					m_fFuseTailCalls;
+
+	// @cmember Statistics of the last optimization
+
+	Statistics				m_sStats;
+};
+
+#endif // ETS_NSCOPTIMIZER_H
@@ -48,19 +48,17 @@
 // Externals
 //
 
-extern CNscContext *g_pCtx;
-
 //
-// Prototypes
+// The parser routines operate on the context of the compile running on the
+// current thread
 //
 
+#define g_pCtx (NscGetCurrentContext ())
+
 //
-// Global type save... this stinks, I need to fix it
+// Prototypes
 //
 
-CNscPStackEntry *g_pNscDeclType;
-size_t g_nNscLastDeclSymbol = 0xFFFFFFFF;
-
 //-----------------------------------------------------------------------------
 //
 // Class definition
@@ -133,7 +131,7 @@ public:
 
 void NscParserReferenceSymbol (NscSymbol *pSymbol)
 {
-	pSymbol ->ulFlags |= NscSymFlag_ParserReferenced;
+	g_pCtx ->SetSymbolFlags (pSymbol, NscSymFlag_ParserReferenced);
 }
 
 //-----------------------------------------------------------------------------
@@ -851,7 +849,7 @@ YYSTYPE NscBuildType (int nType, YYSTYPE pId)
 	// Return results
 	//
 
-	g_pNscDeclType = pOut;
+	g_pCtx ->SetDeclType (pOut);
 	return pOut;
 }
 
@@ -1038,24 +1036,24 @@ YYSTYPE NscBuildBeginDeclaration (YYSTYPE pId)
 			// that we couldn't handle in the BuildType routine
 			// 
 
-			if (g_pNscDeclType ->GetType () == NscType_Unknown)
+			if (g_pCtx ->GetDeclType () ->GetType () == NscType_Unknown)
 			{
 				NscSymbol *pSymbol = g_pCtx ->FindStructTagSymbol (
-					g_pNscDeclType ->GetIdentifier ());
+					g_pCtx ->GetDeclType () ->GetIdentifier ());
 				if (pSymbol == NULL)
 				{
 					g_pCtx ->GenerateMessage (NscMessage_ErrorStructureUndefined,
-						g_pNscDeclType ->GetIdentifier ());
+						g_pCtx ->GetDeclType () ->GetIdentifier ());
 				}
 				else if (pSymbol ->nSymType != NscSymType_Structure)
 				{
 					g_pCtx ->GenerateMessage (
 						NscMessage_ErrorIdentifierNotStructure,
-						g_pNscDeclType ->GetIdentifier ());
+						g_pCtx ->GetDeclType () ->GetIdentifier ());
 				}
 				else
 				{
-					g_pNscDeclType ->SetType (pSymbol ->nType);
+					g_pCtx ->GetDeclType () ->SetType (pSymbol ->nType);
 				}
 			}
 
@@ -1072,7 +1070,7 @@ YYSTYPE NscBuildBeginDeclaration (YYSTYPE pId)
 			else
 			{
 				g_pCtx ->AddVariable (pId ->GetIdentifier (), 
-					g_pNscDeclType ->GetType (), g_pNscDeclType ->GetFlags ());
+					g_pCtx ->GetDeclType () ->GetType (), g_pCtx ->GetDeclType () ->GetFlags ());
 			}
 		}
 
@@ -1104,18 +1102,18 @@ YYSTYPE NscBuildBeginDeclaration (YYSTYPE pId)
 			// Check for constant type
 			//
 
-			if ((g_pNscDeclType ->GetFlags () & NscSymFlag_Constant) != 0)
+			if ((g_pCtx ->GetDeclType () ->GetFlags () & NscSymFlag_Constant) != 0)
 			{
 				g_pCtx ->GenerateMessage (NscMessage_ErrorConstNotAllowedOnLocals,
 					pId ->GetIdentifier ());
 
-				g_pNscDeclType ->SetFlags (g_pNscDeclType ->GetFlags () &
+				g_pCtx ->GetDeclType () ->SetFlags (g_pCtx ->GetDeclType () ->GetFlags () &
 					~NscSymFlag_Constant);
 			}
 
 			g_pCtx ->AddVariable (pId ->GetIdentifier (), 
-				g_pNscDeclType ->GetType (), NscSymFlag_BeingDefined
-				| g_pNscDeclType ->GetFlags ());
+				g_pCtx ->GetDeclType () ->GetType (), NscSymFlag_BeingDefined
+				| g_pCtx ->GetDeclType () ->GetFlags ());
 		}
 	}
 	return pId;
@@ -1171,7 +1169,7 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 		NscSymbol *pSymbol = g_pCtx ->FindDeclSymbol (pId ->GetIdentifier ());
 		assert (pSymbol != NULL);
 		assert (pSymbol ->nSymType == NscSymType_Variable);
-		g_nNscLastDeclSymbol = g_pCtx ->GetSymbolOffset (pSymbol);
+		g_pCtx ->SetLastDeclSymbol (g_pCtx ->GetSymbolOffset (pSymbol));
 
 		//
 		// Clear the "begin defined" flag
@@ -1191,7 +1189,7 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 			// Add this symbol as a constant
 			//
 
-			g_pCtx ->AddGlobalFunction (g_nNscLastDeclSymbol);
+			g_pCtx ->AddGlobalFunction (g_pCtx ->GetLastDeclSymbol ());
 
 			//
 			// Simplify the constant
@@ -1217,11 +1215,11 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 
 					pOut = g_pCtx ->GetPStackEntry (__FILE__, __LINE__);
 
-					if (!NscPushDefaultValue (pOut, g_pNscDeclType ->GetType ()))
+					if (!NscPushDefaultValue (pOut, g_pCtx ->GetDeclType () ->GetType ()))
 					{
 						g_pCtx ->GenerateMessage (
 							NscMessage_ErrorDefaultInitNotPermitted,
-								g_pNscDeclType ->GetType (),
+								g_pCtx ->GetDeclType () ->GetType (),
 								pId ->GetIdentifier ());
 						fInError = true;
 					}
@@ -1267,7 +1265,7 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 			}
 
 			if (!fInError &&
-				g_pCtx ->IsStructure (g_pNscDeclType ->GetType ()))
+				g_pCtx ->IsStructure (g_pCtx ->GetDeclType () ->GetType ()))
 			{
 				g_pCtx ->GenerateMessage (
 					NscMessage_ErrorConstStructIllegal,
@@ -1288,7 +1286,7 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 			//
 
 			//NscPCodeHeader *ph = (NscPCodeHeader *) pauchInit;
-			if (nInitSize > 0 && nInitType != g_pNscDeclType ->GetType ())
+			if (nInitSize > 0 && nInitType != g_pCtx ->GetDeclType () ->GetType ())
 			{
 				g_pCtx ->GenerateMessage (NscMessage_ErrorDeclInitTypeMismatch,
 					pId ->GetIdentifier ());
@@ -1314,7 +1312,7 @@ YYSTYPE NscBuildEndDeclaration (YYSTYPE pId, YYSTYPE pInit)
 				if (pOut == NULL)
 					pOut = g_pCtx ->GetPStackEntry (__FILE__, __LINE__);
 				pOut ->PushDeclaration (pId ->GetIdentifier (), 
-					g_pNscDeclType ->GetType (), pauchInit, nInitSize, 
+					g_pCtx ->GetDeclType () ->GetType (), pauchInit, nInitSize, 
 					-1, -1, pSymbol ->ulFlags);
 			}
 		}
@@ -1422,10 +1420,10 @@ YYSTYPE NscBuildDeclaration (YYSTYPE pType, YYSTYPE pList)
 		g_pCtx ->IsGlobalScope () && 
 		(g_pCtx ->IsPhase2 () || g_pCtx ->IsNWScript ()))
 	{
-		assert (g_nNscLastDeclSymbol != 0xffffffff);
-		NscSymbol *pSymbol = g_pCtx ->GetSymbol (g_nNscLastDeclSymbol);
+		assert (g_pCtx ->GetLastDeclSymbol () != 0xffffffff);
+		NscSymbol *pSymbol = g_pCtx ->GetSymbol (g_pCtx ->GetLastDeclSymbol ());
 		pSymbol ->ulFlags |= NscSymFlag_LastDecl;
-		g_nNscLastDeclSymbol = 0xffffffff;
+		g_pCtx ->SetLastDeclSymbol (0xffffffff);
 	}
 
 	//
@@ -1852,7 +1850,7 @@ YYSTYPE NscBuildFunctionDeclarator (YYSTYPE pType, YYSTYPE pId, YYSTYPE pList)
 		// Try to locate this symbol to make sure definition matches implementation
 		//
 
-		pSymbol = g_pCtx ->FindDeclSymbol (pId ->GetIdentifier ());
+		pSymbol = g_pCtx ->FindDeclSymbolForUpdate (pId ->GetIdentifier ());
 		size_t nSymbol = 0;
 		if (pSymbol != NULL)
 		{
@@ -1926,7 +1924,7 @@ YYSTYPE NscBuildFunctionDeclarator (YYSTYPE pType, YYSTYPE pId, YYSTYPE pList)
 					//      in OpenKnights.
 					//
 
-					pSymbol = g_pCtx ->FindDeclSymbol (pId ->GetIdentifier ());
+					pSymbol = g_pCtx ->FindDeclSymbolForUpdate (pId ->GetIdentifier ());
 					pauchProtoData = g_pCtx ->GetSymbolData (nOffset);
 					p2 = (NscPCodeDeclaration *) pauchProtoData;
 					p2 ->nAltStringOffset = nAltString;
@@ -6037,8 +6035,6 @@ YYSTYPE NscBuildIdentifier (YYSTYPE pId)
 //
 //-----------------------------------------------------------------------------
 
-static int g_nFile;
-static int g_nLine;
 YYSTYPE NscBuildMarkLine (int nIndex, YYSTYPE pStatement)
 {
 	//
@@ -9,6 +9,22 @@
 //
 // This module contains the definition for the symbol table.
 //
+// Symbols are stored in a flat data buffer and addressed by offset.  An open
+// addressed (linear probing) index maps each 32 bit hash value to the most
+// recently added symbol with that hash; older symbols with the same hash are
+// reached through NscSymbol::nNext.  The index doubles in size as it fills.
+//
+// Every hashed add records the previous index entry in an undo log.  A fence
+// remembers the data size and the undo log length, so popping a scope costs
+// time proportional to the number of symbols added within the scope.
+//
+// A symbol table may be chained onto a read-only base table (typically the
+// parsed nwscript.nss table shared by all compiles).  Offsets below the size
+// of the base table resolve into the base table's data and offsets above it
+// resolve into the local data.  Hash values without a local index entry are
+// looked up in the base table's index, and new local entries continue the
+// base table's chains, so the base table is never copied.
+//
 // Copyright (c) 2002-2003 - Edward T. Smith
 //
 // All rights reserved.
@@ -69,11 +85,13 @@ public:
 	CNscSymbolTable (size_t nGrowSize = 0x40000)
 	{
 		m_pauchData = NULL;
+		m_pBase = NULL;
+		m_nBaseSize = 0;
 		m_nSize = 0;
 		m_nAllocated = 0;
 		m_nGrowSize = nGrowSize;
 		m_nGlobalIdentifierCount = 0;
-		memset (&m_sFence, 0, sizeof (m_sFence));
+		m_nHashUsed = 0;
 	}
 
 	// @cmember Delete the streams
@@ -91,7 +109,9 @@ public:
 
 	size_t GetSymbolOffset (NscSymbol *pSymbol)
 	{
-		return (size_t) ((unsigned char *) pSymbol - m_pauchData);
+		if (IsShared (pSymbol))
+			return (size_t) ((unsigned char *) pSymbol - m_pBase ->m_pauchData);
+		return m_nBaseSize + (size_t) ((unsigned char *) pSymbol - m_pauchData);
 	}
 
 	// @cmember Get a symbol from an offset
@@ -105,44 +125,164 @@ public:
 	
 	void CopyFrom (CNscSymbolTable *pTable)
 	{
-		m_nSize = 0;
-		MakeRoom (pTable ->m_nSize);
-		memcpy (m_pauchData, pTable ->m_pauchData, pTable ->m_nSize);
-		memcpy (&m_sFence, &pTable ->m_sFence, sizeof (m_sFence));
+		size_t nLocalSize = pTable ->m_nSize - pTable ->m_nBaseSize;
+		m_pBase = pTable ->m_pBase;
+		m_nBaseSize = pTable ->m_nBaseSize;
+		m_nSize = m_nBaseSize;
+		MakeRoom (nLocalSize);
+		if (nLocalSize > 0)
+			memcpy (m_pauchData, pTable ->m_pauchData, nLocalSize);
 		m_nSize = pTable ->m_nSize;
 		m_nGlobalIdentifierCount = pTable ->m_nGlobalIdentifierCount;
+		m_asHash = pTable ->m_asHash;
+		m_nHashUsed = pTable ->m_nHashUsed;
+		m_asUndo = pTable ->m_asUndo;
+		m_mapSharedFlags = pTable ->m_mapSharedFlags;
+	}
+
+	// @cmember Chain the symbol table onto a read-only base table
+
+	void SetBase (CNscSymbolTable *pBase)
+	{
+		assert (pBase ->m_pBase == NULL);
+		m_pBase = pBase;
+		m_nBaseSize = pBase ->m_nSize;
+		m_nSize = m_nBaseSize;
+		m_nGlobalIdentifierCount = pBase ->m_nGlobalIdentifierCount;
+		m_asHash .clear ();
+		m_nHashUsed = 0;
+		m_asUndo .clear ();
+		m_mapSharedFlags .clear ();
+	}
+
+	// @cmember Get the base table
+
+	CNscSymbolTable *GetBase ()
+	{
+		return m_pBase;
+	}
+
+	// @cmember Return true if the symbol lives in the base table
+
+	bool IsShared (NscSymbol *pSymbol)
+	{
+		unsigned char *puch = (unsigned char *) pSymbol;
+		return m_pBase != NULL && puch >= m_pBase ->m_pauchData &&
+			puch < m_pBase ->m_pauchData + m_nBaseSize;
+	}
+
+	// @cmember Set flags on a symbol (recorded locally for base symbols)
+
+	void SetSymbolFlags (NscSymbol *pSymbol, UINT32 ulFlags)
+	{
+		if (!IsShared (pSymbol))
+			pSymbol ->ulFlags |= ulFlags;
+		else if ((pSymbol ->ulFlags & ulFlags) != ulFlags)
+			m_mapSharedFlags [GetSymbolOffset (pSymbol)] |= ulFlags;
+	}
+
+	// @cmember Copy the base table into the local data so it may be modified
+
+	void Detach ()
+	{
+		if (m_pBase == NULL)
+			return;
+
+		//
+		// Offsets and fences do not change, only the storage does
+		//
+
+		size_t nLocalSize = m_nSize - m_nBaseSize;
+		size_t nAllocated = m_nBaseSize + m_nAllocated;
+		if (nAllocated < m_nSize)
+			nAllocated = m_nSize;
+		unsigned char *pauchNew = new unsigned char [nAllocated];
+		memcpy (pauchNew, m_pBase ->m_pauchData, m_nBaseSize);
+		if (nLocalSize > 0)
+			memcpy (&pauchNew [m_nBaseSize], m_pauchData, nLocalSize);
+		if (m_pauchData)
+			delete [] m_pauchData;
+		m_pauchData = pauchNew;
+		m_nAllocated = nAllocated;
+
+		//
+		// Pull in the index entries that were only present in the base
+		//
+
+		CNscSymbolTable *pBase = m_pBase;
+		m_pBase = NULL;
+		m_nBaseSize = 0;
+		for (size_t i = 0; i < pBase ->m_asHash .size (); i++)
+		{
+			const HashEntry &sEntry = pBase ->m_asHash [i];
+			if (sEntry .nHead != 0)
+			{
+				HashEntry *pEntry = FindHashEntry (sEntry .ulHash, true);
+				if (pEntry ->nHead == 0)
+					pEntry ->nHead = sEntry .nHead;
+			}
+		}
+
+		//
+		// Apply the flags that were set on base symbols
+		//
+
+		for (std::map <size_t, UINT32>::iterator it = m_mapSharedFlags .begin ();
+			it != m_mapSharedFlags .end (); ++it)
+		{
+			GetSymbol (it ->first) ->ulFlags |= it ->second;
+		}
+		m_mapSharedFlags .clear ();
 	}
 
 	// @cmember Reset the symbol table
 
 	void Reset ()
 	{
+		m_pBase = NULL;
+		m_nBaseSize = 0;
 		if (m_nSize > 0)
             m_nSize = 1;
-		memset (&m_sFence, 0, sizeof (m_sFence));
 		m_nGlobalIdentifierCount = 0;
+		m_asHash .clear ();
+		m_nHashUsed = 0;
+		m_asUndo .clear ();
+		m_mapSharedFlags .clear ();
 	}
 
 	// @cmember Get a pointer to symbol table data
 
 	unsigned char *GetData (size_t nOffset = 0)
 	{
-		return &m_pauchData [nOffset];
+		if (nOffset < m_nBaseSize)
+			return &m_pBase ->m_pauchData [nOffset];
+		return &m_pauchData [nOffset - m_nBaseSize];
 	}
 
 	// @cmember Get the current fence
 
 	void GetFence (NscSymbolFence *pFence)
 	{
-		memcpy (pFence, &m_sFence, sizeof (m_sFence));
 		pFence ->nSize = m_nSize;
+		pFence ->nUndo = m_asUndo .size ();
 	}
 
 	// @cmember Restore the given fence
 
 	void RestoreFence (NscSymbolFence *pFence)
 	{
-		memcpy (&m_sFence, pFence, sizeof (m_sFence));
+
+		//
+		// Unlink the symbols added since the fence, newest first
+		//
+
+		assert (pFence ->nUndo <= m_asUndo .size ());
+		while (m_asUndo .size () > pFence ->nUndo)
+		{
+			const HashEntry &sUndo = m_asUndo .back ();
+			FindHashEntry (sUndo .ulHash, false) ->nHead = sUndo .nHead;
+			m_asUndo .pop_back ();
+		}
 		m_nSize = pFence ->nSize;
 	}
 
@@ -155,13 +295,11 @@ public:
 		// Search for a match
 		//
 
-		UINT32 ulHashIndex = ulHash % NscMaxHash;
-		size_t nIndex = m_sFence .anHashStart [ulHashIndex];
+		size_t nIndex = GetHashHead (ulHash);
 		while (nIndex != 0)
 		{
-			NscSymbol *pSymbol = (NscSymbol *) &m_pauchData [nIndex];
-			if (pSymbol ->ulHash == ulHash &&
-				pSymbol ->nLength == nLength &&
+			NscSymbol *pSymbol = GetSymbol (nIndex);
+			if (pSymbol ->nLength == nLength &&
 				((1 << pSymbol ->nSymType) & ulSymTypeMask) != 0 &&
 				memcmp (psz, pSymbol ->szString, 
 				nLength * sizeof (char)) == 0)
@@ -201,30 +339,33 @@ public:
 	{
 
 		//
-		// Get the hash code and index
+		// Get the hash code and index entry
 		//
 
 		size_t nLength = strlen (psz);
 		UINT32 ulHash = GetHash (psz, nLength);
-		UINT32 ulHashIndex = ulHash % NscMaxHash;
+		HashEntry *pEntry = FindHashEntry (ulHash, true);
+
+		//
+		// Remember the previous head so that the fence can restore it
+		//
+
+		m_asUndo .push_back (*pEntry);
 
 		//
-		// If no match was found, we will have to create a new one
+		// Create the new symbol at the head of the chain
 		//
 
 		size_t nSize = sizeof (NscSymbol) + ((nLength) * sizeof (char));
 		MakeRoom (nSize);
-		NscSymbol *pSymbol = (NscSymbol *) &m_pauchData [m_nSize];
-		pSymbol ->nNext = m_sFence .anHashStart [ulHashIndex];
+		NscSymbol *pSymbol = GetSymbol (m_nSize);
+		pSymbol ->nNext = pEntry ->nHead;
 		pSymbol ->ulHash = ulHash;
 		pSymbol ->nSymType = nSymType;
 		pSymbol ->nLength = nLength;
 		memcpy (pSymbol ->szString, psz, nLength);
 		pSymbol ->szString [nLength] = 0;
-		m_sFence .anHashStart [ulHashIndex] = m_nSize;
-#ifdef _DEBUG
-		m_sFence .anHashDepth [ulHashIndex]++;
-#endif
+		pEntry ->nHead = m_nSize;
 
 		m_nSize += nSize;
 		return pSymbol;
@@ -242,7 +383,7 @@ public:
 		size_t nLength = strlen (psz);
 		size_t nSize = sizeof (NscSymbol) + ((nLength) * sizeof (char));
 		MakeRoom (nSize);
-		NscSymbol *pSymbol = (NscSymbol *) &m_pauchData [m_nSize];
+		NscSymbol *pSymbol = GetSymbol (m_nSize);
 		pSymbol ->nNext = 0;
 		pSymbol ->ulHash = 0;
 		pSymbol ->nSymType = nSymType;
@@ -253,25 +394,30 @@ public:
 		return pSymbol;
 	}
 
+	// @cmember Get the hash value (FNV-1a)
+
 	static UINT32 GetHash (const char *psz, size_t nLength)
 	{
-		UINT32 hash = 0;
+		UINT32 hash = 2166136261u;
 		while (nLength-- > 0)
 		{
-			int c = *psz++;
-			hash = c + (hash << 6) + (hash << 16) - hash;
+			hash ^= (unsigned char) *psz++;
+			hash *= 16777619u;
 		}
 		return hash;
 	}
 
-	// @cmember Get the hash value
+	// @cmember Get the hash value (FNV-1a)
 
 	static UINT32 GetHash (const char *psz)
 	{
-		UINT32 hash = 0;
+		UINT32 hash = 2166136261u;
 		int c;
-		while ((c = *psz++) != 0)
-			hash = c + (hash << 6) + (hash << 16) - hash;
+		while ((c = (unsigned char) *psz++) != 0)
+		{
+			hash ^= (UINT32) c;
+			hash *= 16777619u;
+		}
 		return hash;
 	}
 
@@ -281,18 +427,11 @@ public:
 	{
 		size_t nPos = m_nSize;
 		MakeRoom (nSize);
-		memcpy (&m_pauchData [m_nSize], pData, nSize);
+		memcpy (GetData (m_nSize), pData, nSize);
 		m_nSize += nSize;
 		return nPos;
 	}
 
-	// @cmember Get the fence
-
-	NscSymbolFence &GetFence ()
-	{
-		return m_sFence;
-	}
-
 	// @cmember Get the number of global identifier symbols (arbitrary)
 
 	size_t GetGlobalIdentifierCount ()
@@ -309,6 +448,20 @@ public:
 // @access Public inline methods
 public:
 
+// @access Protected types
+protected:
+
+	// @cmember Hash index entry (also used as an undo log record)
+
+	struct HashEntry
+	{
+		UINT32		ulHash;
+		bool		fUsed;
+		size_t		nHead;
+	};
+
+	typedef std::vector <HashEntry> HashEntryVec;
+
 // @access Protected methods
 protected:
 
@@ -316,24 +469,106 @@ protected:
 
 	void MakeRoom (size_t nSize)
 	{
-		if (m_nSize + nSize > m_nAllocated)
+		size_t nLocalSize = m_nSize - m_nBaseSize;
+		if (nLocalSize + nSize > m_nAllocated)
 		{
 			do 
 			{
 				m_nAllocated += m_nGrowSize;
-			} while (m_nSize + nSize > m_nAllocated);
+			} while (nLocalSize + nSize > m_nAllocated);
 			unsigned char *pauchNew = new unsigned char [m_nAllocated];
 			if (m_nSize == 0)
 				m_nSize = 1;
-			else
+			else if (m_pauchData)
 			{
-				memmove (pauchNew, m_pauchData, m_nSize);
+				memmove (pauchNew, m_pauchData, nLocalSize);
 				delete [] m_pauchData;
 			}
 			m_pauchData = pauchNew;
 		}
 	}
 
+	// @cmember Get the first symbol offset for a hash value
+
+	size_t GetHashHead (UINT32 ulHash)
+	{
+		CNscSymbolTable *pTable = this;
+		do
+		{
+			HashEntry *pEntry = pTable ->FindHashEntry (ulHash, false);
+			if (pEntry != NULL)
+				return pEntry ->nHead;
+			pTable = pTable ->m_pBase;
+		} while (pTable != NULL);
+		return 0;
+	}
+
+	// @cmember Locate (or create) the index entry for a hash value
+
+	HashEntry *FindHashEntry (UINT32 ulHash, bool fCreate)
+	{
+
+		//
+		// Grow the index once it is three quarters full
+		//
+
+		if (fCreate && (m_nHashUsed + 1) * 4 > m_asHash .size () * 3)
+			GrowHash ();
+		else if (m_asHash .empty ())
+			return NULL;
+
+		//
+		// Probe
+		//
+
+		size_t nMask = m_asHash .size () - 1;
+		size_t nIndex = (size_t) ulHash & nMask;
+		for (;;)
+		{
+			HashEntry *pEntry = &m_asHash [nIndex];
+			if (!pEntry ->fUsed)
+			{
+				if (!fCreate)
+					return NULL;
+
+				//
+				// A new local entry continues the base table's chain
+				//
+
+				pEntry ->ulHash = ulHash;
+				pEntry ->fUsed = true;
+				pEntry ->nHead = m_pBase ? m_pBase ->GetHashHead (ulHash) : 0;
+				m_nHashUsed++;
+				return pEntry;
+			}
+			if (pEntry ->ulHash == ulHash)
+				return pEntry;
+			nIndex = (nIndex + 1) & nMask;
+		}
+	}
+
+	// @cmember Double the size of the index
+
+	void GrowHash ()
+	{
+		size_t nNewSize = m_asHash .empty () ? NscMaxHash : m_asHash .size () * 2;
+		HashEntryVec asOld;
+		asOld .swap (m_asHash);
+		HashEntry sEmpty = { 0, false, 0 };
+		m_asHash .assign (nNewSize, sEmpty);
+
+		size_t nMask = nNewSize - 1;
+		for (size_t i = 0; i < asOld .size (); i++)
+		{
+			if (!asOld [i] .fUsed)
+				continue;
+			size_t nIndex = (size_t) asOld [i] .ulHash & nMask;
+			while (m_asHash [nIndex] .fUsed)
+				nIndex = (nIndex + 1) & nMask;
+			m_asHash [nIndex] = asOld [i];
+		}
+	}
+
 // @cmember Protected members
 protected:
 
@@ -341,6 +576,14 @@ protected:
 
 	unsigned char	*m_pauchData;
 
+	// @cmember Read-only table this table is chained onto (or NULL)
+
+	CNscSymbolTable	*m_pBase;
+
+	// @cmember Size of the base table (first local offset)
+
+	size_t			m_nBaseSize;
+
 	// @cmember Size of the symbol table
 
 	size_t			m_nSize;
@@ -357,9 +600,21 @@ protected:
 
 	size_t			m_nGlobalIdentifierCount;
 
-	// @cmember Current fence
+	// @cmember Hash index (power of two sized, linear probing)
+
+	HashEntryVec	m_asHash;
+
+	// @cmember Number of used hash index entries
+
+	size_t			m_nHashUsed;
+
+	// @cmember Previous index entries of hashed adds, for fence restores
+
+	HashEntryVec	m_asUndo;
+
+	// @cmember Flags set on base table symbols by this table
 
-	NscSymbolFence	m_sFence;
+	std::map <size_t, UINT32> m_mapSharedFlags;
 };
 
 #endif // ETS_NSCSYMBOLTABLE_H
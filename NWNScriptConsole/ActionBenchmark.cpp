@@ -0,0 +1,718 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ActionBenchmark.cpp
+
+Abstract:
+
+	This module houses the native action microbenchmark.  Each action that
+	has a native routine is called with a fixed set of argument samples
+	through the VM stack handler (as the script VM calls it), through the
+	fast action call path (as the JIT calls it), and directly, so that the
+	cost of argument marshalling can be compared per action.
+
+--*/
+
+#include "Precomp.h"
+#include "NWScriptHost.h"
+#include "ActionBenchmark.h"
+#include "../NWNScriptLib/NWScriptAnalyzer.h"
+
+static const char * CallPathNames[ ] =
+{
+	"stack",
+	"fast",
+	"native"
+};
+
+ActionBenchmark::ActionBenchmark(
+	__in NWScriptHost * ScriptHost,
+	__in IDebugTextOut * TextOut,
+	__in ULONG Runs,
+	__in ULONG WarmupRuns
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new native action microbenchmark.
+
+Arguments:
+
+	ScriptHost - Supplies the script host whose actions are benchmarked.
+
+	TextOut - Supplies the text out interface used for status output.
+
+	Runs - Supplies the count of timed passes per action and call path.
+
+	WarmupRuns - Supplies the count of untimed passes per action and call
+	             path that precede the timed passes.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ScriptHost( ScriptHost ),
+  m_TextOut( TextOut ),
+  m_Runs( Runs ? Runs : 1 ),
+  m_WarmupRuns( WarmupRuns ),
+  m_Stack( NWN::INVALIDOBJID )
+{
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+ActionBenchmark::~ActionBenchmark(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the native action microbenchmark.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+bool
+ActionBenchmark::Run(
+	__in const std::string & ResultsFile
+	)
+/*++
+
+Routine Description:
+
+	This routine benchmarks every action that has a native routine, prints a
+	summary line per action, and writes the results file.
+
+Arguments:
+
+	ResultsFile - Supplies the name of the results file, or an empty string
+	              if only the summary is to be printed.
+
+Return Value:
+
+	The routine returns true on success, else false if the results could not
+	be written or the call paths did not agree.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG   Mismatches;
+	bool    Written;
+	FILE  * f;
+
+	m_Results.clear( );
+
+	m_TextOut->WriteText(
+		"Benchmarking native actions (%lu warm-up pass(es), %lu timed pass(es) of %lu calls per call path)...\n",
+		m_WarmupRuns,
+		m_Runs,
+		(unsigned long) CALLS_PER_PASS);
+
+	Mismatches = 0;
+
+	for (NWSCRIPT_ACTION ActionId = 0; ActionId < MAX_ACTION_ID_NWN2; ActionId += 1)
+	{
+		NWScriptHost::NativeActionProc NativeHandler;
+		ActionResult                   Result;
+
+		NativeHandler = m_ScriptHost->GetNativeAction( ActionId );
+
+		if (NativeHandler == NULL)
+			continue;
+
+		try
+		{
+			BenchmarkAction( &NWActions_NWN2[ ActionId ], NativeHandler, Result );
+		}
+		catch (std::exception &e)
+		{
+			m_TextOut->WriteText(
+				"ERROR: Exception '%s' benchmarking action %s (%lu).\n",
+				e.what( ),
+				m_ScriptHost->GetActionName( ActionId ),
+				ActionId);
+
+			Mismatches += 1;
+			continue;
+		}
+
+		m_TextOut->WriteText(
+			"%-16s stack %7.1f ns, fast %7.1f ns, native %7.1f ns per call%s\n",
+			m_ScriptHost->GetActionName( ActionId ),
+			TicksToNsPerCall( Result.Ticks[ CallPathStack ], Result.Calls ),
+			TicksToNsPerCall( Result.Ticks[ CallPathFast ], Result.Calls ),
+			TicksToNsPerCall( Result.Ticks[ CallPathNative ], Result.Calls ),
+			(Result.Mismatches != 0) ? " (RESULTS DIFFER)" : "");
+
+		Mismatches += Result.Mismatches;
+
+		m_Results.push_back( Result );
+	}
+
+	m_TextOut->WriteText(
+		"Benchmarked %lu native action(s); %lu result mismatch(es).\n",
+		(unsigned long) m_Results.size( ),
+		Mismatches);
+
+	if (ResultsFile.empty( ))
+		return (Mismatches == 0);
+
+	f = fopen( ResultsFile.c_str( ), "wt" );
+
+	if (f == NULL)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Unable to open action benchmark results file '%s'.\n",
+			ResultsFile.c_str( ));
+
+		return false;
+	}
+
+	Written = WriteCsv( f );
+
+	if (fclose( f ) != 0)
+		Written = false;
+
+	if (!Written)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Failed to write action benchmark results file '%s'.\n",
+			ResultsFile.c_str( ));
+
+		return false;
+	}
+
+	m_TextOut->WriteText(
+		"Wrote action benchmark results for %lu action(s) to '%s'.\n",
+		(unsigned long) m_Results.size( ),
+		ResultsFile.c_str( ));
+
+	return (Mismatches == 0);
+}
+
+void
+ActionBenchmark::BuildSamples(
+	__in PCNWACTION_DEFINITION ActionDef,
+	__out_ecount( NUM_SAMPLES * NWScriptHost::MAX_NATIVE_ACTION_ARGS ) NWScriptHost::PNATIVE_ACTION_VALUE Samples
+	)
+/*++
+
+Routine Description:
+
+	This routine builds the argument samples of an action.  The samples cover
+	negative, zero, small, and large values, including values that are out of
+	the domain of the inverse trigonometric and logarithm actions.
+
+Arguments:
+
+	ActionDef - Supplies the action definition.
+
+	Samples - Receives NUM_SAMPLES argument lists of MAX_NATIVE_ACTION_ARGS
+	          values each.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	static const int   IntSamples[ NUM_SAMPLES ] = { -7, -1, 0, 1, 2, 5, 24, 1000 };
+	static const float FloatSamples[ NUM_SAMPLES ] = { -2.5f, -1.0f, -0.5f, 0.0f, 0.25f, 1.0f, 3.0f, 90.0f };
+	static const float VectorSamples[ NUM_SAMPLES ][ 3 ] =
+	{
+		{ 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f },
+		{ 3.0f, 4.0f, 0.0f },
+		{ -1.0f, 2.0f, -3.0f },
+		{ 0.5f, 0.5f, 0.5f },
+		{ 10.0f, -10.0f, 2.0f },
+		{ 0.0f, 0.0f, 0.000001f },
+		{ 100.0f, 200.0f, 300.0f }
+	};
+
+	for (size_t Sample = 0; Sample < NUM_SAMPLES; Sample += 1)
+	{
+		for (unsigned long Param = 0; Param < ActionDef->NumParameters; Param += 1)
+		{
+			NWScriptHost::NATIVE_ACTION_VALUE & Arg = Samples[ Sample * NWScriptHost::MAX_NATIVE_ACTION_ARGS + Param ];
+			size_t                              Index;
+
+			//
+			// Stagger the samples of each parameter so that multi-parameter
+			// actions see varied combinations.
+			//
+
+			Index = (Sample + Param * 3) % NUM_SAMPLES;
+
+			switch (ActionDef->ParameterTypes[ Param ])
+			{
+
+			case ACTIONTYPE_INT:
+				Arg.Int = IntSamples[ Index ];
+				break;
+
+			case ACTIONTYPE_FLOAT:
+				Arg.Float = FloatSamples[ Index ];
+				break;
+
+			case ACTIONTYPE_VECTOR:
+				Arg.Vector.x = VectorSamples[ Index ][ 0 ];
+				Arg.Vector.y = VectorSamples[ Index ][ 1 ];
+				Arg.Vector.z = VectorSamples[ Index ][ 2 ];
+				break;
+
+			default:
+				throw std::runtime_error( "Unsupported native action parameter type." );
+
+			}
+		}
+	}
+}
+
+void
+ActionBenchmark::CallAction(
+	__in CALL_PATH Path,
+	__in PCNWACTION_DEFINITION ActionDef,
+	__in NWScriptHost::NativeActionProc NativeHandler,
+	__in NWScriptHost::PCNATIVE_ACTION_VALUE Args,
+	__out NWScriptHost::PNATIVE_ACTION_VALUE Result
+	)
+/*++
+
+Routine Description:
+
+	This routine calls an action once through the given call path.
+
+Arguments:
+
+	Path - Supplies the call path to use.
+
+	ActionDef - Supplies the action definition.
+
+	NativeHandler - Supplies the native routine of the action.
+
+	Args - Supplies the arguments, in parameter order.
+
+	Result - Receives the return value.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Path)
+	{
+
+	case CallPathStack:
+		{
+			//
+			// Push the arguments as the script VM does (argument 0 last, so
+			// that it is on top), call the handler, and pop the result.
+			//
+
+			for (unsigned long Param = ActionDef->NumParameters; Param != 0; Param -= 1)
+			{
+				switch (ActionDef->ParameterTypes[ Param - 1 ])
+				{
+
+				case ACTIONTYPE_INT:
+					m_Stack.StackPushInt( Args[ Param - 1 ].Int );
+					break;
+
+				case ACTIONTYPE_FLOAT:
+					m_Stack.StackPushFloat( Args[ Param - 1 ].Float );
+					break;
+
+				case ACTIONTYPE_VECTOR:
+					m_Stack.StackPushVector( Args[ Param - 1 ].Vector );
+					break;
+
+				default:
+					break;
+
+				}
+			}
+
+			m_ScriptHost->InvokeActionHandler(
+				m_Stack,
+				ActionDef->ActionId,
+				ActionDef->NumParameters);
+
+			switch (ActionDef->ReturnType)
+			{
+
+			case ACTIONTYPE_INT:
+				Result->Int = m_Stack.StackPopInt( );
+				break;
+
+			case ACTIONTYPE_FLOAT:
+				Result->Float = m_Stack.StackPopFloat( );
+				break;
+
+			case ACTIONTYPE_VECTOR:
+				Result->Vector = m_Stack.StackPopVector( );
+				break;
+
+			default:
+				break;
+
+			}
+		}
+		break;
+
+	case CallPathFast:
+		{
+			NWFASTACTION_CMD Cmds[ NWScriptHost::MAX_NATIVE_ACTION_ARGS * 3 + 1 + 3 ];
+			uintptr_t        CmdParams[ RTL_NUMBER_OF( Cmds ) ];
+			size_t           NumCmds;
+
+			//
+			// Build the same command list that the JIT builds for a fast
+			// action call.
+			//
+
+			NumCmds = 0;
+
+			for (unsigned long Param = ActionDef->NumParameters; Param != 0; Param -= 1)
+			{
+				NWScriptHost::PCNATIVE_ACTION_VALUE Arg = &Args[ Param - 1 ];
+
+				switch (ActionDef->ParameterTypes[ Param - 1 ])
+				{
+
+				case ACTIONTYPE_INT:
+					Cmds[ NumCmds ]      = NWFASTACTION_PUSHINT;
+					CmdParams[ NumCmds ] = (uintptr_t) Arg->Int;
+					NumCmds             += 1;
+					break;
+
+				case ACTIONTYPE_FLOAT:
+					Cmds[ NumCmds ]                  = NWFASTACTION_PUSHFLOAT;
+					CmdParams[ NumCmds ]             = 0;
+					*(float *) &CmdParams[ NumCmds ] = Arg->Float;
+					NumCmds                         += 1;
+					break;
+
+				case ACTIONTYPE_VECTOR:
+					for (size_t i = 0; i < 3; i += 1)
+					{
+						Cmds[ NumCmds ]                  = NWFASTACTION_PUSHFLOAT;
+						CmdParams[ NumCmds ]             = 0;
+						*(float *) &CmdParams[ NumCmds ] = (&Arg->Vector.x)[ i ];
+						NumCmds                         += 1;
+					}
+					break;
+
+				default:
+					break;
+
+				}
+			}
+
+			//
+			// The call command takes no parameter, so the command parameters
+			// of the return value follow the argument command parameters.
+			//
+
+			Cmds[ NumCmds ] = NWFASTACTION_CALL;
+
+			switch (ActionDef->ReturnType)
+			{
+
+			case ACTIONTYPE_INT:
+				Cmds[ NumCmds + 1 ]  = NWFASTACTION_POPINT;
+				CmdParams[ NumCmds ] = (uintptr_t) &Result->Int;
+				NumCmds             += 2;
+				break;
+
+			case ACTIONTYPE_FLOAT:
+				Cmds[ NumCmds + 1 ]  = NWFASTACTION_POPFLOAT;
+				CmdParams[ NumCmds ] = (uintptr_t) &Result->Float;
+				NumCmds             += 2;
+				break;
+
+			case ACTIONTYPE_VECTOR:
+				Cmds[ NumCmds + 1 ]      = NWFASTACTION_POPFLOAT;
+				CmdParams[ NumCmds + 0 ] = (uintptr_t) &Result->Vector.z;
+				Cmds[ NumCmds + 2 ]      = NWFASTACTION_POPFLOAT;
+				CmdParams[ NumCmds + 1 ] = (uintptr_t) &Result->Vector.y;
+				Cmds[ NumCmds + 3 ]      = NWFASTACTION_POPFLOAT;
+				CmdParams[ NumCmds + 2 ] = (uintptr_t) &Result->Vector.x;
+				NumCmds                 += 4;
+				break;
+
+			default:
+				NumCmds += 1;
+				break;
+
+			}
+
+			if (!m_ScriptHost->OnExecuteActionFromJITFast(
+				ActionDef->ActionId,
+				ActionDef->NumParameters,
+				Cmds,
+				NumCmds,
+				CmdParams))
+			{
+				throw std::runtime_error( "Fast action call failed." );
+			}
+		}
+		break;
+
+	case CallPathNative:
+		NativeHandler( Args, Result );
+		break;
+
+	}
+}
+
+void
+ActionBenchmark::BenchmarkAction(
+	__in PCNWACTION_DEFINITION ActionDef,
+	__in NWScriptHost::NativeActionProc NativeHandler,
+	__out ActionResult & Result
+	)
+/*++
+
+Routine Description:
+
+	This routine benchmarks a single action through each call path, after
+	checking that every call path returns the same results for each of the
+	argument samples.
+
+Arguments:
+
+	ActionDef - Supplies the action definition.
+
+	NativeHandler - Supplies the native routine of the action.
+
+	Result - Receives the results of the action.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NWScriptHost::NATIVE_ACTION_VALUE Samples[ NUM_SAMPLES * NWScriptHost::MAX_NATIVE_ACTION_ARGS ];
+	NWScriptHost::NATIVE_ACTION_VALUE Expected;
+	NWScriptHost::NATIVE_ACTION_VALUE Actual;
+	size_t                            ResultSize;
+	volatile ULONG                    Sink;
+
+	ZeroMemory( &Result, sizeof( Result ) );
+	ZeroMemory( Samples, sizeof( Samples ) );
+
+	Result.ActionId = ActionDef->ActionId;
+
+	BuildSamples( ActionDef, Samples );
+
+	switch (ActionDef->ReturnType)
+	{
+
+	case ACTIONTYPE_VOID:
+		ResultSize = 0;
+		break;
+
+	case ACTIONTYPE_VECTOR:
+		ResultSize = sizeof( NWN::Vector3 );
+		break;
+
+	default:
+		ResultSize = sizeof( ULONG );
+		break;
+
+	}
+
+	//
+	// Check that each call path agrees with the native routine, bit for bit.
+	//
+
+	for (size_t Sample = 0; Sample < NUM_SAMPLES; Sample += 1)
+	{
+		NWScriptHost::PCNATIVE_ACTION_VALUE Args = &Samples[ Sample * NWScriptHost::MAX_NATIVE_ACTION_ARGS ];
+
+		ZeroMemory( &Expected, sizeof( Expected ) );
+		CallAction( CallPathNative, ActionDef, NativeHandler, Args, &Expected );
+
+		for (int Path = CallPathStack; Path < CallPathNative; Path += 1)
+		{
+			ZeroMemory( &Actual, sizeof( Actual ) );
+			CallAction( (CALL_PATH) Path, ActionDef, NativeHandler, Args, &Actual );
+
+			if (memcmp( &Expected, &Actual, ResultSize ) != 0)
+			{
+				m_TextOut->WriteText(
+					"WARNING: Action %s sample %lu: %s call path result differs from native result.\n",
+					m_ScriptHost->GetActionName( ActionDef->ActionId ),
+					(unsigned long) Sample,
+					CallPathNames[ Path ]);
+
+				Result.Mismatches += 1;
+			}
+		}
+	}
+
+	//
+	// Now time each call path.
+	//
+
+	Sink = 0;
+
+	for (int Path = CallPathStack; Path < LastCallPath; Path += 1)
+	{
+		for (ULONG Pass = 0; Pass < m_WarmupRuns + m_Runs; Pass += 1)
+		{
+			LARGE_INTEGER Start;
+			LARGE_INTEGER End;
+
+			QueryPerformanceCounter( &Start );
+
+			for (ULONG Call = 0; Call < CALLS_PER_PASS; Call += 1)
+			{
+				CallAction(
+					(CALL_PATH) Path,
+					ActionDef,
+					NativeHandler,
+					&Samples[ (Call % NUM_SAMPLES) * NWScriptHost::MAX_NATIVE_ACTION_ARGS ],
+					&Actual);
+
+				Sink += (ULONG) Actual.Int;
+			}
+
+			QueryPerformanceCounter( &End );
+
+			if (Pass < m_WarmupRuns)
+				continue;
+
+			Result.Ticks[ Path ] += (ULONGLONG) (End.QuadPart - Start.QuadPart);
+
+			if (Path == CallPathStack)
+				Result.Calls += CALLS_PER_PASS;
+		}
+	}
+}
+
+bool
+ActionBenchmark::WriteCsv(
+	__in FILE * f
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the results as CSV, one row per action.
+
+Arguments:
+
+	f - Supplies the results file.
+
+Return Value:
+
+	The routine returns true on success.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (fprintf(
+		f,
+		"action,ordinal,calls,stack_ns_per_call,fast_ns_per_call,native_ns_per_call,mismatches\n") < 0)
+	{
+		return false;
+	}
+
+	for (ActionResultVec::const_iterator it = m_Results.begin( );
+	     it != m_Results.end( );
+	     ++it)
+	{
+		if (fprintf(
+			f,
+			"%s,%lu,%I64u,%.2f,%.2f,%.2f,%lu\n",
+			m_ScriptHost->GetActionName( it->ActionId ),
+			it->ActionId,
+			it->Calls,
+			TicksToNsPerCall( it->Ticks[ CallPathStack ], it->Calls ),
+			TicksToNsPerCall( it->Ticks[ CallPathFast ], it->Calls ),
+			TicksToNsPerCall( it->Ticks[ CallPathNative ], it->Calls ),
+			it->Mismatches) < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+double
+ActionBenchmark::TicksToNsPerCall(
+	__in ULONGLONG Ticks,
+	__in ULONGLONG Calls
+	) const
+/*++
+
+Routine Description:
+
+	This routine converts performance counter ticks to nanoseconds per call.
+
+Arguments:
+
+	Ticks - Supplies the tick count.
+
+	Calls - Supplies the count of calls made in the ticks.
+
+Return Value:
+
+	The average count of nanoseconds per call.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((m_Frequency.QuadPart == 0) || (Calls == 0))
+		return 0.0;
+
+	return (double) Ticks * 1000000000.0 / (double) m_Frequency.QuadPart / (double) Calls;
+}
@@ -0,0 +1,155 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ActionBenchmark.h
+
+Abstract:
+
+	This module defines the native action microbenchmark, which times each
+	action that has a native routine through the VM stack handler, the fast
+	action call path used by the JIT, and a direct native call, and checks
+	that all three produce the same results.
+
+--*/
+
+#ifndef _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_ACTIONBENCHMARK_H
+#define _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_ACTIONBENCHMARK_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class ActionBenchmark
+{
+
+public:
+
+	ActionBenchmark(
+		__in NWScriptHost * ScriptHost,
+		__in IDebugTextOut * TextOut,
+		__in ULONG Runs,
+		__in ULONG WarmupRuns
+		);
+
+	~ActionBenchmark(
+		);
+
+	//
+	// Benchmark every action that has a native routine and write the results
+	// as CSV.  An empty results file name only prints the summary.  The
+	// routine returns false if the results could not be written, or if the
+	// call paths did not agree.
+	//
+
+	bool
+	Run(
+		__in const std::string & ResultsFile
+		);
+
+private:
+
+	//
+	// Define the call paths that are timed.
+	//
+
+	typedef enum _CALL_PATH
+	{
+		CallPathStack,
+		CallPathFast,
+		CallPathNative,
+
+		LastCallPath
+	} CALL_PATH, * PCALL_PATH;
+
+	//
+	// Define the count of argument samples that each action is called with,
+	// and the count of calls made per call path in each pass.
+	//
+
+	enum
+	{
+		NUM_SAMPLES     = 8,
+		CALLS_PER_PASS  = 100000
+	};
+
+	//
+	// Define the results of one action.
+	//
+
+	struct ActionResult
+	{
+		NWSCRIPT_ACTION ActionId;
+		ULONGLONG       Calls;
+		ULONGLONG       Ticks[ LastCallPath ];
+		ULONG           Mismatches;
+	};
+
+	typedef std::vector< ActionResult > ActionResultVec;
+
+	//
+	// Build the argument samples of an action.
+	//
+
+	void
+	BuildSamples(
+		__in PCNWACTION_DEFINITION ActionDef,
+		__out_ecount( NUM_SAMPLES * NWScriptHost::MAX_NATIVE_ACTION_ARGS ) NWScriptHost::PNATIVE_ACTION_VALUE Samples
+		);
+
+	//
+	// Call an action once through the given call path.
+	//
+
+	void
+	CallAction(
+		__in CALL_PATH Path,
+		__in PCNWACTION_DEFINITION ActionDef,
+		__in NWScriptHost::NativeActionProc NativeHandler,
+		__in NWScriptHost::PCNATIVE_ACTION_VALUE Args,
+		__out NWScriptHost::PNATIVE_ACTION_VALUE Result
+		);
+
+	//
+	// Benchmark a single action.
+	//
+
+	void
+	BenchmarkAction(
+		__in PCNWACTION_DEFINITION ActionDef,
+		__in NWScriptHost::NativeActionProc NativeHandler,
+		__out ActionResult & Result
+		);
+
+	//
+	// Write the results as CSV.
+	//
+
+	bool
+	WriteCsv(
+		__in FILE * f
+		);
+
+	//
+	// Convert performance counter ticks to nanoseconds per call.
+	//
+
+	double
+	TicksToNsPerCall(
+		__in ULONGLONG Ticks,
+		__in ULONGLONG Calls
+		) const;
+
+	NWScriptHost               * m_ScriptHost;
+	IDebugTextOut              * m_TextOut;
+	ULONG                        m_Runs;
+	ULONG                        m_WarmupRuns;
+	NWScriptStack                m_Stack;
+	ActionResultVec              m_Results;
+	LARGE_INTEGER                m_Frequency;
+
+};
+
+#endif
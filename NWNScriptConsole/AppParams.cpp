@@ -119,6 +119,39 @@ Environment:
 			SetScriptDebug( _wtoi( argv[ i += 1 ] ) );
 		else if ((!_wcsicmp( argv[ i ], L"-testmode") ) && (i < argc - 1))
 			SetTestMode( _wtoi( argv[ i += 1 ] ) );
+		else if ((!_wcsicmp( argv[ i ], L"-benchruns") ) && (i < argc - 1))
+			SetBenchmarkRuns( (ULONG) _wtoi( argv[ i += 1 ] ) );
+		else if ((!_wcsicmp( argv[ i ], L"-benchwarmup") ) && (i < argc - 1))
+			SetBenchmarkWarmupRuns( (ULONG) _wtoi( argv[ i += 1 ] ) );
+		else if ((!_wcsicmp( argv[ i ], L"-benchout" )) && (i < argc - 1))
+		{
+			std::string Str;
+
+			if (!swutil::UnicodeToAnsi( argv[ i += 1 ], Str ))
+				continue;
+
+			SetBenchmarkOutFile( Str );
+		}
+		else if ((!_wcsicmp( argv[ i ], L"-recordtrace" )) && (i < argc - 1))
+		{
+			std::string Str;
+
+			if (!swutil::UnicodeToAnsi( argv[ i += 1 ], Str ))
+				continue;
+
+			SetRecordTraceFile( Str );
+		}
+		else if ((!_wcsicmp( argv[ i ], L"-replaytrace" )) && (i < argc - 1))
+		{
+			std::string Str;
+
+			if (!swutil::UnicodeToAnsi( argv[ i += 1 ], Str ))
+				continue;
+
+			SetReplayTraceFile( Str );
+		}
+		else if ((!_wcsicmp( argv[ i ], L"-replayverify" )))
+			SetReplayVerify( true );
 		else if ((!_wcsicmp( argv[ i ], L"-nologo" )))
 			SetIsNoLogo( true );
 		else if ((!_wcsicmp( argv[ i ], L"-allowmanagedscripts" )) && (i < argc - 1))
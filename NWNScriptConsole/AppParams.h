@@ -50,7 +50,10 @@ public:
 	  m_NoLogo( false ),
 	  m_AllowManagedScripts( false ),
 	  m_ScriptDebug( 1 ), // NWScriptVM::EDL_Errors
-	  m_TestMode( 0 )
+	  m_TestMode( 0 ),
+	  m_BenchmarkRuns( 10 ),
+	  m_BenchmarkWarmupRuns( 2 ),
+	  m_ReplayVerify( false )
 	{
 		FindCriticalDirectories( );
 		ParseArguments( m_argc, const_cast< const wchar_t * * >( m_argv ) );
@@ -93,6 +96,32 @@ public:
 	inline int GetTestMode( ) const { return m_TestMode; }
 	inline void SetTestMode( __in int TestMode ) { m_TestMode = TestMode; }
 
+	//
+	// Benchmark test mode (-testmode 3) parameters.
+	//
+
+	inline ULONG GetBenchmarkRuns( ) const { return m_BenchmarkRuns; }
+	inline void SetBenchmarkRuns( __in ULONG BenchmarkRuns ) { m_BenchmarkRuns = BenchmarkRuns; }
+
+	inline ULONG GetBenchmarkWarmupRuns( ) const { return m_BenchmarkWarmupRuns; }
+	inline void SetBenchmarkWarmupRuns( __in ULONG BenchmarkWarmupRuns ) { m_BenchmarkWarmupRuns = BenchmarkWarmupRuns; }
+
+	inline const std::string & GetBenchmarkOutFile( ) const { return m_BenchmarkOutFile; }
+	inline void SetBenchmarkOutFile( __in const std::string & BenchmarkOutFile ) { m_BenchmarkOutFile = BenchmarkOutFile; }
+
+	//
+	// Action trace recording and replay (-testmode 4) parameters.
+	//
+
+	inline const std::string & GetRecordTraceFile( ) const { return m_RecordTraceFile; }
+	inline void SetRecordTraceFile( __in const std::string & RecordTraceFile ) { m_RecordTraceFile = RecordTraceFile; }
+
+	inline const std::string & GetReplayTraceFile( ) const { return m_ReplayTraceFile; }
+	inline void SetReplayTraceFile( __in const std::string & ReplayTraceFile ) { m_ReplayTraceFile = ReplayTraceFile; }
+
+	inline bool GetReplayVerify( ) const { return m_ReplayVerify; }
+	inline void SetReplayVerify( __in bool ReplayVerify ) { m_ReplayVerify = ReplayVerify; }
+
 private:
 
 	void
@@ -137,6 +166,12 @@ private:
 	bool                       m_AllowManagedScripts;
 	int                        m_ScriptDebug;
 	int                        m_TestMode;
+	ULONG                      m_BenchmarkRuns;
+	ULONG                      m_BenchmarkWarmupRuns;
+	std::string                m_BenchmarkOutFile;
+	std::string                m_RecordTraceFile;
+	std::string                m_ReplayTraceFile;
+	bool                       m_ReplayVerify;
 
 };
 
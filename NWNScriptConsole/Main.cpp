@@ -17,6 +17,9 @@ Abstract:
 #include "Precomp.h"
 #include "AppParams.h"
 #include "NWScriptHost.h"
+#include "ActionBenchmark.h"
+#include "ScriptBenchmark.h"
+#include "ScriptReplay.h"
 #include "../NWNScriptCompilerLib/Nsc.h"
 
 FILE * g_Log;
@@ -344,6 +347,65 @@ Environment:
 		}
 		break;
 
+	case 3:
+		{
+			//
+			// Benchmark each compiled script under each execution engine.
+			//
+
+			ScriptBenchmark Benchmark(
+				ResMan,
+				ScriptHost,
+				Params.GetTextOut( ),
+				Params.GetBenchmarkRuns( ),
+				Params.GetBenchmarkWarmupRuns( ));
+
+			Benchmark.Run( Params.GetBenchmarkOutFile( ) );
+		}
+		break;
+
+	case 4:
+		{
+			//
+			// Replay the scripts recorded in an action trace.
+			//
+
+			if (Params.GetReplayTraceFile( ).empty( ))
+			{
+				Params.GetTextOut( )->WriteText(
+					"ERROR: Test mode 4 requires -replaytrace <file>.\n");
+				break;
+			}
+
+			ScriptReplay Replay(
+				ScriptHost,
+				Params.GetTextOut( ),
+				Params.GetBenchmarkRuns( ),
+				Params.GetBenchmarkWarmupRuns( ),
+				Params.GetReplayVerify( ));
+
+			Replay.Run(
+				Params.GetReplayTraceFile( ),
+				Params.GetBenchmarkOutFile( ));
+		}
+		break;
+
+	case 5:
+		{
+			//
+			// Benchmark each action that has a native routine.
+			//
+
+			ActionBenchmark Benchmark(
+				ScriptHost,
+				Params.GetTextOut( ),
+				Params.GetBenchmarkRuns( ),
+				Params.GetBenchmarkWarmupRuns( ));
+
+			Benchmark.Run( Params.GetBenchmarkOutFile( ) );
+		}
+		break;
+
 	}
 
 }
@@ -402,12 +464,37 @@ Environment:
 			"\n"
 			"  NWNScriptConsole [-module <module>] [-home <homedir>]\n"
 			"                   [-installdir <installdir>] [-nologo]\n"
+			"                   [-testmode 3 [-benchruns <n>] [-benchwarmup <n>]\n"
+			"                   [-benchout <file.csv|file.json>]]\n"
+			"                   [-recordtrace <file>]\n"
+			"                   [-testmode 4 -replaytrace <file> [-replayverify]\n"
+			"                   [-benchruns <n>] [-benchwarmup <n>] [-benchout <file.csv>]]\n"
+			"                   [-testmode 5 [-benchruns <n>] [-benchwarmup <n>]\n"
+			"                   [-benchout <file.csv>]]\n"
 			"                   ScriptName [script arguments]\n"
 			"\n"
 			"The script name should not contain any extension.  If a module is\n"
 			"loaded, then the script will be loaded using standard resource\n"
 			"loading semantics; otherwise, it is assumed to be a raw filesystem\n"
 			"path (without the .ncs extension).\n"
+			"\n"
+			"Test mode 3 runs every compiled script in the module under the\n"
+			"script VM and the JIT (if installed), and reports ns/instruction,\n"
+			"instructions/second, allocations and action overhead per run.\n"
+			"\n"
+			"-recordtrace writes the action calls (arguments and return values)\n"
+			"of every script that is run to a binary action trace.  Scripts are run\n"
+			"under the script VM while recording.  The NWScript Accelerator plugin\n"
+			"records the same trace format from a live server.\n"
+			"\n"
+			"Test mode 4 replays every script recorded in an action trace under the\n"
+			"script VM, with the recorded action results supplied in place of the\n"
+			"action handlers, and reports the replay timing and any divergence from\n"
+			"the recording.\n"
+			"\n"
+			"Test mode 5 times each math action that has a native routine through\n"
+			"the script VM stack handler, the JIT fast action call, and a direct\n"
+			"native call, and checks that all three return the same results.\n"
 			"\n");
 	
 		return 0;
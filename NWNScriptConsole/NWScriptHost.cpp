@@ -75,10 +75,22 @@ Environment:
   m_JITScriptAborted( false ),
   m_CurrentScript( NULL ),
   m_CurrentJITProgram( NULL ),
-  m_CurrentSelfObjectId( NWN::INVALIDOBJID )
+  m_CurrentSelfObjectId( NWN::INVALIDOBJID ),
+  m_ExecutionEngine( ExecEngineDefault ),
+  m_CollectStats( false ),
+  m_ActionDepth( 0 ),
+  m_ReplayTrace( NULL ),
+  m_ReplayNextAction( 0 ),
+  m_ReplayEndAction( 0 ),
+  m_ReplayVerify( false )
 {
 	int DebugLevel;
 
+	m_Stats.ActionCalls = 0;
+	m_Stats.ActionTime  = 0;
+
+	ZeroMemory( &m_ReplayStats, sizeof( m_ReplayStats ) );
+
 	//
 	// Set up the action table and initialize the script VM.
 	//
@@ -138,6 +150,26 @@ Environment:
 			"WARNING: Failed to setup managed script support: Exception: '%s'.\n",
 			e.what( ) );
 	}
+
+	//
+	// If configured, record an action trace of all scripts that are run.
+	//
+
+	if (!Params->GetRecordTraceFile( ).empty( ))
+	{
+		if (m_TraceWriter.Open( Params->GetRecordTraceFile( ).c_str( ) ))
+		{
+			m_TextOut->WriteText(
+				"Recording action trace to '%s' (scripts run under the script VM).\n",
+				Params->GetRecordTraceFile( ).c_str( ));
+		}
+		else
+		{
+			m_TextOut->WriteText(
+				"WARNING: Unable to create action trace file '%s'.\n",
+				Params->GetRecordTraceFile( ).c_str( ));
+		}
+	}
 }
 
 NWScriptHost::~NWScriptHost(
@@ -227,6 +259,8 @@ Environment:
 	else
 		ObjectSelf = NWN::INVALIDOBJID;
 
+	m_TraceWriter.BeginScript( ScriptName, ObjectSelf, ScriptParameters );
+
 	try
 	{
 		//
@@ -250,6 +284,18 @@ Environment:
 			m_CurrentScript       = LoadScript( ScriptName, m_CurrentJITProgram );
 			m_CurrentSelfObjectId = ObjectSelf;
 
+			if ((m_ExecutionEngine == ExecEngineVM) ||
+			    (m_TraceWriter.IsOpen( )) ||
+			    (m_ReplayTrace != NULL))
+			{
+				m_CurrentJITProgram = NULL;
+			}
+			else if ((m_ExecutionEngine == ExecEngineJIT) &&
+			         (m_CurrentJITProgram.get( ) == NULL))
+			{
+				throw std::runtime_error( "No JIT program is available for the script." );
+			}
+
 			QueryPerformanceCounter( &PerfStart );
 
 			ReturnCode = 0;
@@ -296,9 +342,12 @@ Environment:
 			throw;
 		}
 
-		m_TextOut->WriteText(
-			"Execution finished (time = %I64lums).\n",
-			(PerfEnd.QuadPart - PerfStart.QuadPart) / (PerfFreq.QuadPart / 1000));
+		if (!m_CollectStats)
+		{
+			m_TextOut->WriteText(
+				"Execution finished (time = %I64lums).\n",
+				(PerfEnd.QuadPart - PerfStart.QuadPart) / (PerfFreq.QuadPart / 1000));
+		}
 
 #if 0
 
@@ -386,6 +435,8 @@ Environment:
 		PrevProgram           = NULL;
 		m_JITScriptAborted    = false;
 
+		m_TraceWriter.EndScript( ReturnCode );
+
 		return ReturnCode;
 	}
 	catch (std::exception &e)
@@ -396,6 +447,8 @@ Environment:
 			ObjectSelf,
 			e.what( ));
 
+		m_TraceWriter.EndScript( DefaultReturnCode );
+
 		return DefaultReturnCode;
 	}
 }
@@ -567,6 +620,257 @@ Environment:
 	m_ScriptCache.clear( );
 }
 
+bool
+NWScriptHost::PreloadScript(
+	__in const NWN::ResRef32 & ScriptName,
+	__out bool & JITAvailable
+	)
+/*++
+
+Routine Description:
+
+	This routine loads a script (and generates its JIT program, if the JIT is
+	installed) into the script cache without executing it.
+
+Arguments:
+
+	ScriptName - Supplies the resource name of the script.
+
+	JITAvailable - Receives a Boolean value indicating true if a JIT program
+	               exists for the script.
+
+Return Value:
+
+	The routine returns true if the script could be loaded, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	char                         ResourceName[ sizeof( NWN::ResRef32 ) + 1 ];
+	NWScriptJITLib::Program::Ptr JITProgram;
+
+	JITAvailable = false;
+
+	memcpy( ResourceName, &ScriptName, sizeof( NWN::ResRef32 ) );
+	ResourceName[ sizeof( NWN::ResRef32 ) ] = '\0';
+
+	try
+	{
+		LoadScript( ResourceName, JITProgram );
+	}
+	catch (std::exception &e)
+	{
+		m_TextOut->WriteText(
+			"WARNING: NWScriptHost::PreloadScript( %s ): Exception '%s' loading script.\n",
+			ResourceName,
+			e.what( ));
+
+		return false;
+	}
+
+	JITAvailable = (JITProgram.get( ) != NULL);
+
+	return true;
+}
+
+void
+NWScriptHost::DiscardDeferredScriptSituations(
+	)
+/*++
+
+Routine Description:
+
+	This routine drops all deferred script situations (and their timers)
+	without executing them.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_DeferredSituations.clear( );
+	m_PendingDeferredSituations.clear( );
+}
+
+void
+NWScriptHost::BeginActionReplay(
+	__in const NWScriptActionTraceReader & Trace,
+	__in size_t ScriptIndex,
+	__in bool VerifyArguments
+	)
+/*++
+
+Routine Description:
+
+	This routine switches the action dispatcher to replay mode, in which the
+	recorded action calls of a trace script stand in for the action handlers.
+	Scripts are run under the script VM while a replay is active.
+
+Arguments:
+
+	Trace - Supplies the loaded action trace.
+
+	ScriptIndex - Supplies the index of the trace script whose action calls
+	              are to be replayed.
+
+	VerifyArguments - Supplies a Boolean value that indicates true if the
+	                  arguments of each action call are to be compared with
+	                  the recorded arguments.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const NWScriptActionTraceReader::TraceScript & Script = Trace.GetScripts( )[ ScriptIndex ];
+
+	m_ReplayTrace      = &Trace;
+	m_ReplayNextAction = Script.FirstAction;
+	m_ReplayEndAction  = Script.FirstAction + Script.ActionCount;
+	m_ReplayVerify     = VerifyArguments;
+
+	ZeroMemory( &m_ReplayStats, sizeof( m_ReplayStats ) );
+}
+
+void
+NWScriptHost::EndActionReplay(
+	__out ReplayStats & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine leaves replay mode and returns the replay results.
+
+Arguments:
+
+	Stats - Receives the replay results.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	m_ReplayStats.ActionsRemaining = (ULONG) (m_ReplayEndAction - m_ReplayNextAction);
+
+	Stats = m_ReplayStats;
+
+	m_ReplayTrace      = NULL;
+	m_ReplayNextAction = 0;
+	m_ReplayEndAction  = 0;
+}
+
+void
+NWScriptHost::ReplayAction(
+	__in NWScriptVM & ScriptVM,
+	__in NWScriptStack & VMStack,
+	__in NWSCRIPT_ACTION ActionId,
+	__in size_t NumArguments
+	)
+/*++
+
+Routine Description:
+
+	This routine replays the next recorded action call of the current trace
+	script: the arguments are removed from the stack and the recorded return
+	value is placed on the stack.  If the call does not match the recording,
+	the script is aborted.
+
+Arguments:
+
+	ScriptVM - Supplies the currently executing script VM.
+
+	VMStack - Supplies the currently executing script stack.
+
+	ActionId - Supplies the action service ordinal that was requested.
+
+	NumArguments - Supplies the count of arguments passed to the action ordinal.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, called from script VM.
+
+--*/
+{
+	NWScriptActionTraceReader::REPLAY_STATUS Status;
+
+	if (m_ReplayNextAction >= m_ReplayEndAction)
+	{
+		Status = NWScriptActionTraceReader::ReplayDiverged;
+	}
+	else
+	{
+		Status = m_ReplayTrace->ReplayAction(
+			m_ReplayNextAction,
+			NWActions_NWN2,
+			MAX_ACTION_ID_NWN2,
+			ActionId,
+			NumArguments,
+			VMStack,
+			this,
+			m_ReplayVerify);
+	}
+
+	switch (Status)
+	{
+
+	case NWScriptActionTraceReader::ReplayCompleted:
+		break;
+
+	case NWScriptActionTraceReader::ReplayArgumentMismatch:
+		m_ReplayStats.ArgumentMismatches += 1;
+		break;
+
+	case NWScriptActionTraceReader::ReplayAborted:
+		ScriptVM.AbortScript( );
+		break;
+
+	default:
+		if (ScriptVM.IsDebugLevel( NWScriptVM::EDL_Errors ))
+		{
+			m_TextOut->WriteText(
+				"NWScriptHost::ReplayAction: Action %s (%lu) does not match recorded action call %lu.\n",
+				m_ActionHandlerTable[ ActionId ].ActionName,
+				ActionId,
+				(unsigned long) m_ReplayNextAction);
+		}
+
+		m_ReplayStats.Divergences += 1;
+		ScriptVM.AbortScript( );
+		return;
+
+	}
+
+	m_ReplayNextAction            += 1;
+	m_ReplayStats.ActionsReplayed += 1;
+}
+
 bool
 NWScriptHost::InitiatePendingDeferredScriptSituations(
 	)
@@ -681,13 +985,35 @@ Environment:
 	}
 	else
 	{
+		ULONGLONG StatsStart = BeginActionStats( );
+		bool      Recorded;
+		bool      Completed;
+
+		//
+		// If an action trace is being recorded, capture the arguments now,
+		// while they are still on the stack.
+		//
+
+		Recorded  = m_TraceWriter.BeginAction(
+			&NWActions_NWN2[ ActionId ],
+			NumArguments,
+			VMStack);
+		Completed = true;
+
 		try
 		{
-			(this->*ActionEntry->ActionHandler)(
-				ScriptVM,
-				VMStack,
-				ActionId,
-				NumArguments);
+			if (m_ReplayTrace != NULL)
+			{
+				ReplayAction( ScriptVM, VMStack, ActionId, NumArguments );
+			}
+			else
+			{
+				(this->*ActionEntry->ActionHandler)(
+					ScriptVM,
+					VMStack,
+					ActionId,
+					NumArguments);
+			}
 		}
 		catch (std::exception &e)
 		{
@@ -701,7 +1027,17 @@ Environment:
 			}
 
 			ScriptVM.AbortScript( );
+			Completed = false;
+		}
+
+		if (Recorded)
+		{
+			m_TraceWriter.EndAction(
+				VMStack,
+				(Completed) && (!ScriptVM.IsScriptAborted( )));
 		}
+
+		EndActionStats( StatsStart );
 	}
 }
 
@@ -763,6 +1099,8 @@ Environment:
 	}
 	else
 	{
+		ULONGLONG StatsStart = BeginActionStats( );
+
 		try
 		{
 			(this->*ActionEntry->ActionHandler)(
@@ -782,8 +1120,11 @@ Environment:
 					ActionId);
 			}
 
+			EndActionStats( StatsStart );
 			return false;
 		}
+
+		EndActionStats( StatsStart );
 	}
 
 	return !m_JITScriptAborted;
@@ -856,8 +1197,45 @@ Environment:
 	{
 		return false;
 	}
+	else if (ActionEntry->NativeHandler != NULL)
+	{
+		ULONGLONG StatsStart = BeginActionStats( );
+
+		//
+		// The action has a native routine, so call it directly with the
+		// command parameters instead of round tripping through the JIT stack.
+		//
+
+		try
+		{
+			ExecuteNativeActionFast(
+				ActionId,
+				ActionEntry->NativeHandler,
+				Cmds,
+				NumCmds,
+				CmdParams);
+		}
+		catch (std::exception &e)
+		{
+			if (m_VM->IsDebugLevel( NWScriptVM::EDL_Errors ))
+			{
+				m_TextOut->WriteText(
+					"NWScriptHost::OnExecuteActionFromJITFast: Exception '%s' executing native action %s (%lu).\n",
+					e.what( ),
+					ActionEntry->ActionName,
+					ActionId);
+			}
+
+			EndActionStats( StatsStart );
+			return false;
+		}
+
+		EndActionStats( StatsStart );
+	}
 	else
 	{
+		ULONGLONG StatsStart = BeginActionStats( );
+
 		try
 		{
 			for (size_t i = 0; i < NumCmds; i += 1)
@@ -923,13 +1301,271 @@ Environment:
 					ActionId);
 			}
 
+			EndActionStats( StatsStart );
 			return false;
 		}
+
+		EndActionStats( StatsStart );
 	}
 
 	return !m_JITScriptAborted;
 }
 
+void
+NWScriptHost::ExecuteNativeAction(
+	__in NWScriptStack & VMStack,
+	__in NWSCRIPT_ACTION ActionId,
+	__in NativeActionProc NativeHandler
+	)
+/*++
+
+Routine Description:
+
+	This routine executes the native routine of an action on behalf of its VM
+	stack handler.  The arguments are removed from the VM stack and passed to
+	the native routine, and the return value is placed on the VM stack.
+
+Arguments:
+
+	VMStack - Supplies the script stack that holds the arguments.
+
+	ActionId - Supplies the action service ordinal, which must be valid.
+
+	NativeHandler - Supplies the native routine of the action.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, called from action handlers.
+
+--*/
+{
+	PCNWACTION_DEFINITION ActionDef;
+	NATIVE_ACTION_VALUE   Args[ MAX_NATIVE_ACTION_ARGS ];
+	NATIVE_ACTION_VALUE   Result;
+
+	ActionDef = &NWActions_NWN2[ ActionId ];
+
+	//
+	// Argument 0 is on top of the stack, so the arguments are removed in
+	// parameter order.
+	//
+
+	for (unsigned long i = 0; i < ActionDef->NumParameters; i += 1)
+	{
+		switch (ActionDef->ParameterTypes[ i ])
+		{
+
+		case ACTIONTYPE_INT:
+			Args[ i ].Int = VMStack.StackPopInt( );
+			break;
+
+		case ACTIONTYPE_FLOAT:
+			Args[ i ].Float = VMStack.StackPopFloat( );
+			break;
+
+		case ACTIONTYPE_VECTOR:
+			Args[ i ].Vector = VMStack.StackPopVector( );
+			break;
+
+		default:
+			throw std::runtime_error( "Unsupported native action parameter type." );
+
+		}
+	}
+
+	NativeHandler( Args, &Result );
+
+	switch (ActionDef->ReturnType)
+	{
+
+	case ACTIONTYPE_VOID:
+		break;
+
+	case ACTIONTYPE_INT:
+		VMStack.StackPushInt( Result.Int );
+		break;
+
+	case ACTIONTYPE_FLOAT:
+		VMStack.StackPushFloat( Result.Float );
+		break;
+
+	case ACTIONTYPE_VECTOR:
+		VMStack.StackPushVector( Result.Vector );
+		break;
+
+	default:
+		throw std::runtime_error( "Unsupported native action return type." );
+
+	}
+}
+
+void
+NWScriptHost::ExecuteNativeActionFast(
+	__in NWSCRIPT_ACTION ActionId,
+	__in NativeActionProc NativeHandler,
+	__in_ecount( NumCmds ) PCNWFASTACTION_CMD Cmds,
+	__in size_t NumCmds,
+	__in uintptr_t * CmdParams
+	)
+/*++
+
+Routine Description:
+
+	This routine executes the native routine of an action for a fast action
+	call.
+
+	The fast action commands describe the same push and pop sequence that the
+	call would make against the JIT stack: the arguments are pushed last
+	parameter first (so that argument 0 is pushed last), the action is called,
+	and the return value is popped (a vector as z, y, x).  The sequence is
+	carried out against a small local cell array instead, which is all that a
+	native routine requires.
+
+Arguments:
+
+	ActionId - Supplies the action service ordinal, which must be valid.
+
+	NativeHandler - Supplies the native routine of the action.
+
+	Cmds - Supplies the array of fast action commands.
+
+	NumCmds - Supplies the count of fast action commands.
+
+	CmdParams - Supplies the array of fast action command arguments.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode, called from script JIT code.
+
+--*/
+{
+	union CELL
+	{
+		int   Int;
+		float Float;
+	};
+
+	PCNWACTION_DEFINITION ActionDef;
+	NATIVE_ACTION_VALUE   Args[ MAX_NATIVE_ACTION_ARGS ];
+	NATIVE_ACTION_VALUE   Result;
+	CELL                  Cells[ MAX_NATIVE_ACTION_ARGS * 3 ];
+	size_t                NumCells;
+
+	ActionDef = &NWActions_NWN2[ ActionId ];
+	NumCells  = 0;
+
+	for (size_t i = 0; i < NumCmds; i += 1)
+	{
+		switch (Cmds[ i ])
+		{
+
+		case NWFASTACTION_PUSHINT:
+			if (NumCells == RTL_NUMBER_OF( Cells ))
+				throw std::runtime_error( "Too many native action arguments." );
+
+			Cells[ NumCells++ ].Int = (int) *CmdParams++;
+			break;
+
+		case NWFASTACTION_PUSHFLOAT:
+			if (NumCells == RTL_NUMBER_OF( Cells ))
+				throw std::runtime_error( "Too many native action arguments." );
+
+			Cells[ NumCells++ ].Float = *(float *) &*CmdParams++;
+			break;
+
+		case NWFASTACTION_POPINT:
+			if (NumCells == 0)
+				throw std::runtime_error( "Native action return value underflow." );
+
+			**(int **) CmdParams++ = Cells[ --NumCells ].Int;
+			break;
+
+		case NWFASTACTION_POPFLOAT:
+			if (NumCells == 0)
+				throw std::runtime_error( "Native action return value underflow." );
+
+			**(float **) CmdParams++ = Cells[ --NumCells ].Float;
+			break;
+
+		case NWFASTACTION_CALL:
+			for (unsigned long Param = 0; Param < ActionDef->NumParameters; Param += 1)
+			{
+				size_t Size = (ActionDef->ParameterTypes[ Param ] == ACTIONTYPE_VECTOR) ? 3 : 1;
+
+				if (NumCells < Size)
+					throw std::runtime_error( "Too few native action arguments." );
+
+				NumCells -= Size;
+
+				switch (ActionDef->ParameterTypes[ Param ])
+				{
+
+				case ACTIONTYPE_INT:
+					Args[ Param ].Int = Cells[ NumCells ].Int;
+					break;
+
+				case ACTIONTYPE_FLOAT:
+					Args[ Param ].Float = Cells[ NumCells ].Float;
+					break;
+
+				case ACTIONTYPE_VECTOR:
+					Args[ Param ].Vector.x = Cells[ NumCells + 0 ].Float;
+					Args[ Param ].Vector.y = Cells[ NumCells + 1 ].Float;
+					Args[ Param ].Vector.z = Cells[ NumCells + 2 ].Float;
+					break;
+
+				default:
+					throw std::runtime_error( "Unsupported native action parameter type." );
+
+				}
+			}
+
+			if (NumCells != 0)
+				throw std::runtime_error( "Too many native action arguments." );
+
+			NativeHandler( Args, &Result );
+
+			switch (ActionDef->ReturnType)
+			{
+
+			case ACTIONTYPE_VOID:
+				break;
+
+			case ACTIONTYPE_INT:
+				Cells[ NumCells++ ].Int = Result.Int;
+				break;
+
+			case ACTIONTYPE_FLOAT:
+				Cells[ NumCells++ ].Float = Result.Float;
+				break;
+
+			case ACTIONTYPE_VECTOR:
+				Cells[ NumCells++ ].Float = Result.Vector.x;
+				Cells[ NumCells++ ].Float = Result.Vector.y;
+				Cells[ NumCells++ ].Float = Result.Vector.z;
+				break;
+
+			default:
+				throw std::runtime_error( "Unsupported native action return type." );
+
+			}
+			break;
+
+		default:
+			throw std::runtime_error( "Unsupported fast action command for native action." );
+
+		}
+	}
+}
+
 EngineStructurePtr
 NWSCRIPTACTAPI
 NWScriptHost::CreateEngineStructure(
@@ -962,7 +1598,7 @@ Environment:
 	{
 
 	case EngTypeEffect:
-		return new EngEffect( );
+		return new (EngTypeEffect) EngEffect( );
 
 	default:
 		return EngineStructurePtr( NULL );
@@ -1002,11 +1638,14 @@ Environment:
 
 #define DECLARE_NSS_HANDLER( Name, Ordinal )                                        \
 	m_ActionHandlerTable[ Ordinal ].ActionHandler = &NWScriptHost::OnAction_##Name; \
+    m_ActionHandlerTable[ Ordinal ].NativeHandler = NULL;                           \
     m_ActionHandlerTable[ Ordinal ].ActionId      = Ordinal;                        \
     m_ActionHandlerTable[ Ordinal ].ActionName    = #Name;                  
 
 #include "NWScriptActionDefs.h"
 #undef DECLARE_NSS_HANDLER
+
+	RegisterNativeActions( );
 }
 
 NWScriptHost::NWScriptReaderPtr
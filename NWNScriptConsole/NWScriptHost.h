@@ -29,6 +29,7 @@ class NWScriptJITLib;
 
 #include "../NWNScriptLib/NWScriptInterfaces.h"
 #include "../NWNScriptLib/NWScriptVM.h"
+#include "../NWNScriptLib/NWScriptActionTrace.h"
 #include "../NWN2DataLib/NWScriptReader.h"
 #include "../NWNScriptJIT/NWScriptJITLib.h"
 
@@ -66,6 +67,73 @@ public:
 
 	typedef std::vector< std::string > ScriptParamVec;
 
+	//
+	// Define the execution engines that a script may be run under.  The
+	// default is to use the JIT if a JIT program could be generated for the
+	// script, else the reference VM.
+	//
+
+	typedef enum _EXEC_ENGINE
+	{
+		ExecEngineDefault    = 0,
+		ExecEngineVM         = 1,
+		ExecEngineJIT        = 2,
+
+		LastExecEngine
+	} EXEC_ENGINE, * PEXEC_ENGINE;
+
+	//
+	// Define execution statistics, collected only while enabled (for the
+	// benchmark test mode).  Action time is in performance counter ticks and
+	// excludes nested action calls made from scripts invoked by actions.
+	//
+
+	struct ExecutionStats
+	{
+		ULONGLONG ActionCalls;
+		ULONGLONG ActionTime;
+	};
+
+	//
+	// Define the results of replaying the recorded action calls of a trace
+	// script.  A divergence is an action call that does not match the next
+	// recorded call (the script is aborted at that point); a script that
+	// finishes with recorded calls left over has also diverged.
+	//
+
+	struct ReplayStats
+	{
+		ULONG ActionsReplayed;
+		ULONG ActionsRemaining;
+		ULONG Divergences;
+		ULONG ArgumentMismatches;
+	};
+
+	//
+	// Define the argument and return value of a native action routine.  The
+	// pure math actions have native routines, which take their arguments (in
+	// parameter order) and return their result directly rather than through
+	// a VM stack.  Only int, float, and vector values are supported.
+	//
+
+	enum { MAX_NATIVE_ACTION_ARGS = 4 };
+
+	typedef union _NATIVE_ACTION_VALUE
+	{
+		int          Int;
+		float        Float;
+		NWN::Vector3 Vector;
+	} NATIVE_ACTION_VALUE, * PNATIVE_ACTION_VALUE;
+
+	typedef const union _NATIVE_ACTION_VALUE * PCNATIVE_ACTION_VALUE;
+
+	typedef
+	void
+	(* NativeActionProc)(
+		__in PCNATIVE_ACTION_VALUE Args,
+		__out PNATIVE_ACTION_VALUE Result
+		);
+
 	NWScriptHost(
 		__in ResourceManager & ResMan,
 		__in swutil::TimerManager & TimerManager,
@@ -147,6 +215,145 @@ public:
 		__in NWScriptJITLib::Program::Ptr & ProgramJIT
 		);
 
+	//
+	// Load a script into the script cache ahead of execution, returning true
+	// if the script could be loaded.  JITAvailable receives true if a JIT
+	// program was generated for the script.
+	//
+
+	bool
+	PreloadScript(
+		__in const NWN::ResRef32 & ScriptName,
+		__out bool & JITAvailable
+		);
+
+	//
+	// Select the engine used by subsequent RunScript calls.  If the JIT is
+	// selected but a script has no JIT program, execution fails.
+	//
+
+	inline
+	void
+	SetExecutionEngine(
+		__in EXEC_ENGINE Engine
+		)
+	{
+		m_ExecutionEngine = Engine;
+	}
+
+	//
+	// Enable or disable statistics collection.  While enabled, the per
+	// execution timing message is suppressed.
+	//
+
+	inline
+	void
+	SetCollectStats(
+		__in bool CollectStats
+		)
+	{
+		m_CollectStats = CollectStats;
+	}
+
+	inline
+	const ExecutionStats &
+	GetExecutionStats(
+		) const
+	{
+		return m_Stats;
+	}
+
+	//
+	// Return the cumulative count of instructions executed by the script VM.
+	//
+
+	inline
+	ULONGLONG
+	GetVMInstructionsExecuted(
+		) const
+	{
+		return m_VM->GetTotalInstructionsExecuted( );
+	}
+
+	//
+	// Begin replaying the recorded action calls of one script of an action
+	// trace.  Until EndActionReplay is called, action handlers are not run;
+	// each action call instead consumes the next recorded call of the script,
+	// which supplies the return value.  The trace must remain valid until
+	// EndActionReplay is called.
+	//
+
+	void
+	BeginActionReplay(
+		__in const NWScriptActionTraceReader & Trace,
+		__in size_t ScriptIndex,
+		__in bool VerifyArguments
+		);
+
+	void
+	EndActionReplay(
+		__out ReplayStats & Stats
+		);
+
+	//
+	// Return the native routine of an action, else NULL if the action has
+	// no native routine.
+	//
+
+	inline
+	NativeActionProc
+	GetNativeAction(
+		__in NWSCRIPT_ACTION ActionId
+		) const
+	{
+		if (ActionId >= MAX_ACTION_ID)
+			return NULL;
+
+		return m_ActionHandlerTable[ ActionId ].NativeHandler;
+	}
+
+	inline
+	const char *
+	GetActionName(
+		__in NWSCRIPT_ACTION ActionId
+		) const
+	{
+		if (ActionId >= MAX_ACTION_ID)
+			return "<INVALID>";
+
+		return m_ActionHandlerTable[ ActionId ].ActionName;
+	}
+
+	//
+	// Run the VM stack handler of an action directly against a stack, without
+	// the dispatch bookkeeping of OnExecuteAction.  The action ordinal must be
+	// valid.
+	//
+
+	inline
+	void
+	InvokeActionHandler(
+		__in NWScriptStack & VMStack,
+		__in NWSCRIPT_ACTION ActionId,
+		__in size_t NumArguments
+		)
+	{
+		(this->*m_ActionHandlerTable[ ActionId ].ActionHandler)(
+			*m_VM,
+			VMStack,
+			ActionId,
+			NumArguments);
+	}
+
+	//
+	// Discard all pending and scheduled deferred script situations without
+	// running them.
+	//
+
+	void
+	DiscardDeferredScriptSituations(
+		);
+
 	//
 	// Clear the script cache.
 	//
@@ -307,6 +514,7 @@ private:
 	struct NWScriptActionEntry
 	{
 		OnScriptActionProc   ActionHandler;
+		NativeActionProc     NativeHandler;
 		NWSCRIPT_ACTION      ActionId;
 		const char         * ActionName;
 	};
@@ -327,6 +535,7 @@ private:
 	    __in size_t NumArguments             \
 	    );                                   \
 	                                         \
+	enum { ActionOrdinal_##Name = Ordinal }; \
 	C_ASSERT( Ordinal < MAX_ACTION_ID );     
 
 #include "NWScriptActionDefs.h"
@@ -340,6 +549,41 @@ private:
 	RegisterActions(
 		);
 
+	//
+	// Register the native routines of the pure math actions.
+	//
+
+	void
+	RegisterNativeActions(
+		);
+
+	//
+	// Execute a native action routine, marshalling its arguments and return
+	// value through a VM stack.
+	//
+
+	void
+	ExecuteNativeAction(
+		__in NWScriptStack & VMStack,
+		__in NWSCRIPT_ACTION ActionId,
+		__in NativeActionProc NativeHandler
+		);
+
+	//
+	// Execute a native action routine for a fast action call, taking the
+	// arguments from and returning the result to the command parameters
+	// directly, without using the JIT VM stack.
+	//
+
+	void
+	ExecuteNativeActionFast(
+		__in NWSCRIPT_ACTION ActionId,
+		__in NativeActionProc NativeHandler,
+		__in_ecount( NumCmds ) PCNWFASTACTION_CMD Cmds,
+		__in size_t NumCmds,
+		__in uintptr_t * CmdParams
+		);
+
 	//
 	// Locate a script by name (from the cache map or from disk if it has not
 	// yet been loaded).
@@ -385,6 +629,62 @@ private:
 			return ObjectId | NWN::LISTTYPE_MASK;
 	}
 
+	//
+	// Account for an action call in the execution statistics.  The returned
+	// value is passed to EndActionStats once the action returns.
+	//
+
+	inline
+	ULONGLONG
+	BeginActionStats(
+		)
+	{
+		LARGE_INTEGER Counter;
+
+		if (!m_CollectStats)
+			return 0;
+
+		m_Stats.ActionCalls += 1;
+
+		if (m_ActionDepth++ != 0)
+			return 0;
+
+		QueryPerformanceCounter( &Counter );
+
+		return (ULONGLONG) Counter.QuadPart;
+	}
+
+	inline
+	void
+	EndActionStats(
+		__in ULONGLONG StartTime
+		)
+	{
+		LARGE_INTEGER Counter;
+
+		if (!m_CollectStats)
+			return;
+
+		if (--m_ActionDepth != 0)
+			return;
+
+		QueryPerformanceCounter( &Counter );
+
+		m_Stats.ActionTime += (ULONGLONG) Counter.QuadPart - StartTime;
+	}
+
+	//
+	// Replay the next recorded action call in place of an action handler.
+	//
+
+	void
+	ReplayAction(
+		__in NWScriptVM & ScriptVM,
+		__in NWScriptStack & VMStack,
+		__in NWSCRIPT_ACTION ActionId,
+		__in size_t NumArguments
+		);
+
 	//
 	// Return the object id of the current action object.
 	//
@@ -515,6 +815,29 @@ private:
 
 	NWN::OBJECTID                    m_CurrentSelfObjectId;
 
+	//
+	// Define the engine selection and statistics state used by the benchmark
+	// test mode.
+	//
+
+	EXEC_ENGINE                      m_ExecutionEngine;
+	bool                             m_CollectStats;
+	ULONG                            m_ActionDepth;
+	ExecutionStats                   m_Stats;
+
+	//
+	// Define the action trace recording and replay state.  Only action calls
+	// made by the script VM are recorded, so scripts are run under the VM
+	// while a trace is being recorded.
+	//
+
+	NWScriptActionTraceWriter        m_TraceWriter;
+	const NWScriptActionTraceReader * m_ReplayTrace;
+	size_t                           m_ReplayNextAction;
+	size_t                           m_ReplayEndAction;
+	bool                             m_ReplayVerify;
+	ReplayStats                      m_ReplayStats;
+
 	//
 	// Define the action handler table, which is dispatched by the core
 	// OnExecuteAction routine.
@@ -572,6 +895,12 @@ public:
 		return (m_EffectType == Eff->m_EffectType);
 	}
 
+	//
+	// Effects are allocated from the engine structure pool.
+	//
+
+	DECLARE_ENGINE_STRUCTURE_POOLED_NEW( );
+
 private:
 
 	ULONG m_EffectType;
@@ -604,6 +933,36 @@ typedef swutil::SharedPtr< EngEffect > EngEffectPtr;
 	    __in NWSCRIPT_ACTION ActionId,                         \
 	    __in size_t NumArguments                               \
 	    )                                                      
+
+//
+// This macro defines an NWScript implementation routine for a pure action
+// that has a native routine.  The VM stack handler is generated, and the
+// macro is followed by the body of the native routine, which reads Args and
+// writes Result.
+//
+
+#define SCRIPT_NATIVE_ACTION( Name )                           \
+	static                                                     \
+	void                                                       \
+	NativeAction_##Name(                                       \
+	    __in NWScriptHost::PCNATIVE_ACTION_VALUE Args,         \
+	    __out NWScriptHost::PNATIVE_ACTION_VALUE Result        \
+	    );                                                     \
+	                                                           \
+	SCRIPT_ACTION( Name )                                      \
+	{                                                          \
+	    ExecuteNativeAction(                                   \
+	        VMStack,                                           \
+	        ActionId,                                          \
+	        NativeAction_##Name);                              \
+	}                                                          \
+	                                                           \
+	static                                                     \
+	void                                                       \
+	NativeAction_##Name(                                       \
+	    __in NWScriptHost::PCNATIVE_ACTION_VALUE Args,         \
+	    __out NWScriptHost::PNATIVE_ACTION_VALUE Result        \
+	    )
 #endif
 
 
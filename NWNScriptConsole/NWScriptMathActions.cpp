@@ -17,6 +17,7 @@ Abstract:
 #include "../NWN2MathLib/NWN2MathLib.h"
 #define NWSCRIPTHOST_INTERNAL
 #include "NWScriptHost.h"
+#include "../NWNScriptLib/NWScriptAnalyzer.h"
 
 enum { MAX_DICE = 100 };
 
@@ -93,7 +94,7 @@ Environment:
 	VMStack.StackPushInt( RandValue );
 }
 
-SCRIPT_ACTION( VectorNormalize )
+SCRIPT_NATIVE_ACTION( VectorNormalize )
 /*++
 
 Routine Description:
@@ -114,12 +115,10 @@ Environment:
 
 --*/
 {
-	NWN::Vector3 v = VMStack.StackPopVector( );
-
-	VMStack.StackPushVector( Math::NormalizeVector( v ) );
+	Result->Vector = Math::NormalizeVector( Args[ 0 ].Vector );
 }
 
-SCRIPT_ACTION( AngleToVector )
+SCRIPT_NATIVE_ACTION( AngleToVector )
 /*++
 
 Routine Description:
@@ -140,17 +139,14 @@ Environment:
 
 --*/
 {
-	float        fAngle = VMStack.StackPopFloat( ) * (PI / 180.0f);
-	NWN::Vector3 Heading;
-
-	Heading.x = cos( fAngle );
-	Heading.y = sin( fAngle );
-	Heading.z = 0.0f;
+	float fAngle = Args[ 0 ].Float * (PI / 180.0f);
 
-	VMStack.StackPushVector( Heading );
+	Result->Vector.x = cos( fAngle );
+	Result->Vector.y = sin( fAngle );
+	Result->Vector.z = 0.0f;
 }
 
-SCRIPT_ACTION( VectorToAngle )
+SCRIPT_NATIVE_ACTION( VectorToAngle )
 /*++
 
 Routine Description:
@@ -171,12 +167,12 @@ Environment:
 
 --*/
 {
-	NWN::Vector3 vVector = VMStack.StackPopVector( );
+	const NWN::Vector3 & vVector = Args[ 0 ].Vector;
 
-	VMStack.StackPushFloat( atan2f( vVector.y, vVector.x ) * 180.0f / PI );
+	Result->Float = atan2f( vVector.y, vVector.x ) * 180.0f / PI;
 }
 
-SCRIPT_ACTION( FeetToMeters )
+SCRIPT_NATIVE_ACTION( FeetToMeters )
 /*++
 
 Routine Description:
@@ -197,12 +193,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		VMStack.StackPopFloat( ) * 0.3048f
-		);
+	Result->Float = Args[ 0 ].Float * 0.3048f;
 }
 
-SCRIPT_ACTION( YardsToMeters )
+SCRIPT_NATIVE_ACTION( YardsToMeters )
 /*++
 
 Routine Description:
@@ -223,12 +217,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		VMStack.StackPopFloat( ) * 0.9144f
-		);
+	Result->Float = Args[ 0 ].Float * 0.9144f;
 }
 
-SCRIPT_ACTION( VectorMagnitude )
+SCRIPT_NATIVE_ACTION( VectorMagnitude )
 /*++
 
 Routine Description:
@@ -249,9 +241,7 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		Math::Magnitude( VMStack.StackPopVector( ) )
-		);
+	Result->Float = Math::Magnitude( Args[ 0 ].Vector );
 }
 
 SCRIPT_ACTION( d2 )
@@ -515,7 +505,7 @@ Environment:
 	VMStack.StackPushInt( RollDice( (unsigned long) nNumDice, 100 ) );
 }
 
-SCRIPT_ACTION( RoundsToSeconds )
+SCRIPT_NATIVE_ACTION( RoundsToSeconds )
 /*++
 
 Routine Description:
@@ -536,12 +526,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		VMStack.StackPopInt( ) * 6.0f
-		);
+	Result->Float = Args[ 0 ].Int * 6.0f;
 }
 
-SCRIPT_ACTION( HoursToSeconds )
+SCRIPT_NATIVE_ACTION( HoursToSeconds )
 /*++
 
 Routine Description:
@@ -562,12 +550,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		(float) VMStack.StackPopInt( ) * 60 * 60
-		);
+	Result->Float = (float) Args[ 0 ].Int * 60 * 60;
 }
 
-SCRIPT_ACTION( TurnsToSeconds )
+SCRIPT_NATIVE_ACTION( TurnsToSeconds )
 /*++
 
 Routine Description:
@@ -588,12 +574,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat(
-		VMStack.StackPopInt( ) * 60.0f
-		);
+	Result->Float = Args[ 0 ].Int * 60.0f;
 }
 
-SCRIPT_ACTION( abs )
+SCRIPT_NATIVE_ACTION( abs )
 /*++
 
 Routine Description:
@@ -614,10 +598,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushInt( std::abs( VMStack.StackPopInt( ) ) );
+	Result->Int = std::abs( Args[ 0 ].Int );
 }
 
-SCRIPT_ACTION( fabs )
+SCRIPT_NATIVE_ACTION( fabs )
 /*++
 
 Routine Description:
@@ -638,10 +622,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat( std::abs( VMStack.StackPopFloat( ) ) );
+	Result->Float = std::abs( Args[ 0 ].Float );
 }
 
-SCRIPT_ACTION( cos )
+SCRIPT_NATIVE_ACTION( cos )
 /*++
 
 Routine Description:
@@ -662,10 +646,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat( std::cos( VMStack.StackPopFloat( ) ) );
+	Result->Float = std::cos( Args[ 0 ].Float );
 }
 
-SCRIPT_ACTION( sin )
+SCRIPT_NATIVE_ACTION( sin )
 /*++
 
 Routine Description:
@@ -686,10 +670,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat( std::sin( VMStack.StackPopFloat( ) ) );
+	Result->Float = std::sin( Args[ 0 ].Float );
 }
 
-SCRIPT_ACTION( tan )
+SCRIPT_NATIVE_ACTION( tan )
 /*++
 
 Routine Description:
@@ -710,10 +694,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat( std::tan( VMStack.StackPopFloat( ) ) );
+	Result->Float = std::tan( Args[ 0 ].Float );
 }
 
-SCRIPT_ACTION( acos )
+SCRIPT_NATIVE_ACTION( acos )
 /*++
 
 Routine Description:
@@ -734,19 +718,15 @@ Environment:
 
 --*/
 {
-	float nFloat = VMStack.StackPopFloat( );
+	float nFloat = Args[ 0 ].Float;
 
 	if ((nFloat > 1) || (nFloat < -1))
-	{
-		VMStack.StackPushFloat( 0.0f );
-	}
+		Result->Float = 0.0f;
 	else
-	{
-		VMStack.StackPushFloat( std::acos( nFloat ) );
-	}
+		Result->Float = std::acos( nFloat );
 }
 
-SCRIPT_ACTION( asin )
+SCRIPT_NATIVE_ACTION( asin )
 /*++
 
 Routine Description:
@@ -767,19 +747,15 @@ Environment:
 
 --*/
 {
-	float nFloat = VMStack.StackPopFloat( );
+	float nFloat = Args[ 0 ].Float;
 
 	if ((nFloat > 1) || (nFloat < -1))
-	{
-		VMStack.StackPushFloat( 0.0f );
-	}
+		Result->Float = 0.0f;
 	else
-	{
-		VMStack.StackPushFloat( std::asin( nFloat ) );
-	}
+		Result->Float = std::asin( nFloat );
 }
 
-SCRIPT_ACTION( atan )
+SCRIPT_NATIVE_ACTION( atan )
 /*++
 
 Routine Description:
@@ -800,10 +776,10 @@ Environment:
 
 --*/
 {
-	VMStack.StackPushFloat( std::atan( VMStack.StackPopFloat( ) ) );
+	Result->Float = std::atan( Args[ 0 ].Float );
 }
 
-SCRIPT_ACTION( log )
+SCRIPT_NATIVE_ACTION( log )
 /*++
 
 Routine Description:
@@ -824,19 +800,15 @@ Environment:
 
 --*/
 {
-	float nFloat = VMStack.StackPopFloat();
+	float nFloat = Args[ 0 ].Float;
 
 	if (nFloat <= 0)
-	{
-		VMStack.StackPushFloat( 0 );
-	}
+		Result->Float = 0.0f;
 	else
-	{
-		VMStack.StackPushFloat( std::log( nFloat ) );
-	}
+		Result->Float = std::log( nFloat );
 }
 
-SCRIPT_ACTION( pow )
+SCRIPT_NATIVE_ACTION( pow )
 /*++
 
 Routine Description:
@@ -859,20 +831,16 @@ Environment:
 
 --*/
 {
-	float fBase = VMStack.StackPopFloat( );
-	float fExponent = VMStack.StackPopFloat( );
-	
+	float fBase = Args[ 0 ].Float;
+	float fExponent = Args[ 1 ].Float;
+
 	if ((fBase == 0) || (fExponent < 0))
-	{
-		VMStack.StackPushFloat( 0.0f );
-	}
+		Result->Float = 0.0f;
 	else
-	{
-		VMStack.StackPushFloat( std::pow( fBase, fExponent ) );
-	}
+		Result->Float = std::pow( fBase, fExponent );
 }
 
-SCRIPT_ACTION( sqrt )
+SCRIPT_NATIVE_ACTION( sqrt )
 /*++
 
 Routine Description:
@@ -893,14 +861,74 @@ Environment:
 
 --*/
 {
-	float fValue = VMStack.StackPopFloat( );
-	
+	float fValue = Args[ 0 ].Float;
+
 	if (fValue < 0)
-	{
-		VMStack.StackPushFloat( 0.0f );
-	}
+		Result->Float = 0.0f;
 	else
+		Result->Float = std::sqrt( fValue );
+}
+
+void
+NWScriptHost::RegisterNativeActions(
+	)
+/*++
+
+Routine Description:
+
+	This routine is called to register the native routines of the pure math
+	actions in the action handler table.  Fast action calls from the JIT to
+	these actions invoke the native routine directly.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, script host initialization time only.
+
+--*/
+{
+	static const struct
+	{
+		NWSCRIPT_ACTION  ActionId;
+		NativeActionProc NativeHandler;
+	} NativeActions[ ] =
+	{
+		{ ActionOrdinal_VectorNormalize, NativeAction_VectorNormalize },
+		{ ActionOrdinal_AngleToVector,   NativeAction_AngleToVector   },
+		{ ActionOrdinal_VectorToAngle,   NativeAction_VectorToAngle   },
+		{ ActionOrdinal_FeetToMeters,    NativeAction_FeetToMeters    },
+		{ ActionOrdinal_YardsToMeters,   NativeAction_YardsToMeters   },
+		{ ActionOrdinal_VectorMagnitude, NativeAction_VectorMagnitude },
+		{ ActionOrdinal_RoundsToSeconds, NativeAction_RoundsToSeconds },
+		{ ActionOrdinal_HoursToSeconds,  NativeAction_HoursToSeconds  },
+		{ ActionOrdinal_TurnsToSeconds,  NativeAction_TurnsToSeconds  },
+		{ ActionOrdinal_abs,             NativeAction_abs             },
+		{ ActionOrdinal_fabs,            NativeAction_fabs            },
+		{ ActionOrdinal_cos,             NativeAction_cos             },
+		{ ActionOrdinal_sin,             NativeAction_sin             },
+		{ ActionOrdinal_tan,             NativeAction_tan             },
+		{ ActionOrdinal_acos,            NativeAction_acos            },
+		{ ActionOrdinal_asin,            NativeAction_asin            },
+		{ ActionOrdinal_atan,            NativeAction_atan            },
+		{ ActionOrdinal_log,             NativeAction_log             },
+		{ ActionOrdinal_pow,             NativeAction_pow             },
+		{ ActionOrdinal_sqrt,            NativeAction_sqrt            }
+	};
+
+	for (size_t i = 0; i < RTL_NUMBER_OF( NativeActions ); i += 1)
 	{
-		VMStack.StackPushFloat( std::sqrt( fValue ) );
+		NWSCRIPT_ACTION ActionId = NativeActions[ i ].ActionId;
+
+		if (NWActions_NWN2[ ActionId ].NumParameters > MAX_NATIVE_ACTION_ARGS)
+			throw std::runtime_error( "Native action has too many parameters." );
+
+		m_ActionHandlerTable[ ActionId ].NativeHandler = NativeActions[ i ].NativeHandler;
 	}
 }
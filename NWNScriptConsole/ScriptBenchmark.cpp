@@ -0,0 +1,789 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ScriptBenchmark.cpp
+
+Abstract:
+
+	This module houses the script corpus benchmark.  Each compiled script in
+	the module is run a number of warm-up times and then a number of timed
+	times under each execution engine, and the execution time, instruction
+	count, heap allocation count and action service overhead are recorded.
+
+--*/
+
+#include "Precomp.h"
+#include "NWScriptHost.h"
+#include "ScriptBenchmark.h"
+
+//
+// Count the allocations made through the global operator new of this program
+// while the timed runs of a benchmark are in progress.  Outside of those runs
+// only the flag is tested, so that other commands do not pay for an
+// interlocked operation on every allocation.  The replacement allocates from
+// the same CRT heap as the default operator new, so memory may still be freed
+// by either.
+//
+
+static volatile LONG g_AllocationCount;
+static volatile LONG g_CountAllocations;
+
+void *
+__cdecl
+operator new(
+	__in size_t s
+	)
+{
+	void * p;
+
+	if (g_CountAllocations)
+		InterlockedIncrement( &g_AllocationCount );
+
+	p = malloc( s ? s : 1 );
+
+	if (p == NULL)
+		throw std::bad_alloc( );
+
+	return p;
+}
+
+void
+__cdecl
+operator delete(
+	__in void * p
+	)
+{
+	free( p );
+}
+
+void *
+__cdecl
+operator new[ ](
+	__in size_t s
+	)
+{
+	void * p;
+
+	if (g_CountAllocations)
+		InterlockedIncrement( &g_AllocationCount );
+
+	p = malloc( s ? s : 1 );
+
+	if (p == NULL)
+		throw std::bad_alloc( );
+
+	return p;
+}
+
+void
+__cdecl
+operator delete[ ](
+	__in void * p
+	)
+{
+	free( p );
+}
+
+ScriptBenchmark::ScriptBenchmark(
+	__in ResourceManager & ResMan,
+	__in NWScriptHost * ScriptHost,
+	__in IDebugTextOut * TextOut,
+	__in ULONG Runs,
+	__in ULONG WarmupRuns
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new script benchmark.
+
+Arguments:
+
+	ResMan - Supplies the resource manager whose compiled scripts are to be
+	         benchmarked.
+
+	ScriptHost - Supplies the script host used to execute the scripts.
+
+	TextOut - Supplies the text out interface used for status output.
+
+	Runs - Supplies the count of timed runs per script and engine.
+
+	WarmupRuns - Supplies the count of untimed runs per script and engine
+	             that precede the timed runs.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ResMan( ResMan ),
+  m_ScriptHost( ScriptHost ),
+  m_TextOut( TextOut ),
+  m_Runs( Runs ? Runs : 1 ),
+  m_WarmupRuns( WarmupRuns )
+{
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+ScriptBenchmark::~ScriptBenchmark(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the script benchmark.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+bool
+ScriptBenchmark::Run(
+	__in const std::string & ResultsFile
+	)
+/*++
+
+Routine Description:
+
+	This routine benchmarks every compiled script in the module and writes
+	the results file.
+
+	The reference VM is measured first for each script, as it is the only
+	engine that counts instructions; the instruction count is then used to
+	normalize the other engines' timings.
+
+Arguments:
+
+	ResultsFile - Supplies the name of the results file, or an empty string
+	              if only the summary is to be printed.
+
+Return Value:
+
+	The routine returns true on success, else false if the results file could
+	not be written.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	EngineResult Totals[ BenchEngineMax ];
+	bool         Json;
+	bool         Status;
+	FILE       * f;
+
+	m_Scripts.clear( );
+	ZeroMemory( Totals, sizeof( Totals ) );
+
+	m_TextOut->WriteText(
+		"Benchmarking compiled scripts (%lu warm-up run(s), %lu timed run(s) per engine)...\n",
+		m_WarmupRuns,
+		m_Runs);
+
+	for (ResourceManager::FileId Id = m_ResMan.GetEncapsulatedFileCount( );
+		 Id != 0;
+		 Id -= 1)
+	{
+		NWN::ResRef32 ResRef;
+		NWN::ResType  ResType;
+		bool          JITAvailable;
+
+		if (!m_ResMan.GetEncapsulatedFileEntry( (Id - 1), ResRef, ResType ))
+			continue;
+
+		if (ResType != NWN::ResNCS)
+			continue;
+
+		m_Scripts.push_back( ScriptResult( ) );
+
+		ScriptResult & Result = m_Scripts.back( );
+
+		Result.Name = m_ResMan.StrFromResRef( ResRef );
+		ZeroMemory( Result.Engines, sizeof( Result.Engines ) );
+
+		Result.Loaded = m_ScriptHost->PreloadScript( ResRef, JITAvailable );
+
+		if (!Result.Loaded)
+			continue;
+
+		MeasureScript( ResRef, BenchEngineVM, Result );
+
+		if (JITAvailable)
+			MeasureScript( ResRef, BenchEngineJIT, Result );
+
+		for (int Engine = 0; Engine < BenchEngineMax; Engine += 1)
+		{
+			const EngineResult & ThisResult = Result.Engines[ Engine ];
+
+			if (!ThisResult.Measured)
+				continue;
+
+			Totals[ Engine ].Measured      = true;
+			Totals[ Engine ].Runs         += ThisResult.Runs;
+			Totals[ Engine ].Time         += ThisResult.Time;
+			Totals[ Engine ].Instructions += ThisResult.Instructions * ThisResult.Runs;
+			Totals[ Engine ].Allocations  += ThisResult.Allocations;
+			Totals[ Engine ].ActionCalls  += ThisResult.ActionCalls;
+			Totals[ Engine ].ActionTime   += ThisResult.ActionTime;
+		}
+	}
+
+	//
+	// Print the per-engine summary.  The totals carry the instruction count of
+	// all runs, so normalize them to a single run for GetRates.
+	//
+
+	for (int Engine = 0; Engine < BenchEngineMax; Engine += 1)
+	{
+		double NsPerRun;
+		double NsPerInstruction;
+		double InstructionsPerSecond;
+		double AllocationsPerRun;
+		double ActionCallsPerRun;
+		double NsPerAction;
+
+		if (!Totals[ Engine ].Measured)
+		{
+			m_TextOut->WriteText(
+				"%-4s: not available.\n",
+				GetEngineName( (BENCH_ENGINE) Engine ));
+			continue;
+		}
+
+		if (Totals[ Engine ].Runs != 0)
+			Totals[ Engine ].Instructions /= Totals[ Engine ].Runs;
+
+		GetRates(
+			Totals[ Engine ],
+			NsPerRun,
+			NsPerInstruction,
+			InstructionsPerSecond,
+			AllocationsPerRun,
+			ActionCallsPerRun,
+			NsPerAction);
+
+		m_TextOut->WriteText(
+			"%-4s: %lu run(s), %I64ums, %.2f ns/instruction, %.0f instructions/s, %.1f allocations/run, %.1f actions/run, %.0f ns/action.\n",
+			GetEngineName( (BENCH_ENGINE) Engine ),
+			Totals[ Engine ].Runs,
+			Totals[ Engine ].Time / 1000,
+			NsPerInstruction,
+			InstructionsPerSecond,
+			AllocationsPerRun,
+			ActionCallsPerRun,
+			NsPerAction);
+	}
+
+	if (ResultsFile.empty( ))
+		return true;
+
+	Json = ((ResultsFile.size( ) >= 5) &&
+	        (!_stricmp( ResultsFile.c_str( ) + ResultsFile.size( ) - 5, ".json" )));
+
+	f = fopen( ResultsFile.c_str( ), "wt" );
+
+	if (f == NULL)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Unable to open benchmark results file '%s'.\n",
+			ResultsFile.c_str( ));
+
+		return false;
+	}
+
+	if (Json)
+		Status = WriteJson( f );
+	else
+		Status = WriteCsv( f );
+
+	if (fclose( f ) != 0)
+		Status = false;
+
+	if (!Status)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Failed to write benchmark results file '%s'.\n",
+			ResultsFile.c_str( ));
+	}
+	else
+	{
+		m_TextOut->WriteText(
+			"Wrote benchmark results for %lu script(s) to '%s'.\n",
+			(unsigned long) m_Scripts.size( ),
+			ResultsFile.c_str( ));
+	}
+
+	return Status;
+}
+
+ULONG
+ScriptBenchmark::GetAllocationCount(
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the running count of operator new allocations made
+	while allocation counting was enabled.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The allocation count, which wraps at 2^32.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	return (ULONG) g_AllocationCount;
+}
+
+void
+ScriptBenchmark::MeasureScript(
+	__in const NWN::ResRef32 & ResRef,
+	__in BENCH_ENGINE Engine,
+	__inout ScriptResult & Result
+	)
+/*++
+
+Routine Description:
+
+	This routine runs a script under one engine, first untimed for the
+	warm-up runs and then timed, and records the counters of the timed runs.
+
+	Deferred script situations (DelayCommand and the like) created by the
+	script are discarded after each run, so that they neither accumulate
+	across runs nor run after the benchmark.
+
+Arguments:
+
+	ResRef - Supplies the script to run.
+
+	Engine - Supplies the engine to run the script under.
+
+	Result - Receives the counters for the engine.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	EngineResult                      & ThisResult = Result.Engines[ Engine ];
+	NWScriptHost::ExecutionStats        StartStats;
+	ULONGLONG                           StartInstructions;
+	ULONGLONG                           Time;
+	ULONG                               StartAllocations;
+	LARGE_INTEGER                       Start;
+	LARGE_INTEGER                       End;
+
+	m_ScriptHost->SetExecutionEngine(
+		(Engine == BenchEngineVM) ? NWScriptHost::ExecEngineVM : NWScriptHost::ExecEngineJIT);
+	m_ScriptHost->SetCollectStats( true );
+
+	for (ULONG i = 0; i < m_WarmupRuns; i += 1)
+	{
+		m_ScriptHost->RunScript( ResRef );
+		m_ScriptHost->DiscardDeferredScriptSituations( );
+	}
+
+	StartStats        = m_ScriptHost->GetExecutionStats( );
+	StartInstructions = m_ScriptHost->GetVMInstructionsExecuted( );
+	StartAllocations  = GetAllocationCount( );
+	Time              = 0;
+
+	InterlockedExchange( &g_CountAllocations, TRUE );
+
+	for (ULONG i = 0; i < m_Runs; i += 1)
+	{
+		QueryPerformanceCounter( &Start );
+
+		m_ScriptHost->RunScript( ResRef );
+
+		QueryPerformanceCounter( &End );
+
+		Time += (ULONGLONG) (End.QuadPart - Start.QuadPart);
+
+		m_ScriptHost->DiscardDeferredScriptSituations( );
+	}
+
+	InterlockedExchange( &g_CountAllocations, FALSE );
+
+	ThisResult.Measured    = true;
+	ThisResult.Runs        = m_Runs;
+	ThisResult.Time        = TicksToMicroseconds( Time );
+	ThisResult.Allocations = (ULONG) (GetAllocationCount( ) - StartAllocations);
+	ThisResult.ActionCalls = m_ScriptHost->GetExecutionStats( ).ActionCalls - StartStats.ActionCalls;
+	ThisResult.ActionTime  = TicksToMicroseconds(
+		m_ScriptHost->GetExecutionStats( ).ActionTime - StartStats.ActionTime);
+
+	//
+	// Only the reference VM counts instructions.  Other engines execute the
+	// same program, so they are normalized against the VM's count.
+	//
+
+	if (Engine == BenchEngineVM)
+	{
+		ThisResult.Instructions =
+			(m_ScriptHost->GetVMInstructionsExecuted( ) - StartInstructions) / m_Runs;
+	}
+	else
+	{
+		ThisResult.Instructions = Result.Engines[ BenchEngineVM ].Instructions;
+	}
+
+	m_ScriptHost->SetCollectStats( false );
+	m_ScriptHost->SetExecutionEngine( NWScriptHost::ExecEngineDefault );
+}
+
+bool
+ScriptBenchmark::WriteCsv(
+	__in FILE * f
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the results as CSV, one row per script and engine.
+
+Arguments:
+
+	f - Supplies the results file.
+
+Return Value:
+
+	The routine returns true on success.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (fprintf(
+		f,
+		"script,engine,runs,time_us,instructions_per_run,ns_per_run,ns_per_instruction,"
+		"instructions_per_second,allocations_per_run,actions_per_run,ns_per_action\n") < 0)
+	{
+		return false;
+	}
+
+	for (ScriptResultVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		for (int Engine = 0; Engine < BenchEngineMax; Engine += 1)
+		{
+			const EngineResult & Result = it->Engines[ Engine ];
+			double               NsPerRun;
+			double               NsPerInstruction;
+			double               InstructionsPerSecond;
+			double               AllocationsPerRun;
+			double               ActionCallsPerRun;
+			double               NsPerAction;
+
+			if (!Result.Measured)
+				continue;
+
+			GetRates(
+				Result,
+				NsPerRun,
+				NsPerInstruction,
+				InstructionsPerSecond,
+				AllocationsPerRun,
+				ActionCallsPerRun,
+				NsPerAction);
+
+			if (fprintf(
+				f,
+				"%s,%s,%lu,%I64u,%I64u,%.1f,%.3f,%.0f,%.2f,%.2f,%.1f\n",
+				it->Name.c_str( ),
+				GetEngineName( (BENCH_ENGINE) Engine ),
+				Result.Runs,
+				Result.Time,
+				Result.Instructions,
+				NsPerRun,
+				NsPerInstruction,
+				InstructionsPerSecond,
+				AllocationsPerRun,
+				ActionCallsPerRun,
+				NsPerAction) < 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool
+ScriptBenchmark::WriteJson(
+	__in FILE * f
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the results as JSON.  Script names are resource names
+	and therefore need no escaping.
+
+Arguments:
+
+	f - Supplies the results file.
+
+Return Value:
+
+	The routine returns true on success.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	bool FirstScript;
+
+	if (fprintf(
+		f,
+		"{\n  \"warmupRuns\": %lu,\n  \"runs\": %lu,\n  \"scripts\": [",
+		m_WarmupRuns,
+		m_Runs) < 0)
+	{
+		return false;
+	}
+
+	FirstScript = true;
+
+	for (ScriptResultVec::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		bool FirstEngine;
+
+		if (fprintf(
+			f,
+			"%s\n    { \"name\": \"%s\", \"loaded\": %s, \"engines\": [",
+			FirstScript ? "" : ",",
+			it->Name.c_str( ),
+			it->Loaded ? "true" : "false") < 0)
+		{
+			return false;
+		}
+
+		FirstScript = false;
+		FirstEngine = true;
+
+		for (int Engine = 0; Engine < BenchEngineMax; Engine += 1)
+		{
+			const EngineResult & Result = it->Engines[ Engine ];
+			double               NsPerRun;
+			double               NsPerInstruction;
+			double               InstructionsPerSecond;
+			double               AllocationsPerRun;
+			double               ActionCallsPerRun;
+			double               NsPerAction;
+
+			if (!Result.Measured)
+				continue;
+
+			GetRates(
+				Result,
+				NsPerRun,
+				NsPerInstruction,
+				InstructionsPerSecond,
+				AllocationsPerRun,
+				ActionCallsPerRun,
+				NsPerAction);
+
+			if (fprintf(
+				f,
+				"%s\n      { \"engine\": \"%s\", \"runs\": %lu, \"timeUs\": %I64u, "
+				"\"instructionsPerRun\": %I64u, \"nsPerRun\": %.1f, "
+				"\"nsPerInstruction\": %.3f, \"instructionsPerSecond\": %.0f, "
+				"\"allocationsPerRun\": %.2f, \"actionsPerRun\": %.2f, "
+				"\"nsPerAction\": %.1f }",
+				FirstEngine ? "" : ",",
+				GetEngineName( (BENCH_ENGINE) Engine ),
+				Result.Runs,
+				Result.Time,
+				Result.Instructions,
+				NsPerRun,
+				NsPerInstruction,
+				InstructionsPerSecond,
+				AllocationsPerRun,
+				ActionCallsPerRun,
+				NsPerAction) < 0)
+			{
+				return false;
+			}
+
+			FirstEngine = false;
+		}
+
+		if (fprintf( f, " ] }" ) < 0)
+			return false;
+	}
+
+	if (fprintf( f, "\n  ]\n}\n" ) < 0)
+		return false;
+
+	return true;
+}
+
+void
+ScriptBenchmark::GetRates(
+	__in const EngineResult & Result,
+	__out double & NsPerRun,
+	__out double & NsPerInstruction,
+	__out double & InstructionsPerSecond,
+	__out double & AllocationsPerRun,
+	__out double & ActionCallsPerRun,
+	__out double & NsPerAction
+	)
+/*++
+
+Routine Description:
+
+	This routine derives the reported rates from the raw counters.  Rates
+	whose denominator is zero are reported as zero.
+
+Arguments:
+
+	Result - Supplies the raw counters.
+
+	NsPerRun - Receives the mean time per run, in nanoseconds.
+
+	NsPerInstruction - Receives the mean time per instruction.
+
+	InstructionsPerSecond - Receives the instruction throughput.
+
+	AllocationsPerRun - Receives the mean allocation count per run.
+
+	ActionCallsPerRun - Receives the mean action call count per run.
+
+	NsPerAction - Receives the mean time spent in each action call.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	double TimeNs       = (double) Result.Time * 1000.0;
+	double Instructions = (double) Result.Instructions * (double) Result.Runs;
+
+	NsPerRun              = (Result.Runs != 0) ? TimeNs / (double) Result.Runs : 0.0;
+	NsPerInstruction      = (Instructions != 0.0) ? TimeNs / Instructions : 0.0;
+	InstructionsPerSecond = (TimeNs != 0.0) ? Instructions * 1000000000.0 / TimeNs : 0.0;
+	AllocationsPerRun     = (Result.Runs != 0) ? (double) Result.Allocations / (double) Result.Runs : 0.0;
+	ActionCallsPerRun     = (Result.Runs != 0) ? (double) Result.ActionCalls / (double) Result.Runs : 0.0;
+	NsPerAction           = (Result.ActionCalls != 0) ? (double) Result.ActionTime * 1000.0 / (double) Result.ActionCalls : 0.0;
+}
+
+const char *
+ScriptBenchmark::GetEngineName(
+	__in BENCH_ENGINE Engine
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the display name of an engine.
+
+Arguments:
+
+	Engine - Supplies the engine.
+
+Return Value:
+
+	The engine name.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Engine)
+	{
+
+	case BenchEngineVM:
+		return "VM";
+
+	case BenchEngineJIT:
+		return "JIT";
+
+	default:
+		return "Unknown";
+
+	}
+}
+
+ULONGLONG
+ScriptBenchmark::TicksToMicroseconds(
+	__in ULONGLONG Ticks
+	) const
+/*++
+
+Routine Description:
+
+	This routine converts performance counter ticks to microseconds.
+
+Arguments:
+
+	Ticks - Supplies the tick count.
+
+Return Value:
+
+	The equivalent count of microseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONGLONG Frequency;
+
+	if (m_Frequency.QuadPart == 0)
+		return 0;
+
+	Frequency = (ULONGLONG) m_Frequency.QuadPart;
+
+	return (Ticks / Frequency) * 1000000 + ((Ticks % Frequency) * 1000000) / Frequency;
+}
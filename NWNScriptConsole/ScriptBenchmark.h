@@ -0,0 +1,168 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ScriptBenchmark.h
+
+Abstract:
+
+	This module defines the script corpus benchmark, which runs every compiled
+	script in the loaded module under each available execution engine and
+	records per-script performance counters to a CSV or JSON results file.
+
+--*/
+
+#ifndef _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_SCRIPTBENCHMARK_H
+#define _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_SCRIPTBENCHMARK_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class AppParameters;
+class NWScriptHost;
+
+class ScriptBenchmark
+{
+
+public:
+
+	ScriptBenchmark(
+		__in ResourceManager & ResMan,
+		__in NWScriptHost * ScriptHost,
+		__in IDebugTextOut * TextOut,
+		__in ULONG Runs,
+		__in ULONG WarmupRuns
+		);
+
+	~ScriptBenchmark(
+		);
+
+	//
+	// Benchmark every compiled script and write the results.  If the results
+	// file name ends in .json, JSON is written; otherwise CSV is written.  An
+	// empty file name only prints the summary.  The routine returns false if
+	// the results could not be written.
+	//
+
+	bool
+	Run(
+		__in const std::string & ResultsFile
+		);
+
+	//
+	// Return the count of heap allocations made through operator new by this
+	// program (including the statically linked script VM) during the timed
+	// runs of a benchmark.
+	//
+
+	static
+	ULONG
+	GetAllocationCount(
+		);
+
+private:
+
+	//
+	// Define the engines that are compared.  The reference VM is always
+	// measured; the JIT is measured when it is installed and could generate
+	// code for the script.
+	//
+
+	typedef enum _BENCH_ENGINE
+	{
+		BenchEngineVM,
+		BenchEngineJIT,
+
+		BenchEngineMax
+	} BENCH_ENGINE, * PBENCH_ENGINE;
+
+	struct EngineResult
+	{
+		bool      Measured;
+		ULONG     Runs;
+		ULONGLONG Time;          // Microseconds, all timed runs
+		ULONGLONG Instructions;  // Per run, as counted by the reference VM
+		ULONGLONG Allocations;   // All timed runs
+		ULONGLONG ActionCalls;   // All timed runs
+		ULONGLONG ActionTime;    // Microseconds, all timed runs
+	};
+
+	struct ScriptResult
+	{
+		std::string  Name;
+		bool         Loaded;
+		EngineResult Engines[ BenchEngineMax ];
+	};
+
+	typedef std::vector< ScriptResult > ScriptResultVec;
+
+	//
+	// Measure one script under one engine.
+	//
+
+	void
+	MeasureScript(
+		__in const NWN::ResRef32 & ResRef,
+		__in BENCH_ENGINE Engine,
+		__inout ScriptResult & Result
+		);
+
+	//
+	// Write the results as CSV or JSON.
+	//
+
+	bool
+	WriteCsv(
+		__in FILE * f
+		);
+
+	bool
+	WriteJson(
+		__in FILE * f
+		);
+
+	//
+	// Compute derived rates for a result.
+	//
+
+	static
+	void
+	GetRates(
+		__in const EngineResult & Result,
+		__out double & NsPerRun,
+		__out double & NsPerInstruction,
+		__out double & InstructionsPerSecond,
+		__out double & AllocationsPerRun,
+		__out double & ActionCallsPerRun,
+		__out double & NsPerAction
+		);
+
+	static
+	const char *
+	GetEngineName(
+		__in BENCH_ENGINE Engine
+		);
+
+	//
+	// Convert performance counter ticks to microseconds.
+	//
+
+	ULONGLONG
+	TicksToMicroseconds(
+		__in ULONGLONG Ticks
+		) const;
+
+	ResourceManager            & m_ResMan;
+	NWScriptHost               * m_ScriptHost;
+	IDebugTextOut              * m_TextOut;
+	ULONG                        m_Runs;
+	ULONG                        m_WarmupRuns;
+	ScriptResultVec              m_Scripts;
+	LARGE_INTEGER                m_Frequency;
+
+};
+
+#endif
@@ -0,0 +1,474 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ScriptReplay.cpp
+
+Abstract:
+
+	This module houses the action trace replay benchmark.  Each script
+	invocation recorded in an action trace (for example, on a live server) is
+	run again under the script VM, with the recorded action results supplied
+	in place of the action handlers, so that a production workload can be
+	timed deterministically without the game server.
+
+--*/
+
+#include "Precomp.h"
+#include "NWScriptHost.h"
+#include "ScriptReplay.h"
+
+ScriptReplay::ScriptReplay(
+	__in NWScriptHost * ScriptHost,
+	__in IDebugTextOut * TextOut,
+	__in ULONG Runs,
+	__in ULONG WarmupRuns,
+	__in bool VerifyArguments
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new action trace replay benchmark.
+
+Arguments:
+
+	ScriptHost - Supplies the script host used to execute the scripts.
+
+	TextOut - Supplies the text out interface used for status output.
+
+	Runs - Supplies the count of timed passes over the trace.
+
+	WarmupRuns - Supplies the count of untimed passes over the trace that
+	             precede the timed passes.
+
+	VerifyArguments - Supplies a Boolean value that indicates true if the
+	                  arguments of each action call are to be compared with
+	                  the recorded arguments.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_ScriptHost( ScriptHost ),
+  m_TextOut( TextOut ),
+  m_Runs( Runs ? Runs : 1 ),
+  m_WarmupRuns( WarmupRuns ),
+  m_VerifyArguments( VerifyArguments )
+{
+	if (!QueryPerformanceFrequency( &m_Frequency ))
+		m_Frequency.QuadPart = 0;
+}
+
+ScriptReplay::~ScriptReplay(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the action trace replay benchmark.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+bool
+ScriptReplay::Run(
+	__in const std::string & TraceFile,
+	__in const std::string & ResultsFile
+	)
+/*++
+
+Routine Description:
+
+	This routine loads an action trace, replays all of its completed script
+	invocations (in recorded order) for each warm-up and timed pass, and
+	writes the results file.
+
+Arguments:
+
+	TraceFile - Supplies the name of the action trace file.
+
+	ResultsFile - Supplies the name of the results file, or an empty string
+	              if only the summary is to be printed.
+
+Return Value:
+
+	The routine returns true on success, else false if the trace could not be
+	loaded, the results could not be written, or the replay diverged.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const NWScriptActionTraceReader::TraceScriptVec * Scripts;
+	ScriptResult                                      Totals;
+	ULONG                                             Skipped;
+	bool                                              Status;
+	bool                                              Written;
+	FILE                                            * f;
+
+	m_Scripts.clear( );
+
+	try
+	{
+		m_Trace.Load( TraceFile.c_str( ) );
+	}
+	catch (std::exception &e)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Unable to load action trace '%s': %s\n",
+			TraceFile.c_str( ),
+			e.what( ));
+
+		return false;
+	}
+
+	Scripts = &m_Trace.GetScripts( );
+	Skipped = 0;
+
+	for (NWScriptActionTraceReader::TraceScriptVec::const_iterator it = Scripts->begin( );
+	     it != Scripts->end( );
+	     ++it)
+	{
+		if (!it->Completed)
+			Skipped += 1;
+	}
+
+	m_TextOut->WriteText(
+		"Replaying %lu script invocation(s) and %lu action call(s) from '%s' (%lu warm-up pass(es), %lu timed pass(es))...\n",
+		(unsigned long) (Scripts->size( ) - Skipped),
+		(unsigned long) m_Trace.GetActionCount( ),
+		TraceFile.c_str( ),
+		m_WarmupRuns,
+		m_Runs);
+
+	if (Skipped != 0)
+	{
+		m_TextOut->WriteText(
+			"WARNING: Skipping %lu script invocation(s) that did not finish while the trace was recorded.\n",
+			Skipped);
+	}
+
+	m_ScriptHost->SetExecutionEngine( NWScriptHost::ExecEngineVM );
+	m_ScriptHost->SetCollectStats( true );
+
+	for (ULONG Pass = 0; Pass < m_WarmupRuns + m_Runs; Pass += 1)
+	{
+		bool Timed = (Pass >= m_WarmupRuns);
+
+		for (size_t i = 0; i < Scripts->size( ); i += 1)
+		{
+			const NWScriptActionTraceReader::TraceScript & Script = (*Scripts)[ i ];
+
+			if (!Script.Completed)
+				continue;
+
+			if (Timed)
+			{
+				ScriptResultMap::iterator Result = m_Scripts.find( Script.ScriptName );
+
+				if (Result == m_Scripts.end( ))
+				{
+					ScriptResult Empty;
+
+					ZeroMemory( &Empty, sizeof( Empty ) );
+
+					Result = m_Scripts.insert(
+						ScriptResultMap::value_type( Script.ScriptName, Empty ) ).first;
+				}
+
+				ReplayScript( i, &Result->second );
+			}
+			else
+			{
+				ReplayScript( i, NULL );
+			}
+		}
+	}
+
+	m_ScriptHost->SetCollectStats( false );
+	m_ScriptHost->SetExecutionEngine( NWScriptHost::ExecEngineDefault );
+
+	//
+	// Print the summary.
+	//
+
+	ZeroMemory( &Totals, sizeof( Totals ) );
+
+	for (ScriptResultMap::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		Totals.Invocations          += it->second.Invocations;
+		Totals.Time                 += it->second.Time;
+		Totals.Instructions         += it->second.Instructions;
+		Totals.Actions              += it->second.Actions;
+		Totals.StructAllocations    += it->second.StructAllocations;
+		Totals.StructRecycled       += it->second.StructRecycled;
+		Totals.Divergences          += it->second.Divergences;
+		Totals.ArgumentMismatches   += it->second.ArgumentMismatches;
+		Totals.ReturnCodeMismatches += it->second.ReturnCodeMismatches;
+	}
+
+	{
+		double TimeNs = (double) Totals.Time * 1000.0;
+
+		m_TextOut->WriteText(
+			"Replayed %lu invocation(s) of %lu script(s) in %I64ums: %.0f ns/invocation, %.2f ns/instruction, %.0f instructions/s, %.0f actions/s.\n",
+			Totals.Invocations,
+			(unsigned long) m_Scripts.size( ),
+			Totals.Time / 1000,
+			(Totals.Invocations != 0) ? TimeNs / (double) Totals.Invocations : 0.0,
+			(Totals.Instructions != 0) ? TimeNs / (double) Totals.Instructions : 0.0,
+			(TimeNs != 0.0) ? (double) Totals.Instructions * 1000000000.0 / TimeNs : 0.0,
+			(TimeNs != 0.0) ? (double) Totals.Actions * 1000000000.0 / TimeNs : 0.0);
+		m_TextOut->WriteText(
+			"%lu divergence(s), %lu return code mismatch(es), %lu argument mismatch(es)%s.\n",
+			Totals.Divergences,
+			Totals.ReturnCodeMismatches,
+			Totals.ArgumentMismatches,
+			m_VerifyArguments ? "" : " (arguments not verified)");
+		m_TextOut->WriteText(
+			"%I64u engine structure allocation(s) (%.2f/invocation, %.0f/s), %.1f%% recycled from the pool.\n",
+			Totals.StructAllocations,
+			(Totals.Invocations != 0) ? (double) Totals.StructAllocations / (double) Totals.Invocations : 0.0,
+			(TimeNs != 0.0) ? (double) Totals.StructAllocations * 1000000000.0 / TimeNs : 0.0,
+			(Totals.StructAllocations != 0) ? (double) Totals.StructRecycled * 100.0 / (double) Totals.StructAllocations : 0.0);
+	}
+
+	Status = ((Totals.Divergences == 0) &&
+	          (Totals.ReturnCodeMismatches == 0) &&
+	          (Totals.ArgumentMismatches == 0));
+
+	if (ResultsFile.empty( ))
+		return Status;
+
+	f = fopen( ResultsFile.c_str( ), "wt" );
+
+	if (f == NULL)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Unable to open replay results file '%s'.\n",
+			ResultsFile.c_str( ));
+
+		return false;
+	}
+
+	Written = WriteCsv( f );
+
+	if (fclose( f ) != 0)
+		Written = false;
+
+	if (!Written)
+	{
+		m_TextOut->WriteText(
+			"ERROR: Failed to write replay results file '%s'.\n",
+			ResultsFile.c_str( ));
+
+		return false;
+	}
+
+	m_TextOut->WriteText(
+		"Wrote replay results for %lu script(s) to '%s'.\n",
+		(unsigned long) m_Scripts.size( ),
+		ResultsFile.c_str( ));
+
+	return Status;
+}
+
+void
+ScriptReplay::ReplayScript(
+	__in size_t ScriptIndex,
+	__inout_opt ScriptResult * Result
+	)
+/*++
+
+Routine Description:
+
+	This routine replays a single recorded script invocation.
+
+	Deferred script situations are not replayed (the recorded DelayCommand
+	and AssignCommand calls are not executed), and any that exist are
+	discarded after the run.
+
+Arguments:
+
+	ScriptIndex - Supplies the index of the trace script to replay.
+
+	Result - Optionally receives the counters of the replay.  If NULL, the
+	         replay is a warm-up run.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const NWScriptActionTraceReader::TraceScript & Script = m_Trace.GetScripts( )[ ScriptIndex ];
+	NWScriptHost::ReplayStats                      Replay;
+	EngineStructurePool::PoolStats                 StartPool;
+	EngineStructurePool::PoolStats                 EndPool;
+	ULONGLONG                                      StartInstructions;
+	LARGE_INTEGER                                  Start;
+	LARGE_INTEGER                                  End;
+	int                                            ReturnCode;
+
+	StartInstructions = m_ScriptHost->GetVMInstructionsExecuted( );
+	EngineStructurePool::GetStats( StartPool );
+
+	m_ScriptHost->BeginActionReplay( m_Trace, ScriptIndex, m_VerifyArguments );
+
+	QueryPerformanceCounter( &Start );
+
+	ReturnCode = m_ScriptHost->RunScript(
+		Script.ScriptName.c_str( ),
+		Script.ObjectSelf,
+		Script.Parameters,
+		0);
+
+	QueryPerformanceCounter( &End );
+
+	EngineStructurePool::GetStats( EndPool );
+
+	m_ScriptHost->EndActionReplay( Replay );
+	m_ScriptHost->DiscardDeferredScriptSituations( );
+
+	if (Result == NULL)
+		return;
+
+	Result->Invocations        += 1;
+	Result->Time               += TicksToMicroseconds( (ULONGLONG) (End.QuadPart - Start.QuadPart) );
+	Result->Instructions       += m_ScriptHost->GetVMInstructionsExecuted( ) - StartInstructions;
+	Result->Actions            += Replay.ActionsReplayed;
+	Result->StructAllocations  += (ULONG) (EndPool.Allocations - StartPool.Allocations);
+	Result->StructRecycled     += (ULONG) (EndPool.Recycled - StartPool.Recycled);
+	Result->ArgumentMismatches += Replay.ArgumentMismatches;
+
+	if ((Replay.Divergences != 0) || (Replay.ActionsRemaining != 0))
+		Result->Divergences += 1;
+
+	if (ReturnCode != Script.ReturnCode)
+		Result->ReturnCodeMismatches += 1;
+}
+
+bool
+ScriptReplay::WriteCsv(
+	__in FILE * f
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the results as CSV, one row per script name.
+
+Arguments:
+
+	f - Supplies the results file.
+
+Return Value:
+
+	The routine returns true on success.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (fprintf(
+		f,
+		"script,invocations,time_us,instructions,actions,ns_per_invocation,ns_per_instruction,"
+		"struct_allocations,struct_recycled,divergences,return_code_mismatches,argument_mismatches\n") < 0)
+	{
+		return false;
+	}
+
+	for (ScriptResultMap::const_iterator it = m_Scripts.begin( );
+	     it != m_Scripts.end( );
+	     ++it)
+	{
+		const ScriptResult & Result = it->second;
+		double               TimeNs = (double) Result.Time * 1000.0;
+
+		if (fprintf(
+			f,
+			"%s,%lu,%I64u,%I64u,%I64u,%.1f,%.3f,%I64u,%I64u,%lu,%lu,%lu\n",
+			it->first.c_str( ),
+			Result.Invocations,
+			Result.Time,
+			Result.Instructions,
+			Result.Actions,
+			(Result.Invocations != 0) ? TimeNs / (double) Result.Invocations : 0.0,
+			(Result.Instructions != 0) ? TimeNs / (double) Result.Instructions : 0.0,
+			Result.StructAllocations,
+			Result.StructRecycled,
+			Result.Divergences,
+			Result.ReturnCodeMismatches,
+			Result.ArgumentMismatches) < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ULONGLONG
+ScriptReplay::TicksToMicroseconds(
+	__in ULONGLONG Ticks
+	) const
+/*++
+
+Routine Description:
+
+	This routine converts performance counter ticks to microseconds.
+
+Arguments:
+
+	Ticks - Supplies the tick count.
+
+Return Value:
+
+	The equivalent count of microseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONGLONG Frequency;
+
+	if (m_Frequency.QuadPart == 0)
+		return 0;
+
+	Frequency = (ULONGLONG) m_Frequency.QuadPart;
+
+	return (Ticks / Frequency) * 1000000 + ((Ticks % Frequency) * 1000000) / Frequency;
+}
@@ -0,0 +1,118 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ScriptReplay.h
+
+Abstract:
+
+	This module defines the action trace replay benchmark, which re-runs the
+	scripts recorded in an action trace with the recorded action results fed
+	back in place of the action handlers, and records per-script performance
+	counters to a CSV results file.
+
+--*/
+
+#ifndef _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_SCRIPTREPLAY_H
+#define _SOURCE_PROGRAMS_NWNSCRIPTCONSOLE_SCRIPTREPLAY_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+class NWScriptHost;
+
+class ScriptReplay
+{
+
+public:
+
+	ScriptReplay(
+		__in NWScriptHost * ScriptHost,
+		__in IDebugTextOut * TextOut,
+		__in ULONG Runs,
+		__in ULONG WarmupRuns,
+		__in bool VerifyArguments
+		);
+
+	~ScriptReplay(
+		);
+
+	//
+	// Replay every script recorded in the trace file and write the results.
+	// An empty results file name only prints the summary.  The routine
+	// returns false if the trace could not be loaded, the results could not
+	// be written, or the replay diverged from the recording.
+	//
+
+	bool
+	Run(
+		__in const std::string & TraceFile,
+		__in const std::string & ResultsFile
+		);
+
+private:
+
+	//
+	// Define the counters for all timed replays of one script name.  A trace
+	// usually contains many invocations of the same script.
+	//
+
+	struct ScriptResult
+	{
+		ULONG     Invocations;
+		ULONGLONG Time;                 // Microseconds, all timed invocations
+		ULONGLONG Instructions;         // All timed invocations
+		ULONGLONG Actions;              // All timed invocations
+		ULONGLONG StructAllocations;    // Engine structures, all timed invocations
+		ULONGLONG StructRecycled;       // Engine structures reused from the pool
+		ULONG     Divergences;
+		ULONG     ArgumentMismatches;
+		ULONG     ReturnCodeMismatches;
+	};
+
+	typedef std::map< std::string, ScriptResult > ScriptResultMap;
+
+	//
+	// Replay one trace script and, if a result is supplied, accumulate the
+	// counters of the replay.
+	//
+
+	void
+	ReplayScript(
+		__in size_t ScriptIndex,
+		__inout_opt ScriptResult * Result
+		);
+
+	//
+	// Write the results as CSV.
+	//
+
+	bool
+	WriteCsv(
+		__in FILE * f
+		);
+
+	//
+	// Convert performance counter ticks to microseconds.
+	//
+
+	ULONGLONG
+	TicksToMicroseconds(
+		__in ULONGLONG Ticks
+		) const;
+
+	NWScriptHost               * m_ScriptHost;
+	IDebugTextOut              * m_TextOut;
+	ULONG                        m_Runs;
+	ULONG                        m_WarmupRuns;
+	bool                         m_VerifyArguments;
+	NWScriptActionTraceReader    m_Trace;
+	ScriptResultMap              m_Scripts;
+	LARGE_INTEGER                m_Frequency;
+
+};
+
+#endif
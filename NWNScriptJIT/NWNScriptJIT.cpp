@@ -686,6 +686,9 @@ Environment:
 		case NWScriptJITVersion_NeutralString:
 			return (VersionValue == sizeof( NeutralString ));
 
+		case NWScriptJITVersion_EngineStructurePtrSize:
+			return (VersionValue == sizeof( EngineStructurePtr ));
+
 		default:
 			return FALSE;
 
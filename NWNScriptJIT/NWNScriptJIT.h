@@ -397,7 +397,8 @@ enum
 {
 	NWSCRIPTJITAPI_0       = 0,
 	NWSCRIPTJITAPI_1       = 1, // NWScriptExecuteScriptSituation has OBJECTID
-	NWSCRIPTJITAPI_CURRENT = NWSCRIPTJITAPI_1
+	NWSCRIPTJITAPI_2       = 2, // EngineStructurePtr is an intrusive pointer
+	NWSCRIPTJITAPI_CURRENT = NWSCRIPTJITAPI_2
 };
 
 //
@@ -448,6 +449,12 @@ typedef enum _NWSCRIPT_JIT_VERSION
 
 	NWScriptJITVersion_NeutralString,
 
+	//
+	// sizeof( EngineStructurePtr )
+	//
+
+	NWScriptJITVersion_EngineStructurePtrSize,
+
 	NWScriptJITVersion_Max
 } NWSCRIPT_JIT_VERSION, * PNWSCRIPT_JIT_VERSION;
 
@@ -911,12 +911,13 @@ private:
 			ULONG                VersionValue;
 		} VersionChecks[ ] =
 		{
-			{ NWScriptJITVersion_APIVersion          , NWSCRIPTJITAPI_CURRENT        },
-			{ NWScriptJITVersion_NWScriptReaderState , sizeof( NWScriptReaderState ) },
-			{ NWScriptJITVersion_NWScriptStack       , sizeof( NWScriptStack )       },
-			{ NWScriptJITVersion_NWScriptParamVec    , sizeof( NWScriptParamVec )    },
-			{ NWScriptJITVersion_NWACTION_DEFINITION , sizeof( NWACTION_DEFINITION ) },
-			{ NWScriptJITVersion_NeutralString       , sizeof( NeutralString )       }
+			{ NWScriptJITVersion_APIVersion             , NWSCRIPTJITAPI_CURRENT        },
+			{ NWScriptJITVersion_NWScriptReaderState    , sizeof( NWScriptReaderState ) },
+			{ NWScriptJITVersion_NWScriptStack          , sizeof( NWScriptStack )       },
+			{ NWScriptJITVersion_NWScriptParamVec       , sizeof( NWScriptParamVec )    },
+			{ NWScriptJITVersion_NWACTION_DEFINITION    , sizeof( NWACTION_DEFINITION ) },
+			{ NWScriptJITVersion_NeutralString          , sizeof( NeutralString )       },
+			{ NWScriptJITVersion_EngineStructurePtrSize , sizeof( EngineStructurePtr )  }
 		};
 
 		//
@@ -0,0 +1,1360 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	NWScriptActionTrace.cpp
+
+Abstract:
+
+	This module houses the action trace writer and reader objects, which
+	record the action service calls made by scripts to a compact binary trace
+	and feed the recorded results back to a replay host.
+
+--*/
+
+#include "Precomp.h"
+#include "NWScriptStack.h"
+#include "NWScriptInterfaces.h"
+#include "NWScriptActionTrace.h"
+
+using namespace NWScriptActionTrace;
+
+//
+// Define the record buffer size beyond which the writer flushes to disk even
+// if a script is still active.
+//
+
+#define TRACE_FLUSH_THRESHOLD (64 * 1024)
+
+static
+NWScriptStack::STACK_POINTER
+GetTraceTypeSize(
+	__in NWACTION_TYPE Type,
+	__in NWScriptStack::STACK_POINTER IntegerSize
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the VM stack size of a value of the given action
+	service parameter type.
+
+Arguments:
+
+	Type - Supplies the type of the value.
+
+	IntegerSize - Supplies the size of an integer on the VM stack.
+
+Return Value:
+
+	The size, in bytes, of the value on the VM stack.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (Type)
+	{
+
+	case ACTIONTYPE_VOID:
+	case ACTIONTYPE_ACTION:
+		return 0;
+
+	case ACTIONTYPE_VECTOR:
+		return 3 * IntegerSize;
+
+	default:
+		return IntegerSize;
+
+	}
+}
+
+NWScriptActionTraceWriter::NWScriptActionTraceWriter(
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new, closed action trace writer.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_File( NULL ),
+  m_ScriptDepth( 0 ),
+  m_ActionsRecorded( 0 )
+{
+}
+
+NWScriptActionTraceWriter::~NWScriptActionTraceWriter(
+	)
+/*++
+
+Routine Description:
+
+	This routine flushes and closes the trace, if one is open.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Close( );
+}
+
+bool
+NWScriptActionTraceWriter::Open(
+	__in const char * FileName
+	)
+/*++
+
+Routine Description:
+
+	This routine creates a new trace file and writes the trace header.
+
+Arguments:
+
+	FileName - Supplies the name of the trace file to create.
+
+Return Value:
+
+	The routine returns true on success, else false if the file could not be
+	created.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	TRACE_HEADER Header;
+
+	Close( );
+
+	m_File = fopen( FileName, "wb" );
+
+	if (m_File == NULL)
+		return false;
+
+	m_Buffer.clear( );
+	m_PendingActions.clear( );
+
+	m_ScriptDepth     = 0;
+	m_ActionsRecorded = 0;
+
+	Header.Magic   = TRACE_MAGIC;
+	Header.Version = TRACE_VERSION;
+
+	m_Buffer.insert(
+		m_Buffer.end( ),
+		(const unsigned char *) &Header,
+		(const unsigned char *) (&Header + 1));
+
+	Flush( );
+
+	return IsOpen( );
+}
+
+void
+NWScriptActionTraceWriter::Close(
+	)
+/*++
+
+Routine Description:
+
+	This routine flushes any buffered records and closes the trace file.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (m_File == NULL)
+		return;
+
+	Flush( );
+
+	if (m_File != NULL)
+	{
+		fclose( m_File );
+		m_File = NULL;
+	}
+
+	m_Buffer.clear( );
+	m_PendingActions.clear( );
+	m_ScriptDepth = 0;
+}
+
+void
+NWScriptActionTraceWriter::BeginScript(
+	__in const char * ScriptName,
+	__in NWN::OBJECTID ObjectSelf,
+	__in const ScriptParamVec & Parameters
+	)
+/*++
+
+Routine Description:
+
+	This routine records the start of a script execution.
+
+Arguments:
+
+	ScriptName - Supplies the name of the script.
+
+	ObjectSelf - Supplies the self object of the script.
+
+	Parameters - Supplies the script parameters.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (m_File == NULL)
+		return;
+
+	PutByte( (unsigned char) TraceRecScriptBegin );
+	PutVarInt( (ULONG) m_PendingActions.size( ) );
+	PutString( ScriptName, strlen( ScriptName ) );
+	PutVarInt( (ULONG) ObjectSelf );
+	PutVarInt( (ULONG) Parameters.size( ) );
+
+	for (ScriptParamVec::const_iterator it = Parameters.begin( );
+	     it != Parameters.end( );
+	     ++it)
+	{
+		PutString( it->data( ), it->size( ) );
+	}
+
+	m_ScriptDepth += 1;
+}
+
+void
+NWScriptActionTraceWriter::EndScript(
+	__in int ReturnCode
+	)
+/*++
+
+Routine Description:
+
+	This routine records the end of a script execution.  The trace is flushed
+	to disk once the outermost script returns, so that a trace is complete up
+	to the last finished script even if the host terminates abnormally.
+
+Arguments:
+
+	ReturnCode - Supplies the return code of the script.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((m_File == NULL) || (m_ScriptDepth == 0))
+		return;
+
+	m_ScriptDepth -= 1;
+
+	PutByte( (unsigned char) TraceRecScriptEnd );
+	PutVarInt( (ULONG) m_PendingActions.size( ) );
+	PutSignedVarInt( ReturnCode );
+
+	if ((m_ScriptDepth == 0) || (m_Buffer.size( ) >= TRACE_FLUSH_THRESHOLD))
+		Flush( );
+}
+
+bool
+NWScriptActionTraceWriter::BeginAction(
+	__in PCNWACTION_DEFINITION ActionDef,
+	__in size_t NumArguments,
+	__in const NWScriptStack & VMStack
+	)
+/*++
+
+Routine Description:
+
+	This routine records an action call and its arguments, which are read
+	from the VM stack in place.  The first parameter is on the top of the
+	stack.
+
+Arguments:
+
+	ActionDef - Supplies the definition of the action that is being called.
+
+	NumArguments - Supplies the count of arguments passed to the action.
+
+	VMStack - Supplies the VM stack, with the arguments on top.
+
+Return Value:
+
+	The routine returns true if the call was recorded, in which case the
+	caller must call EndAction once the action returns.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NWScriptStack::STACK_POINTER IntegerSize;
+	NWScriptStack::STACK_POINTER ArgumentsSize;
+	PendingAction                Pending;
+	size_t                       RecordStart;
+
+	if ((m_File == NULL) || (m_ScriptDepth == 0))
+		return false;
+
+	if (NumArguments > ActionDef->NumParameters)
+		NumArguments = ActionDef->NumParameters;
+
+	IntegerSize   = VMStack.GetStackIntegerSize( );
+	ArgumentsSize = 0;
+	RecordStart   = m_Buffer.size( );
+
+	try
+	{
+		PutByte( (unsigned char) TraceRecActionCall );
+		PutVarInt( (ULONG) m_PendingActions.size( ) );
+		PutVarInt( (ULONG) ActionDef->ActionId );
+		PutVarInt( (ULONG) NumArguments );
+
+		for (size_t i = 0; i < NumArguments; i += 1)
+		{
+			NWACTION_TYPE Type = ActionDef->ParameterTypes[ i ];
+
+			ArgumentsSize += GetTraceTypeSize( Type, IntegerSize );
+
+			PutStackValue( Type, VMStack, -ArgumentsSize );
+		}
+
+		Pending.ActionDef = ActionDef;
+		Pending.ResultSP  = VMStack.GetCurrentSP( ) - ArgumentsSize +
+			GetTraceTypeSize( ActionDef->ReturnType, IntegerSize );
+
+		m_PendingActions.push_back( Pending );
+	}
+	catch (std::exception)
+	{
+		//
+		// The arguments did not match the action prototype.  Leave the call
+		// out of the trace, and let the action handler report the error.
+		//
+
+		m_Buffer.resize( RecordStart );
+		return false;
+	}
+
+	return true;
+}
+
+void
+NWScriptActionTraceWriter::EndAction(
+	__in const NWScriptStack & VMStack,
+	__in bool Completed
+	)
+/*++
+
+Routine Description:
+
+	This routine records the return of an action call that was recorded by
+	BeginAction.  If the action handler did not leave exactly the return
+	value in place of its arguments, the call is recorded as not completed.
+
+Arguments:
+
+	VMStack - Supplies the VM stack, with the return value (if any) on top.
+
+	Completed - Supplies a Boolean value that indicates true if the action
+	            handler returned normally without aborting the script.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PendingAction Pending;
+	size_t        RecordStart;
+
+	if (m_PendingActions.empty( ))
+		return;
+
+	Pending = m_PendingActions.back( );
+	m_PendingActions.pop_back( );
+
+	if (m_File == NULL)
+		return;
+
+	if ((Completed) && (VMStack.GetCurrentSP( ) != Pending.ResultSP))
+		Completed = false;
+
+	PutByte( (unsigned char) TraceRecActionReturn );
+	PutVarInt( (ULONG) m_PendingActions.size( ) );
+
+	RecordStart = m_Buffer.size( );
+
+	if (Completed)
+	{
+		try
+		{
+			PutByte( 1 );
+			PutStackValue(
+				Pending.ActionDef->ReturnType,
+				VMStack,
+				-GetTraceTypeSize(
+					Pending.ActionDef->ReturnType,
+					VMStack.GetStackIntegerSize( )));
+		}
+		catch (std::exception)
+		{
+			m_Buffer.resize( RecordStart );
+			Completed = false;
+		}
+	}
+
+	if (!Completed)
+		PutByte( 0 );
+
+	m_ActionsRecorded += 1;
+
+	if (m_Buffer.size( ) >= TRACE_FLUSH_THRESHOLD)
+		Flush( );
+}
+
+void
+NWScriptActionTraceWriter::PutStackValue(
+	__in NWACTION_TYPE Type,
+	__in const NWScriptStack & VMStack,
+	__in NWScriptStack::STACK_POINTER SP
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a typed value, read from the VM stack, to the record
+	buffer.  Engine structures and action arguments only record their type.
+
+Arguments:
+
+	Type - Supplies the type of the value.
+
+	VMStack - Supplies the VM stack.
+
+	SP - Supplies the displacement of the value from the top of the stack.
+
+Return Value:
+
+	None.  An std::exception is raised if the stack entry has the wrong type.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PutByte( (unsigned char) Type );
+
+	switch (Type)
+	{
+
+	case ACTIONTYPE_INT:
+		PutSignedVarInt( VMStack.GetStackInt( SP ) );
+		break;
+
+	case ACTIONTYPE_FLOAT:
+		PutFloat( VMStack.GetStackFloat( SP ) );
+		break;
+
+	case ACTIONTYPE_STRING:
+		{
+			const std::string & String = VMStack.GetStackString( SP );
+
+			PutString( String.data( ), String.size( ) );
+		}
+		break;
+
+	case ACTIONTYPE_OBJECT:
+		PutVarInt( (ULONG) VMStack.GetStackObjectId( SP ) );
+		break;
+
+	case ACTIONTYPE_VECTOR:
+		{
+			NWN::Vector3 Vector = VMStack.GetStackVector( SP );
+
+			PutFloat( Vector.x );
+			PutFloat( Vector.y );
+			PutFloat( Vector.z );
+		}
+		break;
+
+	case ACTIONTYPE_VOID:
+	case ACTIONTYPE_ACTION:
+		break;
+
+	default:
+		if ((Type < ACTIONTYPE_ENGINE_0) || (Type > ACTIONTYPE_ENGINE_9))
+			throw std::runtime_error( "Invalid action service value type." );
+
+		//
+		// Validate that the stack entry is an engine structure of the right
+		// type, but record nothing further.
+		//
+
+		VMStack.GetStackEngineStructure(
+			SP,
+			(NWScriptStack::ENGINE_STRUCTURE_NUMBER) (Type - ACTIONTYPE_ENGINE_0));
+		break;
+
+	}
+}
+
+void
+NWScriptActionTraceWriter::PutVarInt(
+	__in ULONG Value
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a variable length unsigned integer to the record
+	buffer, seven bits per byte, least significant group first.
+
+Arguments:
+
+	Value - Supplies the value to append.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	while (Value >= 0x80)
+	{
+		m_Buffer.push_back( (unsigned char) (Value | 0x80) );
+		Value >>= 7;
+	}
+
+	m_Buffer.push_back( (unsigned char) Value );
+}
+
+void
+NWScriptActionTraceWriter::PutFloat(
+	__in float Value
+	)
+/*++
+
+Routine Description:
+
+	This routine appends the raw representation of a float to the record
+	buffer, so that the value is replayed bit for bit.
+
+Arguments:
+
+	Value - Supplies the value to append.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const unsigned char * Bytes = (const unsigned char *) &Value;
+
+	m_Buffer.insert( m_Buffer.end( ), Bytes, Bytes + sizeof( Value ) );
+}
+
+void
+NWScriptActionTraceWriter::PutString(
+	__in_ecount( Length ) const char * String,
+	__in size_t Length
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a length-prefixed string to the record buffer.
+
+Arguments:
+
+	String - Supplies the string characters.
+
+	Length - Supplies the count of characters.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PutVarInt( (ULONG) Length );
+
+	m_Buffer.insert(
+		m_Buffer.end( ),
+		(const unsigned char *) String,
+		(const unsigned char *) String + Length);
+}
+
+void
+NWScriptActionTraceWriter::Flush(
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the record buffer to the trace file.  If the write
+	fails, the trace file is closed and recording stops.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((m_File == NULL) || (m_Buffer.empty( )))
+		return;
+
+	if ((fwrite( &m_Buffer[ 0 ], m_Buffer.size( ), 1, m_File ) != 1) ||
+	    (fflush( m_File ) != 0))
+	{
+		fclose( m_File );
+		m_File = NULL;
+	}
+
+	m_Buffer.clear( );
+}
+
+
+
+NWScriptActionTraceReader::NWScriptActionTraceReader(
+	)
+/*++
+
+Routine Description:
+
+	This routine constructs a new, empty action trace reader.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+: m_Offset( 0 )
+{
+}
+
+NWScriptActionTraceReader::~NWScriptActionTraceReader(
+	)
+/*++
+
+Routine Description:
+
+	This routine tears down the action trace reader.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+}
+
+void
+NWScriptActionTraceReader::Load(
+	__in const char * FileName
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a trace file into memory and parses the outermost
+	scripts and their action calls.  Nested scripts (those run by an action)
+	are skipped, as are action calls that were not made by a script.
+
+Arguments:
+
+	FileName - Supplies the name of the trace file.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE         * f;
+	long           Size;
+	TRACE_HEADER   Header;
+	bool           ScriptOpen;
+
+	m_Scripts.clear( );
+	m_Actions.clear( );
+	m_Arguments.clear( );
+	m_Data.clear( );
+	m_Offset = 0;
+
+	f = fopen( FileName, "rb" );
+
+	if (f == NULL)
+		throw std::runtime_error( "Unable to open action trace file." );
+
+	if ((fseek( f, 0, SEEK_END ) != 0) ||
+	    ((Size = ftell( f )) < (long) sizeof( Header )) ||
+	    (fseek( f, 0, SEEK_SET ) != 0))
+	{
+		fclose( f );
+		throw std::runtime_error( "Action trace file is truncated." );
+	}
+
+	m_Data.resize( (size_t) Size );
+
+	if (fread( &m_Data[ 0 ], m_Data.size( ), 1, f ) != 1)
+	{
+		fclose( f );
+		throw std::runtime_error( "Failed to read action trace file." );
+	}
+
+	fclose( f );
+
+	memcpy( &Header, &m_Data[ 0 ], sizeof( Header ) );
+
+	if ((Header.Magic != TRACE_MAGIC) || (Header.Version != TRACE_VERSION))
+		throw std::runtime_error( "Unrecognized action trace file format." );
+
+	m_Offset   = sizeof( Header );
+	ScriptOpen = false;
+
+	while (m_Offset < m_Data.size( ))
+	{
+		TRACE_RECORD_TYPE RecordType;
+		ULONG             Depth;
+		bool              Keep;
+
+		RecordType = (TRACE_RECORD_TYPE) GetByte( );
+		Depth      = GetVarInt( );
+
+		switch (RecordType)
+		{
+
+		case TraceRecScriptBegin:
+			if (Depth == 0)
+			{
+				TraceScript Script;
+
+				GetString( Script.ScriptName );
+
+				Script.ObjectSelf  = (NWN::OBJECTID) GetVarInt( );
+				Script.ReturnCode  = 0;
+				Script.Completed   = false;
+				Script.FirstAction = m_Actions.size( );
+				Script.ActionCount = 0;
+
+				Script.Parameters.resize( GetVarInt( ) );
+
+				for (ScriptParamVec::iterator it = Script.Parameters.begin( );
+				     it != Script.Parameters.end( );
+				     ++it)
+				{
+					GetString( *it );
+				}
+
+				m_Scripts.push_back( Script );
+				ScriptOpen = true;
+			}
+			else
+			{
+				std::string Skip;
+				ULONG       Count;
+
+				GetString( Skip );
+				GetVarInt( );
+
+				Count = GetVarInt( );
+
+				for (ULONG i = 0; i < Count; i += 1)
+					GetString( Skip );
+			}
+			break;
+
+		case TraceRecScriptEnd:
+			{
+				int ReturnCode = GetSignedVarInt( );
+
+				if ((Depth == 0) && (ScriptOpen))
+				{
+					m_Scripts.back( ).ReturnCode = ReturnCode;
+					m_Scripts.back( ).Completed  = true;
+					ScriptOpen                   = false;
+				}
+			}
+			break;
+
+		case TraceRecActionCall:
+			{
+				NWSCRIPT_ACTION ActionId     = (NWSCRIPT_ACTION) GetVarInt( );
+				ULONG           NumArguments = GetVarInt( );
+
+				Keep = ((Depth == 0) && (ScriptOpen));
+
+				if (Keep)
+				{
+					TraceAction Action;
+
+					Action.ActionId         = ActionId;
+					Action.NumArguments     = NumArguments;
+					Action.FirstArgument    = m_Arguments.size( );
+					Action.Completed        = false;
+					Action.ReturnValue.Type = ACTIONTYPE_VOID;
+
+					m_Actions.push_back( Action );
+					m_Scripts.back( ).ActionCount += 1;
+				}
+
+				for (ULONG i = 0; i < NumArguments; i += 1)
+				{
+					if (Keep)
+					{
+						m_Arguments.push_back( TraceValue( ) );
+						GetValue( &m_Arguments.back( ) );
+					}
+					else
+					{
+						GetValue( NULL );
+					}
+				}
+			}
+			break;
+
+		case TraceRecActionReturn:
+			Keep = ((Depth == 0) &&
+			        (ScriptOpen) &&
+			        (m_Scripts.back( ).ActionCount != 0));
+
+			if (GetByte( ) != 0)
+			{
+				if (Keep)
+				{
+					m_Actions.back( ).Completed = true;
+					GetValue( &m_Actions.back( ).ReturnValue );
+				}
+				else
+				{
+					GetValue( NULL );
+				}
+			}
+			break;
+
+		default:
+			throw std::runtime_error( "Malformed action trace record." );
+
+		}
+	}
+
+	std::vector< unsigned char >( ).swap( m_Data );
+	m_Offset = 0;
+}
+
+NWScriptActionTraceReader::REPLAY_STATUS
+NWScriptActionTraceReader::ReplayAction(
+	__in size_t ActionIndex,
+	__in_ecount( ActionCount ) PCNWACTION_DEFINITION ActionDefs,
+	__in NWSCRIPT_ACTION ActionCount,
+	__in NWSCRIPT_ACTION ActionId,
+	__in size_t NumArguments,
+	__inout NWScriptStack & VMStack,
+	__in INWScriptActions * Actions,
+	__in bool VerifyArguments
+	) const
+/*++
+
+Routine Description:
+
+	This routine stands in for an action service handler.  The arguments of
+	the call are removed from the VM stack and the recorded return value is
+	placed on the VM stack.
+
+Arguments:
+
+	ActionIndex - Supplies the index of the recorded action call to replay.
+
+	ActionDefs - Supplies the action table that describes the parameter and
+	             return types of each action.
+
+	ActionCount - Supplies the count of entries in the action table.
+
+	ActionId - Supplies the action service ordinal that the script called.
+
+	NumArguments - Supplies the count of arguments that the script passed.
+
+	VMStack - Supplies the VM stack, with the arguments on top.
+
+	Actions - Supplies the action interface used to create engine structures
+	          for engine structure return values.
+
+	VerifyArguments - Supplies a Boolean value that indicates true if the
+	                  arguments are to be compared with the recorded ones.
+
+Return Value:
+
+	The routine returns the replay status (see REPLAY_STATUS).
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const TraceAction     & Action = m_Actions[ ActionIndex ];
+	PCNWACTION_DEFINITION   ActionDef;
+	bool                    Mismatch;
+
+	if ((ActionId >= ActionCount) || (Action.ActionId != ActionId))
+		return ReplayDiverged;
+
+	ActionDef = &ActionDefs[ ActionId ];
+
+	if (NumArguments > ActionDef->NumParameters)
+		NumArguments = ActionDef->NumParameters;
+
+	if ((Action.NumArguments != NumArguments) ||
+	    ((Action.Completed) && (Action.ReturnValue.Type != ActionDef->ReturnType)))
+	{
+		return ReplayDiverged;
+	}
+
+	Mismatch = false;
+
+	for (ULONG i = 0; i < Action.NumArguments; i += 1)
+	{
+		if (!PopAndCompareValue(
+			ActionDef->ParameterTypes[ i ],
+			VMStack,
+			VerifyArguments ? &m_Arguments[ Action.FirstArgument + i ] : NULL))
+		{
+			Mismatch = true;
+		}
+	}
+
+	if (!Action.Completed)
+		return ReplayAborted;
+
+	switch (Action.ReturnValue.Type)
+	{
+
+	case ACTIONTYPE_INT:
+		VMStack.StackPushInt( Action.ReturnValue.Int );
+		break;
+
+	case ACTIONTYPE_FLOAT:
+		VMStack.StackPushFloat( Action.ReturnValue.Float );
+		break;
+
+	case ACTIONTYPE_STRING:
+		VMStack.StackPushString( Action.ReturnValue.String );
+		break;
+
+	case ACTIONTYPE_OBJECT:
+		VMStack.StackPushObjectId( Action.ReturnValue.ObjectId );
+		break;
+
+	case ACTIONTYPE_VECTOR:
+		VMStack.StackPushVector( Action.ReturnValue.Vector );
+		break;
+
+	case ACTIONTYPE_VOID:
+	case ACTIONTYPE_ACTION:
+		break;
+
+	default:
+		VMStack.StackPushEngineStructure(
+			Actions->CreateEngineStructure(
+				(NWScriptStack::ENGINE_STRUCTURE_NUMBER) (Action.ReturnValue.Type - ACTIONTYPE_ENGINE_0)));
+		break;
+
+	}
+
+	return Mismatch ? ReplayArgumentMismatch : ReplayCompleted;
+}
+
+unsigned char
+NWScriptActionTraceReader::GetByte(
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a byte from the trace data.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The byte read.  An std::exception is raised if the trace is truncated.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (m_Offset >= m_Data.size( ))
+		throw std::runtime_error( "Action trace file is truncated." );
+
+	return m_Data[ m_Offset++ ];
+}
+
+ULONG
+NWScriptActionTraceReader::GetVarInt(
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a variable length unsigned integer from the trace data.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The integer read.  An std::exception is raised if the trace is truncated
+	or the integer is malformed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG         Value;
+	unsigned char Byte;
+
+	Value = 0;
+
+	for (ULONG Shift = 0; ; Shift += 7)
+	{
+		if (Shift > 28)
+			throw std::runtime_error( "Malformed integer in action trace file." );
+
+		Byte   = GetByte( );
+		Value |= (ULONG) (Byte & 0x7F) << Shift;
+
+		if (!(Byte & 0x80))
+			break;
+	}
+
+	return Value;
+}
+
+float
+NWScriptActionTraceReader::GetFloat(
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a raw float from the trace data.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The float read.  An std::exception is raised if the trace is truncated.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	float Value;
+
+	if (m_Data.size( ) - m_Offset < sizeof( Value ))
+		throw std::runtime_error( "Action trace file is truncated." );
+
+	memcpy( &Value, &m_Data[ m_Offset ], sizeof( Value ) );
+	m_Offset += sizeof( Value );
+
+	return Value;
+}
+
+void
+NWScriptActionTraceReader::GetString(
+	__out std::string & String
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a length-prefixed string from the trace data.
+
+Arguments:
+
+	String - Receives the string.
+
+Return Value:
+
+	None.  An std::exception is raised if the trace is truncated.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	ULONG Length = GetVarInt( );
+
+	if (m_Data.size( ) - m_Offset < Length)
+		throw std::runtime_error( "Action trace file is truncated." );
+
+	String.assign( (const char *) &m_Data[ 0 ] + m_Offset, Length );
+	m_Offset += Length;
+}
+
+void
+NWScriptActionTraceReader::GetValue(
+	__out_opt TraceValue * Value
+	)
+/*++
+
+Routine Description:
+
+	This routine reads a typed value from the trace data.
+
+Arguments:
+
+	Value - Optionally receives the value.  If NULL, the value is skipped.
+
+Return Value:
+
+	None.  An std::exception is raised if the trace is truncated or the value
+	is malformed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	TraceValue     Skip;
+	NWACTION_TYPE  Type;
+
+	if (Value == NULL)
+		Value = &Skip;
+
+	Type = (NWACTION_TYPE) GetByte( );
+
+	if (Type >= LASTACTIONTYPE)
+		throw std::runtime_error( "Invalid value type in action trace file." );
+
+	Value->Type = Type;
+
+	switch (Type)
+	{
+
+	case ACTIONTYPE_INT:
+		Value->Int = GetSignedVarInt( );
+		break;
+
+	case ACTIONTYPE_FLOAT:
+		Value->Float = GetFloat( );
+		break;
+
+	case ACTIONTYPE_STRING:
+		GetString( Value->String );
+		break;
+
+	case ACTIONTYPE_OBJECT:
+		Value->ObjectId = (NWN::OBJECTID) GetVarInt( );
+		break;
+
+	case ACTIONTYPE_VECTOR:
+		Value->Vector.x = GetFloat( );
+		Value->Vector.y = GetFloat( );
+		Value->Vector.z = GetFloat( );
+		break;
+
+	default:
+		break;
+
+	}
+}
+
+bool
+NWScriptActionTraceReader::PopAndCompareValue(
+	__in NWACTION_TYPE Type,
+	__inout NWScriptStack & VMStack,
+	__in_opt const TraceValue * Expected
+	)
+/*++
+
+Routine Description:
+
+	This routine removes an action argument from the VM stack and, if a
+	recorded value is supplied, compares it with the recorded value.  Floats
+	and vectors are compared bit for bit; engine structures are only checked
+	for type.
+
+Arguments:
+
+	Type - Supplies the parameter type of the argument.
+
+	VMStack - Supplies the VM stack, with the argument on top.
+
+	Expected - Optionally supplies the recorded value to compare with.
+
+Return Value:
+
+	The routine returns false if a recorded value was supplied and differs
+	from the argument, else true.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if ((Expected != NULL) && (Expected->Type != Type))
+		return false;
+
+	switch (Type)
+	{
+
+	case ACTIONTYPE_INT:
+		{
+			int Int = VMStack.StackPopInt( );
+
+			return (Expected == NULL) || (Int == Expected->Int);
+		}
+
+	case ACTIONTYPE_FLOAT:
+		{
+			float Float = VMStack.StackPopFloat( );
+
+			return (Expected == NULL) ||
+			       (!memcmp( &Float, &Expected->Float, sizeof( Float ) ));
+		}
+
+	case ACTIONTYPE_STRING:
+		{
+			std::string String = VMStack.StackPopString( );
+
+			return (Expected == NULL) || (String == Expected->String);
+		}
+
+	case ACTIONTYPE_OBJECT:
+		{
+			NWN::OBJECTID ObjectId = VMStack.StackPopObjectId( );
+
+			return (Expected == NULL) || (ObjectId == Expected->ObjectId);
+		}
+
+	case ACTIONTYPE_VECTOR:
+		{
+			NWN::Vector3 Vector = VMStack.StackPopVector( );
+
+			return (Expected == NULL) ||
+			       (!memcmp( &Vector, &Expected->Vector, sizeof( Vector ) ));
+		}
+
+	case ACTIONTYPE_VOID:
+	case ACTIONTYPE_ACTION:
+		return true;
+
+	default:
+		VMStack.StackPopEngineStructure(
+			(NWScriptStack::ENGINE_STRUCTURE_NUMBER) (Type - ACTIONTYPE_ENGINE_0));
+		return true;
+
+	}
+}
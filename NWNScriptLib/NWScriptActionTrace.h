@@ -0,0 +1,477 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	NWScriptActionTrace.h
+
+Abstract:
+
+	This module defines the action trace writer and reader objects.  An action
+	trace is a compact binary log of the action service calls made by scripts
+	(action ordinal, arguments, and return value), which allows a script
+	workload captured in one host to be replayed deterministically in another
+	host without the real action service implementations being present.
+
+--*/
+
+#ifndef _SOURCE_PROGRAMS_NWNSCRIPTLIB_NWSCRIPTACTIONTRACE_H
+#define _SOURCE_PROGRAMS_NWNSCRIPTLIB_NWSCRIPTACTIONTRACE_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+//
+// Define the trace file format.
+//
+// The file begins with a TRACE_HEADER and is followed by a series of records,
+// each introduced by a one byte record type.  Integers are stored as LEB128
+// style variable length quantities (signed integers are zigzag encoded
+// first), floats are stored as their raw 32-bit representation, and strings
+// are stored as a length followed by the string bytes.
+//
+// Each record carries the action nesting depth at which it was made.  Scripts
+// that are run by an action (such as ExecuteScript), and the actions that
+// they call, have a greater depth than the action that ran them, and are
+// skipped on replay, as the recorded return value of the outer action already
+// reflects their effects.
+//
+// Engine structure contents are host specific and are not recorded; only the
+// engine structure type is.  A replay host creates a default engine structure
+// of the recorded type in place of an engine structure return value.
+//
+
+namespace NWScriptActionTrace
+{
+	enum
+	{
+		TRACE_MAGIC   = 0x5441534E, // "NSAT"
+		TRACE_VERSION = 1
+	};
+
+	typedef struct _TRACE_HEADER
+	{
+		ULONG Magic;
+		ULONG Version;
+	} TRACE_HEADER, * PTRACE_HEADER;
+
+	typedef const struct _TRACE_HEADER * PCTRACE_HEADER;
+
+	C_ASSERT( sizeof( TRACE_HEADER ) == 8 );
+
+	typedef enum _TRACE_RECORD_TYPE
+	{
+		//
+		// Depth, ScriptName, ObjectSelf, ParameterCount, Parameters[].
+		//
+
+		TraceRecScriptBegin   = 1,
+
+		//
+		// Depth, ReturnCode.
+		//
+
+		TraceRecScriptEnd     = 2,
+
+		//
+		// Depth, ActionId, ArgumentCount, Arguments[] (typed values).
+		//
+
+		TraceRecActionCall    = 3,
+
+		//
+		// Depth, Completed, ReturnValue (typed value, if completed).
+		//
+
+		TraceRecActionReturn  = 4,
+
+		LastTraceRecordType
+	} TRACE_RECORD_TYPE, * PTRACE_RECORD_TYPE;
+}
+
+//
+// Define the action trace writer, which is attached to a host's action
+// dispatcher in order to record a trace.
+//
+
+class NWScriptActionTraceWriter
+{
+
+public:
+
+	typedef std::vector< std::string > ScriptParamVec;
+
+	NWScriptActionTraceWriter(
+		);
+
+	~NWScriptActionTraceWriter(
+		);
+
+	//
+	// Create a new trace file, replacing any existing file.  Any currently
+	// open trace is closed first.
+	//
+
+	bool
+	Open(
+		__in const char * FileName
+		);
+
+	//
+	// Flush and close the trace file.
+	//
+
+	void
+	Close(
+		);
+
+	inline
+	bool
+	IsOpen(
+		) const
+	{
+		return m_File != NULL;
+	}
+
+	//
+	// Record the start and end of a script execution.  Action calls are only
+	// recorded while at least one script is active.
+	//
+
+	void
+	BeginScript(
+		__in const char * ScriptName,
+		__in NWN::OBJECTID ObjectSelf,
+		__in const ScriptParamVec & Parameters
+		);
+
+	void
+	EndScript(
+		__in int ReturnCode
+		);
+
+	//
+	// Record an action call.  BeginAction is called before the action handler
+	// runs, with the arguments still on the VM stack.  If it returns true,
+	// then EndAction must be called once the action handler has returned (or
+	// failed), with the return value (if any) on the VM stack.
+	//
+
+	bool
+	BeginAction(
+		__in PCNWACTION_DEFINITION ActionDef,
+		__in size_t NumArguments,
+		__in const NWScriptStack & VMStack
+		);
+
+	void
+	EndAction(
+		__in const NWScriptStack & VMStack,
+		__in bool Completed
+		);
+
+	//
+	// Return the count of action calls recorded.
+	//
+
+	inline
+	ULONGLONG
+	GetActionsRecorded(
+		) const
+	{
+		return m_ActionsRecorded;
+	}
+
+private:
+
+	//
+	// Define the state of an action call that has not yet returned.
+	//
+
+	struct PendingAction
+	{
+		PCNWACTION_DEFINITION        ActionDef;
+		NWScriptStack::STACK_POINTER ResultSP;
+	};
+
+	typedef std::vector< PendingAction > PendingActionVec;
+
+	//
+	// Write a value of the given type from the VM stack into the record
+	// buffer.
+	//
+
+	void
+	PutStackValue(
+		__in NWACTION_TYPE Type,
+		__in const NWScriptStack & VMStack,
+		__in NWScriptStack::STACK_POINTER SP
+		);
+
+	inline
+	void
+	PutByte(
+		__in unsigned char Byte
+		)
+	{
+		m_Buffer.push_back( Byte );
+	}
+
+	void
+	PutVarInt(
+		__in ULONG Value
+		);
+
+	inline
+	void
+	PutSignedVarInt(
+		__in int Value
+		)
+	{
+		PutVarInt( ((ULONG) Value << 1) ^ (ULONG) (Value >> 31) );
+	}
+
+	void
+	PutFloat(
+		__in float Value
+		);
+
+	void
+	PutString(
+		__in_ecount( Length ) const char * String,
+		__in size_t Length
+		);
+
+	//
+	// Write the record buffer out to the trace file.
+	//
+
+	void
+	Flush(
+		);
+
+	FILE                         * m_File;
+	std::vector< unsigned char >   m_Buffer;
+	PendingActionVec               m_PendingActions;
+	ULONG                          m_ScriptDepth;
+	ULONGLONG                      m_ActionsRecorded;
+
+};
+
+//
+// Define the action trace reader, which loads a trace into memory and
+// supplies recorded action results to a replay host.  Only the outermost
+// scripts of the trace (and their direct action calls) are retained.
+//
+
+class NWScriptActionTraceReader
+{
+
+public:
+
+	typedef std::vector< std::string > ScriptParamVec;
+
+	//
+	// Define a recorded value.  Only the field that corresponds to the value
+	// type is meaningful.
+	//
+
+	struct TraceValue
+	{
+		NWACTION_TYPE Type;
+		int           Int;
+		float         Float;
+		NWN::OBJECTID ObjectId;
+		NWN::Vector3  Vector;
+		std::string   String;
+	};
+
+	typedef std::vector< TraceValue > TraceValueVec;
+
+	struct TraceAction
+	{
+		NWSCRIPT_ACTION ActionId;
+		ULONG           NumArguments;
+		size_t          FirstArgument;
+		bool            Completed;
+		TraceValue      ReturnValue;
+	};
+
+	typedef std::vector< TraceAction > TraceActionVec;
+
+	struct TraceScript
+	{
+		std::string    ScriptName;
+		NWN::OBJECTID  ObjectSelf;
+		ScriptParamVec Parameters;
+		int            ReturnCode;
+		bool           Completed;
+		size_t         FirstAction;
+		size_t         ActionCount;
+	};
+
+	typedef std::vector< TraceScript > TraceScriptVec;
+
+	//
+	// Define the result of replaying an action call.
+	//
+
+	typedef enum _REPLAY_STATUS
+	{
+		//
+		// The recorded return value was placed on the VM stack.
+		//
+
+		ReplayCompleted,
+
+		//
+		// The recorded call did not complete (the script was aborted), so the
+		// caller should abort the script.
+		//
+
+		ReplayAborted,
+
+		//
+		// The recorded return value was placed on the VM stack, but the
+		// arguments on the VM stack differed from the recorded arguments.
+		//
+
+		ReplayArgumentMismatch,
+
+		//
+		// The call does not match the recorded call (a different action or
+		// argument count).  The VM stack is untouched and the caller should
+		// abort the script.
+		//
+
+		ReplayDiverged,
+
+		LastReplayStatus
+	} REPLAY_STATUS, * PREPLAY_STATUS;
+
+	NWScriptActionTraceReader(
+		);
+
+	~NWScriptActionTraceReader(
+		);
+
+	//
+	// Load a trace file.  On failure, an std::exception is raised.
+	//
+
+	void
+	Load(
+		__in const char * FileName
+		);
+
+	inline
+	const TraceScriptVec &
+	GetScripts(
+		) const
+	{
+		return m_Scripts;
+	}
+
+	inline
+	const TraceAction &
+	GetAction(
+		__in size_t ActionIndex
+		) const
+	{
+		return m_Actions[ ActionIndex ];
+	}
+
+	inline
+	size_t
+	GetActionCount(
+		) const
+	{
+		return m_Actions.size( );
+	}
+
+	//
+	// Replay a recorded action call against the VM stack: the arguments are
+	// removed (and optionally compared with the recorded arguments), and the
+	// recorded return value is pushed.  The action table supplies the
+	// parameter types, and Actions is used to create engine structures.
+	//
+
+	REPLAY_STATUS
+	ReplayAction(
+		__in size_t ActionIndex,
+		__in_ecount( ActionCount ) PCNWACTION_DEFINITION ActionDefs,
+		__in NWSCRIPT_ACTION ActionCount,
+		__in NWSCRIPT_ACTION ActionId,
+		__in size_t NumArguments,
+		__inout NWScriptStack & VMStack,
+		__in INWScriptActions * Actions,
+		__in bool VerifyArguments
+		) const;
+
+private:
+
+	//
+	// Parse helpers.  These raise an std::exception on a truncated or
+	// malformed trace.
+	//
+
+	unsigned char
+	GetByte(
+		);
+
+	ULONG
+	GetVarInt(
+		);
+
+	inline
+	int
+	GetSignedVarInt(
+		)
+	{
+		ULONG Value = GetVarInt( );
+
+		return (int) ((Value >> 1) ^ (ULONG) -(LONG) (Value & 1));
+	}
+
+	float
+	GetFloat(
+		);
+
+	void
+	GetString(
+		__out std::string & String
+		);
+
+	//
+	// Read a typed value.  If Value is NULL, the value is skipped.
+	//
+
+	void
+	GetValue(
+		__out_opt TraceValue * Value
+		);
+
+	//
+	// Pop a value of the given type from the VM stack and compare it with a
+	// recorded value, returning true if they match.
+	//
+
+	static
+	bool
+	PopAndCompareValue(
+		__in NWACTION_TYPE Type,
+		__inout NWScriptStack & VMStack,
+		__in_opt const TraceValue * Expected
+		);
+
+	std::vector< unsigned char >   m_Data;
+	size_t                         m_Offset;
+	TraceScriptVec                 m_Scripts;
+	TraceActionVec                 m_Actions;
+	TraceValueVec                  m_Arguments;
+
+};
+
+#endif
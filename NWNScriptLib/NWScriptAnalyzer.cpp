@@ -2402,7 +2402,7 @@ Environment:
 			CheckStackAccess( Entry, 0, Offset, Size );
 			// TODO: Verify this is correct behavior:
 			if (Offset + Size > -Size)
-				throw script_error( 
+				throw stack_error( 
 					Entry.PC, "CPDOWNSP source/destination overlap" );
 
 			for (Idx = 0; Idx < (size_t) Size; Idx += CELL_SIZE)
@@ -2946,11 +2946,11 @@ Environment:
 				Displacement = (STACK_POINTER) Script->ReadINT32( );
 
 				if (Displacement & CELL_UNALIGNED)
-					throw script_error( Entry.PC, "unaligned MOVSP" );
+					throw stack_error( Entry.PC, "unaligned MOVSP" );
 				else if (Displacement > 0)
-					throw script_error( Entry.PC, "positive MOVSP" );
+					throw stack_error( Entry.PC, "positive MOVSP" );
 				else if (Displacement + Entry.SP < 0)
-					throw script_error( Entry.PC, 
+					throw stack_error( Entry.PC, 
 						Entry.SP / CELL_SIZE,
 						"stack underflow",
 						"%X bytes to pop, stack size %X bytes",
@@ -2974,10 +2974,10 @@ Environment:
 				CheckStackAccess( Entry, ReturnSP, Size );
 
 				if (ExcludeOffset > Size)
-					throw script_error( Entry.PC, "invalid exclude offset" );
+					throw stack_error( Entry.PC, "invalid exclude offset" );
 				else if (ExcludeSize > Size ||
 					ExcludeOffset + ExcludeSize > Size)
-					throw script_error( Entry.PC, "too large exclude size" );
+					throw stack_error( Entry.PC, "too large exclude size" );
 
 				// Move the portion we want to save to where it will be after
 				for (STACK_POINTER CurOffset = 0; 
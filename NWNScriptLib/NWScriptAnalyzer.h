@@ -104,20 +104,11 @@ public:
 			m_PC( PC ),
 			m_StackIndex( StackIndex )
 		{
-			char    ErrorMsg[ 1024 ];
 			va_list Ap;
 
 			va_start( Ap, Fmt );
-
-			StringCbVPrintfA(
-				ErrorMsg,
-				sizeof( ErrorMsg ),
-				Fmt,
-				Ap);
-
+			format_specific( Fmt, Ap );
 			va_end( Ap );
-
-			m_SpecificInfo = ErrorMsg;
 		}
 
 		inline
@@ -149,6 +140,29 @@ public:
 		static const int
 		invalid_stack_index = (int)0x80000000;
 
+	protected:
+
+		//
+		// Format the specific info of the error.
+		//
+
+		void
+		format_specific(
+			__in __format_string const char * Fmt,
+			__in va_list Ap
+			)
+		{
+			char ErrorMsg[ 1024 ];
+
+			StringCbVPrintfA(
+				ErrorMsg,
+				sizeof( ErrorMsg ),
+				Fmt,
+				Ap);
+
+			m_SpecificInfo = ErrorMsg;
+		}
+
 	private:
 		PROGRAM_COUNTER m_PC;
 		int m_StackIndex;
@@ -160,6 +174,41 @@ public:
 		std::string m_SpecificInfo;
 	};
 
+	//
+	// Define an exception class for errors in a script's use of the stack
+	// (such as misaligned or out of range stack accesses, or stack underflow),
+	// as opposed to other errors found while raising the script to IR.
+	//
+
+	class stack_error : public script_error
+	{
+	public:
+		inline
+		stack_error(
+			__in PROGRAM_COUNTER PC,
+			__in const char * What
+			)
+			: script_error( PC, What )
+		{
+		}
+
+		stack_error(
+			__in PROGRAM_COUNTER PC,
+			__in int StackIndex,
+			__in const char * What,
+			__in __format_string const char * Fmt,
+			...
+			)
+			: script_error( PC, StackIndex, What )
+		{
+			va_list Ap;
+
+			va_start( Ap, Fmt );
+			format_specific( Fmt, Ap );
+			va_end( Ap );
+		}
+	};
+
 	//
 	// Create a script analyzer (with a specific action table array).
 	//
@@ -1146,11 +1195,11 @@ private:
 	{
 		if ((Offset & CELL_UNALIGNED) ||
 		    (Size & CELL_UNALIGNED))
-			throw script_error( Entry.PC, "unaligned stack access" );
+			throw stack_error( Entry.PC, "unaligned stack access" );
 		else if (Offset + Size > 0)
-			throw script_error( Entry.PC, "positive stack access" );
+			throw stack_error( Entry.PC, "positive stack access" );
 		else if (Offset + Entry.SP < MinSP)
-			throw script_error( Entry.PC, 
+			throw stack_error( Entry.PC, 
 				Entry.SP / CELL_SIZE + 1, 
 				"stack access violation",
 				"stack offset of %X, effective stack size %X",
@@ -1183,7 +1232,7 @@ private:
 		size_t Idx = (SP / CELL_SIZE);
 
 		if (Idx >= Entry.VarStack.size( ))
-			throw std::runtime_error( "illegal local variable SP reference" );
+			throw stack_error( Entry.PC, "illegal local variable SP reference" );
 
 		return Entry.VarStack[ Idx ];
 	}
@@ -24,7 +24,7 @@ Abstract:
 
 class EngineStructure;
 
-typedef swutil::SharedPtr< EngineStructure > EngineStructurePtr;
+typedef swutil::IntrusivePtr< EngineStructure > EngineStructurePtr;
 
 
 
@@ -1056,17 +1056,127 @@ private:
 
 };
 
+//
+// Define the engine structure pool, which recycles the storage of engine
+// structures.  Scripts create and discard engine structures (such as effects)
+// at a high rate, so released blocks are kept on a per engine type free list
+// for reuse rather than returned to the heap.
+//
+// The free lists are interlocked, as the NWScript JIT engine may release
+// engine structures from the managed finalizer thread.  A block is always
+// returned to the pool of the module that allocated it, because the release
+// goes through the virtual destructor of the structure.
+//
+
+class EngineStructurePool
+{
+
+public:
+
+	typedef NWScriptStack::ENGINE_STRUCTURE_NUMBER ENGINE_STRUCTURE_NUMBER;
+
+	//
+	// Define the cumulative allocation counters of the pool.  Recycled
+	// allocations were satisfied from a free list without calling the heap.
+	//
+
+	struct PoolStats
+	{
+		ULONG Allocations;
+		ULONG Recycled;
+		ULONG Frees;
+	};
+
+	//
+	// Allocate storage for an engine structure of the given type.  On failure,
+	// an std::bad_alloc is raised.
+	//
+
+	static
+	void *
+	Allocate(
+		__in size_t Size,
+		__in ENGINE_STRUCTURE_NUMBER EngineType
+		);
+
+	//
+	// Release storage returned by Allocate.
+	//
+
+	static
+	void
+	Free(
+		__in_opt void * p
+		);
+
+	//
+	// Return the allocation counters summed over all engine types.
+	//
+
+	static
+	void
+	GetStats(
+		__out PoolStats & Stats
+		);
+
+};
+
+//
+// An engine structure class may use DECLARE_ENGINE_STRUCTURE_POOLED_NEW in
+// place of DECLARE_SWUTIL_CROSS_MODULE_NEW in order to allocate from the
+// engine structure pool.  Instances are then created with the engine type as
+// a placement argument, i.e. new (EngineType) Class( ... ).
+//
+
+#define DECLARE_ENGINE_STRUCTURE_POOLED_NEW( )                         \
+	                                                                   \
+	inline                                                             \
+	void *                                                             \
+	operator new(                                                      \
+	    __in size_t s,                                                 \
+	    __in ENGINE_STRUCTURE_NUMBER EngineType                        \
+	    )                                                              \
+	{                                                                  \
+	    return EngineStructurePool::Allocate( s, EngineType );         \
+	}                                                                  \
+	                                                                   \
+	inline                                                             \
+	void                                                               \
+	operator delete(                                                   \
+	    __in void * p,                                                 \
+	    __in ENGINE_STRUCTURE_NUMBER EngineType                        \
+	    )                                                              \
+	{                                                                  \
+	    UNREFERENCED_PARAMETER( EngineType );                          \
+	                                                                   \
+	    EngineStructurePool::Free( p );                                \
+	}                                                                  \
+	                                                                   \
+	inline                                                             \
+	void                                                               \
+	operator delete(                                                   \
+	    __in void * p                                                  \
+	    )                                                              \
+	{                                                                  \
+	    EngineStructurePool::Free( p );                                \
+	}
+
 //
 // Define the base engine structure class, from which all implementation
 // defined structures that may be pushed onto the VM stack must be derived.
 //
+// Engine structures are copied on every VM stack push and pop, so they carry
+// their own reference count rather than a separately allocated one.  The
+// count is interlocked as the NWScript JIT engine may drop references from
+// the managed finalizer thread.
+//
 
-class EngineStructure
+class EngineStructure : public swutil::IntrusiveRefCounted
 {
 
 public:
 
-	typedef swutil::SharedPtr< EngineStructure >  Ptr;
+	typedef swutil::IntrusivePtr< EngineStructure > Ptr;
 	typedef NWScriptStack::ENGINE_STRUCTURE_NUMBER ENGINE_STRUCTURE_NUMBER;
 
 	inline
@@ -0,0 +1,251 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	NWScriptStructurePool.cpp
+
+Abstract:
+
+	This module houses the engine structure pool, which recycles the storage
+	of released engine structures on a per engine type free list.
+
+--*/
+
+#include "Precomp.h"
+#include "NWScriptStack.h"
+#include "NWScriptInternal.h"
+
+//
+// Define the maximum count of free blocks cached per engine type.  Blocks
+// released beyond this depth are returned to the heap.
+//
+
+#define POOL_MAX_FREE_DEPTH 256
+
+//
+// Define the pool index of a block that was not allocated from a pool (i.e.
+// one whose size did not match the block size of its engine type's pool).
+//
+
+#define POOL_INDEX_UNPOOLED ((ULONG) -1)
+
+//
+// Define the header that precedes every block handed out by the pool.  The
+// header keeps the block aligned for the interlocked free list, and records
+// the pool that the block belongs to while it is in use.
+//
+
+typedef union DECLSPEC_ALIGN( MEMORY_ALLOCATION_ALIGNMENT ) _POOL_BLOCK_HEADER
+{
+	SLIST_ENTRY FreeListEntry;
+	ULONG       PoolIndex;
+} POOL_BLOCK_HEADER, * PPOOL_BLOCK_HEADER;
+
+//
+// Define the state of the pool of one engine type.  The block size is fixed
+// by the first allocation, as each engine type is implemented by a single
+// class in a given script host.
+//
+
+typedef struct DECLSPEC_ALIGN( MEMORY_ALLOCATION_ALIGNMENT ) _ENGINE_STRUCTURE_POOL
+{
+	SLIST_HEADER  FreeList;
+	volatile LONG BlockSize;
+} ENGINE_STRUCTURE_POOL, * PENGINE_STRUCTURE_POOL;
+
+static ENGINE_STRUCTURE_POOL g_Pools[ LAST_ENGINE_STRUCTURE + 1 ];
+
+//
+// Define the allocation counters of all pools.
+//
+
+static volatile LONG g_Allocations;
+static volatile LONG g_Recycled;
+static volatile LONG g_Frees;
+
+//
+// Initialize the free lists at module load time.
+//
+
+static
+class EngineStructurePoolInitializer
+{
+
+public:
+
+	inline
+	EngineStructurePoolInitializer(
+		)
+	{
+		for (ULONG i = 0; i < RTL_NUMBER_OF( g_Pools ); i += 1)
+		{
+			InitializeSListHead( &g_Pools[ i ].FreeList );
+			g_Pools[ i ].BlockSize = 0;
+		}
+	}
+
+} g_PoolInitializer;
+
+void *
+EngineStructurePool::Allocate(
+	__in size_t Size,
+	__in ENGINE_STRUCTURE_NUMBER EngineType
+	)
+/*++
+
+Routine Description:
+
+	This routine allocates storage for an engine structure.  If the pool of
+	the engine type has a free block of the right size, it is reused, else a
+	new block is allocated from the process heap.
+
+Arguments:
+
+	Size - Supplies the size, in bytes, of the engine structure.
+
+	EngineType - Supplies the engine type of the structure.
+
+Return Value:
+
+	The routine returns a pointer to the storage for the engine structure.  On
+	failure, an std::bad_alloc exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PPOOL_BLOCK_HEADER     Header;
+	PENGINE_STRUCTURE_POOL Pool;
+	ULONG                  PoolIndex;
+
+	if (Size > (size_t) LONG_MAX - sizeof( POOL_BLOCK_HEADER ))
+		throw std::bad_alloc( );
+
+	InterlockedIncrement( &g_Allocations );
+
+	PoolIndex = POOL_INDEX_UNPOOLED;
+
+	if (EngineType <= LAST_ENGINE_STRUCTURE)
+	{
+		Pool = &g_Pools[ EngineType ];
+
+		//
+		// The first allocation of an engine type decides the block size of its
+		// pool.  Any other size is served by the heap directly.
+		//
+
+		if (Pool->BlockSize == 0)
+			InterlockedCompareExchange( &Pool->BlockSize, (LONG) Size, 0 );
+
+		if (Pool->BlockSize == (LONG) Size)
+		{
+			PoolIndex = EngineType;
+
+			Header = (PPOOL_BLOCK_HEADER) InterlockedPopEntrySList( &Pool->FreeList );
+
+			if (Header != NULL)
+			{
+				InterlockedIncrement( &g_Recycled );
+
+				Header->PoolIndex = PoolIndex;
+
+				return Header + 1;
+			}
+		}
+	}
+
+	Header = (PPOOL_BLOCK_HEADER) HeapAlloc(
+		GetProcessHeap( ),
+		0,
+		sizeof( POOL_BLOCK_HEADER ) + Size);
+
+	if (Header == NULL)
+		throw std::bad_alloc( );
+
+	Header->PoolIndex = PoolIndex;
+
+	return Header + 1;
+}
+
+void
+EngineStructurePool::Free(
+	__in_opt void * p
+	)
+/*++
+
+Routine Description:
+
+	This routine releases storage returned by Allocate.  Pooled blocks are
+	placed on the free list of their engine type unless it is already full.
+
+Arguments:
+
+	p - Supplies the storage to release.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PPOOL_BLOCK_HEADER     Header;
+	PENGINE_STRUCTURE_POOL Pool;
+
+	if (p == NULL)
+		return;
+
+	InterlockedIncrement( &g_Frees );
+
+	Header = (PPOOL_BLOCK_HEADER) p - 1;
+
+	if (Header->PoolIndex != POOL_INDEX_UNPOOLED)
+	{
+		Pool = &g_Pools[ Header->PoolIndex ];
+
+		if (QueryDepthSList( &Pool->FreeList ) < POOL_MAX_FREE_DEPTH)
+		{
+			InterlockedPushEntrySList( &Pool->FreeList, &Header->FreeListEntry );
+			return;
+		}
+	}
+
+	HeapFree( GetProcessHeap( ), 0, Header );
+}
+
+void
+EngineStructurePool::GetStats(
+	__out PoolStats & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the cumulative allocation counters of the engine
+	structure pool.
+
+Arguments:
+
+	Stats - Receives the allocation counters.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Stats.Allocations = (ULONG) g_Allocations;
+	Stats.Recycled    = (ULONG) g_Recycled;
+	Stats.Frees       = (ULONG) g_Frees;
+}
@@ -92,6 +92,7 @@ Environment:
   m_TextOut( TextOut ),
   m_DebugLevel( EDL_Errors ),
   m_InstructionsExecuted( 0 ),
+  m_TotalInstructionsExecuted( 0 ),
   m_RecursionLevel( 0 ),
   m_CurrentActionObjectSelf( NWN::INVALIDOBJID ),
   m_ActionDefs( ActionDefs ),
@@ -3353,7 +3354,8 @@ Environment:
 
 		VMStack.ResetStack( );
 
-		m_InstructionsExecuted = 0;
+		m_TotalInstructionsExecuted += m_InstructionsExecuted;
+		m_InstructionsExecuted       = 0;
 	}
 }
 
@@ -81,10 +81,12 @@ public:
 
 	//
 	// Define the full state of the script VM, used to save and restore
-	// execution (such as for a delayed action).
+	// execution (such as for a delayed action).  Like the VM itself, saved
+	// states are confined to a single thread, so their reference count need
+	// not be interlocked.
 	//
 
-	struct VMState
+	struct VMState : public swutil::LocalIntrusiveRefCounted
 	{
 		NWScriptStack     Stack;
 		NWScriptReaderPtr Script;
@@ -93,7 +95,7 @@ public:
 		NWN::OBJECTID     ObjectInvalid;
 		bool              Aborted;
 
-		typedef swutil::SharedPtr< VMState > Ptr;
+		typedef swutil::IntrusivePtr< VMState > Ptr;
 	};
 
 
@@ -252,6 +254,20 @@ public:
 		return m_CurrentActionObjectSelf;
 	}
 
+	//
+	// Return the count of instructions executed by all completed top level
+	// invocations of the VM since it was created.  This is maintained for
+	// benchmarking and is only updated when the outermost script returns.
+	//
+
+	inline
+	ULONGLONG
+	GetTotalInstructionsExecuted(
+		) const
+	{
+		return m_TotalInstructionsExecuted;
+	}
+
 	//
 	// Decode an instruction, returning the opcode data and the length.
 	//
@@ -571,6 +587,13 @@ private:
 
 	size_t                     m_InstructionsExecuted;
 
+	//
+	// Define the cumulative count of instructions executed by completed top
+	// level invocation contexts.
+	//
+
+	ULONGLONG                  m_TotalInstructionsExecuted;
+
 	//
 	// Define the current recursion level within the script VM.
 	//
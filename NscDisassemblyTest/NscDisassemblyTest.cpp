@@ -0,0 +1,1492 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	NscDisassemblyTest.cpp
+
+Abstract:
+
+	This module houses a program that checks the listing produced by
+	NscScriptDecompile against the previous, sprintf based, disassembler
+	(kept in OldDisassembler.h), and measures the speed of both.
+
+	The check disassembles generated scripts that use every opcode and
+	operand form, corrupted copies of those scripts (byte flips, truncation,
+	inserted and overwritten bytes, oversized string lengths) and random
+	bytes.  Float constants get a dedicated pass over edge cases and their
+	neighbors (signed zeros, ties at the sixth decimal place, values at and
+	above 1e9, NaNs, infinities and denormals) and over random bit patterns.
+	Compiled scripts (.ncs) named on the command line, or found in named
+	directories, are checked as well.
+
+--*/
+
+#include "Precomp.h"
+#include "OldDisassembler.h"
+
+//
+// Define the script header that precedes the instruction stream.
+//
+
+#define NCS_HEADER_SIZE 8
+
+const unsigned char NcsHeader[ NCS_HEADER_SIZE ] = { 'N', 'C', 'S', ' ', 'V', '1', '.', '0' };
+
+//
+// Define the number of float constants placed in each float check script.
+//
+
+#define FLOATS_PER_SCRIPT 4096
+
+//
+// Define the operand type bytes that the disassembler names.
+//
+
+const unsigned char KnownTypes[ ] =
+{
+	0x03, 0x04, 0x05, 0x06, 0x10, 0x11, 0x12, 0x13, 0x20, 0x21,
+	0x22, 0x23, 0x24, 0x25, 0x26, 0x30, 0x3A, 0x3B, 0x3C
+};
+
+//
+// Define float bit patterns whose formatting is checked along with their
+// neighbors and their negations.
+//
+
+const unsigned long FloatEdgeCases[ ] =
+{
+	0x00000000, // 0
+	0x00000001, // Smallest denormal
+	0x00400000, // Denormal
+	0x007FFFFF, // Largest denormal
+	0x00800000, // FLT_MIN
+	0x3F800000, // 1
+	0x3F000000, // 0.5
+	0x3C000000, // 1/128, a tie at the sixth decimal place
+	0x3CC00000, // 3/128, a tie
+	0x35000000, // 2^-21, below 0.5e-6
+	0x350637BD, // 0.5e-6
+	0x358637BD, // 1e-6
+	0x3F7FFFF8, // 0.9999995
+	0x49742400, // 1e6
+	0x4B800000, // 2^24
+	0x4E6E6B28, // 1e9
+	0x4F000000, // 2^31
+	0x4F800000, // 2^32
+	0x5F800000, // 2^64
+	0x7F7FFFFF, // FLT_MAX
+	0x7F800000, // Infinity
+	0x7F800001, // Signaling NaN
+	0x7FBFFFFF, // Signaling NaN
+	0x7FC00000, // Quiet NaN
+	0x7FFFFFFF  // Quiet NaN
+};
+
+//
+// Define the results of a group of checks.
+//
+
+struct CHECK_STATS
+{
+	unsigned long    Scripts;
+	unsigned long    Mismatches;
+	unsigned __int64 CodeBytes;
+	unsigned __int64 TextBytes;
+	LONGLONG         OldTime;
+	LONGLONG         NewTime;
+};
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine advances a linear congruential generator and returns its
+	next value.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns a 24-bit pseudorandom value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+unsigned long
+RandomValue32(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns a 32-bit operand value, biased towards small values
+	and values near the ends of the range.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns a 32-bit pseudorandom value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (NextRandom( Seed ) % 4)
+	{
+
+	case 0:
+		return NextRandom( Seed ) % 256;
+
+	case 1:
+		return 0xFFFFFFFF - (NextRandom( Seed ) % 256);
+
+	default:
+		return (NextRandom( Seed ) << 16) ^ NextRandom( Seed );
+
+	}
+}
+
+unsigned long
+RandomFloatBits(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the bits of a float constant: an edge case or one of
+	its neighbors, a tie at the sixth decimal place, or random bits.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the IEEE bits of a float.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Bits;
+	float         Value;
+
+	switch (NextRandom( Seed ) % 4)
+	{
+
+	case 0:
+		Bits  = FloatEdgeCases[ NextRandom( Seed ) % (sizeof( FloatEdgeCases ) / sizeof( FloatEdgeCases[ 0 ] )) ];
+		Bits += (NextRandom( Seed ) % 3) - 1;
+		break;
+
+	case 1:
+		//
+		// Odd multiples of 1/128 are exactly halfway between two six place
+		// decimals.
+		//
+
+		Value = (float) ((NextRandom( Seed ) % 65536) * 2 + 1) / 128.0f;
+		memcpy( &Bits, &Value, sizeof( Bits ) );
+		break;
+
+	default:
+		Bits = (NextRandom( Seed ) << 16) ^ NextRandom( Seed );
+		break;
+
+	}
+
+	if (NextRandom( Seed ) % 2)
+		Bits ^= 0x80000000;
+
+	return Bits;
+}
+
+void
+PutByte(
+	__inout std::vector< unsigned char > & Code,
+	__in unsigned long Value
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a byte to a script.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Value - Supplies the byte value, in the low 8 bits.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Code.push_back( (unsigned char) (Value & 0xFF) );
+}
+
+void
+PutUINT16(
+	__inout std::vector< unsigned char > & Code,
+	__in unsigned long Value
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a big endian 16-bit value to a script.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Value - Supplies the value, in the low 16 bits.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PutByte( Code, Value >> 8 );
+	PutByte( Code, Value );
+}
+
+void
+PutUINT32(
+	__inout std::vector< unsigned char > & Code,
+	__in unsigned long Value
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a big endian 32-bit value to a script.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Value - Supplies the value.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PutUINT16( Code, Value >> 16 );
+	PutUINT16( Code, Value );
+}
+
+unsigned long
+RandomType(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns an operand type byte, usually one that the
+	disassembler names.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the type byte.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (NextRandom( Seed ) % 8 == 0)
+		return NextRandom( Seed ) % 256;
+
+	return KnownTypes[ NextRandom( Seed ) % sizeof( KnownTypes ) ];
+}
+
+unsigned long
+RandomMarker(
+	__inout unsigned long & Seed,
+	__in unsigned long Marker
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the fixed auxiliary byte of an instruction, which
+	is occasionally wrong so that the instruction is invalid.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+	Marker - Supplies the auxiliary byte that the instruction requires.
+
+Return Value:
+
+	The routine returns the auxiliary byte.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (NextRandom( Seed ) % 32 == 0)
+		return NextRandom( Seed ) % 256;
+
+	return Marker;
+}
+
+void
+PutString(
+	__inout std::vector< unsigned char > & Code,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine appends the length and text of a string constant.  Strings
+	may be longer than the 128 characters that are listed, and may contain
+	NULs and arbitrary bytes.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Length;
+	unsigned long Kind;
+
+	if (NextRandom( Seed ) % 8 == 0)
+		Length = 100 + NextRandom( Seed ) % 200;
+	else
+		Length = NextRandom( Seed ) % 40;
+
+	Kind = NextRandom( Seed ) % 4;
+
+	PutUINT16( Code, Length );
+
+	for (unsigned long i = 0; i < Length; i += 1)
+	{
+		unsigned long c;
+
+		c = ' ' + NextRandom( Seed ) % 95;
+
+		if ((Kind == 1) && (NextRandom( Seed ) % 16 == 0))
+			c = 0;
+		else if (Kind == 2)
+			c = NextRandom( Seed ) % 256;
+
+		PutByte( Code, c );
+	}
+}
+
+void
+PutInstruction(
+	__inout std::vector< unsigned char > & Code,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine appends one randomly chosen instruction to a script.  Every
+	opcode and operand form is produced, along with the occasional invalid
+	opcode or auxiliary byte.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Op;
+	unsigned long Type;
+
+	if (NextRandom( Seed ) % 32 == 0)
+		Op = NextRandom( Seed ) % 256;
+	else
+		Op = NscCode_CPDOWNSP + NextRandom( Seed ) % (NscCode_NOP - NscCode_CPDOWNSP + 2);
+
+	if (Op == NscCode_NOP + 1)
+		Op = NscCode_Size;
+
+	PutByte( Code, Op );
+
+	switch (Op)
+	{
+
+	case NscCode_CPDOWNSP:
+	case NscCode_CPTOPSP:
+	case NscCode_CPDOWNBP:
+	case NscCode_CPTOPBP:
+		PutByte( Code, RandomMarker( Seed, 1 ) );
+		PutUINT32( Code, RandomValue32( Seed ) );
+		PutUINT16( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_RSADD:
+	case NscCode_NEG:
+	case NscCode_COMP:
+	case NscCode_NOT:
+	case NscCode_STORE_STATEALL:
+		PutByte( Code, RandomType( Seed ) );
+		break;
+
+	case NscCode_CONST:
+		switch (NextRandom( Seed ) % 9)
+		{
+
+		case 0:
+		case 1:
+			Type = 3;
+			break;
+
+		case 2:
+			Type = 6;
+			break;
+
+		case 3:
+		case 4:
+		case 5:
+			Type = 4;
+			break;
+
+		case 6:
+		case 7:
+			Type = 5;
+			break;
+
+		default:
+			Type = RandomType( Seed );
+			break;
+
+		}
+
+		PutByte( Code, Type );
+
+		if ((Type == 3) || (Type == 6))
+			PutUINT32( Code, RandomValue32( Seed ) );
+		else if (Type == 4)
+			PutUINT32( Code, RandomFloatBits( Seed ) );
+		else if (Type == 5)
+			PutString( Code, Seed );
+		break;
+
+	case NscCode_ACTION:
+		PutByte( Code, RandomMarker( Seed, 0 ) );
+		PutUINT16( Code, RandomValue32( Seed ) );
+		PutByte( Code, NextRandom( Seed ) );
+		break;
+
+	case NscCode_LOGAND:
+	case NscCode_LOGOR:
+	case NscCode_INCOR:
+	case NscCode_EXCOR:
+	case NscCode_BOOLAND:
+	case NscCode_EQUAL:
+	case NscCode_NEQUAL:
+	case NscCode_GEQ:
+	case NscCode_GT:
+	case NscCode_LT:
+	case NscCode_LEQ:
+	case NscCode_SHLEFT:
+	case NscCode_SHRIGHT:
+	case NscCode_USHRIGHT:
+	case NscCode_ADD:
+	case NscCode_SUB:
+	case NscCode_MUL:
+	case NscCode_DIV:
+	case NscCode_MOD:
+		if (NextRandom( Seed ) % 4 == 0)
+			Type = 0x24;
+		else
+			Type = RandomType( Seed );
+
+		PutByte( Code, Type );
+
+		if (Type == 0x24)
+			PutUINT16( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_MOVSP:
+	case NscCode_JMP:
+	case NscCode_JSR:
+	case NscCode_JZ:
+	case NscCode_JNZ:
+		PutByte( Code, RandomMarker( Seed, 0 ) );
+		PutUINT32( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_DECISP:
+	case NscCode_INCISP:
+	case NscCode_DECIBP:
+	case NscCode_INCIBP:
+		PutByte( Code, RandomMarker( Seed, 3 ) );
+		PutUINT32( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_RETN:
+	case NscCode_SAVEBP:
+	case NscCode_RESTOREBP:
+	case NscCode_NOP:
+		PutByte( Code, RandomMarker( Seed, 0 ) );
+		break;
+
+	case NscCode_DESTRUCT:
+		PutByte( Code, RandomMarker( Seed, 1 ) );
+		PutUINT16( Code, RandomValue32( Seed ) );
+		PutUINT16( Code, RandomValue32( Seed ) );
+		PutUINT16( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_STORE_STATE:
+		PutByte( Code, RandomMarker( Seed, 0x10 ) );
+		PutUINT32( Code, RandomValue32( Seed ) );
+		PutUINT32( Code, RandomValue32( Seed ) );
+		break;
+
+	case NscCode_Size:
+		PutUINT32( Code, RandomValue32( Seed ) );
+		break;
+
+	default:
+		break;
+
+	}
+}
+
+void
+BuildScript(
+	__out std::vector< unsigned char > & Code,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine builds a script of random instructions, preceded by the
+	script header and size instruction that the compiler emits.
+
+Arguments:
+
+	Code - Receives the script.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Count;
+
+	Count = 1 + NextRandom( Seed ) % 2000;
+
+	Code.assign( NcsHeader, NcsHeader + NCS_HEADER_SIZE );
+	PutByte( Code, NscCode_Size );
+	PutUINT32( Code, 0 );
+
+	for (unsigned long i = 0; i < Count; i += 1)
+		PutInstruction( Code, Seed );
+
+	Code[ NCS_HEADER_SIZE + 1 ] = (unsigned char) ((Code.size( ) >> 24) & 0xFF);
+	Code[ NCS_HEADER_SIZE + 2 ] = (unsigned char) ((Code.size( ) >> 16) & 0xFF);
+	Code[ NCS_HEADER_SIZE + 3 ] = (unsigned char) ((Code.size( ) >>  8) & 0xFF);
+	Code[ NCS_HEADER_SIZE + 4 ] = (unsigned char) ((Code.size( )      ) & 0xFF);
+}
+
+void
+CorruptScript(
+	__inout std::vector< unsigned char > & Code,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine damages a script in one of several ways, so that operands
+	run off the end of the script and instruction boundaries shift.
+
+Arguments:
+
+	Code - Supplies the script to damage.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	size_t Offset;
+	size_t Length;
+
+	if (Code.empty( ))
+		return;
+
+	Offset = NextRandom( Seed ) % Code.size( );
+
+	switch (NextRandom( Seed ) % 5)
+	{
+
+	case 0:
+		//
+		// Flip bits in a few bytes.
+		//
+
+		for (unsigned long i = 1 + NextRandom( Seed ) % 8; i != 0; i -= 1)
+		{
+			size_t Flip;
+
+			Flip         = NextRandom( Seed ) % Code.size( );
+			Code[ Flip ] = (unsigned char) (Code[ Flip ] ^ (1 + NextRandom( Seed ) % 255));
+		}
+		break;
+
+	case 1:
+		//
+		// Truncate the script.
+		//
+
+		Code.resize( Offset );
+		break;
+
+	case 2:
+		//
+		// Insert random bytes.
+		//
+
+		Length = 1 + NextRandom( Seed ) % 16;
+
+		for (size_t i = 0; i < Length; i += 1)
+			Code.insert( Code.begin( ) + Offset, (unsigned char) NextRandom( Seed ) );
+		break;
+
+	case 3:
+		//
+		// Overwrite a run of bytes.
+		//
+
+		Length = 1 + NextRandom( Seed ) % 64;
+
+		for (size_t i = Offset; (i < Offset + Length) && (i < Code.size( )); i += 1)
+			Code[ i ] = (unsigned char) NextRandom( Seed );
+		break;
+
+	default:
+		//
+		// Plant a string constant whose length runs past the end.
+		//
+
+		if (Code.size( ) < 4)
+			break;
+
+		if (Code.size( ) - Offset < 4)
+			Offset = 0;
+
+		Code[ Offset + 0 ] = NscCode_CONST;
+		Code[ Offset + 1 ] = 5;
+		Code[ Offset + 2 ] = 0xFF;
+		Code[ Offset + 3 ] = (unsigned char) NextRandom( Seed );
+		break;
+
+	}
+}
+
+bool
+CheckScript(
+	__in const std::vector< unsigned char > & Code,
+	__in const char * Description,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine disassembles a script with the previous and the current
+	disassembler, and compares the listings.
+
+	Each disassembler is given its own exactly sized copy of the script, so
+	that reading past the end faults under the page heap.
+
+Arguments:
+
+	Code - Supplies the script to disassemble.
+
+	Description - Supplies a description of the script for error messages.
+
+	Stats - Supplies the statistics of the run, which are updated.
+
+Return Value:
+
+	The routine returns true if the listings match, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > OldCode( Code );
+	std::vector< unsigned char > NewCode( Code );
+	CNwnMemoryStream             OldText;
+	CNwnMemoryStream             NewText;
+	unsigned char                Empty;
+	LARGE_INTEGER                Start;
+	LARGE_INTEGER                End;
+	size_t                       Length;
+	const char                 * OldData;
+	const char                 * NewData;
+
+	Empty = 0;
+
+	QueryPerformanceCounter( &Start );
+
+	NscOldScriptDecompile(
+		OldText,
+		OldCode.empty( ) ? &Empty : &OldCode[ 0 ],
+		(unsigned long) OldCode.size( ),
+		NULL);
+
+	QueryPerformanceCounter( &End );
+
+	Stats.OldTime += End.QuadPart - Start.QuadPart;
+
+	QueryPerformanceCounter( &Start );
+
+	NscScriptDecompile(
+		NewText,
+		NewCode.empty( ) ? &Empty : &NewCode[ 0 ],
+		(unsigned long) NewCode.size( ),
+		NULL);
+
+	QueryPerformanceCounter( &End );
+
+	Stats.NewTime   += End.QuadPart - Start.QuadPart;
+	Stats.Scripts   += 1;
+	Stats.CodeBytes += Code.size( );
+	Stats.TextBytes += OldText.GetLength( );
+
+	OldData = (const char *) OldText.GetData( );
+	NewData = (const char *) NewText.GetData( );
+	Length  = OldText.GetLength( );
+
+	if ((Length == NewText.GetLength( )) &&
+	    ((Length == 0) || (!memcmp( OldData, NewData, Length ))))
+	{
+		return true;
+	}
+
+	if (Stats.Mismatches < 16)
+	{
+		size_t      Line;
+		size_t      LineStart;
+		size_t      OldEnd;
+		size_t      NewEnd;
+		size_t      i;
+		std::string OldLine;
+		std::string NewLine;
+
+		//
+		// Locate the first line that differs.
+		//
+
+		Line      = 1;
+		LineStart = 0;
+
+		for (i = 0; (i < Length) && (i < NewText.GetLength( )) && (OldData[ i ] == NewData[ i ]); i += 1)
+		{
+			if (OldData[ i ] == '\n')
+			{
+				Line      += 1;
+				LineStart  = i + 1;
+			}
+		}
+
+		for (OldEnd = LineStart; (OldEnd < Length) && (OldData[ OldEnd ] != '\r'); OldEnd += 1)
+			;
+		for (NewEnd = LineStart; (NewEnd < NewText.GetLength( )) && (NewData[ NewEnd ] != '\r'); NewEnd += 1)
+			;
+
+		if (LineStart < Length)
+			OldLine.assign( OldData + LineStart, OldData + OldEnd );
+		if (LineStart < NewText.GetLength( ))
+			NewLine.assign( NewData + LineStart, NewData + NewEnd );
+
+		printf(
+			"MISMATCH: %s, %lu bytes, line %lu:\n"
+			"  old: %s\n"
+			"  new: %s\n",
+			Description,
+			(unsigned long) Code.size( ),
+			(unsigned long) Line,
+			OldLine.c_str( ),
+			NewLine.c_str( ));
+	}
+
+	Stats.Mismatches += 1;
+
+	return false;
+}
+
+void
+CheckGenerated(
+	__in unsigned long Count,
+	__in unsigned long Seed,
+	__inout CHECK_STATS & Stats,
+	__inout CHECK_STATS & DamagedStats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks generated scripts, corrupted copies of them and
+	scripts of random bytes.
+
+Arguments:
+
+	Count - Supplies the number of scripts to generate.
+
+	Seed - Supplies the seed of the generator.
+
+	Stats - Supplies the statistics for the intact scripts.
+
+	DamagedStats - Supplies the statistics for the damaged and random
+	               scripts.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Code;
+	char                         Description[ 64 ];
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		BuildScript( Code, Seed );
+
+		StringCbPrintfA( Description, sizeof( Description ), "generated script %lu", i );
+		CheckScript( Code, Description, Stats );
+
+		for (unsigned long j = 1 + NextRandom( Seed ) % 3; j != 0; j -= 1)
+			CorruptScript( Code, Seed );
+
+		StringCbPrintfA( Description, sizeof( Description ), "corrupted script %lu", i );
+		CheckScript( Code, Description, DamagedStats );
+
+		if (i % 8 == 0)
+		{
+			Code.resize( NextRandom( Seed ) % 4096 );
+
+			for (size_t j = 0; j < Code.size( ); j += 1)
+				Code[ j ] = (unsigned char) NextRandom( Seed );
+
+			StringCbPrintfA( Description, sizeof( Description ), "random script %lu", i );
+			CheckScript( Code, Description, DamagedStats );
+		}
+	}
+}
+
+void
+PutFloatConstant(
+	__inout std::vector< unsigned char > & Code,
+	__in unsigned long Bits
+	)
+/*++
+
+Routine Description:
+
+	This routine appends a CONSTF instruction to a script.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Bits - Supplies the IEEE bits of the float.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PutByte( Code, NscCode_CONST );
+	PutByte( Code, 4 );
+	PutUINT32( Code, Bits );
+}
+
+void
+FlushFloatScript(
+	__inout std::vector< unsigned char > & Code,
+	__in bool Force,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks a float constant script once it is full (or when
+	forced), and starts the next one.
+
+Arguments:
+
+	Code - Supplies the script under construction.
+
+	Force - Supplies true if a partial script is to be checked.
+
+	Stats - Supplies the statistics of the float checks.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	size_t Count;
+
+	Count = (Code.size( ) - NCS_HEADER_SIZE) / 6;
+
+	if ((Count < FLOATS_PER_SCRIPT) && ((!Force) || (Count == 0)))
+		return;
+
+	CheckScript( Code, "float constants", Stats );
+
+	Code.assign( NcsHeader, NcsHeader + NCS_HEADER_SIZE );
+}
+
+void
+CheckFloats(
+	__in unsigned long Count,
+	__in unsigned long Seed,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the formatting of float constants: every edge case
+	with its neighbors and negation, the ties at the sixth decimal place,
+	every exponent, and random bit patterns.
+
+Arguments:
+
+	Count - Supplies the number of random bit patterns to check.
+
+	Seed - Supplies the seed of the generator.
+
+	Stats - Supplies the statistics of the float checks.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Code;
+	float                        Value;
+	unsigned long                Bits;
+
+	Code.assign( NcsHeader, NcsHeader + NCS_HEADER_SIZE );
+
+	for (size_t i = 0; i < sizeof( FloatEdgeCases ) / sizeof( FloatEdgeCases[ 0 ] ); i += 1)
+	{
+		for (unsigned long Sign = 0; Sign < 2; Sign += 1)
+		{
+			Bits = FloatEdgeCases[ i ] ^ (Sign << 31);
+
+			PutFloatConstant( Code, Bits - 1 );
+			PutFloatConstant( Code, Bits );
+			PutFloatConstant( Code, Bits + 1 );
+		}
+	}
+
+	FlushFloatScript( Code, true, Stats );
+
+	//
+	// Odd multiples of 1/128 up to 2^24 are ties at the sixth decimal place,
+	// and those below 1e9 are exact floats.
+	//
+
+	for (unsigned long i = 1; i < 0x1000000; i += (i < 0x10000) ? 2 : 2 * (NextRandom( Seed ) % 512 + 1))
+	{
+		Value = (float) i / 128.0f;
+		memcpy( &Bits, &Value, sizeof( Bits ) );
+
+		PutFloatConstant( Code, Bits );
+		PutFloatConstant( Code, Bits ^ 0x80000000 );
+		FlushFloatScript( Code, false, Stats );
+	}
+
+	FlushFloatScript( Code, true, Stats );
+
+	//
+	// Every exponent, with the extreme and some random mantissas.
+	//
+
+	for (unsigned long Exponent = 0; Exponent < 256; Exponent += 1)
+	{
+		for (unsigned long j = 0; j < 32; j += 1)
+		{
+			unsigned long Mantissa;
+
+			if (j == 0)
+				Mantissa = 0;
+			else if (j == 1)
+				Mantissa = 0x7FFFFF;
+			else
+				Mantissa = ((NextRandom( Seed ) << 8) ^ NextRandom( Seed )) & 0x7FFFFF;
+
+			Bits = (Exponent << 23) | Mantissa;
+
+			PutFloatConstant( Code, Bits );
+			PutFloatConstant( Code, Bits ^ 0x80000000 );
+			FlushFloatScript( Code, false, Stats );
+		}
+	}
+
+	FlushFloatScript( Code, true, Stats );
+
+	//
+	// Random bit patterns.
+	//
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		PutFloatConstant( Code, (NextRandom( Seed ) << 16) ^ NextRandom( Seed ) );
+		FlushFloatScript( Code, false, Stats );
+	}
+
+	FlushFloatScript( Code, true, Stats );
+}
+
+bool
+ReadWholeFile(
+	__in const char * FileName,
+	__out std::vector< unsigned char > & Contents
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the entire contents of a file.
+
+Arguments:
+
+	FileName - Supplies the name of the file to read.
+
+	Contents - Receives the contents of the file.
+
+Return Value:
+
+	The routine returns true if the file was read, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE * f;
+	long   Size;
+	bool   Status;
+
+	f = fopen( FileName, "rb" );
+
+	if (f == NULL)
+		return false;
+
+	Status = false;
+	Size   = -1;
+
+	if (fseek( f, 0, SEEK_END ) == 0)
+		Size = ftell( f );
+
+	if ((Size >= 0) && (fseek( f, 0, SEEK_SET ) == 0))
+	{
+		Contents.resize( (size_t) Size );
+
+		if ((Size == 0) || (fread( &Contents[ 0 ], (size_t) Size, 1, f ) == 1))
+			Status = true;
+	}
+
+	fclose( f );
+
+	return Status;
+}
+
+void
+ScanFile(
+	__in const char * FileName,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the disassembly of a compiled script file.
+
+Arguments:
+
+	FileName - Supplies the name of the file to check.
+
+	Stats - Supplies the statistics of the file checks.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Code;
+
+	if (!ReadWholeFile( FileName, Code ))
+	{
+		printf( "WARNING: Failed to read \"%s\".\n", FileName );
+		return;
+	}
+
+	CheckScript( Code, FileName, Stats );
+}
+
+void
+ScanPath(
+	__in const char * Path,
+	__inout CHECK_STATS & Stats
+	)
+/*++
+
+Routine Description:
+
+	This routine checks a compiled script file, or every compiled script
+	file in a directory.
+
+Arguments:
+
+	Path - Supplies the name of the file or directory to check.
+
+	Stats - Supplies the statistics of the file checks.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	WIN32_FIND_DATAA FindData;
+	HANDLE           Find;
+	std::string      Directory;
+	DWORD            Attributes;
+
+	Attributes = GetFileAttributesA( Path );
+
+	if ((Attributes == INVALID_FILE_ATTRIBUTES) ||
+	    (!(Attributes & FILE_ATTRIBUTE_DIRECTORY)))
+	{
+		ScanFile( Path, Stats );
+		return;
+	}
+
+	Directory  = Path;
+	Directory += "\\";
+
+	Find = FindFirstFileA( (Directory + "*.ncs").c_str( ), &FindData );
+
+	if (Find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+
+		ScanFile( (Directory + FindData.cFileName).c_str( ), Stats );
+	} while (FindNextFileA( Find, &FindData ));
+
+	FindClose( Find );
+}
+
+void
+PrintStats(
+	__in const char * Name,
+	__in const CHECK_STATS & Stats,
+	__in const LARGE_INTEGER & Frequency
+	)
+/*++
+
+Routine Description:
+
+	This routine prints the results and timings of one group of checks.
+
+Arguments:
+
+	Name - Supplies the name of the group.
+
+	Stats - Supplies the statistics of the group.
+
+	Frequency - Supplies the performance counter frequency.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	double OldMs;
+	double NewMs;
+
+	OldMs = (double) Stats.OldTime * 1000.0 / (double) Frequency.QuadPart;
+	NewMs = (double) Stats.NewTime * 1000.0 / (double) Frequency.QuadPart;
+
+	printf(
+		"  %-22s %7lu scripts %10.2f MB in %10.2f MB out %6lu mismatches  %9.1f -> %9.1f ms (%.2fx)\n",
+		Name,
+		Stats.Scripts,
+		(double) Stats.CodeBytes / (1024.0 * 1024.0),
+		(double) Stats.TextBytes / (1024.0 * 1024.0),
+		Stats.Mismatches,
+		OldMs,
+		NewMs,
+		(NewMs > 0.0) ? OldMs / NewMs : 0.0);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"NscDisassemblyTest\n"
+		"\n"
+		"This program checks that NscScriptDecompile produces the same listing as\n"
+		"the previous sprintf based disassembler for generated, corrupted and random\n"
+		"scripts, float constant edge cases, and the given compiled scripts, and\n"
+		"reports the time taken by both.\n"
+		"\n"
+		"Usage: NscDisassemblyTest [-count <scripts>] [-floats <random floats>]\n"
+		"                          [file.ncs|directory ...]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the disassembler test program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long               Count;
+	unsigned long               FloatCount;
+	std::vector< const char * > Paths;
+	CHECK_STATS                 GeneratedStats;
+	CHECK_STATS                 DamagedStats;
+	CHECK_STATS                 FloatStats;
+	CHECK_STATS                 FileStats;
+	LARGE_INTEGER               Frequency;
+	unsigned long               Mismatches;
+
+	Count      = 5000;
+	FloatCount = 1000000;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-count" )) && (i + 1 < argc))
+			Count = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-floats" )) && (i + 1 < argc))
+			FloatCount = strtoul( argv[ ++i ], NULL, 10 );
+		else if (argv[ i ][ 0 ] == '-')
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+		else
+			Paths.push_back( argv[ i ] );
+	}
+
+	ZeroMemory( &GeneratedStats, sizeof( GeneratedStats ) );
+	ZeroMemory( &DamagedStats, sizeof( DamagedStats ) );
+	ZeroMemory( &FloatStats, sizeof( FloatStats ) );
+	ZeroMemory( &FileStats, sizeof( FileStats ) );
+
+	QueryPerformanceFrequency( &Frequency );
+
+	try
+	{
+		CheckGenerated( Count, 1, GeneratedStats, DamagedStats );
+		CheckFloats( FloatCount, 1, FloatStats );
+
+		for (size_t i = 0; i < Paths.size( ); i += 1)
+			ScanPath( Paths[ i ], FileStats );
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	Mismatches = GeneratedStats.Mismatches +
+	             DamagedStats.Mismatches   +
+	             FloatStats.Mismatches     +
+	             FileStats.Mismatches;
+
+	printf( "Disassembly listings (old sprintf disassembler -> NscScriptDecompile):\n" );
+
+	PrintStats( "generated", GeneratedStats, Frequency );
+	PrintStats( "corrupted and random", DamagedStats, Frequency );
+	PrintStats( "float constants", FloatStats, Frequency );
+
+	if (!Paths.empty( ))
+		PrintStats( "compiled scripts", FileStats, Frequency );
+
+	printf( "%lu mismatches.\n", Mismatches );
+
+	return (Mismatches == 0) ? 0 : 1;
+}
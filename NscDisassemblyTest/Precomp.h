@@ -0,0 +1,63 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    Precomp.h
+
+Abstract:
+
+    This module acts as the precompiled header that pulls in all common system,
+    SkywingUtils, and NWNScriptCompilerLib definitions that are used by other
+    modules.
+
+--*/
+
+#ifndef _PROGRAMS_NSCDISASSEMBLYTEST_PRECOMP_H
+#define _PROGRAMS_NSCDISASSEMBLYTEST_PRECOMP_H
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#define _CRT_SECURE_NO_DEPRECATE
+#define _CRT_SECURE_NO_DEPRECATE_GLOBALS
+#define STRSAFE_NO_DEPRECATE
+
+#include <winsock2.h>
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <limits.h>
+#include <float.h>
+#include <stdint.h>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+#include <hash_map>
+#include <sstream>
+#include <set>
+#include <algorithm>
+
+#include <mbctype.h>
+#include <io.h>
+#include <time.h>
+
+#include <tchar.h>
+#include <strsafe.h>
+
+#include "../ProjectGlobal/ProjGlobalDefs.h"
+#include "../SkywingUtils/SkywingUtils.h"
+#include "../NWNBaseLib/NWNBaseLib.h"
+#include "../NWN2MathLib/NWN2MathLib.h"
+#include "../Granny2Lib/Granny2Lib.h"
+#include "../NWN2DataLib/NWN2DataLib.h"
+#include "../NWNScriptCompilerLib/Nsc.h"
+#include "../NWNScriptCompilerLib/NscSymbolTable.h"
+
+#endif
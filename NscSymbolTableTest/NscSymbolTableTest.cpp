@@ -0,0 +1,973 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	NscSymbolTableTest.cpp
+
+Abstract:
+
+	This module houses a program that checks the compiler symbol table
+	(CNscSymbolTable) against the previous bucket based implementation, and
+	measures the speed of both on an identifier-heavy workload.
+
+	The check drives both tables with the same random sequence of adds,
+	scope fences, fence restores and typed and untyped lookups, standalone,
+	chained onto a base table, and detached from the base table part way
+	through.  Each lookup must find the symbol at the same offset in both
+	tables.  Directed cases cover index growth while a fence is held, nested
+	fence restores and FindByType after a restore.
+
+--*/
+
+#include "Precomp.h"
+#include "OldSymbolTable.h"
+
+//
+// Define the parameters of the random equivalence check.
+//
+
+#define CHECK_OPERATION_COUNT 40000
+#define CHECK_NAME_COUNT      400
+#define CHECK_BASE_NAME_COUNT 600
+#define CHECK_MAX_FENCE_DEPTH 12
+
+//
+// Define the shape of the benchmark workload.
+//
+
+#define BENCH_ENGINE_SYMBOLS  4500
+#define BENCH_GLOBAL_SYMBOLS  3000
+#define BENCH_FUNCTIONS       300
+#define BENCH_SCOPE_DEPTH     4
+#define BENCH_SCOPE_LOCALS    40
+#define BENCH_SCOPE_LOOKUPS   600
+
+typedef std::vector< std::string > StringVec;
+
+//
+// Define a pair of tables, one of each implementation, that are driven with
+// the same operations.
+//
+
+struct TablePair
+{
+	CNscSymbolTable    New;
+	CNscOldSymbolTable Old;
+};
+
+//
+// Define the state of the equivalence check.
+//
+
+struct CheckState
+{
+	unsigned long Seed;
+	unsigned long Lookups;
+	unsigned long Mismatches;
+};
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+void
+BuildNames(
+	__out StringVec & Names,
+	__in const char * Prefix,
+	__in size_t Count
+	)
+/*++
+
+Routine Description:
+
+	This routine builds a list of distinct identifiers.
+
+Arguments:
+
+	Names - Receives the identifiers.
+
+	Prefix - Supplies the prefix of each identifier.
+
+	Count - Supplies the count of identifiers to build.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	char Name[ 64 ];
+
+	Names.clear( );
+	Names.reserve( Count );
+
+	for (size_t i = 0; i < Count; i += 1)
+	{
+		StringCbPrintfA( Name, sizeof( Name ), "%s%lu", Prefix, (unsigned long) i );
+		Names.push_back( Name );
+	}
+}
+
+bool
+CompareLookup(
+	__inout TablePair & Tables,
+	__in const char * Name,
+	__in UINT32 SymTypeMask,
+	__inout CheckState & State
+	)
+/*++
+
+Routine Description:
+
+	This routine looks up an identifier in both tables and checks that both
+	find the symbol at the same offset (or that neither finds one).
+
+Arguments:
+
+	Tables - Supplies the tables to search.
+
+	Name - Supplies the identifier to look up.
+
+	SymTypeMask - Supplies the mask of symbol types to accept.
+
+	State - Supplies the check state, whose counters are updated.
+
+Return Value:
+
+	The routine returns true if both tables agree, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NscSymbol * NewSymbol;
+	NscSymbol * OldSymbol;
+	bool        Matched;
+
+	if (SymTypeMask == (UINT32) -1)
+	{
+		NewSymbol = Tables.New.Find( Name );
+		OldSymbol = Tables.Old.Find( Name );
+	}
+	else
+	{
+		NewSymbol = Tables.New.FindByType( Name, SymTypeMask );
+		OldSymbol = Tables.Old.FindByType( Name, SymTypeMask );
+	}
+
+	if ((NewSymbol == NULL) || (OldSymbol == NULL))
+		Matched = (NewSymbol == OldSymbol);
+	else
+		Matched = (Tables.New.GetSymbolOffset( NewSymbol ) == Tables.Old.GetSymbolOffset( OldSymbol )) &&
+		          (NewSymbol->nSymType == OldSymbol->nSymType);
+
+	State.Lookups += 1;
+
+	if (!Matched)
+	{
+		if (State.Mismatches < 16)
+		{
+			printf(
+				"MISMATCH: Lookup of '%s' (mask %08lX): new %s at %lu, old %s at %lu.\n",
+				Name,
+				(unsigned long) SymTypeMask,
+				NewSymbol ? "found" : "not found",
+				NewSymbol ? (unsigned long) Tables.New.GetSymbolOffset( NewSymbol ) : 0ul,
+				OldSymbol ? "found" : "not found",
+				OldSymbol ? (unsigned long) Tables.Old.GetSymbolOffset( OldSymbol ) : 0ul);
+		}
+
+		State.Mismatches += 1;
+	}
+
+	return Matched;
+}
+
+void
+AddSymbol(
+	__inout TablePair & Tables,
+	__in const char * Name,
+	__in NscSymType SymType
+	)
+/*++
+
+Routine Description:
+
+	This routine adds a hashed symbol to both tables.
+
+Arguments:
+
+	Tables - Supplies the tables to add the symbol to.
+
+	Name - Supplies the identifier of the symbol.
+
+	SymType - Supplies the type of the symbol.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Tables.New.Add( Name, SymType );
+	Tables.Old.Add( Name, SymType );
+}
+
+UINT32
+RandomSymTypeMask(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine selects the symbol type mask of a lookup: either every type,
+	or a random subset of the symbol types.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The symbol type mask.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (NextRandom( Seed ) % 3 == 0)
+		return (UINT32) -1;
+
+	return (UINT32) ((NextRandom( Seed ) % 31) + 1) << 1;
+}
+
+void
+LookupRandomNames(
+	__inout TablePair & Tables,
+	__in const StringVec & Names,
+	__in const StringVec & BaseNames,
+	__in size_t Count,
+	__inout CheckState & State
+	)
+/*++
+
+Routine Description:
+
+	This routine looks up a number of random identifiers in both tables,
+	drawn from the local names, the base table names and names that were
+	never added.
+
+Arguments:
+
+	Tables - Supplies the tables to search.
+
+	Names - Supplies the identifiers added to the local table.
+
+	BaseNames - Supplies the identifiers added to the base table.
+
+	Count - Supplies the count of lookups to make.
+
+	State - Supplies the check state.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < Count; i += 1)
+	{
+		unsigned long Choice = NextRandom( State.Seed ) % 8;
+		UINT32        Mask   = RandomSymTypeMask( State.Seed );
+
+		if ((Choice < 2) && (!BaseNames.empty( )))
+		{
+			CompareLookup(
+				Tables,
+				BaseNames[ NextRandom( State.Seed ) % BaseNames.size( ) ].c_str( ),
+				Mask,
+				State);
+		}
+		else if (Choice == 2)
+		{
+			char Name[ 32 ];
+
+			StringCbPrintfA( Name, sizeof( Name ), "absent%lu", NextRandom( State.Seed ) % 1000 );
+			CompareLookup( Tables, Name, Mask, State );
+		}
+		else
+		{
+			CompareLookup(
+				Tables,
+				Names[ NextRandom( State.Seed ) % Names.size( ) ].c_str( ),
+				Mask,
+				State);
+		}
+	}
+}
+
+void
+RunRandomCheck(
+	__in bool UseBase,
+	__in bool Detach,
+	__inout CheckState & State
+	)
+/*++
+
+Routine Description:
+
+	This routine drives both tables with the same random sequence of adds,
+	fences, fence restores and lookups, and compares every lookup.
+
+Arguments:
+
+	UseBase - Supplies a Boolean value that indicates whether the tables are
+	          chained onto base tables.
+
+	Detach - Supplies a Boolean value that indicates whether the tables are
+	         detached from their base tables half way through the sequence.
+
+	State - Supplies the check state.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	TablePair                        Base;
+	TablePair                        Tables;
+	StringVec                        Names;
+	StringVec                        BaseNames;
+	std::vector< NscSymbolFence >    NewFences;
+	std::vector< NscOldSymbolFence > OldFences;
+
+	BuildNames( Names, "ident", CHECK_NAME_COUNT );
+
+	if (UseBase)
+	{
+		BuildNames( BaseNames, "Engine", CHECK_BASE_NAME_COUNT );
+
+		for (size_t i = 0; i < BaseNames.size( ); i += 1)
+			AddSymbol( Base, BaseNames[ i ].c_str( ), (NscSymType) (1 + (i % 5)) );
+
+		//
+		// Shadow some of the base names locally as well.
+		//
+
+		for (size_t i = 0; i < 64; i += 1)
+			Names.push_back( BaseNames[ NextRandom( State.Seed ) % BaseNames.size( ) ] );
+
+		Tables.New.SetBase( &Base.New );
+		Tables.Old.SetBase( &Base.Old );
+	}
+
+	for (unsigned long Op = 0; Op < CHECK_OPERATION_COUNT; Op += 1)
+	{
+		unsigned long Choice = NextRandom( State.Seed ) % 100;
+
+		if ((Detach) && (Op == CHECK_OPERATION_COUNT / 2))
+		{
+			Tables.New.Detach( );
+			Tables.Old.Detach( );
+			LookupRandomNames( Tables, Names, BaseNames, 64, State );
+		}
+
+		if (Choice < 30)
+		{
+			AddSymbol(
+				Tables,
+				Names[ NextRandom( State.Seed ) % Names.size( ) ].c_str( ),
+				(NscSymType) (1 + NextRandom( State.Seed ) % 5));
+		}
+		else if (Choice < 33)
+		{
+			const char * Name = Names[ NextRandom( State.Seed ) % Names.size( ) ].c_str( );
+
+			Tables.New.AddNoHash( Name, NscSymType_Linker );
+			Tables.Old.AddNoHash( Name, NscSymType_Linker );
+		}
+		else if (Choice < 34)
+		{
+			unsigned char Data[ 24 ];
+
+			for (size_t i = 0; i < sizeof( Data ); i += 1)
+				Data[ i ] = (unsigned char) NextRandom( State.Seed );
+
+			Tables.New.AppendData( Data, sizeof( Data ) );
+			Tables.Old.AppendData( Data, sizeof( Data ) );
+		}
+		else if ((Choice < 41) && (NewFences.size( ) < CHECK_MAX_FENCE_DEPTH))
+		{
+			NscSymbolFence    NewFence;
+			NscOldSymbolFence OldFence;
+
+			ZeroMemory( &NewFence, sizeof( NewFence ) );
+			ZeroMemory( &OldFence, sizeof( OldFence ) );
+
+			Tables.New.GetFence( &NewFence );
+			Tables.Old.GetFence( &OldFence );
+
+			NewFences.push_back( NewFence );
+			OldFences.push_back( OldFence );
+		}
+		else if ((Choice < 48) && (!NewFences.empty( )))
+		{
+			//
+			// Occasionally pop several nested scopes at once, as a return
+			// out of nested blocks does.
+			//
+
+			size_t Pops = (NextRandom( State.Seed ) % 4 == 0)
+				? 1 + NextRandom( State.Seed ) % NewFences.size( )
+				: 1;
+
+			while (Pops-- > 0)
+			{
+				Tables.New.RestoreFence( &NewFences.back( ) );
+				Tables.Old.RestoreFence( &OldFences.back( ) );
+
+				NewFences.pop_back( );
+				OldFences.pop_back( );
+			}
+
+			LookupRandomNames( Tables, Names, BaseNames, 16, State );
+		}
+		else
+		{
+			LookupRandomNames( Tables, Names, BaseNames, 1, State );
+		}
+	}
+
+	while (!NewFences.empty( ))
+	{
+		Tables.New.RestoreFence( &NewFences.back( ) );
+		Tables.Old.RestoreFence( &OldFences.back( ) );
+
+		NewFences.pop_back( );
+		OldFences.pop_back( );
+
+		LookupRandomNames( Tables, Names, BaseNames, 16, State );
+	}
+}
+
+void
+RunDirectedCheck(
+	__inout CheckState & State
+	)
+/*++
+
+Routine Description:
+
+	This routine checks scope restores in cases that the random sequence may
+	hit only rarely: the hash index growing several times while fences are
+	held, restores of deeply nested fences in one step, and typed lookups of
+	shadowed names after a restore.
+
+Arguments:
+
+	State - Supplies the check state.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	TablePair         Base;
+	TablePair         Tables;
+	StringVec         Names;
+	StringVec         BaseNames;
+	NscSymbolFence    NewFences[ 3 ];
+	NscOldSymbolFence OldFences[ 3 ];
+
+	BuildNames( BaseNames, "EngineFunc", 200 );
+	BuildNames( Names, "nLocal", 2000 );
+
+	for (size_t i = 0; i < BaseNames.size( ); i += 1)
+		AddSymbol( Base, BaseNames[ i ].c_str( ), NscSymType_Function );
+
+	Tables.New.SetBase( &Base.New );
+	Tables.Old.SetBase( &Base.Old );
+
+	//
+	// Globals, some of which shadow engine functions with another type.
+	//
+
+	for (size_t i = 0; i < 40; i += 1)
+	{
+		AddSymbol( Tables, Names[ i ].c_str( ), NscSymType_Variable );
+		AddSymbol( Tables, BaseNames[ i ].c_str( ), NscSymType_Variable );
+	}
+
+	ZeroMemory( NewFences, sizeof( NewFences ) );
+	ZeroMemory( OldFences, sizeof( OldFences ) );
+
+	//
+	// Hold three nested fences while enough names are added to grow the
+	// index from its initial size several times over.  Each scope shadows
+	// names of the enclosing scopes with a different symbol type.
+	//
+
+	for (size_t Depth = 0; Depth < 3; Depth += 1)
+	{
+		Tables.New.GetFence( &NewFences[ Depth ] );
+		Tables.Old.GetFence( &OldFences[ Depth ] );
+
+		for (size_t i = 0; i < 600; i += 1)
+		{
+			AddSymbol(
+				Tables,
+				Names[ (Depth * 500 + i) % Names.size( ) ].c_str( ),
+				(Depth & 1) ? NscSymType_Structure : NscSymType_Variable);
+		}
+
+		AddSymbol( Tables, BaseNames[ Depth ].c_str( ), NscSymType_Token );
+
+		for (size_t i = 0; i < Names.size( ); i += 7)
+		{
+			CompareLookup( Tables, Names[ i ].c_str( ), (UINT32) -1, State );
+			CompareLookup( Tables, Names[ i ].c_str( ), 1 << NscSymType_Variable, State );
+		}
+	}
+
+	//
+	// Restore the two innermost scopes in one step, then the outermost.
+	//
+
+	for (int Restore = 1; Restore >= 0; Restore -= 1)
+	{
+		Tables.New.RestoreFence( &NewFences[ Restore ] );
+		Tables.Old.RestoreFence( &OldFences[ Restore ] );
+
+		for (size_t i = 0; i < Names.size( ); i += 3)
+		{
+			CompareLookup( Tables, Names[ i ].c_str( ), (UINT32) -1, State );
+			CompareLookup( Tables, Names[ i ].c_str( ), 1 << NscSymType_Variable, State );
+			CompareLookup( Tables, Names[ i ].c_str( ), 1 << NscSymType_Structure, State );
+		}
+
+		for (size_t i = 0; i < BaseNames.size( ); i += 1)
+		{
+			CompareLookup( Tables, BaseNames[ i ].c_str( ), (UINT32) -1, State );
+			CompareLookup( Tables, BaseNames[ i ].c_str( ), 1 << NscSymType_Function, State );
+			CompareLookup( Tables, BaseNames[ i ].c_str( ), 1 << NscSymType_Token, State );
+		}
+	}
+
+	//
+	// Every name added under the fences must be gone again: the scoped
+	// names resolve to the globals or to nothing, and the engine names
+	// resolve to the globals or the base table.
+	//
+
+	for (size_t i = 0; i < Names.size( ); i += 1)
+	{
+		NscSymbol * Symbol = Tables.New.Find( Names[ i ].c_str( ) );
+
+		if (((i < 40) && ((Symbol == NULL) || (Symbol->nSymType != NscSymType_Variable))) ||
+		    ((i >= 40) && (Symbol != NULL)))
+		{
+			if (State.Mismatches < 16)
+				printf( "MISMATCH: '%s' survived a fence restore.\n", Names[ i ].c_str( ) );
+
+			State.Mismatches += 1;
+		}
+	}
+}
+
+bool
+CheckEquivalence(
+	)
+/*++
+
+Routine Description:
+
+	This routine runs the directed and random checks of the symbol table.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	CheckState State;
+
+	State.Seed       = 1;
+	State.Lookups    = 0;
+	State.Mismatches = 0;
+
+	RunDirectedCheck( State );
+	RunRandomCheck( false, false, State );
+	RunRandomCheck( true, false, State );
+	RunRandomCheck( true, true, State );
+
+	printf(
+		"Equivalence check: %lu lookups, %lu mismatch(es).\n",
+		State.Lookups,
+		State.Mismatches);
+
+	return (State.Mismatches == 0);
+}
+
+template< class Table, class Fence >
+double
+RunWorkload(
+	__in const StringVec & EngineNames,
+	__in const StringVec & GlobalNames,
+	__in const StringVec & LocalNames,
+	__in unsigned long Iterations,
+	__out ULONGLONG & Checksum
+	)
+/*++
+
+Routine Description:
+
+	This routine runs the benchmark workload against one symbol table
+	implementation.  The workload resembles the compile of a large script:
+	a base table of engine symbols, a number of globals, and many functions
+	whose nested scopes each declare locals and then look up a mix of local,
+	global and engine identifiers.
+
+Arguments:
+
+	EngineNames - Supplies the names of the engine symbols.
+
+	GlobalNames - Supplies the names of the globals.
+
+	LocalNames - Supplies the names of the locals of every scope.
+
+	Iterations - Supplies the count of times the workload is run.
+
+	Checksum - Receives a checksum of the offsets of the symbols found.
+
+Return Value:
+
+	The routine returns the time taken, in milliseconds.  Building the base
+	table is not timed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Table         Base;
+	Table         Compile;
+	Fence         Fences[ BENCH_SCOPE_DEPTH ];
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	unsigned long Seed;
+
+	for (size_t i = 0; i < EngineNames.size( ); i += 1)
+		Base.Add( EngineNames[ i ].c_str( ), NscSymType_Function );
+
+	ZeroMemory( Fences, sizeof( Fences ) );
+
+	Checksum = 0;
+	Seed     = 1;
+
+	QueryPerformanceFrequency( &Frequency );
+	QueryPerformanceCounter( &Start );
+
+	for (unsigned long Iteration = 0; Iteration < Iterations; Iteration += 1)
+	{
+		Compile.SetBase( &Base );
+
+		for (size_t i = 0; i < GlobalNames.size( ); i += 1)
+			Compile.Add( GlobalNames[ i ].c_str( ), NscSymType_Variable );
+
+		for (size_t Function = 0; Function < BENCH_FUNCTIONS; Function += 1)
+		{
+			for (size_t Depth = 0; Depth < BENCH_SCOPE_DEPTH; Depth += 1)
+			{
+				Compile.GetFence( &Fences[ Depth ] );
+
+				for (size_t i = 0; i < BENCH_SCOPE_LOCALS; i += 1)
+				{
+					Compile.Add(
+						LocalNames[ Depth * BENCH_SCOPE_LOCALS + i ].c_str( ),
+						NscSymType_Variable);
+				}
+
+				for (size_t i = 0; i < BENCH_SCOPE_LOOKUPS; i += 1)
+				{
+					const std::string * Name;
+					NscSymbol         * Symbol;
+					unsigned long       Choice;
+
+					Choice = NextRandom( Seed );
+
+					switch (Choice % 3)
+					{
+
+					case 0:
+						Name = &LocalNames[ (Choice >> 2) % ((Depth + 1) * BENCH_SCOPE_LOCALS) ];
+						break;
+
+					case 1:
+						Name = &GlobalNames[ (Choice >> 2) % GlobalNames.size( ) ];
+						break;
+
+					default:
+						Name = &EngineNames[ (Choice >> 2) % EngineNames.size( ) ];
+						break;
+
+					}
+
+					Symbol = Compile.Find( Name->c_str( ), Name->size( ) );
+
+					if (Symbol != NULL)
+						Checksum += Compile.GetSymbolOffset( Symbol );
+				}
+			}
+
+			for (size_t Depth = BENCH_SCOPE_DEPTH; Depth != 0; Depth -= 1)
+				Compile.RestoreFence( &Fences[ Depth - 1 ] );
+		}
+	}
+
+	QueryPerformanceCounter( &End );
+
+	return (double) (End.QuadPart - Start.QuadPart) * 1000.0 / (double) Frequency.QuadPart;
+}
+
+bool
+RunBenchmark(
+	__in unsigned long Iterations
+	)
+/*++
+
+Routine Description:
+
+	This routine measures the previous and current symbol tables on the
+	identifier-heavy benchmark workload, and checks that both found the same
+	symbols.
+
+Arguments:
+
+	Iterations - Supplies the count of times the workload is run.
+
+Return Value:
+
+	The routine returns true if both tables found the same symbols, else
+	false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	StringVec EngineNames;
+	StringVec GlobalNames;
+	StringVec LocalNames;
+	ULONGLONG OldChecksum;
+	ULONGLONG NewChecksum;
+	double    OldTime;
+	double    NewTime;
+
+	BuildNames( EngineNames, "EngineFunction", BENCH_ENGINE_SYMBOLS );
+	BuildNames( GlobalNames, "g_GlobalVariable", BENCH_GLOBAL_SYMBOLS );
+	BuildNames( LocalNames, "nLocalVariable", BENCH_SCOPE_DEPTH * BENCH_SCOPE_LOCALS );
+
+	printf(
+		"Benchmark: %lu engine symbols, %lu globals, %lu functions with %lu nested scopes\n"
+		"of %lu locals and %lu lookups each, %lu iteration(s).\n",
+		(unsigned long) BENCH_ENGINE_SYMBOLS,
+		(unsigned long) BENCH_GLOBAL_SYMBOLS,
+		(unsigned long) BENCH_FUNCTIONS,
+		(unsigned long) BENCH_SCOPE_DEPTH,
+		(unsigned long) BENCH_SCOPE_LOCALS,
+		(unsigned long) BENCH_SCOPE_LOOKUPS,
+		Iterations);
+
+	OldTime = RunWorkload< CNscOldSymbolTable, NscOldSymbolFence >(
+		EngineNames,
+		GlobalNames,
+		LocalNames,
+		Iterations,
+		OldChecksum);
+	NewTime = RunWorkload< CNscSymbolTable, NscSymbolFence >(
+		EngineNames,
+		GlobalNames,
+		LocalNames,
+		Iterations,
+		NewChecksum);
+
+	printf(
+		"  Previous table: %10.1f ms\n"
+		"  Current table:  %10.1f ms  (%.2fx)\n",
+		OldTime,
+		NewTime,
+		(NewTime > 0.0) ? OldTime / NewTime : 0.0);
+
+	if (OldChecksum != NewChecksum)
+	{
+		printf( "MISMATCH: The tables found different symbols during the benchmark.\n" );
+		return false;
+	}
+
+	return true;
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"NscSymbolTableTest\n"
+		"\n"
+		"This program checks that the compiler symbol table finds the same symbols\n"
+		"as the previous bucket based symbol table across adds, nested scope fences\n"
+		"and restores, and optionally measures the speed of both.\n"
+		"\n"
+		"Usage: NscSymbolTableTest [-bench] [-iterations <benchmark iterations>]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the symbol table test program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	bool          Benchmark;
+	unsigned long Iterations;
+	bool          Passed;
+
+	Benchmark  = false;
+	Iterations = 20;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if (!_stricmp( argv[ i ], "-bench" ))
+			Benchmark = true;
+		else if ((!_stricmp( argv[ i ], "-iterations" )) && (i + 1 < argc))
+			Iterations = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	try
+	{
+		Passed = CheckEquivalence( );
+
+		if ((Passed) && (Benchmark))
+			Passed = RunBenchmark( Iterations );
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	return Passed ? 0 : 1;
+}
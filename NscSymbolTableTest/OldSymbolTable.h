@@ -0,0 +1,489 @@
+#ifndef _PROGRAMS_NSCSYMBOLTABLETEST_OLDSYMBOLTABLE_H
+#define _PROGRAMS_NSCSYMBOLTABLETEST_OLDSYMBOLTABLE_H
+
+//-----------------------------------------------------------------------------
+// 
+// @doc
+//
+// @module	OldSymbolTable.h - Reference copy of the previous symbol table |
+//
+// This module contains a copy of the symbol table as it was before the
+// hash index and undo log rework.  It is used only by NscSymbolTableTest
+// as the reference for the current CNscSymbolTable.  The class is renamed
+// to CNscOldSymbolTable and uses its own fence structure, which holds the
+// table's 64 bucket heads as the original NscSymbolFence did.
+//
+// A symbol table may be chained onto a read-only base table (typically the
+// parsed nwscript.nss table shared by all compiles).  Offsets below the size
+// of the base table resolve into the base table's data and offsets above it
+// resolve into the local data.  The local hash chains continue into the base
+// table's hash chains, so a lookup falls through to the base table without
+// the base table ever being copied.
+//
+// Copyright (c) 2002-2003 - Edward T. Smith
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without 
+// modification, are permitted provided that the following conditions are 
+// met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, 
+//    this list of conditions and the following disclaimer. 
+// 2. Neither the name of Edward T. Smith nor the names of its contributors 
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// @end
+//
+// $History: OldSymbolTable.h $
+//      
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Required include files
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Forward definitions
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+//
+// Symbol table fence (the symbol table part of the original NscSymbolFence)
+//
+//-----------------------------------------------------------------------------
+
+struct NscOldSymbolFence
+{
+	size_t			nSize;
+	size_t			anHashStart [NscMaxHash];
+};
+
+//-----------------------------------------------------------------------------
+//
+// Class definition
+//
+//-----------------------------------------------------------------------------
+
+class CNscOldSymbolTable
+{
+// @access Constructors and destructors
+public:
+
+	// @cmember General constructor
+
+	CNscOldSymbolTable (size_t nGrowSize = 0x40000)
+	{
+		m_pauchData = NULL;
+		m_pBase = NULL;
+		m_nBaseSize = 0;
+		m_nSize = 0;
+		m_nAllocated = 0;
+		m_nGrowSize = nGrowSize;
+		m_nGlobalIdentifierCount = 0;
+		memset (&m_sFence, 0, sizeof (m_sFence));
+	}
+
+	// @cmember Delete the streams
+	
+	~CNscOldSymbolTable ()
+	{
+		if (m_pauchData)
+			delete [] m_pauchData;
+	}
+
+// @access Public methods
+public:
+
+	// @cmember Get the offset of a symbol
+
+	size_t GetSymbolOffset (NscSymbol *pSymbol)
+	{
+		if (IsShared (pSymbol))
+			return (size_t) ((unsigned char *) pSymbol - m_pBase ->m_pauchData);
+		return m_nBaseSize + (size_t) ((unsigned char *) pSymbol - m_pauchData);
+	}
+
+	// @cmember Get a symbol from an offset
+
+	NscSymbol *GetSymbol (size_t nOffset)
+	{
+		return (NscSymbol *) GetData (nOffset);
+	}
+
+	// @cmember Save the symbol table to another table
+	
+	void CopyFrom (CNscOldSymbolTable *pTable)
+	{
+		size_t nLocalSize = pTable ->m_nSize - pTable ->m_nBaseSize;
+		m_pBase = pTable ->m_pBase;
+		m_nBaseSize = pTable ->m_nBaseSize;
+		m_nSize = m_nBaseSize;
+		MakeRoom (nLocalSize);
+		if (nLocalSize > 0)
+			memcpy (m_pauchData, pTable ->m_pauchData, nLocalSize);
+		memcpy (&m_sFence, &pTable ->m_sFence, sizeof (m_sFence));
+		m_nSize = pTable ->m_nSize;
+		m_nGlobalIdentifierCount = pTable ->m_nGlobalIdentifierCount;
+		m_mapSharedFlags = pTable ->m_mapSharedFlags;
+	}
+
+	// @cmember Chain the symbol table onto a read-only base table
+
+	void SetBase (CNscOldSymbolTable *pBase)
+	{
+		assert (pBase ->m_pBase == NULL);
+		m_pBase = pBase;
+		m_nBaseSize = pBase ->m_nSize;
+		m_nSize = m_nBaseSize;
+		memcpy (&m_sFence, &pBase ->m_sFence, sizeof (m_sFence));
+		m_nGlobalIdentifierCount = pBase ->m_nGlobalIdentifierCount;
+		m_mapSharedFlags .clear ();
+	}
+
+	// @cmember Get the base table
+
+	CNscOldSymbolTable *GetBase ()
+	{
+		return m_pBase;
+	}
+
+	// @cmember Return true if the symbol lives in the base table
+
+	bool IsShared (NscSymbol *pSymbol)
+	{
+		unsigned char *puch = (unsigned char *) pSymbol;
+		return m_pBase != NULL && puch >= m_pBase ->m_pauchData &&
+			puch < m_pBase ->m_pauchData + m_nBaseSize;
+	}
+
+	// @cmember Set flags on a symbol (recorded locally for base symbols)
+
+	void SetSymbolFlags (NscSymbol *pSymbol, UINT32 ulFlags)
+	{
+		if (!IsShared (pSymbol))
+			pSymbol ->ulFlags |= ulFlags;
+		else if ((pSymbol ->ulFlags & ulFlags) != ulFlags)
+			m_mapSharedFlags [GetSymbolOffset (pSymbol)] |= ulFlags;
+	}
+
+	// @cmember Copy the base table into the local data so it may be modified
+
+	void Detach ()
+	{
+		if (m_pBase == NULL)
+			return;
+
+		//
+		// Offsets and fences do not change, only the storage does
+		//
+
+		size_t nLocalSize = m_nSize - m_nBaseSize;
+		size_t nAllocated = m_nBaseSize + m_nAllocated;
+		if (nAllocated < m_nSize)
+			nAllocated = m_nSize;
+		unsigned char *pauchNew = new unsigned char [nAllocated];
+		memcpy (pauchNew, m_pBase ->m_pauchData, m_nBaseSize);
+		if (nLocalSize > 0)
+			memcpy (&pauchNew [m_nBaseSize], m_pauchData, nLocalSize);
+		if (m_pauchData)
+			delete [] m_pauchData;
+		m_pauchData = pauchNew;
+		m_nAllocated = nAllocated;
+		m_pBase = NULL;
+		m_nBaseSize = 0;
+
+		//
+		// Apply the flags that were set on base symbols
+		//
+
+		for (std::map <size_t, UINT32>::iterator it = m_mapSharedFlags .begin ();
+			it != m_mapSharedFlags .end (); ++it)
+		{
+			GetSymbol (it ->first) ->ulFlags |= it ->second;
+		}
+		m_mapSharedFlags .clear ();
+	}
+
+	// @cmember Reset the symbol table
+
+	void Reset ()
+	{
+		m_pBase = NULL;
+		m_nBaseSize = 0;
+		if (m_nSize > 0)
+            m_nSize = 1;
+		memset (&m_sFence, 0, sizeof (m_sFence));
+		m_nGlobalIdentifierCount = 0;
+		m_mapSharedFlags .clear ();
+	}
+
+	// @cmember Get a pointer to symbol table data
+
+	unsigned char *GetData (size_t nOffset = 0)
+	{
+		if (nOffset < m_nBaseSize)
+			return &m_pBase ->m_pauchData [nOffset];
+		return &m_pauchData [nOffset - m_nBaseSize];
+	}
+
+	// @cmember Get the current fence
+
+	void GetFence (NscOldSymbolFence *pFence)
+	{
+		memcpy (pFence, &m_sFence, sizeof (m_sFence));
+		pFence ->nSize = m_nSize;
+	}
+
+	// @cmember Restore the given fence
+
+	void RestoreFence (NscOldSymbolFence *pFence)
+	{
+		memcpy (&m_sFence, pFence, sizeof (m_sFence));
+		m_nSize = pFence ->nSize;
+	}
+
+	// @cmember Find a symbol
+
+	NscSymbol *Find (const char *psz, size_t nLength, UINT32 ulHash, UINT32 ulSymTypeMask = (UINT32) -1)
+	{
+
+		//
+		// Search for a match
+		//
+
+		UINT32 ulHashIndex = ulHash % NscMaxHash;
+		size_t nIndex = m_sFence .anHashStart [ulHashIndex];
+		while (nIndex != 0)
+		{
+			NscSymbol *pSymbol = GetSymbol (nIndex);
+			if (pSymbol ->ulHash == ulHash &&
+				pSymbol ->nLength == nLength &&
+				((1 << pSymbol ->nSymType) & ulSymTypeMask) != 0 &&
+				memcmp (psz, pSymbol ->szString, 
+				nLength * sizeof (char)) == 0)
+			{
+					return pSymbol;
+			}
+			nIndex = pSymbol ->nNext;
+		}
+		return NULL;
+	}
+
+	// @cmember Find a symbol
+
+	NscSymbol *Find (const char *psz, size_t nLength)
+	{
+		return Find (psz, nLength, GetHash (psz, nLength));
+	}
+
+	// @cmember Find a symbol
+
+	NscSymbol *Find (const char *psz)
+	{
+		size_t nLength = strlen (psz);
+		return Find (psz, nLength, GetHash (psz, nLength));
+	}
+
+	// @cmember Find a symbol
+
+	NscSymbol *FindByType (const char *psz, UINT32 ulSymTypeMask)
+	{
+		size_t nLength = strlen (psz);
+		return Find (psz, nLength, GetHash (psz, nLength), ulSymTypeMask);
+	}
+	// @cmember Add a new symbol
+
+	NscSymbol *Add (const char *psz, NscSymType nSymType)
+	{
+
+		//
+		// Get the hash code and index
+		//
+
+		size_t nLength = strlen (psz);
+		UINT32 ulHash = GetHash (psz, nLength);
+		UINT32 ulHashIndex = ulHash % NscMaxHash;
+
+		//
+		// If no match was found, we will have to create a new one
+		//
+
+		size_t nSize = sizeof (NscSymbol) + ((nLength) * sizeof (char));
+		MakeRoom (nSize);
+		NscSymbol *pSymbol = GetSymbol (m_nSize);
+		pSymbol ->nNext = m_sFence .anHashStart [ulHashIndex];
+		pSymbol ->ulHash = ulHash;
+		pSymbol ->nSymType = nSymType;
+		pSymbol ->nLength = nLength;
+		memcpy (pSymbol ->szString, psz, nLength);
+		pSymbol ->szString [nLength] = 0;
+		m_sFence .anHashStart [ulHashIndex] = m_nSize;
+
+		m_nSize += nSize;
+		return pSymbol;
+	}
+
+	// @cmember Add a new symbol
+
+	NscSymbol *AddNoHash (const char *psz, NscSymType nSymType)
+	{
+
+		//
+		// Blindly add a symbol without updating the hash
+		//
+
+		size_t nLength = strlen (psz);
+		size_t nSize = sizeof (NscSymbol) + ((nLength) * sizeof (char));
+		MakeRoom (nSize);
+		NscSymbol *pSymbol = GetSymbol (m_nSize);
+		pSymbol ->nNext = 0;
+		pSymbol ->ulHash = 0;
+		pSymbol ->nSymType = nSymType;
+		pSymbol ->nLength = nLength;
+		memcpy (pSymbol ->szString, psz, nLength);
+		pSymbol ->szString [nLength] = 0;
+		m_nSize += nSize;
+		return pSymbol;
+	}
+
+	static UINT32 GetHash (const char *psz, size_t nLength)
+	{
+		UINT32 hash = 0;
+		while (nLength-- > 0)
+		{
+			int c = *psz++;
+			hash = c + (hash << 6) + (hash << 16) - hash;
+		}
+		return hash;
+	}
+
+	// @cmember Get the hash value
+
+	static UINT32 GetHash (const char *psz)
+	{
+		UINT32 hash = 0;
+		int c;
+		while ((c = *psz++) != 0)
+			hash = c + (hash << 6) + (hash << 16) - hash;
+		return hash;
+	}
+
+	// @cmember Append raw data
+
+	size_t AppendData (void *pData, size_t nSize)
+	{
+		size_t nPos = m_nSize;
+		MakeRoom (nSize);
+		memcpy (GetData (m_nSize), pData, nSize);
+		m_nSize += nSize;
+		return nPos;
+	}
+
+	// @cmember Get the fence
+
+	NscOldSymbolFence &GetFence ()
+	{
+		return m_sFence;
+	}
+
+	// @cmember Get the number of global identifier symbols (arbitrary)
+
+	size_t GetGlobalIdentifierCount ()
+	{
+		return m_nGlobalIdentifierCount;
+	}
+
+	// @cmember Set the number of global identifier symbols (arbitrary)
+	void SetGlobalIdentifierCount (size_t nGlobalIdentifierCount)
+	{
+		m_nGlobalIdentifierCount = nGlobalIdentifierCount;
+	}
+
+// @access Public inline methods
+public:
+
+// @access Protected methods
+protected:
+
+	// @cmember Insure there is room
+
+	void MakeRoom (size_t nSize)
+	{
+		size_t nLocalSize = m_nSize - m_nBaseSize;
+		if (nLocalSize + nSize > m_nAllocated)
+		{
+			do 
+			{
+				m_nAllocated += m_nGrowSize;
+			} while (nLocalSize + nSize > m_nAllocated);
+			unsigned char *pauchNew = new unsigned char [m_nAllocated];
+			if (m_nSize == 0)
+				m_nSize = 1;
+			else if (m_pauchData)
+			{
+				memmove (pauchNew, m_pauchData, nLocalSize);
+				delete [] m_pauchData;
+			}
+			m_pauchData = pauchNew;
+		}
+	}
+
+// @cmember Protected members
+protected:
+
+	// @cmember Pointer to the symbol table data
+
+	unsigned char	*m_pauchData;
+
+	// @cmember Read-only table this table is chained onto (or NULL)
+
+	CNscOldSymbolTable	*m_pBase;
+
+	// @cmember Size of the base table (first local offset)
+
+	size_t			m_nBaseSize;
+
+	// @cmember Size of the symbol table
+
+	size_t			m_nSize;
+
+	// @cmember Allocated size of the symbol table
+
+	size_t			m_nAllocated;
+
+	// @cmember Grow amount
+
+	size_t			m_nGrowSize;
+
+	// @cmember Number of global identifiers represented by the symbol table
+
+	size_t			m_nGlobalIdentifierCount;
+
+	// @cmember Current fence
+
+	NscOldSymbolFence	m_sFence;
+
+	// @cmember Flags set on base table symbols by this table
+
+	std::map <size_t, UINT32> m_mapSharedFlags;
+};
+
+#endif // _PROGRAMS_NSCSYMBOLTABLETEST_OLDSYMBOLTABLE_H
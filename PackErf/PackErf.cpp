@@ -0,0 +1,311 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	PackErf.cpp
+
+Abstract:
+
+	This module houses a program that packs resource directories and existing
+	ERF files (such as HAKs) into a new ERF file.
+
+	By default, resources whose contents are byte-identical to an earlier
+	resource are stored only once, with the resource list entries of every
+	copy referring to the same contents.  Resource contents are hashed in
+	parallel to find such duplicates.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ErfFileReader.h"
+#include "../NWN2DataLib/ErfFileWriter.h"
+#include "../NWN2DataLib/DirectoryFileReader.h"
+
+void
+AddInput(
+	__inout ErfFileWriter32 & Writer,
+	__in const char * InputName,
+	__in bool CheckForDuplicates
+	)
+/*++
+
+Routine Description:
+
+	This routine stages the resources of an input directory or ERF file for
+	packing.
+
+Arguments:
+
+	Writer - Supplies the ERF writer that receives the resources.
+
+	InputName - Supplies the path to the input directory or ERF file.
+
+	CheckForDuplicates - Supplies a Boolean value that indicates whether
+	                     resources that are already staged are replaced by
+	                     resources of the same name and type in this input.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	DWORD Attributes;
+
+	Attributes = GetFileAttributesA( InputName );
+
+	if (Attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		std::string Msg;
+
+		Msg  = "Input \"";
+		Msg += InputName;
+		Msg += "\" does not exist.";
+
+		throw std::runtime_error( Msg );
+	}
+
+	if (Attributes & FILE_ATTRIBUTE_DIRECTORY)
+	{
+		DirectoryFileReader32 Directory( InputName );
+
+		printf(
+			"Adding %lu resources from directory %s...\n",
+			(unsigned long) Directory.GetEncapsulatedFileCount( ),
+			InputName);
+
+		Writer.InitializeFromResourceAccessor( &Directory, CheckForDuplicates );
+	}
+	else
+	{
+		ErfFileReader32 Erf( InputName );
+
+		printf(
+			"Adding %lu resources from ERF %s...\n",
+			(unsigned long) Erf.GetEncapsulatedFileCount( ),
+			InputName);
+
+		Writer.InitializeFromResourceAccessor( &Erf, CheckForDuplicates );
+	}
+}
+
+unsigned long
+GetFileTypeFromName(
+	__in const char * FileName
+	)
+/*++
+
+Routine Description:
+
+	This routine selects the ERF file type tag for an output file based on the
+	extension of its name.
+
+Arguments:
+
+	FileName - Supplies the name of the output file.
+
+Return Value:
+
+	The routine returns the ERF file type tag of the output file.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char * Ext;
+
+	Ext = strrchr( FileName, '.' );
+
+	if (Ext == NULL)
+		return ErfFileWriter32::ERF_FILE_TYPE;
+	else if (!_stricmp( Ext, ".hak" ))
+		return ErfFileWriter32::HAK_FILE_TYPE;
+	else if (!_stricmp( Ext, ".mod" ))
+		return ErfFileWriter32::MOD_FILE_TYPE;
+	else if (!_stricmp( Ext, ".nwm" ))
+		return ErfFileWriter32::NWM_FILE_TYPE;
+	else
+		return ErfFileWriter32::ERF_FILE_TYPE;
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"PackErf\n"
+		"\n"
+		"This program packs resource directories and ERF files (such as HAKs) into\n"
+		"a new ERF file.  Resources with byte-identical contents are stored only\n"
+		"once.  When an input supplies a resource that an earlier input already\n"
+		"supplied, the later input's resource is used.\n"
+		"\n"
+		"Usage: PackErf -out <output file> [-nodedup] [-threads <hash thread count>]\n"
+		"               <input directory or ERF file...>\n"
+		"\n"
+		"The type of the output file (ERF, HAK, MOD or NWM) is taken from its\n"
+		"extension.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the ERF packing program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char                  * OutputFile;
+	std::vector< const char * >   Inputs;
+	unsigned long                 MaxThreads;
+	bool                          Deduplicate;
+	ErfFileWriter32::CommitStats  Stats;
+
+	OutputFile  = NULL;
+	MaxThreads  = 0;
+	Deduplicate = true;
+
+	ZeroMemory( &Stats, sizeof( Stats ) );
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-out" )) && (i + 1 < argc))
+			OutputFile = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else if (!_stricmp( argv[ i ], "-nodedup" ))
+			Deduplicate = false;
+		else if (argv[ i ][ 0 ] == '-')
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+		else
+			Inputs.push_back( argv[ i ] );
+	}
+
+	if (argc < 2)
+	{
+		PrintUsage( );
+		return -1;
+	}
+
+	if (OutputFile == NULL)
+	{
+		printf( "\nYou must specify the ERF file to write with -out <output file>.\n" );
+		return -1;
+	}
+
+	if (Inputs.empty( ))
+	{
+		printf( "\nYou must specify at least one input directory or ERF file.\n" );
+		return -1;
+	}
+
+	try
+	{
+		ErfFileWriter32 Writer;
+
+		Writer.SetDefaultFileType( GetFileTypeFromName( OutputFile ) );
+		Writer.SetMaxThreads( MaxThreads );
+
+		for (size_t i = 0; i < Inputs.size( ); i += 1)
+			AddInput( Writer, Inputs[ i ], (i != 0) );
+
+		printf( "Writing %s...\n", OutputFile );
+
+		if (!Writer.Commit(
+			OutputFile,
+			0,
+			Deduplicate ? ErfFileWriter32::ERF_COMMIT_FLAG_DEDUPLICATE : 0))
+		{
+			printf( "ERROR: Failed to write %s.\n", OutputFile );
+			return -1;
+		}
+
+		Stats = Writer.GetCommitStats( );
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	//
+	// Report the space that deduplication saved.
+	//
+
+	printf(
+		"Packed %lu resources (%I64u bytes) into %s.\n",
+		(unsigned long) Stats.ResourceCount,
+		Stats.ResourceBytes,
+		OutputFile);
+
+	if (Deduplicate)
+	{
+		printf(
+			"Stored %lu unique resources (%I64u bytes); deduplication saved %I64u bytes (%.1f%%).\n",
+			(unsigned long) Stats.StoredResourceCount,
+			Stats.StoredBytes,
+			Stats.ResourceBytes - Stats.StoredBytes,
+			(Stats.ResourceBytes != 0)
+				? (double) (Stats.ResourceBytes - Stats.StoredBytes) * 100.0 / (double) Stats.ResourceBytes
+				: 0.0);
+	}
+
+	return 0;
+}
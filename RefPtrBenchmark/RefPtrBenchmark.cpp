@@ -0,0 +1,850 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	RefPtrBenchmark.cpp
+
+Abstract:
+
+	This module houses a program that measures the cost of swutil::SharedPtr
+	against swutil::IntrusivePtr, for both the interlocked and the single
+	threaded intrusive reference counts.
+
+	Two operations are measured, with objects allocated from both the Win32
+	process heap (as DECLARE_SWUTIL_CROSS_MODULE_NEW objects such as engine
+	structures are) and the CRT heap:
+
+	- Creating and destroying an object through a pointer.  SharedPtr makes a
+	  second process heap allocation for its shared state.
+
+	- Copying a pointer into a stack of slots and releasing the copies, which
+	  models the engine structure and saved state copies made by the script
+	  VM.
+
+	Before measuring, the program checks the reference counting semantics of
+	IntrusivePtr that the script VM relies upon.
+
+--*/
+
+#include "Precomp.h"
+
+using swutil::SharedPtr;
+using swutil::IntrusivePtr;
+using swutil::IntrusiveRefCounted;
+using swutil::LocalIntrusiveRefCounted;
+
+//
+// Define the number of times that each measurement is repeated.  The fastest
+// pass is reported, which discards passes disturbed by other activity.
+//
+
+#define MEASUREMENT_PASSES 5
+
+//
+// Track the number of live test objects, so that the checks can tell exactly
+// when an object has been deleted.
+//
+
+LONG LiveObjects;
+
+//
+// Define the reference count base used for objects managed by SharedPtr,
+// which keeps its reference count outside of the object.
+//
+
+class UncountedBase
+{
+};
+
+//
+// Define a test object that is allocated from the process heap, in the same
+// fashion as an engine structure.
+//
+
+template< class RefBase >
+class ProcessHeapObject : public RefBase
+{
+
+public:
+
+	inline
+	ProcessHeapObject(
+		__in ULONG InitialValue
+		)
+	: Value( InitialValue )
+	{
+		LiveObjects += 1;
+	}
+
+	inline
+	ProcessHeapObject(
+		__in const ProcessHeapObject & Other
+		)
+	: RefBase( Other ),
+	  Value( Other.Value )
+	{
+		LiveObjects += 1;
+	}
+
+	inline
+	~ProcessHeapObject(
+		)
+	{
+		LiveObjects -= 1;
+	}
+
+	DECLARE_SWUTIL_CROSS_MODULE_NEW( );
+
+	ULONG Value;
+
+};
+
+//
+// Define a test object that is allocated from the CRT heap.
+//
+
+template< class RefBase >
+class CrtHeapObject : public RefBase
+{
+
+public:
+
+	inline
+	CrtHeapObject(
+		__in ULONG InitialValue
+		)
+	: Value( InitialValue )
+	{
+		LiveObjects += 1;
+	}
+
+	inline
+	CrtHeapObject(
+		__in const CrtHeapObject & Other
+		)
+	: RefBase( Other ),
+	  Value( Other.Value )
+	{
+		LiveObjects += 1;
+	}
+
+	inline
+	~CrtHeapObject(
+		)
+	{
+		LiveObjects -= 1;
+	}
+
+	ULONG Value;
+
+};
+
+typedef ProcessHeapObject< IntrusiveRefCounted > IntrusiveProcessObject;
+typedef ProcessHeapObject< LocalIntrusiveRefCounted > LocalProcessObject;
+typedef CrtHeapObject< IntrusiveRefCounted > IntrusiveCrtObject;
+typedef CrtHeapObject< LocalIntrusiveRefCounted > LocalCrtObject;
+
+//
+// Define a list node whose only reference may be held by the previous node,
+// for checking assignment of a pointer from within the object it replaces.
+//
+
+template< class RefBase >
+class ChainNode : public RefBase
+{
+
+public:
+
+	typedef IntrusivePtr< ChainNode > Ptr;
+
+	inline
+	ChainNode(
+		)
+	{
+		LiveObjects += 1;
+	}
+
+	inline
+	~ChainNode(
+		)
+	{
+		LiveObjects -= 1;
+	}
+
+	Ptr Next;
+
+};
+
+//
+// Define the results of measuring one pointer type.
+//
+
+struct MEASUREMENT
+{
+	const char * Name;
+	double       CreateNs;
+	double       CopyNs;
+};
+
+bool
+Expect(
+	__in bool Condition,
+	__in const char * TypeName,
+	__in const char * Description,
+	__inout unsigned long & Failures
+	)
+/*++
+
+Routine Description:
+
+	This routine records the outcome of a single semantic check, and reports
+	the first few failures.
+
+Arguments:
+
+	Condition - Supplies the outcome of the check.
+
+	TypeName - Supplies the name of the type under test.
+
+	Description - Supplies a description of the condition checked.
+
+	Failures - Supplies the failure counter, which is incremented if the
+	           check failed.
+
+Return Value:
+
+	The routine returns the outcome of the check.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (!Condition)
+	{
+		if (Failures < 16)
+			printf( "MISMATCH: %s: %s.\n", TypeName, Description );
+
+		Failures += 1;
+	}
+
+	return Condition;
+}
+
+template< class Object, class RefBase >
+void
+CheckSemantics(
+	__in const char * TypeName,
+	__inout unsigned long & Failures
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the reference counting semantics of IntrusivePtr for
+	one object type.
+
+Arguments:
+
+	TypeName - Supplies the name of the type under test.
+
+	Failures - Supplies the failure counter, which is incremented for each
+	           check that failed.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef IntrusivePtr< Object > Ptr;
+
+	LONG Live;
+
+	Live = LiveObjects;
+
+	//
+	// Copies and assignments share the object, which is deleted when the last
+	// reference is dropped.
+	//
+
+	{
+		Ptr First( new Object( 1 ) );
+		Ptr Empty;
+
+		Expect( First.unique( ), TypeName, "new pointer is not unique", Failures );
+		Expect( Empty.unique( ), TypeName, "empty pointer is not unique", Failures );
+		Expect( Empty == NULL, TypeName, "empty pointer is not NULL", Failures );
+
+		{
+			Ptr Second( First );
+			Ptr Third;
+
+			Third = Second;
+
+			Expect( Second.get( ) == First.get( ), TypeName, "copy does not share the object", Failures );
+			Expect( Third.get( ) == First.get( ), TypeName, "assignment does not share the object", Failures );
+			Expect( !First.unique( ), TypeName, "shared pointer is unique", Failures );
+
+			Third = Third;
+
+			Expect( Third->Value == 1, TypeName, "self assignment lost the object", Failures );
+
+			Second.release( );
+			Third.release( );
+
+			Expect( Second == NULL, TypeName, "released pointer is not NULL", Failures );
+			Expect( First.unique( ), TypeName, "pointer is not unique after releases", Failures );
+		}
+
+		Expect( LiveObjects == Live + 1, TypeName, "object deleted while referenced", Failures );
+
+		First = Empty;
+
+		Expect( LiveObjects == Live, TypeName, "object not deleted by assignment", Failures );
+	}
+
+	Expect( LiveObjects == Live, TypeName, "object leaked", Failures );
+
+	//
+	// Unlike SharedPtr, pointers created independently from the same raw
+	// pointer share one reference count.
+	//
+
+	{
+		Object * Raw;
+
+		Raw = new Object( 2 );
+
+		{
+			Ptr First( Raw );
+
+			{
+				Ptr Second( Raw );
+
+				Expect( !First.unique( ), TypeName, "second pointer from raw pointer not counted", Failures );
+			}
+
+			Expect( LiveObjects == Live + 1, TypeName, "object deleted by second raw pointer", Failures );
+			Expect( First.unique( ), TypeName, "pointer is not unique after raw pointer release", Failures );
+		}
+
+		Expect( LiveObjects == Live, TypeName, "object from raw pointer leaked", Failures );
+	}
+
+	//
+	// Copying the object itself does not copy its reference count.
+	//
+
+	{
+		Ptr First( new Object( 3 ) );
+		Ptr Copy( new Object( *First ) );
+
+		Expect( First.unique( ), TypeName, "original object count changed by copy", Failures );
+		Expect( Copy.unique( ), TypeName, "object copy inherited the reference count", Failures );
+		Expect( Copy->Value == 3, TypeName, "object copy lost its value", Failures );
+	}
+
+	Expect( LiveObjects == Live, TypeName, "copied object leaked", Failures );
+
+	//
+	// Assigning a pointer from within the object that it currently references
+	// must take the new reference before dropping the old one.
+	//
+
+	{
+		typedef ChainNode< RefBase > Node;
+
+		typename Node::Ptr Head( new Node );
+
+		Head->Next       = new Node;
+		Head->Next->Next = new Node;
+
+		Expect( LiveObjects == Live + 3, TypeName, "chain construction failed", Failures );
+
+		Head = Head->Next;
+
+		Expect( LiveObjects == Live + 2, TypeName, "chain head not deleted by assignment", Failures );
+		Expect( (Head != NULL) && (Head->Next != NULL), TypeName, "chain lost by assignment", Failures );
+
+		Head = Head->Next;
+		Head = Head->Next;
+
+		Expect( Head == NULL, TypeName, "chain end is not NULL", Failures );
+	}
+
+	Expect( LiveObjects == Live, TypeName, "chain leaked", Failures );
+}
+
+bool
+CheckEquivalence(
+	)
+/*++
+
+Routine Description:
+
+	This routine checks the reference counting semantics of IntrusivePtr for
+	both reference count bases and both heaps.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Failures;
+
+	Failures = 0;
+
+	CheckSemantics< IntrusiveProcessObject, IntrusiveRefCounted >(
+		"IntrusiveRefCounted, process heap",
+		Failures);
+	CheckSemantics< LocalProcessObject, LocalIntrusiveRefCounted >(
+		"LocalIntrusiveRefCounted, process heap",
+		Failures);
+	CheckSemantics< IntrusiveCrtObject, IntrusiveRefCounted >(
+		"IntrusiveRefCounted, CRT heap",
+		Failures);
+	CheckSemantics< LocalCrtObject, LocalIntrusiveRefCounted >(
+		"LocalIntrusiveRefCounted, CRT heap",
+		Failures);
+
+	printf( "Checked IntrusivePtr semantics: %lu failures.\n", Failures );
+
+	return (Failures == 0);
+}
+
+double
+GetElapsedNs(
+	__in const LARGE_INTEGER & Start,
+	__in const LARGE_INTEGER & End,
+	__in const LARGE_INTEGER & Frequency,
+	__in unsigned long Operations
+	)
+/*++
+
+Routine Description:
+
+	This routine converts a performance counter interval to the average time
+	taken by one operation.
+
+Arguments:
+
+	Start - Supplies the counter value at the start of the interval.
+
+	End - Supplies the counter value at the end of the interval.
+
+	Frequency - Supplies the performance counter frequency.
+
+	Operations - Supplies the number of operations performed.
+
+Return Value:
+
+	The routine returns the average time per operation, in nanoseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	double Seconds;
+
+	Seconds = (double) (End.QuadPart - Start.QuadPart) / (double) Frequency.QuadPart;
+
+	return (Seconds * 1.0e9) / (double) Operations;
+}
+
+template< class Ptr, class Object >
+double
+MeasureCreate(
+	__in unsigned long Iterations,
+	__inout unsigned __int64 & Checksum
+	)
+/*++
+
+Routine Description:
+
+	This routine measures creating an object through a pointer and then
+	dropping the only reference to it.
+
+Arguments:
+
+	Iterations - Supplies the number of objects to create.
+
+	Checksum - Supplies a checksum that the objects are folded into, so that
+	           the work cannot be optimized away.
+
+Return Value:
+
+	The routine returns the fastest average time per object over several
+	passes, in nanoseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	double        Best;
+
+	QueryPerformanceFrequency( &Frequency );
+
+	Best = 0.0;
+
+	for (int Pass = 0; Pass < MEASUREMENT_PASSES; Pass += 1)
+	{
+		double Ns;
+
+		QueryPerformanceCounter( &Start );
+
+		for (unsigned long i = 0; i < Iterations; i += 1)
+		{
+			Ptr p( new Object( i ) );
+
+			//
+			// Fold in the object address as well as its contents, so that the
+			// allocation itself cannot be elided.
+			//
+
+			Checksum += p->Value + (ULONG_PTR) p.get( );
+		}
+
+		QueryPerformanceCounter( &End );
+
+		Ns = GetElapsedNs( Start, End, Frequency, Iterations );
+
+		if ((Pass == 0) || (Ns < Best))
+			Best = Ns;
+	}
+
+	return Best;
+}
+
+template< class Ptr, class Object >
+double
+MeasureCopy(
+	__in unsigned long Iterations,
+	__in unsigned long Depth,
+	__inout unsigned __int64 & Checksum
+	)
+/*++
+
+Routine Description:
+
+	This routine measures copying a pointer into a stack of slots and then
+	releasing each copy, in the fashion of the script VM pushing and popping
+	an engine structure.
+
+Arguments:
+
+	Iterations - Supplies the number of copies to make.  The count is rounded
+	             down to a multiple of the stack depth.
+
+	Depth - Supplies the number of slots in the stack.
+
+	Checksum - Supplies a checksum that the copies are folded into, so that
+	           the work cannot be optimized away.
+
+Return Value:
+
+	The routine returns the fastest average time per copy and release over
+	several passes, in nanoseconds.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< Ptr > Stack( Depth );
+	Ptr                Source( new Object( 1 ) );
+	unsigned long      Rounds;
+	LARGE_INTEGER      Frequency;
+	LARGE_INTEGER      Start;
+	LARGE_INTEGER      End;
+	double             Best;
+
+	Rounds = Iterations / Depth;
+
+	if (Rounds == 0)
+		Rounds = 1;
+
+	QueryPerformanceFrequency( &Frequency );
+
+	Best = 0.0;
+
+	for (int Pass = 0; Pass < MEASUREMENT_PASSES; Pass += 1)
+	{
+		double Ns;
+
+		QueryPerformanceCounter( &Start );
+
+		for (unsigned long r = 0; r < Rounds; r += 1)
+		{
+			for (unsigned long i = 0; i < Depth; i += 1)
+				Stack[ i ] = Source;
+
+			for (unsigned long i = Depth; i != 0; i -= 1)
+			{
+				Checksum += Stack[ i - 1 ]->Value;
+				Stack[ i - 1 ].release( );
+			}
+		}
+
+		QueryPerformanceCounter( &End );
+
+		Ns = GetElapsedNs( Start, End, Frequency, Rounds * Depth );
+
+		if ((Pass == 0) || (Ns < Best))
+			Best = Ns;
+	}
+
+	return Best;
+}
+
+template< template< class > class Object >
+void
+MeasureHeap(
+	__in const char * HeapName,
+	__in unsigned long Iterations,
+	__in unsigned long Depth,
+	__inout unsigned __int64 & Checksum
+	)
+/*++
+
+Routine Description:
+
+	This routine measures SharedPtr and both IntrusivePtr variants for objects
+	allocated from one heap, and prints the results.
+
+Arguments:
+
+	HeapName - Supplies the name of the heap the objects are allocated from.
+
+	Iterations - Supplies the number of operations measured per pass.
+
+	Depth - Supplies the number of slots in the copy stack.
+
+	Checksum - Supplies a checksum that the results are folded into.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	MEASUREMENT Results[ 3 ];
+
+	Results[ 0 ].Name     = "SharedPtr";
+	Results[ 0 ].CreateNs = MeasureCreate< SharedPtr< Object< UncountedBase > >, Object< UncountedBase > >(
+		Iterations,
+		Checksum);
+	Results[ 0 ].CopyNs   = MeasureCopy< SharedPtr< Object< UncountedBase > >, Object< UncountedBase > >(
+		Iterations,
+		Depth,
+		Checksum);
+
+	Results[ 1 ].Name     = "IntrusivePtr (interlocked)";
+	Results[ 1 ].CreateNs = MeasureCreate< IntrusivePtr< Object< IntrusiveRefCounted > >, Object< IntrusiveRefCounted > >(
+		Iterations,
+		Checksum);
+	Results[ 1 ].CopyNs   = MeasureCopy< IntrusivePtr< Object< IntrusiveRefCounted > >, Object< IntrusiveRefCounted > >(
+		Iterations,
+		Depth,
+		Checksum);
+
+	Results[ 2 ].Name     = "IntrusivePtr (local)";
+	Results[ 2 ].CreateNs = MeasureCreate< IntrusivePtr< Object< LocalIntrusiveRefCounted > >, Object< LocalIntrusiveRefCounted > >(
+		Iterations,
+		Checksum);
+	Results[ 2 ].CopyNs   = MeasureCopy< IntrusivePtr< Object< LocalIntrusiveRefCounted > >, Object< LocalIntrusiveRefCounted > >(
+		Iterations,
+		Depth,
+		Checksum);
+
+	printf( "\n%s (ns per operation, ratio to SharedPtr):\n", HeapName );
+	printf( "  %-28s %16s %16s\n", "", "create/destroy", "copy/release" );
+
+	for (size_t i = 0; i < sizeof( Results ) / sizeof( Results[ 0 ] ); i += 1)
+	{
+		printf(
+			"  %-28s %8.1f (%.2fx) %8.1f (%.2fx)\n",
+			Results[ i ].Name,
+			Results[ i ].CreateNs,
+			(Results[ 0 ].CreateNs > 0.0) ? Results[ i ].CreateNs / Results[ 0 ].CreateNs : 0.0,
+			Results[ i ].CopyNs,
+			(Results[ 0 ].CopyNs > 0.0) ? Results[ i ].CopyNs / Results[ 0 ].CopyNs : 0.0);
+	}
+}
+
+void
+RunBenchmark(
+	__in unsigned long Iterations,
+	__in unsigned long Depth
+	)
+/*++
+
+Routine Description:
+
+	This routine measures SharedPtr and IntrusivePtr for objects allocated
+	from the process heap and from the CRT heap.
+
+Arguments:
+
+	Iterations - Supplies the number of operations measured per pass.
+
+	Depth - Supplies the number of slots in the copy stack.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned __int64 Checksum;
+
+	Checksum = 0;
+
+	printf(
+		"Measuring %lu operations per pass, best of %d passes, copy stack depth %lu.\n",
+		Iterations,
+		MEASUREMENT_PASSES,
+		Depth);
+
+	MeasureHeap< ProcessHeapObject >( "Process heap", Iterations, Depth, Checksum );
+	MeasureHeap< CrtHeapObject >( "CRT heap", Iterations, Depth, Checksum );
+
+	printf( "(checksum %I64x)\n", Checksum );
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"RefPtrBenchmark\n"
+		"\n"
+		"This program checks the reference counting semantics of IntrusivePtr, and\n"
+		"then measures object creation and pointer copies through SharedPtr and\n"
+		"IntrusivePtr with objects allocated from the process heap and the CRT heap.\n"
+		"\n"
+		"Usage: RefPtrBenchmark [-iterations <operations per pass>] [-depth <copy stack depth>]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the reference counted pointer
+	benchmark program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Iterations;
+	unsigned long Depth;
+
+	Iterations = 4000000;
+	Depth      = 64;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-iterations" )) && (i + 1 < argc))
+			Iterations = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-depth" )) && (i + 1 < argc))
+			Depth = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	if ((Iterations == 0) || (Depth == 0))
+	{
+		printf( "\nThe iteration count and copy stack depth must be nonzero.\n" );
+		return -1;
+	}
+
+	if (!CheckEquivalence( ))
+		return 1;
+
+	try
+	{
+		RunBenchmark( Iterations, Depth );
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		return -1;
+	}
+
+	return 0;
+}
@@ -1,6 +1,457 @@
 #include "Precomp.h"
 #include "CharsetConv.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SWUTIL_CHARSET_SSE2 1
+#endif
+
+//
+// Define the tables for the direct (single pass) transcoders.  Characters
+// below 0x80 are ASCII in every supported code page; only the upper half of
+// each code page is tabulated.  The reverse tables are sorted by Unicode
+// value for binary search.
+//
+
+typedef struct _CODEPAGE_REVERSE_ENTRY
+{
+	USHORT Unicode;
+	UCHAR  Char;
+} CODEPAGE_REVERSE_ENTRY, * PCODEPAGE_REVERSE_ENTRY;
+
+typedef const CODEPAGE_REVERSE_ENTRY * PCCODEPAGE_REVERSE_ENTRY;
+
+//
+// Windows-1252 (English, French, German, Italian and Spanish talk tables).
+//
+// Bytes that the code page leaves undefined map to the C1 control with the
+// same value, matching MultiByteToWideChar.
+//
+
+static const USHORT Cp1252ToUnicode[ 128 ] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+static const CODEPAGE_REVERSE_ENTRY UnicodeToCp1252[ 128 ] =
+{
+	{ 0x0081, 0x81 }, { 0x008D, 0x8D }, { 0x008F, 0x8F }, { 0x0090, 0x90 },
+	{ 0x009D, 0x9D }, { 0x00A0, 0xA0 }, { 0x00A1, 0xA1 }, { 0x00A2, 0xA2 },
+	{ 0x00A3, 0xA3 }, { 0x00A4, 0xA4 }, { 0x00A5, 0xA5 }, { 0x00A6, 0xA6 },
+	{ 0x00A7, 0xA7 }, { 0x00A8, 0xA8 }, { 0x00A9, 0xA9 }, { 0x00AA, 0xAA },
+	{ 0x00AB, 0xAB }, { 0x00AC, 0xAC }, { 0x00AD, 0xAD }, { 0x00AE, 0xAE },
+	{ 0x00AF, 0xAF }, { 0x00B0, 0xB0 }, { 0x00B1, 0xB1 }, { 0x00B2, 0xB2 },
+	{ 0x00B3, 0xB3 }, { 0x00B4, 0xB4 }, { 0x00B5, 0xB5 }, { 0x00B6, 0xB6 },
+	{ 0x00B7, 0xB7 }, { 0x00B8, 0xB8 }, { 0x00B9, 0xB9 }, { 0x00BA, 0xBA },
+	{ 0x00BB, 0xBB }, { 0x00BC, 0xBC }, { 0x00BD, 0xBD }, { 0x00BE, 0xBE },
+	{ 0x00BF, 0xBF }, { 0x00C0, 0xC0 }, { 0x00C1, 0xC1 }, { 0x00C2, 0xC2 },
+	{ 0x00C3, 0xC3 }, { 0x00C4, 0xC4 }, { 0x00C5, 0xC5 }, { 0x00C6, 0xC6 },
+	{ 0x00C7, 0xC7 }, { 0x00C8, 0xC8 }, { 0x00C9, 0xC9 }, { 0x00CA, 0xCA },
+	{ 0x00CB, 0xCB }, { 0x00CC, 0xCC }, { 0x00CD, 0xCD }, { 0x00CE, 0xCE },
+	{ 0x00CF, 0xCF }, { 0x00D0, 0xD0 }, { 0x00D1, 0xD1 }, { 0x00D2, 0xD2 },
+	{ 0x00D3, 0xD3 }, { 0x00D4, 0xD4 }, { 0x00D5, 0xD5 }, { 0x00D6, 0xD6 },
+	{ 0x00D7, 0xD7 }, { 0x00D8, 0xD8 }, { 0x00D9, 0xD9 }, { 0x00DA, 0xDA },
+	{ 0x00DB, 0xDB }, { 0x00DC, 0xDC }, { 0x00DD, 0xDD }, { 0x00DE, 0xDE },
+	{ 0x00DF, 0xDF }, { 0x00E0, 0xE0 }, { 0x00E1, 0xE1 }, { 0x00E2, 0xE2 },
+	{ 0x00E3, 0xE3 }, { 0x00E4, 0xE4 }, { 0x00E5, 0xE5 }, { 0x00E6, 0xE6 },
+	{ 0x00E7, 0xE7 }, { 0x00E8, 0xE8 }, { 0x00E9, 0xE9 }, { 0x00EA, 0xEA },
+	{ 0x00EB, 0xEB }, { 0x00EC, 0xEC }, { 0x00ED, 0xED }, { 0x00EE, 0xEE },
+	{ 0x00EF, 0xEF }, { 0x00F0, 0xF0 }, { 0x00F1, 0xF1 }, { 0x00F2, 0xF2 },
+	{ 0x00F3, 0xF3 }, { 0x00F4, 0xF4 }, { 0x00F5, 0xF5 }, { 0x00F6, 0xF6 },
+	{ 0x00F7, 0xF7 }, { 0x00F8, 0xF8 }, { 0x00F9, 0xF9 }, { 0x00FA, 0xFA },
+	{ 0x00FB, 0xFB }, { 0x00FC, 0xFC }, { 0x00FD, 0xFD }, { 0x00FE, 0xFE },
+	{ 0x00FF, 0xFF }, { 0x0152, 0x8C }, { 0x0153, 0x9C }, { 0x0160, 0x8A },
+	{ 0x0161, 0x9A }, { 0x0178, 0x9F }, { 0x017D, 0x8E }, { 0x017E, 0x9E },
+	{ 0x0192, 0x83 }, { 0x02C6, 0x88 }, { 0x02DC, 0x98 }, { 0x2013, 0x96 },
+	{ 0x2014, 0x97 }, { 0x2018, 0x91 }, { 0x2019, 0x92 }, { 0x201A, 0x82 },
+	{ 0x201C, 0x93 }, { 0x201D, 0x94 }, { 0x201E, 0x84 }, { 0x2020, 0x86 },
+	{ 0x2021, 0x87 }, { 0x2022, 0x95 }, { 0x2026, 0x85 }, { 0x2030, 0x89 },
+	{ 0x2039, 0x8B }, { 0x203A, 0x9B }, { 0x20AC, 0x80 }, { 0x2122, 0x99 },
+};
+
+//
+// Windows-1250 (Polish talk tables).
+//
+
+static const USHORT Cp1250ToUnicode[ 128 ] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0083, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x0088, 0x2030, 0x0160, 0x2039, 0x015A, 0x0164, 0x017D, 0x0179,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x0098, 0x2122, 0x0161, 0x203A, 0x015B, 0x0165, 0x017E, 0x017A,
+	0x00A0, 0x02C7, 0x02D8, 0x0141, 0x00A4, 0x0104, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x015E, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x017B,
+	0x00B0, 0x00B1, 0x02DB, 0x0142, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x0105, 0x015F, 0x00BB, 0x013D, 0x02DD, 0x013E, 0x017C,
+	0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+	0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+	0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+	0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+	0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+	0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+	0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+	0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9,
+};
+
+static const CODEPAGE_REVERSE_ENTRY UnicodeToCp1250[ 128 ] =
+{
+	{ 0x0081, 0x81 }, { 0x0083, 0x83 }, { 0x0088, 0x88 }, { 0x0090, 0x90 },
+	{ 0x0098, 0x98 }, { 0x00A0, 0xA0 }, { 0x00A4, 0xA4 }, { 0x00A6, 0xA6 },
+	{ 0x00A7, 0xA7 }, { 0x00A8, 0xA8 }, { 0x00A9, 0xA9 }, { 0x00AB, 0xAB },
+	{ 0x00AC, 0xAC }, { 0x00AD, 0xAD }, { 0x00AE, 0xAE }, { 0x00B0, 0xB0 },
+	{ 0x00B1, 0xB1 }, { 0x00B4, 0xB4 }, { 0x00B5, 0xB5 }, { 0x00B6, 0xB6 },
+	{ 0x00B7, 0xB7 }, { 0x00B8, 0xB8 }, { 0x00BB, 0xBB }, { 0x00C1, 0xC1 },
+	{ 0x00C2, 0xC2 }, { 0x00C4, 0xC4 }, { 0x00C7, 0xC7 }, { 0x00C9, 0xC9 },
+	{ 0x00CB, 0xCB }, { 0x00CD, 0xCD }, { 0x00CE, 0xCE }, { 0x00D3, 0xD3 },
+	{ 0x00D4, 0xD4 }, { 0x00D6, 0xD6 }, { 0x00D7, 0xD7 }, { 0x00DA, 0xDA },
+	{ 0x00DC, 0xDC }, { 0x00DD, 0xDD }, { 0x00DF, 0xDF }, { 0x00E1, 0xE1 },
+	{ 0x00E2, 0xE2 }, { 0x00E4, 0xE4 }, { 0x00E7, 0xE7 }, { 0x00E9, 0xE9 },
+	{ 0x00EB, 0xEB }, { 0x00ED, 0xED }, { 0x00EE, 0xEE }, { 0x00F3, 0xF3 },
+	{ 0x00F4, 0xF4 }, { 0x00F6, 0xF6 }, { 0x00F7, 0xF7 }, { 0x00FA, 0xFA },
+	{ 0x00FC, 0xFC }, { 0x00FD, 0xFD }, { 0x0102, 0xC3 }, { 0x0103, 0xE3 },
+	{ 0x0104, 0xA5 }, { 0x0105, 0xB9 }, { 0x0106, 0xC6 }, { 0x0107, 0xE6 },
+	{ 0x010C, 0xC8 }, { 0x010D, 0xE8 }, { 0x010E, 0xCF }, { 0x010F, 0xEF },
+	{ 0x0110, 0xD0 }, { 0x0111, 0xF0 }, { 0x0118, 0xCA }, { 0x0119, 0xEA },
+	{ 0x011A, 0xCC }, { 0x011B, 0xEC }, { 0x0139, 0xC5 }, { 0x013A, 0xE5 },
+	{ 0x013D, 0xBC }, { 0x013E, 0xBE }, { 0x0141, 0xA3 }, { 0x0142, 0xB3 },
+	{ 0x0143, 0xD1 }, { 0x0144, 0xF1 }, { 0x0147, 0xD2 }, { 0x0148, 0xF2 },
+	{ 0x0150, 0xD5 }, { 0x0151, 0xF5 }, { 0x0154, 0xC0 }, { 0x0155, 0xE0 },
+	{ 0x0158, 0xD8 }, { 0x0159, 0xF8 }, { 0x015A, 0x8C }, { 0x015B, 0x9C },
+	{ 0x015E, 0xAA }, { 0x015F, 0xBA }, { 0x0160, 0x8A }, { 0x0161, 0x9A },
+	{ 0x0162, 0xDE }, { 0x0163, 0xFE }, { 0x0164, 0x8D }, { 0x0165, 0x9D },
+	{ 0x016E, 0xD9 }, { 0x016F, 0xF9 }, { 0x0170, 0xDB }, { 0x0171, 0xFB },
+	{ 0x0179, 0x8F }, { 0x017A, 0x9F }, { 0x017B, 0xAF }, { 0x017C, 0xBF },
+	{ 0x017D, 0x8E }, { 0x017E, 0x9E }, { 0x02C7, 0xA1 }, { 0x02D8, 0xA2 },
+	{ 0x02D9, 0xFF }, { 0x02DB, 0xB2 }, { 0x02DD, 0xBD }, { 0x2013, 0x96 },
+	{ 0x2014, 0x97 }, { 0x2018, 0x91 }, { 0x2019, 0x92 }, { 0x201A, 0x82 },
+	{ 0x201C, 0x93 }, { 0x201D, 0x94 }, { 0x201E, 0x84 }, { 0x2020, 0x86 },
+	{ 0x2021, 0x87 }, { 0x2022, 0x95 }, { 0x2026, 0x85 }, { 0x2030, 0x89 },
+	{ 0x2039, 0x8B }, { 0x203A, 0x9B }, { 0x20AC, 0x80 }, { 0x2122, 0x99 },
+};
+
+typedef struct _CODEPAGE_TABLES
+{
+	UINT                     Codepage;
+	const USHORT           * ToUnicode;
+	PCCODEPAGE_REVERSE_ENTRY FromUnicode;
+} CODEPAGE_TABLES, * PCODEPAGE_TABLES;
+
+typedef const CODEPAGE_TABLES * PCCODEPAGE_TABLES;
+
+static const CODEPAGE_TABLES DirectCodepages[] =
+{
+	{ 1252, Cp1252ToUnicode, UnicodeToCp1252 },
+	{ 1250, Cp1250ToUnicode, UnicodeToCp1250 }
+};
+
+//
+// Return the direct transcoding tables for a code page, else NULL if the
+// code page must be converted through the Win32 API.
+//
+static
+PCCODEPAGE_TABLES
+GetDirectCodepage(
+	__in UINT Codepage
+	)
+{
+	if (Codepage == CP_ACP)
+		Codepage = GetACP( );
+
+	for (size_t i = 0; i < sizeof( DirectCodepages ) / sizeof( DirectCodepages[ 0 ] ); i += 1)
+	{
+		if (DirectCodepages[ i ].Codepage == Codepage)
+			return &DirectCodepages[ i ];
+	}
+
+	return NULL;
+}
+
+#ifdef SWUTIL_CHARSET_SSE2
+//
+// Return true if SSE2 instructions may be used.
+//
+static
+bool
+IsSse2Present(
+	)
+{
+#if defined(_M_X64) || defined(__SSE2__)
+	return true;
+#else
+	//
+	// The check is idempotent, so racing initializers are harmless.
+	//
+
+	static const bool Present = (IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE ) != FALSE);
+
+	return Present;
+#endif
+}
+#endif
+
+//
+// Copy the leading run of ASCII characters from Source to Dest, returning the
+// length of the run.  The run is scanned 16 bytes at a time with SSE2 where
+// available, then 8 bytes at a time, then bytewise.
+//
+static
+size_t
+CopyAsciiRun(
+	__in_bcount( Length ) const unsigned char * Source,
+	__in size_t Length,
+	__out_bcount( Length ) unsigned char * Dest
+	)
+{
+	size_t Offset = 0;
+
+#ifdef SWUTIL_CHARSET_SSE2
+	if (IsSse2Present( ))
+	{
+		while (Length - Offset >= 16)
+		{
+			__m128i Chunk = _mm_loadu_si128( (const __m128i *) (Source + Offset) );
+
+			if (_mm_movemask_epi8( Chunk ) != 0)
+				break;
+
+			_mm_storeu_si128( (__m128i *) (Dest + Offset), Chunk );
+			Offset += 16;
+		}
+	}
+#endif
+
+	while (Length - Offset >= 8)
+	{
+		ULONGLONG Word;
+
+		memcpy( &Word, Source + Offset, sizeof( Word ) );
+
+		if ((Word & 0x8080808080808080ULL) != 0)
+			break;
+
+		memcpy( Dest + Offset, &Word, sizeof( Word ) );
+		Offset += 8;
+	}
+
+	while ((Offset < Length) && (Source[ Offset ] < 0x80))
+	{
+		Dest[ Offset ] = Source[ Offset ];
+		Offset += 1;
+	}
+
+	return Offset;
+}
+
+//
+// Map a Unicode character to a code page character, returning false if the
+// character has no exact mapping.
+//
+static
+bool
+LookupReverse(
+	__in PCCODEPAGE_REVERSE_ENTRY Table,
+	__in ULONG Unicode,
+	__out unsigned char & Char
+	)
+{
+	size_t Low  = 0;
+	size_t High = 128;
+
+	while (Low < High)
+	{
+		size_t Mid = (Low + High) / 2;
+
+		if (Table[ Mid ].Unicode == Unicode)
+		{
+			Char = Table[ Mid ].Char;
+			return true;
+		}
+		else if (Table[ Mid ].Unicode < Unicode)
+		{
+			Low = Mid + 1;
+		}
+		else
+		{
+			High = Mid;
+		}
+	}
+
+	return false;
+}
+
+//
+// Convert 8-bit characters from the given codepage directly to UTF-8.
+//
+size_t
+swutil::CodepageToUTF8(
+	__in_bcount( Length ) const char * Text,
+	__in size_t Length,
+	__out_bcount( Length * 3 ) char * Result,
+	__in UINT Codepage /* = CP_ACP */
+	)
+{
+	PCCODEPAGE_TABLES     Tables;
+	const unsigned char * Source;
+	unsigned char       * Dest;
+	size_t                In;
+	size_t                Out;
+
+	Tables = GetDirectCodepage( Codepage );
+
+	if (Tables == NULL)
+		return (size_t) -1;
+
+	Source = (const unsigned char *) Text;
+	Dest   = (unsigned char *) Result;
+	In     = 0;
+	Out    = 0;
+
+	while (In < Length)
+	{
+		size_t Run = CopyAsciiRun( Source + In, Length - In, Dest + Out );
+
+		In  += Run;
+		Out += Run;
+
+		if (In == Length)
+			break;
+
+		//
+		// Every supported code page maps into the BMP below U+FFFF, so the
+		// character encodes to either two or three bytes.
+		//
+
+		USHORT Unicode = Tables->ToUnicode[ Source[ In ] - 0x80 ];
+
+		if (Unicode < 0x800)
+		{
+			Dest[ Out + 0 ] = (unsigned char) (0xC0 | (Unicode >> 6));
+			Dest[ Out + 1 ] = (unsigned char) (0x80 | (Unicode & 0x3F));
+			Out += 2;
+		}
+		else
+		{
+			Dest[ Out + 0 ] = (unsigned char) (0xE0 | (Unicode >> 12));
+			Dest[ Out + 1 ] = (unsigned char) (0x80 | ((Unicode >> 6) & 0x3F));
+			Dest[ Out + 2 ] = (unsigned char) (0x80 | (Unicode & 0x3F));
+			Out += 3;
+		}
+
+		In += 1;
+	}
+
+	return Out;
+}
+
+//
+// Convert UTF-8 characters directly to 8-bit characters in the given
+// codepage.
+//
+size_t
+swutil::UTF8ToCodepage(
+	__in_bcount( Length ) const char * UTF8,
+	__in size_t Length,
+	__out_bcount( Length ) char * Result,
+	__in UINT Codepage /* = CP_ACP */
+	)
+{
+	PCCODEPAGE_TABLES     Tables;
+	const unsigned char * Source;
+	unsigned char       * Dest;
+	size_t                In;
+	size_t                Out;
+
+	Tables = GetDirectCodepage( Codepage );
+
+	if (Tables == NULL)
+		return (size_t) -1;
+
+	Source = (const unsigned char *) UTF8;
+	Dest   = (unsigned char *) Result;
+	In     = 0;
+	Out    = 0;
+
+	while (In < Length)
+	{
+		size_t Run = CopyAsciiRun( Source + In, Length - In, Dest + Out );
+
+		In  += Run;
+		Out += Run;
+
+		if (In == Length)
+			break;
+
+		//
+		// Decode one multibyte sequence.  Only two and three byte sequences
+		// can map to a single byte code page; everything else (including
+		// malformed input) is left to the caller's fallback path.
+		//
+
+		unsigned char Lead = Source[ In ];
+		ULONG         Unicode;
+
+		if ((Lead >= 0xC2) && (Lead < 0xE0))
+		{
+			if ((Length - In < 2) ||
+			    ((Source[ In + 1 ] & 0xC0) != 0x80))
+			{
+				return (size_t) -1;
+			}
+
+			Unicode = ((ULONG) (Lead & 0x1F) << 6) |
+			          ((ULONG) (Source[ In + 1 ] & 0x3F));
+			In += 2;
+		}
+		else if ((Lead >= 0xE0) && (Lead < 0xF0))
+		{
+			if ((Length - In < 3) ||
+			    ((Source[ In + 1 ] & 0xC0) != 0x80) ||
+			    ((Source[ In + 2 ] & 0xC0) != 0x80))
+			{
+				return (size_t) -1;
+			}
+
+			Unicode = ((ULONG) (Lead & 0x0F) << 12) |
+			          ((ULONG) (Source[ In + 1 ] & 0x3F) << 6) |
+			          ((ULONG) (Source[ In + 2 ] & 0x3F));
+
+			if ((Unicode < 0x800) ||
+			    ((Unicode >= 0xD800) && (Unicode <= 0xDFFF)))
+			{
+				return (size_t) -1;
+			}
+
+			In += 3;
+		}
+		else
+		{
+			return (size_t) -1;
+		}
+
+		if (!LookupReverse( Tables->FromUnicode, Unicode, Dest[ Out ] ))
+			return (size_t) -1;
+
+		Out += 1;
+	}
+
+	return Out;
+}
+
 
 //
 // Convert 8-bit characters from the given codepage to UTF-8.
@@ -15,6 +466,28 @@ swutil::UTF8Encode(
 {
 	try
 	{
+		//
+		// Transcode the single byte code pages in one pass.  The output is
+		// built in a separate string and swapped in as Text may alias Result.
+		//
+
+		if ((!Text.empty( )) && (GetDirectCodepage( Codepage ) != NULL))
+		{
+			std::string UTF8( Text.size( ) * 3, '\0' );
+			size_t      UTF8Chars;
+
+			UTF8Chars = CodepageToUTF8(
+				Text.data( ),
+				Text.size( ),
+				&UTF8[ 0 ],
+				Codepage);
+
+			UTF8.resize( UTF8Chars );
+			Result.swap( UTF8 );
+
+			return true;
+		}
+
 		//
 		// We need to first convert input to Unicode before we can convert it
 		// to UTF-8...
@@ -196,6 +669,58 @@ swutil::UTF8Decode(
 	}
 }
 
+//
+// Convert UTF-8 characters to 8-bit characters in the given codepage.
+// UTF8 and Result MAY be the same buffer.
+//
+bool
+swutil::UTF8Decode(
+	__in const std::string & UTF8,
+	__out std::string & Result,
+	__in UINT Codepage /* = CP_ACP */
+	)
+{
+	try
+	{
+		//
+		// Try the single pass transcoder first.  It declines malformed input
+		// and characters without an exact mapping, which are converted via
+		// Unicode so that the system's substitution rules apply.
+		//
+
+		if ((!UTF8.empty( )) && (GetDirectCodepage( Codepage ) != NULL))
+		{
+			std::string Ansi( UTF8.size( ), '\0' );
+			size_t      AnsiChars;
+
+			AnsiChars = UTF8ToCodepage(
+				UTF8.data( ),
+				UTF8.size( ),
+				&Ansi[ 0 ],
+				Codepage);
+
+			if (AnsiChars != (size_t) -1)
+			{
+				Ansi.resize( AnsiChars );
+				Result.swap( Ansi );
+
+				return true;
+			}
+		}
+
+		std::wstring Unicode;
+
+		if (!UTF8Decode( UTF8, Unicode ))
+			return false;
+
+		return UnicodeToAnsi( Unicode, Result, Codepage );
+	}
+	catch (std::bad_alloc)
+	{
+		return false;
+	}
+}
+
 //
 // Convert 8-bit characters to 16-bit characters using the given codepage.
 //
@@ -36,6 +36,42 @@ namespace swutil
 		__out std::wstring & Result
 		);
 
+	//
+	// Convert UTF-8 characters to 8-bit characters in the given codepage.
+	// UTF8 and Result MAY be the same buffer.
+	//
+	bool
+	UTF8Decode(
+		__in const std::string & UTF8,
+		__out std::string & Result,
+		__in UINT Codepage = CP_ACP
+		);
+
+	//
+	// Single pass transcoders for the single byte code pages used by the
+	// talk tables (Windows-1252 and Windows-1250).  The return value is the
+	// number of bytes written, or (size_t) -1 if the code page is not
+	// directly supported or (for UTF8ToCodepage) the input is malformed or
+	// holds a character without an exact mapping.  The UTF8Encode and
+	// UTF8Decode routines use these, falling back to the system conversion
+	// routines when they decline.
+	//
+	size_t
+	CodepageToUTF8(
+		__in_bcount( Length ) const char * Text,
+		__in size_t Length,
+		__out_bcount( Length * 3 ) char * Result,
+		__in UINT Codepage = CP_ACP
+		);
+
+	size_t
+	UTF8ToCodepage(
+		__in_bcount( Length ) const char * UTF8,
+		__in size_t Length,
+		__out_bcount( Length ) char * Result,
+		__in UINT Codepage = CP_ACP
+		);
+
 	//
 	// Convert 8-bit characters to 16-bit characters using the given codepage.
 	//
@@ -9,6 +9,40 @@ using swutil::BufferParser;
 
 #define BUFFERPARSE_BREAK_ON_FAIL 0
 
+namespace
+{
+	//
+	// Mirror the bit order of every byte in a 64-bit value, without altering
+	// the order of the bytes themselves.
+	//
+
+	inline
+	unsigned __int64
+	ReverseBitsInBytes(
+		__in unsigned __int64 Value
+		)
+	{
+		Value = ((Value >> 1) & 0x5555555555555555ull) | ((Value & 0x5555555555555555ull) << 1);
+		Value = ((Value >> 2) & 0x3333333333333333ull) | ((Value & 0x3333333333333333ull) << 2);
+		Value = ((Value >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((Value & 0x0F0F0F0F0F0F0F0Full) << 4);
+
+		return Value;
+	}
+
+	inline
+	unsigned int
+	ReverseBitsInByte(
+		__in unsigned int Value
+		)
+	{
+		Value = ((Value >> 1) & 0x55) | ((Value & 0x55) << 1);
+		Value = ((Value >> 2) & 0x33) | ((Value & 0x33) << 2);
+		Value = ((Value >> 4) & 0x0F) | ((Value & 0x0F) << 4);
+
+		return Value;
+	}
+}
+
 BufferParser::BufferParser(
 	__in_bcount( Length ) const void *Data,
 	__in size_t Length,
@@ -136,7 +170,6 @@ BufferParser::GetFieldBits(
 
 	size_t BitsThisByte  = ((m_DataPosRemaining > 1) ? 8 : m_HighestValidBitPos);
 	size_t BitsRemaining = BitsThisByte - ((m_BitPos == 8) ? 0 : m_BitPos);
-	size_t CurrOutBit    = 0;
 
 	if (NumBits > BitsRemaining)
 	{
@@ -171,68 +204,123 @@ BufferParser::GetFieldBits(
 		}
 	}
 
-	FieldBits = 0;
-
-	while (CurrOutBit < NumBits)
-	{
-		//
-		// If we haven't claimed any data for bit reading yet, then we shall
-		// need to do so first.  Note that after having done this we need to
-		// keep on reading bits until we finish with a byte before the normal
-		// byte-oriented read operations will function.
-		//
+	//
+	// Work out the span of bytes that the field covers.  The bit position
+	// within the first byte is zero if we have not yet claimed it for bit
+	// reading.
+	//
 
-		if (m_BitPos == 8)
-			m_BitPos = 0;
+	size_t BitOffset     = ((m_BitPos == 8) ? 0 : m_BitPos);
+	size_t BitsConsumed  = BitOffset + NumBits;
+	size_t BytesTouched  = (BitsConsumed + 7) / 8;
 
-		//
-		// Grab the current bit.
-		//
+	if (NumBits == 0)
+	{
+		FieldBits = 0;
+		return true;
+	}
 
-		switch (m_BitOrderMode)
-		{
+	//
+	// The checks above always leave the covered span inside the buffer unless
+	// the highest valid bit position was lowered below the current bit
+	// position of the last byte.  Refuse to read past the end in that case.
+	//
 
-		case BitOrderLowToHigh:
-			FieldBits <<= 1;
-			FieldBits  |= static_cast< unsigned __int64 >( ((*m_DataPos >> (    m_BitPos)) & 1ull) );
-//			FieldBits |= static_cast< unsigned __int64 >( (*m_DataPos & (1ull << (    m_BitPos))) << CurrOutBit );
-			break;
-
-		case BitOrderHighToLow:
-			FieldBits <<= 1;
-			FieldBits  |= static_cast< unsigned __int64 >( ((*m_DataPos >> (7 - m_BitPos)) & 1ull) );
-//			FieldBits |= static_cast< unsigned __int64 >( (*m_DataPos & (1ull << (7 - m_BitPos))) << CurrOutBit );
-			break;
-
-		default:
-#ifdef _MSC_VER
-			__assume( 0 );
+	if (BytesTouched > m_DataPosRemaining)
+	{
+#if BUFFERPARSE_BREAK_ON_FAIL
+		__debugbreak( );
 #endif
-			break;
+		return false;
+	}
 
-		}
+	//
+	// Load the covered bytes into a window with the first bit in the stream
+	// order at the top, then shift the field out of the window.  Fields that
+	// stay within the current byte are served from that byte alone.  A field
+	// that straddles the 64-bit window (only possible for more than 57 bits
+	// at a nonzero bit offset) takes its low bits from the following byte.
+	//
 
-		CurrOutBit += 1;
-		m_BitPos   += 1;
+	if (BytesTouched == 1)
+	{
+		unsigned int Byte = *m_DataPos;
 
-		//
-		// If we're at the last bit in this byte, then increment the current
-		// read position, but don't claim the first bit just yet.  This allows
-		// us to use byte-level addressing until we're called to read a sub-
-		// byte quantity once more.
-		//
+		if (m_BitOrderMode == BitOrderLowToHigh)
+			Byte = ReverseBitsInByte( Byte );
 
-		if (m_BitPos == 8)
-		{
-			m_DataPos          += 1;
-			m_DataPosRemaining -= 1;
-		}
+		FieldBits = (Byte >> (8 - BitsConsumed)) & ((1u << NumBits) - 1);
+	}
+	else if (BitsConsumed <= 64)
+	{
+		FieldBits = (LoadBitWindow( m_DataPos, BytesTouched ) << BitOffset) >> (64 - NumBits);
+	}
+	else
+	{
+		size_t       TailBits = BitsConsumed - 64;
+		unsigned int Tail     = m_DataPos[ 8 ];
+
+		if (m_BitOrderMode == BitOrderLowToHigh)
+			Tail = ReverseBitsInByte( Tail );
 
+		FieldBits  = (LoadBitWindow( m_DataPos, 8 ) << BitOffset) >> BitOffset;
+		FieldBits  = (FieldBits << TailBits) | (Tail >> (8 - TailBits));
 	}
 
+	//
+	// Advance past every completed byte.  If we finished exactly on a byte
+	// boundary, then don't claim the next byte just yet.  This allows us to
+	// use byte-level addressing until we're called to read a sub-byte
+	// quantity once more.
+	//
+
+	m_DataPos          += BitsConsumed / 8;
+	m_DataPosRemaining -= BitsConsumed / 8;
+	m_BitPos            = ((BitsConsumed % 8) ? (BitsConsumed % 8) : 8);
+
 	return true;
 }
 
+unsigned __int64
+BufferParser::LoadBitWindow(
+	__in_bcount( Length ) const unsigned char *Data,
+	__in size_t Length
+	) const
+{
+	unsigned __int64 Window;
+
+	//
+	// A full window is fetched with a single unaligned load; only the last
+	// few bytes of the buffer are assembled a byte at a time.  Bytes beyond
+	// Length read as zero.
+	//
+
+	if (Length >= sizeof( Window ))
+	{
+		memcpy( &Window, Data, sizeof( Window ) );
+
+		Window = _byteswap_uint64( Window );
+	}
+	else
+	{
+		Window = 0;
+
+		for (size_t i = 0; i < Length; i += 1)
+			Window |= static_cast< unsigned __int64 >( Data[ i ] ) << (56 - (i * 8));
+	}
+
+	//
+	// In low to high order, the first bit of each byte is the least
+	// significant one, so mirror each byte to put the stream in high to low
+	// order.
+	//
+
+	if (m_BitOrderMode == BitOrderLowToHigh)
+		Window = ReverseBitsInBytes( Window );
+
+	return Window;
+}
+
 bool
 BufferParser::SkipData(
 	__in size_t FieldLength
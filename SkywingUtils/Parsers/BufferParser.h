@@ -406,6 +406,16 @@ namespace swutil
 
 	private:
 
+		//
+		// Load up to eight bytes into a 64-bit window in stream bit order.
+		//
+
+		unsigned __int64
+		LoadBitWindow(
+			__in_bcount( Length ) const unsigned char *Data,
+			__in size_t Length
+			) const;
+
 		//
 		// Initial values for parsing reset.
 		//
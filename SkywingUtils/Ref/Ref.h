@@ -655,6 +655,293 @@ namespace swutil
 	C_ASSERT( offsetof( SharedPtr< int >, m_Ptr ) == sizeof( void * ) );
 
 
+	//
+	// Intrusive reference count base classes, for use with IntrusivePtr.  An
+	// object deriving from one of these classes carries its own reference
+	// count, so an IntrusivePtr requires no separately allocated shared state
+	// and the object is created with a single allocation.
+	//
+	// IntrusiveRefCounted objects may be referenced and dereferenced from any
+	// thread context.
+	//
+	// LocalIntrusiveRefCounted objects use plain (non-interlocked) reference
+	// count arithmetic.  They must be confined to a single thread for their
+	// entire lifetime.
+	//
+	// The reference count is not part of the logical state of the object, so
+	// copying or assigning the object leaves the reference count alone.
+	//
+
+	class IntrusiveRefCounted
+	{
+
+	public:
+
+		inline
+		IntrusiveRefCounted(
+			)
+		: m_IntrusiveReferences( 0 )
+		{
+		}
+
+		inline
+		IntrusiveRefCounted(
+			__in const IntrusiveRefCounted & Other
+			)
+		: m_IntrusiveReferences( 0 )
+		{
+			UNREFERENCED_PARAMETER( Other );
+		}
+
+		inline
+		IntrusiveRefCounted &
+		operator=(
+			__in const IntrusiveRefCounted & Other
+			)
+		{
+			UNREFERENCED_PARAMETER( Other );
+
+			return *this;
+		}
+
+		inline
+		void
+		IntrusiveReference(
+			) const
+		{
+			InterlockedIncrementPtr( &m_IntrusiveReferences );
+		}
+
+		//
+		// Removes a reference, returning true if the reference count has gone
+		// to zero.
+		//
+
+		inline
+		bool
+		IntrusiveDereference(
+			) const
+		{
+			return InterlockedDecrementPtr( &m_IntrusiveReferences ) == 0;
+		}
+
+		inline
+		bool
+		IntrusiveUnique(
+			) const
+		{
+			return m_IntrusiveReferences == 1;
+		}
+
+	protected:
+
+		inline
+		~IntrusiveRefCounted(
+			)
+		{
+		}
+
+	private:
+
+		mutable LONG_PTR volatile m_IntrusiveReferences;
+
+	};
+
+	class LocalIntrusiveRefCounted
+	{
+
+	public:
+
+		inline
+		LocalIntrusiveRefCounted(
+			)
+		: m_IntrusiveReferences( 0 )
+		{
+		}
+
+		inline
+		LocalIntrusiveRefCounted(
+			__in const LocalIntrusiveRefCounted & Other
+			)
+		: m_IntrusiveReferences( 0 )
+		{
+			UNREFERENCED_PARAMETER( Other );
+		}
+
+		inline
+		LocalIntrusiveRefCounted &
+		operator=(
+			__in const LocalIntrusiveRefCounted & Other
+			)
+		{
+			UNREFERENCED_PARAMETER( Other );
+
+			return *this;
+		}
+
+		inline
+		void
+		IntrusiveReference(
+			) const
+		{
+			m_IntrusiveReferences += 1;
+		}
+
+		//
+		// Removes a reference, returning true if the reference count has gone
+		// to zero.
+		//
+
+		inline
+		bool
+		IntrusiveDereference(
+			) const
+		{
+			return --m_IntrusiveReferences == 0;
+		}
+
+		inline
+		bool
+		IntrusiveUnique(
+			) const
+		{
+			return m_IntrusiveReferences == 1;
+		}
+
+	protected:
+
+		inline
+		~LocalIntrusiveRefCounted(
+			)
+		{
+		}
+
+	private:
+
+		mutable LONG_PTR m_IntrusiveReferences;
+
+	};
+
+	//
+	// Intrusively reference counted pointer.  The pointed-to type must derive
+	// from IntrusiveRefCounted or LocalIntrusiveRefCounted, which selects
+	// whether reference count updates are interlocked.  Otherwise, the
+	// interface matches that of SharedPtr.
+	//
+	// Unlike SharedPtr, any number of IntrusivePtr objects may be created
+	// from the same raw pointer, as the reference count travels with the
+	// object.
+	//
+
+	template< class T >
+	class IntrusivePtr
+	{
+
+	public:
+
+		IntrusivePtr(
+			__in T *Ptr
+			)
+			: m_Ptr( Ptr )
+		{
+			if (m_Ptr)
+				m_Ptr->IntrusiveReference( );
+		}
+
+		IntrusivePtr()
+			: m_Ptr( NULL )
+		{
+		}
+
+		IntrusivePtr( __in const IntrusivePtr & Other )
+			: m_Ptr( Other.m_Ptr )
+		{
+			if (m_Ptr)
+				m_Ptr->IntrusiveReference( );
+		}
+
+		~IntrusivePtr()
+		{
+			if (m_Ptr)
+				Dereference( m_Ptr );
+		}
+
+		IntrusivePtr& operator=(
+			__in const IntrusivePtr & Other
+			)
+		{
+			T * OldPtr;
+
+			if (m_Ptr == Other.m_Ptr)
+				return *this;
+
+			OldPtr = m_Ptr;
+			m_Ptr  = Other.m_Ptr;
+
+			if (m_Ptr)
+				m_Ptr->IntrusiveReference( );
+
+			//
+			// Drop the old reference last, as the old object may own the
+			// object that is being assigned to us.
+			//
+
+			if (OldPtr)
+				Dereference( OldPtr );
+
+			return *this;
+		}
+
+		inline T * get() const { return m_Ptr; }
+		inline T & operator*() const { return *m_Ptr; }
+		inline T * operator->() const { return m_Ptr; }
+		inline bool operator==(__in const T * t) const { return m_Ptr == t; }
+		inline bool operator!=(__in const T * t) const { return m_Ptr != t; }
+
+		inline
+		void
+		release()
+		{
+			if (m_Ptr)
+			{
+				T * OldPtr;
+
+				OldPtr = m_Ptr;
+				m_Ptr  = NULL;
+
+				Dereference( OldPtr );
+			}
+		}
+
+		inline
+		bool
+		unique() const
+		{
+			if (!m_Ptr)
+				return true;
+
+			return m_Ptr->IntrusiveUnique( );
+		}
+
+	private:
+
+		static
+		inline
+		void
+		Dereference(
+			__in T * Ptr
+			)
+		{
+			if (Ptr->IntrusiveDereference( ))
+				SharedPtrDeleterDelete( Ptr );
+		}
+
+		T * m_Ptr;
+	};
+
+	C_ASSERT( sizeof( IntrusivePtr< IntrusiveRefCounted > ) == sizeof( void * ) );
+
+
 	
 	//
 	// Define automatically managed buffer context.
@@ -0,0 +1,2160 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	TrxDecompressTest.cpp
+
+Abstract:
+
+	This module houses a program that checks the span and streaming
+	decompression paths of NWN::Compressor, and the streamed walkmesh
+	decompression in TrxFileReader, against the original one-shot zlib
+	uncompress( ) path, and measures the time taken by each path.
+
+	Three checks are made:
+
+	- Generated zlib streams (intact, with trailing data, truncated,
+	  corrupted, and with too little or more than enough output space) are
+	  decompressed through every path, with input chunks of random size
+	  and with input failures injected, and compared with uncompress( ).
+
+	- Generated TRX files are loaded with TrxFileReader, whose walkmesh
+	  decompression streams the compressed block from the file in 64KB
+	  chunks, skips any data trailing the zlib stream, and defers read
+	  errors raised while zlib is active.  The outcome of each load is
+	  compared with that of the original reader, which read the whole
+	  compressed block and then called uncompress( ).
+
+	- Optionally, every compressed packet in a set of TRX (or MDB) files is
+	  decompressed through every path, with the results compared and the
+	  time taken reported, and each file is loaded with TrxFileReader.
+
+--*/
+
+#include "Precomp.h"
+
+//
+// Define the on-disk TRX and MDB structures and identifiers used to build
+// and scan files.  These mirror the private definitions of TrxFileReader.
+//
+
+#define TRX_HEADER_ID             '2NWN'
+#define TRX_AREA_SURFACE_MESH_ID  'MWSA'
+#define TRX_WIDTH_HEIGHT_ID       'HWRT'
+#define TRX_COMPRESSION_HEADER_ID 'PMOC'
+#define TRX_FILLER_ID             'LLIF'
+#define TRX_ASWM_VERSION          0x6C
+
+#include <pshpack1.h>
+
+typedef struct _TRX_HEADER
+{
+	unsigned long  TrxHeaderId;
+	unsigned short MajorVersion;
+	unsigned short MinorVersion;
+	unsigned long  ResourceCount;
+} TRX_HEADER, * PTRX_HEADER;
+
+C_ASSERT( sizeof( TRX_HEADER ) == 0x0C );
+
+typedef struct _TRX_RESOURCE_ENTRY
+{
+	unsigned long ResourceTypeId;
+	unsigned long Offset;
+} TRX_RESOURCE_ENTRY, * PTRX_RESOURCE_ENTRY;
+
+C_ASSERT( sizeof( TRX_RESOURCE_ENTRY ) == 0x08 );
+
+typedef struct _TRX_RESOURCE_HEADER
+{
+	unsigned long ResourceTypeId;
+	unsigned long Length;
+} TRX_RESOURCE_HEADER, * PTRX_RESOURCE_HEADER;
+
+C_ASSERT( sizeof( TRX_RESOURCE_HEADER ) == 0x08 );
+
+typedef struct _TRX_COMPRESSION_HEADER
+{
+	unsigned long TypeId;
+	unsigned long CompressedSize;
+	unsigned long UncompressedSize;
+} TRX_COMPRESSION_HEADER, * PTRX_COMPRESSION_HEADER;
+
+C_ASSERT( sizeof( TRX_COMPRESSION_HEADER ) == 0x0C );
+
+typedef struct _TRX_TRWH_HEADER
+{
+	unsigned long Width;
+	unsigned long Height;
+	unsigned long IdNumber;
+} TRX_TRWH_HEADER, * PTRX_TRWH_HEADER;
+
+C_ASSERT( sizeof( TRX_TRWH_HEADER ) == 0x0C );
+
+typedef struct _TRX_ASWM_HEADER
+{
+	unsigned long Version;
+	unsigned char Name[ 32 ];
+	unsigned char OwnsData;
+	unsigned long PointCount;
+	unsigned long EdgeCount;
+	unsigned long TriangleCount;
+	unsigned long FaceOffset;
+} TRX_ASWM_HEADER, * PTRX_ASWM_HEADER;
+
+C_ASSERT( sizeof( TRX_ASWM_HEADER ) == 37 + 16 );
+
+#include <poppack.h>
+
+//
+// Define the messages that TrxFileReader raises when the compressed walkmesh
+// block cannot be read or decompressed.
+//
+
+const char * const StreamReadError    = "ReadFile( Compressed walkmesh stream ) failed.";
+const char * const DecompressionError = "Walkmesh decompression failed.";
+
+//
+// Define the input chunk size used by TrxFileReader.
+//
+
+#define STREAM_CHUNK_SIZE (64 * 1024)
+
+//
+// Define the decompression paths that are compared and timed.
+//
+
+typedef enum _DECOMPRESS_PATH
+{
+	PathOneShot,
+	PathVector,
+	PathSpan,
+	PathStream,
+	PathStreamOutput,
+
+	LastDecompressPath
+} DECOMPRESS_PATH, * PDECOMPRESS_PATH;
+
+const char * DecompressPathNames[ LastDecompressPath ] =
+{
+	"uncompress( ) (original)",
+	"Uncompress (vector)",
+	"Uncompress (span)",
+	"UncompressStream (64KB input chunks)",
+	"UncompressStream (output callback)"
+};
+
+//
+// Define the kinds of generated zlib stream.
+//
+
+typedef enum _BLOCK_VARIANT
+{
+	BlockIntact,
+	BlockTrailingData,
+	BlockTruncated,
+	BlockCorrupted,
+	BlockOutputShort,
+	BlockOutputLong,
+
+	LastBlockVariant
+} BLOCK_VARIANT, * PBLOCK_VARIANT;
+
+//
+// Define the kinds of generated TRX file.
+//
+
+typedef enum _TRX_VARIANT
+{
+	TrxIntact,
+	TrxTrailingData,
+	TrxTruncatedStream,
+	TrxTruncatedTail,
+	TrxCorrupted,
+	TrxCorruptedTruncated,
+	TrxUncompressedSizeShort,
+	TrxUncompressedSizeLong,
+
+	LastTrxVariant
+} TRX_VARIANT, * PTRX_VARIANT;
+
+const char * TrxVariantNames[ LastTrxVariant ] =
+{
+	"intact",
+	"trailing data",
+	"truncated stream",
+	"truncated trailing data",
+	"corrupted",
+	"corrupted and truncated",
+	"uncompressed size short",
+	"uncompressed size long"
+};
+
+//
+// Define the context of the decompressor input routine, which hands out a
+// compressed buffer in chunks and can be made to fail.
+//
+
+typedef struct _CHUNK_INPUT_CONTEXT
+{
+	const unsigned char * Data;
+	size_t                Length;
+	size_t                Offset;
+	size_t                ChunkSize;      // Zero for random chunk sizes.
+	size_t                MaxChunkSize;
+	unsigned long         Seed;
+	size_t                FailOffset;     // (size_t) -1 to never fail.
+	bool                  Failed;
+	unsigned long         CallsAfterFailure;
+} CHUNK_INPUT_CONTEXT, * PCHUNK_INPUT_CONTEXT;
+
+//
+// Define the context of the decompressor output routine, which gathers the
+// uncompressed data into a buffer of limited size.
+//
+
+typedef struct _CHUNK_OUTPUT_CONTEXT
+{
+	unsigned char * Plain;
+	size_t          PlainLength;
+	size_t          Written;
+	size_t          LargestChunk;
+} CHUNK_OUTPUT_CONTEXT, * PCHUNK_OUTPUT_CONTEXT;
+
+//
+// Define the time taken by each decompression path over a scan.
+//
+
+typedef struct _PATH_TIMINGS
+{
+	double           Seconds[ LastDecompressPath ];
+	unsigned __int64 CompressedBytes;
+	unsigned __int64 UncompressedBytes;
+} PATH_TIMINGS, * PPATH_TIMINGS;
+
+unsigned long
+NextRandom(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine returns the next value of a simple linear congruential
+	generator, so that the test data is the same on every run.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the next pseudo-random value, in the range 0 to
+	0xFFFFFF.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Seed = Seed * 1103515245 + 12345;
+
+	return (Seed >> 8) & 0xFFFFFF;
+}
+
+void
+FillPayload(
+	__out_bcount( Length ) unsigned char * Payload,
+	__in size_t Length,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine fills a buffer with data to compress.  The data is either
+	incompressible, drawn from a small alphabet, or built from repeats of
+	earlier data, so that stored, literal and match heavy deflate blocks are
+	all produced.
+
+Arguments:
+
+	Payload - Supplies the buffer to fill.
+
+	Length - Supplies the length of the buffer, in bytes.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	unsigned long Mode = NextRandom( Seed ) % 3;
+	size_t        i    = 0;
+
+	while (i < Length)
+	{
+		if ((Mode == 2) && (i >= 16) && (NextRandom( Seed ) % 2))
+		{
+			size_t Distance = 1 + (NextRandom( Seed ) % i);
+			size_t Run      = 3 + (NextRandom( Seed ) % 255);
+
+			for (size_t j = 0; (j < Run) && (i < Length); j += 1, i += 1)
+				Payload[ i ] = Payload[ i - Distance ];
+		}
+		else if (Mode == 0)
+		{
+			Payload[ i++ ] = (unsigned char) NextRandom( Seed );
+		}
+		else
+		{
+			Payload[ i++ ] = (unsigned char) ('a' + (NextRandom( Seed ) % 4));
+		}
+	}
+}
+
+size_t
+GeneratePayloadLength(
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine picks the length of a generated payload.  Most payloads
+	are small, but some span many 64KB input and output chunks.
+
+Arguments:
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	The routine returns the length, of at least one byte.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	switch (NextRandom( Seed ) % 4)
+	{
+
+	case 0:
+		return 1 + (NextRandom( Seed ) % 1024);
+
+	case 1:
+		return 1 + (NextRandom( Seed ) % (2 * STREAM_CHUNK_SIZE));
+
+	case 2:
+		return STREAM_CHUNK_SIZE - 2 + (NextRandom( Seed ) % 5);
+
+	default:
+		return 1 + (NextRandom( Seed ) % (6 * STREAM_CHUNK_SIZE));
+
+	}
+}
+
+void
+CompressPayload(
+	__in const std::vector< unsigned char > & Payload,
+	__out std::vector< unsigned char > & Compressed,
+	__in int Level
+	)
+/*++
+
+Routine Description:
+
+	This routine compresses a payload into a zlib stream.
+
+Arguments:
+
+	Payload - Supplies the data to compress.
+
+	Compressed - Receives the zlib stream.
+
+	Level - Supplies the zlib compression level.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	uLongf CompressedLength;
+
+	CompressedLength = compressBound( (uLong) Payload.size( ) );
+
+	Compressed.resize( CompressedLength );
+
+	if (compress2(
+		&Compressed[ 0 ],
+		&CompressedLength,
+		&Payload[ 0 ],
+		(uLong) Payload.size( ),
+		Level) != Z_OK)
+	{
+		throw std::runtime_error( "compress2 failed." );
+	}
+
+	Compressed.resize( CompressedLength );
+}
+
+bool
+__stdcall
+ReadChunk(
+	__in void * Context,
+	__deref_out_bcount( *Length ) const unsigned char * * Data,
+	__out size_t * Length
+	)
+/*++
+
+Routine Description:
+
+	This routine supplies the decompressor with the next chunk of a
+	compressed buffer, failing once the chunk would include the byte at the
+	configured failure offset.
+
+Arguments:
+
+	Context - Supplies the chunk input context.
+
+	Data - Receives a pointer to the chunk.
+
+	Length - Receives the length of the chunk, or zero at the end of the
+	         buffer.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PCHUNK_INPUT_CONTEXT InputContext;
+	size_t               Transfer;
+
+	InputContext = reinterpret_cast< PCHUNK_INPUT_CONTEXT >( Context );
+
+	if (InputContext->Failed)
+	{
+		InputContext->CallsAfterFailure += 1;
+		return false;
+	}
+
+	if (InputContext->ChunkSize != 0)
+		Transfer = InputContext->ChunkSize;
+	else
+		Transfer = 1 + (NextRandom( InputContext->Seed ) % InputContext->MaxChunkSize);
+
+	Transfer = min( Transfer, InputContext->Length - InputContext->Offset );
+
+	if ((Transfer != 0) &&
+	    (InputContext->Offset + Transfer > InputContext->FailOffset))
+	{
+		InputContext->Failed = true;
+		return false;
+	}
+
+	*Data   = InputContext->Data + InputContext->Offset;
+	*Length = Transfer;
+
+	InputContext->Offset += Transfer;
+
+	return true;
+}
+
+bool
+__stdcall
+WriteChunk(
+	__in void * Context,
+	__in_bcount( Length ) const unsigned char * Data,
+	__in size_t Length
+	)
+/*++
+
+Routine Description:
+
+	This routine consumes the next chunk of uncompressed data, failing if it
+	would not fit in the output buffer.
+
+Arguments:
+
+	Context - Supplies the chunk output context.
+
+	Data - Supplies the chunk.
+
+	Length - Supplies the length of the chunk.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	PCHUNK_OUTPUT_CONTEXT OutputContext;
+
+	OutputContext = reinterpret_cast< PCHUNK_OUTPUT_CONTEXT >( Context );
+
+	if (Length > OutputContext->PlainLength - OutputContext->Written)
+		return false;
+
+	memcpy( OutputContext->Plain + OutputContext->Written, Data, Length );
+
+	OutputContext->Written      += Length;
+	OutputContext->LargestChunk  = max( OutputContext->LargestChunk, Length );
+
+	return true;
+}
+
+void
+InitializeInput(
+	__out CHUNK_INPUT_CONTEXT & InputContext,
+	__in_bcount( Length ) const unsigned char * Data,
+	__in size_t Length,
+	__in size_t ChunkSize,
+	__in size_t MaxChunkSize,
+	__in unsigned long Seed,
+	__in size_t FailOffset
+	)
+/*++
+
+Routine Description:
+
+	This routine initializes a chunk input context.
+
+Arguments:
+
+	InputContext - Supplies the context to initialize.
+
+	Data - Supplies the compressed buffer.
+
+	Length - Supplies the length of the compressed buffer, in bytes.
+
+	ChunkSize - Supplies the chunk size, or zero for random chunk sizes.
+
+	MaxChunkSize - Supplies the largest random chunk size.
+
+	Seed - Supplies the initial generator state for random chunk sizes.
+
+	FailOffset - Supplies the offset from which chunk requests fail, or
+	             (size_t) -1 to never fail.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	InputContext.Data              = Data;
+	InputContext.Length            = Length;
+	InputContext.Offset            = 0;
+	InputContext.ChunkSize         = ChunkSize;
+	InputContext.MaxChunkSize      = MaxChunkSize;
+	InputContext.Seed              = Seed;
+	InputContext.FailOffset        = FailOffset;
+	InputContext.Failed            = false;
+	InputContext.CallsAfterFailure = 0;
+}
+
+bool
+RunPath(
+	__in DECOMPRESS_PATH Path,
+	__in_bcount( Length ) const unsigned char * Data,
+	__in size_t Length,
+	__inout std::vector< unsigned char > & Plain,
+	__in size_t PlainLength,
+	__out size_t & PlainWritten
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses a buffer through one decompression path.
+
+Arguments:
+
+	Path - Supplies the path to use.
+
+	Data - Supplies the compressed buffer.
+
+	Length - Supplies the length of the compressed buffer, in bytes.
+
+	Plain - Receives the uncompressed data.  For the vector path, the
+	        vector is resized to the uncompressed length on success.
+
+	PlainLength - Supplies the space available for uncompressed data.
+
+	PlainWritten - Receives the count of uncompressed bytes written.
+
+Return Value:
+
+	A Boolean value indicating true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NWN::Compressor      Compressor;
+	CHUNK_INPUT_CONTEXT  InputContext;
+	CHUNK_OUTPUT_CONTEXT OutputContext;
+	uLongf               OneShotLength;
+	bool                 Status;
+
+	Plain.resize( PlainLength );
+
+	PlainWritten = 0;
+
+	switch (Path)
+	{
+
+	case PathOneShot:
+		//
+		// This is the body of the original Compressor::Uncompress.
+		//
+
+		OneShotLength = (uLongf) PlainLength;
+
+		if (uncompress(
+			&Plain[ 0 ],
+			&OneShotLength,
+			Data,
+			(uLong) Length) != Z_OK)
+		{
+			return false;
+		}
+
+		PlainWritten = OneShotLength;
+		return true;
+
+	case PathVector:
+		if (!Compressor.Uncompress( Data, Length, Plain ))
+			return false;
+
+		PlainWritten = Plain.size( );
+		return true;
+
+	case PathSpan:
+		return Compressor.Uncompress(
+			Data,
+			Length,
+			&Plain[ 0 ],
+			PlainLength,
+			PlainWritten);
+
+	case PathStream:
+		InitializeInput(
+			InputContext,
+			Data,
+			Length,
+			STREAM_CHUNK_SIZE,
+			STREAM_CHUNK_SIZE,
+			0,
+			(size_t) -1);
+
+		return Compressor.UncompressStream(
+			ReadChunk,
+			&InputContext,
+			&Plain[ 0 ],
+			PlainLength,
+			PlainWritten);
+
+	case PathStreamOutput:
+		InitializeInput(
+			InputContext,
+			Data,
+			Length,
+			STREAM_CHUNK_SIZE,
+			STREAM_CHUNK_SIZE,
+			0,
+			(size_t) -1);
+
+		OutputContext.Plain        = &Plain[ 0 ];
+		OutputContext.PlainLength  = PlainLength;
+		OutputContext.Written      = 0;
+		OutputContext.LargestChunk = 0;
+
+		Status = Compressor.UncompressStream(
+			ReadChunk,
+			&InputContext,
+			WriteChunk,
+			&OutputContext,
+			&PlainWritten);
+
+		if ((Status) && (PlainWritten != OutputContext.Written))
+			return false;
+
+		return Status;
+
+	}
+
+	return false;
+}
+
+bool
+MatchesReference(
+	__in bool Status,
+	__in const std::vector< unsigned char > & Plain,
+	__in size_t PlainWritten,
+	__in bool ReferenceStatus,
+	__in const std::vector< unsigned char > & ReferencePlain,
+	__in size_t ReferenceWritten
+	)
+/*++
+
+Routine Description:
+
+	This routine compares the outcome of a decompression path with that of
+	the original one-shot path.
+
+Arguments:
+
+	Status - Supplies the outcome of the path under test.
+
+	Plain - Supplies the uncompressed data of the path under test.
+
+	PlainWritten - Supplies the uncompressed length of the path under test.
+
+	ReferenceStatus - Supplies the outcome of the original path.
+
+	ReferencePlain - Supplies the uncompressed data of the original path.
+
+	ReferenceWritten - Supplies the uncompressed length of the original
+	                   path.
+
+Return Value:
+
+	The routine returns true if the outcomes match, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	if (Status != ReferenceStatus)
+		return false;
+
+	if (!Status)
+		return true;
+
+	if (PlainWritten != ReferenceWritten)
+		return false;
+
+	return (PlainWritten == 0) ||
+	       (memcmp( &Plain[ 0 ], &ReferencePlain[ 0 ], PlainWritten ) == 0);
+}
+
+unsigned long
+CheckBlock(
+	__in const char * Description,
+	__in_bcount( Length ) const unsigned char * Data,
+	__in size_t Length,
+	__in size_t PlainLength,
+	__in size_t StreamLength,
+	__inout unsigned long & Seed,
+	__inout unsigned long & Mismatches,
+	__inout_opt PPATH_TIMINGS Timings,
+	__in unsigned long Iterations
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses a buffer through every decompression path,
+	and through the streaming path with random input chunk sizes and with
+	an input failure injected, and compares each outcome with that of the
+	original one-shot path.
+
+Arguments:
+
+	Description - Supplies a description of the buffer for mismatch
+	              reports.
+
+	Data - Supplies the compressed buffer.
+
+	Length - Supplies the length of the compressed buffer, in bytes.
+
+	PlainLength - Supplies the space available for uncompressed data.
+
+	StreamLength - Supplies the length of the zlib stream at the start of
+	               the buffer if known, else zero.  Input that fails before
+	               the end of the stream must fail decompression.
+
+	Seed - Supplies the generator state, which is updated.
+
+	Mismatches - Supplies the count of mismatches, which is updated.
+
+	Timings - Optionally supplies the timings to add the time taken by each
+	          path to.
+
+	Iterations - Supplies the number of times that each path is timed.
+
+Return Value:
+
+	The routine returns the number of cases checked.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	NWN::Compressor              Compressor;
+	std::vector< unsigned char > ReferencePlain;
+	std::vector< unsigned char > Plain;
+	size_t                       ReferenceWritten;
+	size_t                       PlainWritten;
+	bool                         ReferenceStatus;
+	bool                         Status;
+	unsigned long                Cases;
+
+	Cases           = 0;
+	Status          = false;
+	PlainWritten    = 0;
+	ReferenceStatus = RunPath(
+		PathOneShot,
+		Data,
+		Length,
+		ReferencePlain,
+		PlainLength,
+		ReferenceWritten);
+
+	for (int Path = 0; Path < LastDecompressPath; Path += 1)
+	{
+		LARGE_INTEGER Start;
+		LARGE_INTEGER End;
+		LARGE_INTEGER Frequency;
+
+		QueryPerformanceFrequency( &Frequency );
+		QueryPerformanceCounter( &Start );
+
+		for (unsigned long i = 0; i < Iterations; i += 1)
+		{
+			Status = RunPath(
+				(DECOMPRESS_PATH) Path,
+				Data,
+				Length,
+				Plain,
+				PlainLength,
+				PlainWritten);
+		}
+
+		QueryPerformanceCounter( &End );
+
+		if (Timings != NULL)
+		{
+			Timings->Seconds[ Path ] +=
+				(double) (End.QuadPart - Start.QuadPart) / (double) Frequency.QuadPart;
+		}
+
+		Cases += 1;
+
+		if (!MatchesReference(
+			Status,
+			Plain,
+			PlainWritten,
+			ReferenceStatus,
+			ReferencePlain,
+			ReferenceWritten))
+		{
+			if (Mismatches++ < 16)
+			{
+				printf(
+					"MISMATCH: %s: %s %s, original %s.\n",
+					Description,
+					DecompressPathNames[ Path ],
+					Status ? "succeeded" : "failed",
+					ReferenceStatus ? "succeeded" : "failed");
+			}
+		}
+	}
+
+	if (Timings != NULL)
+	{
+		Timings->CompressedBytes   += Length;
+		Timings->UncompressedBytes += ReferenceWritten;
+	}
+
+	//
+	// Stream the input in chunks of random size, from one byte up, so that
+	// zlib is handed partial chunks at every position.
+	//
+
+	for (int Pass = 0; Pass < 2; Pass += 1)
+	{
+		CHUNK_INPUT_CONTEXT InputContext;
+		size_t              MaxChunkSize;
+
+		MaxChunkSize = (Pass == 0) ? 2 * STREAM_CHUNK_SIZE : 64;
+
+		if ((Pass == 1) && (Length > 64 * 1024))
+			MaxChunkSize = 4096;
+
+		InitializeInput(
+			InputContext,
+			Data,
+			Length,
+			0,
+			MaxChunkSize,
+			NextRandom( Seed ),
+			(size_t) -1);
+
+		Plain.resize( PlainLength );
+
+		Status = Compressor.UncompressStream(
+			ReadChunk,
+			&InputContext,
+			&Plain[ 0 ],
+			PlainLength,
+			PlainWritten);
+
+		Cases += 1;
+
+		if (!MatchesReference(
+			Status,
+			Plain,
+			PlainWritten,
+			ReferenceStatus,
+			ReferencePlain,
+			ReferenceWritten))
+		{
+			if (Mismatches++ < 16)
+			{
+				printf(
+					"MISMATCH: %s: UncompressStream with random chunks of up to %lu bytes %s, original %s.\n",
+					Description,
+					(unsigned long) MaxChunkSize,
+					Status ? "succeeded" : "failed",
+					ReferenceStatus ? "succeeded" : "failed");
+			}
+		}
+	}
+
+	//
+	// Fail the input part of the way through.  The decompressor must give up
+	// without asking for more input, and must fail if the stream was not yet
+	// complete.  If it finished regardless, the result must still be right.
+	//
+
+	if (Length != 0)
+	{
+		CHUNK_INPUT_CONTEXT InputContext;
+		size_t              FailOffset;
+		bool                Matched;
+
+		FailOffset = NextRandom( Seed ) % Length;
+
+		InitializeInput(
+			InputContext,
+			Data,
+			Length,
+			0,
+			STREAM_CHUNK_SIZE,
+			NextRandom( Seed ),
+			FailOffset);
+
+		Plain.resize( PlainLength );
+
+		Status = Compressor.UncompressStream(
+			ReadChunk,
+			&InputContext,
+			&Plain[ 0 ],
+			PlainLength,
+			PlainWritten);
+
+		Cases += 1;
+
+		if (InputContext.CallsAfterFailure != 0)
+			Matched = false;
+		else if (!Status)
+			Matched = true;
+		else if ((StreamLength != 0) && (FailOffset < StreamLength))
+			Matched = false;
+		else
+			Matched = MatchesReference(
+				Status,
+				Plain,
+				PlainWritten,
+				ReferenceStatus,
+				ReferencePlain,
+				ReferenceWritten);
+
+		if (!Matched)
+		{
+			if (Mismatches++ < 16)
+			{
+				printf(
+					"MISMATCH: %s: UncompressStream with input failing at offset %lu %s (%lu further input calls).\n",
+					Description,
+					(unsigned long) FailOffset,
+					Status ? "succeeded" : "failed",
+					InputContext.CallsAfterFailure);
+			}
+		}
+	}
+
+	return Cases;
+}
+
+bool
+CheckCompressor(
+	__in unsigned long Count,
+	__in unsigned long Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine checks every decompression path against the original
+	one-shot path with generated zlib streams.
+
+Arguments:
+
+	Count - Supplies the number of streams to generate.
+
+	Seed - Supplies the initial generator state.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Payload;
+	std::vector< unsigned char > Compressed;
+	unsigned long                Cases;
+	unsigned long                Mismatches;
+
+	Cases      = 0;
+	Mismatches = 0;
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		BLOCK_VARIANT Variant;
+		size_t        PlainLength;
+		size_t        StreamLength;
+		char          Description[ 64 ];
+
+		Variant = (BLOCK_VARIANT) (i % LastBlockVariant);
+
+		Payload.resize( GeneratePayloadLength( Seed ) );
+		FillPayload( &Payload[ 0 ], Payload.size( ), Seed );
+		CompressPayload( Payload, Compressed, (int) (NextRandom( Seed ) % 10) );
+
+		PlainLength  = Payload.size( );
+		StreamLength = Compressed.size( );
+
+		switch (Variant)
+		{
+
+		case BlockTrailingData:
+			{
+				size_t Trailing = 1 + (NextRandom( Seed ) % (STREAM_CHUNK_SIZE + 16));
+
+				for (size_t j = 0; j < Trailing; j += 1)
+					Compressed.push_back( (unsigned char) NextRandom( Seed ) );
+			}
+			break;
+
+		case BlockTruncated:
+			Compressed.resize( NextRandom( Seed ) % Compressed.size( ) );
+			break;
+
+		case BlockCorrupted:
+			{
+				size_t Offset = NextRandom( Seed ) % Compressed.size( );
+
+				Compressed[ Offset ] = (unsigned char) (Compressed[ Offset ] ^ (1 + (NextRandom( Seed ) % 255)));
+				StreamLength         = 0;
+			}
+			break;
+
+		case BlockOutputShort:
+			if (PlainLength > 1)
+				PlainLength -= 1 + (NextRandom( Seed ) % (PlainLength - 1));
+			break;
+
+		case BlockOutputLong:
+			PlainLength += 1 + (NextRandom( Seed ) % STREAM_CHUNK_SIZE);
+			break;
+
+		default:
+			break;
+
+		}
+
+		//
+		// A truncated stream still has at least one byte so that the span is
+		// never empty.
+		//
+
+		if (Compressed.empty( ))
+			Compressed.push_back( 0x78 );
+
+		StringCbPrintfA(
+			Description,
+			sizeof( Description ),
+			"stream %lu",
+			i);
+
+		Cases += CheckBlock(
+			Description,
+			&Compressed[ 0 ],
+			Compressed.size( ),
+			PlainLength,
+			StreamLength,
+			Seed,
+			Mismatches,
+			NULL,
+			1);
+	}
+
+	printf(
+		"Compressor check: %lu streams, %lu cases, %lu mismatch(es).\n",
+		Count,
+		Cases,
+		Mismatches);
+
+	return (Mismatches == 0);
+}
+
+void
+AppendBytes(
+	__inout std::vector< unsigned char > & Buffer,
+	__in_bcount( Length ) const void * Data,
+	__in size_t Length
+	)
+/*++
+
+Routine Description:
+
+	This routine appends raw bytes to a buffer.
+
+Arguments:
+
+	Buffer - Supplies the buffer to append to.
+
+	Data - Supplies the bytes to append.
+
+	Length - Supplies the count of bytes to append.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Buffer.insert(
+		Buffer.end( ),
+		(const unsigned char *) Data,
+		(const unsigned char *) Data + Length);
+}
+
+void
+BuildTrxFile(
+	__in TRX_VARIANT Variant,
+	__out std::vector< unsigned char > & File,
+	__out size_t & BlockOffset,
+	__out TRX_COMPRESSION_HEADER & CompressHeader,
+	__out TRX_TRWH_HEADER & WidthHeight,
+	__out unsigned long & Flags,
+	__out float & TileSize,
+	__inout unsigned long & Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine builds a TRX file holding an area width/height resource, a
+	resource of a type that the reader skips, and a compressed area surface
+	walkmesh.  The walkmesh has no points, faces or tiles, and is followed
+	by padding so that the compressed block spans one or more 64KB input
+	chunks.
+
+	The skipped resource is at least as long as the compressed block, so
+	that a file cut short within the block still passes the reader's check
+	that each resource starts within the file and goes on to the
+	decompression stage.
+
+Arguments:
+
+	Variant - Supplies the kind of file to build.
+
+	File - Receives the file contents.
+
+	BlockOffset - Receives the file offset of the compressed block.
+
+	CompressHeader - Receives the compression header of the walkmesh.
+
+	WidthHeight - Receives the area width/height resource.
+
+	Flags - Receives the walkmesh flags.
+
+	TileSize - Receives the walkmesh tile size.
+
+	Seed - Supplies the generator state, which is updated.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Walkmesh;
+	std::vector< unsigned char > Compressed;
+	TRX_ASWM_HEADER              AswmHeader;
+	TRX_HEADER                   FileHeader;
+	TRX_RESOURCE_ENTRY           Entry;
+	TRX_RESOURCE_HEADER          ResHeader;
+	unsigned long                u;
+	size_t                       Padding;
+	size_t                       StreamLength;
+	size_t                       FillerLength;
+
+	//
+	// Build and compress the walkmesh.
+	//
+
+	ZeroMemory( &AswmHeader, sizeof( AswmHeader ) );
+
+	AswmHeader.Version  = TRX_ASWM_VERSION;
+	AswmHeader.OwnsData = 1;
+
+	Flags    = NextRandom( Seed );
+	TileSize = (float) (1 + (NextRandom( Seed ) % 64));
+
+	AppendBytes( Walkmesh, &AswmHeader, sizeof( AswmHeader ) );
+	AppendBytes( Walkmesh, &Flags, sizeof( Flags ) );
+	AppendBytes( Walkmesh, &TileSize, sizeof( TileSize ) );
+
+	u = 0;
+
+	AppendBytes( Walkmesh, &u, sizeof( u ) );        // TileGridHeight
+	AppendBytes( Walkmesh, &u, sizeof( u ) );        // TileGridWidth
+	AppendBytes( Walkmesh, &u, sizeof( u ) );        // TileBorderSize
+	AppendBytes( Walkmesh, &u, sizeof( u ) );        // IslandCount
+
+	Padding = (NextRandom( Seed ) % 2)
+		? NextRandom( Seed ) % 1024
+		: NextRandom( Seed ) % (4 * STREAM_CHUNK_SIZE);
+
+	//
+	// A corrupted and truncated block must span more than one input chunk,
+	// so that the corruption is seen before the read that fails.  Random
+	// padding does not compress, which guarantees that.
+	//
+
+	if (Variant == TrxCorruptedTruncated)
+		Padding = 2 * STREAM_CHUNK_SIZE + (NextRandom( Seed ) % STREAM_CHUNK_SIZE);
+
+	if (Padding != 0)
+	{
+		size_t HeaderLength = Walkmesh.size( );
+
+		Walkmesh.resize( HeaderLength + Padding );
+
+		if (Variant == TrxCorruptedTruncated)
+		{
+			for (size_t i = HeaderLength; i < Walkmesh.size( ); i += 1)
+				Walkmesh[ i ] = (unsigned char) NextRandom( Seed );
+		}
+		else
+		{
+			FillPayload( &Walkmesh[ HeaderLength ], Padding, Seed );
+		}
+	}
+
+	CompressPayload( Walkmesh, Compressed, (int) (NextRandom( Seed ) % 10) );
+
+	StreamLength = Compressed.size( );
+
+	CompressHeader.TypeId           = TRX_COMPRESSION_HEADER_ID;
+	CompressHeader.UncompressedSize = (unsigned long) Walkmesh.size( );
+
+	switch (Variant)
+	{
+
+	case TrxTrailingData:
+	case TrxTruncatedTail:
+		{
+			size_t Trailing;
+
+			Trailing = (NextRandom( Seed ) % 2)
+				? 1 + (NextRandom( Seed ) % 64)
+				: 1 + (NextRandom( Seed ) % (2 * STREAM_CHUNK_SIZE));
+
+			for (size_t i = 0; i < Trailing; i += 1)
+				Compressed.push_back( (unsigned char) NextRandom( Seed ) );
+		}
+		break;
+
+	case TrxCorrupted:
+		{
+			size_t Offset = NextRandom( Seed ) % (StreamLength / 2 + 1);
+
+			Compressed[ Offset ] = (unsigned char) (Compressed[ Offset ] ^ (1 + (NextRandom( Seed ) % 255)));
+		}
+		break;
+
+	case TrxCorruptedTruncated:
+		//
+		// Corrupt the zlib header check bits, which zlib rejects as soon as
+		// it sees them, rather than at the end of the stream.
+		//
+
+		Compressed[ 1 ] = (unsigned char) (Compressed[ 1 ] ^ (1 + (NextRandom( Seed ) % 31)));
+		break;
+
+	case TrxUncompressedSizeShort:
+		//
+		// Keep enough room for the walkmesh header so that the reader goes on
+		// to decompress the block.
+		//
+
+		CompressHeader.UncompressedSize -=
+			1 + (NextRandom( Seed ) % (CompressHeader.UncompressedSize - sizeof( TRX_ASWM_HEADER )));
+		break;
+
+	case TrxUncompressedSizeLong:
+		CompressHeader.UncompressedSize += 1 + (NextRandom( Seed ) % STREAM_CHUNK_SIZE);
+		break;
+
+	default:
+		break;
+
+	}
+
+	CompressHeader.CompressedSize = (unsigned long) Compressed.size( );
+
+	//
+	// Lay out the file: the header, the resource directory, the width/height
+	// resource, the skipped resource and then the walkmesh resource.
+	//
+
+	FillerLength = Compressed.size( ) + (NextRandom( Seed ) % 64);
+
+	FileHeader.TrxHeaderId   = TRX_HEADER_ID;
+	FileHeader.MajorVersion  = 2;
+	FileHeader.MinorVersion  = 3;
+	FileHeader.ResourceCount = 3;
+
+	File.clear( );
+
+	AppendBytes( File, &FileHeader, sizeof( FileHeader ) );
+
+	Entry.ResourceTypeId = TRX_WIDTH_HEIGHT_ID;
+	Entry.Offset         = (unsigned long) (sizeof( FileHeader ) + 3 * sizeof( Entry ));
+
+	AppendBytes( File, &Entry, sizeof( Entry ) );
+
+	Entry.ResourceTypeId = TRX_FILLER_ID;
+	Entry.Offset        += (unsigned long) (sizeof( ResHeader ) + sizeof( WidthHeight ));
+
+	AppendBytes( File, &Entry, sizeof( Entry ) );
+
+	Entry.ResourceTypeId = TRX_AREA_SURFACE_MESH_ID;
+	Entry.Offset        += (unsigned long) (sizeof( ResHeader ) + FillerLength);
+
+	AppendBytes( File, &Entry, sizeof( Entry ) );
+
+	WidthHeight.Width    = 1 + (NextRandom( Seed ) % 32);
+	WidthHeight.Height   = 1 + (NextRandom( Seed ) % 32);
+	WidthHeight.IdNumber = NextRandom( Seed );
+
+	ResHeader.ResourceTypeId = TRX_WIDTH_HEIGHT_ID;
+	ResHeader.Length         = sizeof( WidthHeight );
+
+	AppendBytes( File, &ResHeader, sizeof( ResHeader ) );
+	AppendBytes( File, &WidthHeight, sizeof( WidthHeight ) );
+
+	ResHeader.ResourceTypeId = TRX_FILLER_ID;
+	ResHeader.Length         = (unsigned long) FillerLength;
+
+	AppendBytes( File, &ResHeader, sizeof( ResHeader ) );
+
+	for (size_t i = 0; i < FillerLength; i += 1)
+		File.push_back( (unsigned char) NextRandom( Seed ) );
+
+	ResHeader.ResourceTypeId = TRX_AREA_SURFACE_MESH_ID;
+	ResHeader.Length         = (unsigned long) (sizeof( CompressHeader ) + Compressed.size( ));
+
+	AppendBytes( File, &ResHeader, sizeof( ResHeader ) );
+	AppendBytes( File, &CompressHeader, sizeof( CompressHeader ) );
+
+	BlockOffset = File.size( );
+
+	AppendBytes( File, &Compressed[ 0 ], Compressed.size( ) );
+
+	//
+	// Cut the file short within the zlib stream or within the data that
+	// trails it.
+	//
+
+	switch (Variant)
+	{
+
+	case TrxTruncatedStream:
+		File.resize( BlockOffset + (NextRandom( Seed ) % StreamLength) );
+		break;
+
+	case TrxCorruptedTruncated:
+		//
+		// Keep the first input chunk whole, so that zlib is handed the
+		// corrupted header before a read fails.
+		//
+
+		File.resize(
+			BlockOffset +
+			STREAM_CHUNK_SIZE +
+			(NextRandom( Seed ) % (StreamLength - STREAM_CHUNK_SIZE)));
+		break;
+
+	case TrxTruncatedTail:
+		File.resize(
+			BlockOffset +
+			StreamLength +
+			(NextRandom( Seed ) % (Compressed.size( ) - StreamLength)));
+		break;
+
+	default:
+		break;
+
+	}
+}
+
+std::string
+GetOriginalTrxOutcome(
+	__in const std::vector< unsigned char > & File,
+	__in size_t BlockOffset,
+	__in const TRX_COMPRESSION_HEADER & CompressHeader
+	)
+/*++
+
+Routine Description:
+
+	This routine determines how the original TrxFileReader handled the
+	compressed walkmesh block of a file.  The original reader checked that
+	the walkmesh resource did not extend beyond the end of the file by more
+	than its own offset, read the whole compressed block and then
+	decompressed it with uncompress( ).
+
+Arguments:
+
+	File - Supplies the file contents.
+
+	BlockOffset - Supplies the file offset of the compressed block.
+
+	CompressHeader - Supplies the compression header of the block.
+
+Return Value:
+
+	The routine returns the message of the exception that the original
+	reader raised, or an empty string if the block was decompressed.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > Plain;
+	size_t                       PlainWritten;
+	size_t                       ResourceOffset;
+	size_t                       ResourceLength;
+
+	ResourceOffset = BlockOffset - sizeof( TRX_RESOURCE_HEADER ) - sizeof( CompressHeader );
+	ResourceLength = sizeof( CompressHeader ) + CompressHeader.CompressedSize;
+
+	if (ResourceLength > ResourceOffset + File.size( ))
+		return "Resource extends beyond end of file.";
+
+	if (File.size( ) - BlockOffset < CompressHeader.CompressedSize)
+		return StreamReadError;
+
+	if (!RunPath(
+		PathOneShot,
+		&File[ BlockOffset ],
+		CompressHeader.CompressedSize,
+		Plain,
+		CompressHeader.UncompressedSize,
+		PlainWritten))
+	{
+		return DecompressionError;
+	}
+
+	return "";
+}
+
+bool
+CheckTrxReader(
+	__in const std::string & FileName,
+	__in unsigned long Count,
+	__in unsigned long Seed
+	)
+/*++
+
+Routine Description:
+
+	This routine loads generated TRX files with TrxFileReader, and compares
+	the outcome with that of the original reader.  Files that load must
+	also yield the area dimensions and walkmesh settings that were stored.
+
+Arguments:
+
+	FileName - Supplies the name of the file to write each TRX file to.
+
+	Count - Supplies the number of files to generate.
+
+	Seed - Supplies the initial generator state.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	MeshManager                  MeshMgr;
+	std::vector< unsigned char > File;
+	unsigned long                Mismatches;
+	unsigned long                Loaded;
+
+	Mismatches = 0;
+	Loaded     = 0;
+
+	for (unsigned long i = 0; i < Count; i += 1)
+	{
+		TRX_VARIANT            Variant;
+		TRX_COMPRESSION_HEADER CompressHeader;
+		TRX_TRWH_HEADER        WidthHeight;
+		size_t                 BlockOffset;
+		unsigned long          Flags;
+		float                  TileSize;
+		std::string            Expected;
+		std::string            Actual;
+		bool                   Matched;
+		FILE                 * f;
+
+		Variant = (TRX_VARIANT) (i % LastTrxVariant);
+
+		BuildTrxFile(
+			Variant,
+			File,
+			BlockOffset,
+			CompressHeader,
+			WidthHeight,
+			Flags,
+			TileSize,
+			Seed);
+
+		Expected = GetOriginalTrxOutcome( File, BlockOffset, CompressHeader );
+
+		f = fopen( FileName.c_str( ), "wb" );
+
+		if (f == NULL)
+			throw std::runtime_error( "Failed to create the TRX file." );
+
+		if (fwrite( &File[ 0 ], File.size( ), 1, f ) != 1)
+		{
+			fclose( f );
+			throw std::runtime_error( "Failed to write the TRX file." );
+		}
+
+		fclose( f );
+
+		Matched = true;
+
+		try
+		{
+			TrxFileReader Reader(
+				MeshMgr,
+				FileName,
+				false,
+				TrxFileReader::ModeTRX);
+
+			Loaded += 1;
+
+			if ((Reader.GetWidth( ) != WidthHeight.Width)                 ||
+			    (Reader.GetHeight( ) != WidthHeight.Height)               ||
+			    (Reader.GetSurfaceMesh( ).GetFlags( ) != Flags)           ||
+			    (Reader.GetSurfaceMesh( ).GetTileSize( ) != TileSize))
+			{
+				Matched = false;
+			}
+		}
+		catch (std::exception &e)
+		{
+			Actual = e.what( );
+		}
+
+		if (Actual != Expected)
+			Matched = false;
+
+		if (!Matched)
+		{
+			if (Mismatches++ < 16)
+			{
+				printf(
+					"MISMATCH: TRX file %lu (%s, %lu of %lu compressed bytes present): '%s', original '%s'.\n",
+					i,
+					TrxVariantNames[ Variant ],
+					(unsigned long) (File.size( ) - BlockOffset),
+					CompressHeader.CompressedSize,
+					Actual.empty( ) ? "loaded" : Actual.c_str( ),
+					Expected.empty( ) ? "loaded" : Expected.c_str( ));
+			}
+		}
+	}
+
+	printf(
+		"TrxFileReader check: %lu files, %lu loaded, %lu mismatch(es).\n",
+		Count,
+		Loaded,
+		Mismatches);
+
+	return (Mismatches == 0);
+}
+
+bool
+ReadWholeFile(
+	__in const std::string & FileName,
+	__out std::vector< unsigned char > & File
+	)
+/*++
+
+Routine Description:
+
+	This routine reads the contents of a file.
+
+Arguments:
+
+	FileName - Supplies the name of the file.
+
+	File - Receives the file contents.
+
+Return Value:
+
+	The routine returns true on success, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE * f;
+	long   Size;
+	bool   Status;
+
+	f = fopen( FileName.c_str( ), "rb" );
+
+	if (f == NULL)
+		return false;
+
+	Status = false;
+	Size   = -1;
+
+	if (fseek( f, 0, SEEK_END ) == 0)
+		Size = ftell( f );
+
+	if ((Size >= 0) && (fseek( f, 0, SEEK_SET ) == 0))
+	{
+		File.resize( (size_t) Size );
+
+		Status = (Size == 0) ||
+		         (fread( &File[ 0 ], File.size( ), 1, f ) == 1);
+	}
+
+	fclose( f );
+
+	return Status;
+}
+
+bool
+ScanFile(
+	__in const std::string & FileName,
+	__in unsigned long Iterations,
+	__inout MeshManager & MeshMgr,
+	__inout PATH_TIMINGS & Timings,
+	__inout unsigned long & Blocks,
+	__inout unsigned long & Mismatches
+	)
+/*++
+
+Routine Description:
+
+	This routine decompresses every compressed packet of a TRX or MDB file
+	through every decompression path, comparing and timing each, and then
+	loads the file with TrxFileReader.
+
+Arguments:
+
+	FileName - Supplies the name of the file.
+
+	Iterations - Supplies the number of times that each path is timed.
+
+	MeshMgr - Supplies the mesh manager for TrxFileReader.
+
+	Timings - Supplies the timings to add the time taken by each path to.
+
+	Blocks - Supplies the count of compressed packets, which is updated.
+
+	Mismatches - Supplies the count of mismatches, which is updated.
+
+Return Value:
+
+	The routine returns true if the file was scanned, else false if it could
+	not be read or is not a TRX or MDB file.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< unsigned char > File;
+	TRX_HEADER                   FileHeader;
+	bool                         Mdb;
+	bool                         Decompressed;
+	unsigned long                Seed;
+
+	if (!ReadWholeFile( FileName, File ))
+	{
+		printf( "WARNING: Failed to read '%s'.\n", FileName.c_str( ) );
+		return false;
+	}
+
+	if (File.size( ) >= sizeof( FileHeader ))
+		memcpy( &FileHeader, &File[ 0 ], sizeof( FileHeader ) );
+	else
+		ZeroMemory( &FileHeader, sizeof( FileHeader ) );
+
+	if ((FileHeader.TrxHeaderId != TRX_HEADER_ID) ||
+	    (FileHeader.ResourceCount > (File.size( ) - sizeof( FileHeader )) / sizeof( TRX_RESOURCE_ENTRY )))
+	{
+		printf( "WARNING: '%s' is not a TRX or MDB file.\n", FileName.c_str( ) );
+		return false;
+	}
+
+	Mdb          = (FileName.size( ) >= 4) &&
+	               (!_stricmp( FileName.c_str( ) + FileName.size( ) - 4, ".mdb" ));
+	Decompressed = true;
+	Seed         = 1;
+
+	for (unsigned long i = 0; i < FileHeader.ResourceCount; i += 1)
+	{
+		TRX_RESOURCE_ENTRY           Entry;
+		TRX_COMPRESSION_HEADER       CompressHeader;
+		size_t                       BlockOffset;
+		std::vector< unsigned char > Plain;
+		size_t                       PlainWritten;
+		char                         Description[ MAX_PATH + 64 ];
+
+		memcpy(
+			&Entry,
+			&File[ sizeof( FileHeader ) + i * sizeof( Entry ) ],
+			sizeof( Entry ));
+
+		BlockOffset = (size_t) Entry.Offset + sizeof( TRX_RESOURCE_HEADER ) + sizeof( CompressHeader );
+
+		if ((Entry.Offset >= File.size( )) || (BlockOffset > File.size( )))
+			continue;
+
+		memcpy(
+			&CompressHeader,
+			&File[ BlockOffset - sizeof( CompressHeader ) ],
+			sizeof( CompressHeader ));
+
+		if (CompressHeader.TypeId != TRX_COMPRESSION_HEADER_ID)
+			continue;
+
+		if ((CompressHeader.CompressedSize == 0)   ||
+		    (CompressHeader.UncompressedSize == 0) ||
+		    (CompressHeader.CompressedSize > File.size( ) - BlockOffset))
+		{
+			printf(
+				"WARNING: '%s' packet %lu has a bad compression header.\n",
+				FileName.c_str( ),
+				i);
+			continue;
+		}
+
+		StringCbPrintfA(
+			Description,
+			sizeof( Description ),
+			"%s packet %lu",
+			FileName.c_str( ),
+			i);
+
+		Blocks += 1;
+
+		CheckBlock(
+			Description,
+			&File[ BlockOffset ],
+			CompressHeader.CompressedSize,
+			CompressHeader.UncompressedSize,
+			0,
+			Seed,
+			Mismatches,
+			&Timings,
+			Iterations);
+
+		if (!RunPath(
+			PathOneShot,
+			&File[ BlockOffset ],
+			CompressHeader.CompressedSize,
+			Plain,
+			CompressHeader.UncompressedSize,
+			PlainWritten))
+		{
+			Decompressed = false;
+		}
+	}
+
+	//
+	// Load the file.  If every packet decompressed with the original path,
+	// the load must not fail in the compressed walkmesh stage.
+	//
+
+	try
+	{
+		TrxFileReader Reader(
+			MeshMgr,
+			FileName,
+			false,
+			Mdb ? TrxFileReader::ModeMDB : TrxFileReader::ModeTRX);
+	}
+	catch (std::exception &e)
+	{
+		if ((Decompressed) &&
+		    ((!strcmp( e.what( ), StreamReadError )) ||
+		     (!strcmp( e.what( ), DecompressionError ))))
+		{
+			if (Mismatches++ < 16)
+			{
+				printf(
+					"MISMATCH: %s: TrxFileReader raised '%s'.\n",
+					FileName.c_str( ),
+					e.what( ));
+			}
+		}
+		else
+		{
+			printf(
+				"WARNING: %s: TrxFileReader raised '%s'.\n",
+				FileName.c_str( ),
+				e.what( ));
+		}
+	}
+
+	return true;
+}
+
+bool
+ScanFiles(
+	__in const std::vector< std::string > & Paths,
+	__in unsigned long Iterations
+	)
+/*++
+
+Routine Description:
+
+	This routine scans a set of TRX and MDB files, and reports the time
+	taken by each decompression path.
+
+Arguments:
+
+	Paths - Supplies the files to scan.  A directory stands for every TRX
+	        and MDB file in it.
+
+	Iterations - Supplies the number of times that each path is timed.
+
+Return Value:
+
+	The routine returns true if every check passed, else false.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char * Extensions[ ] = { "*.trx", "*.mdb" };
+
+	MeshManager                MeshMgr;
+	PATH_TIMINGS               Timings;
+	std::vector< std::string > Files;
+	unsigned long              Scanned;
+	unsigned long              Blocks;
+	unsigned long              Mismatches;
+
+	ZeroMemory( &Timings, sizeof( Timings ) );
+
+	Scanned    = 0;
+	Blocks     = 0;
+	Mismatches = 0;
+
+	for (std::vector< std::string >::const_iterator it = Paths.begin( );
+	     it != Paths.end( );
+	     ++it)
+	{
+		DWORD Attributes = GetFileAttributesA( it->c_str( ) );
+
+		if ((Attributes == INVALID_FILE_ATTRIBUTES) ||
+		    (!(Attributes & FILE_ATTRIBUTE_DIRECTORY)))
+		{
+			Files.push_back( *it );
+			continue;
+		}
+
+		for (size_t e = 0; e < sizeof( Extensions ) / sizeof( Extensions[ 0 ] ); e += 1)
+		{
+			WIN32_FIND_DATAA FindData;
+			HANDLE           Find;
+			std::string      Mask;
+
+			Mask  = *it;
+			Mask += "\\";
+			Mask += Extensions[ e ];
+
+			Find = FindFirstFileA( Mask.c_str( ), &FindData );
+
+			if (Find == INVALID_HANDLE_VALUE)
+				continue;
+
+			do
+			{
+				if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+					continue;
+
+				Files.push_back( *it + "\\" + FindData.cFileName );
+			} while (FindNextFileA( Find, &FindData ));
+
+			FindClose( Find );
+		}
+	}
+
+	for (std::vector< std::string >::const_iterator it = Files.begin( );
+	     it != Files.end( );
+	     ++it)
+	{
+		if (ScanFile( *it, Iterations, MeshMgr, Timings, Blocks, Mismatches ))
+			Scanned += 1;
+	}
+
+	printf(
+		"Scan: %lu files, %lu compressed packets (%.1f MB compressed, %.1f MB uncompressed), %lu mismatch(es).\n",
+		Scanned,
+		Blocks,
+		(double) (__int64) Timings.CompressedBytes / (1024.0 * 1024.0),
+		(double) (__int64) Timings.UncompressedBytes / (1024.0 * 1024.0),
+		Mismatches);
+
+	if (Blocks != 0)
+	{
+		printf(
+			"Time to decompress every packet %lu time(s) (ms, MB/s uncompressed, relative to uncompress( )):\n",
+			Iterations);
+
+		for (int Path = 0; Path < LastDecompressPath; Path += 1)
+		{
+			double Seconds = Timings.Seconds[ Path ];
+
+			printf(
+				"  %-38s %10.1f  %8.1f  %.2fx\n",
+				DecompressPathNames[ Path ],
+				Seconds * 1000.0,
+				(Seconds > 0.0)
+					? ((double) (__int64) Timings.UncompressedBytes * Iterations / (1024.0 * 1024.0)) / Seconds
+					: 0.0,
+				(Timings.Seconds[ PathOneShot ] > 0.0)
+					? Seconds / Timings.Seconds[ PathOneShot ]
+					: 0.0);
+		}
+	}
+
+	return (Mismatches == 0);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"TrxDecompressTest\n"
+		"\n"
+		"This program checks that the span and streaming decompression paths of\n"
+		"NWN::Compressor, and the streamed walkmesh decompression of TrxFileReader,\n"
+		"match the original one-shot uncompress( ) path.  Given TRX or MDB files (or\n"
+		"directories holding them), it also decompresses every compressed packet\n"
+		"through each path, and reports the time taken.\n"
+		"\n"
+		"Usage: TrxDecompressTest [-count <streams>] [-iterations <timed runs>]\n"
+		"                         [-keep] [<file or directory> ...]\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the TRX decompression test
+	program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns zero if every check passed, else a nonzero value.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< std::string > Paths;
+	std::string                TrxFile;
+	unsigned long              Count;
+	unsigned long              Iterations;
+	bool                       Keep;
+	bool                       Passed;
+
+	Count      = 3000;
+	Iterations = 5;
+	Keep       = false;
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-count" )) && (i + 1 < argc))
+			Count = strtoul( argv[ ++i ], NULL, 10 );
+		else if ((!_stricmp( argv[ i ], "-iterations" )) && (i + 1 < argc))
+			Iterations = strtoul( argv[ ++i ], NULL, 10 );
+		else if (!_stricmp( argv[ i ], "-keep" ))
+			Keep = true;
+		else if (argv[ i ][ 0 ] != '-')
+			Paths.push_back( argv[ i ] );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	if (Iterations == 0)
+	{
+		printf( "\nThe timed run count must be at least 1.\n" );
+		return -1;
+	}
+
+	{
+		char TempPath[ MAX_PATH + 1 ];
+		char TempFile[ MAX_PATH + 1 ];
+
+		if ((!GetTempPathA( sizeof( TempPath ), TempPath )) ||
+		    (!GetTempFileNameA( TempPath, "trx", 0, TempFile )))
+		{
+			printf( "ERROR: Failed to create a temporary file.\n" );
+			return -1;
+		}
+
+		TrxFile = TempFile;
+	}
+
+	try
+	{
+		Passed = true;
+
+		if (!CheckCompressor( Count, 1 ))
+			Passed = false;
+
+		if (!CheckTrxReader( TrxFile, Count / 10 + LastTrxVariant, 1 ))
+			Passed = false;
+
+		if ((!Paths.empty( )) && (!ScanFiles( Paths, Iterations )))
+			Passed = false;
+	}
+	catch (std::exception &e)
+	{
+		printf( "ERROR: Exception '%s'.\n", e.what( ) );
+		Passed = false;
+	}
+
+	if (!Keep)
+		DeleteFileA( TrxFile.c_str( ) );
+
+	return Passed ? 0 : 1;
+}
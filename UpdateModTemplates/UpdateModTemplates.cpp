@@ -20,6 +20,7 @@ Abstract:
 #include "../NWN2DataLib/TextOut.h"
 #include "../NWN2DataLib/ResourceManager.h"
 #include "../NWN2DataLib/GffFileWriter.h"
+#include "../NWN2DataLib/GffCommitBatch.h"
 
 //
 // Define the debug text output interface, used to write debug or log messages
@@ -260,14 +261,181 @@ Environment:
 	}
 }
 
+//
+// Define a template named on the command line, along with the file that holds
+// it for each object type (or the error raised when it could not be located).
+//
+
+struct TemplateEntry
+{
+	std::string Name;
+	std::string FileName[ NumValidObjectTypes ];
+	std::string LocateError[ NumValidObjectTypes ];
+};
+
+typedef std::vector< TemplateEntry > TemplateVec;
+
+//
+// Map a lowercase template name to its index in the TemplateVec.
+//
+
+typedef stdext::hash_map< std::string, size_t > TemplateIndexMap;
+
+//
+// Define an area to be updated.  The area parameters are read on the main
+// thread, as the resource manager is not safe for concurrent use.
+//
+
+struct AreaWork
+{
+	NWN::ResRef32 AreaResRef;
+	std::string   GitFileName;
+	std::string   AreaName;
+	std::string   AreaTag;
+};
+
+typedef std::vector< AreaWork > AreaWorkVec;
+
+//
+// Define the state shared by all area worker threads.  All of it is read only
+// while the workers run, except for the interlocked counters, the output lock
+// and the commit batch that saves the updated .git files.
+//
+
+struct UpdateContext
+{
+	ResourceManager        * ResMan;
+	IDebugTextOut          * TextOut;
+	unsigned long            ObjectTypeMask;
+	const TemplateVec      * Templates;
+	const TemplateIndexMap * TemplateIndex;
+	const StringVec        * ExcludeFields;
+	GffCommitBatch         * CommitBatch;
+	AreaWorkVec              Areas;
+	volatile LONG            NextArea;
+	volatile LONG            AreasFailed;
+	CRITICAL_SECTION         OutputLock;
+};
+
+//
+// Define the state of an area worker thread.  Each worker keeps its own cache
+// of parsed templates (indexed by template index * NumValidObjectTypes +
+// object type index), as a GffFileReader may not be read from by more than
+// one thread at a time.
+//
+
+struct AreaWorker
+{
+	UpdateContext                   * Context;
+	HANDLE                            Thread;
+	std::vector< GffFileReader::Ptr > TemplateCache;
+	std::vector< bool >               TemplateLoaded;
+	StringVec                         TemplateLoadError;
+};
+
+//
+// Define the text output interface used by the area worker threads, which
+// holds the messages for an area so that they can be printed as one block
+// once the area is done.
+//
+
+class BufferTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		char buf[8193];
+
+		StringCbVPrintfA( buf, sizeof( buf ), fmt, ap );
+		m_Messages.push_back( buf );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	{
+		WriteTextV( fmt, argptr );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	//
+	// Write all held messages to another text output interface.
+	//
+
+	inline
+	void
+	Flush(
+		__in IDebugTextOut * TextOut
+		)
+	{
+		for (StringVec::const_iterator it = m_Messages.begin( );
+		     it != m_Messages.end( );
+		     ++it)
+		{
+			TextOut->WriteText( "%s", it->c_str( ) );
+		}
+
+		m_Messages.clear( );
+	}
+
+private:
+
+	StringVec m_Messages;
+
+};
+
 void
 ProcessArea(
-	__in const NWN::ResRef32 & AreaResRef,
-	__in ResourceManager & ResMan,
-	__in IDebugTextOut * TextOut,
-	__in unsigned long ObjectTypeMask,
-	__in const StringVec & TemplateNames,
-	__in const StringVec & ExcludeFields
+	__in const AreaWork & Area,
+	__inout AreaWorker & Worker,
+	__in IDebugTextOut * TextOut
 	)
 /*++
 
@@ -276,75 +444,47 @@ Routine Description:
 	This routine updates placed instances within a given area with data from
 	their templates.
 
+	The routine may run concurrently for different areas.  It does not use the
+	resource manager other than for its thread safe helpers, as all resources
+	were located by the main thread beforehand.
+
 Arguments:
 
-	AreaResRef - Supplies the resource name of the area to display.
+	Area - Supplies the area to update.
 
-	ResMan - Supplies a reference to the resource manager instance to use in
-	         order to load any associated resource data.
+	Worker - Supplies the worker thread state, including the worker's parsed
+	         template cache.
 
 	TextOut - Supplies the text output interface.
 
-	ObjectTypeMask - Supplies the mask of object types to update templates for.
-
-	TemplateNames - Supplies the RESREF names of templates that are to be
-	                updated.
-
-	ExcludeFields - Supplies a list of fields that are to be excluded from
-	                copying even if they are present in the template.
-
 Return Value:
 
 	None.  An std::exception is raised on failure.
 
 Environment:
 
-	User mode.
+	User mode, area worker thread.
 
 --*/
 {
-	//
-	// Areas are comprised of two files, an <area>.are with area parameters,
-	// and an <area>.git with the object instance parameters about objects that
-	// have been placed in the area via the toolset.
-	//
-
-	DemandResource32                 AreFile( ResMan, AreaResRef, NWN::ResARE );
-	DemandResource32                 GitFile( ResMan, AreaResRef, NWN::ResGIT );
-	GffFileReader                    Are( AreFile, ResMan );
-	GffFileReader::Ptr               Git = new GffFileReader( GitFile, ResMan );
+	const UpdateContext            * Context = Worker.Context;
+	ResourceManager                & ResMan  = *Context->ResMan;
+	GffFileReader::Ptr               Git     = new GffFileReader( Area.GitFileName, ResMan );
 	GffFileWriter                    GitWriter;
 	const GffFileReader::GffStruct * RootStruct;
 	GffFileWriter::GffStruct         GitWriterRoot;
-	std::string                      AreaName;
-	std::string                      AreaTag;
 
 	//
 	// Start off by duplicating the current GIT contents over to the new output
 	// GIT.
 	//
 
-	RootStruct = Are.GetRootStruct( );
 	GitWriter.InitializeFromReader( Git.get( ) );
 
-	//
-	// Acquire parameters we need from area.git.
-	//
-
-	if (!RootStruct->GetCExoLocString( "Name", AreaName ))
-	{
-		TextOut->WriteText(
-			"Warning: Failed to read area Name for area %s.\n",
-			ResMan.StrFromResRef( AreaResRef ).c_str( ));
-	}
-
-	if (!RootStruct->GetCExoString( "Tag", AreaTag ))
-		throw std::runtime_error( "Failed to read area Tag" );
-	
 	TextOut->WriteText(
 		"Updating instance information for area %s (tag %s)...\n", 
-		AreaName.c_str( ),
-		AreaTag.c_str( ));
+		Area.AreaName.c_str( ),
+		Area.AreaTag.c_str( ));
 
 	//
 	// Now update each of the instance data items that we are interested in.
@@ -355,7 +495,7 @@ Environment:
 
 	for (size_t i = 0; i < NumValidObjectTypes; i += 1)
 	{
-		if (!(ObjectTypeMask & (1 << ValidObjectTypes[ i ].TypeCode )))
+		if (!(Context->ObjectTypeMask & (1 << ValidObjectTypes[ i ].TypeCode )))
 			continue;
 
 		//
@@ -365,13 +505,14 @@ Environment:
 
 		for (size_t j = 0; j <= ULONG_MAX; j += 1)
 		{
-			GffFileReader::GffStruct ObjStructIn;
-			GffFileWriter::GffStruct ObjStructOut;
-			NWN::ResRef32            TemplateResRef;
-			std::string              TemplateString;
-			bool                     MatchingTemplate;
-			std::string              FileName;
-			GffFileReader::Ptr       TemplateReader;
+			GffFileReader::GffStruct           ObjStructIn;
+			GffFileWriter::GffStruct           ObjStructOut;
+			NWN::ResRef32                      TemplateResRef;
+			std::string                        TemplateString;
+			TemplateIndexMap::const_iterator   Match;
+			const TemplateEntry              * Template;
+			size_t                             CacheIndex;
+			GffFileReader                    * TemplateReader;
 
 			//
 			// Fetch the corresponding list element in both the input and output
@@ -392,23 +533,20 @@ Environment:
 			if (!ObjStructIn.GetResRef( "TemplateResRef", TemplateResRef ))
 				continue;
 
-			TemplateString   = ResMan.StrFromResRef( TemplateResRef );
-			MatchingTemplate = false;
+			//
+			// N.B.  StrFromResRef returns a lowercase name, which is the form
+			//       that the template index is keyed by.
+			//
 
-			for (StringVec::const_iterator it = TemplateNames.begin( );
-			     it != TemplateNames.end( );
-			     ++it)
-			{
-				if (!_stricmp( it->c_str( ), TemplateString.c_str( ) ))
-				{
-					MatchingTemplate = true;
-					break;
-				}
-			}
+			TemplateString = ResMan.StrFromResRef( TemplateResRef );
+			Match          = Context->TemplateIndex->find( TemplateString );
 
-			if (!MatchingTemplate)
+			if (Match == Context->TemplateIndex->end( ))
 				continue;
 
+			Template   = &(*Context->Templates)[ Match->second ];
+			CacheIndex = Match->second * NumValidObjectTypes + i;
+
 			//
 			// This instance appears to be one that we should update, try and
 			// process it.
@@ -427,37 +565,47 @@ Environment:
 			// even legal GFF-based templates to begin with! (e.g. fireplace.upe).
 			//
 
-			try
-			{
-				FileName = ResMan.Demand(
-					TemplateResRef,
-					ValidObjectTypes[ i ].TemplateResType);
-			}
-			catch (std::exception &e)
+			if (Template->FileName[ i ].empty( ))
 			{
 				TextOut->WriteText(
 					"WARNING:  Exception '%s' locating template %s.%s, skipping object instance...\n",
-					e.what( ),
+					Template->LocateError[ i ].c_str( ),
 					TemplateString.c_str( ),
 					ResMan.ResTypeToExt( ValidObjectTypes[ i ].TemplateResType ));
 
 				continue;
 			}
 
-			try
+			//
+			// Parse the template the first time that this worker encounters it,
+			// then reuse the parsed template for every further instance.
+			//
+
+			if (!Worker.TemplateLoaded[ CacheIndex ])
 			{
-				TemplateReader = new GffFileReader(
-					FileName,
-					ResMan);
+				Worker.TemplateLoaded[ CacheIndex ] = true;
+
+				try
+				{
+					Worker.TemplateCache[ CacheIndex ] = new GffFileReader(
+						Template->FileName[ i ],
+						ResMan);
+				}
+				catch (std::exception &e)
+				{
+					Worker.TemplateLoadError[ CacheIndex ] = e.what( );
+				}
 			}
-			catch (std::exception &e)
+
+			TemplateReader = Worker.TemplateCache[ CacheIndex ].get( );
+
+			if (TemplateReader == NULL)
 			{
 				TextOut->WriteText(
 					"WARNING:  Exception '%s' loading template %s.%s, skipping object instance...\n",
-					e.what( ),
+					Worker.TemplateLoadError[ CacheIndex ].c_str( ),
 					TemplateString.c_str( ),
 					ResMan.ResTypeToExt( ValidObjectTypes[ i ].TemplateResType ));
-				ResMan.Release( FileName );
 
 				continue;
 			}
@@ -472,7 +620,7 @@ Environment:
 					TemplateReader->GetRootStruct( ),
 					&ObjStructIn,
 					&ObjStructOut,
-					ExcludeFields,
+					*Context->ExcludeFields,
 					TextOut);
 			}
 			catch (std::exception &e)
@@ -483,22 +631,344 @@ Environment:
 					TemplateString.c_str( ),
 					ResMan.ResTypeToExt( ValidObjectTypes[ i ].TemplateResType ));
 			}
-
-			TemplateReader = NULL;
-			ResMan.Release( FileName );
 		}
 	}
 
 	//
-	// Now replace the object instance GFF with our edited version.
+	// Now replace the object instance GFF with our edited version.  The file
+	// is only rewritten if the update changed its contents.
 	//
 
 	Git = NULL;
 
-	GitWriter.Commit(
-		GitFile,
+	if (!Context->CommitBatch->Commit(
+		GitWriter,
+		Area.GitFileName,
 		GffFileWriter::GIT_FILE_TYPE,
-		GffFileWriter::GFF_COMMIT_FLAG_SEQUENTIAL);
+		GffFileWriter::GFF_COMMIT_FLAG_SEQUENTIAL))
+	{
+		throw std::runtime_error( "Failed to write " + Area.GitFileName + "." );
+	}
+}
+
+DWORD
+WINAPI
+AreaWorkerThread(
+	__in LPVOID Parameter
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point of an area worker thread.  It updates areas
+	until none remain, printing the messages for each area as a block once the
+	area is done.
+
+Arguments:
+
+	Parameter - Supplies the AreaWorker of the thread.
+
+Return Value:
+
+	The routine always returns zero.
+
+Environment:
+
+	User mode, area worker thread.
+
+--*/
+{
+	AreaWorker    * Worker  = (AreaWorker *) Parameter;
+	UpdateContext * Context = Worker->Context;
+
+	for (;;)
+	{
+		BufferTextOut AreaTextOut;
+		size_t        Index;
+
+		Index = (size_t) (InterlockedIncrement( &Context->NextArea ) - 1);
+
+		if (Index >= Context->Areas.size( ))
+			break;
+
+		try
+		{
+			ProcessArea( Context->Areas[ Index ], *Worker, &AreaTextOut );
+		}
+		catch (std::exception &e)
+		{
+			AreaTextOut.WriteText(
+				"ERROR: Exception '%s' updating area %s, skipping area.\n",
+				e.what( ),
+				Context->ResMan->StrFromResRef( Context->Areas[ Index ].AreaResRef ).c_str( ));
+
+			InterlockedIncrement( &Context->AreasFailed );
+		}
+
+		EnterCriticalSection( &Context->OutputLock );
+		AreaTextOut.Flush( Context->TextOut );
+		LeaveCriticalSection( &Context->OutputLock );
+	}
+
+	return 0;
+}
+
+void
+UpdateAreas(
+	__inout UpdateContext & Context,
+	__in unsigned long MaxThreads
+	)
+/*++
+
+Routine Description:
+
+	This routine updates all of the areas of the update context in parallel.
+	The areas are independent .git files, so each is updated by whichever
+	worker thread picks it up next.
+
+Arguments:
+
+	Context - Supplies the update context, whose areas and templates have
+	          already been located.
+
+	MaxThreads - Supplies the maximum count of worker threads, or zero to use
+	             one worker thread per processor.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	std::vector< AreaWorker > Workers;
+	SYSTEM_INFO               SystemInfo;
+	size_t                    ThreadCount;
+	size_t                    ThreadsStarted;
+
+	GetSystemInfo( &SystemInfo );
+
+	ThreadCount = (MaxThreads != 0) ? MaxThreads : SystemInfo.dwNumberOfProcessors;
+
+	if (ThreadCount > Context.Areas.size( ))
+		ThreadCount = Context.Areas.size( );
+
+	if (ThreadCount == 0)
+		ThreadCount = 1;
+
+	Workers.resize( ThreadCount );
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		Workers[ i ].Context = &Context;
+		Workers[ i ].Thread  = NULL;
+		Workers[ i ].TemplateCache.resize( Context.Templates->size( ) * NumValidObjectTypes );
+		Workers[ i ].TemplateLoaded.resize( Context.Templates->size( ) * NumValidObjectTypes, false );
+		Workers[ i ].TemplateLoadError.resize( Context.Templates->size( ) * NumValidObjectTypes );
+	}
+
+	Context.NextArea    = 0;
+	Context.AreasFailed = 0;
+
+	InitializeCriticalSection( &Context.OutputLock );
+
+	//
+	// Start the workers.  If no thread could be created, then update the areas
+	// on the calling thread instead.
+	//
+
+	ThreadsStarted = 0;
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		Workers[ i ].Thread = CreateThread(
+			NULL,
+			0,
+			AreaWorkerThread,
+			&Workers[ i ],
+			0,
+			NULL);
+
+		if (Workers[ i ].Thread != NULL)
+			ThreadsStarted += 1;
+	}
+
+	if (ThreadsStarted == 0)
+		AreaWorkerThread( &Workers[ 0 ] );
+
+	for (size_t i = 0; i < ThreadCount; i += 1)
+	{
+		if (Workers[ i ].Thread == NULL)
+			continue;
+
+		WaitForSingleObject( Workers[ i ].Thread, INFINITE );
+		CloseHandle( Workers[ i ].Thread );
+	}
+
+	DeleteCriticalSection( &Context.OutputLock );
+}
+
+void
+LocateTemplates(
+	__in ResourceManager & ResMan,
+	__in unsigned long ObjectTypeMask,
+	__in const StringVec & TemplateNames,
+	__out TemplateVec & Templates,
+	__out TemplateIndexMap & TemplateIndex,
+	__inout StringVec & DemandedFiles
+	)
+/*++
+
+Routine Description:
+
+	This routine locates the file of each template to update, for each object
+	type to update, and builds the index used to match placed instances to
+	their templates.
+
+Arguments:
+
+	ResMan - Supplies the resource manager used to locate the templates.
+
+	ObjectTypeMask - Supplies the mask of object types to update templates for.
+
+	TemplateNames - Supplies the RESREF names of templates that are to be
+	                updated.
+
+	Templates - Receives the located templates.
+
+	TemplateIndex - Receives the map of lowercase template names to indicies
+	                in Templates.
+
+	DemandedFiles - Receives the file names of all demanded resources, which
+	                the caller must release.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	Templates.clear( );
+	TemplateIndex.clear( );
+
+	for (StringVec::const_iterator it = TemplateNames.begin( );
+	     it != TemplateNames.end( );
+	     ++it)
+	{
+		std::string Name( *it );
+
+		for (size_t i = 0; i < Name.size( ); i += 1)
+			Name[ i ] = (char) tolower( (int) (unsigned char) Name[ i ] );
+
+		if (TemplateIndex.find( Name ) != TemplateIndex.end( ))
+			continue;
+
+		Templates.push_back( TemplateEntry( ) );
+
+		TemplateEntry & Template = Templates.back( );
+
+		Template.Name = Name;
+		TemplateIndex.insert( TemplateIndexMap::value_type( Name, Templates.size( ) - 1 ) );
+
+		for (size_t i = 0; i < NumValidObjectTypes; i += 1)
+		{
+			if (!(ObjectTypeMask & (1 << ValidObjectTypes[ i ].TypeCode )))
+				continue;
+
+			try
+			{
+				Template.FileName[ i ] = ResMan.Demand(
+					ResMan.ResRef32FromStr( Name ),
+					ValidObjectTypes[ i ].TemplateResType);
+			}
+			catch (std::exception &e)
+			{
+				Template.LocateError[ i ] = e.what( );
+				continue;
+			}
+
+			DemandedFiles.push_back( Template.FileName[ i ] );
+		}
+	}
+}
+
+void
+PrepareArea(
+	__in const NWN::ResRef32 & AreaResRef,
+	__in ResourceManager & ResMan,
+	__in IDebugTextOut * TextOut,
+	__out AreaWork & Area,
+	__inout StringVec & DemandedFiles
+	)
+/*++
+
+Routine Description:
+
+	This routine locates the files of an area and reads the area parameters
+	ahead of the (parallel) instance update.
+
+Arguments:
+
+	AreaResRef - Supplies the resource name of the area to prepare.
+
+	ResMan - Supplies a reference to the resource manager instance to use in
+	         order to load any associated resource data.
+
+	TextOut - Supplies the text output interface.
+
+	Area - Receives the area parameters.
+
+	DemandedFiles - Receives the file names of all demanded resources, which
+	                the caller must release.
+
+Return Value:
+
+	None.  An std::exception is raised on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	//
+	// Areas are comprised of two files, an <area>.are with area parameters,
+	// and an <area>.git with the object instance parameters about objects that
+	// have been placed in the area via the toolset.
+	//
+
+	DemandResource32                 AreFile( ResMan, AreaResRef, NWN::ResARE );
+	GffFileReader                    Are( AreFile, ResMan );
+	const GffFileReader::GffStruct * RootStruct;
+
+	Area.AreaResRef = AreaResRef;
+
+	//
+	// Acquire parameters we need from area.are.
+	//
+
+	RootStruct = Are.GetRootStruct( );
+
+	if (!RootStruct->GetCExoLocString( "Name", Area.AreaName ))
+	{
+		TextOut->WriteText(
+			"Warning: Failed to read area Name for area %s.\n",
+			ResMan.StrFromResRef( AreaResRef ).c_str( ));
+	}
+
+	if (!RootStruct->GetCExoString( "Tag", Area.AreaTag ))
+		throw std::runtime_error( "Failed to read area Tag" );
+
+	Area.GitFileName = ResMan.Demand( AreaResRef, NWN::ResGIT );
+
+	DemandedFiles.push_back( Area.GitFileName );
 }
 
 void
@@ -573,6 +1043,7 @@ Environment:
 		"                          -objecttype <first object type to match>\n"
 		"                          [-objecttype <additional object type N...>]\n"
 		"                          [-excludefield <exclude field 1...>]\n"
+		"                          [-threads <worker thread count>]\n"
 		);
 
 	printf( "\n" );
@@ -767,12 +1238,14 @@ Environment:
 	StringVec       TemplateNames;
 	StringVec       ExcludeFields;
 	unsigned long   ObjectTypeMask;
+	unsigned long   MaxThreads;
 	bool            Erf16;
 
 	ModuleName     = NULL;
 	NWN2Home       = NULL;
 	InstallDir     = NULL;
 	ObjectTypeMask = 0;
+	MaxThreads     = 0;
 	Erf16          = false;
 
 	//
@@ -791,6 +1264,8 @@ Environment:
 			TemplateNames.push_back( argv[ ++i ] );
 		else if ((!_stricmp( argv[ i ], "-excludefield" )) && (i + 1 < argc))
 			ExcludeFields.push_back( argv[ ++i ] );
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
 		else if ((!_stricmp( argv[ i ], "-nwn1")))
 			Erf16 = true;
 		else if ((!_stricmp( argv[ i ], "-objecttype" )) && (i + 1 < argc))
@@ -869,6 +1344,7 @@ Environment:
 
 	PrintfTextOut   TextOut;
 	ResourceManager ResMan( &TextOut );
+	StringVec       DemandedFiles;
 
 	try
 	{
@@ -889,12 +1365,40 @@ Environment:
 		const GffFileReader::GffStruct * RootStruct = ModuleIfo.GetRootStruct( );
 		std::string                      ModName;
 		GffFileReader::GffStruct         Struct;
+		TemplateVec                      Templates;
+		TemplateIndexMap                 TemplateIndex;
+		UpdateContext                    Context;
+		GffCommitBatch                   CommitBatch;
 
 		if (RootStruct->GetCExoLocString( "Mod_Name", ModName ))
 			TextOut.WriteText( "The module name is: %s.\n", ModName.c_str( ) );
 
 		//
-		// Now look at each area.
+		// Locate each template once up front.  Placed instances are matched
+		// against the template index, and each template is parsed only once
+		// per worker thread no matter how many instances of it are placed.
+		//
+
+		LocateTemplates(
+			ResMan,
+			ObjectTypeMask,
+			TemplateNames,
+			Templates,
+			TemplateIndex,
+			DemandedFiles);
+
+		Context.ResMan         = &ResMan;
+		Context.TextOut        = &TextOut;
+		Context.ObjectTypeMask = ObjectTypeMask;
+		Context.Templates      = &Templates;
+		Context.TemplateIndex  = &TemplateIndex;
+		Context.ExcludeFields  = &ExcludeFields;
+		Context.CommitBatch    = &CommitBatch;
+
+		//
+		// Now look at each area.  All resource manager access happens here on
+		// the main thread; the instances of each area are then updated in
+		// parallel.
 		//
 
 		for (size_t i = 0; i <= ULONG_MAX; i += 1)
@@ -907,20 +1411,47 @@ Environment:
 			if (!Struct.GetResRef( "Area_Name", AreaResRef ))
 				throw std::runtime_error( "Mod_Area_list element is missing Area_Name." );
 
-			//
-			// Process templates in this area.
-			//
+			Context.Areas.push_back( AreaWork( ) );
 
-			ProcessArea(
+			PrepareArea(
 				AreaResRef,
 				ResMan,
 				&TextOut,
-				ObjectTypeMask,
-				TemplateNames,
-				ExcludeFields);
+				Context.Areas.back( ),
+				DemandedFiles);
 		}
 
-		TextOut.WriteText( "Finished processing module.\n" );
+		UpdateAreas( Context, MaxThreads );
+
+		//
+		// Flush the .git files that were rewritten to disk in one pass, now
+		// that every area is done, and report how many actually changed.
+		//
+
+		if (!CommitBatch.Flush( ))
+			TextOut.WriteText( "WARNING: Failed to flush updated area files to disk.\n" );
+
+		const GffCommitBatch::CommitStats & Stats = CommitBatch.GetCommitStats( );
+
+		TextOut.WriteText(
+			"Wrote %lu of %lu area file(s) (%I64u of %I64u bytes); %lu unchanged file(s) were left as is.\n",
+			(unsigned long) Stats.WrittenFileCount,
+			(unsigned long) Stats.FileCount,
+			Stats.WrittenBytes,
+			Stats.FileBytes,
+			(unsigned long) (Stats.FileCount - Stats.WrittenFileCount));
+
+		if (Context.AreasFailed != 0)
+		{
+			TextOut.WriteText(
+				"Finished processing module (%lu of %lu area(s) could not be updated).\n",
+				(unsigned long) Context.AreasFailed,
+				(unsigned long) Context.Areas.size( ));
+		}
+		else
+		{
+			TextOut.WriteText( "Finished processing module.\n" );
+		}
 	}
 	catch (std::exception &e)
 	{
@@ -932,6 +1463,13 @@ Environment:
 		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
 	}
 
+	for (StringVec::const_iterator it = DemandedFiles.begin( );
+	     it != DemandedFiles.end( );
+	     ++it)
+	{
+		ResMan.Release( *it );
+	}
+
 	//
 	// All done.
 	//
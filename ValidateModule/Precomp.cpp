@@ -0,0 +1,15 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+    Precomp.cpp
+
+Abstract:
+
+    This module builds the precompiled header.
+
+--*/
+
+#include "Precomp.h"
@@ -0,0 +1,937 @@
+/*++
+
+Copyright (c) Ken Johnson (Skywing). All rights reserved.
+
+Module Name:
+
+	ValidateModule.cpp
+
+Abstract:
+
+	This module houses a program that checks the integrity of every GFF, 2DA,
+	compiled script and area terrain file of a module and its HAKs.
+
+	Each resource is run through the full parser for its type, with the
+	strict checks that are otherwise skipped on load (such as validating every
+	field of a GFF file).  Resources are checked in parallel, and a report
+	listing the result of every resource is written in resource name order.
+
+--*/
+
+#include "Precomp.h"
+#include "../NWN2DataLib/TextOut.h"
+#include "../NWN2DataLib/ResourceManager.h"
+#include "../NWN2DataLib/ModuleScan.h"
+#include "../NWN2DataLib/2DAFileReader.h"
+#include "../NWN2DataLib/NWScriptReader.h"
+
+//
+// Define the debug text output interface, used to write debug or log messages
+// to the user.
+//
+
+class PrintfTextOut : public IDebugTextOut
+{
+
+public:
+
+	inline
+	PrintfTextOut(
+		)
+	{
+		AllocConsole( );
+	}
+
+	inline
+	~PrintfTextOut(
+		)
+	{
+		FreeConsole( );
+	}
+
+	enum { STD_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE };
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( STD_COLOR, fmt, ap );
+		va_end( ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteText(
+		__in WORD Attributes,
+		__in __format_string const char* fmt,
+		...
+		)
+	{
+		va_list ap;
+
+		va_start( ap, fmt );
+		WriteTextV( Attributes, fmt, ap );
+		va_end( ap );
+
+		UNREFERENCED_PARAMETER( Attributes );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in __format_string const char* fmt,
+		__in va_list ap
+		)
+	{
+		WriteTextV( STD_COLOR, fmt, ap );
+	}
+
+	inline
+	virtual
+	void
+	WriteTextV(
+		__in WORD Attributes,
+		__in const char *fmt,
+		__in va_list argptr
+		)
+	/*++
+
+	Routine Description:
+
+		This routine displays text to the log file and the debug console.
+
+		The console output may have color attributes supplied, as per the standard
+		SetConsoleTextAttribute API.
+
+	Arguments:
+
+		Attributes - Supplies color attributes for the text as per the standard
+					 SetConsoleTextAttribute API (e.g. FOREGROUND_RED).
+
+		fmt - Supplies the printf-style format string to use to display text.
+
+		argptr - Supplies format inserts.
+
+	Return Value:
+
+		None.
+
+	Environment:
+
+		User mode.
+
+	--*/
+	{
+		HANDLE console = GetStdHandle( STD_OUTPUT_HANDLE );
+		char buf[8193];
+		StringCbVPrintfA(buf, sizeof( buf ), fmt, argptr);
+		DWORD n = (DWORD)strlen(buf);
+		SetConsoleTextAttribute( console, Attributes );
+		WriteConsoleA(console, buf, n, &n, 0);
+	}
+
+};
+
+//
+// Define the parser that is used to check a resource type.
+//
+
+typedef enum _VALIDATOR_TYPE
+{
+	ValidatorGff,
+	Validator2DA,
+	ValidatorNcs,
+	ValidatorTrx,
+
+	LastValidatorType
+} VALIDATOR_TYPE, * PVALIDATOR_TYPE;
+
+struct ValidateTypeSpec
+{
+	NWN::ResType   ResType;
+	VALIDATOR_TYPE Validator;
+};
+
+static const ValidateTypeSpec ValidateTypes[ ] =
+{
+	{ NWN::ResIFO, ValidatorGff },
+	{ NWN::ResARE, ValidatorGff },
+	{ NWN::ResGIT, ValidatorGff },
+	{ NWN::ResGIC, ValidatorGff },
+	{ NWN::ResJRL, ValidatorGff },
+	{ NWN::ResFAC, ValidatorGff },
+	{ NWN::ResDLG, ValidatorGff },
+	{ NWN::ResITP, ValidatorGff },
+	{ NWN::ResBIC, ValidatorGff },
+	{ NWN::ResCAM, ValidatorGff },
+	{ NWN::ResUTC, ValidatorGff },
+	{ NWN::ResUTD, ValidatorGff },
+	{ NWN::ResUTE, ValidatorGff },
+	{ NWN::ResUTI, ValidatorGff },
+	{ NWN::ResUTM, ValidatorGff },
+	{ NWN::ResUTP, ValidatorGff },
+	{ NWN::ResUTR, ValidatorGff },
+	{ NWN::ResUTS, ValidatorGff },
+	{ NWN::ResUTT, ValidatorGff },
+	{ NWN::ResUTW, ValidatorGff },
+	{ NWN::ResULT, ValidatorGff },
+	{ NWN::ResUEN, ValidatorGff },
+	{ NWN::ResUPE, ValidatorGff },
+	{ NWN::Res2DA, Validator2DA },
+	{ NWN::ResNCS, ValidatorNcs },
+	{ NWN::ResTRN, ValidatorTrx },
+	{ NWN::ResTRX, ValidatorTrx }
+};
+
+//
+// Define the result of checking one resource.
+//
+
+struct ResourceResult
+{
+	size_t      TypeIndex;
+	bool        Passed;
+	std::string Detail;
+};
+
+typedef std::vector< ResourceResult > ResourceResultVec;
+
+//
+// Define the results of a scan item.  Present is filled in before the scan,
+// and selects the resource types of the item that are checked; the other
+// types may only exist in the base game data.
+//
+
+struct ItemResult
+{
+	std::vector< bool > Present;
+	ResourceResultVec   Resources;
+};
+
+typedef std::vector< ItemResult > ItemResultVec;
+
+//
+// Define the module scan visitor that checks the resources of each item.
+//
+
+class ModuleValidateVisitor : public IModuleScanVisitor
+{
+
+public:
+
+	inline
+	ModuleValidateVisitor(
+		__inout ItemResultVec & Results
+		)
+	: m_Results( Results )
+	{
+	}
+
+	virtual
+	void
+	VisitScanItem(
+		__in ModuleScan::ScanContext & Context
+		);
+
+private:
+
+	//
+	// Check a resource, raising an std::exception if it is malformed.
+	//
+
+	void
+	ValidateResource(
+		__in ModuleScan::ScanContext & Context,
+		__in const ValidateTypeSpec & Spec
+		);
+
+	ModuleValidateVisitor &
+	operator=(
+		__in const ModuleValidateVisitor & other
+		);
+
+	ItemResultVec & m_Results;
+
+};
+
+void
+ModuleValidateVisitor::VisitScanItem(
+	__in ModuleScan::ScanContext & Context
+	)
+/*++
+
+Routine Description:
+
+	This routine checks each resource of a scan item, and records the result
+	of each check.  A malformed resource does not stop the remaining resources
+	of the item from being checked.
+
+	It is called on a module scan worker thread.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the item.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	ItemResult  & Result = m_Results[ Context.GetItemIndex( ) ];
+	std::string   ResRef;
+
+	ResRef = Context.GetResourceManager( ).StrFromResRef( Context.GetItem( ).ResRef );
+
+	for (size_t i = 0; i < RTL_NUMBER_OF( ValidateTypes ); i += 1)
+	{
+		ResourceResult Resource;
+		char           Detail[ 256 ];
+
+		if (!Result.Present[ i ])
+			continue;
+
+		Resource.TypeIndex = i;
+		Resource.Passed    = false;
+
+		try
+		{
+			ValidateResource( Context, ValidateTypes[ i ] );
+
+			Resource.Passed = true;
+		}
+		catch (NWScriptAnalyzer::script_error &e)
+		{
+			StringCbPrintfA(
+				Detail,
+				sizeof( Detail ),
+				"Analyzer exception '%s' ('%s') at PC=%08X, SP=%08X.",
+				e.what( ),
+				e.specific( ),
+				(unsigned long) e.pc( ),
+				(unsigned long) e.stack_index( ));
+
+			Resource.Detail = Detail;
+		}
+		catch (std::exception &e)
+		{
+			Resource.Detail = e.what( );
+		}
+
+		if (!Resource.Passed)
+		{
+			Context.GetTextOut( )->WriteText(
+				"FAILED: %s.%s: %s\n",
+				ResRef.c_str( ),
+				ResourceManager::ResTypeToExt( ValidateTypes[ i ].ResType ),
+				Resource.Detail.c_str( ));
+		}
+
+		Result.Resources.push_back( Resource );
+	}
+}
+
+void
+ModuleValidateVisitor::ValidateResource(
+	__in ModuleScan::ScanContext & Context,
+	__in const ValidateTypeSpec & Spec
+	)
+/*++
+
+Routine Description:
+
+	This routine checks one resource of the current item with the parser for
+	its type.
+
+	GFF files must carry the file type of their resource type, and every
+	field is checked.  Compiled scripts are run through the script analyzer
+	against the NWN2 action table.  Area terrain files are fully loaded, which
+	validates the walkmesh, its tile surface meshes and its path tables.
+
+Arguments:
+
+	Context - Supplies the scan context, which describes the item.
+
+	Spec - Supplies the resource type to check.
+
+Return Value:
+
+	None.  An std::exception is raised if the resource is malformed.
+
+Environment:
+
+	User mode, module scan worker thread.
+
+--*/
+{
+	const std::string & FileName = Context.GetFileName( Spec.ResType );
+
+	if (FileName.empty( ))
+		throw std::runtime_error( "Resource not found." );
+
+	switch (Spec.Validator)
+	{
+
+	case ValidatorGff:
+		{
+			const GffFileReader * Reader;
+			const char          * Ext;
+			char                  FileType[ 4 ];
+			unsigned long         ActualType;
+
+			Reader = Context.GetGffReader( Spec.ResType );
+			Ext    = ResourceManager::ResTypeToExt( Spec.ResType );
+
+			//
+			// The file type is the upper case extension, padded with spaces.
+			//
+
+			for (size_t i = 0; i < sizeof( FileType ); i += 1)
+			{
+				if (*Ext != '\0')
+					FileType[ i ] = (char) toupper( (int) (unsigned char) *Ext++ );
+				else
+					FileType[ i ] = ' ';
+			}
+
+			ActualType = Reader->GetFileType( );
+
+			if (memcmp( &ActualType, FileType, sizeof( FileType ) ))
+			{
+				char Msg[ 64 ];
+
+				StringCbPrintfA(
+					Msg,
+					sizeof( Msg ),
+					"GFF file type is '%.4s', expected '%.4s'.",
+					(const char *) &ActualType,
+					FileType);
+
+				throw std::runtime_error( Msg );
+			}
+
+			Reader->Validate( );
+		}
+		break;
+
+	case Validator2DA:
+		{
+			TwoDAFileReader Reader( FileName );
+		}
+		break;
+
+	case ValidatorNcs:
+		{
+			NWScriptReader   Reader( FileName.c_str( ) );
+			NWScriptAnalyzer Analyzer( NULL, NWActions_NWN2, MAX_ACTION_ID_NWN2 );
+
+			//
+			// The optimization pass does not check anything further, so it is
+			// skipped.
+			//
+
+			Analyzer.Analyze( &Reader, NWScriptAnalyzer::AF_NO_OPTIMIZATIONS );
+		}
+		break;
+
+	case ValidatorTrx:
+		Context.GetTrxReader( Spec.ResType, false );
+		break;
+
+	default:
+		throw std::runtime_error( "Unsupported validator." );
+
+	}
+}
+
+size_t
+GetValidateTypeIndex(
+	__in NWN::ResType ResType
+	)
+/*++
+
+Routine Description:
+
+	This routine locates the checked resource type entry of a resource type.
+
+Arguments:
+
+	ResType - Supplies the resource type to look up.
+
+Return Value:
+
+	The routine returns the index into ValidateTypes of the resource type, or
+	RTL_NUMBER_OF( ValidateTypes ) if the resource type is not checked.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	for (size_t i = 0; i < RTL_NUMBER_OF( ValidateTypes ); i += 1)
+	{
+		if (ValidateTypes[ i ].ResType == ResType)
+			return i;
+	}
+
+	return RTL_NUMBER_OF( ValidateTypes );
+}
+
+void
+AddModuleResources(
+	__in ResourceManager & ResMan,
+	__inout ModuleScan & Scan,
+	__out ItemResultVec & Results
+	)
+/*++
+
+Routine Description:
+
+	This routine adds a scan item for every resource name that has a checked
+	resource in the module, its HAKs, or a directory (such as the override
+	directory), and records which types each item has there.  Resources that
+	only exist in the base game data files are not checked.
+
+Arguments:
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan that receives the items.
+
+	Results - Receives the results of each item, with the present resource
+	          types filled in, in item order.
+
+Return Value:
+
+	None.  On failure, an std::exception is raised.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	typedef std::map< std::string, std::pair< NWN::ResRef32, std::vector< bool > > > ItemMap;
+
+	ItemMap Items;
+	size_t  i;
+
+	for (ResourceManager::FileId Id = 0;
+	     Id < ResMan.GetEncapsulatedFileCount( );
+	     Id += 1)
+	{
+		NWN::ResRef32                 ResRef;
+		NWN::ResType                  ResType;
+		size_t                        TypeIndex;
+		ResourceManager::FileHandle   Handle;
+		ResourceManager::AccessorType AccessorType;
+		std::string                   AccessorName;
+
+		if (!ResMan.GetEncapsulatedFileEntry( Id, ResRef, ResType ))
+			continue;
+
+		TypeIndex = GetValidateTypeIndex( ResType );
+
+		if (TypeIndex == RTL_NUMBER_OF( ValidateTypes ))
+			continue;
+
+		//
+		// Determine where the resource comes from.  The module and its HAKs
+		// are ERFs, or the module is a directory.
+		//
+
+		Handle = ResMan.OpenFileByIndex( Id );
+
+		if (Handle == ResourceManager::INVALID_FILE)
+			continue;
+
+		try
+		{
+			AccessorType = ResMan.GetResourceAccessorName( Handle, AccessorName );
+		}
+		catch (std::exception)
+		{
+			ResMan.CloseFile( Handle );
+			throw;
+		}
+
+		ResMan.CloseFile( Handle );
+
+		if ((AccessorType != ResourceManager::AccessorTypeErf) &&
+		    (AccessorType != ResourceManager::AccessorTypeDirectory))
+		{
+			continue;
+		}
+
+		std::pair< NWN::ResRef32, std::vector< bool > > & Item = Items[ ResMan.StrFromResRef( ResRef ) ];
+
+		if (Item.second.empty( ))
+		{
+			Item.first = ResRef;
+			Item.second.resize( RTL_NUMBER_OF( ValidateTypes ), false );
+		}
+
+		Item.second[ TypeIndex ] = true;
+	}
+
+	Results.clear( );
+	Results.resize( Items.size( ) );
+
+	i = 0;
+
+	for (ItemMap::const_iterator it = Items.begin( );
+	     it != Items.end( );
+	     ++it, i += 1)
+	{
+		Scan.AddItem( it->second.first );
+
+		Results[ i ].Present = it->second.second;
+	}
+}
+
+bool
+WriteReport(
+	__in const char * ReportFile,
+	__in ResourceManager & ResMan,
+	__in const ModuleScan & Scan,
+	__in const ItemResultVec & Results
+	)
+/*++
+
+Routine Description:
+
+	This routine writes the validation report, a tab separated file with one
+	line for each checked resource, in resource name order.
+
+Arguments:
+
+	ReportFile - Supplies the path to the report file to write.
+
+	ResMan - Supplies the resource manager that the module is loaded in.
+
+	Scan - Supplies the module scan whose items were checked.
+
+	Results - Supplies the results of each item.
+
+Return Value:
+
+	The routine returns true on success, else false on failure.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	FILE * f;
+
+	f = fopen( ReportFile, "wt" );
+
+	if (f == NULL)
+		return false;
+
+	fprintf( f, "Resource\tType\tStatus\tDetail\n" );
+
+	for (size_t i = 0; i < Results.size( ); i += 1)
+	{
+		std::string ResRef = ResMan.StrFromResRef( Scan.GetItems( )[ i ].ResRef );
+
+		for (ResourceResultVec::const_iterator it = Results[ i ].Resources.begin( );
+		     it != Results[ i ].Resources.end( );
+		     ++it)
+		{
+			fprintf(
+				f,
+				"%s\t%s\t%s\t%s\n",
+				ResRef.c_str( ),
+				ResourceManager::ResTypeToExt( ValidateTypes[ it->TypeIndex ].ResType ),
+				it->Passed ? "OK" : "FAILED",
+				it->Detail.c_str( ));
+		}
+
+		//
+		// An item that failed outside of a resource check has no results for
+		// the resources that it had.
+		//
+
+		for (size_t t = 0; t < Results[ i ].Present.size( ); t += 1)
+		{
+			bool Checked = false;
+
+			if (!Results[ i ].Present[ t ])
+				continue;
+
+			for (ResourceResultVec::const_iterator it = Results[ i ].Resources.begin( );
+			     it != Results[ i ].Resources.end( );
+			     ++it)
+			{
+				if (it->TypeIndex == t)
+				{
+					Checked = true;
+					break;
+				}
+			}
+
+			if (!Checked)
+			{
+				fprintf(
+					f,
+					"%s\t%s\tFAILED\tResource was not checked.\n",
+					ResRef.c_str( ),
+					ResourceManager::ResTypeToExt( ValidateTypes[ t ].ResType ));
+			}
+		}
+	}
+
+	return (fclose( f ) == 0);
+}
+
+void
+PrintUsage(
+	)
+/*++
+
+Routine Description:
+
+	This routine prints usage information for the program to the console.
+
+Arguments:
+
+	None.
+
+Return Value:
+
+	None.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	printf(
+		"ValidateModule\n"
+		"\n"
+		"This program checks the integrity of the GFF, 2DA, compiled script and area\n"
+		"terrain resources of a module and its HAKs.\n"
+		"\n"
+		"Usage: ValidateModule -home <homedir> -installdir <installdir>\n"
+		"                      -module <module resource name>\n"
+		"                      [-report <report file>]\n"
+		"                      [-threads <worker thread count>]\n"
+		"\n"
+		"The report is a tab separated file with one line for each resource.  The\n"
+		"program exits with status 1 if any resource is malformed.\n"
+		);
+}
+
+int
+__cdecl
+main(
+	__in int argc,
+	__in_ecount( argc ) const char * * argv
+	)
+/*++
+
+Routine Description:
+
+	This routine is the entry point symbol for the module validator program.
+
+Arguments:
+
+	argc - Supplies the count of command line arguments.
+
+	argv - Supplies the command line argument vector.
+
+Return Value:
+
+	The routine returns the process exit code.
+
+Environment:
+
+	User mode.
+
+--*/
+{
+	const char    * ModuleName;
+	const char    * NWN2Home;
+	const char    * InstallDir;
+	const char    * ReportFile;
+	unsigned long   MaxThreads;
+	int             ExitCode;
+
+	ModuleName = NULL;
+	NWN2Home   = NULL;
+	InstallDir = NULL;
+	ReportFile = NULL;
+	MaxThreads = 0;
+
+	//
+	// Parse out the command line arguments.
+	//
+
+	for (int i = 1; i < argc; i += 1)
+	{
+		if ((!_stricmp( argv[ i ], "-module" )) && (i + 1 < argc))
+			ModuleName = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-home" )) && (i + 1 < argc))
+			NWN2Home = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-installdir" )) && (i + 1 < argc))
+			InstallDir = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-report" )) && (i + 1 < argc))
+			ReportFile = argv[ ++i ];
+		else if ((!_stricmp( argv[ i ], "-threads" )) && (i + 1 < argc))
+			MaxThreads = strtoul( argv[ ++i ], NULL, 10 );
+		else
+		{
+			PrintUsage( );
+			printf( "\nUnrecognized command line argument.\n" );
+			return -1;
+		}
+	}
+
+	//
+	// First, check that we've got the necessary arguments.
+	//
+
+	if (ModuleName == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the module resource name of the module to load with -module <module resource name>.  The module resource name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (NWN2Home == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 home directory location with -home <homedir>.  The home directory is typically the path to your \"Documents\\Neverwinter Nights 2\" directory.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	if (InstallDir == NULL)
+	{
+		PrintUsage( );
+		printf( "\nYou must specify the NWN2 game installation directory location with -installdir <installdir>.  The installation directory is typically the path to the Neverwinter Nights 2 directory under Program Files.  The directory name must be enclosed in quotes if it contains spaces.\n" );
+		return -1;
+	}
+
+	//
+	// Now spin up a resource manager instance.
+	//
+
+	PrintfTextOut   TextOut;
+	ResourceManager ResMan( &TextOut );
+
+	ExitCode = 0;
+
+	try
+	{
+		ItemResultVec Results;
+		ULONG         Checked[ RTL_NUMBER_OF( ValidateTypes ) ];
+		ULONG         Failed[ RTL_NUMBER_OF( ValidateTypes ) ];
+		ULONG         TotalChecked;
+		ULONG         TotalFailed;
+
+		TextOut.WriteText( "Loading module...\n" );
+		ModuleScan::LoadModule( ResMan, ModuleName, NWN2Home, InstallDir );
+
+		ModuleScan   Scan( ResMan, &TextOut );
+		NWN::ResType Types[ RTL_NUMBER_OF( ValidateTypes ) ];
+
+		for (size_t i = 0; i < RTL_NUMBER_OF( ValidateTypes ); i += 1)
+			Types[ i ] = ValidateTypes[ i ].ResType;
+
+		Scan.SetScanTypes( Types, RTL_NUMBER_OF( Types ) );
+
+		AddModuleResources( ResMan, Scan, Results );
+
+		TextOut.WriteText( "Validating %lu resource names...\n", (unsigned long) Results.size( ) );
+
+		ModuleValidateVisitor Visitor( Results );
+
+		if (!Scan.Scan( &Visitor, MaxThreads ))
+			ExitCode = 1;
+
+		//
+		// Tally the results by resource type.
+		//
+
+		ZeroMemory( Checked, sizeof( Checked ) );
+		ZeroMemory( Failed, sizeof( Failed ) );
+
+		TotalChecked = 0;
+		TotalFailed  = 0;
+
+		for (ItemResultVec::const_iterator it = Results.begin( );
+		     it != Results.end( );
+		     ++it)
+		{
+			for (ResourceResultVec::const_iterator rit = it->Resources.begin( );
+			     rit != it->Resources.end( );
+			     ++rit)
+			{
+				Checked[ rit->TypeIndex ] += 1;
+				TotalChecked              += 1;
+
+				if (!rit->Passed)
+				{
+					Failed[ rit->TypeIndex ] += 1;
+					TotalFailed              += 1;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < RTL_NUMBER_OF( ValidateTypes ); i += 1)
+		{
+			if (Checked[ i ] == 0)
+				continue;
+
+			TextOut.WriteText(
+				"   %s: %lu checked, %lu failed\n",
+				ResourceManager::ResTypeToExt( ValidateTypes[ i ].ResType ),
+				Checked[ i ],
+				Failed[ i ]);
+		}
+
+		TextOut.WriteText(
+			"Validated %lu resources (%lu failed) in %lums (%lums locating resources) with %lu threads.\n",
+			TotalChecked,
+			TotalFailed,
+			Scan.GetStats( ).PrepareTime + Scan.GetStats( ).VisitTime,
+			Scan.GetStats( ).PrepareTime,
+			Scan.GetStats( ).Threads);
+
+		if (TotalFailed != 0)
+			ExitCode = 1;
+
+		if (ReportFile != NULL)
+		{
+			if (!WriteReport( ReportFile, ResMan, Scan, Results ))
+			{
+				TextOut.WriteText( "ERROR: Failed to write report file '%s'.\n", ReportFile );
+				ExitCode = -1;
+			}
+		}
+	}
+	catch (std::exception &e)
+	{
+		TextOut.WriteText( "ERROR: Exception '%s'.\n", e.what( ) );
+		ExitCode = -1;
+	}
+
+	return ExitCode;
+}